@@ -0,0 +1,140 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Benchmark
+{
+    class Timer
+    {
+    public:
+        Timer() : m_start( std::chrono::steady_clock::now() ) {}
+
+        double GetMilliseconds() const
+        {
+            return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - m_start ).count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    // Timed repetitions of one case, in milliseconds
+    struct Result
+    {
+        std::string name;
+        uint64_t    items;          // work done by one repetition, 0 when it has no natural unit
+        uint32_t    repetitions;
+        double      median;
+        double      mean;
+        double      stddev;
+        double      min;
+        double      max;
+    };
+
+    // Keeps the case for WriteResults and returns the median of times, which must not be empty. Names are
+    // unique and stable across runs, so results of two builds can be compared case by case.
+    double Record( const std::string& name, const std::vector<double>& times, uint64_t items = 0 );
+
+    const std::vector<Result>& GetResults();
+
+    // Every recorded case as JSON; false when the file could not be written
+    bool WriteResults( const std::string& path );
+
+    struct SoftwareRasterizerOptions
+    {
+        SoftwareRasterizerOptions()
+            : width( 1280 )
+            , height( 720 )
+            , shadowMapSize( 2048 )
+            , sphereCount( 16 )
+            , iterations( 10 )
+        {
+        }
+
+        uint32_t    width;
+        uint32_t    height;
+        uint32_t    shadowMapSize;
+        uint32_t    sphereCount; // procedural scene, used when objPath is empty
+        uint32_t    iterations;
+        std::string objPath;
+        std::string outputPath;  // writes <outputPath>.ppm and <outputPath>_shadow.pgm when set
+    };
+
+    struct SceneOptions
+    {
+        SceneOptions()
+            : nodeCount( 100000 )
+            , cameraUpdates( 100000 )
+            , iterations( 10 )
+        {
+        }
+
+        uint32_t    nodeCount;
+        uint32_t    cameraUpdates;
+        uint32_t    iterations;
+        std::string objPath;     // generated sphere when empty
+    };
+
+    // Each benchmark prints its own results and returns false when its validation failed
+    // Shader cache keys, invalidation and corrupt entries, then shaderCount stub compiles fetched cold and warm
+    bool RunShaderCache( uint32_t shaderCount, uint32_t iterations );
+
+    // Descriptor ranges: first fit, merging and reuse, transient slices held until their frame completes, then churn
+    bool RunDescriptorAllocator( uint32_t operationCount, uint32_t iterations );
+
+    // Upload ring wrap-around, alignment, overflow and fence-gated reuse, then allocating and re-referencing constants
+    bool RunUploadRing( uint32_t allocationCount, uint32_t iterations );
+
+    bool RunDrawSort( uint32_t itemCount, uint32_t iterations );
+    bool RunSoftwareRasterizer( const SoftwareRasterizerOptions& options );
+
+    // Cascaded shadow fits covering the view frustum, texel snapping, splits and atlas tiles, then fitCount fits
+    bool RunShadowFrustum( uint32_t fitCount, uint32_t iterations );
+
+    // Light counts from 1024 up to maxLightCount in steps of 4x
+    bool RunLightClusters( uint32_t maxLightCount, uint32_t iterations );
+
+    // Every BatchMath kernel on itemCount matrices, points, boxes or spheres, on each path the processor supports
+    bool RunBatchMath( uint32_t itemCount, uint32_t iterations );
+
+    // Render loop of frameCount frames consuming a synthetic mouse sampled on its own thread
+    bool RunInputSampler( uint32_t frameCount, double frameMilliseconds );
+
+    // Cost of scopeCount profiler scopes, compiled in and disabled or enabled, against none
+    bool RunProfiler( uint32_t scopeCount, uint32_t iterations );
+
+    // GPU pass timing on mock timestamp queries: resolve, latency and stalls, then the bookkeeping per frame
+    bool RunGpuTimer( uint32_t frameCount, uint32_t iterations );
+
+    // Memory accounting on the mock backend: categories, owners, peaks and budgets, then tracking cost
+    bool RunMemoryTracker( uint32_t allocationCount, uint32_t iterations );
+
+    // Frame scheduling on a fake clock: invalidations, progressive work and polling, then the cost per loop iteration
+    bool RunFrameScheduler( uint32_t iterationCount, uint32_t iterations );
+
+    // The viewer's OBJ loading, bounds and orbit camera, node hierarchy of a generated scene, then culling and
+    // recording through the viewer's draw recorder from 10K nodes up
+    bool RunScene( const SceneOptions& options );
+
+    // Synthetic scenes: determinism, config and file round trip, then generation, recording through the viewer's
+    // draw recorder, writing and reading at scale
+    bool RunSceneGenerator( uint32_t maxObjectCount, uint32_t iterations );
+
+    // Frame statistics: rolling percentiles, histograms and the baseline regression gate, then the cost per frame
+    bool RunFrameStatistics( uint32_t frameCount, uint32_t iterations );
+
+    // Frame arena checks, a headless frame that must not touch the heap, then arena against heap
+    bool RunFrameArena( uint32_t allocationCount, uint32_t iterations );
+
+    // TLSF and buffer suballocator checks, then random churn, defragmentation and memory against committed resources
+    bool RunBufferSuballocator( uint32_t operationCount, uint32_t iterations );
+
+    // Job system checks under stress, then job overhead, a job tree, transforms and culling from 1 thread to every core
+    bool RunJobSystem( uint32_t jobCount, uint32_t iterations );
+
+    // Pipeline compiler checks, then a scene's first frames with pipelines created inline against in the background
+    bool RunPipelineCompiler( uint32_t pipelineCount, uint32_t iterations );
+}
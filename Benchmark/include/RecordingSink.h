@@ -0,0 +1,54 @@
+#pragma once
+
+#include "DrawRecorder.h"
+
+#include <cstdint>
+#include <vector>
+
+// Command sink that keeps what DrawRecorder::Record issues instead of sending it, so the stream can be
+// replayed and checked. Root signatures and pipelines are recorded by address, draws by their packet's.
+class RecordingSink : public DrawRecorder::CommandSink
+{
+public:
+    enum COMMAND
+    {
+        COMMAND_SET_ROOT_SIGNATURE,
+        COMMAND_SET_CONSTANT_BUFFER,
+        COMMAND_SET_SHADER_RESOURCE,
+        COMMAND_SET_DESCRIPTOR_HEAP,
+        COMMAND_SET_DESCRIPTOR_TABLE,
+        COMMAND_SET_PIPELINE_STATE,
+        COMMAND_DRAW,
+    };
+
+    struct Command
+    {
+        COMMAND  type;
+        uint32_t parameter;
+        uint64_t value;
+    };
+
+public:
+    // Keeps the capacity, so a stream no longer than the last one allocates nothing
+    void Reset() { m_commands.clear(); }
+
+    virtual void SetRootSignature( const DrawRecorder::Packet& packet );
+    virtual void SetConstantBuffer( uint32_t parameter, uint64_t address );
+    virtual void SetShaderResource( uint32_t parameter, uint64_t address );
+    virtual void SetDescriptorHeap();
+    virtual void SetDescriptorTable( uint32_t parameter, uint32_t descriptorIndex );
+    virtual void SetPipelineState( const DrawRecorder::Packet& packet );
+    virtual void Draw( const DrawRecorder::Packet& packet );
+
+    // Replays the stream as the GPU would see it: every draw must find exactly the state of its packet, and
+    // the draws must be the recorder's packets in its sorted order
+    bool Verify( const DrawRecorder& recorder ) const;
+
+    const std::vector<Command>& GetCommands() const { return m_commands; }
+
+private:
+    void Add( COMMAND type, uint32_t parameter, uint64_t value );
+
+private:
+    std::vector<Command> m_commands;
+};
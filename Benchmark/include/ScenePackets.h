@@ -0,0 +1,48 @@
+#pragma once
+
+#include "DrawBindings.h"
+#include "DrawRecorder.h"
+#include "SceneGenerator.h"
+
+#include <cstdint>
+#include <vector>
+
+// The viewer's forward pass over a generated scene, once Scene::AddGenerated made a model of every mesh node.
+// Construct binds each model's context through DrawBindings::BindForward as RenderPassForward::Construct does,
+// Create makes its packet through DrawBindings::CreatePacket as RenderContext::GetDrawPacket does. The nodes are
+// stand-ins with fixed addresses, and the root signature and pipeline are only ever compared.
+class ScenePackets
+{
+public:
+    void Construct( const GeneratedScene& scene );
+
+    // Packet of a mesh node with its world bounds; false for nodes without a mesh
+    bool Create( uint32_t node, const float boundsMin[3], const float boundsMax[3], DrawRecorder::Packet& packet ) const;
+
+private:
+    // Addresses of a node's constants and of its buffers, 64 KB apart
+    class Source : public DrawBindings::Source
+    {
+    public:
+        Source( uint64_t constantBuffer = 0, uint64_t shaderResources = 0, uint32_t shaderResourceCount = 0 );
+
+        virtual uint64_t GetConstantBufferAddress() const { return m_constantBuffer; }
+        virtual uint32_t GetShaderResourceCount() const { return m_shaderResourceCount; }
+        virtual uint64_t GetShaderResourceAddress( uint32_t index ) const { return m_shaderResources + index * 0x10000ull; }
+
+    private:
+        uint64_t m_constantBuffer;
+        uint64_t m_shaderResources;
+        uint32_t m_shaderResourceCount;
+    };
+
+private:
+    Source m_camera;
+    Source m_light;
+    Source m_lightClusters;
+
+    std::vector<Source>       m_materials;     // one per context, standing in for its model
+    std::vector<DrawBindings> m_contexts;      // mesh nodes in scene order
+    std::vector<uint32_t>     m_contextOfNode;   // UINT32_MAX for nodes without a mesh
+    std::vector<uint32_t>     m_indexCounts;   // per context
+};
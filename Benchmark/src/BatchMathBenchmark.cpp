@@ -0,0 +1,336 @@
+#include "Benchmarks.h"
+#include "BatchMath.h"
+#include "ShadowFrustum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    double Measure( const string& name, uint32_t iterations, uint64_t items, const function<void()>& func )
+    {
+        vector<double> times;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            Benchmark::Timer timer;
+            func();
+            times.push_back( timer.GetMilliseconds() );
+        }
+
+        return Benchmark::Record( name, times, items );
+    }
+
+    bool IsNear( float a, float b )
+    {
+        return fabsf( a - b ) <= 1e-4f * (1.0f + fabsf( b ));
+    }
+
+    bool IsInside( const float viewProjection[16], const float point[4] )
+    {
+        float clip[4];
+        ShadowFrustum::Transform( viewProjection, point, clip );
+        return clip[3] > 0.0f && fabsf( clip[0] ) < clip[3] && fabsf( clip[1] ) < clip[3] && clip[2] > 0.0f && clip[2] < clip[3];
+    }
+
+    // Rigid transform with a uniform scale, as world and view matrices are
+    void CreateAffine( mt19937& random, float m[16] )
+    {
+        uniform_real_distribution<float> unit( -1.0f, 1.0f );
+        uniform_real_distribution<float> scale( 0.5f, 2.0f );
+
+        const float angle  = 3.14159265f * unit( random );
+        const float factor = scale( random );
+        const float c = cosf( angle ) * factor;
+        const float s = sinf( angle ) * factor;
+
+        const float rotation[16]    = { c, 0.0f, -s, 0.0f,  0.0f, factor, 0.0f, 0.0f,  s, 0.0f, c, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f };
+        const float translation[16] = { 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,
+                                        100.0f * unit( random ), 100.0f * unit( random ), 100.0f * unit( random ), 1.0f };
+        ShadowFrustum::Multiply( translation, rotation, m );
+    }
+
+    struct Kernel
+    {
+        const char*                 name;
+        function<void( BatchMath::PATH )> run;
+        function<vector<uint8_t>()> output;     // bytes compared between the paths
+        function<void()>            reference;  // same work through ShadowFrustum, one item per call; may be empty
+        function<bool()>            check;      // scalar output against the reference output
+    };
+}
+
+bool Benchmark::RunBatchMath( uint32_t itemCount, uint32_t iterations )
+{
+    const size_t count = max( 1u, itemCount );
+
+    mt19937 random( 12345 );
+    uniform_real_distribution<float> unit( -1.0f, 1.0f );
+
+    // Inputs
+    float matrix[16];
+    CreateAffine( random, matrix );
+
+    vector<float> matrices( count * 16 );
+    for (size_t i = 0; i < count; ++i)
+    {
+        CreateAffine( random, &matrices[i * 16] );
+    }
+
+    vector<float> x( count ), y( count ), z( count ), radius( count );
+    vector<float> boxMin[3], boxMax[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        boxMin[axis].resize( count );
+        boxMax[axis].resize( count );
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        x[i]      = 200.0f * unit( random );
+        y[i]      = 20.0f * unit( random );
+        z[i]      = 200.0f * unit( random );
+        radius[i] = 1.0f + 4.0f * fabsf( unit( random ) );
+
+        const float center[3] = { x[i], y[i], z[i] };
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            boxMin[axis][i] = center[axis] - radius[i];
+            boxMax[axis][i] = center[axis] + radius[i] * fabsf( unit( random ) );
+        }
+    }
+    const BatchMath::ConstBoxes boxes = { { boxMin[0].data(), boxMin[1].data(), boxMin[2].data() },
+                                          { boxMax[0].data(), boxMax[1].data(), boxMax[2].data() } };
+
+    // 16:9 camera 10 units up looking down +z
+    float projection[16] = { 0.0f };
+    projection[0]  = 1.732f / (16.0f / 9.0f);
+    projection[5]  = 1.732f;
+    projection[10] = 250.0f / 249.5f;
+    projection[11] = 1.0f;
+    projection[14] = -0.5f * 250.0f / 249.5f;
+
+    float view[16] = { 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, -10.0f, 0.0f, 1.0f };
+    float viewProjection[16];
+    ShadowFrustum::Multiply( projection, view, viewProjection );
+
+    float planes[24];
+    BatchMath::GetFrustumPlanes( viewProjection, planes );
+
+    // Outputs
+    vector<float> outMatrices( count * 16 ), referenceMatrices( count * 16 );
+    vector<float> outX( count ), outY( count ), outZ( count ), referencePoints( count * 3 );
+    vector<float> outMin[3], outMax[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        outMin[axis].resize( count );
+        outMax[axis].resize( count );
+    }
+    const BatchMath::Boxes outBoxes = { { outMin[0].data(), outMin[1].data(), outMin[2].data() },
+                                        { outMax[0].data(), outMax[1].data(), outMax[2].data() } };
+    vector<uint8_t> visible( count );
+
+    auto bytes = []( const vector<float>& values )
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(values.data());
+        return vector<uint8_t>( p, p + values.size() * sizeof( float ) );
+    };
+
+    auto checkMatrices = [&]()
+    {
+        for (size_t i = 0; i < outMatrices.size(); ++i)
+        {
+            if (!IsNear( outMatrices[i], referenceMatrices[i] ))
+                return false;
+        }
+        return true;
+    };
+
+    const Kernel kernels[] =
+    {
+        {
+            "multiply",
+            [&]( BatchMath::PATH path ) { BatchMath::MultiplyArray( matrix, matrices.data(), outMatrices.data(), count, path ); },
+            [&]() { return bytes( outMatrices ); },
+            [&]()
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    ShadowFrustum::Multiply( matrix, &matrices[i * 16], &referenceMatrices[i * 16] );
+                }
+            },
+            checkMatrices,
+        },
+        {
+            "affine inverse",
+            [&]( BatchMath::PATH path ) { BatchMath::InvertAffineArray( matrices.data(), outMatrices.data(), count, path ); },
+            [&]() { return bytes( outMatrices ); },
+            [&]()
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    ShadowFrustum::Invert( &matrices[i * 16], &referenceMatrices[i * 16] );
+                }
+            },
+            checkMatrices,
+        },
+        {
+            "point transform",
+            [&]( BatchMath::PATH path ) { BatchMath::TransformPoints( matrix, x.data(), y.data(), z.data(), count, outX.data(), outY.data(), outZ.data(), path ); },
+            [&]()
+            {
+                vector<uint8_t> result = bytes( outX );
+                const vector<uint8_t> resultY = bytes( outY );
+                const vector<uint8_t> resultZ = bytes( outZ );
+                result.insert( result.end(), resultY.begin(), resultY.end() );
+                result.insert( result.end(), resultZ.begin(), resultZ.end() );
+                return result;
+            },
+            [&]()
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const float point[4] = { x[i], y[i], z[i], 1.0f };
+                    float result[4];
+                    ShadowFrustum::Transform( matrix, point, result );
+                    copy( result, result + 3, &referencePoints[i * 3] );
+                }
+            },
+            [&]()
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    if (!IsNear( outX[i], referencePoints[i * 3] ) || !IsNear( outY[i], referencePoints[i * 3 + 1] ) || !IsNear( outZ[i], referencePoints[i * 3 + 2] ))
+                        return false;
+                }
+                return true;
+            },
+        },
+        {
+            "box transform",
+            [&]( BatchMath::PATH path ) { BatchMath::TransformBoxes( matrix, boxes, count, outBoxes, path ); },
+            [&]()
+            {
+                vector<uint8_t> result;
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    const vector<uint8_t> resultMin = bytes( outMin[axis] );
+                    const vector<uint8_t> resultMax = bytes( outMax[axis] );
+                    result.insert( result.end(), resultMin.begin(), resultMin.end() );
+                    result.insert( result.end(), resultMax.begin(), resultMax.end() );
+                }
+                return result;
+            },
+            nullptr,
+            // Every transformed corner lies inside the transformed box
+            [&]()
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    for (int corner = 0; corner < 8; ++corner)
+                    {
+                        const float point[4] = { (corner & 1) ? boxMax[0][i] : boxMin[0][i],
+                                                 (corner & 2) ? boxMax[1][i] : boxMin[1][i],
+                                                 (corner & 4) ? boxMax[2][i] : boxMin[2][i], 1.0f };
+                        float result[4];
+                        ShadowFrustum::Transform( matrix, point, result );
+                        for (int axis = 0; axis < 3; ++axis)
+                        {
+                            const float tolerance = 1e-4f * (1.0f + fabsf( result[axis] ));
+                            if (result[axis] < outMin[axis][i] - tolerance || result[axis] > outMax[axis][i] + tolerance)
+                                return false;
+                        }
+                    }
+                }
+                return true;
+            },
+        },
+        {
+            "sphere test",
+            [&]( BatchMath::PATH path ) { BatchMath::TestSpheres( planes, 6, x.data(), y.data(), z.data(), radius.data(), count, visible.data(), path ); },
+            [&]() { return visible; },
+            nullptr,
+            // Spheres whose center projects inside the clip volume are never culled
+            [&]()
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const float point[4] = { x[i], y[i], z[i], 1.0f };
+                    if (IsInside( viewProjection, point ) && !visible[i])
+                        return false;
+                }
+                return true;
+            },
+        },
+        {
+            "box test",
+            [&]( BatchMath::PATH path ) { BatchMath::TestBoxes( planes, 6, boxes, count, visible.data(), path ); },
+            [&]() { return visible; },
+            nullptr,
+            // Boxes with a corner inside the clip volume are never culled
+            [&]()
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    for (int corner = 0; corner < 8; ++corner)
+                    {
+                        const float point[4] = { (corner & 1) ? boxMax[0][i] : boxMin[0][i],
+                                                 (corner & 2) ? boxMax[1][i] : boxMin[1][i],
+                                                 (corner & 4) ? boxMax[2][i] : boxMin[2][i], 1.0f };
+                        if (IsInside( viewProjection, point ) && !visible[i])
+                            return false;
+                    }
+                }
+                return true;
+            },
+        },
+    };
+
+    cout << "BatchMath: " << count << " items, best path " << BatchMath::GetPathName( BatchMath::PATH_BEST )
+         << ", median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = true;
+
+    const BatchMath::PATH bestPath = BatchMath::GetBestPath();
+    for (const Kernel& kernel : kernels)
+    {
+        cout << "  " << kernel.name << endl;
+
+        if (kernel.reference)
+        {
+            const double time = Measure( string( "BatchMath/" ) + kernel.name + "/reference", iterations, count, kernel.reference );
+            cout << "    " << setw( 8 ) << "reference" << setw( 10 ) << time << " ms"
+                 << "  " << setw( 8 ) << setprecision( 1 ) << count / time / 1000.0 << " M items/s" << setprecision( 3 ) << endl;
+        }
+
+        // The scalar output is checked against the reference, the SIMD outputs against the scalar one byte for byte
+        kernel.run( BatchMath::PATH_SCALAR );
+        const vector<uint8_t> scalarOutput = kernel.output();
+        const bool bChecked = kernel.check();
+        cout << "    reference check " << (bChecked ? "passed" : "FAILED") << endl;
+        bSucceeded &= bChecked;
+
+        for (int path = BatchMath::PATH_SCALAR; path <= bestPath; ++path)
+        {
+            const double time = Measure( string( "BatchMath/" ) + kernel.name + "/" + BatchMath::GetPathName( static_cast<BatchMath::PATH>(path) ),
+                                         iterations, count, [&]() { kernel.run( static_cast<BatchMath::PATH>(path) ); } );
+            const bool bMatched = kernel.output() == scalarOutput;
+
+            cout << "    " << setw( 8 ) << BatchMath::GetPathName( static_cast<BatchMath::PATH>(path) ) << setw( 10 ) << time << " ms"
+                 << "  " << setw( 8 ) << setprecision( 1 ) << count / time / 1000.0 << " M items/s" << setprecision( 3 )
+                 << (bMatched ? "" : "  MISMATCH") << endl;
+
+            bSucceeded &= bMatched;
+        }
+    }
+
+    return bSucceeded;
+}
@@ -0,0 +1,467 @@
+#include "Benchmarks.h"
+#include "BufferSuballocator.h"
+#include "MemoryTracker.h"
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const uint64_t KiB = 1024;
+    const uint64_t MiB = 1024 * KiB;
+
+    // Sizes spread evenly over the powers of two from 256 bytes to 256 KiB, like a scene of small and large meshes
+    uint64_t RandomSize( mt19937& random, uint64_t minSize = 256, uint64_t maxSize = 256 * KiB )
+    {
+        uniform_real_distribution<double> exponent( log( static_cast<double>(minSize) ), log( static_cast<double>(maxSize) ) );
+        return static_cast<uint64_t>(exp( exponent( random ) ));
+    }
+
+    // Blocks without storage, so the workloads measure the allocator alone
+    class NullBlockBackend : public BufferBlockBackend
+    {
+    public:
+        virtual bool CreateBlock( uint32_t, uint64_t ) { return true; }
+        virtual void DestroyBlock( uint32_t ) {}
+        virtual void Copy( uint32_t, uint64_t, uint32_t, uint64_t, uint64_t ) {}
+    };
+
+    unsigned char PatternByte( BufferSuballocator::Handle handle, uint64_t i )
+    {
+        return static_cast<unsigned char>(handle * 31 + i * 7);
+    }
+
+    // Random allocations and frees with mixed alignments: aligned, never overlapping, merged back to one range
+    bool CheckTlsf()
+    {
+        const uint64_t CAPACITY = 16 * MiB;
+        const uint32_t OP_COUNT = 20000;
+
+        TlsfAllocator allocator( CAPACITY, 256 );
+
+        struct Live
+        {
+            uint32_t node;
+            uint64_t size;
+            uint64_t alignment;
+        };
+
+        mt19937 random( 7 );
+        const uint64_t alignments[] = { 0, 256, 4096, 64 * KiB };
+
+        vector<Live> live;
+        bool     bPassed       = true;
+        size_t   peakLive      = 0;
+        uint32_t maxFreeRanges = 0;
+        uint32_t failures      = 0;
+        for (uint32_t i = 0; i < OP_COUNT; ++i)
+        {
+            if (live.empty() || random() % 100 < 55)
+            {
+                const uint64_t size      = RandomSize( random );
+                const uint64_t alignment = alignments[random() % 4];
+                const uint32_t node      = allocator.Allocate( size, alignment );
+                if (node == TlsfAllocator::INVALID_NODE)
+                {
+                    failures++;
+                    continue;
+                }
+
+                const Live entry = { node, size, alignment };
+                live.push_back( entry );
+
+                bPassed &= allocator.GetSize( node ) >= size && (allocator.GetOffset( node ) & (max<uint64_t>( alignment, 256 ) - 1)) == 0;
+            }
+            else
+            {
+                const size_t index = random() % live.size();
+                allocator.Free( live[index].node );
+                live[index] = live.back();
+                live.pop_back();
+            }
+
+            peakLive      = max( peakLive, live.size() );
+            maxFreeRanges = max( maxFreeRanges, allocator.GetFreeRangeCount() );
+        }
+
+        bPassed &= allocator.Validate() && failures > 0 && failures < OP_COUNT / 4;
+
+        // Live ranges in offset order must not overlap
+        sort( live.begin(), live.end(), [&]( const Live& a, const Live& b ) { return allocator.GetOffset( a.node ) < allocator.GetOffset( b.node ); } );
+        for (size_t i = 1; i < live.size(); ++i)
+        {
+            bPassed &= allocator.GetOffset( live[i - 1].node ) + allocator.GetSize( live[i - 1].node ) <= allocator.GetOffset( live[i].node );
+        }
+
+        for (const Live& entry : live)
+        {
+            allocator.Free( entry.node );
+        }
+
+        bPassed &= allocator.Validate() && allocator.GetUsedBytes() == 0 && allocator.GetAllocationCount() == 0 &&
+                   allocator.GetFreeRangeCount() == 1 && allocator.GetLargestFreeRange() == CAPACITY;
+
+        // Exact fits, including the whole block
+        const uint32_t whole = allocator.Allocate( CAPACITY );
+        bPassed &= whole != TlsfAllocator::INVALID_NODE && allocator.Allocate( 1 ) == TlsfAllocator::INVALID_NODE &&
+                   allocator.Allocate( 0 ) == TlsfAllocator::INVALID_NODE;
+        allocator.Free( whole );
+        bPassed &= allocator.GetFreeRangeCount() == 1;
+
+        cout << "  tlsf check              " << (bPassed ? "passed" : "FAILED") << " (" << OP_COUNT << " operations, peak " << peakLive
+             << " live, " << maxFreeRanges << " free ranges at most, " << failures << " full)" << endl;
+
+        return bPassed;
+    }
+
+    // Freed ranges wait for their fence, empty blocks are destroyed, large buffers get a block of their own
+    bool CheckDeferredFree()
+    {
+        MockBufferBlockBackend backend;
+        BufferSuballocator suballocator( backend, MiB );
+
+        const BufferSuballocator::Handle a = suballocator.Allocate( 512 * KiB );
+        const BufferSuballocator::Handle b = suballocator.Allocate( 512 * KiB );
+        const uint64_t offsetA = suballocator.GetLocation( a ).offset;
+
+        // The GPU may still read a in frame 1, so c goes into a new block
+        suballocator.Free( a );
+        const BufferSuballocator::Handle c = suballocator.Allocate( 512 * KiB );
+        bool bPassed = suballocator.GetLocation( b ).block == 0 && suballocator.GetLocation( c ).block == 1 &&
+                       suballocator.GetStatistics().pendingBytes == 512 * KiB;
+
+        suballocator.EndFrame( 1 );
+        suballocator.Reclaim( 0 );
+        bPassed &= suballocator.GetStatistics().pendingBytes == 512 * KiB;
+
+        suballocator.Reclaim( 1 );
+        const BufferSuballocator::Handle d = suballocator.Allocate( 512 * KiB );
+        const BufferSuballocator::Location locationD = suballocator.GetLocation( d );
+        bPassed &= locationD.block == 0 && locationD.offset == offsetA && suballocator.GetStatistics().pendingBytes == 0;
+
+        // Block 1 empties and goes, block 0 stays as the last ordinary block
+        suballocator.Free( c );
+        suballocator.EndFrame( 2 );
+        suballocator.Reclaim( 2 );
+        bPassed &= suballocator.GetStatistics().blocks == 1 && backend.GetLiveBlockCount() == 1;
+
+        const BufferSuballocator::Handle large = suballocator.Allocate( 3 * MiB );
+        const BufferSuballocator::Location locationLarge = suballocator.GetLocation( large );
+        bPassed &= locationLarge.block == 1 && locationLarge.size == 3 * MiB && suballocator.GetStatistics().blockBytes == 4 * MiB;
+
+        suballocator.Free( large );
+        suballocator.Free( b );
+        suballocator.Free( d );
+        suballocator.EndFrame( 3 );
+        suballocator.Reclaim( 3 );
+
+        const BufferSuballocator::Statistics stats = suballocator.GetStatistics();
+        bPassed &= suballocator.Validate() && stats.blocks == 1 && stats.allocations == 0 && stats.usedBytes == 0 &&
+                   stats.blocksCreated == 3 && stats.blocksDestroyed == 2 && backend.GetLiveBlockCount() == 1;
+
+        cout << "  deferred free check     " << (bPassed ? "passed" : "FAILED") << " (" << stats.blocksCreated << " blocks created, "
+             << stats.blocksDestroyed << " destroyed)" << endl;
+
+        return bPassed;
+    }
+
+    // A scene loaded and mostly unloaded again: defragmenting a budget per frame frees blocks and keeps every byte
+    bool CheckDefragment()
+    {
+        const uint32_t BUFFER_COUNT = 2000;
+        const uint64_t FRAME_BYTES  = 256 * KiB;
+
+        MockBufferBlockBackend backend;
+        BufferSuballocator suballocator( backend, MiB );
+
+        mt19937 random( 11 );
+        vector<BufferSuballocator::Handle> handles;
+        for (uint32_t i = 0; i < BUFFER_COUNT; ++i)
+        {
+            const BufferSuballocator::Handle handle = suballocator.Allocate( RandomSize( random, 256, 16 * KiB ), random() % 2 ? 0 : 4096 );
+            const BufferSuballocator::Location location = suballocator.GetLocation( handle );
+
+            unsigned char* pData = backend.GetData( location.block ) + location.offset;
+            for (uint64_t j = 0; j < location.size; ++j)
+            {
+                pData[j] = PatternByte( handle, j );
+            }
+
+            handles.push_back( handle );
+        }
+
+        // Three of five unloaded
+        shuffle( handles.begin(), handles.end(), random );
+        for (size_t i = handles.size() * 2 / 5; i < handles.size(); ++i)
+        {
+            suballocator.Free( handles[i] );
+        }
+        handles.resize( handles.size() * 2 / 5 );
+
+        uint64_t frame = 1;
+        suballocator.EndFrame( frame );
+        suballocator.Reclaim( frame );
+
+        const BufferSuballocator::Statistics before = suballocator.GetStatistics();
+
+        // Each frame's moves free their ranges two frames later, as with two frames in flight
+        uint32_t frames  = 0;
+        uint64_t maxMove = 0;
+        while (frames < 1000)
+        {
+            frame++;
+            suballocator.Reclaim( frame - 2 );
+            const uint64_t moved = suballocator.Defragment( FRAME_BYTES );
+            suballocator.EndFrame( frame );
+
+            maxMove = max( maxMove, moved );
+            frames++;
+            if (moved == 0)
+                break;
+        }
+        suballocator.Reclaim( frame );
+
+        const BufferSuballocator::Statistics after = suballocator.GetStatistics();
+
+        bool bIntact = true;
+        for (BufferSuballocator::Handle handle : handles)
+        {
+            const BufferSuballocator::Location location = suballocator.GetLocation( handle );
+            const unsigned char* pData = backend.GetData( location.block ) + location.offset;
+            for (uint64_t j = 0; j < location.size && bIntact; ++j)
+            {
+                bIntact = pData[j] == PatternByte( handle, j );
+            }
+        }
+
+        // A frame goes over its budget by less than one buffer
+        const bool bPassed = bIntact && suballocator.Validate() && frames < 1000 && maxMove < FRAME_BYTES + 16 * KiB &&
+                             after.blocks < before.blocks && after.GetFragmentation() < before.GetFragmentation() &&
+                             after.allocations == handles.size() && after.moves > 0 && backend.GetLiveBlockCount() == after.blocks;
+
+        cout << "  defragment check        " << (bPassed ? "passed" : "FAILED") << " (blocks " << before.blocks << " -> " << after.blocks
+             << ", fragmentation " << setprecision( 1 ) << before.GetFragmentation() * 100.0 << "% -> " << after.GetFragmentation() * 100.0
+             << "%, " << after.moves << " moves in " << frames << " frames)" << setprecision( 3 ) << endl;
+
+        return bPassed;
+    }
+
+    struct ChurnResult
+    {
+        uint64_t                      operations;
+        uint64_t                      committedBytes;    // the live buffers as a committed resource each
+        BufferSuballocator::Statistics statistics;
+    };
+
+    // operationCount allocations and frees around a live set of liveCount buffers, one frame every 64 operations
+    ChurnResult Churn( BufferSuballocator& suballocator, uint32_t operationCount, uint32_t liveCount, uint32_t seed )
+    {
+        struct Live
+        {
+            BufferSuballocator::Handle handle;
+            uint64_t                   size;
+        };
+
+        mt19937 random( seed );
+        vector<Live> live;
+        live.reserve( liveCount * 2 );
+
+        uint64_t frame = 0;
+        for (uint32_t i = 0; i < operationCount; ++i)
+        {
+            if (live.size() < liveCount / 2 || (live.size() < liveCount * 2 && random() % 2 == 0))
+            {
+                const uint64_t size = RandomSize( random );
+                const Live entry = { suballocator.Allocate( size, random() % 4 == 0 ? 4096 : 0 ), size };
+                live.push_back( entry );
+            }
+            else
+            {
+                const size_t index = random() % live.size();
+                suballocator.Free( live[index].handle );
+                live[index] = live.back();
+                live.pop_back();
+            }
+
+            if (i % 64 == 63)
+            {
+                frame++;
+                suballocator.EndFrame( frame );
+                suballocator.Reclaim( frame - min<uint64_t>( frame, 2 ) );
+            }
+        }
+
+        suballocator.EndFrame( frame + 1 );
+        suballocator.Reclaim( frame + 1 );
+
+        ChurnResult result;
+        result.operations     = operationCount;
+        result.committedBytes = 0;
+        for (const Live& entry : live)
+        {
+            result.committedBytes += (entry.size + MockMemoryBackend::PAGE_SIZE - 1) / MockMemoryBackend::PAGE_SIZE * MockMemoryBackend::PAGE_SIZE;
+        }
+        result.statistics = suballocator.GetStatistics();
+
+        for (const Live& entry : live)
+        {
+            suballocator.Free( entry.handle );
+        }
+        suballocator.EndFrame( frame + 2 );
+        suballocator.Reclaim( frame + 2 );
+
+        return result;
+    }
+
+    struct CompactResult
+    {
+        BufferSuballocator::Statistics fragmented;
+        BufferSuballocator::Statistics compacted;
+        uint64_t                       moves;
+        uint64_t                       movedBytes;
+        uint32_t                       frames;
+        double                         milliseconds;
+    };
+
+    // A scene of liveCount * 4 buffers loaded and three quarters unloaded, then defragmented at 1 MiB a frame
+    CompactResult Compact( BufferSuballocator& suballocator, uint32_t liveCount, uint32_t seed )
+    {
+        mt19937 random( seed );
+        vector<BufferSuballocator::Handle> handles;
+        for (uint32_t i = 0; i < liveCount * 4; ++i)
+        {
+            handles.push_back( suballocator.Allocate( RandomSize( random ) ) );
+        }
+
+        shuffle( handles.begin(), handles.end(), random );
+        for (size_t i = liveCount; i < handles.size(); ++i)
+        {
+            suballocator.Free( handles[i] );
+        }
+        handles.resize( liveCount );
+
+        uint64_t frame = 1;
+        suballocator.EndFrame( frame );
+        suballocator.Reclaim( frame );
+
+        CompactResult result;
+        result.fragmented = suballocator.GetStatistics();
+
+        Benchmark::Timer timer;
+        while (suballocator.Defragment( MiB ) > 0)
+        {
+            frame++;
+            suballocator.EndFrame( frame );
+            suballocator.Reclaim( frame );
+        }
+        result.milliseconds = timer.GetMilliseconds();
+
+        result.compacted  = suballocator.GetStatistics();
+        result.moves      = result.compacted.moves - result.fragmented.moves;
+        result.movedBytes = result.compacted.movedBytes - result.fragmented.movedBytes;
+        result.frames     = static_cast<uint32_t>(frame - 1);
+
+        for (BufferSuballocator::Handle handle : handles)
+        {
+            suballocator.Free( handle );
+        }
+        suballocator.EndFrame( frame + 1 );
+        suballocator.Reclaim( frame + 1 );
+
+        return result;
+    }
+}
+
+bool Benchmark::RunBufferSuballocator( uint32_t operationCount, uint32_t iterations )
+{
+    const uint32_t LIVE_COUNT = 4096;
+
+    cout << "BufferSuballocator: " << operationCount << " operations around " << LIVE_COUNT << " live buffers, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = CheckTlsf();
+    bSucceeded &= CheckDeferredFree();
+    bSucceeded &= CheckDefragment();
+
+    // One block on its own, frees immediate
+    {
+        TlsfAllocator allocator( 4096 * MiB );
+        mt19937 random( 3 );
+        vector<uint32_t> live;
+        live.reserve( LIVE_COUNT * 2 );
+
+        vector<double> times;
+        for (uint32_t n = 0; n < iterations; ++n)
+        {
+            Benchmark::Timer timer;
+            for (uint32_t i = 0; i < operationCount; ++i)
+            {
+                if (live.size() < LIVE_COUNT / 2 || (live.size() < LIVE_COUNT * 2 && random() % 2 == 0))
+                {
+                    live.push_back( allocator.Allocate( 256 + random() % (64 * KiB) ) );
+                }
+                else
+                {
+                    const size_t index = random() % live.size();
+                    allocator.Free( live[index] );
+                    live[index] = live.back();
+                    live.pop_back();
+                }
+            }
+            times.push_back( timer.GetMilliseconds() );
+        }
+
+        bSucceeded &= allocator.Validate() && find( live.begin(), live.end(), TlsfAllocator::INVALID_NODE ) == live.end();
+
+        const double median = Benchmark::Record( "TlsfAllocator/random alloc and free", times, operationCount );
+        cout << "  tlsf                    " << setw( 8 ) << median * 1000000.0 / max( 1u, operationCount ) << " ns per operation" << endl;
+    }
+
+    // Blocks of 64 MiB with frees held two frames
+    NullBlockBackend backend;
+    BufferSuballocator suballocator( backend );
+
+    vector<double> churnTimes, defragmentTimes;
+    ChurnResult churn;
+    CompactResult compact;
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        Benchmark::Timer churnTimer;
+        churn = Churn( suballocator, operationCount, LIVE_COUNT, 17 + n );
+        churnTimes.push_back( churnTimer.GetMilliseconds() );
+
+        bSucceeded &= suballocator.Validate() && churn.statistics.failures == 0;
+
+        compact = Compact( suballocator, LIVE_COUNT, 23 + n );
+        defragmentTimes.push_back( compact.milliseconds );
+
+        bSucceeded &= suballocator.Validate() && compact.compacted.blocks < compact.fragmented.blocks &&
+                      compact.compacted.GetFragmentation() < compact.fragmented.GetFragmentation();
+    }
+
+    const double churnTime      = Benchmark::Record( "BufferSuballocator/random alloc and free", churnTimes, operationCount );
+    const double defragmentTime = Benchmark::Record( "BufferSuballocator/defragment", defragmentTimes, compact.moves );
+
+    const BufferSuballocator::Statistics& stats      = churn.statistics;
+    const BufferSuballocator::Statistics& fragmented = compact.fragmented;
+    const BufferSuballocator::Statistics& compacted  = compact.compacted;
+    cout << "  churn                   " << setw( 8 ) << churnTime * 1000000.0 / max( 1u, operationCount ) << " ns per operation" << endl;
+    cout << "  after churn             " << stats.allocations << " buffers, " << setprecision( 1 ) << stats.requestedBytes / double( MiB )
+         << " MiB requested in " << stats.blockBytes / double( MiB ) << " MiB of blocks, " << churn.committedBytes / double( MiB )
+         << " MiB as committed resources, fragmentation " << stats.GetFragmentation() * 100.0 << "%" << setprecision( 3 ) << endl;
+    cout << "  defragment              " << setw( 8 ) << defragmentTime << " ms" << endl;
+    cout << "  fragmented              " << fragmented.blocks << " blocks, " << setprecision( 1 ) << fragmented.usedBytes / double( MiB ) << " of "
+         << fragmented.blockBytes / double( MiB ) << " MiB used, fragmentation " << fragmented.GetFragmentation() * 100.0 << "%" << setprecision( 3 ) << endl;
+    cout << "  compacted               " << compacted.blocks << " blocks, " << setprecision( 1 ) << compacted.usedBytes / double( MiB ) << " of "
+         << compacted.blockBytes / double( MiB ) << " MiB used, fragmentation " << compacted.GetFragmentation() * 100.0 << "%, "
+         << compact.moves << " moves / " << compact.movedBytes / double( MiB ) << " MiB in " << compact.frames << " frames" << setprecision( 3 ) << endl;
+
+    return bSucceeded;
+}
@@ -0,0 +1,234 @@
+#include "Benchmarks.h"
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    struct Range
+    {
+        uint32_t index;
+        uint32_t count;
+    };
+
+    // First fit, frees merged with both neighbours, the freed space handed out again
+    bool CheckPersistent()
+    {
+        const uint32_t PERSISTENT_COUNT = 1024;
+
+        DescriptorAllocator allocator( PERSISTENT_COUNT, 64, 2 );
+
+        bool bPassed = allocator.GetCapacity() == PERSISTENT_COUNT + 128;
+
+        const uint32_t a = allocator.AllocatePersistent( 100 );
+        const uint32_t b = allocator.AllocatePersistent( 200 );
+        const uint32_t c = allocator.AllocatePersistent( 300 );
+        bPassed &= a == 0 && b == 100 && c == 300;
+        bPassed &= allocator.AllocatePersistent( 0 ) == DescriptorAllocator::INVALID_INDEX;
+
+        // The hole left by b is the first that fits
+        allocator.FreePersistent( b, 200 );
+        bPassed &= allocator.AllocatePersistent( 150 ) == 100 && allocator.AllocatePersistent( 50 ) == 250;
+        allocator.FreePersistent( 100, 150 );
+        allocator.FreePersistent( 250, 50 );
+
+        // Freeing a and c merges everything back, so the whole region fits again
+        allocator.FreePersistent( a, 100 );
+        allocator.FreePersistent( c, 300 );
+        bPassed &= allocator.GetStatistics().persistentUsed == 0 && allocator.GetStatistics().persistentPeak == 600;
+
+        const uint32_t whole = allocator.AllocatePersistent( PERSISTENT_COUNT );
+        bPassed &= whole == 0 && allocator.AllocatePersistent( 1 ) == DescriptorAllocator::INVALID_INDEX;
+        allocator.FreePersistent( whole, PERSISTENT_COUNT );
+
+        // Ranges past the persistent region and invalid indices are ignored
+        allocator.FreePersistent( PERSISTENT_COUNT, 1 );
+        allocator.FreePersistent( DescriptorAllocator::INVALID_INDEX, 1 );
+        bPassed &= allocator.AllocatePersistent( PERSISTENT_COUNT ) == 0;
+        allocator.FreePersistent( 0, PERSISTENT_COUNT );
+
+        // Random churn against a map of the region: ranges stay inside it and never overlap
+        mt19937 random( 11 );
+        vector<uint8_t> owned( PERSISTENT_COUNT, 0 );
+        vector<Range>   live;
+        uint32_t        failures = 0;
+        for (uint32_t i = 0; i < 20000 && bPassed; ++i)
+        {
+            if (live.empty() || random() % 100 < 55)
+            {
+                const uint32_t count = 1 + random() % 32;
+                const uint32_t index = allocator.AllocatePersistent( count );
+                if (index == DescriptorAllocator::INVALID_INDEX)
+                {
+                    failures++;
+                    continue;
+                }
+
+                bPassed &= index + count <= PERSISTENT_COUNT;
+                for (uint32_t j = index; j < index + count && bPassed; ++j)
+                {
+                    bPassed &= owned[j] == 0;
+                    owned[j] = 1;
+                }
+
+                const Range range = { index, count };
+                live.push_back( range );
+            }
+            else
+            {
+                const size_t n = random() % live.size();
+                allocator.FreePersistent( live[n].index, live[n].count );
+                fill( owned.begin() + live[n].index, owned.begin() + live[n].index + live[n].count, 0 );
+                live[n] = live.back();
+                live.pop_back();
+            }
+        }
+
+        uint32_t used = 0;
+        for (const Range& range : live)
+        {
+            used += range.count;
+            allocator.FreePersistent( range.index, range.count );
+        }
+        bPassed &= failures > 0 && allocator.GetStatistics().persistentUsed == 0 && allocator.AllocatePersistent( PERSISTENT_COUNT ) == 0;
+
+        cout << "  persistent check        " << (bPassed ? "passed" : "FAILED") << " (" << live.size() << " ranges of " << used
+             << " descriptors live at the end, " << failures << " full)" << endl;
+
+        return bPassed;
+    }
+
+    // Each frame allocates from its own slice, which is handed out again only once its frame's fence completed
+    bool CheckTransient()
+    {
+        const uint32_t PERSISTENT_COUNT = 16;
+        const uint32_t SLICE_COUNT      = 8;
+        const uint32_t FRAME_COUNT      = 2;
+
+        DescriptorAllocator allocator( PERSISTENT_COUNT, SLICE_COUNT, FRAME_COUNT );
+
+        // Frame 1 fills slice 0, and overflow fails instead of spilling into the next slice
+        bool bPassed = allocator.AllocateTransient( 5 ) == PERSISTENT_COUNT && allocator.AllocateTransient( 3 ) == PERSISTENT_COUNT + 5;
+        bPassed &= allocator.AllocateTransient( 1 ) == DescriptorAllocator::INVALID_INDEX;
+        bPassed &= allocator.GetStatistics().transientUsed == SLICE_COUNT && allocator.GetStatistics().failures == 1;
+        allocator.EndFrame( 1 );
+
+        // Frame 2 uses slice 1
+        bPassed &= allocator.GetFrameIndex() == 1 && allocator.GetStatistics().transientUsed == 0;
+        bPassed &= allocator.AllocateTransient( 2 ) == PERSISTENT_COUNT + SLICE_COUNT;
+        allocator.EndFrame( 2 );
+
+        // Frame 3 comes back to slice 0 while frame 1 is still on the GPU
+        allocator.Reclaim( 0 );
+        bPassed &= allocator.GetFrameIndex() == 0 && allocator.AllocateTransient( 1 ) == DescriptorAllocator::INVALID_INDEX;
+        bPassed &= allocator.AllocateTransient( 1 ) == DescriptorAllocator::INVALID_INDEX && allocator.GetStatistics().busyFrames == 1;
+
+        // Once frame 1 completed the slice is free again, from its start
+        allocator.Reclaim( 1 );
+        bPassed &= allocator.AllocateTransient( 4 ) == PERSISTENT_COUNT;
+        allocator.EndFrame( 3 );
+
+        // Slice 1 waits for frame 2, and frames whose slice was busy do not hold it any longer
+        allocator.Reclaim( 1 );
+        bPassed &= allocator.AllocateTransient( 1 ) == DescriptorAllocator::INVALID_INDEX;
+        allocator.EndFrame( 4 );
+        allocator.Reclaim( 2 );
+        bPassed &= allocator.AllocateTransient( 1 ) == DescriptorAllocator::INVALID_INDEX;
+        allocator.EndFrame( 5 );
+        allocator.Reclaim( 3 );
+        bPassed &= allocator.AllocateTransient( 1 ) == PERSISTENT_COUNT + SLICE_COUNT;
+        allocator.EndFrame( 6 );
+
+        // Transient ranges never touch the persistent region
+        bPassed &= allocator.AllocatePersistent( PERSISTENT_COUNT ) == 0 && allocator.AllocatePersistent( 1 ) == DescriptorAllocator::INVALID_INDEX;
+
+        cout << "  transient check         " << (bPassed ? "passed" : "FAILED") << " (" << allocator.GetStatistics().busyFrames << " frames found their slice busy, "
+             << allocator.GetStatistics().failures << " failures)" << endl;
+
+        return bPassed;
+    }
+}
+
+bool Benchmark::RunDescriptorAllocator( uint32_t operationCount, uint32_t iterations )
+{
+    // A scene's worth of persistent tables, and transient ranges as a pass binding per draw would take
+    const uint32_t PERSISTENT_COUNT = 65536;
+    const uint32_t SLICE_COUNT      = 4096;
+    const uint32_t FRAME_COUNT      = 2;
+
+    operationCount = max( 1u, operationCount );
+
+    cout << "DescriptorAllocator: " << operationCount << " operations, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = CheckPersistent();
+    bSucceeded &= CheckTransient();
+
+    // Tables of 1 to 8 descriptors allocated and freed at random, as models come and go
+    mt19937 random( 5 );
+    vector<uint32_t> counts( operationCount );
+    vector<uint32_t> choices( operationCount );
+    for (uint32_t i = 0; i < operationCount; ++i)
+    {
+        counts[i]  = 1 + random() % 8;
+        choices[i] = random();
+    }
+
+    vector<double> churnTimes, transientTimes;
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        DescriptorAllocator allocator( PERSISTENT_COUNT, SLICE_COUNT, FRAME_COUNT );
+        vector<Range> live;
+        live.reserve( operationCount );
+
+        Benchmark::Timer churnTimer;
+        for (uint32_t i = 0; i < operationCount; ++i)
+        {
+            if (live.empty() || choices[i] % 100 < 55)
+            {
+                const Range range = { allocator.AllocatePersistent( counts[i] ), counts[i] };
+                if (range.index != DescriptorAllocator::INVALID_INDEX)
+                    live.push_back( range );
+            }
+            else
+            {
+                const size_t index = choices[i] % live.size();
+                allocator.FreePersistent( live[index].index, live[index].count );
+                live[index] = live.back();
+                live.pop_back();
+            }
+        }
+        churnTimes.push_back( churnTimer.GetMilliseconds() );
+
+        // Frames of single descriptors until the operations run out; every frame completes before its slice returns
+        Benchmark::Timer transientTimer;
+        uint64_t frame = 1;
+        for (uint32_t i = 0; i < operationCount; ++i)
+        {
+            if (allocator.AllocateTransient( 1 ) == DescriptorAllocator::INVALID_INDEX)
+            {
+                allocator.EndFrame( frame );
+                allocator.Reclaim( frame );
+                frame++;
+                bSucceeded &= allocator.AllocateTransient( 1 ) != DescriptorAllocator::INVALID_INDEX;
+            }
+        }
+        transientTimes.push_back( transientTimer.GetMilliseconds() );
+
+        bSucceeded &= allocator.GetStatistics().busyFrames == 0;
+    }
+
+    const double churn     = Benchmark::Record( "DescriptorAllocator/persistent churn", churnTimes, operationCount );
+    const double transient = Benchmark::Record( "DescriptorAllocator/transient", transientTimes, operationCount );
+
+    cout << "  persistent churn        " << setw( 9 ) << churn << " ms (" << churn * 1000000.0 / operationCount << " ns per operation)" << endl;
+    cout << "  transient               " << setw( 9 ) << transient << " ms (" << transient * 1000000.0 / operationCount << " ns per allocation)" << endl;
+
+    return bSucceeded;
+}
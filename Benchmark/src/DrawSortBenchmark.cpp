@@ -0,0 +1,133 @@
+#include "Benchmarks.h"
+#include "DrawSort.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Scene-order draws: each object picks its state at random, as a naive submission would
+    void CreateDrawItems( vector<DrawSort::Item>& items, uint32_t count )
+    {
+        const uint32_t PIPELINE_COUNT = 64;
+        const uint32_t MATERIAL_COUNT = 4096;
+        const uint32_t MESH_COUNT     = 16384;
+
+        mt19937 random( 12345 );
+        uniform_int_distribution<uint32_t> pipeline( 0, PIPELINE_COUNT - 1 );
+        uniform_int_distribution<uint32_t> material( 0, MATERIAL_COUNT - 1 );
+        uniform_int_distribution<uint32_t> mesh( 0, MESH_COUNT - 1 );
+        uniform_real_distribution<float>   depth( 0.0f, 1000.0f );
+
+        items.resize( count );
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            items[i].key   = DrawKey::Pack( 1, pipeline( random ), material( random ), mesh( random ), DrawKey::QuantizeDepth( depth( random ), 1000.0f ) );
+            items[i].index = i;
+        }
+    }
+
+    // Fields round-trip, and ids past their field saturate instead of wrapping onto small ids or spilling into
+    // the field above
+    bool CheckKeys()
+    {
+        bool bPassed = true;
+
+        const uint64_t key = DrawKey::Pack( 3, 1234, 5678, 40000, 65535 );
+        bPassed &= DrawKey::GetPass( key ) == 3 && DrawKey::GetPipeline( key ) == 1234 && DrawKey::GetMaterial( key ) == 5678;
+        bPassed &= DrawKey::GetMesh( key ) == 40000 && DrawKey::GetDepth( key ) == 65535;
+
+        // Past 16K pipelines the id used to wrap to 0 and sort ahead of the first pipeline
+        const uint32_t pipelineMax = DrawKey::MaxValue( DrawKey::PIPELINE_BITS );
+        const uint64_t wide = DrawKey::Pack( 1, pipelineMax + 1, 0, 0, 0 );
+        bPassed &= DrawKey::GetPass( wide ) == 1 && DrawKey::GetPipeline( wide ) == pipelineMax;
+        bPassed &= wide > DrawKey::Pack( 1, pipelineMax - 1, DrawKey::MaxValue( DrawKey::MATERIAL_BITS ), 0, 0 );
+        bPassed &= wide == DrawKey::Pack( 1, 0xffffffff, 0, 0, 0 );
+
+        bPassed &= DrawKey::Fits( pipelineMax, DrawKey::PIPELINE_BITS ) && !DrawKey::Fits( pipelineMax + 1, DrawKey::PIPELINE_BITS );
+        bPassed &= DrawKey::GetMaterial( DrawKey::Pack( 1, 0, 1u << DrawKey::MATERIAL_BITS, 7, 0 ) ) == DrawKey::MaxValue( DrawKey::MATERIAL_BITS );
+        bPassed &= DrawKey::GetMesh( DrawKey::Pack( 1, 0, 0, 1u << DrawKey::MESH_BITS, 0 ) ) == DrawKey::MaxValue( DrawKey::MESH_BITS );
+
+        cout << "  key check             " << (bPassed ? "passed" : "FAILED") << endl;
+
+        return bPassed;
+    }
+
+    template <typename SortFunc>
+    double Measure( const string& name, const vector<DrawSort::Item>& source, uint32_t iterations, SortFunc sort, vector<DrawSort::Item>& result )
+    {
+        vector<double> times;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            result = source;
+
+            Benchmark::Timer timer;
+            sort( result );
+            times.push_back( timer.GetMilliseconds() );
+        }
+
+        return Benchmark::Record( name, times, source.size() );
+    }
+}
+
+bool Benchmark::RunDrawSort( uint32_t itemCount, uint32_t iterations )
+{
+    vector<DrawSort::Item> source;
+    CreateDrawItems( source, itemCount );
+
+    vector<DrawSort::Item> reference;
+    const double referenceTime = Measure( "DrawSort/stable_sort", source, iterations, []( vector<DrawSort::Item>& items )
+    {
+        stable_sort( items.begin(), items.end(), []( const DrawSort::Item& a, const DrawSort::Item& b ) { return a.key < b.key; } );
+    }, reference );
+
+    cout << "DrawSort: " << itemCount << " items, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+    cout << "  std::stable_sort      " << setw( 10 ) << referenceTime << " ms" << endl;
+
+    bool bSucceeded = CheckKeys();
+
+    const uint32_t hardwareThreads = max( 1u, thread::hardware_concurrency() );
+    for (uint32_t threadCount = 1; ; threadCount *= 2)
+    {
+        threadCount = min( threadCount, hardwareThreads );
+
+        DrawSort drawSort( threadCount );
+
+        vector<DrawSort::Item> result;
+        const double time = Measure( "DrawSort/radix/" + to_string( threadCount ) + " threads", source, iterations, [&]( vector<DrawSort::Item>& items ) { drawSort.Sort( items ); }, result );
+
+        // The radix sort is stable, so it has to match the reference item for item
+        bool bMatched = result.size() == reference.size();
+        for (size_t i = 0; bMatched && i < result.size(); ++i)
+        {
+            bMatched = result[i].key == reference[i].key && result[i].index == reference[i].index;
+        }
+
+        cout << "  radix " << setw( 3 ) << threadCount << " thread(s)   " << setw( 10 ) << time << " ms"
+             << "  " << setw( 8 ) << setprecision( 1 ) << itemCount / time / 1000.0 << " M items/s" << setprecision( 3 )
+             << (bMatched ? "" : "  MISMATCH") << endl;
+
+        bSucceeded &= bMatched;
+
+        if (threadCount == hardwareThreads)
+            break;
+    }
+
+    const DrawSort::StateChanges unsorted = DrawSort::CountStateChanges( source );
+    const DrawSort::StateChanges sorted   = DrawSort::CountStateChanges( reference );
+
+    cout << "  state changes         pipeline " << unsorted.pipeline << " -> " << sorted.pipeline
+         << ", material " << unsorted.material << " -> " << sorted.material
+         << ", mesh " << unsorted.mesh << " -> " << sorted.mesh
+         << ", total " << unsorted.Total() << " -> " << sorted.Total() << endl;
+
+    return bSucceeded;
+}
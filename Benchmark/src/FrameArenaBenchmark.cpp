@@ -0,0 +1,566 @@
+#include "Benchmarks.h"
+#include "AllocationCounter.h"
+#include "DrawRecorder.h"
+#include "FrameArena.h"
+#include "FrameStatistics.h"
+#include "GpuTimer.h"
+#include "LightClusters.h"
+#include "Profiler.h"
+#include "ShadowFrustum.h"
+#include "SoftwareRasterizer.h"
+#include "JobSystem.h"
+#include "RecordingSink.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    typedef SoftwareRasterizer SR;
+
+    const float PI = 3.14159265f;
+
+    bool IsAligned( const void* p, size_t alignment )
+    {
+        return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+    }
+
+    // Alignment, the previous frame surviving the next, overflow and growth, and allocating from jobs on every thread
+    bool CheckArena()
+    {
+        bool bPassed = true;
+
+        FrameArena arena( 1024 );
+        arena.BeginFrame();
+
+        char*     pByte   = arena.Allocate<char>( 1 );
+        double*   pDouble = arena.Allocate<double>( 3 );
+        void*     pBlock  = arena.Allocate( 100, 64 );
+        uint16_t* pShort  = arena.Allocate<uint16_t>( 5 );
+        bPassed &= pByte != nullptr && IsAligned( pDouble, alignof(double) ) && IsAligned( pBlock, 64 ) && IsAligned( pShort, 2 );
+        bPassed &= arena.Allocate( 0 ) == nullptr;
+
+        // Written in one frame, still there in the next, rewound in the one after
+        uint32_t* pFirst = arena.Allocate<uint32_t>( 64 );
+        for (uint32_t i = 0; i < 64; ++i)
+        {
+            pFirst[i] = i * 7;
+        }
+
+        arena.BeginFrame();
+        uint32_t* pSecond = arena.Allocate<uint32_t>( 64 );
+        memset( pSecond, 0xff, 64 * sizeof( uint32_t ) );
+        for (uint32_t i = 0; i < 64; ++i)
+        {
+            bPassed &= pFirst[i] == i * 7;
+        }
+
+        arena.BeginFrame();
+        bPassed &= arena.Allocate<char>( 1 ) == pByte;
+
+        // A frame past the capacity goes to the heap, then both buffers grow and the same frame fits again
+        auto allocateFrame = [&]()
+        {
+            for (uint32_t i = 0; i < 64; ++i)
+            {
+                memset( arena.Allocate( 48, 16 ), static_cast<int>(i), 48 );
+            }
+        };
+
+        arena.BeginFrame();
+        allocateFrame();
+        const FrameArena::Statistics overflowed = arena.GetStatistics();
+        bPassed &= overflowed.overflowAllocations > 0;
+
+        arena.BeginFrame();
+        allocateFrame();
+        arena.BeginFrame();
+        allocateFrame();
+
+        const AllocationCounter::Scope allocations;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            arena.BeginFrame();
+            allocateFrame();
+        }
+        const FrameArena::Statistics& grown = arena.GetStatistics();
+        bPassed &= grown.overflowAllocations == overflowed.overflowAllocations && grown.grows == 2;
+        bPassed &= grown.capacity >= 64 * 48 && allocations.GetCount() == 0;
+
+        // Jobs on every thread take blocks at once; none may overlap
+        JobSystem& jobs = JobSystem::GetInstance();
+        const uint32_t threadCount     = jobs.GetThreadCount();
+        const uint32_t blocksPerThread = 1000;
+
+        FrameArena shared( 1 << 20 );
+        shared.BeginFrame();
+
+        vector<uint32_t*> blocks( static_cast<size_t>(threadCount) * blocksPerThread );
+        auto allocateBlocks = [&]( uint32_t thread )
+        {
+            for (uint32_t i = 0; i < blocksPerThread; ++i)
+            {
+                uint32_t* pValues = shared.Allocate<uint32_t>( 4 );
+                for (uint32_t k = 0; k < 4; ++k)
+                {
+                    pValues[k] = thread * blocksPerThread + i;
+                }
+                blocks[static_cast<size_t>(thread) * blocksPerThread + i] = pValues;
+            }
+        };
+        jobs.ParallelFor( threadCount, allocateBlocks, 1 );
+
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            for (uint32_t k = 0; k < 4; ++k)
+            {
+                bPassed &= blocks[i][k] == i;
+            }
+        }
+        bPassed &= shared.GetFrameBytes() == blocks.size() * 4 * sizeof( uint32_t );
+
+        cout << "  arena check             " << (bPassed ? "passed" : "FAILED")
+             << " (" << threadCount << " threads, grown to " << grown.capacity << " bytes after " << overflowed.overflowAllocations << " overflow allocations)" << endl;
+
+        return bPassed;
+    }
+}
+
+namespace
+{
+    enum STAGE
+    {
+        STAGE_ARENA,
+        STAGE_SHADOW_FIT,
+        STAGE_LIGHT_CLUSTERS,
+        STAGE_DRAW_RECORD,
+        STAGE_SHADOW_MAP,
+        STAGE_FORWARD,
+        STAGE_GPU_TIMER,
+        STAGE_PROFILER,
+        STAGE_STATISTICS,
+
+        STAGE_NUM,
+    };
+
+    const char* STAGE_NAMES[STAGE_NUM] =
+    {
+        "arena",
+        "shadow fit",
+        "light clusters",
+        "draw recording",
+        "shadow map",
+        "forward",
+        "gpu timer",
+        "profiler",
+        "statistics",
+    };
+
+    const uint32_t CASCADE_COUNT  = 4;
+    const uint32_t PIPELINE_COUNT = 8;
+    const uint32_t MODEL_COUNT    = 512;
+
+    void AddSphere( vector<SR::Vertex>& vertices, vector<uint16_t>& indices, float cx, float cz, float radius, uint32_t segments )
+    {
+        const uint32_t base = static_cast<uint32_t>(vertices.size());
+        for (uint32_t i = 0; i <= segments; ++i)
+        {
+            for (uint32_t j = 0; j <= segments; ++j)
+            {
+                const float theta = PI * i / segments;
+                const float phi   = 2.0f * PI * j / segments;
+                const float n[3]  = { sinf( theta ) * cosf( phi ), cosf( theta ), sinf( theta ) * sinf( phi ) };
+
+                SR::Vertex vertex;
+                memset( &vertex, 0, sizeof( vertex ) );
+                vertex.position[0] = cx + radius * n[0];
+                vertex.position[1] = radius * n[1];
+                vertex.position[2] = cz + radius * n[2];
+                memcpy( vertex.normal, n, sizeof( n ) );
+                vertex.color[0] = vertex.color[1] = vertex.color[2] = vertex.color[3] = 1.0f;
+                vertices.push_back( vertex );
+            }
+        }
+
+        for (uint32_t i = 0; i < segments; ++i)
+        {
+            for (uint32_t j = 0; j < segments; ++j)
+            {
+                const uint16_t a = static_cast<uint16_t>(base + i * (segments + 1) + j);
+                const uint16_t b = static_cast<uint16_t>(a + segments + 1);
+                const uint16_t triangle[6] = { a, static_cast<uint16_t>(a + 1), b, static_cast<uint16_t>(a + 1), static_cast<uint16_t>(b + 1), b };
+                indices.insert( indices.end(), triangle, triangle + 6 );
+            }
+        }
+    }
+
+    // The CPU side of a viewer frame with nothing to present: the cascades fitted, the lights clustered, the
+    // draws gathered into the frame arena and sorted and recorded by the viewer's DrawRecorder into a
+    // RecordingSink, both software raster passes, the GPU zones on mock queries, the profiler and the frame
+    // statistics. Everything it keeps from frame to frame is set up once.
+    class HeadlessFrame
+    {
+    public:
+        HeadlessFrame( uint32_t drawCount, uint32_t lightCount )
+            : m_drawCount( drawCount )
+            , m_shadowMap( 256, 256 )
+            , m_color( 320, 180 )
+            , m_depth( 320, 180 )
+            , m_queries( GpuTimer::QUERY_COUNT, 1000000 )
+            , m_timer( m_queries )
+            , m_frame( 0 )
+        {
+            // Four spheres on a 2 x 2 grid, one mesh each
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                AddSphere( m_vertices[i], m_indices[i], (i % 2) * 2.0f - 1.0f, (i / 2) * 2.0f - 1.0f, 0.8f, 32 );
+
+                SR::Mesh mesh;
+                mesh.pVertices   = m_vertices[i].data();
+                mesh.vertexCount = static_cast<uint32_t>(m_vertices[i].size());
+                mesh.pIndices    = m_indices[i].data();
+                mesh.indexCount  = static_cast<uint32_t>(m_indices[i].size());
+                for (int k = 0; k < 4; ++k)
+                {
+                    mesh.material.ka[k] = 0.1f;
+                    mesh.material.kd[k] = 0.8f;
+                    mesh.material.ks[k] = 0.2f;
+                }
+                m_meshes.push_back( mesh );
+            }
+            m_rasterizer.SetCullMode( SR::CULL_MODE_NONE );
+
+            const float up[3]       = { 0.0f, 1.0f, 0.0f };
+            const float lightEye[3] = { 0.0f, 5.0f, 0.0f };
+            const float lightDir[3] = { 0.0f, -0.70710678f, -0.70710678f };
+            const float eye[3]      = { 0.0f, 2.0f, -6.0f };
+            const float target[3]   = { 0.0f, 0.0f, 0.0f };
+
+            memset( &m_light, 0, sizeof( m_light ) );
+            memset( &m_transform, 0, sizeof( m_transform ) );
+            for (int k = 0; k < 3; ++k)
+            {
+                m_light.direction[k] = lightDir[k];
+                m_light.intensity[k] = 1.0f;
+                m_light.color[k]     = 1.0f;
+            }
+            SR::CreateLookAtLH( lightEye, lightDir, up, m_light.view );
+            SR::CreateOrthographicLH( -5.0f, 5.0f, -5.0f, 5.0f, 1.0f, 100.0f, m_light.projection );
+
+            for (int k = 0; k < 4; ++k)
+            {
+                m_transform.world[k * 5] = 1.0f;
+            }
+            SR::CreateLookAtLH( eye, target, up, m_transform.view );
+            SR::CreatePerspectiveFovLH( 50.0f * PI / 180.0f, 16.0f / 9.0f, 0.5f, 50.0f, m_transform.projection );
+
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                for (const SR::Vertex& vertex : m_vertices[i])
+                {
+                    m_receivers.Add( vertex.position );
+                }
+            }
+            ShadowFrustum::ComputeSplits( 0.5f, 50.0f, CASCADE_COUNT, 0.5f, m_splits );
+
+            mt19937 random( 5 );
+            uniform_real_distribution<float> unit( -1.0f, 1.0f );
+            const float color[3] = { 1.0f, 1.0f, 1.0f };
+            m_lights.Reserve( lightCount );
+            for (uint32_t i = 0; i < lightCount; ++i)
+            {
+                const float position[3] = { 20.0f * unit( random ), 2.0f * unit( random ), 20.0f * unit( random ) };
+                m_lights.AddPointLight( position, 1.0f + fabsf( unit( random ) ), color );
+            }
+
+            // Draws as the pass's contexts hand them out: the camera's constants, then the model's own and
+            // its table. Root signatures, pipelines and models are stand-ins, only ever compared.
+            m_packets.resize( m_drawCount );
+            for (uint32_t i = 0; i < m_drawCount; ++i)
+            {
+                const uint32_t pipeline = random() % PIPELINE_COUNT;
+                const uint32_t model    = random() % MODEL_COUNT;
+
+                DrawRecorder::Packet& packet = m_packets[i];
+                packet.pContext       = &m_packets[i];
+                packet.pRootSignature = &m_rootSignatures[pipeline % 2];
+                packet.pPipelineState = &m_pipelineStates[pipeline];
+                packet.pModel         = &m_models[model];
+
+                packet.constantBuffers[0]  = 0x10000;
+                packet.constantBuffers[1]  = 0x20000 + model * 256ull;
+                packet.constantBufferCount = 2;
+                packet.shaderResourceCount = 0;
+
+                packet.descriptorIndex = model;
+                packet.indexCount      = m_meshes[model % m_meshes.size()].indexCount;
+                packet.center[0]       = 20.0f * unit( random );
+                packet.center[1]       = 0.0f;
+                packet.center[2]       = 20.0f + 20.0f * unit( random );
+            }
+
+            const float forward[3] = { 0.0f, 0.0f, 1.0f };
+            m_recorder.SetSortPass( 1 );    // RenderPass::SORT_PASS_OPAQUE
+            m_recorder.SetSortView( eye, forward, 50.0f );
+
+            // Named up front, so a frame only looks them up
+            m_statistics.AddPass( "GPU Shadow" );
+            m_statistics.AddPass( "GPU Forward" );
+        }
+
+        // Counts the global heap allocations of each stage into allocations
+        bool Run( uint64_t allocations[STAGE_NUM] )
+        {
+            bool bValid = true;
+
+            Profiler::BeginFrame();
+
+            uint64_t count = AllocationCounter::GetCount();
+            auto endStage = [&]( STAGE stage )
+            {
+                const uint64_t now = AllocationCounter::GetCount();
+                allocations[stage] += now - count;
+                count = now;
+            };
+
+            {
+                PROFILE_SCOPE( "HeadlessFrame" );
+
+                m_arena.BeginFrame();
+                endStage( STAGE_ARENA );
+
+                for (uint32_t cascade = 0; cascade < CASCADE_COUNT; ++cascade)
+                {
+                    ShadowFrustum::Input input;
+                    memcpy( input.direction, m_light.direction, sizeof( input.direction ) );
+                    input.pCameraView       = m_transform.view;
+                    input.pCameraProjection = m_transform.projection;
+                    input.splitNear         = m_splits[cascade];
+                    input.splitFar          = m_splits[cascade + 1];
+                    input.receivers         = m_receivers;
+                    input.casters           = m_receivers;
+                    input.resolution        = 1024;
+                    bValid &= ShadowFrustum::Fit( input, m_cascades[cascade] );
+                }
+                endStage( STAGE_SHADOW_FIT );
+
+                bValid &= m_clusters.Build( m_transform.view, m_transform.projection, m_lights );
+                endStage( STAGE_LIGHT_CLUSTERS );
+
+                // Gathered into the arena, each draw a little further along than last frame, as moving models are
+                DrawRecorder::Packet* pPackets = m_arena.Allocate<DrawRecorder::Packet>( m_drawCount );
+                for (uint32_t i = 0; i < m_drawCount; ++i)
+                {
+                    pPackets[i] = m_packets[i];
+                    pPackets[i].center[2] += 0.01f * ((m_frame + i) & 0xff);
+                }
+
+                m_recordStatistics.Clear();
+                m_recorder.Sort( pPackets, m_arena.Allocate<DrawSort::Item>( m_drawCount ), m_drawCount, m_recordStatistics );
+
+                m_sink.Reset();
+                m_recorder.Record( m_sink, m_recordStatistics );
+                bValid &= m_recordStatistics.drawCount == static_cast<int>(m_drawCount) && m_sink.Verify( m_recorder );
+                endStage( STAGE_DRAW_RECORD );
+
+                bValid &= m_rasterizer.RenderShadow( m_light, m_meshes, m_shadowMap );
+                endStage( STAGE_SHADOW_MAP );
+
+                m_color.Clear( 1.0f, 1.0f, 1.0f );
+                m_depth.Clear( 1.0f );
+                bValid &= m_rasterizer.RenderForward( m_transform, m_light, m_shadowMap, m_meshes, m_color, m_depth );
+                bValid &= m_rasterizer.GetStatistics().pixels > 0;
+                endStage( STAGE_FORWARD );
+
+                // Read back a frame later, as on the GPU
+                void* pCommandList = nullptr;
+                m_queries.Complete( m_frame );
+                m_timer.Update( m_frame );
+                const uint32_t shadowZone = m_timer.BeginZone( pCommandList, "GPU Shadow" );
+                m_queries.Advance( 1500 );
+                m_timer.EndZone( pCommandList, shadowZone );
+                const uint32_t forwardZone = m_timer.BeginZone( pCommandList, "GPU Forward" );
+                m_queries.Advance( 4000 );
+                m_timer.EndZone( pCommandList, forwardZone );
+                m_queries.Submit( m_frame + 1 );
+                m_timer.EndFrame( m_frame + 1 );
+                endStage( STAGE_GPU_TIMER );
+            }
+
+            Profiler::EndFrame();
+            endStage( STAGE_PROFILER );
+
+            FrameStatistics::Frame frame;
+            frame.cpuMilliseconds = Profiler::GetSummary().lastMilliseconds;
+            for (const GpuTimer::ZoneTime& zone : m_timer.GetZoneTimes())
+            {
+                const uint32_t pass = m_statistics.AddPass( zone.name );
+                if (pass != FrameStatistics::INVALID_PASS)
+                    frame.passMilliseconds[pass] = zone.milliseconds;
+            }
+            frame.draws     = m_recordStatistics.drawCount;
+            frame.triangles = m_rasterizer.GetStatistics().triangles;
+            m_statistics.AddFrame( frame );
+            endStage( STAGE_STATISTICS );
+
+            m_frame++;
+
+            return bValid;
+        }
+
+        const FrameStatistics& GetStatistics() const { return m_statistics; }
+
+    private:
+        uint32_t m_drawCount;
+
+        vector<SR::Vertex> m_vertices[4];
+        vector<uint16_t>   m_indices[4];
+        vector<SR::Mesh>   m_meshes;
+        SR                 m_rasterizer;
+        SR::LightConstants     m_light;
+        SR::TransformConstants m_transform;
+        SR::DepthTarget        m_shadowMap;
+        SR::ColorTarget        m_color;
+        SR::DepthTarget        m_depth;
+
+        ShadowFrustum::Bounds m_receivers;
+        float                 m_splits[CASCADE_COUNT + 1];
+        ShadowFrustum::Result m_cascades[CASCADE_COUNT];
+
+        LightList     m_lights;
+        LightClusters m_clusters;
+
+        vector<DrawRecorder::Packet> m_packets;
+        char                         m_rootSignatures[2];
+        char                         m_pipelineStates[PIPELINE_COUNT];
+        char                         m_models[MODEL_COUNT];
+        DrawRecorder                 m_recorder;
+        RecordingSink                m_sink;
+        DrawRecorder::Statistics     m_recordStatistics;
+        FrameArena                   m_arena;
+
+        MockGpuTimestampQueries m_queries;
+        GpuTimer                m_timer;
+
+        FrameStatistics m_statistics;
+
+        uint64_t m_frame;
+    };
+
+    // After a few frames to size every list, arena and worker, a frame of the same work allocates nothing
+    bool CheckSteadyState( HeadlessFrame& frame, uint32_t frameCount )
+    {
+        const uint32_t WARM_UP_FRAMES = 4;
+
+        bool     bValid = true;
+        uint64_t warmUp[STAGE_NUM] = {};
+        for (uint32_t i = 0; i < WARM_UP_FRAMES; ++i)
+        {
+            bValid &= frame.Run( warmUp );
+        }
+
+        // The stages break down what the scope counts
+        const AllocationCounter::Scope scope;
+        uint64_t allocations[STAGE_NUM] = {};
+        for (uint32_t i = 0; i < frameCount; ++i)
+        {
+            bValid &= frame.Run( allocations );
+        }
+        const uint64_t total = scope.GetCount();
+
+        const bool bPassed = bValid && total == 0;
+
+        cout << "  steady state check      " << (bPassed ? "passed" : "FAILED") << " (" << total << " allocations in " << frameCount << " frames";
+        if (!AllocationCounter::IsEnabled())
+            cout << ", counter compiled out";
+        cout << ")" << endl;
+
+        if (total != 0)
+        {
+            for (uint32_t stage = 0; stage < STAGE_NUM; ++stage)
+            {
+                if (allocations[stage] != 0)
+                    cout << "    " << left << setw( 22 ) << STAGE_NAMES[stage] << right << allocations[stage] << endl;
+            }
+        }
+
+        return bPassed;
+    }
+}
+
+bool Benchmark::RunFrameArena( uint32_t allocationCount, uint32_t iterations )
+{
+    const uint32_t BLOCK_SIZE = 64;
+
+    cout << "FrameArena: " << allocationCount << " blocks of " << BLOCK_SIZE << " bytes, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = CheckArena();
+
+    const bool bProfilerEnabled = Profiler::IsEnabled();
+    Profiler::SetEnabled( true );
+
+    HeadlessFrame frame( 50000, 4096 );
+    bSucceeded &= CheckSteadyState( frame, 16 );
+
+    // A frame's transient blocks from the arena against the same blocks from the heap
+    FrameArena arena( static_cast<size_t>(allocationCount) * BLOCK_SIZE );
+    vector<unsigned char*> blocks( allocationCount );
+
+    vector<double> arenaTimes, heapTimes, frameTimes;
+    uint64_t       sum = 0;
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        Benchmark::Timer arenaTimer;
+        arena.BeginFrame();
+        for (uint32_t i = 0; i < allocationCount; ++i)
+        {
+            blocks[i] = arena.Allocate<unsigned char>( BLOCK_SIZE );
+            blocks[i][0] = static_cast<unsigned char>(i);
+        }
+        arenaTimes.push_back( arenaTimer.GetMilliseconds() );
+
+        for (uint32_t i = 0; i < allocationCount; ++i)
+        {
+            sum += blocks[i][0];
+        }
+
+        Benchmark::Timer heapTimer;
+        for (uint32_t i = 0; i < allocationCount; ++i)
+        {
+            blocks[i] = new unsigned char[BLOCK_SIZE];
+            blocks[i][0] = static_cast<unsigned char>(i);
+        }
+        for (uint32_t i = 0; i < allocationCount; ++i)
+        {
+            sum += blocks[i][0];
+            delete[] blocks[i];
+        }
+        heapTimes.push_back( heapTimer.GetMilliseconds() );
+
+        uint64_t allocations[STAGE_NUM] = {};
+        Benchmark::Timer frameTimer;
+        bSucceeded &= frame.Run( allocations );
+        frameTimes.push_back( frameTimer.GetMilliseconds() );
+    }
+
+    Profiler::SetEnabled( bProfilerEnabled );
+
+    const double arenaTime = Benchmark::Record( "FrameArena/allocate", arenaTimes, allocationCount );
+    const double heapTime  = Benchmark::Record( "FrameArena/new and delete", heapTimes, allocationCount );
+    const double frameTime = Benchmark::Record( "FrameArena/headless frame", frameTimes, 1 );
+
+    cout << "  arena           " << setw( 10 ) << arenaTime * 1.0e6 / max( 1u, allocationCount ) << " ns/block" << endl;
+    cout << "  new and delete  " << setw( 10 ) << heapTime * 1.0e6 / max( 1u, allocationCount ) << " ns/block (checksum " << sum % 1000 << ")" << endl;
+    cout << "  headless frame  " << setw( 10 ) << frameTime << " ms (cpu p50 " << frame.GetStatistics().GetPercentiles( FrameStatistics::METRIC_CPU_TIME ).p50 << " ms)" << endl;
+
+    return bSucceeded;
+}
@@ -0,0 +1,203 @@
+#include "Benchmarks.h"
+#include "FrameScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Intervals exact in binary, so the waits in whole milliseconds are too
+    const double PENDING_INTERVAL = 1.0 / 64.0;     // 15.625 ms, waits of 16
+    const double POLLING_INTERVAL = 1.0 / 128.0;    // 7.8125 ms, waits of 8
+
+    // Frames requested by invalidations only: one per batch of invalidations, none while clean, and an idle
+    // loop that may sleep until the next message
+    bool CheckInvalidation()
+    {
+        double now = 100.0;
+        FrameScheduler scheduler( [&]() { return now; } );
+
+        // Everything starts invalidated, so the first iteration renders
+        bool bPassed = scheduler.GetWaitMilliseconds() == 0 && scheduler.BeginIteration();
+        bPassed &= scheduler.GetDirty() == 0 && scheduler.GetWaitMilliseconds() == FrameScheduler::WAIT_INFINITE;
+
+        // Clean: however often and however late the loop wakes, nothing renders
+        for (uint32_t i = 0; i < 100; ++i)
+        {
+            now += 0.5;
+            bPassed &= !scheduler.BeginIteration() && scheduler.GetWaitMilliseconds() == FrameScheduler::WAIT_INFINITE;
+        }
+
+        // One frame for any number of invalidations before the iteration, counted for each reason
+        scheduler.Invalidate( FrameScheduler::INVALIDATE_CAMERA );
+        bPassed &= scheduler.GetWaitMilliseconds() == 0;
+        scheduler.Invalidate( FrameScheduler::INVALIDATE_CAMERA | FrameScheduler::INVALIDATE_LIGHT );
+        bPassed &= scheduler.BeginIteration() && !scheduler.BeginIteration() && !scheduler.BeginIteration();
+        bPassed &= scheduler.GetWaitMilliseconds() == FrameScheduler::WAIT_INFINITE;
+
+        // The frame is due at once, with no time passing
+        scheduler.Invalidate( FrameScheduler::INVALIDATE_WINDOW );
+        bPassed &= scheduler.BeginIteration() && !scheduler.BeginIteration();
+
+        const FrameScheduler::Statistics& stats = scheduler.GetStatistics();
+        bPassed &= stats.frames == 3 && stats.iterations == 106 && stats.pendingFrames == 0;
+        bPassed &= stats.reasonFrames[0] == 2 && stats.reasonFrames[1] == 2 && stats.reasonFrames[2] == 1 && stats.reasonFrames[3] == 2;
+
+        // Continuous rendering ignores all of it
+        scheduler.SetContinuous( true );
+        bPassed &= scheduler.GetWaitMilliseconds() == 0 && scheduler.BeginIteration() && scheduler.BeginIteration();
+        scheduler.SetContinuous( false );
+        bPassed &= !scheduler.BeginIteration() && scheduler.GetWaitMilliseconds() == FrameScheduler::WAIT_INFINITE;
+
+        cout << "  invalidation check      " << (bPassed ? "passed" : "FAILED") << " (" << stats.frames << " frames in " << stats.iterations << " iterations)" << endl;
+
+        return bPassed;
+    }
+
+    // Progressive work renders at the pending interval, whatever the loop's wake-ups, until it converges
+    bool CheckProgressive()
+    {
+        const uint32_t STEPS = 16;
+
+        double now = 0.0;
+        FrameScheduler scheduler( [&]() { return now; } );
+        scheduler.SetPendingInterval( PENDING_INTERVAL );
+        bool bPassed = scheduler.BeginIteration();
+
+        uint32_t steps     = 0;
+        uint32_t wakes     = 0;
+        double   lastFrame = now;
+        double   maxGap    = 0.0;
+        double   minGap    = 1.0;
+
+        scheduler.BeginWork();
+        bPassed &= scheduler.GetWaitMilliseconds() == 16;
+        while (scheduler.GetPendingWork() > 0 && wakes < 1000)
+        {
+            // Messages wake the loop early every other time
+            const uint32_t wait = scheduler.GetWaitMilliseconds();
+            bPassed &= wait != FrameScheduler::WAIT_INFINITE && wait <= 16;
+            now += (wakes % 2 == 0 ? wait * 0.5 : wait) / 1000.0;
+            wakes++;
+
+            if (!scheduler.BeginIteration())
+                continue;
+
+            maxGap    = max( maxGap, now - lastFrame );
+            minGap    = min( minGap, now - lastFrame );
+            lastFrame = now;
+
+            // Each frame refines the image once
+            if (++steps == STEPS)
+                scheduler.EndWork();
+        }
+
+        bPassed &= steps == STEPS && minGap >= PENDING_INTERVAL - 1e-9 && maxGap <= 0.016 + 1e-9;
+        bPassed &= scheduler.GetStatistics().pendingFrames == STEPS;
+
+        // Converged: no more frames and nothing to wake up for
+        bPassed &= scheduler.GetWaitMilliseconds() == FrameScheduler::WAIT_INFINITE;
+        now += 1.0;
+        bPassed &= !scheduler.BeginIteration();
+
+        // An invalidation during the work renders at once and restarts the interval
+        scheduler.BeginWork();
+        now += 0.005;
+        scheduler.Invalidate( FrameScheduler::INVALIDATE_SCENE );
+        bPassed &= scheduler.BeginIteration() && scheduler.GetWaitMilliseconds() == 16;
+        now += 0.015;
+        bPassed &= !scheduler.BeginIteration() && scheduler.GetWaitMilliseconds() == 1;
+        now += 0.001;
+        bPassed &= scheduler.BeginIteration();
+        scheduler.EndWork();
+        scheduler.EndWork();
+        bPassed &= scheduler.GetPendingWork() == 0;
+
+        cout << "  progressive check       " << (bPassed ? "passed" : "FAILED") << " (" << steps << " steps in " << wakes << " wakes, frames "
+             << minGap * 1000.0 << " to " << maxGap * 1000.0 << " ms apart)" << endl;
+
+        return bPassed;
+    }
+
+    // Polling wakes the loop at the pending interval after each iteration, without rendering
+    bool CheckPolling()
+    {
+        double now = 0.0;
+        FrameScheduler scheduler( [&]() { return now; } );
+        scheduler.SetPendingInterval( POLLING_INTERVAL );
+        bool bPassed = scheduler.BeginIteration();
+
+        scheduler.SetPolling( true );
+        bPassed &= scheduler.GetWaitMilliseconds() == 8;
+
+        uint32_t wakes = 0;
+        for (uint32_t i = 0; i < 50; ++i)
+        {
+            now += scheduler.GetWaitMilliseconds() / 1000.0;
+            bPassed &= !scheduler.BeginIteration() && scheduler.GetWaitMilliseconds() == 8;
+            wakes++;
+        }
+
+        // Woken early by a message, the next poll is an interval after that iteration
+        now += 0.004;
+        bPassed &= !scheduler.BeginIteration() && scheduler.GetWaitMilliseconds() == 8;
+        now += 0.003;
+        bPassed &= scheduler.GetWaitMilliseconds() == 5;
+
+        scheduler.SetPolling( false );
+        bPassed &= scheduler.GetWaitMilliseconds() == FrameScheduler::WAIT_INFINITE;
+        bPassed &= scheduler.GetStatistics().frames == 1;
+
+        cout << "  polling check           " << (bPassed ? "passed" : "FAILED") << " (" << wakes << " wakes, no frames)" << endl;
+
+        return bPassed;
+    }
+}
+
+bool Benchmark::RunFrameScheduler( uint32_t iterationCount, uint32_t iterations )
+{
+    iterationCount = max( 1u, iterationCount );
+
+    cout << "FrameScheduler: " << iterationCount << " loop iterations, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = CheckInvalidation();
+    bSucceeded &= CheckProgressive();
+    bSucceeded &= CheckPolling();
+
+    // A loop woken a thousand times a second, with the camera moving every tenth iteration
+    vector<double> times;
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        double now = 0.0;
+        FrameScheduler scheduler( [&]() { return now; } );
+
+        uint64_t wait = 0;
+
+        Benchmark::Timer timer;
+        for (uint32_t i = 0; i < iterationCount; ++i)
+        {
+            now += 0.001;
+            if (i % 10 == 0)
+                scheduler.Invalidate( FrameScheduler::INVALIDATE_CAMERA );
+
+            scheduler.BeginIteration();
+            wait += scheduler.GetWaitMilliseconds() == FrameScheduler::WAIT_INFINITE ? 1 : 0;
+        }
+        times.push_back( timer.GetMilliseconds() );
+
+        const FrameScheduler::Statistics& stats = scheduler.GetStatistics();
+        bSucceeded &= stats.frames == (iterationCount + 9) / 10 && wait == iterationCount;
+    }
+
+    const double loop = Benchmark::Record( "FrameScheduler/iteration", times, iterationCount );
+
+    cout << "  iteration               " << setw( 9 ) << loop << " ms (" << loop * 1000000.0 / iterationCount << " ns per iteration)" << endl;
+
+    return bSucceeded;
+}
@@ -0,0 +1,234 @@
+#include "Benchmarks.h"
+#include "FrameStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const uint32_t WINDOW_FRAMES = 600;
+
+    // A frame of a steady scene: a few ms with jitter, and now and then a hitch
+    FrameStatistics::Frame CreateFrame( mt19937& random, uint32_t shadowPass, uint32_t forwardPass )
+    {
+        FrameStatistics::Frame frame;
+        frame.passMilliseconds[shadowPass]  = 1.0 + (random() % 1000) / 2000.0;
+        frame.passMilliseconds[forwardPass] = 3.0 + (random() % 1000) / 1000.0;
+        frame.cpuMilliseconds = frame.passMilliseconds[shadowPass] + frame.passMilliseconds[forwardPass] + (random() % 50 == 0 ? 20.0 : 0.5);
+        frame.draws           = 1200;
+        frame.triangles       = 2500000;
+        frame.uploadBytes     = 256 * 1024;
+        return frame;
+    }
+
+    double GetRank( vector<double> values, double share )
+    {
+        sort( values.begin(), values.end() );
+        const size_t rank = max<size_t>( 1, static_cast<size_t>(ceil( share * values.size() )) );
+        return values[rank - 1];
+    }
+
+    // Percentiles of the window against the newest frames sorted; a spike leaves with its frame
+    bool CheckPercentiles()
+    {
+        bool bPassed = true;
+
+        FrameStatistics statistics( WINDOW_FRAMES );
+        const uint32_t shadowPass  = statistics.AddPass( "shadow" );
+        const uint32_t forwardPass = statistics.AddPass( "forward" );
+        bPassed &= statistics.AddPass( "shadow" ) == shadowPass && statistics.GetMetricCount() == FrameStatistics::METRIC_PASS + 2;
+
+        mt19937 random( 1 );
+        vector<double> cpuTimes;
+        for (uint32_t i = 0; i < 4 * WINDOW_FRAMES + 17; ++i)
+        {
+            const FrameStatistics::Frame frame = CreateFrame( random, shadowPass, forwardPass );
+            statistics.AddFrame( frame );
+            cpuTimes.push_back( frame.cpuMilliseconds );
+        }
+
+        const vector<double> window( cpuTimes.end() - WINDOW_FRAMES, cpuTimes.end() );
+        const FrameStatistics::Percentiles percentiles = statistics.GetPercentiles( FrameStatistics::METRIC_CPU_TIME );
+        bPassed &= percentiles.p50 == GetRank( window, 0.50 ) && percentiles.p95 == GetRank( window, 0.95 ) &&
+                   percentiles.p99 == GetRank( window, 0.99 ) && percentiles.max == *max_element( window.begin(), window.end() );
+        bPassed &= statistics.GetWindowCount() == WINDOW_FRAMES && statistics.GetFrameCount() == cpuTimes.size();
+
+        const FrameStatistics::Percentiles draws = statistics.GetPercentiles( FrameStatistics::METRIC_DRAWS );
+        bPassed &= draws.p50 == 1200.0 && draws.p99 == 1200.0 && draws.mean == 1200.0;
+
+        // One spike, then a full window of steady frames pushes it out
+        FrameStatistics::Frame frame;
+        frame.cpuMilliseconds = 100.0;
+        statistics.AddFrame( frame );
+        bPassed &= statistics.GetPercentiles( FrameStatistics::METRIC_CPU_TIME ).max == 100.0;
+
+        frame.cpuMilliseconds = 5.0;
+        for (uint32_t i = 0; i < WINDOW_FRAMES; ++i)
+        {
+            statistics.AddFrame( frame );
+        }
+        const FrameStatistics::Percentiles steady = statistics.GetPercentiles( FrameStatistics::METRIC_CPU_TIME );
+        bPassed &= steady.p50 == 5.0 && steady.max == 5.0;
+
+        // Every frame in one bucket, the ones past the last bucket in it
+        FrameStatistics::Histogram histogram = statistics.GetHistogram( FrameStatistics::METRIC_CPU_TIME, 1.0, 34 );
+        bPassed &= histogram.counts[5] == WINDOW_FRAMES;
+
+        histogram = statistics.GetHistogram( FrameStatistics::METRIC_CPU_TIME, 1.0, 4 );
+        bPassed &= histogram.counts[3] == WINDOW_FRAMES;
+
+        statistics.Clear();
+        bPassed &= statistics.GetPercentiles( FrameStatistics::METRIC_CPU_TIME ).max == 0.0 && statistics.GetPassCount() == 2;
+
+        cout << "  percentile check        " << (bPassed ? "passed" : "FAILED")
+             << " (p50 " << percentiles.p50 << " ms, p95 " << percentiles.p95 << " ms, p99 " << percentiles.p99 << " ms)" << endl;
+
+        return bPassed;
+    }
+
+    // Replays of one path pass against their own baseline, and fail once a frame time or count grows past
+    // its tolerance or a metric goes missing
+    bool CheckBaseline()
+    {
+        bool bPassed = true;
+
+        auto replay = [&]( double cpuScale, uint64_t extraDraws, bool bForward )
+        {
+            FrameStatistics statistics( WINDOW_FRAMES );
+            const uint32_t shadowPass  = statistics.AddPass( "GPU Shadow" );
+            const uint32_t forwardPass = bForward ? statistics.AddPass( "GPU Forward" ) : shadowPass;
+
+            mt19937 random( 7 );
+            for (uint32_t i = 0; i < WINDOW_FRAMES; ++i)
+            {
+                FrameStatistics::Frame frame = CreateFrame( random, shadowPass, forwardPass );
+                frame.cpuMilliseconds *= cpuScale;
+                frame.draws += extraDraws;
+                statistics.AddFrame( frame );
+            }
+
+            FrameBaseline baseline;
+            baseline.Capture( statistics );
+            return baseline;
+        };
+
+        const string path = "frame_statistics_benchmark.txt";
+
+        FrameBaseline recorded = replay( 1.0, 0, true );
+        FrameBaseline stored;
+        bPassed &= recorded.Write( path ) && stored.Read( path ) && stored.GetFrameCount() == WINDOW_FRAMES;
+        remove( path.c_str() );
+
+        // Exact round trip, names with spaces included
+        bPassed &= stored.GetEntries().size() == recorded.GetEntries().size();
+        for (size_t i = 0; i < stored.GetEntries().size() && bPassed; ++i)
+        {
+            const FrameBaseline::Entry& a = stored.GetEntries()[i];
+            const FrameBaseline::Entry& b = recorded.GetEntries()[i];
+            bPassed &= a.name == b.name && a.bTime == b.bTime && a.percentiles.p50 == b.percentiles.p50 &&
+                       a.percentiles.p95 == b.percentiles.p95 && a.percentiles.p99 == b.percentiles.p99 &&
+                       a.percentiles.max == b.percentiles.max && a.percentiles.mean == b.percentiles.mean;
+        }
+
+        FrameBaseline::Tolerances tolerances;
+        vector<FrameBaseline::Comparison> comparisons;
+        bPassed &= stored.Compare( replay( 1.0, 0, true ), tolerances, comparisons ) && comparisons.size() == 2 * stored.GetEntries().size();
+        bPassed &= stored.Compare( replay( 1.05, 0, true ), tolerances, comparisons );
+        bPassed &= stored.Compare( replay( 0.5, 0, true ), tolerances, comparisons );
+
+        bPassed &= !stored.Compare( replay( 1.5, 0, true ), tolerances, comparisons );
+        const size_t regressed = count_if( comparisons.begin(), comparisons.end(), []( const FrameBaseline::Comparison& c ) { return c.bRegressed; } );
+        bPassed &= regressed == 2 && comparisons[0].name == "cpu" && comparisons[0].bRegressed && comparisons[1].bRegressed;
+
+        ostringstream report;
+        FrameBaseline::WriteComparisons( report, comparisons );
+        bPassed &= report.str().find( "REGRESSED" ) != string::npos;
+
+        bPassed &= !stored.Compare( replay( 1.0, 1, true ), tolerances, comparisons );
+
+        tolerances.metrics.push_back( make_pair( string( "draws" ), FrameBaseline::Tolerance( 0.01 ) ) );
+        bPassed &= stored.Compare( replay( 1.0, 1, true ), tolerances, comparisons );
+
+        bPassed &= !stored.Compare( replay( 1.0, 0, false ), tolerances, comparisons );
+        bPassed &= any_of( comparisons.begin(), comparisons.end(), []( const FrameBaseline::Comparison& c ) { return c.bMissing && c.name == "GPU Forward"; } );
+
+        // Not a baseline
+        FILE* pFile = fopen( path.c_str(), "w" );
+        if (pFile != nullptr)
+        {
+            fprintf( pFile, "frames 10\nms 1 2 3\n" );
+            fclose( pFile );
+        }
+        bPassed &= !stored.Read( path ) && stored.GetEntries().empty() && !stored.GetError().empty();
+        remove( path.c_str() );
+
+        cout << "  baseline check          " << (bPassed ? "passed" : "FAILED") << endl;
+
+        return bPassed;
+    }
+}
+
+bool Benchmark::RunFrameStatistics( uint32_t frameCount, uint32_t iterations )
+{
+    cout << "FrameStatistics: " << frameCount << " frames, window " << WINDOW_FRAMES << ", median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = CheckPercentiles();
+    bSucceeded &= CheckBaseline();
+
+    if (frameCount == 0)
+        return bSucceeded;
+
+    FrameStatistics statistics( WINDOW_FRAMES );
+    const uint32_t shadowPass  = statistics.AddPass( "shadow" );
+    const uint32_t forwardPass = statistics.AddPass( "forward" );
+
+    mt19937 random( 3 );
+    vector<FrameStatistics::Frame> frames( min<uint32_t>( frameCount, 4096 ) );
+    for (FrameStatistics::Frame& frame : frames)
+    {
+        frame = CreateFrame( random, shadowPass, forwardPass );
+    }
+
+    // Adding a frame is what every frame pays; the report is paid once per report interval
+    vector<double> addTimes, reportTimes;
+    FrameStatistics::Percentiles cpu;
+    uint32_t                     fastFrames = 0;
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        Benchmark::Timer addTimer;
+        for (uint32_t i = 0; i < frameCount; ++i)
+        {
+            statistics.AddFrame( frames[i % frames.size()] );
+        }
+        addTimes.push_back( addTimer.GetMilliseconds() );
+
+        Benchmark::Timer reportTimer;
+        for (uint32_t metric = 0; metric < statistics.GetMetricCount(); ++metric)
+        {
+            const FrameStatistics::Percentiles percentiles = statistics.GetPercentiles( metric );
+            if (metric == FrameStatistics::METRIC_CPU_TIME)
+                cpu = percentiles;
+        }
+        fastFrames = statistics.GetHistogram( FrameStatistics::METRIC_CPU_TIME, 1.0, 34 ).counts[5];
+        reportTimes.push_back( reportTimer.GetMilliseconds() );
+    }
+
+    const double addTime    = Benchmark::Record( "FrameStatistics/add frame", addTimes, frameCount );
+    const double reportTime = Benchmark::Record( "FrameStatistics/percentiles and histogram", reportTimes, statistics.GetMetricCount() );
+
+    cout << "  add frame       " << setw( 10 ) << addTime * 1.0e6 / frameCount << " ns/frame" << endl;
+    cout << "  report          " << setw( 10 ) << reportTime << " ms for " << statistics.GetMetricCount() << " metrics (cpu p99 " << cpu.p99 << " ms, "
+         << fastFrames << " frames in 5 - 6 ms)" << endl;
+
+    return bSucceeded;
+}
@@ -0,0 +1,160 @@
+#include "Benchmarks.h"
+#include "GpuTimer.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const uint64_t FREQUENCY = 1000000;     // microsecond ticks
+
+    // Shadow pass every other frame as when the cascades are cached, then the clear and the forward pass
+    const uint64_t SHADOW_TICKS  = 1500;
+    const uint64_t CLEAR_TICKS   = 100;
+    const uint64_t FORWARD_TICKS = 4000;
+    const uint64_t GAP_TICKS     = 50;
+
+    void RecordFrame( GpuTimer& timer, MockGpuTimestampQueries& queries, uint32_t frame )
+    {
+        // The mock ignores the command list
+        void* pCommandList = nullptr;
+
+        auto zone = [&]( const char* name, uint64_t ticks )
+        {
+            const uint32_t index = timer.BeginZone( pCommandList, name );
+            queries.Advance( ticks );
+            timer.EndZone( pCommandList, index );
+            queries.Advance( GAP_TICKS );
+        };
+
+        if (frame % 2 == 0)
+            zone( "GPU Shadow", SHADOW_TICKS );
+        zone( "GPU Clear", CLEAR_TICKS );
+        zone( "GPU Forward", FORWARD_TICKS );
+    }
+
+    bool IsNear( double value, double expected )
+    {
+        return fabs( value - expected ) < 1e-9;
+    }
+
+    // Zone times of the newest frame read, which was recorded frame - latency
+    bool CheckZoneTimes( const GpuTimer& timer, uint64_t recordedFrame )
+    {
+        const vector<GpuTimer::ZoneTime>& times = timer.GetZoneTimes();
+        const bool bShadow = recordedFrame % 2 == 0;
+        if (times.size() != (bShadow ? 3u : 2u))
+            return false;
+
+        const double tickMilliseconds = 1000.0 / FREQUENCY;
+        size_t i = 0;
+        if (bShadow && !IsNear( times[i++].milliseconds, SHADOW_TICKS * tickMilliseconds ))
+            return false;
+
+        const double frameTicks = (bShadow ? SHADOW_TICKS + GAP_TICKS : 0) + CLEAR_TICKS + GAP_TICKS + FORWARD_TICKS;
+        return IsNear( times[i].milliseconds, CLEAR_TICKS * tickMilliseconds ) &&
+               IsNear( times[i + 1].milliseconds, FORWARD_TICKS * tickMilliseconds ) &&
+               IsNear( timer.GetStatistics().lastMilliseconds, frameTicks * tickMilliseconds );
+    }
+
+    // The GPU finishes each frame latency frames after it was submitted, then stalls for a while
+    bool CheckResolve( uint32_t frameCount, uint32_t latency, uint32_t stallFrames )
+    {
+        MockGpuTimestampQueries queries( GpuTimer::QUERY_COUNT, FREQUENCY );
+        GpuTimer timer( queries );
+
+        Profiler::Reset();
+        Profiler::SetEnabled( true );
+
+        const uint32_t stallBegin = frameCount / 2;
+        uint64_t completed = 0;
+        bool bTimes = true;
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            // Frame n signals fence n + 1
+            if (frame < stallBegin || frame >= stallBegin + stallFrames)
+                completed = frame >= latency ? frame - latency + 1 : 0;
+            queries.Complete( completed );
+
+            Profiler::BeginFrame();
+            if (timer.Update( completed ) > 0)
+                bTimes &= CheckZoneTimes( timer, frame - timer.GetStatistics().lastLatency );
+
+            RecordFrame( timer, queries, frame );
+
+            queries.Submit( frame + 1 );
+            timer.EndFrame( frame + 1 );
+            Profiler::EndFrame();
+        }
+
+        Profiler::SetEnabled( false );
+
+        const GpuTimer::Statistics& stats = timer.GetStatistics();
+        const Profiler::Summary& summary = Profiler::GetSummary();
+        const Profiler::ZoneStatistics* pForward = nullptr;
+        for (const Profiler::ZoneStatistics& zone : summary.zones)
+        {
+            if (string( zone.name ) == "GPU Forward")
+                pForward = &zone;
+        }
+
+        // A stall longer than the query ranges costs frames; the timer reads everything else
+        const uint64_t expectedSkipped = stallFrames + latency > GpuTimer::MAX_FRAMES ? stallFrames + latency - GpuTimer::MAX_FRAMES : 0;
+        const bool bPassed = bTimes && queries.GetEarlyReads() == 0 && stats.failedReads == 0 && stats.droppedZones == 0 &&
+                             stats.skippedFrames == expectedSkipped &&
+                             stats.readFrames + stats.skippedFrames + latency == frameCount &&
+                             stats.lastLatency == latency && stats.maxLatency == latency + stallFrames &&
+                             pForward != nullptr && pForward->depth == 1 && IsNear( pForward->maxMilliseconds, FORWARD_TICKS * 1000.0 / FREQUENCY );
+
+        cout << "  latency " << latency << ", stall " << setw( 2 ) << stallFrames << "      " << (bPassed ? "passed" : "FAILED")
+             << " (" << stats.readFrames << " read, " << stats.skippedFrames << " skipped, max latency " << stats.maxLatency << ")" << endl;
+
+        Profiler::Reset();
+
+        return bPassed;
+    }
+}
+
+bool Benchmark::RunGpuTimer( uint32_t frameCount, uint32_t iterations )
+{
+    cout << "GpuTimer: " << frameCount << " frames on the mock queries, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = true;
+    bSucceeded &= CheckResolve( 32, 1, 0 );
+    bSucceeded &= CheckResolve( 32, 2, 1 );
+    bSucceeded &= CheckResolve( 32, 2, 6 );
+
+    // Bookkeeping per frame: three zones, the submission and the read of the frame before
+    vector<double> times;
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        MockGpuTimestampQueries queries( GpuTimer::QUERY_COUNT, FREQUENCY );
+        GpuTimer timer( queries );
+
+        Benchmark::Timer benchmarkTimer;
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            queries.Complete( frame );
+            timer.Update( frame );
+            RecordFrame( timer, queries, 0 );
+            queries.Submit( frame + 1 );
+            timer.EndFrame( frame + 1 );
+        }
+        times.push_back( benchmarkTimer.GetMilliseconds() );
+
+        bSucceeded &= timer.GetStatistics().readFrames + 1 == frameCount;
+    }
+
+    const double median = Benchmark::Record( "GpuTimer/frames", times, frameCount );
+
+    cout << "  " << median << " ms, " << setprecision( 1 ) << median * 1000000.0 / max( 1u, frameCount ) << " ns per frame" << setprecision( 3 ) << endl;
+
+    return bSucceeded;
+}
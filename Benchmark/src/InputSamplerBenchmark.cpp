@@ -0,0 +1,115 @@
+#include "Benchmarks.h"
+#include "InputSampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+    // Sampled by hand with a fake clock: more events than the ring holds while nothing is consumed
+    bool CheckCoalescing()
+    {
+        double now = 0.0;
+
+        SyntheticInputSource source;
+        source.AddDrag( 1, 2, -1, InputSampler::RING_SIZE + 44 );
+        source.AddIdle( 1 );
+
+        InputSampler sampler( source, [&]() { return now; } );
+        for (uint32_t i = 0; i < InputSampler::RING_SIZE + 44; ++i)
+        {
+            now += 0.001;
+            sampler.SampleOnce();
+        }
+
+        InputSampler::Frame first;
+        sampler.Consume( first );
+
+        // The merged event goes out with the next sample
+        now += 0.001;
+        sampler.SampleOnce();
+
+        InputSampler::Frame second;
+        sampler.Consume( second );
+
+        const InputSampler::Statistics stats = sampler.GetStatistics();
+        const bool bPassed = first.eventCount == InputSampler::RING_SIZE && first.pressed == 1 && first.firstTime == 0.001 &&
+                             second.eventCount == 1 && second.released == 1 && second.buttons == 0 &&
+                             first.dx + second.dx == source.GetTotalX() && first.dy + second.dy == source.GetTotalY() &&
+                             stats.coalesced == 44;
+
+        cout << "  coalescing check        " << (bPassed ? "passed" : "FAILED")
+             << " (" << stats.events << " events, " << stats.coalesced << " coalesced)" << endl;
+
+        return bPassed;
+    }
+}
+
+bool Benchmark::RunInputSampler( uint32_t frameCount, double frameMilliseconds )
+{
+    const double SAMPLE_RATE = 1000.0;
+
+    cout << "InputSampler: " << frameCount << " frames of " << frameMilliseconds << " ms, sampled at " << SAMPLE_RATE << " Hz" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = CheckCoalescing();
+
+    // Drags with the left button, a pause, then the center button, repeated past the end of the run
+    const uint32_t samplesPerFrame = max( 1u, static_cast<uint32_t>(frameMilliseconds * SAMPLE_RATE / 1000.0) );
+    SyntheticInputSource source;
+    for (uint32_t i = 0; i < frameCount; i += 8)
+    {
+        source.AddDrag( 1, 3, -2, samplesPerFrame * 5 );
+        source.AddIdle( samplesPerFrame );
+        source.AddDrag( 4, -1, 1, samplesPerFrame * 2 );
+    }
+
+    InputSampler sampler( source );
+    sampler.Start( SAMPLE_RATE );
+
+    // Render loop: input is consumed before recording, the sleep stands for recording and the wait for the GPU
+    int64_t  consumedX = 0;
+    int64_t  consumedY = 0;
+    uint32_t presses   = 0;
+    for (uint32_t frame = 0; frame < frameCount; ++frame)
+    {
+        InputSampler::Frame input;
+        sampler.Consume( input );
+
+        consumedX += input.dx;
+        consumedY += input.dy;
+        presses   += ((input.pressed & 1) ? 1 : 0) + ((input.pressed & 4) ? 1 : 0);
+
+        this_thread::sleep_for( chrono::duration<double, milli>( frameMilliseconds ) );
+
+        sampler.RecordPresent( input, sampler.Now() );
+    }
+
+    sampler.Stop();
+
+    // Whatever arrived after the last frame still adds up
+    InputSampler::Frame rest;
+    sampler.Consume( rest );
+    consumedX += rest.dx;
+    consumedY += rest.dy;
+
+    const InputSampler::Statistics stats = sampler.GetStatistics();
+    const double duration = frameCount * frameMilliseconds / 1000.0;
+    const bool bMatched = consumedX == source.GetTotalX() && consumedY == source.GetTotalY() && stats.coalesced == 0;
+
+    cout << "  " << stats.samples << " samples (" << setprecision( 1 ) << stats.samples / duration << " Hz)"
+         << ", " << stats.events << " events, " << presses << " button presses" << setprecision( 3 ) << endl;
+    cout << "  input to present " << stats.AverageLatency() * 1000.0 << " ms avg / " << stats.latencyMax * 1000.0 << " ms max"
+         << ", newest input " << stats.AverageLastLatency() * 1000.0 << " ms avg over " << stats.presents << " frames" << endl;
+    cout << "  motion check            " << (bMatched ? "passed" : "FAILED")
+         << " (" << consumedX << ", " << consumedY << " of " << source.GetTotalX() << ", " << source.GetTotalY() << ")" << endl;
+
+    bSucceeded &= bMatched;
+
+    return bSucceeded;
+}
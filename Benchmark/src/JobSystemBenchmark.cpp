@@ -0,0 +1,473 @@
+#include "Benchmarks.h"
+#include "BatchMath.h"
+#include "DrawSort.h"
+#include "JobSystem.h"
+#include "SceneGenerator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Checks run with this many workers whatever the machine has, so steals and sleeps happen on one core too
+    const uint32_t CHECK_WORKERS = 7;
+
+    // Every index exactly once, for counts around the grain and ring sizes, and from inside jobs
+    bool CheckParallelFor()
+    {
+        JobSystem jobs( CHECK_WORKERS );
+
+        bool bPassed = true;
+        const uint32_t counts[] = { 0, 1, 2, 7, 64, 4095, 4096, 4097, 100000 };
+        const uint32_t grains[] = { 0, 1, 3, 1000 };
+        for (uint32_t count : counts)
+        {
+            for (uint32_t grain : grains)
+            {
+                vector<atomic<uint32_t> > calls( count );
+                for (auto& value : calls)
+                {
+                    value = 0;
+                }
+
+                auto call = [&]( uint32_t i ) { calls[i]++; };
+                jobs.ParallelFor( count, call, grain );
+
+                bPassed &= all_of( calls.begin(), calls.end(), []( const atomic<uint32_t>& value ) { return value == 1; } );
+            }
+        }
+
+        // Nested: every outer index runs an inner loop, waiting inside a job
+        const uint32_t OUTER = 256;
+        const uint32_t INNER = 1000;
+        vector<uint64_t> sums( OUTER, 0 );
+        auto outer = [&]( uint32_t i )
+        {
+            atomic<uint64_t> sum( 0 );
+            auto inner = [&]( uint32_t j ) { sum += j; };
+            jobs.ParallelFor( INNER, inner, 16 );
+            sums[i] = sum;
+        };
+        jobs.ParallelFor( OUTER, outer, 1 );
+        bPassed &= all_of( sums.begin(), sums.end(), [&]( uint64_t value ) { return value == uint64_t( INNER ) * (INNER - 1) / 2; } );
+
+        const JobSystem::Statistics stats = jobs.GetStatistics();
+        bPassed &= stats.jobs > 0;
+
+        cout << "  parallel for check      " << (bPassed ? "passed" : "FAILED") << " (" << jobs.GetThreadCount() << " threads, "
+             << stats.jobs << " jobs, " << stats.steals << " stolen)" << endl;
+
+        return bPassed;
+    }
+
+    // Diamonds of jobs: one job, a fan of jobs that need it, and a last job that needs the fan
+    bool CheckDependencies()
+    {
+        JobSystem jobs( CHECK_WORKERS );
+
+        const uint32_t ROUNDS = 2000;
+        const uint32_t FAN    = 16;
+
+        bool bPassed = true;
+        for (uint32_t round = 0; round < ROUNDS && bPassed; ++round)
+        {
+            uint32_t first = 0;
+            uint32_t fan[FAN] = {};
+            uint32_t last = 0;
+
+            JobSystem::Counter firstDone, fanDone, lastDone;
+
+            // Long enough that the fan is usually submitted while it runs
+            auto runFirst = [&]()
+            {
+                volatile uint32_t spin = 0;
+                for (uint32_t i = 0; i < 2000; ++i)
+                {
+                    spin = spin + i;
+                }
+                first = round + 1;
+            };
+            auto runFan   = [&]( uint32_t begin, uint32_t ) { fan[begin] = first * (begin + 1); };
+            auto runLast  = [&]()
+            {
+                for (uint32_t value : fan)
+                {
+                    last += value;
+                }
+            };
+
+            // Each group is added in full before anything depends on its counter, which would otherwise reach
+            // zero early
+            jobs.Run( runFirst, &firstDone );
+            for (uint32_t i = 0; i < FAN; ++i)
+            {
+                jobs.Submit( []( void* pContext, uint32_t begin, uint32_t end ) { (*static_cast<decltype(runFan)*>(pContext))( begin, end ); },
+                             &runFan, i, i + 1, &fanDone, &firstDone );
+            }
+            jobs.Run( runLast, &lastDone, &fanDone );
+
+            // A counter at zero holds nothing back
+            JobSystem::Counter none;
+            uint32_t free = 0;
+            auto runFree = [&]() { free = 1; };
+            jobs.Run( runFree, &lastDone, &none );
+
+            jobs.Wait( lastDone );
+            jobs.Wait( fanDone );
+            jobs.Wait( firstDone );
+
+            bPassed &= last == (round + 1) * FAN * (FAN + 1) / 2 && free == 1;
+        }
+
+        cout << "  dependency check        " << (bPassed ? "passed" : "FAILED") << " (" << ROUNDS << " rounds of " << FAN + 2 << " jobs)" << endl;
+
+        return bPassed;
+    }
+
+    uint64_t Fibonacci( JobSystem& jobs, uint32_t n )
+    {
+        if (n < 2)
+            return n;
+
+        // Small ones inline, as a real job would keep its leaves
+        if (n < 12)
+            return Fibonacci( jobs, n - 1 ) + Fibonacci( jobs, n - 2 );
+
+        uint64_t a = 0;
+        JobSystem::Counter counter;
+        auto left = [&]() { a = Fibonacci( jobs, n - 1 ); };
+        jobs.Run( left, &counter );
+
+        const uint64_t b = Fibonacci( jobs, n - 2 );
+        jobs.Wait( counter );
+
+        return a + b;
+    }
+
+    // Several outside threads submitting at once, recursive jobs waiting on their children, and more jobs in
+    // flight than a ring holds
+    bool CheckStress()
+    {
+        JobSystem jobs( CHECK_WORKERS );
+
+        bool bPassed = true;
+
+        // Outside threads share slot 0
+        const uint32_t THREADS = 4;
+        const uint32_t COUNT   = 20000;
+        vector<uint8_t> results( THREADS, 0 );
+        vector<thread>  threads;
+        for (uint32_t t = 0; t < THREADS; ++t)
+        {
+            threads.push_back( thread( [&, t]()
+            {
+                bool bOk = true;
+                for (uint32_t round = 0; round < 20; ++round)
+                {
+                    atomic<uint64_t> sum( 0 );
+                    auto add = [&]( uint32_t i ) { sum += i; };
+                    jobs.ParallelFor( COUNT, add, 7 );
+                    bOk &= sum == uint64_t( COUNT ) * (COUNT - 1) / 2;
+                }
+                results[t] = bOk;
+            } ) );
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        bPassed &= all_of( results.begin(), results.end(), []( uint8_t value ) { return value == 1; } );
+
+        bPassed &= Fibonacci( jobs, 24 ) == 46368;
+
+        // Twice the ring: the submitter has to help before it finds free jobs
+        const uint32_t OVERFLOW_COUNT = JobSystem::JOB_CAPACITY * 2;
+        atomic<uint32_t> ran( 0 );
+        auto count = [&]() { ran++; };
+        JobSystem::Counter counter;
+        for (uint32_t i = 0; i < OVERFLOW_COUNT; ++i)
+        {
+            jobs.Run( count, &counter );
+        }
+        jobs.Wait( counter );
+        bPassed &= ran == OVERFLOW_COUNT;
+
+        // Without workers everything runs on the waiting thread
+        JobSystem inlineJobs( 0 );
+        ran = 0;
+        JobSystem::Counter inlineCounter;
+        for (uint32_t i = 0; i < 100; ++i)
+        {
+            inlineJobs.Run( count, &inlineCounter );
+        }
+        inlineJobs.Wait( inlineCounter );
+        bPassed &= ran == 100 && inlineJobs.GetThreadCount() == 1;
+
+        const JobSystem::Statistics stats = jobs.GetStatistics();
+        cout << "  stress check            " << (bPassed ? "passed" : "FAILED") << " (" << stats.jobs << " jobs, " << stats.steals << " stolen, "
+             << stats.sleeps << " sleeps)" << endl;
+
+        return bPassed;
+    }
+
+    // Scene loading and transforms go through the shared job system; the results must match a serial pass
+    bool CheckScene()
+    {
+        SceneGenerator::Config config;
+        config.objectCount    = 5000;
+        config.hierarchyDepth = 4;
+
+        GeneratedScene scene;
+        bool bPassed = SceneGenerator::Generate( config, scene );
+
+        // Serial world matrices against UpdateWorld's, which are computed level by level in parallel
+        vector<float> worlds( scene.nodes.size() * 16 );
+        for (size_t i = 0; i < scene.nodes.size(); ++i)
+        {
+            const GeneratedScene::Node& node = scene.nodes[i];
+            if (node.parent == GeneratedScene::NO_PARENT)
+                copy( node.local, node.local + 16, &worlds[i * 16] );
+            else
+                BatchMath::Multiply( &worlds[node.parent * 16], node.local, &worlds[i * 16] );
+        }
+
+        for (size_t i = 0; i < scene.nodes.size(); ++i)
+        {
+            bPassed &= equal( worlds.begin() + i * 16, worlds.begin() + i * 16 + 16, scene.nodes[i].world );
+        }
+
+        const uint64_t hash = scene.GetHash();
+        scene.UpdateWorld();
+        bPassed &= scene.GetHash() == hash;
+
+        // Meshes are read in parallel; the scene must come back equal
+        ostringstream path;
+        path << "jobsystem_check_" << config.seed << ".scene";
+
+        SceneGenerator generator;
+        GeneratedScene read;
+        bPassed &= generator.Write( scene, path.str() ) && generator.Read( path.str(), read ) && read.GetHash() == hash;
+
+        remove( path.str().c_str() );
+        for (size_t i = 0; i < scene.meshes.size(); ++i)
+        {
+            remove( SceneGenerator::GetMeshPath( path.str(), i ).c_str() );
+        }
+
+        // A sort of many items runs its chunks as jobs
+        vector<DrawSort::Item> items( DrawSort::PARALLEL_THRESHOLD * 4 );
+        mt19937_64 random( 5 );
+        for (uint32_t i = 0; i < items.size(); ++i)
+        {
+            items[i].key   = random() & 0xffffffffffull;
+            items[i].index = i;
+        }
+
+        DrawSort sort( 4 );
+        sort.Sort( items );
+        bPassed &= DrawSort::IsSorted( items );
+
+        cout << "  scene check             " << (bPassed ? "passed" : "FAILED") << " (" << scene.nodes.size() << " nodes, depth "
+             << scene.GetDepth() << ", " << scene.meshes.size() << " meshes)" << endl;
+
+        return bPassed;
+    }
+
+    struct Workload
+    {
+        // Parent worlds times locals, as a flat hierarchy level
+        vector<float> parents;
+        vector<float> locals;
+        vector<float> worlds;
+
+        // Boxes of the objects in world space and the result of culling them
+        vector<float>   boxes[6];
+        vector<uint8_t> visible;
+        float           planes[24];
+    };
+
+    void CreateWorkload( uint32_t objectCount, Workload& workload )
+    {
+        mt19937 random( 9 );
+        uniform_real_distribution<float> position( -100.0f, 100.0f );
+
+        workload.parents.assign( 16, 0.0f );
+        workload.parents[0] = workload.parents[5] = workload.parents[10] = workload.parents[15] = 1.0f;
+        workload.parents[12] = 1.0f;
+
+        workload.locals.assign( static_cast<size_t>(objectCount) * 16, 0.0f );
+        workload.worlds.assign( static_cast<size_t>(objectCount) * 16, 0.0f );
+        for (uint32_t i = 0; i < objectCount; ++i)
+        {
+            float* m = &workload.locals[static_cast<size_t>(i) * 16];
+            m[0] = m[5] = m[10] = m[15] = 1.0f;
+            m[12] = position( random );
+            m[13] = position( random ) * 0.1f;
+            m[14] = position( random );
+        }
+
+        for (int axis = 0; axis < 6; ++axis)
+        {
+            workload.boxes[axis].resize( objectCount );
+        }
+        for (uint32_t i = 0; i < objectCount; ++i)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const float center = position( random );
+                workload.boxes[axis][i]     = center - 1.0f;
+                workload.boxes[axis + 3][i] = center + 1.0f;
+            }
+        }
+        workload.visible.assign( objectCount, 0 );
+
+        // A box frustum around the origin, half the objects inside
+        const float planes[24] =
+        {
+             1.0f, 0.0f, 0.0f, 50.0f,  -1.0f,  0.0f, 0.0f, 50.0f,
+             0.0f, 1.0f, 0.0f, 70.0f,   0.0f, -1.0f, 0.0f, 70.0f,
+             0.0f, 0.0f, 1.0f, 100.0f,  0.0f,  0.0f, -1.0f, 100.0f,
+        };
+        copy( planes, planes + 24, workload.planes );
+    }
+
+    // Objects a transform or culling job takes; a few microseconds of work
+    const uint32_t OBJECT_GRAIN = 1024;
+
+    void Transform( JobSystem& jobs, Workload& workload )
+    {
+        const uint32_t objectCount = static_cast<uint32_t>(workload.visible.size());
+        auto transform = [&]( uint32_t job )
+        {
+            const size_t begin = static_cast<size_t>(job) * OBJECT_GRAIN;
+            const size_t count = min<size_t>( OBJECT_GRAIN, objectCount - begin );
+            BatchMath::MultiplyArray( workload.parents.data(), &workload.locals[begin * 16], &workload.worlds[begin * 16], count );
+        };
+        jobs.ParallelFor( (objectCount + OBJECT_GRAIN - 1) / OBJECT_GRAIN, transform, 1 );
+    }
+
+    size_t Cull( JobSystem& jobs, Workload& workload )
+    {
+        const uint32_t objectCount = static_cast<uint32_t>(workload.visible.size());
+        const uint32_t jobCount    = (objectCount + OBJECT_GRAIN - 1) / OBJECT_GRAIN;
+
+        vector<size_t> visibleCounts( jobCount );
+        auto cull = [&]( uint32_t job )
+        {
+            const size_t begin = static_cast<size_t>(job) * OBJECT_GRAIN;
+
+            BatchMath::ConstBoxes boxes;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                boxes.min[axis] = &workload.boxes[axis][begin];
+                boxes.max[axis] = &workload.boxes[axis + 3][begin];
+            }
+            visibleCounts[job] = BatchMath::TestBoxes( workload.planes, 6, boxes, min<size_t>( OBJECT_GRAIN, objectCount - begin ), &workload.visible[begin] );
+        };
+        jobs.ParallelFor( jobCount, cull, 1 );
+
+        size_t visible = 0;
+        for (size_t count : visibleCounts)
+        {
+            visible += count;
+        }
+        return visible;
+    }
+}
+
+bool Benchmark::RunJobSystem( uint32_t jobCount, uint32_t iterations )
+{
+    const uint32_t hardwareThreads = max( 1u, thread::hardware_concurrency() );
+
+    cout << "JobSystem: " << jobCount << " jobs and objects, 1 to " << hardwareThreads << " threads, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = CheckParallelFor();
+    bSucceeded &= CheckDependencies();
+    bSucceeded &= CheckStress();
+    bSucceeded &= CheckScene();
+
+    Workload workload;
+    CreateWorkload( jobCount, workload );
+
+    // Serial results, which every thread count must reproduce
+    JobSystem serial( 0 );
+    Transform( serial, workload );
+    const vector<float> expectedWorlds = workload.worlds;
+    const size_t expectedVisible = Cull( serial, workload );
+
+    double baseline[4] = {};
+    for (uint32_t threadCount = 1; threadCount <= hardwareThreads; threadCount *= 2)
+    {
+        JobSystem jobs( threadCount - 1 );
+
+        ostringstream suffix;
+        suffix << "/" << threadCount << " threads";
+
+        // Empty jobs in batches, for the cost of a submit, a take and a finish
+        const uint32_t BATCH = 1024;
+        atomic<uint32_t> ran( 0 );
+        auto empty = [&]() { ran.fetch_add( 1, memory_order_relaxed ); };
+
+        vector<double> emptyTimes, fibonacciTimes, transformTimes, cullTimes;
+        for (uint32_t n = 0; n < iterations; ++n)
+        {
+            ran = 0;
+            Benchmark::Timer emptyTimer;
+            for (uint32_t submitted = 0; submitted < jobCount; submitted += BATCH)
+            {
+                JobSystem::Counter counter;
+                for (uint32_t i = submitted; i < min( jobCount, submitted + BATCH ); ++i)
+                {
+                    jobs.Run( empty, &counter );
+                }
+                jobs.Wait( counter );
+            }
+            emptyTimes.push_back( emptyTimer.GetMilliseconds() );
+            bSucceeded &= ran == jobCount;
+
+            Benchmark::Timer fibonacciTimer;
+            bSucceeded &= Fibonacci( jobs, 27 ) == 196418;
+            fibonacciTimes.push_back( fibonacciTimer.GetMilliseconds() );
+
+            fill( workload.worlds.begin(), workload.worlds.end(), 0.0f );
+            Benchmark::Timer transformTimer;
+            Transform( jobs, workload );
+            transformTimes.push_back( transformTimer.GetMilliseconds() );
+            bSucceeded &= workload.worlds == expectedWorlds;
+
+            fill( workload.visible.begin(), workload.visible.end(), 0 );
+            Benchmark::Timer cullTimer;
+            bSucceeded &= Cull( jobs, workload ) == expectedVisible;
+            cullTimes.push_back( cullTimer.GetMilliseconds() );
+        }
+
+        const double times[4] =
+        {
+            Benchmark::Record( "JobSystem/empty jobs" + suffix.str(), emptyTimes, jobCount ),
+            Benchmark::Record( "JobSystem/fibonacci" + suffix.str(), fibonacciTimes ),
+            Benchmark::Record( "JobSystem/transforms" + suffix.str(), transformTimes, jobCount ),
+            Benchmark::Record( "JobSystem/culling" + suffix.str(), cullTimes, jobCount ),
+        };
+        if (threadCount == 1)
+            copy( times, times + 4, baseline );
+
+        const JobSystem::Statistics stats = jobs.GetStatistics();
+        cout << "  " << setw( 3 ) << threadCount << " thread(s)  empty " << setw( 8 ) << times[0] * 1000000.0 / max( 1u, jobCount ) << " ns per job"
+             << "   fibonacci " << setw( 8 ) << times[1] << " ms (" << setprecision( 2 ) << baseline[1] / times[1] << "x)" << setprecision( 3 )
+             << "   transforms " << setw( 8 ) << times[2] << " ms (" << setprecision( 2 ) << baseline[2] / times[2] << "x)" << setprecision( 3 )
+             << "   culling " << setw( 8 ) << times[3] << " ms (" << setprecision( 2 ) << baseline[3] / times[3] << "x)" << setprecision( 3 )
+             << "   " << stats.steals << " stolen" << endl;
+    }
+
+    return bSucceeded;
+}
@@ -0,0 +1,212 @@
+#include "Benchmarks.h"
+#include "LightClusters.h"
+#include "ShadowFrustum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // 16:9 perspective looking down +z from slightly above a 200 x 200 light field
+    void CreateCamera( float view[16], float projection[16] )
+    {
+        const float nearZ  = 0.5f;
+        const float farZ   = 250.0f;
+        const float scaleY = 1.0f / tanf( 0.5f * 1.0472f );
+        const float scaleX = scaleY / (16.0f / 9.0f);
+
+        fill( projection, projection + 16, 0.0f );
+        projection[0]  = scaleX;
+        projection[5]  = scaleY;
+        projection[10] = farZ / (farZ - nearZ);
+        projection[11] = 1.0f;
+        projection[14] = -nearZ * farZ / (farZ - nearZ);
+
+        // 10 units up, tilted down to look at the center of the field
+        const float c = cosf( 0.1f );
+        const float s = sinf( 0.1f );
+        const float rotation[16] = { 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, c, -s, 0.0f,  0.0f, s, c, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f };
+        const float translation[16] = { 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, -10.0f, 0.0f, 1.0f };
+        ShadowFrustum::Multiply( rotation, translation, view );
+    }
+
+    // Every fourth light is a spot light; ranges are small against the field, as in a lit city block
+    void CreateLights( LightList& lights, uint32_t count )
+    {
+        mt19937 random( 12345 );
+        uniform_real_distribution<float> unit( -1.0f, 1.0f );
+        uniform_real_distribution<float> range( 1.0f, 6.0f );
+
+        lights.Clear();
+        lights.Reserve( count );
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float position[3] = { 100.0f * unit( random ), 5.0f * unit( random ), 100.0f + 100.0f * unit( random ) };
+            const float color[3]    = { 1.0f, 1.0f, 1.0f };
+
+            if (i % 4 == 3)
+            {
+                const float direction[3] = { unit( random ), -1.0f, unit( random ) };
+                lights.AddSpotLight( position, direction, range( random ), 0.3f, 0.3f + 0.8f * fabsf( unit( random ) ), color );
+            }
+            else
+            {
+                lights.AddPointLight( position, range( random ), color );
+            }
+        }
+    }
+
+    double Measure( const string& name, LightClusters& clusters, const float view[16], const float projection[16], const LightList& lights, uint32_t iterations )
+    {
+        vector<double> times;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            clusters.Build( view, projection, lights );
+            times.push_back( clusters.GetStatistics().milliseconds );
+        }
+
+        return Benchmark::Record( name, times, lights.Size() );
+    }
+
+    bool IsEqual( const LightClusters& a, const LightClusters& b )
+    {
+        if (a.GetIndices() != b.GetIndices() || a.GetRanges().size() != b.GetRanges().size())
+            return false;
+
+        for (size_t i = 0; i < a.GetRanges().size(); ++i)
+        {
+            if (a.GetRanges()[i].offset != b.GetRanges()[i].offset || a.GetRanges()[i].count != b.GetRanges()[i].count)
+                return false;
+        }
+
+        return true;
+    }
+
+    // Samples points each light reaches and checks that the cluster containing the point lists the light
+    uint32_t CountMissedLights( const LightClusters& clusters, const float view[16], const float projection[16], const LightList& lights )
+    {
+        const LightClusters::Config& config = clusters.GetConfig();
+
+        float viewProjection[16];
+        ShadowFrustum::Multiply( projection, view, viewProjection );
+
+        mt19937 random( 54321 );
+        uniform_real_distribution<float> unit( -1.0f, 1.0f );
+
+        uint32_t missed = 0;
+        for (size_t light = 0; light < lights.Size(); ++light)
+        {
+            for (int sample = 0; sample < 64; ++sample)
+            {
+                const float offset[3] = { unit( random ), unit( random ), unit( random ) };
+                const float length    = sqrtf( offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2] );
+                if (length > 1.0f || length < 1e-3f)
+                    continue;
+
+                const float cosAngle = (offset[0] * lights.directionX[light] + offset[1] * lights.directionY[light] + offset[2] * lights.directionZ[light]) / length;
+                if (cosAngle < lights.spotCosOuter[light])
+                    continue;
+
+                const float world[4] = { lights.positionX[light] + offset[0] * lights.range[light],
+                                         lights.positionY[light] + offset[1] * lights.range[light],
+                                         lights.positionZ[light] + offset[2] * lights.range[light], 1.0f };
+
+                float clip[4];
+                ShadowFrustum::Transform( viewProjection, world, clip );
+                if (clip[3] <= 0.0f)
+                    continue;
+
+                const float x = clip[0] / clip[3];
+                const float y = clip[1] / clip[3];
+                const float z = clip[2] / clip[3];
+                if (x < -1.0f || x > 1.0f || y < -1.0f || y > 1.0f || z < 0.0f || z > 1.0f)
+                    continue;
+
+                float viewPosition[4];
+                ShadowFrustum::Transform( view, world, viewPosition );
+
+                const uint32_t tileX = min( config.tilesX - 1, static_cast<uint32_t>((x + 1.0f) * 0.5f * config.tilesX) );
+                const uint32_t tileY = min( config.tilesY - 1, static_cast<uint32_t>((1.0f - y) * 0.5f * config.tilesY) );
+
+                const LightClusters::Range& range = clusters.GetRanges()[clusters.GetClusterIndex( tileX, tileY, clusters.GetSlice( viewPosition[2] ) )];
+                const uint32_t* pBegin = clusters.GetIndices().data() + range.offset;
+                if (find( pBegin, pBegin + range.count, static_cast<uint32_t>(light) ) == pBegin + range.count)
+                    missed++;
+            }
+        }
+
+        return missed;
+    }
+}
+
+bool Benchmark::RunLightClusters( uint32_t maxLightCount, uint32_t iterations )
+{
+    float view[16];
+    float projection[16];
+    CreateCamera( view, projection );
+
+    LightClusters::Config config;
+
+    cout << "LightClusters: " << config.tilesX << "x" << config.tilesY << "x" << config.slices << " clusters, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = true;
+
+    const uint32_t hardwareThreads = max( 1u, thread::hardware_concurrency() );
+    for (uint32_t lightCount = 1024; lightCount <= maxLightCount; lightCount *= 4)
+    {
+        LightList lights;
+        CreateLights( lights, lightCount );
+
+        LightClusters reference( 1 );
+        reference.SetConfig( config );
+        reference.Build( view, projection, lights );
+
+        const LightClusters::Statistics& stats = reference.GetStatistics();
+        cout << "  " << lightCount << " lights: " << stats.visibleLights << " visible, " << stats.indices << " indices"
+             << ", " << setprecision( 2 ) << static_cast<double>(stats.indices) / reference.GetClusterCount() << " per cluster"
+             << ", max " << stats.maxClusterLights << setprecision( 3 ) << endl;
+
+        // No false negatives: every lit point finds its light in its cluster
+        if (lightCount == 1024)
+        {
+            const uint32_t missed = CountMissedLights( reference, view, projection, lights );
+            cout << "    coverage check        " << (missed == 0 ? "passed" : "FAILED") << " (" << missed << " missed samples)" << endl;
+            bSucceeded &= missed == 0;
+        }
+
+        for (uint32_t threadCount = 1; ; threadCount *= 2)
+        {
+            threadCount = min( threadCount, hardwareThreads );
+
+            LightClusters clusters( threadCount );
+            clusters.SetConfig( config );
+
+            const double time = Measure( "LightClusters/" + to_string( lightCount ) + " lights/" + to_string( threadCount ) + " threads",
+                                         clusters, view, projection, lights, iterations );
+
+            // The output must not depend on the thread count
+            const bool bMatched = IsEqual( clusters, reference );
+
+            cout << "    " << setw( 3 ) << threadCount << " thread(s) (" << clusters.GetStatistics().threads << " used) "
+                 << setw( 10 ) << time << " ms"
+                 << "  " << setw( 8 ) << setprecision( 1 ) << lightCount / time / 1000.0 << " M lights/s" << setprecision( 3 )
+                 << (bMatched ? "" : "  MISMATCH") << endl;
+
+            bSucceeded &= bMatched;
+
+            if (threadCount == hardwareThreads)
+                break;
+        }
+    }
+
+    return bSucceeded;
+}
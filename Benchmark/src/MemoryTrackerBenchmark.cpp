@@ -0,0 +1,152 @@
+#include "Benchmarks.h"
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const uint64_t KiB  = 1024;
+    const uint64_t PAGE = MockMemoryBackend::PAGE_SIZE;
+
+    // Two models, a shadow map and a descriptor heap on the mock; one model is unloaded again
+    bool CheckAccounting()
+    {
+        MockMemoryBackend backend;
+        backend.SetDeviceMemory( 1024 * 1024 * KiB, 300 * 1024 * KiB );
+
+        MemoryTracker tracker;
+        tracker.SetBackend( &backend );
+
+        int bunny = 0;
+        int floor = 0;
+        tracker.SetOwnerName( &bunny, "bunny.obj" );
+        tracker.SetOwnerName( &floor, "floor.obj" );
+
+        MemoryTracker::Handle bunnyVertices = tracker.Track( MemoryTracker::CATEGORY_GEOMETRY, MemoryResourceDesc::Buffer( 100000 ), &bunny );
+        MemoryTracker::Handle bunnyIndices  = tracker.Track( MemoryTracker::CATEGORY_GEOMETRY, MemoryResourceDesc::Buffer( 10000 ), &bunny );
+        MemoryTracker::Handle floorVertices = tracker.Track( MemoryTracker::CATEGORY_GEOMETRY, MemoryResourceDesc::Buffer( 4 * PAGE ), &floor );
+        MemoryTracker::Handle shadowMap     = tracker.Track( MemoryTracker::CATEGORY_SHADOW,
+                                                             MemoryResourceDesc::Texture2D( 4096, 4096, 4, MemoryResourceDesc::FLAG_DEPTH_STENCIL ) );
+        MemoryTracker::Handle descriptors   = tracker.Track( MemoryTracker::CATEGORY_DESCRIPTORS, MemoryResourceDesc::DescriptorHeap( 1000, 32 ) );
+
+        // Pages round buffers up, descriptor heaps are exact
+        const MemoryTracker::Usage geometry = tracker.GetUsage( MemoryTracker::CATEGORY_GEOMETRY );
+        bool bPassed = geometry.bytes == 7 * PAGE && geometry.requestedBytes == 110000 + 4 * PAGE && geometry.allocations == 3 &&
+                       tracker.GetUsage( MemoryTracker::CATEGORY_SHADOW ).bytes == 4096 * 4096 * 4 &&
+                       tracker.GetUsage( MemoryTracker::CATEGORY_DESCRIPTORS ).bytes == 32000 &&
+                       tracker.GetOwnerUsage( &bunny ).bytes == 3 * PAGE &&
+                       tracker.GetOwners().front().name == "unowned" && tracker.GetOwners()[1].name == "floor.obj";
+
+        // Unloading keeps the peaks
+        bunnyVertices.Release();
+        {
+            MemoryTracker::Handle moved( std::move( bunnyIndices ) );
+            bPassed &= !bunnyIndices.IsValid() && moved.IsValid();
+        }
+        tracker.RemoveOwner( &bunny );
+
+        const MemoryTracker::Statistics stats = tracker.GetStatistics();
+        bPassed &= stats.categories[MemoryTracker::CATEGORY_GEOMETRY].bytes == 4 * PAGE &&
+                   stats.categories[MemoryTracker::CATEGORY_GEOMETRY].peakBytes == 7 * PAGE &&
+                   stats.total.bytes == 4 * PAGE + 4096 * 4096 * 4 + 32000 &&
+                   stats.total.peakBytes == 7 * PAGE + 4096 * 4096 * 4 + 32000 &&
+                   stats.tracked == 5 && stats.released == 2 && tracker.GetOwnerUsage( &bunny ).bytes == 0;
+
+        ostringstream report;
+        tracker.WriteReport( report );
+        bPassed &= report.str().find( "geometry: 0.25 MiB" ) != string::npos && report.str().find( "device: 300.00 MiB" ) != string::npos;
+
+        cout << "  accounting check        " << (bPassed ? "passed" : "FAILED")
+             << " (" << stats.total.bytes << " bytes, peak " << stats.total.peakBytes << ")" << endl;
+
+        return bPassed;
+    }
+
+    // Warnings fire when a budget is crossed, not for every allocation over it
+    bool CheckBudgets()
+    {
+        MockMemoryBackend backend;
+
+        MemoryTracker tracker;
+        tracker.SetBackend( &backend );
+        tracker.SetBudget( MemoryTracker::CATEGORY_GEOMETRY, 4 * PAGE );
+        tracker.SetTotalBudget( 6 * PAGE );
+
+        vector<pair<MemoryTracker::CATEGORY, uint64_t> > warnings;
+        tracker.SetWarning( [&]( MemoryTracker::CATEGORY category, uint64_t bytes, uint64_t budget )
+        {
+            (void)budget;
+            warnings.push_back( make_pair( category, bytes ) );
+        } );
+
+        vector<MemoryTracker::Handle> handles;
+        for (int i = 0; i < 7; ++i)
+        {
+            handles.push_back( tracker.Track( MemoryTracker::CATEGORY_GEOMETRY, MemoryResourceDesc::Buffer( PAGE ) ) );
+        }
+
+        // Back under both budgets, then over the geometry budget once more
+        handles.resize( 3 );
+        handles.push_back( tracker.Track( MemoryTracker::CATEGORY_GEOMETRY, MemoryResourceDesc::Buffer( 2 * PAGE ) ) );
+        handles.clear();
+
+        const MemoryTracker::Statistics stats = tracker.GetStatistics();
+        const bool bPassed = warnings.size() == 3 &&
+                             warnings[0].first == MemoryTracker::CATEGORY_GEOMETRY && warnings[0].second == 5 * PAGE &&
+                             warnings[1].first == MemoryTracker::CATEGORY_NUM && warnings[1].second == 7 * PAGE &&
+                             warnings[2].first == MemoryTracker::CATEGORY_GEOMETRY && warnings[2].second == 5 * PAGE &&
+                             stats.budgetWarnings == 3 && stats.total.bytes == 0 && stats.total.allocations == 0;
+
+        cout << "  budget check            " << (bPassed ? "passed" : "FAILED") << " (" << warnings.size() << " warnings)" << endl;
+
+        return bPassed;
+    }
+}
+
+bool Benchmark::RunMemoryTracker( uint32_t allocationCount, uint32_t iterations )
+{
+    cout << "MemoryTracker: " << allocationCount << " allocations, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = CheckAccounting();
+    bSucceeded &= CheckBudgets();
+
+    // Tracking every allocation of a scene load, then releasing it, across a few owners
+    MockMemoryBackend backend;
+    MemoryTracker tracker;
+    tracker.SetBackend( &backend );
+
+    const uint32_t OWNER_COUNT = 64;
+    vector<int> owners( OWNER_COUNT );
+
+    vector<double> times;
+    vector<MemoryTracker::Handle> handles;
+    handles.reserve( allocationCount );
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        Benchmark::Timer timer;
+        for (uint32_t i = 0; i < allocationCount; ++i)
+        {
+            handles.push_back( tracker.Track( static_cast<MemoryTracker::CATEGORY>(i % MemoryTracker::CATEGORY_NUM),
+                                              MemoryResourceDesc::Buffer( 256 + i % 4096 ), &owners[i % OWNER_COUNT] ) );
+        }
+        handles.clear();
+        times.push_back( timer.GetMilliseconds() );
+    }
+
+    const MemoryTracker::Statistics stats = tracker.GetStatistics();
+    bSucceeded &= stats.total.bytes == 0 && stats.released == stats.tracked;
+
+    const double median = Benchmark::Record( "MemoryTracker/track and release", times, allocationCount );
+
+    cout << "  track and release       " << median << " ms, " << setprecision( 1 )
+         << median * 1000000.0 / max( 1u, allocationCount ) << " ns per allocation" << setprecision( 3 ) << endl;
+
+    return bSucceeded;
+}
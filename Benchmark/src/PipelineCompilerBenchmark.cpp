@@ -0,0 +1,240 @@
+#include "Benchmarks.h"
+#include "AllocationCounter.h"
+#include "PipelineCompiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Busy, as a driver compiling a pipeline is
+    void Spin( double milliseconds )
+    {
+        Benchmark::Timer timer;
+        while (timer.GetMilliseconds() < milliseconds)
+        {
+        }
+    }
+
+    // Publication at Update only, one compile per key, failures, clearing, the inline compiler and a
+    // destructor that does not wait for queued compiles
+    bool CheckCompiler()
+    {
+        bool bPassed = true;
+
+        const uint32_t KEY_COUNT = 16;
+
+        atomic<uint32_t> compiles( 0 );
+        auto compile = [&]() { Spin( 0.1 ); compiles++; return true; };
+
+        {
+            PipelineCompiler compiler( 4 );
+
+            for (uint64_t key = 0; key < KEY_COUNT; ++key)
+            {
+                bPassed &= compiler.Request( key, compile ) == PipelineCompiler::STATE_COMPILING;
+            }
+            bPassed &= compiler.Request( 0, compile ) == PipelineCompiler::STATE_COMPILING;
+            bPassed &= compiler.Request( KEY_COUNT, []() { return false; } ) == PipelineCompiler::STATE_COMPILING;
+            bPassed &= compiler.GetPendingCount() == KEY_COUNT + 1;
+
+            // Finished, but not visible before the frame boundary
+            compiler.Wait();
+            bPassed &= compiles == KEY_COUNT && compiler.GetState( 1 ) == PipelineCompiler::STATE_COMPILING;
+
+            vector<uint64_t> keys;
+            bPassed &= compiler.Update( &keys ) == KEY_COUNT + 1 && keys.size() == KEY_COUNT + 1;
+            bPassed &= compiler.GetPendingCount() == 0;
+            bPassed &= compiler.GetState( 1 ) == PipelineCompiler::STATE_READY;
+            bPassed &= compiler.GetState( KEY_COUNT ) == PipelineCompiler::STATE_FAILED;
+            bPassed &= compiler.GetState( KEY_COUNT + 1 ) == PipelineCompiler::STATE_UNKNOWN;
+            bPassed &= compiler.Update() == 0;
+
+            // Known keys are not compiled again, failed ones included
+            bPassed &= compiler.Request( 1, compile ) == PipelineCompiler::STATE_READY;
+            bPassed &= compiler.Request( KEY_COUNT, compile ) == PipelineCompiler::STATE_FAILED;
+
+            const PipelineCompiler::Statistics& stats = compiler.GetStatistics();
+            bPassed &= stats.requests == KEY_COUNT + 1 && stats.published == KEY_COUNT + 1 && stats.failures == 1;
+            bPassed &= stats.maxLatencyFrames == 1 && stats.compileMilliseconds >= KEY_COUNT * 0.1;
+
+            compiler.Clear();
+            bPassed &= compiler.GetState( 1 ) == PipelineCompiler::STATE_UNKNOWN;
+            bPassed &= compiler.Request( 1, compile ) == PipelineCompiler::STATE_COMPILING;
+            compiler.Wait();
+            bPassed &= compiler.Update() == 1 && compiles == KEY_COUNT + 1;
+        }
+
+        // Without threads the request pays for the compile, which is still published by the next Update
+        {
+            PipelineCompiler compiler( 0 );
+
+            compiles = 0;
+            bPassed &= compiler.Request( 7, compile ) == PipelineCompiler::STATE_COMPILING && compiles == 1;
+            bPassed &= compiler.GetState( 7 ) == PipelineCompiler::STATE_COMPILING;
+            bPassed &= compiler.Update() == 1 && compiler.GetState( 7 ) == PipelineCompiler::STATE_READY;
+        }
+
+        // Queued compiles are dropped at destruction
+        compiles = 0;
+        {
+            PipelineCompiler compiler( 1 );
+            auto slow = [&]() { Spin( 1.0 ); compiles++; return true; };
+            for (uint64_t key = 0; key < 100; ++key)
+            {
+                compiler.Request( key, slow );
+            }
+        }
+        bPassed &= compiles < 100;
+
+        cout << "  compiler check          " << (bPassed ? "passed" : "FAILED") << " (" << compiles << " of 100 queued compiles ran before destruction)" << endl;
+
+        return bPassed;
+    }
+
+    struct FrameResult
+    {
+        FrameResult()
+            : firstFrameMilliseconds( 0.0 )
+            , maxFrameMilliseconds( 0.0 )
+            , fallbackFrames( 0 )
+            , frames( 0 )
+            , fallbackDraws( 0 )
+        {
+        }
+
+        double   firstFrameMilliseconds;
+        double   maxFrameMilliseconds;  // main thread time in Request and Update
+        uint32_t fallbackFrames;        // frames with a draw whose pipeline was not ready
+        uint32_t frames;                // until every pipeline was ready
+        uint64_t fallbackDraws;
+    };
+
+    // A viewer loading a scene: every frame asks for the pipeline of each draw and uses a fallback for those
+    // not ready, until all of them are
+    FrameResult RunFrames( PipelineCompiler& compiler, uint32_t pipelineCount, uint32_t drawCount, double compileMilliseconds, double frameMilliseconds )
+    {
+        auto compile = [=]() { Spin( compileMilliseconds ); return true; };
+
+        FrameResult result;
+        for (;;)
+        {
+            Benchmark::Timer timer;
+
+            compiler.Update();
+
+            bool bFallback = false;
+            for (uint32_t draw = 0; draw < drawCount; ++draw)
+            {
+                if (compiler.Request( draw % pipelineCount, compile ) != PipelineCompiler::STATE_READY)
+                {
+                    bFallback = true;
+                    result.fallbackDraws++;
+                }
+            }
+
+            const double milliseconds = timer.GetMilliseconds();
+            if (result.frames == 0)
+                result.firstFrameMilliseconds = milliseconds;
+            result.maxFrameMilliseconds = max( result.maxFrameMilliseconds, milliseconds );
+
+            result.frames++;
+            if (!bFallback)
+                break;
+
+            result.fallbackFrames++;
+
+            // The rest of the frame, which the compile threads run alongside
+            Spin( frameMilliseconds );
+        }
+
+        return result;
+    }
+
+    // Frames once every pipeline is ready must not touch the heap
+    bool CheckSteadyState( PipelineCompiler& compiler, uint32_t pipelineCount, uint32_t drawCount )
+    {
+        auto compile = []() { return true; };
+
+        const AllocationCounter::Scope allocations;
+
+        bool bPassed = true;
+        for (uint32_t frame = 0; frame < 16; ++frame)
+        {
+            compiler.Update();
+            for (uint32_t draw = 0; draw < drawCount; ++draw)
+            {
+                bPassed &= compiler.Request( draw % pipelineCount, compile ) == PipelineCompiler::STATE_READY;
+            }
+        }
+
+        bPassed &= allocations.GetCount() == 0;
+
+        cout << "  steady state check      " << (bPassed ? "passed" : "FAILED") << " (" << allocations.GetCount() << " allocations in 16 frames"
+             << (AllocationCounter::IsEnabled() ? "" : ", counter compiled out") << ")" << endl;
+
+        return bPassed;
+    }
+}
+
+bool Benchmark::RunPipelineCompiler( uint32_t pipelineCount, uint32_t iterations )
+{
+    // Draws per pipeline, and the cost of a driver compile and of the rest of a frame, kept small to run quickly
+    const uint32_t DRAWS_PER_PIPELINE  = 16;
+    const double   COMPILE_MILLISECONDS = 2.0;
+    const double   FRAME_MILLISECONDS   = 4.0;
+
+    pipelineCount = max( 1u, pipelineCount );
+    const uint32_t drawCount = pipelineCount * DRAWS_PER_PIPELINE;
+
+    cout << "PipelineCompiler: " << pipelineCount << " pipelines of " << COMPILE_MILLISECONDS << " ms, " << drawCount << " draws, "
+         << PipelineCompiler::DEFAULT_THREADS << " threads, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = CheckCompiler();
+
+    vector<double> blockingTimes, firstFrameTimes, maxFrameTimes, steadyTimes;
+    FrameResult    asynchronous;
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        // Creating every pipeline inside the first frame, as the passes did
+        PipelineCompiler blocking( 0 );
+        const FrameResult blocked = RunFrames( blocking, pipelineCount, drawCount, COMPILE_MILLISECONDS, FRAME_MILLISECONDS );
+        blockingTimes.push_back( blocked.firstFrameMilliseconds );
+
+        // The same scene with fallbacks while the pipelines are created in the background
+        PipelineCompiler compiler;
+        asynchronous = RunFrames( compiler, pipelineCount, drawCount, COMPILE_MILLISECONDS, FRAME_MILLISECONDS );
+        firstFrameTimes.push_back( asynchronous.firstFrameMilliseconds );
+        maxFrameTimes.push_back( asynchronous.maxFrameMilliseconds );
+
+        bSucceeded &= compiler.GetPendingCount() == 0 && compiler.GetStatistics().published == pipelineCount;
+
+        // Every frame once all pipelines are ready
+        Benchmark::Timer steadyTimer;
+        RunFrames( compiler, pipelineCount, drawCount, COMPILE_MILLISECONDS, FRAME_MILLISECONDS );
+        steadyTimes.push_back( steadyTimer.GetMilliseconds() );
+
+        if (n + 1 == iterations)
+            bSucceeded &= CheckSteadyState( compiler, pipelineCount, drawCount );
+    }
+
+    const double blocking   = Benchmark::Record( "PipelineCompiler/blocking first frame", blockingTimes, pipelineCount );
+    const double firstFrame = Benchmark::Record( "PipelineCompiler/background first frame", firstFrameTimes, pipelineCount );
+    const double maxFrame   = Benchmark::Record( "PipelineCompiler/background longest frame", maxFrameTimes, pipelineCount );
+    const double steady     = Benchmark::Record( "PipelineCompiler/ready frame", steadyTimes, drawCount );
+
+    cout << "  blocking first frame    " << setw( 9 ) << blocking << " ms" << endl;
+    cout << "  background first frame  " << setw( 9 ) << firstFrame << " ms, longest " << maxFrame << " ms"
+         << ", stall removed " << blocking - maxFrame << " ms" << endl;
+    cout << "  fallbacks               " << asynchronous.fallbackFrames << " frames, " << asynchronous.fallbackDraws << " draws"
+         << ", every pipeline ready in frame " << asynchronous.frames << endl;
+    cout << "  ready frame             " << setw( 9 ) << steady << " ms (" << steady * 1000000.0 / drawCount << " ns per draw)" << endl;
+
+    return bSucceeded;
+}
@@ -0,0 +1,166 @@
+#include "Benchmarks.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    volatile uint32_t g_sink = 0;
+
+    // A few nanoseconds of work, so the loop is not optimized away
+    inline void Work( uint32_t i )
+    {
+        g_sink = g_sink + i;
+    }
+
+    double Measure( const char* name, uint32_t iterations, uint32_t calls, bool bScoped )
+    {
+        vector<double> times;
+        for (uint32_t n = 0; n < iterations; ++n)
+        {
+            Benchmark::Timer timer;
+            if (bScoped)
+            {
+                for (uint32_t i = 0; i < calls; ++i)
+                {
+                    PROFILE_SCOPE( "Work" );
+                    Work( i );
+                }
+            }
+            else
+            {
+                for (uint32_t i = 0; i < calls; ++i)
+                {
+                    Work( i );
+                }
+            }
+            times.push_back( timer.GetMilliseconds() );
+        }
+
+        return Benchmark::Record( name, times, calls );
+    }
+
+    // Two frames of nested zones on the main thread and two workers, then the summary and the trace
+    bool CheckZones()
+    {
+        Profiler::Reset();
+        Profiler::SetEnabled( true );
+
+        for (int frame = 0; frame < 2; ++frame)
+        {
+            Profiler::BeginFrame();
+            {
+                PROFILE_SCOPE( "Frame" );
+                for (int i = 0; i < 3; ++i)
+                {
+                    PROFILE_SCOPE( "Pass" );
+                    Work( i );
+                }
+
+                vector<thread> workers;
+                for (int i = 0; i < 2; ++i)
+                {
+                    workers.push_back( thread( []()
+                    {
+                        PROFILE_SCOPE( "Worker" );
+                        PROFILE_SCOPE( "Job" );
+                        Work( 1 );
+                    } ) );
+                }
+                for (auto& worker : workers)
+                {
+                    worker.join();
+                }
+            }
+            Profiler::EndFrame();
+        }
+
+        Profiler::SetEnabled( false );
+
+        const Profiler::Summary& summary = Profiler::GetSummary();
+        auto find = [&]( const char* name ) -> const Profiler::ZoneStatistics*
+        {
+            for (const Profiler::ZoneStatistics& zone : summary.zones)
+            {
+                if (string( zone.name ) == name)
+                    return &zone;
+            }
+            return nullptr;
+        };
+
+        const Profiler::ZoneStatistics* pFrame = find( "Frame" );
+        const Profiler::ZoneStatistics* pPass  = find( "Pass" );
+        const Profiler::ZoneStatistics* pJob   = find( "Job" );
+        const bool bSummary = summary.frames == 2 && summary.zones.size() == 4 &&
+                              pFrame != nullptr && pFrame->calls == 1 && pFrame->depth == 0 &&
+                              pPass != nullptr && pPass->calls == 3 && pPass->depth == 1 &&
+                              pJob != nullptr && pJob->calls == 2 && pJob->depth == 1 &&
+                              pFrame->lastMilliseconds >= pPass->lastMilliseconds;
+
+        // Every zone of both frames as a complete event
+        const string path = "profiler_benchmark_trace.json";
+        bool bTrace = Profiler::WriteChromeTrace( path );
+        if (bTrace)
+        {
+            ifstream stream( path.c_str() );
+            stringstream text;
+            text << stream.rdbuf();
+
+            const string content = text.str();
+            size_t events = 0;
+            for (size_t pos = content.find( "\"ph\":\"X\"" ); pos != string::npos; pos = content.find( "\"ph\":\"X\"", pos + 1 ))
+            {
+                events++;
+            }
+            bTrace = events == 2 * (1 + 3 + 2 * 2) && content.find( "\"traceEvents\"" ) != string::npos;
+            stream.close();
+            remove( path.c_str() );
+        }
+
+        cout << "  zone check              " << (bSummary ? "passed" : "FAILED") << " (" << summary.zones.size() << " zones)" << endl;
+        cout << "  trace check             " << (bTrace ? "passed" : "FAILED") << endl;
+
+        Profiler::Reset();
+
+        return bSummary && bTrace;
+    }
+}
+
+bool Benchmark::RunProfiler( uint32_t scopeCount, uint32_t iterations )
+{
+    cout << "Profiler: " << scopeCount << " scopes, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = CheckZones();
+
+    const double baseline = Measure( "Profiler/no scope", iterations, scopeCount, false );
+
+    Profiler::SetEnabled( false );
+    const double disabled = Measure( "Profiler/disabled", iterations, scopeCount, true );
+
+    Profiler::SetEnabled( true );
+    const double enabled = Measure( "Profiler/enabled", iterations, scopeCount, true );
+    Profiler::SetEnabled( false );
+    Profiler::Reset();
+
+    auto output = [&]( const char* name, double time )
+    {
+        cout << "    " << setw( 10 ) << name << setw( 10 ) << time << " ms"
+             << "  " << setw( 8 ) << setprecision( 2 ) << max( 0.0, time - baseline ) * 1000000.0 / scopeCount << " ns per scope" << setprecision( 3 ) << endl;
+    };
+
+    output( "no scope", baseline );
+    output( "disabled", disabled );
+    output( "enabled", enabled );
+
+    return bSucceeded;
+}
@@ -0,0 +1,128 @@
+#include "RecordingSink.h"
+
+namespace
+{
+    uint64_t GetAddress( const void* pObject )
+    {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pObject));
+    }
+}
+
+void RecordingSink::Add( COMMAND type, uint32_t parameter, uint64_t value )
+{
+    const Command command = { type, parameter, value };
+    m_commands.push_back( command );
+}
+
+void RecordingSink::SetRootSignature( const DrawRecorder::Packet& packet )
+{
+    Add( COMMAND_SET_ROOT_SIGNATURE, 0, GetAddress( packet.pRootSignature ) );
+}
+
+void RecordingSink::SetConstantBuffer( uint32_t parameter, uint64_t address )
+{
+    Add( COMMAND_SET_CONSTANT_BUFFER, parameter, address );
+}
+
+void RecordingSink::SetShaderResource( uint32_t parameter, uint64_t address )
+{
+    Add( COMMAND_SET_SHADER_RESOURCE, parameter, address );
+}
+
+void RecordingSink::SetDescriptorHeap()
+{
+    Add( COMMAND_SET_DESCRIPTOR_HEAP, 0, 0 );
+}
+
+void RecordingSink::SetDescriptorTable( uint32_t parameter, uint32_t descriptorIndex )
+{
+    Add( COMMAND_SET_DESCRIPTOR_TABLE, parameter, descriptorIndex );
+}
+
+void RecordingSink::SetPipelineState( const DrawRecorder::Packet& packet )
+{
+    Add( COMMAND_SET_PIPELINE_STATE, 0, GetAddress( packet.pPipelineState ) );
+}
+
+void RecordingSink::Draw( const DrawRecorder::Packet& packet )
+{
+    Add( COMMAND_DRAW, packet.indexCount, GetAddress( &packet ) );
+}
+
+bool RecordingSink::Verify( const DrawRecorder& recorder ) const
+{
+    // Root arguments by parameter: the CBVs, then the SRVs, then the table
+    const uint32_t MAX_PARAMETERS = DrawRecorder::MAX_CONSTANT_BUFFERS + DrawRecorder::MAX_SHADER_RESOURCES + 1;
+
+    const uint64_t UNSET = UINT64_MAX;
+
+    uint64_t rootSignature = UNSET;
+    uint64_t pipelineState = UNSET;
+    uint64_t arguments[MAX_PARAMETERS];
+    bool     bHeapBound    = false;
+    for (auto& argument : arguments)
+    {
+        argument = UNSET;
+    }
+
+    const DrawRecorder::Packet* pPackets = recorder.GetPackets();
+    const DrawSort::Item*       pItems   = recorder.GetItems();
+    const uint32_t              count    = recorder.GetCount();
+
+    uint32_t draw = 0;
+    for (const Command& command : m_commands)
+    {
+        switch (command.type)
+        {
+        case COMMAND_SET_ROOT_SIGNATURE:
+            rootSignature = command.value;
+            for (auto& argument : arguments)
+            {
+                argument = UNSET;
+            }
+            break;
+        case COMMAND_SET_CONSTANT_BUFFER:
+        case COMMAND_SET_SHADER_RESOURCE:
+        case COMMAND_SET_DESCRIPTOR_TABLE:
+            if (command.parameter >= MAX_PARAMETERS || (command.type == COMMAND_SET_DESCRIPTOR_TABLE && !bHeapBound))
+                return false;
+            arguments[command.parameter] = command.value;
+            break;
+        case COMMAND_SET_DESCRIPTOR_HEAP:
+            bHeapBound = true;
+            break;
+        case COMMAND_SET_PIPELINE_STATE:
+            pipelineState = command.value;
+            break;
+        case COMMAND_DRAW:
+        {
+            if (draw >= count)
+                return false;
+
+            const DrawRecorder::Packet& packet = pPackets[pItems[draw++].index];
+            if (command.value != GetAddress( &packet ) || command.parameter != packet.indexCount ||
+                rootSignature != GetAddress( packet.pRootSignature ) || pipelineState != GetAddress( packet.pPipelineState ))
+                return false;
+
+            for (uint32_t i = 0; i < packet.constantBufferCount; ++i)
+            {
+                if (arguments[i] != packet.constantBuffers[i])
+                    return false;
+            }
+
+            for (uint32_t i = 0; i < packet.shaderResourceCount; ++i)
+            {
+                if (arguments[packet.constantBufferCount + i] != packet.shaderResources[i])
+                    return false;
+            }
+
+            const uint32_t table = packet.constantBufferCount + packet.shaderResourceCount;
+            if (packet.descriptorIndex != DescriptorAllocator::INVALID_INDEX && arguments[table] != packet.descriptorIndex)
+                return false;
+            break;
+        }
+        }
+    }
+
+    return draw == count && DrawSort::IsSorted( pItems, count );
+}
@@ -0,0 +1,124 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+    vector<Benchmark::Result>& GetResultList()
+    {
+        static vector<Benchmark::Result> results;
+        return results;
+    }
+
+    // Names are plain ASCII, but quotes, backslashes and control characters must not break the file
+    string Escape( const string& text )
+    {
+        string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char code[8];
+                snprintf( code, sizeof( code ), "\\u%04x", c );
+                escaped += code;
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+}
+
+double Benchmark::Record( const string& name, const vector<double>& times, uint64_t items )
+{
+    vector<double> sorted( times );
+    sort( sorted.begin(), sorted.end() );
+
+    Result result;
+    result.name        = name;
+    result.items       = items;
+    result.repetitions = static_cast<uint32_t>(sorted.size());
+    result.min         = sorted.front();
+    result.max         = sorted.back();
+
+    // Median is less sensitive to the first, cold iteration
+    const size_t middle = sorted.size() / 2;
+    result.median = sorted.size() % 2 != 0 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) * 0.5;
+
+    double sum = 0.0;
+    for (double time : sorted)
+    {
+        sum += time;
+    }
+    result.mean = sum / sorted.size();
+
+    // Sample standard deviation; a single repetition has none
+    double squares = 0.0;
+    for (double time : sorted)
+    {
+        squares += (time - result.mean) * (time - result.mean);
+    }
+    result.stddev = sorted.size() > 1 ? sqrt( squares / (sorted.size() - 1) ) : 0.0;
+
+    GetResultList().push_back( result );
+
+    return result.median;
+}
+
+const vector<Benchmark::Result>& Benchmark::GetResults()
+{
+    return GetResultList();
+}
+
+bool Benchmark::WriteResults( const string& path )
+{
+    ofstream file( path.c_str() );
+    if (!file)
+    {
+        cerr << "Failed to open " << path << endl;
+        return false;
+    }
+
+    const time_t now = time( nullptr );
+    char date[32] = {};
+    strftime( date, sizeof( date ), "%Y-%m-%dT%H:%M:%SZ", gmtime( &now ) );
+
+    file << "{" << endl
+         << "  \"date\": \"" << date << "\"," << endl
+         << "  \"threads\": " << thread::hardware_concurrency() << "," << endl
+         << "  \"unit\": \"ms\"," << endl
+         << "  \"results\": [";
+
+    file << setprecision( 9 );
+
+    const vector<Result>& results = GetResultList();
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result& result = results[i];
+        file << (i == 0 ? "" : ",") << endl
+             << "    { \"name\": \"" << Escape( result.name ) << "\", \"items\": " << result.items
+             << ", \"repetitions\": " << result.repetitions
+             << ", \"median\": " << result.median << ", \"mean\": " << result.mean << ", \"stddev\": " << result.stddev
+             << ", \"min\": " << result.min << ", \"max\": " << result.max << " }";
+    }
+
+    file << endl << "  ]" << endl << "}" << endl;
+
+    return file.good();
+}
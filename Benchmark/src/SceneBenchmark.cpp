@@ -0,0 +1,542 @@
+#include "Benchmarks.h"
+#include "BatchMath.h"
+#include "AllocationCounter.h"
+#include "DrawRecorder.h"
+#include "FrameArena.h"
+#include "ObjMesh.h"
+#include "OrbitCamera.h"
+#include "RecordingSink.h"
+#include "ScenePackets.h"
+#include "SceneGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Loading a model with the viewer's ObjMesh as Model::BindAsset does, moving the viewer's OrbitCamera as
+// App::ProcessInput does, then updating and recording a frame of a generated scene: the node hierarchy walked as
+// the viewer's scene and as flat arrays, then culling and the viewer's DrawRecorder sorting and recording into a
+// RecordingSink
+namespace
+{
+    const float PI = 3.14159265f;
+
+    // Sphere with positions, normals and texture coordinates, as the viewer's sample models are exported
+    string CreateSphereObj( uint32_t segments )
+    {
+        ostringstream obj;
+        obj << fixed << setprecision( 6 );
+        for (uint32_t i = 0; i <= segments; ++i)
+        {
+            for (uint32_t j = 0; j <= segments; ++j)
+            {
+                const float theta = PI * i / segments;
+                const float phi   = 2.0f * PI * j / segments;
+                const float n[3]  = { sinf( theta ) * cosf( phi ), cosf( theta ), sinf( theta ) * sinf( phi ) };
+                obj << "v " << n[0] << " " << n[1] << " " << n[2] << "\n"
+                    << "vn " << n[0] << " " << n[1] << " " << n[2] << "\n"
+                    << "vt " << static_cast<float>(j) / segments << " " << static_cast<float>(i) / segments << "\n";
+            }
+        }
+
+        for (uint32_t i = 0; i < segments; ++i)
+        {
+            for (uint32_t j = 0; j < segments; ++j)
+            {
+                const uint32_t a = i * (segments + 1) + j + 1;
+                const uint32_t b = a + segments + 1;
+                obj << "f " << a << "/" << a << "/" << a << " " << a + 1 << "/" << a + 1 << "/" << a + 1 << " "
+                    << b + 1 << "/" << b + 1 << "/" << b + 1 << " " << b << "/" << b << "/" << b << "\n";
+            }
+        }
+
+        return obj.str();
+    }
+
+    // Model::CreateVertexBuffer and CreateIndexBuffer: the CPU copies, then the copy GeometryHeap::Upload makes
+    void CreateBuffers( const ObjMesh& mesh, vector<ObjMesh::Vertex>& vertices, vector<uint16_t>& indices, vector<uint8_t>& uploadBuffer )
+    {
+        vertices.resize( mesh.GetVertexCount() );
+        if (!vertices.empty())
+            mesh.CreateVertices( vertices.data() );
+
+        indices.resize( mesh.GetIndexCount() );
+        if (!indices.empty())
+            mesh.CreateIndices( indices.data() );
+
+        const size_t vertexSize = vertices.size() * sizeof( ObjMesh::Vertex );
+        const size_t indexSize  = indices.size() * sizeof( uint16_t );
+        uploadBuffer.resize( vertexSize + indexSize );
+        if (vertexSize > 0)
+            memcpy( uploadBuffer.data(), vertices.data(), vertexSize );
+        if (indexSize > 0)
+            memcpy( uploadBuffer.data() + vertexSize, indices.data(), indexSize );
+    }
+
+    float Distance( const float a[3], const float b[3] )
+    {
+        const float d[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+        return sqrtf( d[0] * d[0] + d[1] * d[1] + d[2] * d[2] );
+    }
+
+    bool IsNear( float value, float expected, float tolerance )
+    {
+        return fabsf( value - expected ) <= tolerance;
+    }
+
+    // Node with its children by shared pointer, walked as Scene walks its root node
+    struct SceneNode
+    {
+        float local[16];
+        float world[16];
+
+        vector<shared_ptr<SceneNode> > children;
+    };
+
+    // Parents before children, so one pass over the arrays resolves every world matrix
+    struct FlatHierarchy
+    {
+        vector<uint32_t> parents;
+        vector<float>    locals;
+        vector<float>    worlds;
+    };
+
+    // Nodes of a generated scene under one root with the identity, as the viewer's scene root
+    void CreateHierarchy( const GeneratedScene& scene, SceneNode& root, vector<shared_ptr<SceneNode> >& nodes, FlatHierarchy& flat )
+    {
+        const size_t nodeCount = scene.nodes.size();
+
+        const float identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f };
+        copy( identity, identity + 16, root.local );
+        root.children.clear();
+
+        nodes.resize( nodeCount );
+        flat.parents.resize( nodeCount );
+        flat.locals.resize( nodeCount * 16 );
+        flat.worlds.resize( nodeCount * 16 );
+
+        for (size_t i = 0; i < nodeCount; ++i)
+        {
+            const GeneratedScene::Node& node = scene.nodes[i];
+
+            nodes[i] = make_shared<SceneNode>();
+            copy( node.local, node.local + 16, nodes[i]->local );
+            copy( node.local, node.local + 16, &flat.locals[i * 16] );
+
+            flat.parents[i] = node.parent;
+            if (node.parent == GeneratedScene::NO_PARENT)
+                root.children.push_back( nodes[i] );
+            else
+                nodes[node.parent]->children.push_back( nodes[i] );
+        }
+    }
+
+    void UpdateWorld( SceneNode& node, const float parentWorld[16] )
+    {
+        BatchMath::Multiply( parentWorld, node.local, node.world );
+        for (const auto& pChild : node.children)
+        {
+            UpdateWorld( *pChild, node.world );
+        }
+    }
+
+    // Roots are multiplied by the identity too, so the results match the tree's bit for bit
+    void UpdateWorld( FlatHierarchy& flat, const float rootWorld[16] )
+    {
+        for (size_t i = 0; i < flat.parents.size(); ++i)
+        {
+            const float* pParentWorld = flat.parents[i] == GeneratedScene::NO_PARENT ? rootWorld : &flat.worlds[flat.parents[i] * 16];
+            BatchMath::Multiply( pParentWorld, &flat.locals[i * 16], &flat.worlds[i * 16] );
+        }
+    }
+
+    const float    DEPTH_RANGE      = 200.0f;
+    const uint32_t SORT_PASS_OPAQUE = 1;    // RenderPass::SORT_PASS_OPAQUE
+
+    // RenderPass::GatherDrawPackets for the mesh nodes that passed culling, with the world bounds CullNodes left,
+    // packets in the frame arena
+    uint32_t GatherPackets( const ScenePackets& scenePackets, const vector<uint8_t>& visible, size_t visibleCount, const vector<float>& boxes,
+                            FrameArena& arena, DrawRecorder::Packet*& pPackets )
+    {
+        const size_t count = visible.size();
+
+        uint32_t packetCount = 0;
+        pPackets = arena.Allocate<DrawRecorder::Packet>( visibleCount );
+        for (uint32_t i = 0; i < count && packetCount < visibleCount; ++i)
+        {
+            if (visible[i] == 0)
+                continue;
+
+            const float boundsMin[3] = { boxes[i], boxes[count + i], boxes[count * 2 + i] };
+            const float boundsMax[3] = { boxes[count * 3 + i], boxes[count * 4 + i], boxes[count * 5 + i] };
+            if (scenePackets.Create( i, boundsMin, boundsMax, pPackets[packetCount] ))
+                packetCount++;
+        }
+
+        return packetCount;
+    }
+
+    // World bounds of every node's mesh, which fits in [-1, 1], then the frustum test of the camera
+    size_t CullNodes( const vector<float>& worlds, const float planes[24], vector<float>& boxes, vector<uint8_t>& visible )
+    {
+        const size_t count = worlds.size() / 16;
+        boxes.resize( count * 6 );
+        visible.resize( count );
+
+        float* pMin[3] = { &boxes[0], &boxes[count], &boxes[count * 2] };
+        float* pMax[3] = { &boxes[count * 3], &boxes[count * 4], &boxes[count * 5] };
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float* m = &worlds[i * 16];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const float extent = fabsf( m[axis] ) + fabsf( m[4 + axis] ) + fabsf( m[8 + axis] );
+                pMin[axis][i] = m[12 + axis] - extent;
+                pMax[axis][i] = m[12 + axis] + extent;
+            }
+        }
+
+        const BatchMath::ConstBoxes constBoxes = { { pMin[0], pMin[1], pMin[2] }, { pMax[0], pMax[1], pMax[2] } };
+        return BatchMath::TestBoxes( planes, 6, constBoxes, count, visible.data() );
+    }
+
+    // 16:9 perspective at the origin looking down +z
+    void CreateFrustumPlanes( float planes[24] )
+    {
+        const float nearZ  = 0.5f;
+        const float farZ   = DEPTH_RANGE;
+        const float scaleY = 1.0f / tanf( 0.5f * 1.0472f );
+
+        float projection[16] = {};
+        projection[0]  = scaleY / (16.0f / 9.0f);
+        projection[5]  = scaleY;
+        projection[10] = farZ / (farZ - nearZ);
+        projection[11] = 1.0f;
+        projection[14] = -nearZ * farZ / (farZ - nearZ);
+
+        BatchMath::GetFrustumPlanes( projection, planes );
+    }
+
+    void Output( const char* name, double milliseconds, uint64_t items, const char* unit )
+    {
+        cout << "  " << left << setw( 24 ) << name << right << setw( 10 ) << milliseconds << " ms"
+             << "  " << setw( 8 ) << setprecision( 1 ) << items / max( milliseconds, 1e-6 ) / 1000.0 << " M " << unit << "/s"
+             << setprecision( 3 ) << endl;
+    }
+}
+
+bool Benchmark::RunScene( const SceneOptions& options )
+{
+    const uint32_t iterations = max( 1u, options.iterations );
+    const uint32_t nodeCount  = max( 1u, options.nodeCount );
+
+    string objText;
+    if (options.objPath.empty())
+    {
+        objText = CreateSphereObj( 200 );
+    }
+    else
+    {
+        // Read once; the parse is timed, the disk is not
+        ifstream file( options.objPath.c_str(), ios::binary );
+        if (!file)
+        {
+            cerr << "Failed to open " << options.objPath << endl;
+            return false;
+        }
+        ostringstream stream;
+        stream << file.rdbuf();
+        objText = stream.str();
+    }
+
+    cout << "Scene: " << (options.objPath.empty() ? string( "sphere of 200 segments" ) : options.objPath) << ", "
+         << nodeCount << " nodes, " << options.cameraUpdates << " camera updates, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = true;
+
+    // Model::BindAsset: the viewer's parse, its buffer contents and its bounds
+    ObjMesh                 mesh;
+    vector<ObjMesh::Vertex> vertices;
+    vector<uint16_t>        indices;
+    vector<uint8_t>         uploadBuffer;
+    float                   lo[3] = {};
+    float                   hi[3] = {};
+
+    vector<double> parseTimes, bufferTimes, boxTimes;
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        Benchmark::Timer parseTimer;
+        mesh.Parse( objText );
+        parseTimes.push_back( parseTimer.GetMilliseconds() );
+
+        Benchmark::Timer bufferTimer;
+        CreateBuffers( mesh, vertices, indices, uploadBuffer );
+        bufferTimes.push_back( bufferTimer.GetMilliseconds() );
+
+        Benchmark::Timer boxTimer;
+        mesh.GetBounds( lo, hi );
+        boxTimes.push_back( boxTimer.GetMilliseconds() );
+    }
+
+    const uint64_t vertexCount = mesh.GetVertexCount();
+    Output( "obj parse", Benchmark::Record( "Scene/obj parse", parseTimes, vertexCount ), vertexCount, "vertices" );
+    Output( "vertex and index buffers", Benchmark::Record( "Scene/vertex and index buffers", bufferTimes, vertexCount ), vertexCount, "vertices" );
+    Output( "bounding box", Benchmark::Record( "Scene/bounding box", boxTimes, vertexCount ), vertexCount, "vertices" );
+
+    {
+        // Corners of the three face forms, negative indices and a quad split into a fan, on a line ending in CRLF
+        ObjMesh forms;
+        forms.Parse( "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvt 0.25 0.75\nvn 0 0 -1\n"
+                     "f 1/1/1 2//1 3/1\r\nf -4 -2 -1\n# f 1 2 3\n" );
+
+        vector<ObjMesh::Vertex> formVertices( forms.GetVertexCount() );
+        vector<uint16_t>        formIndices( forms.GetIndexCount() );
+        forms.CreateVertices( formVertices.data() );
+        forms.CreateIndices( formIndices.data() );
+
+        const uint16_t expected[] = { 0, 1, 2, 0, 2, 3 };
+        bool bPassed = formVertices.size() == 4 && formIndices.size() == 6 &&
+                       equal( formIndices.begin(), formIndices.end(), expected ) &&
+                       formVertices[0].texCoord[1] == 0.75f && formVertices[0].normal[2] == -1.0f &&
+                       formVertices[1].normal[2] == -1.0f && formVertices[1].texCoord[0] == 0.0f &&
+                       formVertices[2].texCoord[0] == 0.25f && formVertices[2].normal[2] == 0.0f;
+
+        if (options.objPath.empty())
+        {
+            // Poles repeat per segment, so every vertex is referenced and the box is the unit sphere's
+            bPassed &= vertexCount == 201 * 201 && indices.size() == 200 * 200 * 6 &&
+                       uploadBuffer.size() == vertexCount * sizeof( ObjMesh::Vertex ) + indices.size() * sizeof( uint16_t ) &&
+                       memcmp( uploadBuffer.data(), vertices.data(), vertexCount * sizeof( ObjMesh::Vertex ) ) == 0;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                bPassed &= IsNear( lo[axis], -1.0f, 1e-3f ) && IsNear( hi[axis], 1.0f, 1e-3f );
+            }
+            bPassed &= IsNear( vertices[201 * 100 + 50].normal[0], vertices[201 * 100 + 50].position[0], 1e-6f ) &&
+                       IsNear( vertices[201 * 100 + 50].texCoord[0], 0.25f, 1e-6f );
+        }
+
+        cout << "  load check              " << (bPassed ? "passed" : "FAILED")
+             << " (" << vertexCount << " vertices, " << indices.size() / 3 << " triangles)" << endl;
+        bSucceeded &= bPassed;
+    }
+
+    // A generated scene of nodeCount objects, walked through shared pointers as the scene does and as one pass
+    // over flat arrays
+    SceneGenerator::Config config;
+    config.objectCount    = nodeCount;
+    config.hierarchyDepth = 6;
+    config.instanceRatio  = 0.99f;
+    config.maxSegments    = 16;
+    config.extent         = DEPTH_RANGE;
+
+    GeneratedScene generated;
+    SceneGenerator::Generate( config, generated );
+
+    SceneNode root;
+    vector<shared_ptr<SceneNode> > nodes;
+    FlatHierarchy flat;
+    CreateHierarchy( generated, root, nodes, flat );
+
+    vector<double> treeTimes, flatTimes;
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        Benchmark::Timer treeTimer;
+        UpdateWorld( root, root.local );
+        treeTimes.push_back( treeTimer.GetMilliseconds() );
+
+        Benchmark::Timer flatTimer;
+        UpdateWorld( flat, root.world );
+        flatTimes.push_back( flatTimer.GetMilliseconds() );
+    }
+
+    Output( "hierarchy, tree", Benchmark::Record( "Scene/hierarchy/tree", treeTimes, nodeCount ), nodeCount, "nodes" );
+    Output( "hierarchy, flat", Benchmark::Record( "Scene/hierarchy/flat", flatTimes, nodeCount ), nodeCount, "nodes" );
+
+    // Same multiplies in the same order, so the two walks agree bit for bit
+    bool bHierarchy = true;
+    for (uint32_t i = 0; bHierarchy && i < nodeCount; ++i)
+    {
+        bHierarchy = memcmp( nodes[i]->world, &flat.worlds[i * 16], sizeof( nodes[i]->world ) ) == 0;
+    }
+    cout << "  hierarchy check         " << (bHierarchy ? "passed" : "FAILED") << endl;
+    bSucceeded &= bHierarchy;
+
+    // App::ProcessInput and UpdateViewMatrix for a stream of mouse moves with the left button held
+    mt19937 random( 12345 );
+    uniform_real_distribution<float> delta( -20.0f, 20.0f );
+    vector<float> moves( options.cameraUpdates * 2 );
+    for (float& move : moves)
+    {
+        move = delta( random );
+    }
+
+    OrbitCamera::State camera;
+    float              view[16] = {};
+    vector<double>     cameraTimes;
+    bool               bCamera = true;
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        const OrbitCamera::State start = { { 1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -10.0f }, { 0.0f, 0.0f, 0.0f } };
+        camera = start;
+
+        Benchmark::Timer timer;
+        for (uint32_t i = 0; i < options.cameraUpdates; ++i)
+        {
+            if (OrbitCamera::Rotate( camera, moves[i * 2], moves[i * 2 + 1] ))
+                bCamera &= OrbitCamera::GetViewMatrix( camera, view );
+        }
+        cameraTimes.push_back( timer.GetMilliseconds() );
+    }
+
+    Output( "camera", Benchmark::Record( "Scene/camera", cameraTimes, options.cameraUpdates ), options.cameraUpdates, "updates" );
+
+    // The orbit keeps the distance and the pose keeps looking at the target, the view undoes the pose; translating
+    // moves both points, and the wheel stops short of the target
+    {
+        const float distance = Distance( camera.position, camera.lookAt );
+
+        const float lookAtDir[3] = { camera.pose[6], camera.pose[7], camera.pose[8] };
+        const float targetDir[3] = { (camera.lookAt[0] - camera.position[0]) / distance, (camera.lookAt[1] - camera.position[1]) / distance,
+                                     (camera.lookAt[2] - camera.position[2]) / distance };
+        const float facing = lookAtDir[0] * targetDir[0] + lookAtDir[1] * targetDir[1] + lookAtDir[2] * targetDir[2];
+
+        float viewOrigin[3] = {};
+        for (int row = 0; row < 3; ++row)
+        {
+            viewOrigin[row] = view[row] * camera.position[0] + view[4 + row] * camera.position[1] + view[8 + row] * camera.position[2] + view[12 + row];
+        }
+
+        bCamera &= options.cameraUpdates == 0 ||
+                   (IsNear( distance, 10.0f, 1e-2f ) && facing > 0.999f &&
+                    IsNear( viewOrigin[0], 0.0f, 1e-3f ) && IsNear( viewOrigin[1], 0.0f, 1e-3f ) && IsNear( viewOrigin[2], 0.0f, 1e-3f ));
+
+        OrbitCamera::State moved = camera;
+        bCamera &= OrbitCamera::Translate( moved, 30.0f, -40.0f ) && IsNear( Distance( moved.position, camera.position ), 0.5f, 1e-4f ) &&
+                   IsNear( Distance( moved.position, moved.lookAt ), distance, 1e-4f ) && !OrbitCamera::Translate( moved, 0.0f, 0.0f );
+
+        bCamera &= OrbitCamera::Zoom( moved, 100.0f ) && IsNear( Distance( moved.position, moved.lookAt ), distance - 1.0f, 1e-3f ) &&
+                   OrbitCamera::Zoom( moved, 1e6f ) && IsNear( Distance( moved.position, moved.lookAt ), 0.001f, 1e-4f );
+
+        cout << "  camera check            " << (bCamera ? "passed" : "FAILED") << " (distance " << distance << ")" << endl;
+        bSucceeded &= bCamera;
+    }
+
+    // RenderPass::Draw of the forward pass from 10K nodes up in steps of 10x: cull, gather, then the viewer's
+    // recorder sorting and recording into the sink
+    float planes[24];
+    CreateFrustumPlanes( planes );
+
+    // Camera at the origin looking down +z, so the depth is the world z of the node
+    const float origin[3]    = { 0.0f, 0.0f, 0.0f };
+    const float direction[3] = { 0.0f, 0.0f, 1.0f };
+
+    vector<float>            worlds;
+    vector<float>            boxes;
+    vector<uint8_t>          visible;
+    ScenePackets             scenePackets;
+    FrameArena               arena;
+    RecordingSink            sink;
+    DrawRecorder::Statistics stats;
+
+    for (uint32_t sceneNodes = min( 10000u, nodeCount ); sceneNodes <= nodeCount; sceneNodes *= 10)
+    {
+        config.objectCount = sceneNodes;
+        SceneGenerator::Generate( config, generated );
+
+        worlds.resize( sceneNodes * 16 );
+        for (uint32_t i = 0; i < sceneNodes; ++i)
+        {
+            copy( generated.nodes[i].world, generated.nodes[i].world + 16, &worlds[i * 16] );
+        }
+
+        // RenderPass::Construct: a context per model, bound as the forward pass binds them
+        vector<double> constructTimes;
+        for (uint32_t n = 0; n < iterations; ++n)
+        {
+            Benchmark::Timer constructTimer;
+            scenePackets.Construct( generated );
+            constructTimes.push_back( constructTimer.GetMilliseconds() );
+        }
+
+        // Ids start over as when the pass is constructed for a new scene
+        DrawRecorder recorder;
+        recorder.SetSortPass( SORT_PASS_OPAQUE );
+        recorder.SetSortView( origin, direction, DEPTH_RANGE );
+
+        // After the first frames grew both buffers of the arena and the lists, a frame of the same scene
+        // allocates nothing
+        const uint32_t WARM_UP_FRAMES = 3;
+        uint64_t       allocations    = 0;
+        size_t         visibleCount   = 0;
+
+        vector<double> cullTimes, recordTimes;
+        for (uint32_t n = 0; n < WARM_UP_FRAMES + iterations; ++n)
+        {
+            const AllocationCounter::Scope frameAllocations;
+
+            arena.BeginFrame();
+
+            Benchmark::Timer cullTimer;
+            visibleCount = CullNodes( worlds, planes, boxes, visible );
+            const double cullTime = cullTimer.GetMilliseconds();
+
+            Benchmark::Timer recordTimer;
+            DrawRecorder::Packet* pPackets = nullptr;
+            const uint32_t packetCount = GatherPackets( scenePackets, visible, visibleCount, boxes, arena, pPackets );
+
+            stats.Clear();
+            recorder.Sort( pPackets, arena.Allocate<DrawSort::Item>( packetCount ), packetCount, stats );
+
+            sink.Reset();
+            recorder.Record( sink, stats );
+            const double recordTime = recordTimer.GetMilliseconds();
+
+            if (n < WARM_UP_FRAMES)
+                continue;
+
+            allocations += frameAllocations.GetCount();
+            cullTimes.push_back( cullTime );
+            recordTimes.push_back( recordTime );
+        }
+
+        const string name = "Scene/" + to_string( sceneNodes ) + " nodes";
+
+        cout << "  " << sceneNodes << " nodes" << endl;
+        Output( "construct", Benchmark::Record( name + "/construct", constructTimes, sceneNodes ), sceneNodes, "nodes" );
+        Output( "cull", Benchmark::Record( name + "/cull", cullTimes, sceneNodes ), sceneNodes, "nodes" );
+        Output( "gather, sort and record", Benchmark::Record( name + "/gather sort and record", recordTimes, visibleCount ), visibleCount, "draws" );
+
+        // Camera, light, material and cluster constants then the cluster lists, as the forward root signature
+        // has them; only the material differs between models
+        bool bBound = visibleCount >= 2;
+        if (bBound)
+        {
+            const DrawRecorder::Packet* pPackets = recorder.GetPackets();
+            bBound = pPackets[0].constantBufferCount == 4 && pPackets[0].shaderResourceCount == 3 &&
+                     memcmp( &pPackets[0].constantBuffers[0], &pPackets[1].constantBuffers[0], 2 * sizeof( uint64_t ) ) == 0 &&
+                     pPackets[0].constantBuffers[2] != pPackets[1].constantBuffers[2] &&
+                     pPackets[0].constantBuffers[3] == pPackets[1].constantBuffers[3] && pPackets[0].pModel != pPackets[1].pModel;
+        }
+
+        const bool bRecorded = bBound && stats.drawCount == static_cast<int>(visibleCount) && sink.Verify( recorder ) && allocations == 0;
+
+        cout << "  record check            " << (bRecorded ? "passed" : "FAILED")
+             << " (" << visibleCount << " visible, " << sink.GetCommands().size() << " commands, binds "
+             << stats.requestedBinds << " -> " << stats.issuedBinds << ", saturated keys " << stats.saturatedKeys << ", "
+             << allocations << " allocations after warm-up)" << endl;
+        bSucceeded &= bRecorded;
+    }
+
+    return bSucceeded;
+}
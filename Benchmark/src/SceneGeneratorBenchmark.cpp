@@ -0,0 +1,255 @@
+#include "Benchmarks.h"
+#include "DrawRecorder.h"
+#include "RecordingSink.h"
+#include "SceneGenerator.h"
+#include "ScenePackets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Roots stay on the ground within the extent; children may reach a little past it
+    bool IsInExtent( const GeneratedScene& scene, float extent )
+    {
+        for (const GeneratedScene::Node& node : scene.nodes)
+        {
+            if (node.parent == GeneratedScene::NO_PARENT && (fabsf( node.world[12] ) > 0.5f * extent || fabsf( node.world[14] ) > 0.5f * extent))
+                return false;
+        }
+        for (size_t i = 0; i < scene.lights.Size(); ++i)
+        {
+            if (fabsf( scene.lights.positionX[i] ) > 0.5f * extent || fabsf( scene.lights.positionZ[i] ) > 0.5f * extent)
+                return false;
+        }
+        return true;
+    }
+
+    // Same seed same scene, another seed another; depth, instancing and light mix as configured
+    bool CheckConfig()
+    {
+        bool bPassed = true;
+
+        SceneGenerator::Config config;
+        config.objectCount = 5000;
+        config.lightCount  = 1000;
+
+        GeneratedScene a, b;
+        for (int distribution = 0; distribution < SceneGenerator::DISTRIBUTION_NUM; ++distribution)
+        {
+            config.distribution = static_cast<SceneGenerator::DISTRIBUTION>(distribution);
+            config.seed         = 7;
+            SceneGenerator::Generate( config, a );
+            SceneGenerator::Generate( config, b );
+            bPassed &= a.GetHash() == b.GetHash() && IsInExtent( a, config.extent );
+
+            config.seed = 8;
+            SceneGenerator::Generate( config, b );
+            bPassed &= a.GetHash() != b.GetHash();
+        }
+
+        for (uint32_t depth = 1; depth <= 5; ++depth)
+        {
+            config.hierarchyDepth = depth;
+            SceneGenerator::Generate( config, a );
+            bPassed &= a.GetDepth() == depth && a.nodes.size() == config.objectCount;
+        }
+
+        config.instanceRatio = 0.75f;
+        SceneGenerator::Generate( config, a );
+        bPassed &= a.meshes.size() == 1250;
+
+        config.instanceRatio = 1.0f;
+        SceneGenerator::Generate( config, a );
+        bPassed &= a.meshes.size() == 1;
+
+        uint32_t spotLights = 0;
+        for (size_t i = 0; i < a.lights.Size(); ++i)
+        {
+            spotLights += a.lights.spotCosOuter[i] > -1.0f ? 1 : 0;
+        }
+        bPassed &= a.lights.Size() == config.lightCount && spotLights > 150 && spotLights < 350;
+
+        // Every index stays within its mesh at the highest complexity
+        config.minSegments = config.maxSegments = SceneGenerator::MAX_SEGMENTS;
+        config.instanceRatio = 0.999f;
+        SceneGenerator::Generate( config, a );
+        for (const GeneratedScene::Mesh& mesh : a.meshes)
+        {
+            bPassed &= !mesh.indices.empty() && *max_element( mesh.indices.begin(), mesh.indices.end() ) < mesh.positions.size() / 3;
+        }
+
+        cout << "  config check            " << (bPassed ? "passed" : "FAILED") << " (" << spotLights << " spot lights of " << a.lights.Size() << ")" << endl;
+
+        return bPassed;
+    }
+
+    // Written, read back and regenerated scenes are all the same scene
+    bool CheckRoundTrip( const GeneratedScene& scene, const GeneratedScene& read )
+    {
+        return !read.nodes.empty() && read.GetHash() == scene.GetHash() && read.GetDepth() == scene.GetDepth() &&
+               memcmp( read.nodes.back().world, scene.nodes.back().world, sizeof( read.nodes.back().world ) ) == 0;
+    }
+
+    // RenderPass::Construct and Draw of the forward pass over every model of the scene, which it does not cull:
+    // the viewer's recorder sorts the packets front to back from a camera above the ground and records them
+    // into the sink. Returns the statistics of the last run; bPassed is cleared by any run whose stream is wrong.
+    DrawRecorder::Statistics RecordScene( const GeneratedScene& scene, float extent, uint32_t iterations, vector<double>& times, bool& bPassed )
+    {
+        const float origin[3]    = { 0.0f, extent, -extent };
+        const float direction[3] = { 0.0f, -0.7071068f, 0.7071068f };
+
+        // World bounds of each node's mesh, as the scene's models are made of world-space vertices
+        vector<float> bounds( scene.nodes.size() * 6 );
+        for (size_t i = 0; i < scene.nodes.size(); ++i)
+        {
+            const GeneratedScene::Node& node = scene.nodes[i];
+            if (node.mesh == GeneratedScene::NO_MESH)
+                continue;
+
+            const GeneratedScene::Mesh& mesh = scene.meshes[node.mesh];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                float center = node.world[12 + axis];
+                float extent = 0.0f;
+                for (int row = 0; row < 3; ++row)
+                {
+                    const float m = node.world[row * 4 + axis];
+                    center += m * (mesh.boundsMin[row] + mesh.boundsMax[row]) * 0.5f;
+                    extent += fabsf( m ) * (mesh.boundsMax[row] - mesh.boundsMin[row]) * 0.5f;
+                }
+                bounds[i * 6 + axis]     = center - extent;
+                bounds[i * 6 + 3 + axis] = center + extent;
+            }
+        }
+
+        ScenePackets                 scenePackets;
+        vector<DrawRecorder::Packet> packets;
+        vector<DrawSort::Item>       items;
+        RecordingSink                sink;
+        DrawRecorder::Statistics     stats;
+
+        for (uint32_t n = 0; n < iterations; ++n)
+        {
+            Benchmark::Timer timer;
+
+            DrawRecorder recorder;
+            recorder.SetSortPass( 1 );      // RenderPass::SORT_PASS_OPAQUE
+            recorder.SetSortView( origin, direction, 3.0f * extent );
+
+            scenePackets.Construct( scene );
+
+            packets.resize( scene.nodes.size() );
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < scene.nodes.size(); ++i)
+            {
+                if (scenePackets.Create( i, &bounds[i * 6], &bounds[i * 6 + 3], packets[count] ))
+                    count++;
+            }
+
+            items.resize( count );
+            stats.Clear();
+            recorder.Sort( packets.data(), items.data(), count, stats );
+
+            sink.Reset();
+            recorder.Record( sink, stats );
+
+            times.push_back( timer.GetMilliseconds() );
+
+            bPassed &= count > 0 && stats.drawCount == static_cast<int>(count) && sink.Verify( recorder );
+        }
+
+        return stats;
+    }
+
+    void RemoveFiles( const GeneratedScene& scene, const string& manifestPath )
+    {
+        remove( manifestPath.c_str() );
+        for (size_t i = 0; i < scene.meshes.size(); ++i)
+        {
+            remove( SceneGenerator::GetMeshPath( manifestPath, i ).c_str() );
+        }
+    }
+}
+
+bool Benchmark::RunSceneGenerator( uint32_t maxObjectCount, uint32_t iterations )
+{
+    cout << "SceneGenerator: up to " << maxObjectCount << " objects, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = CheckConfig();
+
+    // Scale from 10K objects up in steps of 10x, each written and read back through the viewer's loaders
+    const string manifestPath = "scene_generator_benchmark.txt";
+
+    for (uint32_t objectCount = min( 10000u, maxObjectCount ); objectCount > 0 && objectCount <= maxObjectCount; objectCount *= 10)
+    {
+        SceneGenerator::Config config;
+        config.seed          = objectCount;
+        config.objectCount   = objectCount;
+        config.instanceRatio = 0.99f;
+        config.lightCount    = objectCount / 10;
+
+        GeneratedScene scene;
+        vector<double> times;
+        for (uint32_t n = 0; n < iterations; ++n)
+        {
+            Benchmark::Timer timer;
+            SceneGenerator::Generate( config, scene );
+            times.push_back( timer.GetMilliseconds() );
+        }
+
+        const string name = "SceneGenerator/" + to_string( objectCount ) + " objects";
+        const double generateTime = Benchmark::Record( name + "/generate", times, objectCount );
+
+        cout << "  " << setw( 8 ) << objectCount << " objects  " << scene.meshes.size() << " meshes, depth " << scene.GetDepth()
+             << ", " << scene.GetDrawnTriangleCount() / 1000000.0 << " M triangles" << endl;
+        cout << "    generate      " << setw( 10 ) << generateTime << " ms" << endl;
+
+        bool bRecorded = true;
+        vector<double> recordTimes;
+        const DrawRecorder::Statistics stats = RecordScene( scene, config.extent, iterations, recordTimes, bRecorded );
+        cout << "    record        " << setw( 10 ) << Benchmark::Record( name + "/record", recordTimes, objectCount ) << " ms ("
+             << stats.drawCount << " draws, binds " << stats.requestedBinds << " -> " << stats.issuedBinds
+             << ", saturated keys " << stats.saturatedKeys << ")" << endl;
+        cout << "    record check          " << (bRecorded ? "passed" : "FAILED") << endl;
+        bSucceeded &= bRecorded;
+
+        SceneGenerator generator;
+        vector<double> writeTimes, readTimes;
+        GeneratedScene read;
+        bool bRoundTrip = true;
+        for (uint32_t n = 0; n < iterations; ++n)
+        {
+            Benchmark::Timer writeTimer;
+            bRoundTrip &= generator.Write( scene, manifestPath );
+            writeTimes.push_back( writeTimer.GetMilliseconds() );
+
+            Benchmark::Timer readTimer;
+            bRoundTrip &= generator.Read( manifestPath, read );
+            readTimes.push_back( readTimer.GetMilliseconds() );
+        }
+
+        if (!generator.GetError().empty())
+            cerr << generator.GetError() << endl;
+
+        cout << "    write         " << setw( 10 ) << Benchmark::Record( name + "/write", writeTimes, objectCount ) << " ms" << endl;
+        cout << "    read          " << setw( 10 ) << Benchmark::Record( name + "/read", readTimes, objectCount ) << " ms" << endl;
+
+        bRoundTrip &= CheckRoundTrip( scene, read );
+        cout << "    round trip check      " << (bRoundTrip ? "passed" : "FAILED") << endl;
+        bSucceeded &= bRoundTrip;
+
+        RemoveFiles( scene, manifestPath );
+    }
+
+    return bSucceeded;
+}
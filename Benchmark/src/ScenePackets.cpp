@@ -0,0 +1,82 @@
+#include "ScenePackets.h"
+
+namespace
+{
+    // Every context of the pass shares them
+    const char ROOT_SIGNATURE = 0;
+    const char PIPELINE_STATE = 0;
+
+    const uint64_t CAMERA_ADDRESS         = 0x10000;
+    const uint64_t LIGHT_ADDRESS          = 0x10100;
+    const uint64_t LIGHT_CLUSTER_ADDRESS  = 0x10200;
+    const uint64_t MATERIAL_ADDRESS       = 0x100000;   // one 256-byte constant buffer per model
+    const uint64_t CLUSTER_LIST_ADDRESSES = 0x20000;    // lights, ranges and indices
+    const uint32_t CLUSTER_LIST_COUNT     = 3;          // ClusteredLights::SHADER_RESOURCE_NUM
+
+    const uint32_t SHADOW_MAP_TABLE = 0;
+
+    const uint32_t NO_CONTEXT = UINT32_MAX;
+}
+
+ScenePackets::Source::Source( uint64_t constantBuffer, uint64_t shaderResources, uint32_t shaderResourceCount )
+    : m_constantBuffer( constantBuffer )
+    , m_shaderResources( shaderResources )
+    , m_shaderResourceCount( shaderResourceCount )
+{
+}
+
+void ScenePackets::Construct( const GeneratedScene& scene )
+{
+    m_camera        = Source( CAMERA_ADDRESS );
+    m_light         = Source( LIGHT_ADDRESS );
+    m_lightClusters = Source( LIGHT_CLUSTER_ADDRESS, CLUSTER_LIST_ADDRESSES, CLUSTER_LIST_COUNT );
+
+    m_contexts.clear();
+    m_indexCounts.clear();
+    m_contextOfNode.assign( scene.nodes.size(), NO_CONTEXT );
+
+    // Models are made per mesh node from world-space vertices, so no two contexts share one
+    for (uint32_t i = 0; i < scene.nodes.size(); ++i)
+    {
+        if (scene.nodes[i].mesh == GeneratedScene::NO_MESH)
+            continue;
+
+        m_contextOfNode[i] = static_cast<uint32_t>(m_contexts.size());
+        m_indexCounts.push_back( static_cast<uint32_t>(scene.meshes[scene.nodes[i].mesh].indices.size()) );
+        m_contexts.push_back( DrawBindings() );
+    }
+
+    // Filled before any context points at one, as the vector must not move afterwards
+    m_materials.clear();
+    for (size_t i = 0; i < m_contexts.size(); ++i)
+    {
+        m_materials.push_back( Source( MATERIAL_ADDRESS + i * 256ull ) );
+    }
+
+    for (size_t i = 0; i < m_contexts.size(); ++i)
+    {
+        DrawBindings& context = m_contexts[i];
+        context.SetDescriptorIndex( SHADOW_MAP_TABLE );
+        context.SetRootSignature( &ROOT_SIGNATURE );
+        context.SetPipelineState( &PIPELINE_STATE );
+
+        // The light clusters exist only in scenes with lights
+        DrawBindings::ForwardSources sources;
+        sources.pCamera        = &m_camera;
+        sources.pLight         = &m_light;
+        sources.pMaterial      = &m_materials[i];
+        sources.pLightClusters = scene.lights.Size() > 0 ? &m_lightClusters : nullptr;
+        context.BindForward( sources );
+    }
+}
+
+bool ScenePackets::Create( uint32_t node, const float boundsMin[3], const float boundsMax[3], DrawRecorder::Packet& packet ) const
+{
+    const uint32_t context = node < m_contextOfNode.size() ? m_contextOfNode[node] : NO_CONTEXT;
+    if (context == NO_CONTEXT)
+        return false;
+
+    m_contexts[context].CreatePacket( &m_contexts[context], &m_materials[context], m_indexCounts[context], boundsMin, boundsMax, packet );
+
+    return true;
+}
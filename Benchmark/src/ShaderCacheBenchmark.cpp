@@ -0,0 +1,281 @@
+#include "Benchmarks.h"
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Sources and cache files go into the working directory and are removed at the end
+    const char* SOURCE_PATH  = "shader_cache_benchmark.hlsl";
+    const char* INCLUDE_PATH = "shader_cache_benchmark.hlsli";
+    const char* CACHE_DIRECTORY = ".";
+
+    bool WriteText( const string& path, const string& text )
+    {
+        ofstream file( path.c_str(), ios::out | ios::binary | ios::trunc );
+        file << text;
+        return file.good();
+    }
+
+    string ReadText( const string& path )
+    {
+        ifstream file( path.c_str(), ios::in | ios::binary );
+        return string( istreambuf_iterator<char>( file ), istreambuf_iterator<char>() );
+    }
+
+    string GetCachePath( uint64_t key )
+    {
+        char name[32];
+        snprintf( name, sizeof( name ), "%016llx.cso", static_cast<unsigned long long>(key) );
+        return string( CACHE_DIRECTORY ) + "/" + name;
+    }
+
+    void WriteSources( const string& includeText )
+    {
+        WriteText( SOURCE_PATH, "#include \"" + string( INCLUDE_PATH ) + "\"\n\nfloat4 VSMain() : SV_Position { return Offset; }\nfloat4 PSMain() : SV_Target { return Offset; }\n" );
+        WriteText( INCLUDE_PATH, includeText );
+    }
+
+    // Busy, as the shader compiler is
+    void Spin( double milliseconds )
+    {
+        Benchmark::Timer timer;
+        while (timer.GetMilliseconds() < milliseconds)
+        {
+        }
+    }
+
+    // The bytecode a stub compiler makes of a request, so a blob shows which request it came from
+    string GetBytecode( const ShaderCache::CompileRequest& request )
+    {
+        return request.entryPoint + "/" + request.profile + "/" + to_string( request.flags );
+    }
+
+    bool HasBytecode( const shared_ptr<ShaderCache::Blob>& pBlob, const ShaderCache::CompileRequest& request )
+    {
+        const string expected = GetBytecode( request );
+        return pBlob != nullptr && pBlob->GetSize() == expected.size() && equal( expected.begin(), expected.end(), static_cast<const char*>(pBlob->GetData()) );
+    }
+
+    // Keys follow the source, its includes, the entry point, the profile and the flags, and nothing else
+    bool CheckKeys()
+    {
+        bool bPassed = true;
+
+        WriteSources( "float4 Offset;\n" );
+
+        vector<string> closure;
+        ShaderCache::ResolveIncludes( SOURCE_PATH, closure );
+        bPassed &= closure.size() == 2 && closure[0] == SOURCE_PATH && closure[1] == INCLUDE_PATH;
+
+        const ShaderCache::CompileRequest request( SOURCE_PATH, "VSMain", "vs_5_0", 0 );
+        const uint64_t key = ShaderCache::ComputeKey( request );
+        bPassed &= ShaderCache::ComputeKey( request ) == key;
+
+        bPassed &= ShaderCache::ComputeKey( ShaderCache::CompileRequest( SOURCE_PATH, "PSMain", "vs_5_0", 0 ) ) != key;
+        bPassed &= ShaderCache::ComputeKey( ShaderCache::CompileRequest( SOURCE_PATH, "VSMain", "vs_5_1", 0 ) ) != key;
+        bPassed &= ShaderCache::ComputeKey( ShaderCache::CompileRequest( SOURCE_PATH, "VSMain", "vs_5_0", 1 ) ) != key;
+
+        // The entry point and profile are hashed with their terminators, so moving a character between them counts
+        bPassed &= ShaderCache::ComputeKey( ShaderCache::CompileRequest( SOURCE_PATH, "VSMai", "nvs_5_0", 0 ) ) != key;
+
+        // An edited include changes the key, and undoing the edit brings it back
+        WriteSources( "float4 Offset; // edited\n" );
+        bPassed &= ShaderCache::ComputeKey( request ) != key;
+        WriteSources( "float4 Offset;\n" );
+        bPassed &= ShaderCache::ComputeKey( request ) == key;
+
+        // A missing include still counts, by name
+        remove( INCLUDE_PATH );
+        const uint64_t missingKey = ShaderCache::ComputeKey( request );
+        bPassed &= missingKey != key;
+        WriteSources( "float4 Offset;\n" );
+
+        cout << "  key check               " << (bPassed ? "passed" : "FAILED") << " (" << closure.size() << " files in the include closure)" << endl;
+
+        return bPassed;
+    }
+
+    // Misses compile and are stored, hits map the file, edits invalidate, corrupt or foreign files and failed
+    // compiles are never served
+    bool CheckCache( vector<uint64_t>& keys )
+    {
+        bool bPassed = true;
+
+        atomic<uint32_t> compiles( 0 );
+        auto compile = [&]( const ShaderCache::CompileRequest& request, vector<unsigned char>& bytecode )
+        {
+            const string text = GetBytecode( request );
+            bytecode.assign( text.begin(), text.end() );
+            compiles++;
+            return true;
+        };
+
+        WriteSources( "float4 Offset;\n" );
+
+        const vector<ShaderCache::CompileRequest> requests = {
+            ShaderCache::CompileRequest( SOURCE_PATH, "VSMain", "vs_5_0", 0 ),
+            ShaderCache::CompileRequest( SOURCE_PATH, "PSMain", "ps_5_0", 0 ),
+            ShaderCache::CompileRequest( SOURCE_PATH, "PSMain", "ps_5_0", 1 ),
+        };
+
+        auto fetch = [&]( ShaderCache& cache )
+        {
+            vector<shared_ptr<ShaderCache::Blob> > blobs;
+            bool bFetched = cache.Fetch( requests, blobs );
+            for (size_t i = 0; i < requests.size(); ++i)
+            {
+                bFetched &= HasBytecode( blobs[i], requests[i] );
+            }
+            return bFetched;
+        };
+
+        for (const auto& request : requests)
+        {
+            keys.push_back( ShaderCache::ComputeKey( request ) );
+        }
+
+        // Cold, then warm from another cache on the same directory
+        {
+            ShaderCache cache( CACHE_DIRECTORY, compile, 4 );
+            bPassed &= fetch( cache ) && compiles == 3;
+            bPassed &= cache.GetStatistics().misses == 3 && cache.GetStatistics().hits == 0;
+        }
+        {
+            ShaderCache cache( CACHE_DIRECTORY, compile, 4 );
+            bPassed &= fetch( cache ) && compiles == 3;
+            bPassed &= cache.GetStatistics().hits == 3 && cache.GetStatistics().misses == 0;
+        }
+
+        // Every request depends on the include
+        WriteSources( "float4 Offset; // edited\n" );
+        for (const auto& request : requests)
+        {
+            keys.push_back( ShaderCache::ComputeKey( request ) );
+        }
+        {
+            ShaderCache cache( CACHE_DIRECTORY, compile, 4 );
+            bPassed &= fetch( cache ) && compiles == 6;
+        }
+        WriteSources( "float4 Offset;\n" );
+
+        // A truncated file, a file with a flipped byte in its header and another key's file are compiled again
+        const string vertexPath = GetCachePath( keys[0] );
+        const string pixelPath  = GetCachePath( keys[1] );
+        const string flagsPath  = GetCachePath( keys[2] );
+
+        string vertexFile = ReadText( vertexPath );
+        WriteText( vertexPath, vertexFile.substr( 0, vertexFile.size() - 1 ) );
+
+        string pixelFile = ReadText( pixelPath );
+        pixelFile[0] = static_cast<char>(pixelFile[0] ^ 0x01);
+        WriteText( pixelPath, pixelFile );
+
+        WriteText( flagsPath, ReadText( GetCachePath( keys[3] ) ) );
+        {
+            ShaderCache cache( CACHE_DIRECTORY, compile, 4 );
+            bPassed &= fetch( cache ) && compiles == 9 && cache.GetStatistics().misses == 3;
+        }
+        {
+            ShaderCache cache( CACHE_DIRECTORY, compile, 4 );
+            bPassed &= fetch( cache ) && compiles == 9 && cache.GetStatistics().hits == 3;
+        }
+
+        // A failed compile leaves its entry null and stores nothing, so the next fetch compiles it again
+        {
+            auto fail = []( const ShaderCache::CompileRequest&, vector<unsigned char>& ) { return false; };
+            const ShaderCache::CompileRequest request( SOURCE_PATH, "VSMain", "vs_5_0", 2 );
+            keys.push_back( ShaderCache::ComputeKey( request ) );
+
+            ShaderCache failing( CACHE_DIRECTORY, fail, 4 );
+            bPassed &= failing.Fetch( request ) == nullptr && failing.GetStatistics().failures == 1;
+
+            ShaderCache cache( CACHE_DIRECTORY, compile, 4 );
+            bPassed &= HasBytecode( cache.Fetch( request ), request ) && compiles == 10 && cache.GetStatistics().misses == 1;
+        }
+
+        cout << "  cache check             " << (bPassed ? "passed" : "FAILED") << " (" << compiles << " compiles)" << endl;
+
+        return bPassed;
+    }
+
+    void RemoveFiles( const vector<uint64_t>& keys )
+    {
+        for (uint64_t key : keys)
+        {
+            remove( GetCachePath( key ).c_str() );
+        }
+        remove( SOURCE_PATH );
+        remove( INCLUDE_PATH );
+    }
+}
+
+bool Benchmark::RunShaderCache( uint32_t shaderCount, uint32_t iterations )
+{
+    // Cost of one compile, kept small to run quickly; the driver's compiler takes tens of milliseconds
+    const double COMPILE_MILLISECONDS = 1.0;
+    const int    WORKER_COUNT         = 4;
+
+    shaderCount = max( 1u, shaderCount );
+
+    cout << "ShaderCache: " << shaderCount << " shaders of " << COMPILE_MILLISECONDS << " ms, " << WORKER_COUNT << " workers, median of "
+         << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    vector<uint64_t> keys;
+
+    bool bSucceeded = CheckKeys();
+    bSucceeded &= CheckCache( keys );
+
+    auto compile = [=]( const ShaderCache::CompileRequest& request, vector<unsigned char>& bytecode )
+    {
+        Spin( COMPILE_MILLISECONDS );
+        const string text = GetBytecode( request );
+        bytecode.assign( text.begin(), text.end() );
+        return true;
+    };
+
+    // Other flags every run, so each cold fetch finds an empty cache
+    vector<double> coldTimes, warmTimes;
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        vector<ShaderCache::CompileRequest> requests;
+        for (uint32_t i = 0; i < shaderCount; ++i)
+        {
+            requests.push_back( ShaderCache::CompileRequest( SOURCE_PATH, "Main" + to_string( i ), "ps_5_0", 100 + n ) );
+            keys.push_back( ShaderCache::ComputeKey( requests.back() ) );
+        }
+
+        vector<shared_ptr<ShaderCache::Blob> > blobs;
+        {
+            ShaderCache cache( CACHE_DIRECTORY, compile, WORKER_COUNT );
+            bSucceeded &= cache.Fetch( requests, blobs );
+            coldTimes.push_back( cache.GetStatistics().coldMilliseconds );
+        }
+        {
+            ShaderCache cache( CACHE_DIRECTORY, compile, WORKER_COUNT );
+            bSucceeded &= cache.Fetch( requests, blobs ) && cache.GetStatistics().hits == static_cast<int>(shaderCount);
+            warmTimes.push_back( cache.GetStatistics().warmMilliseconds );
+        }
+    }
+
+    const double cold = Benchmark::Record( "ShaderCache/cold fetch", coldTimes, shaderCount );
+    const double warm = Benchmark::Record( "ShaderCache/warm fetch", warmTimes, shaderCount );
+
+    cout << "  cold fetch              " << setw( 9 ) << cold << " ms (" << shaderCount * COMPILE_MILLISECONDS << " ms of compiles)" << endl;
+    cout << "  warm fetch              " << setw( 9 ) << warm << " ms (" << cold / max( warm, 1e-6 ) << "x)" << endl;
+
+    RemoveFiles( keys );
+
+    return bSucceeded;
+}
@@ -0,0 +1,406 @@
+#include "Benchmarks.h"
+#include "ShadowFrustum.h"
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    typedef SoftwareRasterizer SR;
+
+    const float PI = 3.14159265f;
+
+    const float FOV_Y  = 50.0f * PI / 180.0f;
+    const float ASPECT = 16.0f / 9.0f;
+    const float NEAR_Z = 0.5f;
+    const float FAR_Z  = 50.0f;
+
+    const float LIGHT_DIRECTION[3] = { 0.3f, -1.0f, -0.5f };
+
+    float Dot( const float a[3], const float b[3] )
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    void Normalize( float v[3] )
+    {
+        const float length = sqrtf( Dot( v, v ) );
+        for (int k = 0; k < 3; ++k)
+        {
+            v[k] /= length;
+        }
+    }
+
+    struct Camera
+    {
+        Camera( const float eyePosition[3], const float targetPosition[3] )
+        {
+            const float up[3] = { 0.0f, 1.0f, 0.0f };
+            SR::CreateLookAtLH( eyePosition, targetPosition, up, view );
+            SR::CreatePerspectiveFovLH( FOV_Y, ASPECT, NEAR_Z, FAR_Z, projection );
+
+            // The same basis built by hand, so the corners do not come from the code under test
+            for (int k = 0; k < 3; ++k)
+            {
+                eye[k]     = eyePosition[k];
+                forward[k] = targetPosition[k] - eyePosition[k];
+            }
+            Normalize( forward );
+
+            right[0] = up[1] * forward[2] - up[2] * forward[1];
+            right[1] = up[2] * forward[0] - up[0] * forward[2];
+            right[2] = up[0] * forward[1] - up[1] * forward[0];
+            Normalize( right );
+
+            upward[0] = forward[1] * right[2] - forward[2] * right[1];
+            upward[1] = forward[2] * right[0] - forward[0] * right[2];
+            upward[2] = forward[0] * right[1] - forward[1] * right[0];
+        }
+
+        // The four corners of the frustum's cross section at a view depth
+        void GetCorners( float depth, float corners[4][3] ) const
+        {
+            const float halfHeight = depth * tanf( 0.5f * FOV_Y );
+            const float halfWidth  = halfHeight * ASPECT;
+            for (int i = 0; i < 4; ++i)
+            {
+                const float x = (i & 1) ? halfWidth : -halfWidth;
+                const float y = (i & 2) ? halfHeight : -halfHeight;
+                for (int k = 0; k < 3; ++k)
+                {
+                    corners[i][k] = eye[k] + forward[k] * depth + right[k] * x + upward[k] * y;
+                }
+            }
+        }
+
+        float view[16];
+        float projection[16];
+
+        float eye[3];
+        float forward[3];
+        float right[3];
+        float upward[3];
+    };
+
+    ShadowFrustum::Input CreateInput( const Camera& camera, const ShadowFrustum::Bounds& bounds )
+    {
+        ShadowFrustum::Input input;
+        copy( LIGHT_DIRECTION, LIGHT_DIRECTION + 3, input.direction );
+        input.pCameraView       = camera.view;
+        input.pCameraProjection = camera.projection;
+        input.casters           = bounds;
+        input.receivers         = bounds;
+
+        return input;
+    }
+
+    // Receivers enclosing the whole camera frustum, so every fit has to cover its whole slice
+    ShadowFrustum::Bounds CreateWorld()
+    {
+        const float lo[3] = { -200.0f, -200.0f, -200.0f };
+        const float hi[3] = { 200.0f, 200.0f, 200.0f };
+
+        ShadowFrustum::Bounds bounds;
+        bounds.Add( lo );
+        bounds.Add( hi );
+
+        return bounds;
+    }
+
+    // Inside the map's clip volume, with a margin for rounding
+    bool IsInside( const ShadowFrustum::Result& result, const float point[3] )
+    {
+        const float EPSILON = 1e-4f;
+
+        float viewProjection[16];
+        ShadowFrustum::Multiply( result.projection, result.view, viewProjection );
+
+        const float position[4] = { point[0], point[1], point[2], 1.0f };
+        float clip[4];
+        ShadowFrustum::Transform( viewProjection, position, clip );
+
+        return fabsf( clip[0] ) <= 1.0f + EPSILON && fabsf( clip[1] ) <= 1.0f + EPSILON && clip[2] >= -EPSILON && clip[2] <= 1.0f + EPSILON;
+    }
+
+    // Every corner of every cascade's slice of the view frustum lies inside that cascade's box
+    bool CheckFit()
+    {
+        const uint32_t MAP_SIZE = 2048;
+
+        const float eye[3]    = { 3.0f, 4.0f, -10.0f };
+        const float target[3] = { 0.0f, 0.0f, 5.0f };
+        const Camera camera( eye, target );
+
+        const ShadowFrustum::Input input = CreateInput( camera, CreateWorld() );
+
+        bool     bPassed = true;
+        uint32_t corners = 0;
+        for (uint32_t count = 1; count <= ShadowFrustum::MAX_CASCADES; ++count)
+        {
+            ShadowFrustum::Result results[ShadowFrustum::MAX_CASCADES];
+            float splits[ShadowFrustum::MAX_CASCADES + 1] = { NEAR_Z, FAR_Z };
+            bPassed &= ShadowFrustum::FitCascades( input, count, 0.5f, MAP_SIZE, results, splits ) == count;
+
+            for (uint32_t i = 0; i < count && bPassed; ++i)
+            {
+                uint32_t x, y, size;
+                ShadowFrustum::GetCascadeTile( i, count, MAP_SIZE, x, y, size );
+                bPassed &= results[i].bFitted && fabsf( results[i].texelsPerUnit * results[i].extent - size ) < 1e-2f;
+
+                // Both faces of the slice; neighbouring cascades share the split between them, so nothing falls in a gap
+                const float depths[2] = { splits[i], splits[i + 1] };
+                for (float depth : depths)
+                {
+                    float slice[4][3];
+                    camera.GetCorners( depth, slice );
+                    for (const float* corner : slice)
+                    {
+                        bPassed &= IsInside( results[i], corner );
+                        corners++;
+                    }
+                }
+            }
+
+            bPassed &= fabsf( splits[0] - NEAR_Z ) < 1e-3f && fabsf( splits[count] - FAR_Z ) < 1e-2f;
+        }
+
+        // Without a camera the box covers the whole of the receivers
+        ShadowFrustum::Input whole = input;
+        whole.pCameraView       = nullptr;
+        whole.pCameraProjection = nullptr;
+
+        ShadowFrustum::Result result;
+        float splits[ShadowFrustum::MAX_CASCADES + 1];
+        bPassed &= ShadowFrustum::FitCascades( whole, ShadowFrustum::MAX_CASCADES, 0.5f, MAP_SIZE, &result, splits ) == 1 && !result.bFitted;
+        for (int i = 0; i < 8; ++i)
+        {
+            const float corner[3] = { (i & 1) ? 200.0f : -200.0f, (i & 2) ? 200.0f : -200.0f, (i & 4) ? 200.0f : -200.0f };
+            bPassed &= IsInside( result, corner );
+        }
+
+        cout << "  fit check               " << (bPassed ? "passed" : "FAILED") << " (" << corners << " frustum corners inside their cascade)" << endl;
+
+        return bPassed;
+    }
+
+    // Texel position of a point in the map, whose fraction stays put while the box moves by whole texels
+    float GetTexelX( const ShadowFrustum::Result& result, uint32_t resolution, const float point[3] )
+    {
+        float viewProjection[16];
+        ShadowFrustum::Multiply( result.projection, result.view, viewProjection );
+
+        const float position[4] = { point[0], point[1], point[2], 1.0f };
+        float clip[4];
+        ShadowFrustum::Transform( viewProjection, position, clip );
+
+        return (clip[0] * 0.5f + 0.5f) * resolution;
+    }
+
+    // Camera moves of a fraction of a texel move the snapped box by whole texels or not at all, so the scene
+    // stays on the same texels; without snapping it slides across them
+    bool CheckSnap()
+    {
+        const uint32_t RESOLUTION = 1024;
+        const uint32_t MOVES      = 64;
+
+        const float target[3] = { 0.0f, 0.0f, 5.0f };
+        const float point[3]  = { 1.0f, 0.0f, 4.0f };
+
+        bool     bPassed        = true;
+        uint32_t unsnappedMoves = 0;
+        uint32_t snappedSteps   = 0;
+        for (int bSnap = 1; bSnap >= 0; --bSnap)
+        {
+            float firstFraction = 0.0f;
+            float lastLeft      = 0.0f;
+            float texelSize     = 0.0f;
+            for (uint32_t move = 0; move < MOVES; ++move)
+            {
+                // Well under a texel per move, as checked on the first fit
+                const float offset   = move * 0.004f;
+                const float eye[3]   = { 3.0f + offset, 4.0f, -10.0f + offset };
+                const float moved[3] = { target[0] + offset, target[1], target[2] + offset };
+                const Camera camera( eye, moved );
+
+                ShadowFrustum::Input input = CreateInput( camera, CreateWorld() );
+                input.resolution    = RESOLUTION;
+                input.sizeStep      = 1.0f;
+                input.bSnapToTexels = bSnap != 0;
+
+                ShadowFrustum::Result result;
+                bPassed &= ShadowFrustum::Fit( input, result );
+
+                // Left edge of the box along the light's x axis
+                const float xAxis[3] = { result.view[0], result.view[4], result.view[8] };
+                const float left     = Dot( result.origin, xAxis ) - 0.5f * result.extent;
+
+                const float texelX   = GetTexelX( result, RESOLUTION, point );
+                const float fraction = texelX - floorf( texelX );
+                if (move == 0)
+                {
+                    firstFraction = fraction;
+                    texelSize     = result.extent / RESOLUTION;
+                    bPassed &= 0.004f < 0.2f * texelSize;
+                }
+                else if (bSnap != 0)
+                {
+                    // The size never changes over such small moves, and the edge steps a whole texel at most
+                    const float steps = (left - lastLeft) / texelSize;
+                    bPassed &= result.extent / RESOLUTION == texelSize;
+                    bPassed &= fabsf( steps - roundf( steps ) ) < 1e-2f && fabsf( steps ) < 1.5f;
+                    bPassed &= fabsf( fraction - firstFraction ) < 1e-2f || fabsf( fabsf( fraction - firstFraction ) - 1.0f ) < 1e-2f;
+                    snappedSteps += roundf( steps ) != 0.0f ? 1 : 0;
+                }
+                else
+                {
+                    unsnappedMoves += fabsf( fraction - firstFraction ) > 1e-2f ? 1 : 0;
+                }
+
+                lastLeft = left;
+            }
+        }
+
+        bPassed &= unsnappedMoves > 0;
+
+        cout << "  snap check              " << (bPassed ? "passed" : "FAILED") << " (" << snappedSteps << " whole-texel steps in " << MOVES
+             << " moves, " << unsnappedMoves << " moves off the texel grid without snapping)" << endl;
+
+        return bPassed;
+    }
+
+    // Splits run from near to far in order, evenly for lambda 0 and geometrically for lambda 1
+    bool CheckSplits()
+    {
+        const float ranges[][2] = { { 0.5f, 50.0f }, { 0.1f, 1000.0f }, { 0.0f, 10.0f }, { 2.0f, 2.0f } };
+
+        bool bPassed = true;
+        for (const auto& range : ranges)
+        {
+            const float nearZ = range[0];
+            const float farZ  = range[1];
+
+            for (uint32_t count = 1; count <= ShadowFrustum::MAX_CASCADES; ++count)
+            {
+                const float lambdas[] = { 0.0f, 0.5f, 1.0f };
+                for (float lambda : lambdas)
+                {
+                    float splits[ShadowFrustum::MAX_CASCADES + 1];
+                    ShadowFrustum::ComputeSplits( nearZ, farZ, count, lambda, splits );
+
+                    bPassed &= splits[0] == nearZ && splits[count] == farZ;
+                    for (uint32_t i = 1; i <= count; ++i)
+                    {
+                        bPassed &= farZ > nearZ ? splits[i] > splits[i - 1] : splits[i] == splits[i - 1];
+                    }
+
+                    const float tolerance = 1e-4f * max( farZ, 1.0f );
+                    for (uint32_t i = 1; i < count; ++i)
+                    {
+                        const float t = static_cast<float>(i) / count;
+                        if (lambda == 0.0f)
+                            bPassed &= fabsf( splits[i] - (nearZ + (farZ - nearZ) * t) ) < tolerance;
+                        else if (lambda == 1.0f && nearZ > 0.0f)
+                            bPassed &= fabsf( splits[i] - nearZ * powf( farZ / nearZ, t ) ) < tolerance;
+                    }
+                }
+            }
+        }
+
+        cout << "  split check             " << (bPassed ? "passed" : "FAILED") << endl;
+
+        return bPassed;
+    }
+
+    // Tiles lie inside the atlas and never overlap, and a single cascade gets all of it
+    bool CheckTiles()
+    {
+        const uint32_t mapSizes[] = { 2048, 1024, 1023 };
+
+        bool bPassed = true;
+        for (uint32_t mapSize : mapSizes)
+        {
+            for (uint32_t count = 1; count <= ShadowFrustum::MAX_CASCADES; ++count)
+            {
+                uint32_t tiles[ShadowFrustum::MAX_CASCADES][3];
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    ShadowFrustum::GetCascadeTile( i, count, mapSize, tiles[i][0], tiles[i][1], tiles[i][2] );
+                    bPassed &= tiles[i][2] > 0 && tiles[i][0] + tiles[i][2] <= mapSize && tiles[i][1] + tiles[i][2] <= mapSize;
+
+                    for (uint32_t j = 0; j < i; ++j)
+                    {
+                        const bool bApartX = tiles[i][0] + tiles[i][2] <= tiles[j][0] || tiles[j][0] + tiles[j][2] <= tiles[i][0];
+                        const bool bApartY = tiles[i][1] + tiles[i][2] <= tiles[j][1] || tiles[j][1] + tiles[j][2] <= tiles[i][1];
+                        bPassed &= bApartX || bApartY;
+                    }
+                }
+
+                if (count == 1)
+                    bPassed &= tiles[0][0] == 0 && tiles[0][1] == 0 && tiles[0][2] == mapSize;
+            }
+        }
+
+        cout << "  tile check              " << (bPassed ? "passed" : "FAILED") << endl;
+
+        return bPassed;
+    }
+}
+
+bool Benchmark::RunShadowFrustum( uint32_t fitCount, uint32_t iterations )
+{
+    const uint32_t MAP_SIZE = 2048;
+
+    fitCount = max( 1u, fitCount );
+
+    cout << "ShadowFrustum: " << fitCount << " fits of " << ShadowFrustum::MAX_CASCADES << " cascades, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = CheckFit();
+    bSucceeded &= CheckSnap();
+    bSucceeded &= CheckSplits();
+    bSucceeded &= CheckTiles();
+
+    // A camera orbiting the scene, as the viewer fits every frame
+    vector<Camera> cameras;
+    for (uint32_t i = 0; i < 64; ++i)
+    {
+        const float angle     = 2.0f * PI * i / 64.0f;
+        const float eye[3]    = { 10.0f * cosf( angle ), 4.0f, 10.0f * sinf( angle ) };
+        const float target[3] = { 0.0f, 0.0f, 0.0f };
+        cameras.push_back( Camera( eye, target ) );
+    }
+
+    const float lo[3] = { -20.0f, -1.0f, -20.0f };
+    const float hi[3] = { 20.0f, 5.0f, 20.0f };
+    ShadowFrustum::Bounds bounds;
+    bounds.Add( lo );
+    bounds.Add( hi );
+
+    vector<double> times;
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        ShadowFrustum::Result results[ShadowFrustum::MAX_CASCADES];
+        float splits[ShadowFrustum::MAX_CASCADES + 1];
+
+        Benchmark::Timer timer;
+        for (uint32_t i = 0; i < fitCount; ++i)
+        {
+            ShadowFrustum::Input input = CreateInput( cameras[i % cameras.size()], bounds );
+            input.sizeStep = 2.0f;
+            bSucceeded &= ShadowFrustum::FitCascades( input, ShadowFrustum::MAX_CASCADES, 0.5f, MAP_SIZE, results, splits ) == ShadowFrustum::MAX_CASCADES;
+        }
+        times.push_back( timer.GetMilliseconds() );
+    }
+
+    const double fit = Benchmark::Record( "ShadowFrustum/fit cascades", times, fitCount );
+
+    cout << "  fit cascades            " << setw( 9 ) << fit << " ms (" << fit * 1000000.0 / fitCount << " ns per fit)" << endl;
+
+    return bSucceeded;
+}
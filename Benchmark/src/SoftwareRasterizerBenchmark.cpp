@@ -0,0 +1,344 @@
+#include "Benchmarks.h"
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    typedef SoftwareRasterizer SR;
+
+    const float PI = 3.14159265f;
+
+    struct MeshData
+    {
+        vector<SR::Vertex> vertices;
+        vector<uint16_t>   indices;
+    };
+
+    SR::Vertex MakeVertex( float x, float y, float z, float nx, float ny, float nz )
+    {
+        SR::Vertex v;
+        memset( &v, 0, sizeof( v ) );
+        v.position[0] = x;  v.position[1] = y;  v.position[2] = z;
+        v.normal[0]   = nx; v.normal[1]   = ny; v.normal[2]   = nz;
+        v.color[0] = v.color[1] = v.color[2] = v.color[3] = 1.0f;
+        return v;
+    }
+
+    // Same winding as the viewer's assets: clockwise seen from outside
+    void AddSphere( MeshData& mesh, float cx, float cy, float cz, float radius, uint32_t segments )
+    {
+        const uint32_t base = static_cast<uint32_t>(mesh.vertices.size());
+        for (uint32_t i = 0; i <= segments; ++i)
+        {
+            for (uint32_t j = 0; j <= segments; ++j)
+            {
+                const float theta = PI * i / segments;
+                const float phi   = 2.0f * PI * j / segments;
+                const float n[3]  = { sinf( theta ) * cosf( phi ), cosf( theta ), sinf( theta ) * sinf( phi ) };
+                mesh.vertices.push_back( MakeVertex( cx + radius * n[0], cy + radius * n[1], cz + radius * n[2], n[0], n[1], n[2] ) );
+            }
+        }
+
+        for (uint32_t i = 0; i < segments; ++i)
+        {
+            for (uint32_t j = 0; j < segments; ++j)
+            {
+                const uint16_t a = static_cast<uint16_t>(base + i * (segments + 1) + j);
+                const uint16_t b = static_cast<uint16_t>(a + segments + 1);
+                const uint16_t triangle[6] = { a, static_cast<uint16_t>(a + 1), b, static_cast<uint16_t>(a + 1), static_cast<uint16_t>(b + 1), b };
+                mesh.indices.insert( mesh.indices.end(), triangle, triangle + 6 );
+            }
+        }
+    }
+
+    void AddFloor( MeshData& mesh, float halfSize, float y )
+    {
+        const uint16_t base = static_cast<uint16_t>(mesh.vertices.size());
+        mesh.vertices.push_back( MakeVertex( -halfSize, y, -halfSize, 0.0f, 1.0f, 0.0f ) );
+        mesh.vertices.push_back( MakeVertex(  halfSize, y, -halfSize, 0.0f, 1.0f, 0.0f ) );
+        mesh.vertices.push_back( MakeVertex(  halfSize, y,  halfSize, 0.0f, 1.0f, 0.0f ) );
+        mesh.vertices.push_back( MakeVertex( -halfSize, y,  halfSize, 0.0f, 1.0f, 0.0f ) );
+
+        const uint16_t triangles[6] = { 0, 3, 2, 0, 2, 1 };
+        for (uint16_t index : triangles)
+        {
+            mesh.indices.push_back( static_cast<uint16_t>(base + index) );
+        }
+    }
+
+    // Positions, normals and triangulated faces only; meshes are split to stay within 16-bit indices
+    bool LoadObj( const string& path, vector<MeshData>& meshes )
+    {
+        ifstream file( path.c_str() );
+        if (!file)
+        {
+            cerr << "Failed to open " << path << endl;
+            return false;
+        }
+
+        vector<float> positions;
+        vector<float> normals;
+
+        MeshData mesh;
+        string   line;
+        while (getline( file, line ))
+        {
+            istringstream stream( line );
+            string        type;
+            stream >> type;
+
+            if (type == "v" || type == "vn")
+            {
+                float x = 0.0f, y = 0.0f, z = 0.0f;
+                stream >> x >> y >> z;
+
+                vector<float>& target = type == "v" ? positions : normals;
+                target.push_back( x );
+                target.push_back( y );
+                target.push_back( z );
+            }
+            else if (type == "f")
+            {
+                vector<SR::Vertex> face;
+                string             token;
+                while (stream >> token)
+                {
+                    int position = 0, texCoord = 0, normal = 0;
+                    if (sscanf( token.c_str(), "%d/%d/%d", &position, &texCoord, &normal ) != 3)
+                    {
+                        texCoord = 0;
+                        normal   = 0;
+                        if (sscanf( token.c_str(), "%d//%d", &position, &normal ) != 2)
+                            sscanf( token.c_str(), "%d", &position );
+                    }
+
+                    const size_t p = position > 0 ? static_cast<size_t>(position - 1) : positions.size() / 3 + position;
+                    const size_t n = normal > 0 ? static_cast<size_t>(normal - 1) : normals.size() / 3 + normal;
+                    if (p * 3 + 2 >= positions.size())
+                        continue;
+
+                    const bool bNormal = normal != 0 && n * 3 + 2 < normals.size();
+                    face.push_back( MakeVertex( positions[p * 3], positions[p * 3 + 1], positions[p * 3 + 2],
+                                                bNormal ? normals[n * 3] : 0.0f, bNormal ? normals[n * 3 + 1] : 1.0f, bNormal ? normals[n * 3 + 2] : 0.0f ) );
+                }
+
+                if (face.size() < 3)
+                    continue;
+
+                if (mesh.vertices.size() + face.size() > 0xffff)
+                {
+                    meshes.push_back( mesh );
+                    mesh = MeshData();
+                }
+
+                const uint16_t base = static_cast<uint16_t>(mesh.vertices.size());
+                mesh.vertices.insert( mesh.vertices.end(), face.begin(), face.end() );
+                for (size_t i = 1; i + 1 < face.size(); ++i)
+                {
+                    mesh.indices.push_back( base );
+                    mesh.indices.push_back( static_cast<uint16_t>(base + i) );
+                    mesh.indices.push_back( static_cast<uint16_t>(base + i + 1) );
+                }
+            }
+        }
+
+        if (!mesh.indices.empty())
+            meshes.push_back( mesh );
+
+        return true;
+    }
+
+    // Grid of spheres over a floor, inside the viewer's default light frustum
+    void CreateScene( vector<MeshData>& meshes, uint32_t sphereCount )
+    {
+        const float GRID_SIZE = 3.0f;
+
+        MeshData floor;
+        AddFloor( floor, 2.5f, -1.0f );
+        meshes.push_back( floor );
+
+        const uint32_t columns = static_cast<uint32_t>(ceil( sqrt( static_cast<float>(sphereCount) ) ));
+        const float    spacing = columns > 0 ? GRID_SIZE / columns : 0.0f;
+        for (uint32_t i = 0; i < sphereCount; ++i)
+        {
+            MeshData sphere;
+            const float x = -0.5f * GRID_SIZE + spacing * (i % columns + 0.5f);
+            const float z = -0.5f * GRID_SIZE + spacing * (i / columns + 0.5f);
+            AddSphere( sphere, x, -1.0f + spacing * 0.4f, z, spacing * 0.4f, 64 );
+            meshes.push_back( sphere );
+        }
+    }
+
+    // Light::UpdateLightData() and App::CreateScene()
+    void CreateViews( uint32_t width, uint32_t height, SR::LightConstants& light, SR::TransformConstants& transform )
+    {
+        memset( &light, 0, sizeof( light ) );
+        memset( &transform, 0, sizeof( transform ) );
+
+        const float up[3]        = { 0.0f, 1.0f, 0.0f };
+        const float lightEye[3]  = { 0.0f, 5.0f, 0.0f };
+        const float lightDir[3]  = { 0.0f, -0.70710678f, -0.70710678f };
+        const float cameraEye[3] = { 0.0f, 0.0f, 5.0f };
+        const float target[3]    = { 0.0f, 0.0f, 0.0f };
+
+        light.position[1] = 5.0f;
+        light.position[3] = 1.0f;
+        for (int i = 0; i < 4; ++i)
+        {
+            light.color[i] = 1.0f;
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            light.direction[i] = lightDir[i];
+            light.intensity[i] = 1.0f;
+        }
+
+        const float size = 1.86523065f * 5;
+        SR::CreateLookAtLH( lightEye, lightDir, up, light.view );
+        SR::CreateOrthographicLH( -0.5f * size, 0.5f * size, -0.5f * size, 0.5f * size, 1.0f, 100.0f, light.projection );
+
+        for (int i = 0; i < 4; ++i)
+        {
+            transform.world[i * 5] = 1.0f;
+        }
+        SR::CreateLookAtLH( cameraEye, target, up, transform.view );
+        SR::CreatePerspectiveFovLH( 50.0f * PI / 180.0f, static_cast<float>(width) / height, 1.0f, 100.0f, transform.projection );
+    }
+
+    uint32_t Hash( const SR::ColorTarget& color, const SR::DepthTarget& depth )
+    {
+        uint32_t hash = 2166136261u;
+        for (uint32_t pixel : color.data)
+        {
+            hash = (hash ^ pixel) * 16777619u;
+        }
+        for (float value : depth.data)
+        {
+            uint32_t bits;
+            memcpy( &bits, &value, sizeof( bits ) );
+            hash = (hash ^ bits) * 16777619u;
+        }
+        return hash;
+    }
+}
+
+bool Benchmark::RunSoftwareRasterizer( const SoftwareRasterizerOptions& options )
+{
+    vector<MeshData> meshData;
+    if (options.objPath.empty())
+        CreateScene( meshData, options.sphereCount );
+    else if (!LoadObj( options.objPath, meshData ))
+        return false;
+
+    vector<SR::Mesh> meshes;
+    for (const MeshData& data : meshData)
+    {
+        SR::Mesh mesh;
+        mesh.pVertices   = data.vertices.data();
+        mesh.vertexCount = static_cast<uint32_t>(data.vertices.size());
+        mesh.pIndices    = data.indices.data();
+        mesh.indexCount  = static_cast<uint32_t>(data.indices.size());
+
+        const SR::MaterialConstants material = { { 0.1f, 0.1f, 0.1f, 1.0f }, { 0.5f, 0.5f, 0.5f, 1.0f }, { 1.0f, 1.0f, 1.0f, 50.0f } };
+        mesh.material = material;
+        meshes.push_back( mesh );
+    }
+
+    SR::LightConstants     light;
+    SR::TransformConstants transform;
+    CreateViews( options.width, options.height, light, transform );
+
+    // 1, 2, 4, ... up to the hardware concurrency, which is always measured
+    const uint32_t maxThreads = max( 1u, thread::hardware_concurrency() );
+    vector<uint32_t> threadCounts;
+    for (uint32_t count = 1; count < maxThreads; count *= 2)
+    {
+        threadCounts.push_back( count );
+    }
+    threadCounts.push_back( maxThreads );
+
+    cout << "Software rasterizer: " << options.width << "x" << options.height << ", shadow map " << options.shadowMapSize
+         << ", " << meshes.size() << " meshes" << endl;
+    cout << setw( 8 ) << "threads" << setw( 12 ) << "pass" << setw( 12 ) << "ms" << setw( 12 ) << "setup ms"
+         << setw( 12 ) << "MP/s" << setw( 14 ) << "Mtris/s" << setw( 12 ) << "speedup" << endl;
+
+    bool     bSucceeded    = true;
+    uint32_t referenceHash = 0;
+    double   baseTimes[2]  = { 0.0, 0.0 };
+
+    SR::DepthTarget shadowMap( options.shadowMapSize, options.shadowMapSize );
+    SR::ColorTarget color( options.width, options.height );
+    SR::DepthTarget depth( options.width, options.height );
+
+    for (uint32_t threadCount : threadCounts)
+    {
+        SR rasterizer( threadCount );
+
+        // Median of the iterations for each pass
+        vector<double>     times[2];
+        SR::Statistics     statistics[2];
+        for (uint32_t i = 0; i < options.iterations; ++i)
+        {
+            shadowMap.Clear( 1.0f );
+            bSucceeded &= rasterizer.RenderShadow( light, meshes, shadowMap );
+            statistics[0] = rasterizer.GetStatistics();
+            times[0].push_back( statistics[0].TotalMilliseconds() );
+
+            color.Clear( 1.0f, 1.0f, 1.0f );
+            depth.Clear( 1.0f );
+            bSucceeded &= rasterizer.RenderForward( transform, light, shadowMap, meshes, color, depth );
+            statistics[1] = rasterizer.GetStatistics();
+            times[1].push_back( statistics[1].TotalMilliseconds() );
+        }
+
+        const char*    passNames[2] = { "shadow", "forward" };
+        const uint64_t pixels[2]    = { static_cast<uint64_t>(options.shadowMapSize) * options.shadowMapSize,
+                                        static_cast<uint64_t>(options.width) * options.height };
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            const string   name         = string( "SoftwareRasterizer/" ) + passNames[pass] + "/" + to_string( threadCount ) + " threads";
+            const double   milliseconds = max( Benchmark::Record( name, times[pass], pixels[pass] ), 1e-6 );
+            if (threadCount == threadCounts.front())
+                baseTimes[pass] = milliseconds;
+
+            cout << setw( 8 ) << threadCount << setw( 12 ) << passNames[pass]
+                 << setw( 12 ) << fixed << setprecision( 2 ) << milliseconds
+                 << setw( 12 ) << statistics[pass].setupMilliseconds
+                 << setw( 12 ) << pixels[pass] / (milliseconds * 1000.0)
+                 << setw( 14 ) << statistics[pass].triangles / (milliseconds * 1000.0)
+                 << setw( 11 ) << baseTimes[pass] / milliseconds << "x" << endl;
+        }
+
+        // Tiles always walk their triangles in submission order, so every thread count has to match
+        const uint32_t hash = Hash( color, shadowMap );
+        if (threadCount == threadCounts.front())
+            referenceHash = hash;
+        else if (hash != referenceHash)
+        {
+            cerr << "Software rasterizer output differs with " << threadCount << " threads" << endl;
+            bSucceeded = false;
+        }
+    }
+
+    if (!options.outputPath.empty())
+    {
+        bSucceeded &= SR::SaveColor( color, options.outputPath + ".ppm" );
+        bSucceeded &= SR::SaveDepth( shadowMap, options.outputPath + "_shadow.pgm" );
+        cout << "Wrote " << options.outputPath << ".ppm and " << options.outputPath << "_shadow.pgm" << endl;
+    }
+
+    return bSucceeded;
+}
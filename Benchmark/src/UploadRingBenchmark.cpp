@@ -0,0 +1,249 @@
+#include "Benchmarks.h"
+#include "ConstantUpload.h"
+#include "UploadRingAllocator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Any address works for the GPU side, as long as it keeps the alignment
+    const uint64_t GPU_BASE = 0x10000000;
+
+    struct Live
+    {
+        uint64_t fenceValue;    // frame the allocation was made in
+        uint64_t offset;        // in the buffer
+        uint32_t size;
+    };
+
+    // Alignment, no allocation straddling the end, a full ring failing, and space handed out again only once the
+    // frame that used it has completed
+    bool CheckRing()
+    {
+        const uint64_t CAPACITY  = 4096;
+        const uint32_t ALIGNMENT = 256;
+
+        vector<unsigned char> memory( CAPACITY );
+        unsigned char* pBase = memory.data();
+
+        bool bPassed = true;
+
+        // Sizes round up to the alignment, and the last block before the end is skipped rather than split
+        {
+            UploadRingAllocator ring( pBase, GPU_BASE, CAPACITY, ALIGNMENT );
+
+            const UploadRingAllocator::Allocation first = ring.Allocate( 1 );
+            bPassed &= first.IsValid() && first.size == ALIGNMENT && first.pCPU == pBase && first.gpuAddress == GPU_BASE;
+            bPassed &= !ring.Allocate( 0 ).IsValid() && !ring.Allocate( CAPACITY + 1 ).IsValid();
+
+            const UploadRingAllocator::Allocation middle = ring.Allocate( 2 * ALIGNMENT + 1 );
+            bPassed &= middle.size == 3 * ALIGNMENT && middle.virtualOffset == ALIGNMENT;
+            ring.EndFrame( 1 );
+            ring.Reclaim( 1 );
+
+            // 1024 bytes used of 4096, then 2560 up to 3584, so 1024 more would cross the end
+            bPassed &= ring.Allocate( 2560 ).virtualOffset == 1024;
+            const UploadRingAllocator::Allocation wrapped = ring.Allocate( 1024 );
+            bPassed &= wrapped.IsValid() && wrapped.virtualOffset == CAPACITY && wrapped.pCPU == pBase && wrapped.gpuAddress == GPU_BASE;
+
+            // The frame's own allocations hold the rest, so the ring is full until it completes
+            bPassed &= !ring.Allocate( ALIGNMENT ).IsValid() && ring.GetStatistics().failures == 3;
+            ring.EndFrame( 2 );
+            ring.Reclaim( 1 );
+            bPassed &= !ring.Allocate( ALIGNMENT ).IsValid();
+            ring.Reclaim( 2 );
+            bPassed &= ring.Allocate( ALIGNMENT ).IsValid() && ring.GetStatistics().usedBytes == ALIGNMENT;
+        }
+
+        // Random frames completing three frames late: every allocation aligned, inside the buffer and clear of all
+        // space a frame still in flight uses
+        UploadRingAllocator ring( pBase, GPU_BASE, CAPACITY, ALIGNMENT );
+        mt19937      random( 3 );
+        vector<Live> live;
+        uint32_t     failures   = 0;
+        uint32_t     wraps      = 0;
+        uint64_t     lastOffset = 0;
+        for (uint64_t frame = 1; frame <= 2000 && bPassed; ++frame)
+        {
+            const uint64_t completed = frame > 3 ? frame - 3 : 0;
+            ring.Reclaim( completed );
+            live.erase( remove_if( live.begin(), live.end(), [=]( const Live& l ) { return l.fenceValue <= completed; } ), live.end() );
+
+            const uint32_t count = random() % 6;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const UploadRingAllocator::Allocation allocation = ring.Allocate( 1 + random() % 700 );
+                if (!allocation.IsValid())
+                {
+                    failures++;
+                    continue;
+                }
+
+                const uint64_t offset = static_cast<unsigned char*>(allocation.pCPU) - pBase;
+                bPassed &= offset % ALIGNMENT == 0 && offset + allocation.size <= CAPACITY;
+                bPassed &= allocation.gpuAddress == GPU_BASE + offset && allocation.virtualOffset % CAPACITY == offset;
+                for (const Live& l : live)
+                {
+                    bPassed &= offset + allocation.size <= l.offset || l.offset + l.size <= offset;
+                }
+
+                wraps     += offset < lastOffset ? 1 : 0;
+                lastOffset = offset;
+
+                const Live l = { frame, offset, allocation.size };
+                live.push_back( l );
+            }
+
+            ring.EndFrame( frame );
+        }
+
+        bPassed &= failures > 0 && wraps > 0;
+
+        cout << "  ring check              " << (bPassed ? "passed" : "FAILED") << " (" << wraps << " wraps, " << failures
+             << " allocations failed on a full ring)" << endl;
+
+        return bPassed;
+    }
+
+    // Clean constants keep their copy while it is recent, get a new one once it is too old, and keep the old one
+    // when the ring is full
+    bool CheckConstantUpload()
+    {
+        const uint64_t CAPACITY  = 4096;
+        const uint32_t ALIGNMENT = 256;
+
+        vector<unsigned char> memory( CAPACITY );
+        unsigned char* pBase = memory.data();
+
+        UploadRingAllocator ring( pBase, GPU_BASE, CAPACITY, ALIGNMENT );
+        ConstantUpload      constants;
+
+        float data[16] = { 1.0f };
+
+        auto holds = [&]( const float* pData ) { return memcmp( pBase + (constants.GetGPUAddress() - GPU_BASE), pData, sizeof( data ) ) == 0; };
+
+        // Frame 1 writes, frame 2 references the same copy and keeps it alive past frame 1
+        bool bPassed = constants.Update( ring, data, sizeof( data ) ) && !constants.IsDirty();
+        const uint64_t firstAddress = constants.GetGPUAddress();
+        ring.EndFrame( 1 );
+
+        bPassed &= !constants.Update( ring, data, sizeof( data ) ) && constants.GetGPUAddress() == firstAddress;
+        bPassed &= ring.GetStatistics().reuses == 1;
+        ring.EndFrame( 2 );
+        ring.Reclaim( 1 );
+        bPassed &= ring.GetStatistics().usedBytes == ALIGNMENT;
+        ring.Reclaim( 2 );
+        bPassed &= ring.GetStatistics().usedBytes == 0;
+
+        // Half a ring later the copy is too old to reference, so it is written again though clean
+        bPassed &= ring.Allocate( CAPACITY / 2 ).IsValid();
+        bPassed &= constants.Update( ring, data, sizeof( data ) ) && constants.GetGPUAddress() != firstAddress && holds( data );
+        const uint64_t secondAddress = constants.GetGPUAddress();
+
+        // A full ring fails the write: the previous copy stays bound and the data stays dirty for the next frame
+        while (ring.Allocate( ALIGNMENT ).IsValid())
+        {
+        }
+
+        const float previous[16] = { 1.0f };
+        data[0] = 2.0f;
+        constants.MarkDirty();
+        bPassed &= !constants.Update( ring, data, sizeof( data ) ) && constants.IsDirty();
+        bPassed &= constants.GetGPUAddress() == secondAddress && holds( previous );
+        ring.EndFrame( 3 );
+        ring.Reclaim( 3 );
+
+        bPassed &= constants.Update( ring, data, sizeof( data ) ) && !constants.IsDirty() && holds( data );
+
+        cout << "  constant upload check   " << (bPassed ? "passed" : "FAILED") << " (" << ring.GetStatistics().reuses << " reuses, "
+             << ring.GetStatistics().failures << " failed allocations)" << endl;
+
+        return bPassed;
+    }
+}
+
+bool Benchmark::RunUploadRing( uint32_t allocationCount, uint32_t iterations )
+{
+    // Constant buffers of a frame, completing two frames late as with the viewer's swap chain
+    const uint64_t CAPACITY          = 16 * 1024 * 1024;
+    const uint32_t CONSTANT_SIZE     = 256;
+    const uint32_t FRAME_ALLOCATIONS = 1000;
+    const uint64_t FRAME_LATENCY     = 2;
+
+    allocationCount = max( 1u, allocationCount );
+
+    cout << "UploadRing: " << allocationCount << " allocations of " << CONSTANT_SIZE << " bytes, median of " << iterations << " runs" << endl;
+    cout << fixed << setprecision( 3 );
+
+    bool bSucceeded = CheckRing();
+    bSucceeded &= CheckConstantUpload();
+
+    vector<unsigned char> memory( CAPACITY );
+    vector<unsigned char> data( CONSTANT_SIZE, 0 );
+    vector<ConstantUpload> constants( FRAME_ALLOCATIONS );
+
+    vector<double> allocateTimes, cleanTimes;
+    for (uint32_t n = 0; n < iterations; ++n)
+    {
+        // Fresh data for every draw, every frame
+        {
+            UploadRingAllocator ring( memory.data(), GPU_BASE, CAPACITY );
+
+            Benchmark::Timer timer;
+            uint64_t frame = 1;
+            for (uint32_t i = 0; i < allocationCount; ++i)
+            {
+                if (i % FRAME_ALLOCATIONS == 0)
+                {
+                    ring.EndFrame( frame );
+                    ring.Reclaim( frame > FRAME_LATENCY ? frame - FRAME_LATENCY : 0 );
+                    frame++;
+                }
+
+                bSucceeded &= ring.Allocate( CONSTANT_SIZE ).IsValid();
+            }
+            allocateTimes.push_back( timer.GetMilliseconds() );
+        }
+
+        // The same draws with constants that do not change, referencing their copies again
+        {
+            UploadRingAllocator ring( memory.data(), GPU_BASE, CAPACITY );
+            for (auto& constant : constants)
+            {
+                constant.MarkDirty();
+            }
+
+            Benchmark::Timer timer;
+            uint64_t frame = 1;
+            for (uint32_t i = 0; i < allocationCount; ++i)
+            {
+                if (i % FRAME_ALLOCATIONS == 0)
+                {
+                    ring.EndFrame( frame );
+                    ring.Reclaim( frame > FRAME_LATENCY ? frame - FRAME_LATENCY : 0 );
+                    frame++;
+                }
+
+                constants[i % FRAME_ALLOCATIONS].Update( ring, data.data(), CONSTANT_SIZE );
+            }
+            cleanTimes.push_back( timer.GetMilliseconds() );
+
+            bSucceeded &= ring.GetStatistics().failures == 0 && ring.GetStatistics().highWaterBytes <= (FRAME_LATENCY + 2) * FRAME_ALLOCATIONS * CONSTANT_SIZE;
+        }
+    }
+
+    const double allocate = Benchmark::Record( "UploadRing/allocate", allocateTimes, allocationCount );
+    const double clean    = Benchmark::Record( "UploadRing/clean update", cleanTimes, allocationCount );
+
+    cout << "  allocate                " << setw( 9 ) << allocate << " ms (" << allocate * 1000000.0 / allocationCount << " ns per allocation)" << endl;
+    cout << "  clean update            " << setw( 9 ) << clean << " ms (" << clean * 1000000.0 / allocationCount << " ns per update)" << endl;
+
+    return bSucceeded;
+}
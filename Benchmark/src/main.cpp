@@ -0,0 +1,146 @@
+#include "Benchmarks.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main( int argc, char* argv[] )
+{
+    uint32_t drawItemCount = 1000000;
+    uint32_t iterations    = 10;
+    uint32_t maxLightCount = 65536;
+    uint32_t mathItemCount = 1000000;
+    uint32_t inputFrames   = 120;
+    uint32_t scopeCount    = 10000000;
+    uint32_t gpuFrames     = 100000;
+    uint32_t allocations   = 1000000;
+    uint32_t objectCount   = 1000000;
+    uint32_t frameCount    = 10000000;
+    uint32_t jobCount      = 1000000;
+    uint32_t pipelineCount = 64;
+    uint32_t shaderCount   = 64;
+    uint32_t fitCount      = 100000;
+    string   jsonPath;
+
+    Benchmark::SoftwareRasterizerOptions rasterizerOptions;
+    Benchmark::SceneOptions              sceneOptions;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp( argv[i], "--draw-items" ) == 0 && i + 1 < argc)
+            drawItemCount = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--iterations" ) == 0 && i + 1 < argc)
+            iterations = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--raster-size" ) == 0 && i + 2 < argc)
+        {
+            rasterizerOptions.width  = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+            rasterizerOptions.height = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        }
+        else if (strcmp( argv[i], "--shadow-size" ) == 0 && i + 1 < argc)
+            rasterizerOptions.shadowMapSize = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--spheres" ) == 0 && i + 1 < argc)
+            rasterizerOptions.sphereCount = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--obj" ) == 0 && i + 1 < argc)
+            rasterizerOptions.objPath = sceneOptions.objPath = argv[++i];
+        else if (strcmp( argv[i], "--raster-output" ) == 0 && i + 1 < argc)
+            rasterizerOptions.outputPath = argv[++i];
+        else if (strcmp( argv[i], "--lights" ) == 0 && i + 1 < argc)
+            maxLightCount = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--math-items" ) == 0 && i + 1 < argc)
+            mathItemCount = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--input-frames" ) == 0 && i + 1 < argc)
+            inputFrames = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--scopes" ) == 0 && i + 1 < argc)
+            scopeCount = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--gpu-frames" ) == 0 && i + 1 < argc)
+            gpuFrames = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--allocations" ) == 0 && i + 1 < argc)
+            allocations = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--nodes" ) == 0 && i + 1 < argc)
+            sceneOptions.nodeCount = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--camera-updates" ) == 0 && i + 1 < argc)
+            sceneOptions.cameraUpdates = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--objects" ) == 0 && i + 1 < argc)
+            objectCount = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--frames" ) == 0 && i + 1 < argc)
+            frameCount = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--jobs" ) == 0 && i + 1 < argc)
+            jobCount = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--pipelines" ) == 0 && i + 1 < argc)
+            pipelineCount = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--shaders" ) == 0 && i + 1 < argc)
+            shaderCount = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--fits" ) == 0 && i + 1 < argc)
+            fitCount = static_cast<uint32_t>(strtoul( argv[++i], nullptr, 10 ));
+        else if (strcmp( argv[i], "--json" ) == 0 && i + 1 < argc)
+            jsonPath = argv[++i];
+        else
+        {
+            cerr << "usage: Benchmark [--draw-items N] [--iterations N] [--raster-size W H] [--shadow-size N]" << endl
+                 << "                 [--spheres N] [--obj path] [--raster-output path] [--lights N]" << endl
+                 << "                 [--math-items N] [--input-frames N] [--scopes N]" << endl
+                 << "                 [--gpu-frames N] [--allocations N] [--nodes N] [--camera-updates N]" << endl
+                 << "                 [--objects N] [--frames N] [--jobs N] [--pipelines N] [--shaders N]" << endl
+                 << "                 [--fits N] [--json path]" << endl;
+            return 1;
+        }
+    }
+
+    bool bSucceeded = true;
+
+    bSucceeded &= Benchmark::RunShaderCache( shaderCount, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunDescriptorAllocator( allocations, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunUploadRing( allocations, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunDrawSort( drawItemCount, iterations > 0 ? iterations : 1 );
+
+    rasterizerOptions.iterations = iterations > 0 ? iterations : 1;
+    bSucceeded &= Benchmark::RunSoftwareRasterizer( rasterizerOptions );
+
+    bSucceeded &= Benchmark::RunShadowFrustum( fitCount, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunLightClusters( maxLightCount, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunBatchMath( mathItemCount, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunInputSampler( inputFrames, 16.0 );
+
+    bSucceeded &= Benchmark::RunProfiler( scopeCount, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunGpuTimer( gpuFrames, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunMemoryTracker( allocations, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunFrameScheduler( frameCount, iterations > 0 ? iterations : 1 );
+
+    sceneOptions.iterations = iterations > 0 ? iterations : 1;
+    bSucceeded &= Benchmark::RunScene( sceneOptions );
+
+    bSucceeded &= Benchmark::RunSceneGenerator( objectCount, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunFrameStatistics( frameCount, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunFrameArena( allocations, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunBufferSuballocator( allocations, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunJobSystem( jobCount, iterations > 0 ? iterations : 1 );
+
+    bSucceeded &= Benchmark::RunPipelineCompiler( pipelineCount, iterations > 0 ? iterations : 1 );
+
+    // Written even when a check failed, so the failing run can be compared too
+    if (!jsonPath.empty())
+    {
+        if (Benchmark::WriteResults( jsonPath ))
+            cout << "Wrote " << Benchmark::GetResults().size() << " results to " << jsonPath << endl;
+        else
+            bSucceeded = false;
+    }
+
+    return bSucceeded ? 0 : 1;
+}
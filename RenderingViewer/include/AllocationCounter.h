@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts global heap allocations, for checking that a frame in steady state allocates nothing.
+// Independent of D3D.
+//
+// The counter replaces the global operator new and delete of the program it is linked into and forwards
+// them to malloc and free, so it sees every allocation through new, the standard containers included.
+// Counting is two relaxed atomic adds and a thread-local add per allocation.
+//
+// Opt-in: only builds defining ALLOCATION_COUNTER_ENABLED replace the operators, which the Benchmark
+// project and the viewer's Debug configurations do. Elsewhere the global operators are left alone, every
+// count is zero and Scope compiles to nothing.
+class AllocationCounter
+{
+public:
+#ifdef ALLOCATION_COUNTER_ENABLED
+    // Counts since a point of the program, for the calling thread or all of them
+    class Scope
+    {
+    public:
+        Scope()
+            : m_count( AllocationCounter::GetCount() )
+            , m_bytes( AllocationCounter::GetBytes() )
+            , m_threadCount( AllocationCounter::GetThreadCount() )
+        {
+        }
+
+        uint64_t GetCount() const { return AllocationCounter::GetCount() - m_count; }
+        uint64_t GetBytes() const { return AllocationCounter::GetBytes() - m_bytes; }
+        uint64_t GetThreadCount() const { return AllocationCounter::GetThreadCount() - m_threadCount; }
+
+    private:
+        uint64_t m_count;
+        uint64_t m_bytes;
+        uint64_t m_threadCount;
+    };
+#else
+    class Scope
+    {
+    public:
+        Scope() {}
+
+        uint64_t GetCount() const { return 0; }
+        uint64_t GetBytes() const { return 0; }
+        uint64_t GetThreadCount() const { return 0; }
+    };
+#endif
+
+public:
+    // False when compiled out, so checks built on the counts can tell they would pass vacuously
+    static bool IsEnabled();
+
+    // Allocations and requested bytes since the program started, on all threads
+    static uint64_t GetCount();
+    static uint64_t GetBytes();
+
+    // Allocations the calling thread made
+    static uint64_t GetThreadCount();
+};
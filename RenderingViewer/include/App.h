@@ -10,8 +10,15 @@ public:
     ~App();
 
 public: // Process
+    // One loop iteration: polls input and renders a frame only when something changed
     bool Run();
 
+    // Window events that need a new frame
+    void Invalidate( uint32_t reasons ) { m_scheduler.Invalidate( reasons ); }
+
+    // How long the message loop may sleep before calling Run again
+    uint32_t GetWaitMilliseconds() const { return m_scheduler.GetWaitMilliseconds(); }
+
     bool Initialize();
     void Terminate();
 
@@ -39,11 +46,21 @@ protected:
 
     void Present( unsigned int syncInterval );
 
+    // allocations: global heap allocations of the frame
+    void AddFrameStatistics( uint64_t allocations );
+    void OutputStatistics();
+
     void WaitDrawCommandDone();
     void ResetFrame();
 
     void ProcessInput();
 
+    // Moves the camera to the state and updates its view matrix
+    void UpdateViewMatrix( const OrbitCamera::State& camera );
+
+    // Invalidates the scheduler for camera, light and model changes since the last call
+    void TrackChanges();
+
 protected:
     HWND m_hWnd;
     HINSTANCE m_hInst;
@@ -74,9 +91,25 @@ protected:
 
     shared_ptr<Camera>          m_pCamera;
     shared_ptr<Light>           m_pLight;
+    shared_ptr<ClusteredLights> m_pLightClusters;
+
+    shared_ptr<PipelineCache>                 m_pPipelineCache;
+    shared_ptr<GlobalDescriptorHeap>          m_pDescHeap;
+    shared_ptr<UploadRing>                    m_pUploadRing;
+    shared_ptr<GeometryHeap>                  m_pGeometryHeap;
+    shared_ptr<GpuTimestampHeap>              m_pGpuTimestamps;
+    shared_ptr<GpuTimer>                      m_pGpuTimer;
+    shared_ptr<FrameArena>                    m_pFrameArena;
+
+    // Device memory created by the App itself; the rest is tracked by the objects that own it
+    unique_ptr<DeviceMemoryBackend>           m_pMemoryBackend;
+    MemoryTracker::Handle                     m_rtvHeapMemory;
+    MemoryTracker::Handle                     m_backBufferMemory[2];
+    MemoryTracker::Handle                     m_dsvHeapMemory;
+    MemoryTracker::Handle                     m_depthMemory;
+    MemoryTracker::Handle                     m_shadowMapMemory;
 
     shared_ptr<RenderPassClear>               m_pRenderPassClear;
-    shared_ptr<RenderPassClear>               m_pRenderPassClearShadow;
     shared_ptr<RenderPassForward>             m_pRenderPassForward;
     shared_ptr<RenderPassShadow>              m_pRenderPassShadow;
 
@@ -89,9 +122,20 @@ protected:
 
     UINT m_swapChainCount;
 
-    bool m_isInit;
+    UINT64 m_frameCount;
+
+    // Percentiles over the last FrameStatistics window, reported with the other statistics
+    FrameStatistics m_frameStatistics;
+
+    FrameScheduler m_scheduler;
+    UINT64         m_cameraVersion;
+    UINT64         m_lightVersion;
+    UINT64         m_sceneVersion;
 
-    bool m_bUpdateCB;
+    bool   m_bCompilingPipelines;   // the scheduler counts it as pending work
+    UINT64 m_fallbackFrames;        // drawn while a pipeline was still being created
+
+    bool m_isInit;
 
     unique_ptr<InputManager> m_inputManager;
 };
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Matrix, point, box and plane math over many items at once. Independent of D3D.
+//
+// Matrices are 16 floats in the layout the shaders read (column_major packing, mul( M, v )), as in
+// ShadowFrustum. Points and boxes are structure-of-arrays. Every function has a scalar path and SSE2 and
+// AVX2 paths picked at run time; the SIMD paths do the same operations in the same order as the scalar
+// one, without fused multiply-add, so all paths return bit-for-bit identical results.
+class BatchMath
+{
+public:
+    enum PATH
+    {
+        PATH_SCALAR,
+        PATH_SSE2,
+        PATH_AVX2,
+
+        PATH_BEST,  // widest path the build and the processor support
+    };
+
+    // Boxes as arrays of x, y and z components
+    struct ConstBoxes
+    {
+        const float* min[3];
+        const float* max[3];
+    };
+
+    struct Boxes
+    {
+        float* min[3];
+        float* max[3];
+    };
+
+public:
+    static PATH GetBestPath();
+    static const char* GetPathName( PATH path );
+
+    // out = a * b, applying b first. out may alias a or b.
+    static void Multiply( const float a[16], const float b[16], float out[16], PATH path = PATH_BEST );
+
+    // out[i] = a * b[i] for arrays of 16-float matrices
+    static void MultiplyArray( const float a[16], const float* b, float* out, size_t count, PATH path = PATH_BEST );
+
+    // Inverse of a matrix whose bottom row is 0 0 0 1, e.g. a view or world matrix. Returns false when it is singular.
+    static bool InvertAffine( const float m[16], float out[16], PATH path = PATH_BEST );
+
+    // Returns the number of singular matrices; their results are not finite
+    static size_t InvertAffineArray( const float* m, float* out, size_t count, PATH path = PATH_BEST );
+
+    // Points with w 1, the bottom row of m is ignored. The outputs may alias the inputs.
+    static void TransformPoints( const float m[16], const float* x, const float* y, const float* z, size_t count,
+                                 float* outX, float* outY, float* outZ, PATH path = PATH_BEST );
+
+    // Axis-aligned boxes around the transformed boxes
+    static void TransformBoxes( const float m[16], const ConstBoxes& boxes, size_t count, const Boxes& out, PATH path = PATH_BEST );
+
+    // Planes are 4 floats a, b, c, d with the inside where a x + b y + c z + d >= 0. pVisible[i] is 1 unless the
+    // sphere or box lies entirely outside one of the planes. Return the number of visible ones.
+    static size_t TestSpheres( const float* planes, uint32_t planeCount, const float* x, const float* y, const float* z, const float* radius,
+                               size_t count, uint8_t* pVisible, PATH path = PATH_BEST );
+    static size_t TestBoxes( const float* planes, uint32_t planeCount, const ConstBoxes& boxes, size_t count, uint8_t* pVisible, PATH path = PATH_BEST );
+
+    // Left, right, bottom, top, near and far planes of a D3D clip space (z in [0, 1]), normalized so the
+    // sphere test gets distances in world units
+    static void GetFrustumPlanes( const float viewProjection[16], float planes[24] );
+};
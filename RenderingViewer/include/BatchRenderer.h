@@ -0,0 +1,118 @@
+#pragma once
+
+using namespace std;
+
+// Headless batch rendering: no window, no DirectInput and no D3D device.
+//
+// Loads the scene once, then renders every view of a camera-path file (see CameraPathReader) with the
+// software renderer. Reading views, rendering and encoding images run on their own threads with
+// framesInFlight color buffers between them, so the stages overlap.
+//
+// A fixed camera path over a fixed scene is also the replay of the performance regression gate: the frame
+// statistics of a run can be stored as a baseline, and a later run compared against it fails when its
+// frames got slower or heavier than the tolerances allow.
+class BatchRenderer
+{
+public:
+    struct Options
+    {
+        Options()
+            : width( 1280 )
+            , height( 720 )
+            , shadowMapSize( 2048 )
+            , threadCount( 0 )
+            , framesInFlight( 3 )
+        {
+            // Nothing generated unless asked for
+            generator.objectCount = 0;
+        }
+
+        string         cameraPath;
+        string         outputDirectory;
+        vector<string> modelPaths;     // the viewer's default scene when empty and nothing is generated
+
+        // A scene from SceneGenerator instead of the models: generated when objectCount is set, otherwise
+        // read from scenePath when that is set. A generated scene is also written to scenePath when set.
+        SceneGenerator::Config generator;
+        string                 scenePath;
+
+        // Frame statistics are written to writeBaselinePath and compared against baselinePath when set
+        string                    baselinePath;
+        string                    writeBaselinePath;
+        FrameBaseline::Tolerances tolerances;
+
+        UINT     width;
+        UINT     height;
+        UINT     shadowMapSize;
+        uint32_t threadCount;          // rasterizer threads, 0 uses the hardware concurrency
+        uint32_t framesInFlight;
+    };
+
+    // Busy time of each stage, and the time the render stage waited on the others
+    struct Statistics
+    {
+        Statistics() { Clear(); }
+
+        void Clear()
+        {
+            frames                  = 0;
+            sceneMilliseconds       = 0.0;
+            wallMilliseconds        = 0.0;
+            loadMilliseconds        = 0.0;
+            renderMilliseconds      = 0.0;
+            encodeMilliseconds      = 0.0;
+            renderStallMilliseconds = 0.0;
+        }
+
+        double FramesPerSecond() const { return wallMilliseconds > 0.0 ? frames * 1000.0 / wallMilliseconds : 0.0; }
+
+        uint32_t frames;
+        double   sceneMilliseconds;  // scene load and shadow map, before the first frame
+        double   wallMilliseconds;   // first view read to last image written
+        double   loadMilliseconds;
+        double   renderMilliseconds;
+        double   encodeMilliseconds;
+        double   renderStallMilliseconds;
+    };
+
+public:
+    BatchRenderer();
+    ~BatchRenderer();
+
+public:
+    // Returns false when args do not ask for batch mode. Recognized:
+    // --batch <camera path> <output directory> [--size W H] [--shadow-size N] [--threads N] [--frames-in-flight N] [--model path]...
+    // [--generate N] [--seed N] [--depth N] [--instancing R] [--segments MIN MAX] [--distribution uniform|clustered|grid]
+    // [--lights N] [--scene path] [--baseline path] [--write-baseline path] [--tolerance RELATIVE MS] [--count-tolerance RELATIVE]
+    static bool ParseArguments( const vector<string>& args, Options& options );
+
+    bool Run( const Options& options );
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+    void PrintStatistics() const;
+
+    const FrameStatistics& GetFrameStatistics() const { return m_frameStatistics; }
+
+    // Of the last run against Options::baselinePath, empty without one
+    const vector<FrameBaseline::Comparison>& GetComparisons() const { return m_comparisons; }
+
+private:
+    // Replays longer than this compare their last frames only
+    static const uint32_t STATISTICS_FRAMES = 1 << 16;
+
+    bool CreateScene( const Options& options );
+    bool CreateGeneratedScene( const Options& options );
+
+    // Returns false when the frames regressed or the baseline could not be read or written
+    bool CompareBaseline( const Options& options );
+
+private:
+    shared_ptr<Scene> m_pScene;
+
+    Statistics m_statistics;
+
+    FrameStatistics                   m_frameStatistics;
+    vector<FrameBaseline::Comparison> m_comparisons;
+    bool                              m_bRegressed;
+};
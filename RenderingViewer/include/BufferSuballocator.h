@@ -0,0 +1,200 @@
+#pragma once
+
+#include "TlsfAllocator.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Creates, destroys and copies between the blocks a BufferSuballocator places buffers in
+class BufferBlockBackend
+{
+public:
+    virtual ~BufferBlockBackend() {}
+
+    virtual bool CreateBlock( uint32_t block, uint64_t size ) = 0;
+    virtual void DestroyBlock( uint32_t block ) = 0;
+
+    // Defragmentation moving a buffer; the ranges never overlap
+    virtual void Copy( uint32_t srcBlock, uint64_t srcOffset, uint32_t dstBlock, uint64_t dstOffset, uint64_t size ) = 0;
+};
+
+// Blocks in CPU memory, for tests and benchmarks
+class MockBufferBlockBackend : public BufferBlockBackend
+{
+public:
+    MockBufferBlockBackend();
+
+    unsigned char* GetData( uint32_t block ) { return m_blocks[block].data(); }
+
+    uint32_t GetLiveBlockCount() const { return m_liveBlocks; }
+    uint64_t GetCopiedBytes() const { return m_copiedBytes; }
+
+    virtual bool CreateBlock( uint32_t block, uint64_t size );
+    virtual void DestroyBlock( uint32_t block );
+    virtual void Copy( uint32_t srcBlock, uint64_t srcOffset, uint32_t dstBlock, uint64_t dstOffset, uint64_t size );
+
+private:
+    std::vector<std::vector<unsigned char> > m_blocks;
+    uint32_t                                 m_liveBlocks;
+    uint64_t                                 m_copiedBytes;
+};
+
+// Places buffers in a few large blocks instead of a resource each. Independent of D3D.
+//
+// Each block is a TlsfAllocator. A buffer goes into the first block with room, a block is created when none
+// has any, and a buffer larger than a block gets a block of its own. Handles stay valid while Defragment
+// moves buffers, so owners look the location up when they bind a buffer instead of keeping it.
+//
+// Freed ranges are held until the GPU is done with them, as in UploadRingAllocator: EndFrame tags the frees
+// of the frame with its fence value and Reclaim returns them once that fence has completed. Blocks left
+// empty are then destroyed, except the last ordinary one.
+//
+// Defragment moves buffers out of the emptiest blocks into fuller ones, and down into lower holes of their
+// own block, up to a byte budget per call so it can run every frame. The backend copies the data, and the
+// range moved from is freed like any other.
+class BufferSuballocator
+{
+public:
+    typedef uint32_t Handle;
+
+    static const Handle   INVALID_HANDLE      = ~0u;
+    static const uint64_t DEFAULT_BLOCK_SIZE  = 64ull * 1024 * 1024;
+    static const uint64_t DEFAULT_GRANULARITY = 256;
+
+    struct Location
+    {
+        uint32_t block;
+        uint64_t offset;
+        uint64_t size;      // as requested
+    };
+
+    struct Statistics
+    {
+        Statistics()
+            : blocks( 0 )
+            , blockBytes( 0 )
+            , usedBytes( 0 )
+            , requestedBytes( 0 )
+            , pendingBytes( 0 )
+            , freeBytes( 0 )
+            , largestFreeRange( 0 )
+            , allocations( 0 )
+            , moves( 0 )
+            , movedBytes( 0 )
+            , blocksCreated( 0 )
+            , blocksDestroyed( 0 )
+            , failures( 0 )
+        {
+        }
+
+        // Share of the free bytes outside the largest free range, 0 when free space is one range
+        double GetFragmentation() const { return freeBytes > 0 ? 1.0 - static_cast<double>(largestFreeRange) / freeBytes : 0.0; }
+
+        uint32_t blocks;
+        uint64_t blockBytes;
+        uint64_t usedBytes;         // live buffers, rounded to the granularity
+        uint64_t requestedBytes;
+        uint64_t pendingBytes;      // freed, waiting for the GPU
+        uint64_t freeBytes;
+        uint64_t largestFreeRange;
+        uint32_t allocations;
+        uint64_t moves;             // since construction
+        uint64_t movedBytes;
+        uint32_t blocksCreated;
+        uint32_t blocksDestroyed;
+        uint32_t failures;
+    };
+
+public:
+    // Not owned; blocks are created on the first allocation
+    BufferSuballocator( BufferBlockBackend& backend, uint64_t blockSize = DEFAULT_BLOCK_SIZE, uint64_t granularity = DEFAULT_GRANULARITY );
+    ~BufferSuballocator();
+
+    BufferSuballocator( const BufferSuballocator& ) = delete;
+    BufferSuballocator& operator=( const BufferSuballocator& ) = delete;
+
+public:
+    // alignment is a power of two, 0 takes the granularity. INVALID_HANDLE for size 0 or when the backend
+    // could not create a block.
+    Handle Allocate( uint64_t size, uint64_t alignment = 0 );
+
+    // The range is reused once the frame in progress has completed
+    void Free( Handle handle );
+
+    Location GetLocation( Handle handle ) const;
+
+    void EndFrame( uint64_t fenceValue );
+    void Reclaim( uint64_t completedFenceValue );
+
+    // Returns the bytes moved, which the last buffer moved may take past maxBytes
+    uint64_t Defragment( uint64_t maxBytes );
+
+    uint64_t GetBlockSize() const { return m_blockSize; }
+
+    Statistics GetStatistics() const;
+
+    // Every block is valid and every handle points at a live range of the block it names
+    bool Validate() const;
+
+private:
+    struct Block
+    {
+        Block()
+            : pendingBytes( 0 )
+            , bDedicated( false )
+        {
+        }
+
+        std::unique_ptr<TlsfAllocator> pAllocator;     // null for an unused slot
+        uint64_t                       pendingBytes;
+        bool                           bDedicated;
+    };
+
+    struct Entry
+    {
+        uint32_t block;     // INVALID_HANDLE for an unused slot
+        uint32_t node;
+        uint64_t size;
+        uint64_t alignment;
+    };
+
+    struct PendingFree
+    {
+        uint64_t fenceValue;
+        uint32_t block;
+        uint32_t node;
+    };
+
+    uint32_t CreateBlock( uint64_t size, bool bDedicated );
+
+    // Frees node in block once the frame in progress has completed
+    void Retire( uint32_t block, uint32_t node );
+
+    // Places the buffer at node in block and retires the range it was in
+    void Move( Handle handle, uint32_t block, uint32_t node );
+
+private:
+    BufferBlockBackend& m_backend;
+    uint64_t            m_blockSize;
+    uint64_t            m_granularity;
+
+    std::vector<Block>    m_blocks;
+    std::vector<Entry>    m_entries;
+    std::vector<Handle>   m_unusedHandles;
+
+    std::vector<PendingFree> m_pendingFrees;
+    size_t                   m_frameFreeBegin;  // frees from here on belong to the frame in progress
+
+    // Reused by Defragment
+    std::vector<uint32_t> m_blockOrder;
+    std::vector<Handle>   m_candidates;
+
+    uint64_t m_requestedBytes;
+    uint32_t m_allocationCount;
+    uint64_t m_moves;
+    uint64_t m_movedBytes;
+    uint32_t m_blocksCreated;
+    uint32_t m_blocksDestroyed;
+    uint32_t m_failures;
+};
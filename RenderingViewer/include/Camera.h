@@ -18,24 +18,24 @@ public:
 
 public:
     const Vec3f& GetLookAt() const { return m_lookAt; }
-    void SetLookAt( const Vec3f& lookAt ) { m_lookAt = lookAt; }
+    void SetLookAt( const Vec3f& lookAt ) { m_lookAt = lookAt; MarkChanged(); }
 
     const Mat44f& GetViewMatrix() const { return m_viewMatrix; }
-    void SetViewMatrix( const Mat44f& viewMatrix ) { m_viewMatrix = viewMatrix; }
+    void SetViewMatrix( const Mat44f& viewMatrix ) { m_viewMatrix = viewMatrix; m_constants.MarkDirty(); MarkChanged(); }
 
     const Mat44f& GetProjectionMatrix() const { return m_projectionMatrix; }
-    void SetProjectionMatrix( const Mat44f& projectionMatrix ) { m_projectionMatrix = projectionMatrix; }
+    void SetProjectionMatrix( const Mat44f& projectionMatrix ) { m_projectionMatrix = projectionMatrix; m_constants.MarkDirty(); MarkChanged(); }
 
     const Mat33f& GetPoseMatrix() const { return m_poseMatrix; }
-    void SetPoseMatrix( const Mat33f& poseMatrix ) { m_poseMatrix = poseMatrix; }
+    void SetPoseMatrix( const Mat33f& poseMatrix ) { m_poseMatrix = poseMatrix; MarkChanged(); }
 
     Vec3f GetLookDir() const { return Vec3f::normalize( m_lookAt - m_position ); }
 
     void CreateViewMatrix();
 
-    virtual bool BindDescriptorHeap( ID3D12Device* pDevice, shared_ptr<DescriptorHeap> pDescHeap );
+    virtual void UpdateGPUBuffer( UploadRingAllocator& ring );
 
-    virtual void UpdateGPUBuffer();
+    virtual D3D12_GPU_VIRTUAL_ADDRESS GetConstantBufferAddress() const { return m_constants.GetGPUAddress(); }
 
 public:
     ResTransformBuffer& GetBufferData() { return m_transformBufferData; }
@@ -46,7 +46,7 @@ protected:
 
 private:
     ResTransformBuffer            m_transformBufferData;
-    shared_ptr<ConstantBuffer>    m_pCameraCB;
+    ConstantUpload                m_constants;
 
     Mat44f m_viewMatrix;
     Mat44f m_projectionMatrix;
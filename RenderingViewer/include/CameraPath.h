@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Streams views from a camera-path file. Independent of D3D.
+//
+// One view per line: 16 floats of the view matrix followed by 16 floats of the projection matrix,
+// each in the memory order of Mat44f (the layout uploaded to the shaders). Values are separated by
+// spaces, tabs or commas. Empty lines and lines starting with '#' are skipped.
+class CameraPathReader
+{
+public:
+    struct View
+    {
+        uint32_t index; // 0-based among the views of the file
+        uint32_t line;  // 1-based line in the file
+
+        float view[16];
+        float projection[16];
+    };
+
+public:
+    CameraPathReader();
+    ~CameraPathReader();
+
+public:
+    bool Open( const std::string& path );
+
+    // Returns false at the end of the file or on a malformed line, which HasError() tells apart
+    bool Read( View& view );
+
+    bool HasError() const { return !m_error.empty(); }
+    const std::string& GetError() const { return m_error; }
+
+private:
+    std::ifstream m_file;
+    std::string   m_path;
+    std::string   m_error;
+
+    uint32_t m_line;
+    uint32_t m_index;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+// Point and spot lights shaded per cluster of the camera frustum.
+// Build bins the lights for the camera on the CPU; the forward pass reads the constants at b3 and the
+// light, cluster range and light index buffers as root SRVs t1-t3.
+class ClusteredLights : public Node
+{
+public:
+    struct ResClusterData
+    {
+        UINT  tilesX;
+        UINT  tilesY;
+        UINT  slices;
+        UINT  lightCount;
+
+        float sliceScale;   // slice = log( viewDepth ) * sliceScale + sliceBias
+        float sliceBias;
+        float tileScaleX;   // tiles per pixel
+        float tileScaleY;
+    };
+
+    struct ResLight
+    {
+        Vec4f positionRange;
+        Vec4f colorCosInner;
+        Vec4f directionCosOuter;   // cosOuter -1 for point lights
+    };
+
+    enum SHADER_RESOURCE
+    {
+        SHADER_RESOURCE_LIGHTS,
+        SHADER_RESOURCE_RANGES,
+        SHADER_RESOURCE_INDICES,
+        SHADER_RESOURCE_NUM,
+    };
+
+public:
+    // threadCount 0 bins on every hardware thread
+    ClusteredLights( ID3D12Device* pDevice, UINT threadCount = 0 );
+    ~ClusteredLights();
+
+public:
+    UINT AddPointLight( const Vec3f& position, float range, const Vec3f& color );
+
+    // Half-angles in radians
+    UINT AddSpotLight( const Vec3f& position, const Vec3f& direction, float range, float innerAngle, float outerAngle, const Vec3f& color );
+
+    void ClearLights();
+
+    const LightList& GetLights() const { return m_lights; }
+
+    void SetConfig( const LightClusters::Config& config ) { m_clusters.SetConfig( config ); MarkChanged(); }
+
+    // Bins the lights for the camera and the screen size; skipped while neither they nor the lights changed
+    void Build( const Camera& camera, UINT width, UINT height );
+
+    const LightClusters& GetClusters() const { return m_clusters; }
+
+    // Build calls that binned the lights
+    UINT64 GetBuildCount() const { return m_buildCount; }
+
+    virtual void UpdateGPUBuffer( UploadRingAllocator& ring );
+
+    virtual D3D12_GPU_VIRTUAL_ADDRESS GetConstantBufferAddress() const { return m_constants.GetGPUAddress(); }
+
+    virtual UINT GetShaderResourceCount() const { return SHADER_RESOURCE_NUM; }
+    virtual D3D12_GPU_VIRTUAL_ADDRESS GetShaderResourceAddress( UINT index ) const { return m_shaderResources[index].GetGPUAddress(); }
+
+private:
+    LightList             m_lights;
+    LightClusters         m_clusters;
+
+    ResClusterData        m_clusterData;
+    ConstantUpload        m_constants;
+
+    vector<ResLight>      m_gpuLights;
+    ConstantUpload        m_shaderResources[SHADER_RESOURCE_NUM];
+
+    UINT64                m_buildCount;
+    UINT64                m_builtCameraVersion;
+    UINT64                m_builtVersion;
+    UINT                  m_builtWidth;
+    UINT                  m_builtHeight;
+    bool                  m_bBuilt;
+};
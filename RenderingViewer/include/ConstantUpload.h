@@ -0,0 +1,27 @@
+#pragma once
+
+#include "UploadRingAllocator.h"
+
+// Constant data uploaded through the ring with dirty tracking.
+// Clean data keeps pointing at its last copy and is only rewritten when that copy gets too old.
+class ConstantUpload
+{
+public:
+    ConstantUpload()
+        : m_bDirty( true )
+    {
+    }
+
+public:
+    void MarkDirty() { m_bDirty = true; }
+    bool IsDirty() const { return m_bDirty; }
+
+    // Returns true when the data was written this call
+    bool Update( UploadRingAllocator& ring, const void* pData, uint32_t size );
+
+    uint64_t GetGPUAddress() const { return m_allocation.gpuAddress; }
+
+private:
+    UploadRingAllocator::Allocation m_allocation;
+    bool                            m_bDirty;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Index allocator for one shader-visible descriptor heap. Independent of D3D.
+//
+// [0, persistentCount)                          : free-list region for descriptors that live across frames
+// [persistentCount, persistentCount + n * size) : ring of per-frame slices, reset when the slice comes around again
+//
+// A slice is handed out again only once the fence value of the frame that last used it has completed.
+class DescriptorAllocator
+{
+public:
+    static const uint32_t INVALID_INDEX = 0xffffffff;
+
+    struct Statistics
+    {
+        Statistics()
+            : persistentUsed( 0 )
+            , persistentPeak( 0 )
+            , transientUsed( 0 )
+            , transientPeak( 0 )
+            , failures( 0 )
+            , busyFrames( 0 )
+        {
+        }
+
+        uint32_t persistentUsed;
+        uint32_t persistentPeak;
+        uint32_t transientUsed;
+        uint32_t transientPeak;
+        uint32_t failures;
+        uint32_t busyFrames;    // frames whose slice was still in use by the GPU, failing every transient allocation
+    };
+
+public:
+    DescriptorAllocator( uint32_t persistentCount, uint32_t transientCountPerFrame, uint32_t frameCount );
+    ~DescriptorAllocator();
+
+public:
+    // Contiguous range in the persistent region, first fit
+    uint32_t AllocatePersistent( uint32_t count );
+    void FreePersistent( uint32_t index, uint32_t count );
+
+    // Contiguous range in the current frame slice, valid until the slice is reused. Fails while the slice's
+    // previous frame has not completed.
+    uint32_t AllocateTransient( uint32_t count );
+
+    // The current slice is in use until fenceValue has completed; moves to the next slice
+    void EndFrame( uint64_t fenceValue );
+
+    // Frees the slices of frames whose fence value has completed
+    void Reclaim( uint64_t completedFenceValue );
+
+    uint32_t GetCapacity() const { return m_persistentCount + m_transientCountPerFrame * m_frameCount; }
+    uint32_t GetFrameIndex() const { return m_frameIndex; }
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+private:
+    struct Range
+    {
+        uint32_t begin;
+        uint32_t count;
+    };
+
+    uint32_t m_persistentCount;
+    uint32_t m_transientCountPerFrame;
+    uint32_t m_frameCount;
+
+    // Sorted by begin, never adjacent
+    std::vector<Range> m_freeRanges;
+
+    uint32_t m_frameIndex;
+    uint32_t m_transientOffset;
+
+    // Fence value of the frame that last used each slice, in use while above the completed value
+    std::vector<uint64_t> m_sliceFenceValues;
+    uint64_t              m_completedFenceValue;
+    bool                  m_bSliceBusy;
+
+    Statistics m_statistics;
+};
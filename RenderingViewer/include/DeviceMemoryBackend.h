@@ -0,0 +1,19 @@
+#pragma once
+
+using namespace Microsoft::WRL;
+
+// Sizes resources as the device places them and reads the local video memory budget of the adapter
+class DeviceMemoryBackend : public MemoryBackend
+{
+public:
+    DeviceMemoryBackend( ID3D12Device* pDevice, IDXGIAdapter* pAdapter );
+    ~DeviceMemoryBackend();
+
+public:
+    virtual uint64_t GetAllocationSize( const MemoryResourceDesc& desc );
+    virtual bool QueryDeviceMemory( uint64_t& budget, uint64_t& usage );
+
+private:
+    ComPtr<ID3D12Device>  m_pDevice;
+    ComPtr<IDXGIAdapter3> m_pAdapter;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "DrawRecorder.h"
+
+#include <cstdint>
+
+// Root arguments a render context binds for its draws, and the draw packet made from them every frame.
+// Independent of D3D: nodes are bound through Source, which Node implements, so the benchmark makes the
+// packets of a generated scene with the same code as the viewer's passes.
+class DrawBindings
+{
+public:
+    // What a node binds: its constants as a root CBV, its buffers as root SRVs
+    class Source
+    {
+    public:
+        virtual ~Source() {}
+
+        virtual uint64_t GetConstantBufferAddress() const = 0;
+        virtual uint32_t GetShaderResourceCount() const = 0;
+        virtual uint64_t GetShaderResourceAddress( uint32_t index ) const = 0;
+    };
+
+    // The nodes the forward pass binds for a model; null for those the scene does not have
+    struct ForwardSources
+    {
+        ForwardSources();
+
+        const Source* pCamera;
+        const Source* pLight;
+        const Source* pMaterial;
+        const Source* pLightClusters;
+    };
+
+public:
+    DrawBindings();
+
+    // Only compared, so they may be anything that identifies the object
+    void SetRootSignature( const void* pRootSignature ) { m_pRootSignature = pRootSignature; }
+    void SetPipelineState( const void* pPipelineState ) { m_pPipelineState = pPipelineState; }
+
+    // DescriptorAllocator::INVALID_INDEX binds no table
+    void SetDescriptorIndex( uint32_t index ) { m_descriptorIndex = index; }
+
+    // The source's constants as the next root CBV, or its buffers as the next root SRVs; false, binding
+    // nothing, when they do not fit
+    bool AddConstantBuffer( const Source* pSource );
+    bool AddShaderResources( const Source* pSource );
+
+    // RenderPassForward's root parameters: b0 camera, b1 light, b2 material and b3 light clusters, then the
+    // buffers of the nodes that have any; false if any did not fit
+    bool BindForward( const ForwardSources& sources );
+
+    // Addresses are read now, as nodes upload their constants to a new place every frame
+    void CreatePacket( const void* pContext, const void* pModel, uint32_t indexCount, const float boundsMin[3], const float boundsMax[3],
+                       DrawRecorder::Packet& packet ) const;
+
+    uint32_t GetConstantBufferCount() const { return m_constantBufferCount; }
+    uint32_t GetShaderResourceCount() const { return m_shaderResourceCount; }
+
+private:
+    const void* m_pRootSignature;
+    const void* m_pPipelineState;
+    uint32_t    m_descriptorIndex;
+
+    const Source* m_pConstantSources[DrawRecorder::MAX_CONSTANT_BUFFERS];
+    uint32_t      m_constantBufferCount;
+
+    // A source per entry, each binding all of its buffers
+    const Source* m_pShaderResourceSources[DrawRecorder::MAX_SHADER_RESOURCES];
+    uint32_t      m_shaderResourceSourceCount;
+    uint32_t      m_shaderResourceCount;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "DescriptorAllocator.h"
+#include "DrawSort.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+// Sorts a pass's draw packets and records them into a command sink, skipping binds of state the previous
+// draw left in place. Independent of D3D: the pass gathers the packets from its contexts and its sink turns
+// the calls into commands, so the benchmark records the same stream into memory.
+class DrawRecorder
+{
+public:
+    static const uint32_t MAX_CONSTANT_BUFFERS = 4;
+    static const uint32_t MAX_SHADER_RESOURCES = 4;
+
+    // Draw gathered from a context. Raw pointers are only used to detect state changes.
+    struct Packet
+    {
+        const void* pContext;           // handed back to the sink, which knows its type
+
+        const void* pRootSignature;
+        const void* pPipelineState;
+        const void* pModel;             // owns the material constants and the geometry
+
+        // Root CBVs occupy the first root parameters, root SRVs and then the descriptor table follow them
+        uint64_t constantBuffers[MAX_CONSTANT_BUFFERS];
+        uint32_t constantBufferCount;
+
+        uint64_t shaderResources[MAX_SHADER_RESOURCES];
+        uint32_t shaderResourceCount;
+
+        uint32_t descriptorIndex;       // DescriptorAllocator::INVALID_INDEX binds no table
+
+        uint32_t indexCount;
+        float    center[3];             // of the model's bounds, for the depth field
+    };
+
+    // Receives the binds and draws that reach the command list, in order. Parameters are root parameter indices.
+    class CommandSink
+    {
+    public:
+        virtual ~CommandSink() {}
+
+        virtual void SetRootSignature( const Packet& packet ) = 0;
+        virtual void SetConstantBuffer( uint32_t parameter, uint64_t address ) = 0;
+        virtual void SetShaderResource( uint32_t parameter, uint64_t address ) = 0;
+        virtual void SetDescriptorHeap() = 0;
+        virtual void SetDescriptorTable( uint32_t parameter, uint32_t descriptorIndex ) = 0;
+        virtual void SetPipelineState( const Packet& packet ) = 0;
+        virtual void Draw( const Packet& packet ) = 0;
+    };
+
+    struct Statistics
+    {
+        Statistics() { Clear(); }
+
+        void Clear()
+        {
+            drawCount      = 0;
+            triangleCount  = 0;
+            commandLists   = 0;
+            requestedBinds = 0;
+            issuedBinds    = 0;
+            heapSwitches   = 0;
+
+            unsortedStateChanges = 0;
+            stateChanges         = 0;
+
+            fallbackDraws = 0;
+            skippedDraws  = 0;
+
+            saturatedKeys = 0;
+        }
+
+        // Binds a naive recorder would have issued versus binds that reached the command list
+        int RedundantBinds() const { return requestedBinds - issuedBinds; }
+
+        int      drawCount;
+        uint64_t triangleCount;
+        int      commandLists;
+        int      requestedBinds;
+        int      issuedBinds;
+        int      heapSwitches;
+
+        // Pipeline, material and mesh changes in scene order versus sorted order
+        int unsortedStateChanges;
+        int stateChanges;
+
+        // Draws whose pipeline was still being created, drawn with the pass's fallback or not at all
+        int fallbackDraws;
+        int skippedDraws;
+
+        // Draws whose pipeline or model id was wider than its key field and sorted with the field's largest value
+        int saturatedKeys;
+    };
+
+public:
+    DrawRecorder();
+
+public:
+    // Most significant key field, in submission order
+    void SetSortPass( uint32_t pass ) { m_sortPass = pass; }
+
+    // Draws are ordered by distance along direction from origin, quantized over [0, depthRange]
+    void SetSortView( const float origin[3], const float direction[3], float depthRange );
+
+    // Ids stay with their pipeline or model across frames; cleared when the pass rebuilds its contexts
+    void ClearSortIds();
+
+    // Keys count packets into pItems and sorts them. Both arrays must stay valid until the last Record.
+    void Sort( const Packet* pPackets, DrawSort::Item* pItems, uint32_t count, Statistics& statistics );
+
+    // The sorted packets, each bind issued only when it differs from the state left by the draw before
+    void Record( CommandSink& sink, Statistics& statistics ) const;
+
+    const Packet*         GetPackets() const { return m_pPackets; }
+    const DrawSort::Item* GetItems() const { return m_pItems; }
+    uint32_t              GetCount() const { return m_count; }
+
+private:
+    uint64_t CreateSortKey( const Packet& packet, Statistics& statistics );
+    static uint32_t GetSortId( std::unordered_map<const void*, uint32_t>& ids, const void* pObject );
+
+private:
+    uint32_t m_sortPass;
+    float    m_sortOrigin[3];
+    float    m_sortDirection[3];
+    float    m_sortDepthRange;
+
+    std::unordered_map<const void*, uint32_t> m_pipelineIds;   // each map counts from 0, so one cannot use up the other's field
+    std::unordered_map<const void*, uint32_t> m_modelIds;
+    DrawSort                                  m_drawSort;
+
+    const Packet*   m_pPackets;
+    DrawSort::Item* m_pItems;      // m_count, in draw order
+    uint32_t        m_count;
+};
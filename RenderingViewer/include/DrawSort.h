@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 64-bit draw sort key, most significant field first:
+//
+// pass (4) | pipeline (14) | material (14) | mesh (16) | depth (16)
+//
+// Ascending order groups draws by pass and state, and orders each group front-to-back.
+namespace DrawKey
+{
+    const uint32_t PASS_BITS     = 4;
+    const uint32_t PIPELINE_BITS = 14;
+    const uint32_t MATERIAL_BITS = 14;
+    const uint32_t MESH_BITS     = 16;
+    const uint32_t DEPTH_BITS    = 16;
+
+    const uint32_t DEPTH_SHIFT    = 0;
+    const uint32_t MESH_SHIFT     = DEPTH_SHIFT + DEPTH_BITS;
+    const uint32_t MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+    const uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+    const uint32_t PASS_SHIFT     = PIPELINE_SHIFT + PIPELINE_BITS;
+
+    inline uint32_t MaxValue( uint32_t bits ) { return static_cast<uint32_t>((1ull << bits) - 1); }
+
+    inline bool Fits( uint32_t value, uint32_t bits ) { return value <= MaxValue( bits ); }
+
+    inline uint64_t Field( uint32_t value, uint32_t bits, uint32_t shift )
+    {
+        return static_cast<uint64_t>(value < MaxValue( bits ) ? value : MaxValue( bits )) << shift;
+    }
+
+    inline uint32_t Extract( uint64_t key, uint32_t bits, uint32_t shift )
+    {
+        return static_cast<uint32_t>((key >> shift) & ((1ull << bits) - 1));
+    }
+
+    // Values wider than their field saturate to its largest value, so they share it rather than wrap onto
+    // small ids and spill into the neighbouring fields
+    inline uint64_t Pack( uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t depth )
+    {
+        return Field( pass, PASS_BITS, PASS_SHIFT )
+             | Field( pipeline, PIPELINE_BITS, PIPELINE_SHIFT )
+             | Field( material, MATERIAL_BITS, MATERIAL_SHIFT )
+             | Field( mesh, MESH_BITS, MESH_SHIFT )
+             | Field( depth, DEPTH_BITS, DEPTH_SHIFT );
+    }
+
+    // Maps [0, range] onto the depth field, clamping outside values
+    inline uint32_t QuantizeDepth( float depth, float range )
+    {
+        if (!(range > 0.0f) || !(depth > 0.0f))
+            return 0;
+
+        const float maxValue = static_cast<float>((1u << DEPTH_BITS) - 1);
+        const float value    = depth / range * maxValue;
+
+        return value >= maxValue ? (1u << DEPTH_BITS) - 1 : static_cast<uint32_t>(value);
+    }
+
+    inline uint32_t GetPass( uint64_t key )     { return Extract( key, PASS_BITS, PASS_SHIFT ); }
+    inline uint32_t GetPipeline( uint64_t key ) { return Extract( key, PIPELINE_BITS, PIPELINE_SHIFT ); }
+    inline uint32_t GetMaterial( uint64_t key ) { return Extract( key, MATERIAL_BITS, MATERIAL_SHIFT ); }
+    inline uint32_t GetMesh( uint64_t key )     { return Extract( key, MESH_BITS, MESH_SHIFT ); }
+    inline uint32_t GetDepth( uint64_t key )    { return Extract( key, DEPTH_BITS, DEPTH_SHIFT ); }
+}
+
+// Stable LSD radix sort of draw items by key, split across worker threads. Independent of D3D.
+class DrawSort
+{
+public:
+    struct Item
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    // Binds a recorder has to issue when walking items in order, counted per key field
+    struct StateChanges
+    {
+        StateChanges()
+            : pass( 0 )
+            , pipeline( 0 )
+            , material( 0 )
+            , mesh( 0 )
+        {
+        }
+
+        uint32_t Total() const { return pass + pipeline + material + mesh; }
+
+        uint32_t pass;
+        uint32_t pipeline;
+        uint32_t material;
+        uint32_t mesh;
+    };
+
+    static const uint32_t RADIX_BITS = 8;
+    static const uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+
+    // Below this many items the sort runs on the calling thread only
+    static const size_t PARALLEL_THRESHOLD = 16384;
+
+public:
+    // threadCount 0 uses the hardware concurrency
+    explicit DrawSort( uint32_t threadCount = 0 );
+    ~DrawSort();
+
+public:
+    void Sort( std::vector<Item>& items );
+
+    // In place, for items that do not live in a vector, like a frame arena's
+    void Sort( Item* pItems, size_t count );
+
+    uint32_t GetThreadCount() const { return m_threadCount; }
+
+    // Digit passes skipped because every key shared the digit, for the last Sort()
+    uint32_t GetSkippedPasses() const { return m_skippedPasses; }
+
+    static StateChanges CountStateChanges( const Item* pItems, size_t count );
+    static StateChanges CountStateChanges( const std::vector<Item>& items ) { return CountStateChanges( items.data(), items.size() ); }
+
+    static bool IsSorted( const Item* pItems, size_t count );
+    static bool IsSorted( const std::vector<Item>& items ) { return IsSorted( items.data(), items.size() ); }
+
+private:
+    uint32_t GetSortThreads( size_t count ) const;
+
+    // Returns true when the sorted result ended up in pScratch
+    bool SortRange( Item* pItems, Item* pScratch, size_t count, uint32_t threadCount );
+
+private:
+    uint32_t m_threadCount;
+    uint32_t m_skippedPasses;
+
+    std::vector<Item>   m_scratch;
+    std::vector<size_t> m_histograms;
+};
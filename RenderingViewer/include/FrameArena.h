@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+// Linear allocator for data that lives for one frame, like draw lists and sort keys. Independent of D3D.
+//
+// Two buffers take turns: BeginFrame rewinds the buffer of the frame before the last one, so what the
+// previous frame allocated stays valid while the GPU or another thread still reads it. Allocating is an
+// atomic bump of the offset and may happen on any thread between two BeginFrame calls. Nothing is freed
+// or destroyed one by one, so only trivially copyable types go in.
+//
+// A frame that does not fit takes the rest from the heap and is counted as overflow. The next BeginFrame
+// grows each buffer to the largest frame seen when it comes round, after which the frame fits again.
+class FrameArena
+{
+public:
+    struct Statistics
+    {
+        Statistics()
+            : capacity( 0 )
+            , frameBytes( 0 )
+            , peakBytes( 0 )
+            , overflowAllocations( 0 )
+            , overflowBytes( 0 )
+            , grows( 0 )
+        {
+        }
+
+        size_t   capacity;              // of one buffer
+        size_t   frameBytes;            // allocated in the last finished frame, padding included
+        size_t   peakBytes;
+        uint64_t overflowAllocations;   // that went to the heap, since construction
+        uint64_t overflowBytes;
+        uint32_t grows;
+    };
+
+public:
+    explicit FrameArena( size_t capacity = 1 << 20 );
+    ~FrameArena();
+
+    FrameArena( const FrameArena& ) = delete;
+    FrameArena& operator=( const FrameArena& ) = delete;
+
+public:
+    // Must not overlap Allocate on another thread
+    void BeginFrame();
+
+    // Aligned to alignment, a power of two; null for size 0
+    void* Allocate( size_t size, size_t alignment = alignof(std::max_align_t) );
+
+    // Storage for count T, not constructed
+    template <typename T>
+    T* Allocate( size_t count )
+    {
+        static_assert( std::is_trivially_copyable<T>::value, "FrameArena never destroys what it holds" );
+        return static_cast<T*>(Allocate( sizeof( T ) * count, alignof(T) ));
+    }
+
+    uint64_t GetFrameIndex() const { return m_frameIndex; }
+
+    // Bytes allocated in the current frame so far
+    size_t GetFrameBytes() const;
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+private:
+    struct Buffer
+    {
+        Buffer()
+            : offset( 0 )
+            , overflowBytes( 0 )
+        {
+        }
+
+        std::vector<unsigned char>  data;
+        std::atomic<size_t>         offset;
+        std::vector<unsigned char*> overflow;       // heap blocks, freed when the buffer is rewound
+        size_t                      overflowBytes;
+    };
+
+    size_t GetUsedBytes( const Buffer& buffer ) const;
+
+    void* AllocateOverflow( Buffer& buffer, size_t size, size_t alignment );
+
+    void Rewind( Buffer& buffer );
+
+private:
+    Buffer     m_buffers[2];
+    uint32_t   m_current;
+    uint64_t   m_frameIndex;
+    size_t     m_capacity;      // what both buffers grow to
+    std::mutex m_overflowMutex;
+
+    Statistics m_statistics;
+};
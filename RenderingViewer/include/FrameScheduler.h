@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+// Decides which iterations of the message loop produce a frame. Independent of D3D.
+//
+// Frames are rendered only after something was invalidated, or at a fixed rate while asynchronous or
+// progressive work is pending. Between frames the loop may sleep for GetWaitMilliseconds(). Time comes
+// from a clock callback, so the decisions can be replayed with a fake clock.
+class FrameScheduler
+{
+public:
+    enum INVALIDATE
+    {
+        INVALIDATE_CAMERA = 1 << 0,
+        INVALIDATE_LIGHT  = 1 << 1,
+        INVALIDATE_SCENE  = 1 << 2,
+        INVALIDATE_WINDOW = 1 << 3,
+
+        INVALIDATE_ALL    = INVALIDATE_CAMERA | INVALIDATE_LIGHT | INVALIDATE_SCENE | INVALIDATE_WINDOW,
+    };
+
+    static const uint32_t INVALIDATE_REASON_NUM = 4;
+
+    // Same value as INFINITE
+    static const uint32_t WAIT_INFINITE = 0xffffffffu;
+
+    // Seconds from an arbitrary origin
+    typedef std::function<double()> Clock;
+
+    struct Statistics
+    {
+        Statistics() { Clear(); }
+
+        void Clear()
+        {
+            iterations    = 0;
+            frames        = 0;
+            pendingFrames = 0;
+            for (uint32_t i = 0; i < INVALIDATE_REASON_NUM; ++i)
+            {
+                reasonFrames[i] = 0;
+            }
+        }
+
+        double RenderedRatio() const { return iterations > 0 ? static_cast<double>(frames) / iterations : 0.0; }
+
+        uint64_t iterations;                            // BeginIteration calls
+        uint64_t frames;                                // iterations that rendered
+        uint64_t pendingFrames;                         // frames rendered only for pending work
+        uint64_t reasonFrames[INVALIDATE_REASON_NUM];   // frames per invalidation bit, a frame may count for several
+    };
+
+public:
+    // An empty clock uses std::chrono::steady_clock. Starts with everything invalidated.
+    explicit FrameScheduler( Clock clock = Clock() );
+    ~FrameScheduler();
+
+public:
+    void Invalidate( uint32_t reasons ) { m_dirty |= reasons; }
+    uint32_t GetDirty() const { return m_dirty; }
+
+    // Asynchronous or progressive work in flight, rendered at the pending interval until it ends
+    void BeginWork() { m_pendingWork++; }
+    void EndWork() { if (m_pendingWork > 0) m_pendingWork--; }
+    uint32_t GetPendingWork() const { return m_pendingWork; }
+
+    // Wakes the loop at the pending interval without rendering, e.g. while input devices have to be polled
+    void SetPolling( bool bPolling ) { m_bPolling = bPolling; }
+
+    // Renders every iteration, as the loop did before
+    void SetContinuous( bool bContinuous ) { m_bContinuous = bContinuous; }
+
+    void SetPendingInterval( double seconds ) { m_pendingInterval = seconds; }
+    double GetPendingInterval() const { return m_pendingInterval; }
+
+    // Starts a loop iteration. Returns true when it should render a frame, which consumes the invalidations.
+    bool BeginIteration();
+
+    // How long the loop may sleep before the next iteration is due; 0 when a frame is due now
+    uint32_t GetWaitMilliseconds() const;
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+private:
+    double Now() const;
+
+private:
+    Clock    m_clock;
+
+    uint32_t m_dirty;
+    uint32_t m_pendingWork;
+    bool     m_bPolling;
+    bool     m_bContinuous;
+
+    double   m_pendingInterval;
+    double   m_lastFrameTime;
+    double   m_lastIterationTime;
+
+    Statistics m_statistics;
+};
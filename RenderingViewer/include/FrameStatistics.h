@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Rolling statistics of per-frame measurements. Independent of D3D.
+//
+// Every frame adds one sample of each metric: CPU frame time, the time of each named pass, draws, triangles,
+// uploaded bytes and heap allocations. The last windowFrames samples are kept in a ring, so percentiles and histograms follow
+// the recent frames and a spike stops counting once it leaves the window. Adding a frame only copies it into
+// the ring; percentiles are computed when asked for, with the nearest-rank method.
+class FrameStatistics
+{
+public:
+    enum METRIC
+    {
+        METRIC_CPU_TIME,        // ms
+        METRIC_DRAWS,
+        METRIC_TRIANGLES,
+        METRIC_UPLOAD_BYTES,
+        METRIC_ALLOCATIONS,
+
+        METRIC_PASS,            // ms of pass i is METRIC_PASS + i
+    };
+
+    static const uint32_t MAX_PASSES   = 8;
+    static const uint32_t METRIC_NUM   = METRIC_PASS + MAX_PASSES;
+    static const uint32_t INVALID_PASS = ~0u;
+
+    struct Frame
+    {
+        Frame() { Clear(); }
+
+        void Clear()
+        {
+            cpuMilliseconds = 0.0;
+            for (double& milliseconds : passMilliseconds)
+            {
+                milliseconds = 0.0;
+            }
+            draws       = 0;
+            triangles   = 0;
+            uploadBytes = 0;
+            allocations = 0;
+        }
+
+        double   cpuMilliseconds;
+        double   passMilliseconds[MAX_PASSES];  // at the index AddPass returned
+        uint64_t draws;
+        uint64_t triangles;
+        uint64_t uploadBytes;
+        uint64_t allocations;   // global heap allocations, see AllocationCounter
+    };
+
+    struct Percentiles
+    {
+        Percentiles()
+            : p50( 0.0 )
+            , p95( 0.0 )
+            , p99( 0.0 )
+            , max( 0.0 )
+            , mean( 0.0 )
+        {
+        }
+
+        double p50;
+        double p95;
+        double p99;
+        double max;
+        double mean;
+    };
+
+    // Buckets of bucketWidth from 0; the last one also counts everything above it
+    struct Histogram
+    {
+        double                bucketWidth;
+        std::vector<uint32_t> counts;
+    };
+
+public:
+    explicit FrameStatistics( uint32_t windowFrames = 600 );
+
+public:
+    // Index of the pass's time in Frame::passMilliseconds, the same index for the same name.
+    // INVALID_PASS once MAX_PASSES are named. Looking up a named pass does not allocate.
+    uint32_t AddPass( const char* name );
+    uint32_t GetPassCount() const { return static_cast<uint32_t>(m_passNames.size()); }
+
+    void AddFrame( const Frame& frame );
+
+    // Drops the samples, keeps the passes
+    void Clear();
+
+    uint64_t GetFrameCount() const { return m_frameCount; }     // added since the last Clear
+    uint32_t GetWindowCount() const { return m_windowCount; }   // in the window
+    uint32_t GetWindowFrames() const { return m_windowFrames; }
+
+    // The fixed metrics and one per named pass
+    uint32_t GetMetricCount() const { return METRIC_PASS + GetPassCount(); }
+    std::string GetMetricName( uint32_t metric ) const;
+    static bool IsTimeMetric( uint32_t metric ) { return metric == METRIC_CPU_TIME || metric >= METRIC_PASS; }
+
+    // All zero with an empty window
+    Percentiles GetPercentiles( uint32_t metric ) const;
+    Histogram GetHistogram( uint32_t metric, double bucketWidth, uint32_t bucketCount ) const;
+
+    // One line of percentiles per metric
+    void WriteReport( std::ostream& stream ) const;
+
+    // One bar per non-empty bucket, scaled to the fullest
+    void WriteHistogram( std::ostream& stream, uint32_t metric, double bucketWidth, uint32_t bucketCount ) const;
+
+private:
+    double GetSample( uint32_t metric, uint32_t frame ) const { return m_samples[static_cast<size_t>(frame) * METRIC_NUM + metric]; }
+
+private:
+    uint32_t                 m_windowFrames;
+    std::vector<double>      m_samples;         // METRIC_NUM per frame of the window
+    uint32_t                 m_nextFrame;
+    uint32_t                 m_windowCount;
+    uint64_t                 m_frameCount;
+    std::vector<std::string> m_passNames;
+};
+
+// Percentiles of a replay, stored to compare later runs of the same replay against. Independent of D3D.
+//
+// The file has one line per metric, unit and percentiles first and the name last, so names may contain
+// spaces. Values are written exactly. Compare checks p50 and p95 only: the tail of a short replay is
+// mostly noise, so p99 and max are stored to read, not to fail on.
+class FrameBaseline
+{
+public:
+    // A metric regresses when it is above baseline * (1 + relative) + absolute
+    struct Tolerance
+    {
+        Tolerance( double relative = 0.0, double absolute = 0.0 )
+            : relative( relative )
+            , absolute( absolute )
+        {
+        }
+
+        double relative;
+        double absolute;    // in the metric's unit, the slack of metrics near zero
+    };
+
+    struct Tolerances
+    {
+        Tolerances()
+            : time( 0.1, 0.5 )
+            , count( 0.0, 0.0 )
+        {
+        }
+
+        Tolerance time;     // ms metrics
+        Tolerance count;    // draws, triangles, bytes and allocations, which a fixed replay repeats exactly
+        std::vector<std::pair<std::string, Tolerance>> metrics;     // overrides by metric name
+    };
+
+    struct Entry
+    {
+        std::string                  name;
+        bool                         bTime;
+        FrameStatistics::Percentiles percentiles;
+    };
+
+    struct Comparison
+    {
+        std::string name;
+        const char* percentile;     // "p50" or "p95"
+        double      baseline;
+        double      current;
+        double      limit;
+        bool        bMissing;       // in the baseline but not in the current run
+        bool        bRegressed;
+    };
+
+public:
+    FrameBaseline();
+
+public:
+    void Capture( const FrameStatistics& statistics );
+
+    bool Write( const std::string& path );
+    bool Read( const std::string& path );
+
+    // Returns false when any metric of this baseline regressed in current or is missing from it.
+    // Metrics only current has are new and not compared.
+    bool Compare( const FrameBaseline& current, const Tolerances& tolerances, std::vector<Comparison>& comparisons ) const;
+
+    static void WriteComparisons( std::ostream& stream, const std::vector<Comparison>& comparisons );
+
+    const std::vector<Entry>& GetEntries() const { return m_entries; }
+    uint64_t GetFrameCount() const { return m_frameCount; }
+
+    // Why the last Write or Read failed, for the log
+    const std::string& GetError() const { return m_error; }
+
+private:
+    const Entry* Find( const std::string& name ) const;
+
+private:
+    std::vector<Entry> m_entries;
+    uint64_t           m_frameCount;
+    std::string        m_error;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+using namespace std;
+
+// Upload heaps holding the models' vertex and index buffers, placed through BufferSuballocator. Each block is
+// one ID3D12Heap with a single buffer over all of it, persistently mapped.
+class GeometryHeap : public BufferBlockBackend
+{
+public:
+    GeometryHeap( ID3D12Device* pDevice, UINT64 blockSize = BufferSuballocator::DEFAULT_BLOCK_SIZE );
+    ~GeometryHeap();
+
+public:
+    // Places size bytes and copies them in; INVALID_HANDLE when no block could be created. Upload and Free may
+    // be called from loading jobs, the rest only while none run.
+    BufferSuballocator::Handle Upload( const void* pData, UINT64 size, UINT64 alignment = 0 );
+
+    // Kept until the frame in progress has completed, see BufferSuballocator::EndFrame
+    void Free( BufferSuballocator::Handle handle );
+
+    // Defragment may move a buffer between frames, so views are made from this when recording
+    D3D12_GPU_VIRTUAL_ADDRESS GetGPUAddress( BufferSuballocator::Handle handle ) const;
+
+    BufferSuballocator& GetAllocator() { return *m_pAllocator; }
+    const BufferSuballocator& GetAllocator() const { return *m_pAllocator; }
+
+    virtual bool CreateBlock( uint32_t block, uint64_t size );
+    virtual void DestroyBlock( uint32_t block );
+    virtual void Copy( uint32_t srcBlock, uint64_t srcOffset, uint32_t dstBlock, uint64_t dstOffset, uint64_t size );
+
+private:
+    struct Block
+    {
+        Block()
+            : pCPU( nullptr )
+            , gpuAddress( 0 )
+        {
+        }
+
+        ComPtr<ID3D12Heap>        pHeap;
+        ComPtr<ID3D12Resource>    pResource;
+        unsigned char*            pCPU;
+        D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;
+        MemoryTracker::Handle     memory;
+    };
+
+    ComPtr<ID3D12Device>           m_pDevice;
+    vector<Block>                  m_blocks;
+    unique_ptr<BufferSuballocator> m_pAllocator;
+    mutex                          m_mutex;         // Upload and Free
+};
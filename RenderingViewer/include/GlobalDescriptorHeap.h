@@ -0,0 +1,54 @@
+#pragma once
+
+using namespace acLib;
+using namespace acLib::DX12;
+using namespace std;
+
+// The single shader-visible CBV/SRV/UAV heap every pass draws from.
+// Views are created in a CPU-only staging heap and copied into the slot the allocator handed out.
+class GlobalDescriptorHeap
+{
+public:
+    GlobalDescriptorHeap( ID3D12Device* pDevice, UINT persistentCount, UINT transientCountPerFrame, UINT frameCount );
+    ~GlobalDescriptorHeap();
+
+public:
+    UINT AllocatePersistent( UINT count ) { return m_allocator.AllocatePersistent( count ); }
+    void FreePersistent( UINT index, UINT count ) { m_allocator.FreePersistent( index, count ); }
+
+    UINT AllocateTransient( UINT count ) { return m_allocator.AllocateTransient( count ); }
+
+    void EndFrame( UINT64 fenceValue ) { m_allocator.EndFrame( fenceValue ); }
+    void Reclaim( UINT64 completedFenceValue ) { m_allocator.Reclaim( completedFenceValue ); }
+
+    bool CreateView( ID3D12Device* pDevice, shared_ptr<Buffer> pBuffer, Buffer::BUFFER_VIEW_TYPE type, UINT index );
+
+    D3D12_CPU_DESCRIPTOR_HANDLE GetCPUHandle( UINT index ) const;
+    D3D12_GPU_DESCRIPTOR_HANDLE GetGPUHandle( UINT index ) const;
+
+    ID3D12DescriptorHeap* GetHeap() const { return m_pHeap.Get(); }
+
+    const DescriptorAllocator::Statistics& GetStatistics() const { return m_allocator.GetStatistics(); }
+
+protected:
+    bool GetStagingView( ID3D12Device* pDevice, shared_ptr<Buffer> pBuffer, Buffer::BUFFER_VIEW_TYPE type, D3D12_CPU_DESCRIPTOR_HANDLE& handle );
+
+private:
+    ComPtr<ID3D12DescriptorHeap> m_pHeap;
+    UINT                         m_descriptorSize;
+    MemoryTracker::Handle        m_heapMemory;
+
+    DescriptorAllocator          m_allocator;
+
+    struct StagingView
+    {
+        weak_ptr<Buffer>            pBuffer;
+        D3D12_CPU_DESCRIPTOR_HANDLE handle;
+    };
+
+    // Retired staging heaps are kept because buffers remember the heaps they created views in
+    vector<shared_ptr<DescriptorHeap> > m_pStagingHeaps;
+    vector<MemoryTracker::Handle>       m_stagingMemory;
+    UINT                                m_stagingCount;
+    map<pair<const Buffer*, Buffer::BUFFER_VIEW_TYPE>, StagingView> m_stagingViews;
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Timestamp queries of a graphics API. Command lists are passed through untyped, as the backend's own list type.
+class GpuTimestampQueries
+{
+public:
+    virtual ~GpuTimestampQueries() {}
+
+    virtual uint32_t GetCapacity() const = 0;
+
+    // Timestamp ticks per second
+    virtual uint64_t GetFrequency() const = 0;
+
+    // Records the GPU time at which the commands before it completed
+    virtual void WriteTimestamp( void* pCommandList, uint32_t index ) = 0;
+
+    // Records a copy of the queries into CPU readable memory, after the timestamps in the same list
+    virtual void Resolve( void* pCommandList, uint32_t first, uint32_t count ) = 0;
+
+    // Only valid once the commands that resolved the queries completed; returns false when they could not be read
+    virtual bool Read( uint32_t first, uint32_t count, uint64_t* pTimestamps ) = 0;
+};
+
+// Stands in for a GPU: timestamps are taken from a clock the caller advances, and resolved queries only become
+// readable once the fence value they were submitted with is completed
+class MockGpuTimestampQueries : public GpuTimestampQueries
+{
+public:
+    MockGpuTimestampQueries( uint32_t capacity, uint64_t frequency );
+
+    // Time the commands recorded next take on the GPU
+    void Advance( uint64_t ticks ) { m_clock += ticks; }
+
+    // Resolves recorded since the last Submit execute with the given fence value
+    void Submit( uint64_t fenceValue );
+    void Complete( uint64_t fenceValue );
+
+    // Reads of queries that were not resolved or whose commands had not completed
+    uint64_t GetEarlyReads() const { return m_earlyReads; }
+
+    virtual uint32_t GetCapacity() const { return static_cast<uint32_t>(m_queries.size()); }
+    virtual uint64_t GetFrequency() const { return m_frequency; }
+
+    virtual void WriteTimestamp( void* pCommandList, uint32_t index );
+    virtual void Resolve( void* pCommandList, uint32_t first, uint32_t count );
+    virtual bool Read( uint32_t first, uint32_t count, uint64_t* pTimestamps );
+
+private:
+    static const uint64_t UNSUBMITTED = ~0ull;
+
+    struct Query
+    {
+        uint64_t written;
+        uint64_t resolved;
+        uint64_t fenceValue;    // of the submission that resolved it, UNSUBMITTED until then
+        bool     bResolved;
+    };
+
+    std::vector<Query>    m_queries;
+    std::vector<uint32_t> m_unsubmitted;
+    uint64_t              m_frequency;
+    uint64_t              m_clock;
+    uint64_t              m_completedFence;
+    uint64_t              m_earlyReads;
+};
+
+// Times named zones of GPU work per frame with timestamp queries. Independent of D3D.
+//
+// Each zone brackets commands in one command list with a pair of timestamps and resolves the pair right after.
+// A frame is read once the fence value it was submitted with has completed, usually a frame or two later, so
+// the CPU never waits on the queries. Frames are kept in MAX_FRAMES query ranges; when the GPU falls further
+// behind, the new frame goes untimed. The newest frame read is also handed to the Profiler summary.
+class GpuTimer
+{
+public:
+    static const uint32_t MAX_ZONES    = 8;     // per frame
+    static const uint32_t MAX_FRAMES   = 4;     // submitted and not yet read
+    static const uint32_t QUERY_COUNT  = 2 * MAX_ZONES * MAX_FRAMES;
+    static const uint32_t INVALID_ZONE = ~0u;
+
+    struct ZoneTime
+    {
+        const char* name;
+        double      milliseconds;
+    };
+
+    struct Statistics
+    {
+        Statistics() { Clear(); }
+
+        void Clear()
+        {
+            frames           = 0;
+            readFrames       = 0;
+            skippedFrames    = 0;
+            droppedZones     = 0;
+            failedReads      = 0;
+            lastLatency      = 0;
+            maxLatency       = 0;
+            lastMilliseconds = 0.0;
+        }
+
+        uint64_t frames;            // submitted
+        uint64_t readFrames;
+        uint64_t skippedFrames;     // every range still in flight, the frame was not timed
+        uint64_t droppedZones;      // past MAX_ZONES, or begun and never ended
+        uint64_t failedReads;
+        uint32_t lastLatency;       // frames submitted until a frame was read, 1 when read during the next frame
+        uint32_t maxLatency;
+        double   lastMilliseconds;  // first zone begin to last zone end of the newest frame read
+    };
+
+public:
+    explicit GpuTimer( GpuTimestampQueries& queries );
+
+public:
+    // Returns INVALID_ZONE when the frame is not timed; EndZone ignores it
+    uint32_t BeginZone( void* pCommandList, const char* name );
+    void EndZone( void* pCommandList, uint32_t zone );
+
+    // The zones begun since the previous call were submitted, followed by a signal of fenceValue
+    void EndFrame( uint64_t fenceValue );
+
+    // Reads every frame whose fence value completed, oldest first. Returns the number of frames read.
+    uint32_t Update( uint64_t completedFenceValue );
+
+    // Zones of the newest frame read, in the order they were begun
+    const std::vector<ZoneTime>& GetZoneTimes() const { return m_zoneTimes; }
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+private:
+    struct Zone
+    {
+        const char* name;
+        bool        bEnded;
+    };
+
+    struct Frame
+    {
+        Frame()
+            : frameIndex( 0 )
+            , fenceValue( 0 )
+            , bInFlight( false )
+        {
+        }
+
+        uint64_t          frameIndex;
+        uint64_t          fenceValue;
+        bool              bInFlight;
+        std::vector<Zone> zones;
+    };
+
+    uint32_t GetQuery( uint32_t slot, uint32_t zone ) const { return (slot * MAX_ZONES + zone) * 2; }
+
+    void ReadFrame( Frame& frame, uint32_t slot );
+
+private:
+    GpuTimestampQueries& m_queries;
+    bool                 m_bValid;
+
+    Frame                m_frames[MAX_FRAMES];
+    uint64_t             m_frameIndex;
+    bool                 m_bStarted;      // the current frame has begun a zone
+    bool                 m_bTimed;        // and got a query range
+
+    std::vector<ZoneTime> m_zoneTimes;
+    std::vector<uint64_t> m_timestamps;
+
+    Statistics m_statistics;
+};
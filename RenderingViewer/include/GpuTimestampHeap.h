@@ -0,0 +1,29 @@
+#pragma once
+
+using namespace std;
+
+// Timestamp query heap with a readback buffer the queries are resolved into
+class GpuTimestampHeap : public GpuTimestampQueries
+{
+public:
+    GpuTimestampHeap( ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue, UINT capacity );
+    ~GpuTimestampHeap();
+
+public:
+    bool IsValid() const { return m_pQueryHeap != nullptr && m_pReadback != nullptr; }
+
+    // Command lists are ID3D12GraphicsCommandList
+    virtual uint32_t GetCapacity() const { return IsValid() ? m_capacity : 0; }
+    virtual uint64_t GetFrequency() const { return m_frequency; }
+
+    virtual void WriteTimestamp( void* pCommandList, uint32_t index );
+    virtual void Resolve( void* pCommandList, uint32_t first, uint32_t count );
+    virtual bool Read( uint32_t first, uint32_t count, uint64_t* pTimestamps );
+
+private:
+    ComPtr<ID3D12QueryHeap> m_pQueryHeap;
+    ComPtr<ID3D12Resource>  m_pReadback;
+    MemoryTracker::Handle   m_readbackMemory;
+    UINT                    m_capacity;
+    UINT64                  m_frequency;
+};
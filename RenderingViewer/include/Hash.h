@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Hash
+{
+    const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+    const uint64_t FNV_PRIME        = 1099511628211ULL;
+
+    // 64-bit FNV-1a. Chain calls by passing the previous result as seed.
+    inline uint64_t Fnv1a( const void* pData, size_t size, uint64_t seed = FNV_OFFSET_BASIS )
+    {
+        const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= pBytes[i];
+            hash *= FNV_PRIME;
+        }
+
+        return hash;
+    }
+
+    template<typename T>
+    inline uint64_t Value( const T& value, uint64_t seed = FNV_OFFSET_BASIS )
+    {
+        return Fnv1a( &value, sizeof( T ), seed );
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
-class InputManager
+// Keyboard is polled by the caller; the mouse is read by an InputSampler thread and drained by ProcessMouse
+class InputManager : public InputSource
 {
 public:
     enum ACTION_STATE
@@ -25,8 +26,22 @@ public:
     void Release();
 
     void ProcessKeyboard();
+
+    // DIK_ key code went down since the previous ProcessKeyboard
+    bool IsKeyPressed( BYTE key ) const { return (m_keyboardBuffer[key] & 0x80) && !(m_prevKeyboardBuffer[key] & 0x80); }
+
+    // Takes the mouse input sampled since the previous call
     void ProcessMouse();
 
+    // Input the current mouse state was built from, with its sample times
+    const InputSampler::Frame& GetInputFrame() const { return m_inputFrame; }
+
+    InputSampler& GetSampler() { return m_sampler; }
+    const InputSampler& GetSampler() const { return m_sampler; }
+
+    // Reads the mouse on the sampling thread
+    virtual bool Sample( InputState& state );
+
     const DIMOUSESTATE& GetMouseState() const { return m_mouseState; }
     const DIMOUSESTATE& GetPrevMouseState() const { return m_prevMouseState; }
 
@@ -51,5 +66,8 @@ private:
     LPDIRECTINPUTDEVICE8  m_pDIMouse;
     DIMOUSESTATE m_prevMouseState;
     DIMOUSESTATE m_mouseState;
+
+    InputSampler        m_sampler;
+    InputSampler::Frame m_inputFrame;
 };
 
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// One read of a pointing device
+struct InputState
+{
+    int32_t  dx;        // relative motion since the previous sample
+    int32_t  dy;
+    int32_t  dz;        // wheel
+    uint32_t buttons;   // bit per held button
+};
+
+class InputSource
+{
+public:
+    virtual ~InputSource() {}
+
+    // Called on the sampling thread. Returns false when the device could not be read this time.
+    virtual bool Sample( InputState& state ) = 0;
+};
+
+// Replays scripted steps, one state per sample, so the sampler can run without a device
+class SyntheticInputSource : public InputSource
+{
+public:
+    SyntheticInputSource();
+
+    // Steps are added before sampling starts
+    void AddStep( const InputState& state, uint32_t samples );
+    void AddDrag( uint32_t buttons, int32_t dx, int32_t dy, uint32_t samples );
+    void AddIdle( uint32_t samples );
+
+    bool IsFinished() const { return m_sampleCount.load() >= m_totalSamples; }
+    uint64_t GetSampleCount() const { return m_sampleCount.load(); }
+
+    // Sums of the motion the source has reported so far
+    int64_t GetTotalX() const { return m_totalX.load(); }
+    int64_t GetTotalY() const { return m_totalY.load(); }
+
+    virtual bool Sample( InputState& state );
+
+private:
+    struct Step
+    {
+        InputState state;
+        uint64_t   endSample;
+    };
+
+    std::vector<Step>     m_steps;
+    uint64_t              m_totalSamples;
+    size_t                m_step;
+
+    std::atomic<uint64_t> m_sampleCount;
+    std::atomic<int64_t>  m_totalX;
+    std::atomic<int64_t>  m_totalY;
+};
+
+// Samples an input device on its own thread into timestamped events. Independent of D3D.
+//
+// The sampling thread pushes an event whenever the device moved or a button changed, and the render
+// loop drains the events right before it updates the camera. Events go through a single-producer,
+// single-consumer ring, so neither side takes a lock. Each drained frame carries the time of the input
+// it reflects; RecordPresent turns that into input-to-present latency.
+class InputSampler
+{
+public:
+    // Seconds from an arbitrary origin, as FrameScheduler::Clock
+    typedef std::function<double()> Clock;
+
+    // Called on the sampling thread when an event arrives in an empty ring, e.g. to wake the message loop
+    typedef std::function<void()> Notify;
+
+    static const uint32_t RING_SIZE = 256;
+
+    // Input drained by one Consume call
+    struct Frame
+    {
+        Frame() { Clear(); }
+
+        void Clear()
+        {
+            dx         = 0;
+            dy         = 0;
+            dz         = 0;
+            buttons    = 0;
+            pressed    = 0;
+            released   = 0;
+            eventCount = 0;
+            firstTime  = 0.0;
+            lastTime   = 0.0;
+        }
+
+        bool HasInput() const { return eventCount > 0; }
+
+        int32_t  dx;
+        int32_t  dy;
+        int32_t  dz;
+        uint32_t buttons;       // held after the last event
+        uint32_t pressed;       // buttons that went down during the frame
+        uint32_t released;      // buttons that went up during the frame
+        uint32_t eventCount;
+        double   firstTime;     // sample time of the oldest event
+        double   lastTime;      // sample time of the newest event
+    };
+
+    struct Statistics
+    {
+        Statistics() { Clear(); }
+
+        void Clear()
+        {
+            samples        = 0;
+            failedSamples  = 0;
+            events         = 0;
+            coalesced      = 0;
+            presents       = 0;
+            latencySum     = 0.0;
+            latencyMax     = 0.0;
+            lastLatencySum = 0.0;
+        }
+
+        double AverageLatency() const { return presents > 0 ? latencySum / presents : 0.0; }
+        double AverageLastLatency() const { return presents > 0 ? lastLatencySum / presents : 0.0; }
+
+        uint64_t samples;           // device reads
+        uint64_t failedSamples;
+        uint64_t events;            // samples that moved or changed a button
+        uint64_t coalesced;         // events merged into the previous one while the ring was full
+        uint64_t presents;          // presented frames that reflected input
+        double   latencySum;        // seconds from the oldest input of a frame to its present
+        double   latencyMax;
+        double   lastLatencySum;    // seconds from the newest input of a frame to its present
+    };
+
+public:
+    // An empty clock uses std::chrono::steady_clock
+    explicit InputSampler( InputSource& source, Clock clock = Clock() );
+    ~InputSampler();
+
+public:
+    void SetNotify( Notify notify ) { m_notify = notify; }
+
+    // Samples at rate per second until Stop
+    void Start( double rate = 1000.0 );
+    void Stop();
+    bool IsRunning() const { return m_thread.joinable(); }
+
+    // Reads the source once; the sampling thread calls it, and tests may call it while the thread is stopped
+    void SampleOnce();
+
+    // Drains the events since the previous call. Called by one thread only.
+    void Consume( Frame& frame );
+
+    // Events waiting to be consumed
+    bool HasPending() const { return m_head.load( std::memory_order_acquire ) != m_tail.load( std::memory_order_relaxed ); }
+
+    // Latency of a frame presented at presentTime; frames without input are not counted
+    void RecordPresent( const Frame& frame, double presentTime );
+
+    double Now() const { return m_clock(); }
+
+    // A snapshot; the sampling thread keeps counting
+    Statistics GetStatistics() const;
+
+private:
+    struct Event
+    {
+        double     time;
+        InputState state;
+    };
+
+    bool Push( const Event& event );
+
+    void Loop( double rate );
+
+private:
+    InputSource&          m_source;
+    Clock                 m_clock;
+    Notify                m_notify;
+
+    // Producer writes m_head, consumer writes m_tail
+    Event                 m_ring[RING_SIZE];
+    std::atomic<uint32_t> m_head;
+    std::atomic<uint32_t> m_tail;
+
+    // Sampling thread only
+    Event                 m_pending;
+    bool                  m_bPending;
+    uint32_t              m_sampledButtons;
+
+    // Consumer only
+    uint32_t              m_consumedButtons;
+
+    std::thread           m_thread;
+    std::atomic<bool>     m_bRunning;
+
+    std::atomic<uint64_t> m_samples;
+    std::atomic<uint64_t> m_failedSamples;
+    std::atomic<uint64_t> m_events;
+    std::atomic<uint64_t> m_coalesced;
+
+    Statistics            m_presentStatistics;
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing job scheduler shared by loading, transforms, culling, sorting and the rasterizer.
+// Independent of D3D.
+//
+// Every worker owns a Chase-Lev deque: it pushes and pops jobs at the bottom, idle threads steal from the
+// top, so a thread works through its own jobs depth first while the oldest, largest ones spread out.
+// Threads that are not workers share one more deque, guarded by a mutex on their side only.
+//
+// A job is a function pointer, a context and a range, taken from a fixed ring of the submitting thread,
+// so submitting never touches the heap. Counters track groups of jobs: Wait returns once a counter is
+// zero, running jobs in the meantime instead of blocking, and a job given a dependency starts only once
+// that counter is zero. ParallelFor splits an index range into jobs and helps until they are done, so it
+// may be called from inside a job.
+//
+// Jobs must not block on each other except through Wait; a thread waiting any other way holds a thread
+// the others may need.
+class JobSystem
+{
+public:
+    typedef void (*Function)( void* pContext, uint32_t begin, uint32_t end );
+
+    class Counter;
+
+private:
+    struct Job
+    {
+        Job() : bBusy( false ) {}
+
+        Function          function;
+        void*             pContext;
+        uint32_t          begin;
+        uint32_t          end;
+        Counter*          pCounter;
+        Job*              pNextWaiting;     // in the waiting list of a dependency
+        std::atomic<bool> bBusy;            // from submission until the job starts
+    };
+
+public:
+    // Jobs not yet finished. Waited on before it goes out of scope, and not while jobs are still being added
+    // from outside the ones it counts.
+    class Counter
+    {
+    public:
+        Counter() : m_value( 0 ), m_pWaiting( nullptr ) {}
+
+        Counter( const Counter& ) = delete;
+        Counter& operator=( const Counter& ) = delete;
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<uint32_t> m_value;
+        std::mutex            m_mutex;      // orders reaching zero against adding waiting jobs
+        Job*                  m_pWaiting;   // jobs that start when the value reaches zero
+    };
+
+    struct Statistics
+    {
+        Statistics()
+            : jobs( 0 )
+            , steals( 0 )
+            , inlineJobs( 0 )
+            , sleeps( 0 )
+        {
+        }
+
+        uint64_t jobs;          // run since construction
+        uint64_t steals;        // taken from another thread's deque
+        uint64_t inlineJobs;    // run at submission because the deque was full
+        uint64_t sleeps;        // workers going to sleep for lack of jobs
+    };
+
+    // Jobs one thread may have submitted and not yet started, and the size of each deque
+    static const uint32_t JOB_CAPACITY = 4096;
+
+    static const uint32_t DEFAULT_WORKERS = ~0u;
+
+public:
+    // workerCount threads besides the callers; DEFAULT_WORKERS uses the hardware concurrency minus one, 0 runs
+    // every job on the thread that waits for it
+    explicit JobSystem( uint32_t workerCount = DEFAULT_WORKERS );
+    ~JobSystem();
+
+    JobSystem( const JobSystem& ) = delete;
+    JobSystem& operator=( const JobSystem& ) = delete;
+
+    // Shared by every part of the viewer, so they do not oversubscribe the cores
+    static JobSystem& GetInstance();
+
+public:
+    // Workers and one caller
+    uint32_t GetThreadCount() const { return m_workerCount + 1; }
+
+    // func() on some thread. The counter goes up now and down when func returns; func starts once
+    // pDependency, when given, is zero. func must outlive the job.
+    template <typename Func>
+    void Run( Func& func, Counter* pCounter, Counter* pDependency = nullptr )
+    {
+        Submit( &InvokeOnce<Func>, &func, 0, 1, pCounter, pDependency );
+    }
+
+    // func( i ) for every i below count, in jobs of grain indices, 0 picking a few jobs per thread. The grain
+    // is raised when the jobs would not fit the ring. Returns once every call has.
+    template <typename Func>
+    void ParallelFor( uint32_t count, Func& func, uint32_t grain = 0 )
+    {
+        ParallelFor( count, grain, &InvokeRange<Func>, &func );
+    }
+
+    void ParallelFor( uint32_t count, uint32_t grain, Function function, void* pContext );
+
+    // The general form of Run, for a range of one function
+    void Submit( Function function, void* pContext, uint32_t begin, uint32_t end, Counter* pCounter, Counter* pDependency = nullptr );
+
+    // Runs jobs until counter is zero
+    void Wait( Counter& counter );
+
+    Statistics GetStatistics() const;
+
+private:
+    // Chase-Lev deque of fixed size, as in "Correct and Efficient Work-Stealing for Weak Memory Models"
+    class Deque
+    {
+    public:
+        Deque();
+
+        // Owner only; false when full
+        bool Push( Job* pJob );
+        Job* Pop();
+
+        // Any thread; nullptr when empty or when another thread took the job first
+        Job* Steal();
+
+    private:
+        alignas(64) std::atomic<int64_t> m_top;
+        alignas(64) std::atomic<int64_t> m_bottom;
+        std::atomic<Job*>                m_jobs[JOB_CAPACITY];
+    };
+
+    // A thread's deque and job ring; slot 0 belongs to every thread that is not a worker
+    struct alignas(64) Slot
+    {
+        Slot() : nextJob( 0 ), jobCount( 0 ), stealCount( 0 ), inlineCount( 0 ) {}
+
+        Deque    deque;
+        Job      jobs[JOB_CAPACITY];
+        uint32_t nextJob;
+
+        std::atomic<uint64_t> jobCount;
+        std::atomic<uint64_t> stealCount;
+        std::atomic<uint64_t> inlineCount;
+    };
+
+    template <typename Func>
+    static void InvokeOnce( void* pContext, uint32_t, uint32_t )
+    {
+        (*static_cast<Func*>(pContext))();
+    }
+
+    template <typename Func>
+    static void InvokeRange( void* pContext, uint32_t begin, uint32_t end )
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            (*static_cast<Func*>(pContext))( i );
+        }
+    }
+
+    // Slot of the calling thread
+    uint32_t GetSlot() const;
+
+    Job* AllocateJob( uint32_t slot );
+
+    void Push( uint32_t slot, Job* pJob );
+
+    // A job of the calling thread's deque, else one stolen from the others
+    Job* Take( uint32_t slot );
+
+    void Execute( uint32_t slot, Job* pJob );
+
+    // Lowers the counter and starts its waiting jobs when it reaches zero
+    void Finish( uint32_t slot, Counter& counter );
+
+    void Loop( uint32_t slot );
+
+private:
+    uint32_t m_workerCount;
+
+    std::vector<std::unique_ptr<Slot> > m_slots;
+    std::vector<std::thread>            m_threads;
+
+    std::mutex m_externalMutex;     // the owner side of slot 0
+
+    // Workers sleep when there is nothing to steal; m_queued counts jobs in the deques
+    std::mutex              m_mutex;
+    std::condition_variable m_wake;
+    std::atomic<int32_t>    m_queued;
+    std::atomic<uint32_t>   m_sleeping;
+    std::atomic<uint64_t>   m_sleeps;
+    bool                    m_bStop;
+};
@@ -17,17 +17,45 @@ public:
         Vec3f intensity[DIRECTIONAL_LIGHT_NUM];
         //Mat44f lightVP[DIRECTIONAL_LIGHT_NUM];
 
+        // Cascaded shadow map, one tile of the shadow map atlas per cascade
+        static const int CASCADE_NUM = 4;
+        float  cascadePadding[2];
+        Mat44f cascadeViewProjection[CASCADE_NUM];
+        Vec4f  cascadeSplits;                      // far view depth of each cascade
+        Vec4f  cascadeRects[CASCADE_NUM];          // atlas uv scale in xy, offset in zw
+        UINT   cascadeCount;
+
         DWORD size;
     };
 
+    // Width and height of the fixed shadow box used until the first fit
+    static const float DEFAULT_SHADOW_EXTENT;
+
 public:
     Light( ID3D12Device* pDevice );
     ~Light();
 
 public:
-    virtual bool BindDescriptorHeap( ID3D12Device* pDevice, shared_ptr<DescriptorHeap> pDescHeap );
+    virtual void UpdateGPUBuffer( UploadRingAllocator& ring );
+
+    virtual D3D12_GPU_VIRTUAL_ADDRESS GetConstantBufferAddress() const { return m_constants.GetGPUAddress(); }
+
+    // Light constants with view and projection replaced by one cascade, for rendering into its tile
+    D3D12_GPU_VIRTUAL_ADDRESS GetCascadeConstantBufferAddress( UINT cascade ) const { return m_cascadeConstants[cascade].GetGPUAddress(); }
+
+    // Fits one shadow box per cascade to the part of bounds the camera sees, or a single box to all of
+    // bounds without a camera. shadowMapSize is the size of the whole atlas.
+    void FitShadowFrustum( const Camera* pCamera, const ShadowFrustum::Bounds& bounds, UINT shadowMapSize );
 
-    virtual void UpdateGPUBuffer();
+    // Clamped to [1, CASCADE_NUM]
+    void SetCascadeCount( UINT count );
+    UINT GetCascadeCount() const { return m_cascadeCount; }
+
+    // 0 splits the depth range uniformly, 1 logarithmically
+    void SetCascadeSplitLambda( float lambda ) { m_cascadeSplitLambda = lambda; }
+    float GetCascadeSplitLambda() const { return m_cascadeSplitLambda; }
+
+    const ShadowFrustum::Result& GetShadowFrustum( UINT cascade = 0 ) const { return m_shadowFrustum[cascade]; }
 
 public:
     ResLightData & GetBufferData() { return m_lightBufferData; }
@@ -36,7 +64,16 @@ public:
 protected:
     virtual bool CreateCB( ID3D12Device* pDevice );
 
+    void UpdateLightData();
+
 private:
     ResLightData               m_lightBufferData;
-    shared_ptr<ConstantBuffer> m_pLightCB;
+    ConstantUpload             m_constants;
+
+    ResLightData               m_cascadeBufferData[ResLightData::CASCADE_NUM];
+    ConstantUpload             m_cascadeConstants[ResLightData::CASCADE_NUM];
+
+    UINT                       m_cascadeCount;
+    float                      m_cascadeSplitLambda;
+    ShadowFrustum::Result      m_shadowFrustum[ResLightData::CASCADE_NUM];
 };
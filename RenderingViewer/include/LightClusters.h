@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Point and spot lights in structure-of-arrays form. Independent of D3D.
+//
+// Point lights have spotCosOuter -1, which makes the cone the whole sphere.
+struct LightList
+{
+    void Clear();
+    void Reserve( size_t count );
+
+    size_t Size() const { return positionX.size(); }
+
+    uint32_t AddPointLight( const float position[3], float range, const float color[3] );
+
+    // Angles are half-angles in radians, direction points away from the light
+    uint32_t AddSpotLight( const float position[3], const float direction[3], float range, float innerAngle, float outerAngle, const float color[3] );
+
+    // Sphere that contains everything the light reaches: center xyz, radius w
+    void GetBoundingSphere( size_t index, float sphere[4] ) const;
+
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> positionZ;
+    std::vector<float> range;
+
+    std::vector<float> colorR;
+    std::vector<float> colorG;
+    std::vector<float> colorB;
+
+    std::vector<float> directionX;
+    std::vector<float> directionY;
+    std::vector<float> directionZ;
+    std::vector<float> spotCosInner;
+    std::vector<float> spotCosOuter;
+};
+
+// Bins lights into a view-space froxel grid for clustered shading. Independent of D3D.
+//
+// The grid has TILES_X x TILES_Y screen tiles and exponentially spaced depth slices between the
+// near and far planes of the projection. Each light's bounding sphere is tested against the tile
+// planes, which pass through the eye, and against the slice depths. The result is a range per
+// cluster into one compact index list. Indices of a cluster are in ascending light order, so the
+// output does not depend on the thread count.
+//
+// Matrices are 16 floats in the layout the shaders read (column_major packing, mul( M, v )). The view
+// matrix must be rigid so radii carry over to view space.
+class LightClusters
+{
+public:
+    struct Config
+    {
+        Config()
+            : tilesX( 16 )
+            , tilesY( 9 )
+            , slices( 24 )
+            , nearZ( 0.0f )
+            , farZ( 0.0f )
+        {
+        }
+
+        uint32_t tilesX;   // at most 255
+        uint32_t tilesY;   // at most 255
+        uint32_t slices;   // at most 255
+        float    nearZ;    // 0 takes the near plane of the projection
+        float    farZ;     // 0 takes the far plane of the projection
+    };
+
+    struct Range
+    {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    // Counters of the last Build call
+    struct Statistics
+    {
+        Statistics() { Clear(); }
+
+        void Clear()
+        {
+            lights           = 0;
+            visibleLights    = 0;
+            indices          = 0;
+            maxClusterLights = 0;
+            threads          = 0;
+            milliseconds     = 0.0;
+        }
+
+        uint32_t lights;
+        uint32_t visibleLights;     // inside the depth range of the grid
+        uint32_t indices;           // light/cluster pairs
+        uint32_t maxClusterLights;
+        uint32_t threads;
+        double   milliseconds;
+    };
+
+public:
+    // threadCount 0 uses the hardware concurrency
+    explicit LightClusters( uint32_t threadCount = 0 );
+    ~LightClusters();
+
+public:
+    void SetConfig( const Config& config ) { m_config = config; }
+    const Config& GetConfig() const { return m_config; }
+
+    uint32_t GetThreadCount() const { return m_threadCount; }
+
+    // Returns false when the projection cannot be inverted or has no positive depth range
+    bool Build( const float view[16], const float projection[16], const LightList& lights );
+
+    uint32_t GetClusterCount() const { return m_config.tilesX * m_config.tilesY * m_config.slices; }
+
+    // Tile y counts from the top of the screen, like pixel rows
+    uint32_t GetClusterIndex( uint32_t x, uint32_t y, uint32_t slice ) const { return (slice * m_config.tilesY + y) * m_config.tilesX + x; }
+
+    const std::vector<Range>& GetRanges() const { return m_ranges; }
+    const std::vector<uint32_t>& GetIndices() const { return m_indices; }
+
+    // Depth range the grid was built for
+    float GetNear() const { return m_nearZ; }
+    float GetFar() const { return m_farZ; }
+
+    // slice = floor( log( viewDepth ) * scale + bias ), clamped to the slice count
+    float GetSliceScale() const { return m_sliceScale; }
+    float GetSliceBias() const { return m_sliceBias; }
+    uint32_t GetSlice( float viewDepth ) const;
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+private:
+    // Cluster range of one light, inclusive; z0 > z1 when the light is outside the depth range
+    struct Bounds
+    {
+        uint8_t x0, x1;
+        uint8_t y0, y1;
+        uint8_t z0, z1;
+    };
+
+    // Per binning thread: its index list, which cluster ranges are relative to, and the lists BinSlices
+    // reuses from one Build to the next
+    struct BinScratch
+    {
+        std::vector<uint32_t> indices;
+        std::vector<uint32_t> sliceOffsets;
+        std::vector<uint32_t> sliceLights;
+        std::vector<uint32_t> sliceFill;
+        std::vector<uint32_t> counts;
+    };
+
+    void ComputeBounds( const float view[16], const float projection[16], const LightList& lights, size_t begin, size_t end );
+    void BinSlices( uint32_t thread, uint32_t sliceBegin, uint32_t sliceEnd );
+
+    // func( i ) for every i below workerCount, as jobs of the shared JobSystem
+    template <typename Func>
+    void ParallelFor( uint32_t workerCount, Func func );
+
+private:
+    uint32_t m_threadCount;
+    Config   m_config;
+
+    float m_nearZ;
+    float m_farZ;
+    float m_sliceScale;
+    float m_sliceBias;
+
+    std::vector<Bounds>   m_bounds;
+    std::vector<uint32_t> m_visible;
+
+    std::vector<BinScratch> m_binScratch;
+    std::vector<uint32_t>   m_threadBase;
+
+    std::vector<Range>    m_ranges;
+    std::vector<uint32_t> m_indices;
+
+    Statistics m_statistics;
+};
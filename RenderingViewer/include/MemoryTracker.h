@@ -0,0 +1,241 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What a tracked allocation holds, in terms a backend can size
+struct MemoryResourceDesc
+{
+    enum TYPE
+    {
+        TYPE_BUFFER,
+        TYPE_TEXTURE_2D,
+        TYPE_DESCRIPTOR_HEAP,
+    };
+
+    enum FLAG
+    {
+        FLAG_RENDER_TARGET = 1 << 0,
+        FLAG_DEPTH_STENCIL = 1 << 1,
+    };
+
+    static MemoryResourceDesc Buffer( uint64_t bytes );
+    static MemoryResourceDesc Texture2D( uint32_t width, uint32_t height, uint32_t bytesPerTexel, uint32_t flags = 0 );
+    static MemoryResourceDesc DescriptorHeap( uint32_t count, uint32_t descriptorSize );
+
+    // Bytes of data, before any alignment or padding of the device
+    uint64_t GetBytes() const { return width * height * elementSize; }
+
+    TYPE     type;
+    uint64_t width;         // bytes, texels or descriptors
+    uint32_t height;
+    uint32_t elementSize;   // bytes per texel or descriptor, 1 for buffers
+    uint32_t flags;
+};
+
+class MemoryBackend
+{
+public:
+    virtual ~MemoryBackend() {}
+
+    // Bytes the device reserves for the resource, alignment and padding included
+    virtual uint64_t GetAllocationSize( const MemoryResourceDesc& desc ) = 0;
+
+    // Device memory the process may use and does use as the OS sees it; false when unknown
+    virtual bool QueryDeviceMemory( uint64_t& budget, uint64_t& usage ) = 0;
+};
+
+// Sizes resources as a typical discrete GPU places them: buffers and textures in 64 KiB pages, descriptor heaps
+// exactly. Device memory is whatever was set.
+class MockMemoryBackend : public MemoryBackend
+{
+public:
+    static const uint64_t PAGE_SIZE = 64 * 1024;
+
+    MockMemoryBackend();
+
+    void SetDeviceMemory( uint64_t budget, uint64_t usage ) { m_budget = budget; m_usage = usage; }
+
+    virtual uint64_t GetAllocationSize( const MemoryResourceDesc& desc );
+    virtual bool QueryDeviceMemory( uint64_t& budget, uint64_t& usage );
+
+private:
+    uint64_t m_budget;
+    uint64_t m_usage;
+};
+
+// Accounts device memory by category and owner. Independent of D3D.
+//
+// Every buffer, texture and descriptor heap is tracked by a handle kept next to the resource, so the memory is
+// counted until the resource is destroyed. Sizes come from the backend; without one the data size is counted.
+// Current and peak bytes are kept per category and per owner, and a category or the total that grows past its
+// budget calls the warning callback once, until it drops back under. Thread-safe.
+class MemoryTracker
+{
+public:
+    enum CATEGORY
+    {
+        CATEGORY_GEOMETRY,
+        CATEGORY_CONSTANTS,
+        CATEGORY_DESCRIPTORS,
+        CATEGORY_SHADOW,
+        CATEGORY_RENDER_TARGETS,
+        CATEGORY_OTHER,
+
+        CATEGORY_NUM,
+    };
+
+    // Called without the lock held; category is CATEGORY_NUM for the total
+    typedef std::function<void( CATEGORY category, uint64_t bytes, uint64_t budget )> BudgetWarning;
+
+    struct Usage
+    {
+        Usage() { Clear(); }
+
+        void Clear()
+        {
+            bytes          = 0;
+            requestedBytes = 0;
+            peakBytes      = 0;
+            allocations    = 0;
+        }
+
+        uint64_t bytes;             // as placed by the device
+        uint64_t requestedBytes;    // data size of the same allocations
+        uint64_t peakBytes;
+        uint32_t allocations;       // live
+    };
+
+    struct OwnerUsage
+    {
+        const void* owner;
+        std::string name;
+        Usage       usage;
+    };
+
+    struct Statistics
+    {
+        Statistics() { Clear(); }
+
+        void Clear()
+        {
+            total.Clear();
+            for (uint32_t i = 0; i < CATEGORY_NUM; ++i)
+            {
+                categories[i].Clear();
+            }
+            tracked        = 0;
+            released       = 0;
+            budgetWarnings = 0;
+        }
+
+        Usage    total;
+        Usage    categories[CATEGORY_NUM];
+        uint64_t tracked;
+        uint64_t released;
+        uint64_t budgetWarnings;
+    };
+
+    // Releases its memory when destroyed; only moved, never copied
+    class Handle
+    {
+    public:
+        Handle();
+        ~Handle() { Release(); }
+
+        Handle( Handle&& other ) noexcept;
+        Handle& operator=( Handle&& other ) noexcept;
+
+        void Release();
+
+        bool IsValid() const { return m_pTracker != nullptr; }
+
+    private:
+        Handle( const Handle& );
+        Handle& operator=( const Handle& );
+
+        friend class MemoryTracker;
+
+        MemoryTracker* m_pTracker;
+        uint64_t       m_id;
+    };
+
+public:
+    MemoryTracker();
+
+    // The tracker the viewer's resources report to
+    static MemoryTracker& GetInstance();
+
+    static const char* GetCategoryName( CATEGORY category );
+
+public:
+    // Not owned; set before anything is tracked, or sizes of earlier allocations stay as they were counted
+    void SetBackend( MemoryBackend* pBackend );
+
+    void SetWarning( BudgetWarning warning );
+
+    // 0 disables a budget
+    void SetBudget( CATEGORY category, uint64_t bytes );
+    void SetTotalBudget( uint64_t bytes );
+
+    // Owners are named once, e.g. a model by its source path; unnamed owners are listed by address
+    void SetOwnerName( const void* owner, const std::string& name );
+    void RemoveOwner( const void* owner );
+
+    Handle Track( CATEGORY category, const MemoryResourceDesc& desc, const void* owner = nullptr );
+
+    Statistics GetStatistics() const;
+    Usage GetUsage( CATEGORY category ) const;
+    Usage GetOwnerUsage( const void* owner ) const;
+
+    // Owners by current bytes, largest first
+    std::vector<OwnerUsage> GetOwners() const;
+
+    // Totals, every category and the largest owners, one per line
+    void WriteReport( std::ostream& stream, size_t ownerCount = 8 ) const;
+
+    // Forgets every allocation and peak; handles still alive release nothing
+    void Reset();
+
+private:
+    struct Allocation
+    {
+        CATEGORY    category;
+        const void* owner;
+        uint64_t    bytes;
+        uint64_t    requestedBytes;
+    };
+
+    struct Owner
+    {
+        std::string name;
+        Usage       usage;
+    };
+
+    void Release( uint64_t id );
+
+    // Called with the lock held; returns true when the usage just went over the budget
+    static bool Add( Usage& usage, uint64_t bytes, uint64_t requestedBytes, uint64_t budget );
+    static void Remove( Usage& usage, uint64_t bytes, uint64_t requestedBytes );
+
+private:
+    mutable std::mutex m_mutex;
+
+    MemoryBackend* m_pBackend;
+    BudgetWarning  m_warning;
+
+    uint64_t m_budgets[CATEGORY_NUM];
+    uint64_t m_totalBudget;
+
+    uint64_t                                   m_nextId;
+    std::unordered_map<uint64_t, Allocation>   m_allocations;
+    std::map<const void*, Owner>               m_owners;
+
+    Statistics m_statistics;
+};
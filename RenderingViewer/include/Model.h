@@ -19,7 +19,7 @@ public:
     struct BoundingBox
     {
         BoundingBox()
-            : hi( Vec3f( FLT_MIN ) )
+            : hi( Vec3f( -FLT_MAX ) )
             , lo( Vec3f( FLT_MAX ) )
         {
         }
@@ -34,27 +34,54 @@ public:
     
     void Release();
 
-    bool BindAsset( ID3D12Device* pDevice, const string& sourcePath );
-    virtual bool BindDescriptorHeap( ID3D12Device* pDevice, shared_ptr<DescriptorHeap> pDescHeap);
+    // pGeometryHeap nullptr loads the CPU copies only (headless rendering)
+    bool BindAsset( shared_ptr<GeometryHeap> pGeometryHeap, const string& sourcePath );
+
+    // A mesh already loaded from sourcePath, e.g. by a job; binding allocates from the heap, so it stays on
+    // the thread that owns it
+    void BindAsset( shared_ptr<GeometryHeap> pGeometryHeap, const string& sourcePath, const ObjMesh& mesh );
+
+    // Geometry built in memory, e.g. by SceneGenerator; name stands in for the source path
+    bool BindMesh( shared_ptr<GeometryHeap> pGeometryHeap, const string& name, vector<Vertex> vertices, vector<unsigned short> indices );
+
+    virtual void UpdateGPUBuffer( UploadRingAllocator& ring );
+
+    virtual D3D12_GPU_VIRTUAL_ADDRESS GetConstantBufferAddress() const { return m_materialConstants.GetGPUAddress(); }
     
     int GetIndexCount() const { return m_indexCount; }
 
-    shared_ptr<VertexBuffer> GetVertexBuffer() const { return m_pVertexBuffer; }
-    shared_ptr<IndexBuffer>  GetIndexBuffer() const { return m_pIndexBuffer; }
+    // Made from where the geometry heap holds the buffers now, which defragmentation may change
+    D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView() const;
+    D3D12_INDEX_BUFFER_VIEW  GetIndexBufferView() const;
+
+    const BoundingBox& GetBoundingBox() const { return m_boundingBox; }
+
+    // CPU copies of the buffer contents, for the software rasterizer
+    const vector<Vertex>& GetVertices() const { return m_vertices; }
+    const vector<unsigned short>& GetIndices() const { return m_indices; }
+    const ResMaterialData& GetMaterialData() const { return m_materialData; }
 
 protected:
-    void CreateVertexBuffer( ID3D12Device* pDevice, const acObjLoader& loader);
-    void CreateIndexBuffer( ID3D12Device* pDevice, const acObjLoader& loader );
-    void CreateBoundingBox( const acObjLoader& loader );
-    void CreateMaterial( ID3D12Device* pDevice );
+    void CreateVertexBuffer( const ObjMesh& mesh );
+    void CreateIndexBuffer( const ObjMesh& mesh );
+
+    // GPU buffers from the CPU copies
+    void CreateVertexBuffer();
+    void CreateIndexBuffer();
+    void CreateBoundingBox( const ObjMesh& mesh );
+    void CreateMaterial();
 
 private:
-    shared_ptr<VertexBuffer>    m_pVertexBuffer;
-    shared_ptr<IndexBuffer>     m_pIndexBuffer;
+    shared_ptr<GeometryHeap>    m_pGeometryHeap;
+    BufferSuballocator::Handle  m_vertexAllocation;
+    BufferSuballocator::Handle  m_indexAllocation;
     int                         m_indexCount;
 
-    shared_ptr<ConstantBuffer>    m_pMaterialCB;
+    vector<Vertex>              m_vertices;
+    vector<unsigned short>      m_indices;
+
     ResMaterialData               m_materialData;
+    ConstantUpload                m_materialConstants;
 
     string m_sourcePath;
     BoundingBox     m_boundingBox;
@@ -1,6 +1,7 @@
 #pragma once
 
-class Node
+// Bound by render contexts through DrawBindings, which reads the addresses below
+class Node : public DrawBindings::Source
 {
 public:
     enum NODE_TYPE
@@ -9,6 +10,7 @@ public:
         NODE_TYPE_CAMERA,
         NODE_TYPE_LIGHT,
         NODE_TYPE_MODEL,
+        NODE_TYPE_LIGHT_CLUSTER,
         NODE_TYPE_NUM,
     };
 
@@ -21,13 +23,17 @@ public:
     bool IsNodeType( NODE_TYPE type ) const { return type == m_nodeType; }
 
     const Vec3f& GetPosition() const { return m_position; }
-    void SetPosition(const Vec3f& position) { m_position = position; }
+    void SetPosition(const Vec3f& position) { m_position = position; MarkChanged(); }
 
     const Vec3f& GetScale() const { return m_scale; }
-    void SetScale( const Vec3f& scale ) { m_scale = scale; }
+    void SetScale( const Vec3f& scale ) { m_scale = scale; MarkChanged(); }
 
     const Vec3f& GetRotate() const { return m_rotate; }
-    void SetRotate( const Vec3f& rotate ) { m_rotate = rotate; }
+    void SetRotate( const Vec3f& rotate ) { m_rotate = rotate; MarkChanged(); }
+
+    // Increases whenever the transform or content changes, so passes can keep results that depend on the node
+    UINT64 GetVersion() const { return m_version; }
+    void MarkChanged() { m_version++; }
 
     shared_ptr<Node> GetParent() const { return m_pParent; }
 
@@ -39,9 +45,14 @@ public:
     void RemoveChild( shared_ptr<Node> pNode );
     void RemoveChild( int index );
 
-    virtual bool BindDescriptorHeap( ID3D12Device* pDevice, shared_ptr<DescriptorHeap> pDescHeap );
+    // Uploads constant data that changed since the last call
+    virtual void UpdateGPUBuffer( UploadRingAllocator& ring );
+
+    virtual D3D12_GPU_VIRTUAL_ADDRESS GetConstantBufferAddress() const { return 0; }
 
-    virtual void UpdateGPUBuffer();
+    // Buffers bound as root SRVs, after the node's constants
+    virtual UINT GetShaderResourceCount() const { return 0; }
+    virtual D3D12_GPU_VIRTUAL_ADDRESS GetShaderResourceAddress( UINT index ) const { AC_USE_VAR( index ); return 0; }
 
 protected:
     virtual bool CreateCB();
@@ -53,6 +64,8 @@ protected:
     Vec3f m_scale;
     Vec3f m_rotate;
 
+    UINT64 m_version;
+
     shared_ptr<Node>          m_pParent;
     vector<shared_ptr<Node> > m_pChildren;
 };
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Triangle mesh of a Wavefront OBJ file, as Model binds it. Independent of D3D.
+//
+// Attributes are kept per position: the normal and texture coordinate of a face corner go to the vertex of
+// its position, and polygons are split into fans. The buffers take 16-bit indices, so a mesh of more than
+// 65536 positions has to be split before it is bound.
+class ObjMesh
+{
+public:
+    // Same layout as Vertex
+    struct Vertex
+    {
+        float position[3];
+        float normal[3];
+        float texCoord[2];
+        float color[4];
+    };
+
+public:
+    void Clear();
+
+    // Reads the whole file, then parses it; false if it cannot be read
+    bool Load( const std::string& path );
+
+    // Lines other than v, vn, vt and f are skipped
+    void Parse( const std::string& text );
+
+    size_t GetVertexCount() const { return m_positions.size() / 3; }
+    size_t GetIndexCount() const { return m_indices.size(); }
+
+    // xyz per vertex
+    const std::vector<float>& GetPositions() const { return m_positions; }
+    const std::vector<float>& GetNormals() const { return m_normals; }
+
+    // The CPU copies the vertex and index buffers are uploaded from, GetVertexCount and GetIndexCount long
+    void CreateVertices( Vertex* pVertices ) const;
+    void CreateIndices( uint16_t* pIndices ) const;
+
+    // Of the positions; lo is above hi for an empty mesh
+    void GetBounds( float lo[3], float hi[3] ) const;
+
+private:
+    void ParseFace( const char* p );
+
+private:
+    std::vector<float>    m_positions;
+    std::vector<float>    m_normals;      // per position
+    std::vector<float>    m_texCoords;    // per position
+    std::vector<uint32_t> m_indices;
+
+    // As listed in the file, before they are moved to the positions of the faces using them
+    std::vector<float>    m_fileNormals;
+    std::vector<float>    m_fileTexCoords;
+    std::vector<uint32_t> m_face;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+// Mouse control of the viewer's camera: rotating orbits the position around the target, translating moves both,
+// the wheel moves the position towards the target. Independent of D3D.
+//
+// The pose is 9 floats laid out as Mat33f, its rows are the camera axes in world space. The view matrix is the
+// inverse of the pose placed at the position, 16 floats laid out as Mat44f.
+class OrbitCamera
+{
+public:
+    struct State
+    {
+        float pose[9];
+        float position[3];
+        float lookAt[3];
+    };
+
+public:
+    // Mouse moves in pixels and wheel steps as DirectInput reports them; false when the state did not change
+    static bool Rotate( State& state, float dx, float dy );
+    static bool Translate( State& state, float dx, float dy );
+    static bool Zoom( State& state, float dz );
+
+    // False if the pose is singular
+    static bool GetViewMatrix( const State& state, float view[16] );
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+using namespace acLib;
+using namespace acLib::DX12;
+using namespace std;
+
+class PipelineCache
+{
+public:
+    struct Statistics
+    {
+        Statistics()
+            : rootSignatureHits( 0 )
+            , rootSignatureMisses( 0 )
+            , pipelineStateHits( 0 )
+            , pipelineStateMisses( 0 )
+            , collisions( 0 )
+            , shaderHits( 0 )
+            , shaderLoads( 0 )
+        {
+        }
+
+        int rootSignatureHits;
+        int rootSignatureMisses;
+        int pipelineStateHits;
+        int pipelineStateMisses;
+        int collisions;             // hashes matching an entry of another key, created without caching
+        int shaderHits;
+        int shaderLoads;
+    };
+
+public:
+    PipelineCache();
+    ~PipelineCache();
+
+    void Release();
+
+public:
+    shared_ptr<RootSignature> GetRootSignature( ID3D12Device* pDevice, const D3D12_ROOT_SIGNATURE_DESC& desc );
+
+    // Creates a missing pipeline on the calling thread. The root signature must come from GetRootSignature.
+    shared_ptr<PipelineState> GetPipelineState( ID3D12Device* pDevice,
+                                                const PipelineState::InputElement& element,
+                                                const PipelineState::ShaderCode& shader,
+                                                shared_ptr<RootSignature> pRootSignature );
+
+    // Null until the pipeline was created in the background and published by an Update; the first call
+    // starts the creation. Bytecode must stay valid until then, as the blobs of GetShader do.
+    shared_ptr<PipelineState> RequestPipelineState( ID3D12Device* pDevice,
+                                                    const PipelineState::InputElement& element,
+                                                    const PipelineState::ShaderCode& shader,
+                                                    shared_ptr<RootSignature> pRootSignature );
+
+    // Frame boundary: makes the pipelines created since the last call available to RequestPipelineState
+    // and returns their count
+    UINT Update();
+
+    // Requested pipelines not yet available
+    UINT GetPendingCount() const { return m_compiler.GetPendingCount(); }
+
+    const PipelineCompiler::Statistics& GetCompilerStatistics() const { return m_compiler.GetStatistics(); }
+
+    bool GetShader( const wstring& file, PipelineState::ShaderCode& shader );
+
+    // Compiles or maps every VSMain/PSMain pair up front so misses are compiled in parallel
+    bool PreloadShaders( const vector<wstring>& files );
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+    shared_ptr<ShaderCache> GetShaderCache() const { return m_pShaderCache; }
+
+public:
+    // Canonical keys: the bytes of everything the object is created from, with no pointers, so equal keys
+    // make equal objects. Entries are found by the hash of the key and confirmed by comparing it.
+    static void CreateRootSignatureKey( const D3D12_ROOT_SIGNATURE_DESC& desc, vector<UINT8>& key );
+    // The root signature by the hash of its key, as its address may be reused by another one once released
+    static void CreatePipelineStateKey( const PipelineState::InputElement& element,
+                                        const PipelineState::ShaderCode& shader,
+                                        UINT64 rootSignatureHash,
+                                        vector<UINT8>& key );
+
+    static UINT64 HashKey( const vector<UINT8>& key );
+    static UINT64 HashShaderCode( const PipelineState::ShaderCode& shader );
+
+private:
+    struct RootSignatureEntry
+    {
+        vector<UINT8>             key;
+        shared_ptr<RootSignature> pRootSignature;
+    };
+
+    struct PipelineStateEntry
+    {
+        vector<UINT8>             key;
+        shared_ptr<PipelineState> pPipelineState;
+    };
+
+    struct ShaderEntry
+    {
+        shared_ptr<ShaderCache::Blob> pVSBlob;
+        shared_ptr<ShaderCache::Blob> pPSBlob;
+    };
+
+    // Hash of the pipeline key of the root signature, or false if it did not come from this cache
+    bool GetRootSignatureHash( const shared_ptr<RootSignature>& pRootSignature, UINT64& hash ) const;
+
+    // Pipeline key and hash of a request into m_key; false if the root signature did not come from this cache
+    bool CreateRequestKey( const PipelineState::InputElement& element,
+                           const PipelineState::ShaderCode& shader,
+                           const shared_ptr<RootSignature>& pRootSignature,
+                           UINT64& hash );
+
+private:
+    unordered_map<UINT64, RootSignatureEntry>    m_rootSignatures;
+    unordered_map<const RootSignature*, UINT64>  m_rootSignatureHashes;  // of the entries above, by object
+    unordered_map<UINT64, PipelineStateEntry>    m_pipelineStates;
+    unordered_map<UINT64, PipelineStateEntry>    m_compilingStates;      // requested, not yet published
+    vector<UINT64>                               m_publishedKeys;        // of the last Update, kept for its capacity
+    vector<UINT8>                                m_key;                  // of the last lookup, kept for its capacity
+    map<wstring, ShaderEntry>                    m_shaders;
+
+    shared_ptr<ShaderCache> m_pShaderCache;
+    PipelineCompiler        m_compiler;
+
+    Statistics m_statistics;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Creates pipelines on background threads and publishes them at frame boundaries. Independent of D3D: a
+// pipeline is a key and a compile callback, so the scheduling can run with a stub on any platform.
+//
+// Compiles run on threads of their own rather than as jobs of the JobSystem: a driver compile takes
+// milliseconds, and a thread waiting for its own jobs would pick one up and stall its frame. A finished
+// compile stays invisible until the next Update, so every pipeline keeps one state from the start of a
+// frame to its end; draws whose pipeline is still compiling use a fallback or are skipped meanwhile.
+class PipelineCompiler
+{
+public:
+    enum STATE
+    {
+        STATE_UNKNOWN,      // never requested
+        STATE_COMPILING,    // requested and not yet published
+        STATE_READY,
+        STATE_FAILED,
+    };
+
+    // Runs on a compile thread; false when the pipeline could not be created
+    typedef std::function<bool()> CompileFunc;
+
+    struct Statistics
+    {
+        Statistics()
+            : requests( 0 )
+            , published( 0 )
+            , failures( 0 )
+            , compileMilliseconds( 0.0 )
+            , maxCompileMilliseconds( 0.0 )
+            , maxLatencyFrames( 0 )
+        {
+        }
+
+        uint64_t requests;                  // compiles started
+        uint64_t published;                 // compiles made visible by Update, failed ones included
+        uint64_t failures;
+        double   compileMilliseconds;       // time of the published compiles, which no caller waited for
+        double   maxCompileMilliseconds;
+        uint64_t maxLatencyFrames;          // Updates between a request and its publication
+    };
+
+    static const uint32_t DEFAULT_THREADS = 2;
+
+public:
+    // Threads start with the first request. 0 threads compiles inside Request, blocking the caller as creating
+    // pipelines directly does.
+    explicit PipelineCompiler( uint32_t threadCount = DEFAULT_THREADS );
+
+    // Drops the queued compiles and waits for the running ones
+    ~PipelineCompiler();
+
+    PipelineCompiler( const PipelineCompiler& ) = delete;
+    PipelineCompiler& operator=( const PipelineCompiler& ) = delete;
+
+public:
+    // Queues compile unless key was requested before. Returns the state of key as of the last Update,
+    // STATE_COMPILING when it was queued now.
+    STATE Request( uint64_t key, const CompileFunc& compile );
+
+    STATE GetState( uint64_t key ) const;
+
+    // Frame boundary: publishes the compiles finished since the last call and returns their count, appending
+    // their keys to pKeys when given
+    uint32_t Update( std::vector<uint64_t>* pKeys = nullptr );
+
+    // Requested and not yet published
+    uint32_t GetPendingCount() const { return m_pendingCount; }
+
+    // Blocks until every queued compile has finished; they are published by the next Update
+    void Wait();
+
+    // Waits, then forgets every key, so each is compiled again when requested
+    void Clear();
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+private:
+    struct Compile
+    {
+        uint64_t    key;
+        CompileFunc compile;
+        uint64_t    frame;          // Updates before the request
+        bool        bSucceeded;
+        double      milliseconds;
+    };
+
+    void Loop();
+
+private:
+    std::unordered_map<uint64_t, STATE> m_states;   // as of the last Update
+    uint32_t                            m_pendingCount;
+    uint64_t                            m_frame;
+
+    // Compiles waiting for a thread, and finished ones waiting for Update
+    std::mutex                              m_mutex;
+    std::condition_variable                 m_wake;
+    std::condition_variable                 m_idle;
+    std::deque<std::unique_ptr<Compile> >   m_queue;
+    std::vector<std::unique_ptr<Compile> >  m_finished;
+    std::vector<std::unique_ptr<Compile> >  m_publishing;   // swapped with m_finished by Update, kept for its capacity
+    uint32_t                                m_running;
+    bool                                    m_bStop;
+
+    uint32_t                 m_threadCount;
+    std::vector<std::thread> m_threads;
+
+    Statistics m_statistics;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Define PROFILER_DISABLED to compile the scopes out entirely
+#if !defined(PROFILER_DISABLED)
+#define PROFILER_CONCAT_INNER( a, b ) a##b
+#define PROFILER_CONCAT( a, b ) PROFILER_CONCAT_INNER( a, b )
+
+// Times the rest of the enclosing block; name must be a string literal or otherwise outlive the profiler
+#define PROFILE_SCOPE( name ) Profiler::Scope PROFILER_CONCAT( profilerScope, __LINE__ )( name )
+#else
+#define PROFILE_SCOPE( name ) ((void)0)
+#endif
+
+// CPU profiler of nested, named zones. Independent of D3D.
+//
+// Each thread writes the zones it closes into its own fixed-size ring, so recording takes no lock;
+// only the first zone of a thread registers its ring. While the profiler is disabled a scope costs one
+// relaxed atomic load. EndFrame folds the zones closed since the previous frame into a rolling summary,
+// and WriteChromeTrace exports what the rings still hold for chrome://tracing or Perfetto. Both read
+// the rings of other threads and are meant to be called between frames, while workers are idle.
+class Profiler
+{
+public:
+    static const uint32_t EVENTS_PER_THREAD = 1 << 16;
+    static const uint32_t SUMMARY_FRAMES    = 120;
+
+    struct ZoneStatistics
+    {
+        const char* name;
+        uint32_t    depth;                  // nesting depth of the first call seen
+        uint32_t    calls;                  // in the last frame
+        double      lastMilliseconds;       // summed over the calls of the last frame
+        double      averageMilliseconds;    // per frame over the last SUMMARY_FRAMES frames
+        double      maxMilliseconds;
+    };
+
+    struct Summary
+    {
+        Summary() { Clear(); }
+
+        void Clear()
+        {
+            frames              = 0;
+            lastMilliseconds    = 0.0;
+            averageMilliseconds = 0.0;
+            maxMilliseconds     = 0.0;
+            droppedEvents       = 0;
+            zones.clear();
+        }
+
+        uint64_t                    frames;
+        double                      lastMilliseconds;       // BeginFrame to EndFrame
+        double                      averageMilliseconds;
+        double                      maxMilliseconds;
+        uint64_t                    droppedEvents;          // overwritten before a frame summary read them
+        std::vector<ZoneStatistics> zones;                  // in order of first appearance
+    };
+
+    class Scope
+    {
+    public:
+        explicit Scope( const char* name )
+            : m_name( nullptr )
+        {
+            if (IsEnabled())
+                Begin( name );
+        }
+
+        ~Scope()
+        {
+            if (m_name != nullptr)
+                End();
+        }
+
+    private:
+        Scope( const Scope& );
+        Scope& operator=( const Scope& );
+
+        void Begin( const char* name );
+        void End();
+
+    private:
+        const char* m_name;
+        int64_t     m_begin;
+    };
+
+public:
+    static void SetEnabled( bool bEnabled ) { s_bEnabled.store( bEnabled, std::memory_order_relaxed ); }
+    static bool IsEnabled() { return s_bEnabled.load( std::memory_order_relaxed ); }
+
+    // Name shown for the calling thread in the trace
+    static void SetThreadName( const char* name );
+
+    static void BeginFrame();
+    static void EndFrame();
+
+    // A zone timed elsewhere, e.g. on the GPU, counted with the frame that ends next. Main thread only;
+    // such zones are in the summary but not in the trace.
+    static void AddZone( const char* name, uint32_t depth, double milliseconds );
+
+    static const Summary& GetSummary();
+
+    // Returns false when the file could not be written
+    static bool WriteChromeTrace( const std::string& path );
+
+    // Drops all recorded zones and the summary
+    static void Reset();
+
+private:
+    static std::atomic<bool> s_bEnabled;
+};
@@ -7,6 +7,9 @@ using namespace std;
 class RenderContext
 {
 public:
+    static const UINT MAX_CONSTANT_BUFFERS = DrawRecorder::MAX_CONSTANT_BUFFERS;
+    static const UINT MAX_SHADER_RESOURCES = DrawRecorder::MAX_SHADER_RESOURCES;
+
     struct ConstructParams
     {
         ConstructParams()
@@ -34,37 +37,56 @@ public:
         bool bDSOnly;
     };
 
+    // Draw item gathered from a context, sorted and recorded by the pass's draw recorder
+    typedef DrawRecorder::Packet DrawPacket;
+
 public:
     RenderContext( ID3D12Device* pDevice );
     ~RenderContext();
     
 public:
-    bool Clear( const ConstructParams& params );
-    bool Draw( const ConstructParams& params );
+    // Records into a list that already transitioned the targets and set them
+    bool Clear( shared_ptr<CommandList> pCommandList, const ConstructParams& params );
+
+    bool GetDrawPacket( DrawPacket& packet ) const;
+
+    // Descriptor table this context's draws reference, owned by the render pass
+    void SetDescriptorTable( shared_ptr<GlobalDescriptorHeap> pDescHeap, UINT index, UINT count );
+    UINT GetDescriptorIndex() const { return m_descriptorIndex; }
 
-    void Reset();
+    // Writes a view into the next unbound slot of the table
+    bool BindDescriptor( ID3D12Device* pDevice, shared_ptr<Buffer> pBuffer, Buffer::BUFFER_VIEW_TYPE type );
 
-    shared_ptr<DescriptorHeap> GetDescHeap() const { return m_pDescHeap; }
-    void SetDescHeap( shared_ptr<DescriptorHeap> pDescHeap ) { m_pDescHeap = pDescHeap; }
+    // Node whose constants are bound as the next root CBV
+    bool AddConstantBuffer( shared_ptr<Node> pNode );
 
-    shared_ptr<RootSignature> GetRootSignature() const { return m_pRootSignature; }
-    void SetRootSinature( shared_ptr<RootSignature> pRootSignature ) { m_pRootSignature = pRootSignature; }
+    // Node whose buffers are bound as the next root SRVs
+    bool AddShaderResources( shared_ptr<Node> pNode );
 
-    shared_ptr<PipelineState> GetPipelineState() const { return m_pPipelineState; }
-    void SetPipelineState( shared_ptr<PipelineState> pPipelineState ){ m_pPipelineState = pPipelineState; }
+    // The forward pass's root arguments for the model pMaterial; other nodes may be null
+    bool BindForward( shared_ptr<Node> pCamera, shared_ptr<Node> pLight, shared_ptr<Node> pMaterial, shared_ptr<Node> pLightClusters );
 
-    shared_ptr<CommandList> GetCommandList() const { return m_pCommandList; }
+    const shared_ptr<RootSignature>& GetRootSignature() const { return m_pRootSignature; }
+    void SetRootSinature( shared_ptr<RootSignature> pRootSignature ) { m_pRootSignature = pRootSignature; m_bindings.SetRootSignature( pRootSignature.get() ); }
 
-    shared_ptr<Node> GetNode() const { return m_pNode; }
+    const shared_ptr<PipelineState>& GetPipelineState() const { return m_pPipelineState; }
+    void SetPipelineState( shared_ptr<PipelineState> pPipelineState ){ m_pPipelineState = pPipelineState; m_bindings.SetPipelineState( pPipelineState.get() ); }
+
+    const shared_ptr<Node>& GetNode() const { return m_pNode; }
     void SetNode( shared_ptr<Node> pNode );
 
 protected:
-    shared_ptr<DescriptorHeap>         m_pDescHeap;
+    shared_ptr<GlobalDescriptorHeap>   m_pDescHeap;
+    UINT                               m_descriptorIndex;
+    UINT                               m_descriptorCount;
+    UINT                               m_boundDescriptorCount;
+
+    // Kept alive for the bindings, which only point at them
+    vector<shared_ptr<Node> >          m_pBoundNodes;
+    DrawBindings                       m_bindings;
 
     shared_ptr<RootSignature>          m_pRootSignature;
     shared_ptr<PipelineState>          m_pPipelineState;
 
-    shared_ptr<CommandList>            m_pCommandList;
-
     shared_ptr<Node> m_pNode;
 };
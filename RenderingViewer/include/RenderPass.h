@@ -6,19 +6,48 @@ using namespace std;
 
 class RenderPass
 {
+public:
+    // Most significant draw key field, in submission order
+    enum SORT_PASS
+    {
+        SORT_PASS_SHADOW,
+        SORT_PASS_OPAQUE,
+    };
+
+    typedef DrawRecorder::Statistics Statistics;
+
 public:
     RenderPass( ID3D12Device* pDevice );
     ~RenderPass();
     
 public:
-    virtual shared_ptr<DescriptorHeap> CreateDescHeap( ID3D12Device* pDevice ) = 0;
     virtual shared_ptr<RootSignature>  CreateRootSinature( ID3D12Device* pDevice ) = 0;
+    // Null while the pipeline is still being created in the background
     virtual shared_ptr<PipelineState> CreatePipelineState( ID3D12Device* pDevice, shared_ptr<RootSignature> pRootSignature, shared_ptr<Node> pNode = nullptr ) = 0;
 
     void SetScene( shared_ptr<Scene> pScene );
 
+    // The cache shared by every pass, set before Construct; passes creating pipelines construct nothing without it
+    shared_ptr<PipelineCache> GetPipelineCache() const { return m_pPipelineCache; }
+    void SetPipelineCache( shared_ptr<PipelineCache> pPipelineCache ) { m_pPipelineCache = pPipelineCache; }
+
+    shared_ptr<GlobalDescriptorHeap> GetDescriptorHeap() const { return m_pDescHeap; }
+    void SetDescriptorHeap( shared_ptr<GlobalDescriptorHeap> pDescHeap ) { m_pDescHeap = pDescHeap; }
+
+    // Gives contexts the pipelines the cache published since they were constructed; returns how many changed
+    UINT UpdatePipelineStates( ID3D12Device* pDevice );
+
     virtual void BindResource( ID3D12Device* pDevice, shared_ptr<Buffer> pResource, Buffer::BUFFER_VIEW_TYPE type );
 
+    // Times the recorded commands on the GPU as the zone name, a string literal
+    void SetGpuTimer( shared_ptr<GpuTimer> pGpuTimer, const char* name );
+
+    // Draw lists and sort keys are allocated from the arena and live until its next BeginFrame but one
+    void SetFrameArena( shared_ptr<FrameArena> pFrameArena ) { m_pFrameArena = pFrameArena; }
+
+    // Draws are ordered by distance along direction from origin, quantized over [0, depthRange]
+    void SetSortView( const Vec3f& origin, const Vec3f& direction, float depthRange );
+
     virtual void Construct( ID3D12Device* pDevice );
     virtual void Draw( const RenderContext::ConstructParams& params );
 
@@ -26,9 +55,74 @@ public:
 
     void Reset();
 
+    shared_ptr<CommandList> GetCommandList() const { return m_pCommandList; }
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+protected:
+    UINT AllocateDescriptorTable( UINT count );
+    void ReleaseDescriptorTables();
+
+    void GatherDrawPackets();
+    void SortDrawPackets();
+    void RecordDrawPackets( const RenderContext::ConstructParams& params );
+
+    // RecordDrawPackets in parts, for passes that record several sorted batches into one command list
+    void BeginRecording( const RenderContext::ConstructParams& params );
+    void RecordDrawItems();
+    void EndRecording();
+
+    // Storage of this frame for count T; null when count is 0 or no arena was set
+    template <typename T>
+    T* AllocateFrameData( size_t count );
+
+    // The context's pipeline from CreatePipelineState, else the fallback until UpdatePipelineStates finds it
+    void AssignPipelineState( ID3D12Device* pDevice, shared_ptr<RenderContext> pContext, shared_ptr<Node> pNode );
+
+protected:
+    // Records the draw recorder's binds and draws into a command list
+    class CommandListSink : public DrawRecorder::CommandSink
+    {
+    public:
+        CommandListSink( CommandList* pCommandList, GlobalDescriptorHeap* pDescHeap );
+
+        virtual void SetRootSignature( const RenderContext::DrawPacket& packet );
+        virtual void SetConstantBuffer( uint32_t parameter, uint64_t address );
+        virtual void SetShaderResource( uint32_t parameter, uint64_t address );
+        virtual void SetDescriptorHeap();
+        virtual void SetDescriptorTable( uint32_t parameter, uint32_t descriptorIndex );
+        virtual void SetPipelineState( const RenderContext::DrawPacket& packet );
+        virtual void Draw( const RenderContext::DrawPacket& packet );
+
+    private:
+        CommandList*               m_pCommandList;
+        ID3D12GraphicsCommandList* m_pGraphicsList;
+        GlobalDescriptorHeap*      m_pDescHeap;
+    };
+
 protected:
     shared_ptr<Scene>                   m_pScene;
+    shared_ptr<PipelineCache>           m_pPipelineCache;
+    shared_ptr<GlobalDescriptorHeap>    m_pDescHeap;
+    vector<pair<UINT, UINT> >           m_descriptorTables;
     vector<shared_ptr<RenderContext> >     m_pRenderContexts;
 
+    // Drawn by contexts whose pipeline is still being created; null skips their draws
+    shared_ptr<PipelineState>                                   m_pFallbackPipelineState;
+    vector<pair<shared_ptr<RenderContext>, shared_ptr<Node> > > m_pendingContexts;
+
+    shared_ptr<CommandList>                  m_pCommandList;
+    shared_ptr<FrameArena>                   m_pFrameArena;
+    RenderContext::DrawPacket*               m_pDrawPackets;
+    UINT                                     m_drawPacketCount;
+
+    DrawRecorder                             m_drawRecorder;
+
+    Statistics m_statistics;
+
+    shared_ptr<GpuTimer> m_pGpuTimer;
+    const char*          m_gpuTimerName;
+    UINT                 m_gpuZone;
+
     PipelineState::InputElement m_element;
 };
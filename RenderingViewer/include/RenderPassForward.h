@@ -12,7 +12,6 @@ public:
 
     virtual void Construct( ID3D12Device* pDevice );
 
-    virtual shared_ptr<DescriptorHeap> CreateDescHeap( ID3D12Device* pDevice );
     virtual shared_ptr<RootSignature> CreateRootSinature( ID3D12Device* pDevice );
     virtual shared_ptr<PipelineState> CreatePipelineState( ID3D12Device* pDevice, shared_ptr<RootSignature> pRootSignature, shared_ptr<Node> pNode = nullptr );
 };
@@ -4,15 +4,91 @@ using namespace acLib;
 using namespace acLib::DX12;
 using namespace std;
 
+// Renders every cascade of the light into its tile of the shadow map atlas, in one command list.
+// Tiles are cached: a cascade is only cleared and re-rendered when its box or one of its casters changed.
 class RenderPassShadow : public RenderPass
 {
+public:
+    struct CascadeStatistics
+    {
+        CascadeStatistics() { Clear(); }
+
+        void Clear()
+        {
+            cascadeCount = 0;
+            for (int i = 0; i < Light::ResLightData::CASCADE_NUM; ++i)
+            {
+                casters[i]  = 0;
+                culled[i]   = 0;
+                rendered[i] = false;
+            }
+            recordMilliseconds = 0.0;
+        }
+
+        int    cascadeCount;
+        int    casters[Light::ResLightData::CASCADE_NUM];   // models inside each cascade's box
+        int    culled[Light::ResLightData::CASCADE_NUM];    // models outside each cascade's box
+        bool   rendered[Light::ResLightData::CASCADE_NUM];  // false when the cached tile was kept
+        double recordMilliseconds;                          // CPU time to cull, sort and record every cascade
+    };
+
+    // Totals since construction
+    struct CacheStatistics
+    {
+        CacheStatistics()
+            : frames( 0 )
+            , passes( 0 )
+            , cascadeRenders( 0 )
+        {
+        }
+
+        UINT64 frames;          // Draw calls
+        UINT64 passes;          // Draw calls that recorded commands
+        UINT64 cascadeRenders;  // tiles cleared and re-rendered
+    };
+
 public:
     RenderPassShadow( ID3D12Device* pDevice );
     ~RenderPassShadow();
 
     virtual void Construct( ID3D12Device* pDevice );
 
-    virtual shared_ptr<DescriptorHeap> CreateDescHeap( ID3D12Device* pDevice );
+    // params.viewport covers the whole atlas
+    virtual void Draw( const RenderContext::ConstructParams& params );
+
+    const CascadeStatistics& GetCascadeStatistics() const { return m_cascadeStatistics; }
+    const CacheStatistics& GetCacheStatistics() const { return m_cacheStatistics; }
+
+    // False when Draw kept every cached tile; the command list is then closed empty and must not be executed
+    bool IsRecorded() const { return m_bRecorded; }
+
+    // Re-renders every cascade on the next Draw, e.g. after the shadow map was recreated
+    void Invalidate();
+
     virtual shared_ptr<RootSignature> CreateRootSinature( ID3D12Device* pDevice );
     virtual shared_ptr<PipelineState> CreatePipelineState( ID3D12Device* pDevice, shared_ptr<RootSignature> pRootSignature, shared_ptr<Node> pNode = nullptr );
+
+private:
+    // What a tile was rendered from
+    struct CascadeCache
+    {
+        CascadeCache()
+            : bValid( false )
+        {
+        }
+
+        bool                                bValid;
+        Mat44f                              viewProjection;
+        Vec4f                               rect;
+        vector<pair<const Node*, UINT64> >  casters;    // node and version
+    };
+
+    shared_ptr<Light>                   m_pLight;
+    vector<pair<const Node*, UINT64> >  m_casters;  // of the cascade being culled, kept for its capacity
+
+    CascadeCache                        m_cascadeCache[Light::ResLightData::CASCADE_NUM];
+    bool                                m_bRecorded;
+
+    CascadeStatistics                   m_cascadeStatistics;
+    CacheStatistics                     m_cacheStatistics;
 };
@@ -9,6 +9,14 @@ public:
 public:
     shared_ptr<Node> GetRootNode() const { return m_pRootNode; }
 
+    // Union of the models' bounding boxes
+    ShadowFrustum::Bounds GetBounds() const;
+
+    // One model per node that has a mesh, its vertices moved to world space, since models are drawn without a
+    // world matrix; the hierarchy is flattened under the root. Lights go into one ClusteredLights node.
+    // pGeometryHeap nullptr keeps the meshes on the CPU only.
+    bool AddGenerated( ID3D12Device* pDevice, shared_ptr<GeometryHeap> pGeometryHeap, const GeneratedScene& scene );
+
 private:
     shared_ptr<Node> m_pRootNode;
 };
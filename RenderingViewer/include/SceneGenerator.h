@@ -0,0 +1,131 @@
+#pragma once
+
+#include "LightClusters.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A scene as SceneGenerator makes it: shared meshes, a node hierarchy that places them, and lights
+struct GeneratedScene
+{
+    static const uint32_t NO_PARENT = 0xffffffff;
+    static const uint32_t NO_MESH   = 0xffffffff;
+
+    // Unit-sized around the origin, 16-bit indices as Model draws them
+    struct Mesh
+    {
+        std::vector<float>    positions;    // xyz
+        std::vector<float>    normals;      // xyz
+        std::vector<uint16_t> indices;      // triangle list
+        float                 boundsMin[3];
+        float                 boundsMax[3];
+    };
+
+    // Matrices are 16 floats in the BatchMath layout; world is parent world * local
+    struct Node
+    {
+        uint32_t parent;
+        uint32_t mesh;
+        float    local[16];
+        float    world[16];
+    };
+
+    void Clear();
+
+    uint64_t GetVertexCount() const;
+    uint64_t GetTriangleCount() const;
+
+    // Triangles drawn by all nodes, instances counted once each
+    uint64_t GetDrawnTriangleCount() const;
+
+    // Levels of the hierarchy, 1 when every node is a root
+    uint32_t GetDepth() const;
+
+    // Recomputes every world matrix from the locals, a level of the hierarchy at a time, each level in parallel
+    void UpdateWorld();
+
+    // Over the meshes, nodes and lights; equal scenes hash equal
+    uint64_t GetHash() const;
+
+    std::vector<Mesh> meshes;
+    std::vector<Node> nodes;    // parents before their children
+    LightList         lights;
+};
+
+// Deterministic synthetic scenes for scale testing. Independent of D3D.
+//
+// The same config gives the same scene on every run: the random numbers come from a fixed engine converted
+// by hand, not from the library's distributions, so only the math library's rounding can differ between
+// platforms. Objects are spread over the extent, then stacked into a hierarchy of the configured depth,
+// children gathered around their parent. Instanced objects share the mesh of an earlier one.
+class SceneGenerator
+{
+public:
+    enum DISTRIBUTION
+    {
+        DISTRIBUTION_UNIFORM,       // anywhere on the ground
+        DISTRIBUTION_CLUSTERED,     // around a few centers, as towns
+        DISTRIBUTION_GRID,          // one per cell, as a city block
+
+        DISTRIBUTION_NUM,
+    };
+
+    struct Config
+    {
+        Config()
+            : seed( 1 )
+            , objectCount( 10000 )
+            , instanceRatio( 0.9f )
+            , minSegments( 8 )
+            , maxSegments( 24 )
+            , hierarchyDepth( 3 )
+            , distribution( DISTRIBUTION_UNIFORM )
+            , extent( 200.0f )
+            , lightCount( 256 )
+            , spotLightRatio( 0.25f )
+        {
+        }
+
+        uint32_t     seed;
+        uint32_t     objectCount;
+        float        instanceRatio;     // share of objects drawing an earlier object's mesh, in [0, 1]
+        uint32_t     minSegments;       // mesh complexity: rings of a sphere, cuts of a box side
+        uint32_t     maxSegments;
+        uint32_t     hierarchyDepth;    // levels of nodes, 1 makes every object a root
+        DISTRIBUTION distribution;
+        float        extent;            // objects and lights lie within [-extent / 2, extent / 2] on x and z
+        uint32_t     lightCount;
+        float        spotLightRatio;    // the rest are point lights
+    };
+
+    // Largest segment count whose meshes stay within 16-bit indices
+    static const uint32_t MAX_SEGMENTS = 100;
+
+public:
+    static const char* GetDistributionName( DISTRIBUTION distribution );
+
+    // False with no output when the config cannot be met, e.g. no objects
+    static bool Generate( const Config& config, GeneratedScene& scene );
+
+    // The manifest lists the nodes and lights and names one OBJ per mesh, written next to it as
+    // <manifest path without extension>_<mesh>.obj. Floats are written exactly, so Read gives an equal scene.
+    bool Write( const GeneratedScene& scene, const std::string& manifestPath );
+    bool Read( const std::string& manifestPath, GeneratedScene& scene );
+
+    static std::string GetMeshPath( const std::string& manifestPath, size_t mesh );
+
+    // Why the last Write or Read failed, for the log
+    const std::string& GetError() const { return m_error; }
+
+private:
+    static void CreateSphere( uint32_t segments, GeneratedScene::Mesh& mesh );
+    static void CreateBox( uint32_t segments, GeneratedScene::Mesh& mesh );
+
+    bool WriteMesh( const GeneratedScene::Mesh& mesh, const std::string& path );
+    // Sets error and returns false on failure; called from several threads at once
+    static bool ReadMesh( const std::string& path, GeneratedScene::Mesh& mesh, std::string& error );
+
+private:
+    std::string m_error;
+};
@@ -5,7 +5,10 @@ using namespace acLib::DX12;
 class Shader
 {
 public:
-    static bool CompileShader( const std::wstring& file, ComPtr<ID3DBlob>& pVSBlob, ComPtr<ID3DBlob>& pPSBlob );
+    // Compiler backend for ShaderCache
+    static bool Compile( const ShaderCache::CompileRequest& request, vector<unsigned char>& bytecode );
+
+    static unsigned int GetCompileFlags();
 
     static bool SearchFilePath( const std::wstring& filePath, std::wstring& result );
-};
\ No newline at end of file
+};
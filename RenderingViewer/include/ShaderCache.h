@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Compiled shader bytecode cache persisted on disk.
+// Independent of D3D: the compiler is injected so the cache can run with a stub on any platform.
+class ShaderCache
+{
+public:
+    struct CompileRequest
+    {
+        CompileRequest()
+            : flags( 0 )
+        {
+        }
+
+        CompileRequest( const std::string& p, const std::string& e, const std::string& pr, unsigned int f )
+            : path( p )
+            , entryPoint( e )
+            , profile( pr )
+            , flags( f )
+        {
+        }
+
+        std::string  path;
+        std::string  entryPoint;
+        std::string  profile;
+        unsigned int flags;
+    };
+
+    // Bytecode either mapped from the cache file or owned in memory after a compile
+    class Blob
+    {
+    public:
+        Blob();
+        ~Blob();
+
+        const void* GetData() const { return m_pData; }
+        size_t GetSize() const { return m_size; }
+
+        bool Map( const std::string& path, uint64_t key );
+        void Assign( std::vector<unsigned char>&& bytecode );
+
+    private:
+        Blob( const Blob& );
+        Blob& operator=( const Blob& );
+
+        void Unmap();
+
+    private:
+        const void* m_pData;
+        size_t      m_size;
+
+        std::vector<unsigned char> m_bytecode;
+
+        void*  m_pMapped;
+        size_t m_mappedSize;
+#if defined(_WIN32)
+        void*  m_hFile;
+        void*  m_hMapping;
+#endif
+    };
+
+    typedef std::function<bool( const CompileRequest& request, std::vector<unsigned char>& bytecode )> CompileFunc;
+
+    struct Statistics
+    {
+        Statistics()
+            : hits( 0 )
+            , misses( 0 )
+            , failures( 0 )
+            , coldMilliseconds( 0.0 )
+            , warmMilliseconds( 0.0 )
+        {
+        }
+
+        int hits;
+        int misses;
+        int failures;
+
+        // Wall time of the last fetch that had to compile (cold) and that was served from disk only (warm)
+        double coldMilliseconds;
+        double warmMilliseconds;
+    };
+
+public:
+    ShaderCache( const std::string& directory, CompileFunc compiler, int workerCount = 0 );
+    ~ShaderCache();
+
+public:
+    // Resolves every request, compiling misses in parallel. Failed entries are left null.
+    bool Fetch( const std::vector<CompileRequest>& requests, std::vector<std::shared_ptr<Blob> >& blobs );
+    std::shared_ptr<Blob> Fetch( const CompileRequest& request );
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+    const std::string& GetDirectory() const { return m_directory; }
+
+public:
+    // Hash of the source, its #include closure, entry point, profile and flags
+    static uint64_t ComputeKey( const CompileRequest& request );
+
+    // Source file followed by every file it includes, depth first, each listed once
+    static void ResolveIncludes( const std::string& path, std::vector<std::string>& closure );
+
+protected:
+    std::string GetCachePath( uint64_t key ) const;
+
+    bool Store( uint64_t key, const std::vector<unsigned char>& bytecode ) const;
+
+private:
+    std::string m_directory;
+    CompileFunc m_compiler;
+    int         m_workerCount;
+
+    Statistics m_statistics;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+
+// Fits a directional light's orthographic shadow projection to the part of the scene the camera sees. Independent of D3D.
+//
+// The fitted box covers the intersection of the camera frustum with the receiver bounds. Its near plane
+// is pulled back to the caster bounds so casters outside the view still reach the map. The box is square,
+// its size can be quantized and its position snapped to whole texels, so the map does not shimmer as the
+// camera moves. Matrices are 16 floats in the layout the shaders read (column_major packing, mul( M, v )).
+//
+// Cascaded maps fit one box per slice of the camera depth range; ComputeSplits gives the slice bounds and
+// FitCascades fits every slice to its tile of the shadow map atlas.
+class ShadowFrustum
+{
+public:
+    static const uint32_t MAX_CASCADES = 4;
+
+    struct Bounds
+    {
+        Bounds();
+
+        void Add( const float point[3] );
+        void Add( const Bounds& bounds );
+
+        bool IsValid() const { return min[0] <= max[0] && min[1] <= max[1] && min[2] <= max[2]; }
+
+        float min[3];
+        float max[3];
+    };
+
+    struct Input
+    {
+        Input();
+
+        float direction[3];             // light direction, pointing from the light into the scene
+
+        const float* pCameraView;       // nullptr fits the whole receiver bounds
+        const float* pCameraProjection;
+
+        float splitNear;                // camera view depth range to cover, splitFar 0 covers the whole frustum
+        float splitFar;
+
+        Bounds casters;
+        Bounds receivers;
+
+        uint32_t resolution;            // shadow map width and height in texels
+        float    sizeStep;              // box size rounds up to a multiple of this, 0 keeps it exact
+        bool     bSnapToTexels;
+    };
+
+    struct Result
+    {
+        Result();
+
+        float view[16];
+        float projection[16];
+
+        float origin[3];       // center of the near plane
+        float depthRange;      // near to far distance along the light direction
+        float extent;          // world-space width and height covered by the map
+
+        float texelsPerUnit;   // effective texel density on the receivers
+        bool  bFitted;         // false when the camera sees none of the receivers and the whole bounds were used
+    };
+
+public:
+    // Returns false when the receiver bounds are empty or the light direction is zero
+    static bool Fit( const Input& input, Result& result );
+
+    // Smallest shadow map resolution that keeps texelsPerUnit over a box of the given extent
+    static uint32_t GetResolutionForDensity( float extent, float texelsPerUnit );
+
+    // View depth range of the camera frustum, clamped to the part the bounds occupy.
+    // Returns false when the bounds lie entirely outside the depth range.
+    static bool GetDepthRange( const float view[16], const float projection[16], const Bounds& bounds, float& nearZ, float& farZ );
+
+    // count + 1 split depths from nearZ to farZ. lambda blends uniform (0) and logarithmic (1) spacing.
+    static void ComputeSplits( float nearZ, float farZ, uint32_t count, float lambda, float* pSplits );
+
+    // Tile of a square atlas of mapSize texels a cascade renders to, in texels
+    static void GetCascadeTile( uint32_t cascade, uint32_t cascadeCount, uint32_t mapSize, uint32_t& x, uint32_t& y, uint32_t& size );
+
+    // Fits one box per cascade, up to MAX_CASCADES, over the camera depth range the receivers occupy, each at
+    // the resolution of its tile. A single box is fitted without a camera or when the receivers lie outside
+    // its depth range. input.sizeStep applies to a single box and shrinks with the cascade count; the split
+    // and resolution fields of input are ignored. Writes cascade count + 1 split depths when more than one
+    // cascade is fitted, and returns the cascade count, 0 when a fit failed.
+    static uint32_t FitCascades( const Input& input, uint32_t cascadeCount, float lambda, uint32_t mapSize, Result* pResults, float* pSplits );
+
+    // False when the bounds lie entirely outside the fitted box, so nothing in them reaches the map
+    static bool Intersects( const Result& result, const Bounds& bounds );
+
+    // out = a * b: mul( out, v ) == mul( a, mul( b, v ) )
+    static void Multiply( const float a[16], const float b[16], float out[16] );
+
+    static bool Invert( const float m[16], float out[16] );
+
+    // mul( M, v ) as written in the shaders
+    static void Transform( const float m[16], const float v[4], float out[4] );
+};
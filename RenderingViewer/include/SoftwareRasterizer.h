@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Tiled, multithreaded CPU rasterizer that reproduces Shadow.hlsl and ForwardShading.hlsl. Independent of D3D.
+//
+// Inputs use the memory layout of the GPU path: Vertex matches VSInput, and the constant structs match
+// Camera::ResTransformBuffer, Light::ResLightData and Model::ResMaterialData. Matrices are 16 floats read the way
+// the shaders read them (column_major packing, mul( M, v )).
+//
+// Triangles are set up and binned into TILE_SIZE tiles, then tiles are rasterized in parallel with
+// 4-wide SSE2 edge and depth tests where available. Each tile walks its triangles in submission order,
+// so the output does not depend on the thread count.
+class SoftwareRasterizer
+{
+public:
+    static const uint32_t TILE_SIZE       = 64;
+    static const uint32_t MAX_TARGET_SIZE = 8192;
+
+    enum CULL_MODE
+    {
+        CULL_MODE_NONE,
+        CULL_MODE_BACK,
+    };
+
+    struct Vertex
+    {
+        float position[3];
+        float normal[3];
+        float texCoord[2];
+        float color[4];
+    };
+
+    struct TransformConstants
+    {
+        float world[16];
+        float view[16];
+        float projection[16];
+    };
+
+    struct LightConstants
+    {
+        float position[4];
+        float color[4];
+        float view[16];
+        float projection[16];
+        float direction[3];
+        float intensity[3];
+    };
+
+    struct MaterialConstants
+    {
+        float ka[4];
+        float kd[4];
+        float ks[4]; // w: shininess
+    };
+
+    struct Mesh
+    {
+        Mesh()
+            : pVertices( nullptr )
+            , vertexCount( 0 )
+            , pIndices( nullptr )
+            , indexCount( 0 )
+        {
+        }
+
+        const Vertex*   pVertices;
+        uint32_t        vertexCount;
+        const uint16_t* pIndices;
+        uint32_t        indexCount;
+
+        MaterialConstants material;
+    };
+
+    struct DepthTarget
+    {
+        DepthTarget( uint32_t width = 0, uint32_t height = 0 ) { Resize( width, height ); }
+
+        void Resize( uint32_t w, uint32_t h ) { width = w; height = h; data.assign( static_cast<size_t>(w) * h, 1.0f ); }
+        void Clear( float value ) { data.assign( data.size(), value ); }
+
+        uint32_t           width;
+        uint32_t           height;
+        std::vector<float> data;
+    };
+
+    // RGBA8, R in the lowest byte like DXGI_FORMAT_R8G8B8A8_UNORM
+    struct ColorTarget
+    {
+        ColorTarget( uint32_t width = 0, uint32_t height = 0 ) { Resize( width, height ); }
+
+        void Resize( uint32_t w, uint32_t h ) { width = w; height = h; data.assign( static_cast<size_t>(w) * h, 0xff000000u ); }
+        void Clear( float r, float g, float b );
+
+        uint32_t              width;
+        uint32_t              height;
+        std::vector<uint32_t> data;
+    };
+
+    // Counters of the last Render call
+    struct Statistics
+    {
+        Statistics() { Clear(); }
+
+        void Clear()
+        {
+            triangles        = 0;
+            binnedTriangles  = 0;
+            tileTriangles    = 0;
+            pixels           = 0;
+            setupMilliseconds  = 0.0;
+            rasterMilliseconds = 0.0;
+        }
+
+        double TotalMilliseconds() const { return setupMilliseconds + rasterMilliseconds; }
+
+        uint64_t triangles;        // submitted
+        uint64_t binnedTriangles;  // after clipping and culling
+        uint64_t tileTriangles;    // triangle/tile pairs rasterized
+        uint64_t pixels;           // pixels that passed the depth test
+
+        double setupMilliseconds;
+        double rasterMilliseconds;
+    };
+
+public:
+    // threadCount 0 uses the hardware concurrency
+    explicit SoftwareRasterizer( uint32_t threadCount = 0 );
+    ~SoftwareRasterizer();
+
+public:
+    void SetCullMode( CULL_MODE cullMode ) { m_cullMode = cullMode; }
+    CULL_MODE GetCullMode() const { return m_cullMode; }
+
+    uint32_t GetThreadCount() const { return m_threadCount; }
+
+    // Shadow.hlsl: depth only, positions transformed by the light view and projection
+    bool RenderShadow( const LightConstants& light, const std::vector<Mesh>& meshes, DepthTarget& shadowMap );
+
+    // ForwardShading.hlsl: Phong shading with the shadow map compare
+    bool RenderForward( const TransformConstants& transform, const LightConstants& light, const DepthTarget& shadowMap,
+                        const std::vector<Mesh>& meshes, ColorTarget& color, DepthTarget& depth );
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+    // Binary PPM / 8-bit PGM, readable without extra libraries
+    static bool SaveColor( const ColorTarget& target, const std::string& path );
+    static bool SaveDepth( const DepthTarget& target, const std::string& path );
+
+    // Matrices in the layout the shaders read, for callers without the viewer's math types
+    static void CreateLookAtLH( const float eye[3], const float target[3], const float up[3], float out[16] );
+    static void CreatePerspectiveFovLH( float fovY, float aspect, float nearZ, float farZ, float out[16] );
+    static void CreateOrthographicLH( float left, float right, float bottom, float top, float nearZ, float farZ, float out[16] );
+
+    // mul( M, v ) as written in the shaders
+    static void Transform( const float m[16], const float v[4], float out[4] );
+
+private:
+    static const uint32_t VARYING_COUNT    = 7;                 // world position, normal
+    static const uint32_t CLIP_VERTEX_SIZE = 4 + VARYING_COUNT; // clip position, varyings
+
+    struct Triangle
+    {
+        int32_t minX;
+        int32_t minY;
+        int32_t maxX;
+        int32_t maxY;
+
+        // Edge k is opposite vertex k: E = a * x + b * y + c in subpixels, inside when E >= 0
+        int64_t a[3];
+        int64_t b[3];
+        int64_t c[3];
+
+        float invArea;
+        float z[3];
+        float invW[3];
+
+        uint32_t meshIndex;
+        float    varyings[3][VARYING_COUNT];
+    };
+
+    struct Pass;
+
+    bool Render( const Pass& pass, const std::vector<Mesh>& meshes, DepthTarget& depth );
+
+    void SetupTriangles( const Pass& pass, const std::vector<Mesh>& meshes, uint32_t thread, uint64_t begin, uint64_t end );
+    void TransformVertices( const Pass& pass, const std::vector<Mesh>& meshes, uint64_t begin, uint64_t end );
+    void EmitTriangle( const Pass& pass, uint32_t thread, uint32_t meshIndex, const float* pVertices[3] );
+    void RasterizeTile( const Pass& pass, const std::vector<Mesh>& meshes, uint32_t tile, DepthTarget& depth );
+
+    // func( i ) for every i below workerCount, as jobs of the shared JobSystem
+    template <typename Func>
+    void ParallelFor( uint32_t workerCount, Func func );
+
+private:
+    uint32_t  m_threadCount;
+    CULL_MODE m_cullMode;
+
+    uint32_t m_tilesX;
+    uint32_t m_tilesY;
+    uint32_t m_setupThreads;
+
+    std::vector<uint64_t>                m_vertexOffsets;
+    std::vector<float>                   m_clipVertices;
+    std::vector<std::vector<Triangle> >  m_triangles; // per setup thread
+    std::vector<std::vector<uint32_t> >  m_bins;      // [thread * tileCount + tile], indices into m_triangles[thread]
+    std::vector<uint64_t>                m_tilePixels;
+    std::vector<uint64_t>                m_tileTriangles;
+
+    Statistics m_statistics;
+};
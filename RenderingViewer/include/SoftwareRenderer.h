@@ -0,0 +1,52 @@
+#pragma once
+
+using namespace std;
+
+// Renders a scene's shadow and forward passes on the CPU with SoftwareRasterizer,
+// reading the same camera, light and model data the GPU passes upload
+class SoftwareRenderer
+{
+public:
+    // threadCount 0 uses the hardware concurrency
+    explicit SoftwareRenderer( uint32_t threadCount = 0 );
+    ~SoftwareRenderer();
+
+public:
+    // Prepare() followed by RenderView() from the scene's camera
+    bool Render( shared_ptr<Scene> pScene, UINT width, UINT height, UINT shadowMapSize );
+
+    // Collects the scene's models and light and renders the shadow map. Views of a static scene share it.
+    bool Prepare( shared_ptr<Scene> pScene, UINT shadowMapSize );
+
+    // Forward pass into color, with the shadow map of the last Prepare()
+    bool RenderView( const SoftwareRasterizer::TransformConstants& transform, SoftwareRasterizer::ColorTarget& color );
+
+    // Writes <basePath>.ppm and <basePath>_shadow.pgm
+    bool Save( const string& basePath ) const;
+
+    const SoftwareRasterizer::ColorTarget& GetColorTarget() const { return m_color; }
+    const SoftwareRasterizer::DepthTarget& GetShadowMap() const { return m_shadowMap; }
+
+    // Models drawn per view
+    size_t GetMeshCount() const { return m_meshes.size(); }
+
+    const SoftwareRasterizer::Statistics& GetShadowStatistics() const { return m_shadowStatistics; }
+    const SoftwareRasterizer::Statistics& GetForwardStatistics() const { return m_forwardStatistics; }
+
+    static SoftwareRasterizer::TransformConstants CreateTransform( const Mat44f& view, const Mat44f& projection );
+
+private:
+    SoftwareRasterizer m_rasterizer;
+
+    shared_ptr<Camera>                 m_pCamera;
+    SoftwareRasterizer::LightConstants m_light;
+
+    SoftwareRasterizer::ColorTarget m_color;
+    SoftwareRasterizer::DepthTarget m_depth;
+    SoftwareRasterizer::DepthTarget m_shadowMap;
+
+    vector<SoftwareRasterizer::Mesh> m_meshes;
+
+    SoftwareRasterizer::Statistics m_shadowStatistics;
+    SoftwareRasterizer::Statistics m_forwardStatistics;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit allocator over the offsets of one block of memory. Independent of D3D: it only
+// hands out ranges, the owner decides what lives at them.
+//
+// Free ranges are listed by size class. The first level is the power of two of the size, the second splits
+// it into SL_COUNT equal steps, and a bitmap per level finds the smallest class that fits in constant time.
+// A freed range merges with its free neighbours right away, so two free ranges never touch. Sizes and
+// offsets are multiples of the granularity.
+class TlsfAllocator
+{
+public:
+    static const uint32_t INVALID_NODE = ~0u;
+
+public:
+    // granularity is rounded up to a power of two and capacity down to a multiple of it
+    explicit TlsfAllocator( uint64_t capacity, uint64_t granularity = 256 );
+    ~TlsfAllocator();
+
+public:
+    // alignment is a power of two, anything up to the granularity aligns to the granularity.
+    // INVALID_NODE for size 0 or when no free range fits.
+    uint32_t Allocate( uint64_t size, uint64_t alignment = 0 );
+    void Free( uint32_t node );
+
+    // Of an allocated node, size rounded up to the granularity
+    uint64_t GetOffset( uint32_t node ) const { return m_nodes[node].offset; }
+    uint64_t GetSize( uint32_t node ) const { return m_nodes[node].size; }
+
+    uint64_t GetCapacity() const { return m_capacity; }
+    uint64_t GetGranularity() const { return m_granularity; }
+    uint64_t GetUsedBytes() const { return m_usedBytes; }
+    uint32_t GetAllocationCount() const { return m_allocationCount; }
+    uint32_t GetFreeRangeCount() const { return m_freeRangeCount; }
+    uint64_t GetLargestFreeRange() const;
+
+    // Ranges tile the block, free ones are merged and each is listed in its class with the bitmaps agreeing
+    bool Validate() const;
+
+private:
+    static const uint32_t SL_BITS  = 4;
+    static const uint32_t SL_COUNT = 1u << SL_BITS;
+    static const uint32_t FL_COUNT = 64 - SL_BITS + 1;
+
+    struct Node
+    {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t prevPhysical;  // neighbours in the block
+        uint32_t nextPhysical;
+        uint32_t prevFree;      // neighbours in the class list, while free
+        uint32_t nextFree;
+        bool     bFree;
+    };
+
+    // Class of a range of granules, exact below SL_COUNT granules
+    static void GetClass( uint64_t granules, uint32_t& fl, uint32_t& sl );
+
+    // A free range of at least granules, still listed
+    uint32_t FindFree( uint64_t granules ) const;
+
+    void InsertFree( uint32_t node );
+    void RemoveFree( uint32_t node );
+
+    // Cuts node after size bytes; the rest is a new node, neither free nor listed
+    uint32_t Split( uint32_t node, uint64_t size );
+
+    uint32_t CreateNode();
+    void DestroyNode( uint32_t node );
+
+private:
+    uint64_t m_capacity;
+    uint64_t m_granularity;
+    uint32_t m_granularityShift;
+
+    std::vector<Node>     m_nodes;          // node 0 always starts the block
+    std::vector<uint32_t> m_unusedNodes;
+
+    uint64_t m_flBitmap;
+    uint32_t m_slBitmaps[FL_COUNT];
+    uint32_t m_freeHeads[FL_COUNT][SL_COUNT];
+
+    uint64_t m_usedBytes;
+    uint32_t m_allocationCount;
+    uint32_t m_freeRangeCount;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+using namespace std;
+
+// Persistently mapped upload heap buffer handed out through UploadRingAllocator
+class UploadRing
+{
+public:
+    UploadRing( ID3D12Device* pDevice, UINT64 capacity );
+    ~UploadRing();
+
+public:
+    UploadRingAllocator& GetAllocator() { return *m_pAllocator; }
+    const UploadRingAllocator& GetAllocator() const { return *m_pAllocator; }
+
+    bool IsValid() const { return m_pResource != nullptr; }
+
+private:
+    ComPtr<ID3D12Resource>          m_pResource;
+    unique_ptr<UploadRingAllocator> m_pAllocator;
+    MemoryTracker::Handle           m_memory;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// Sub-allocates a persistently mapped upload buffer as a ring. Independent of D3D:
+// the owner supplies the mapped CPU pointer and the GPU base address (any memory block works headless).
+//
+// Space used by a frame is reclaimed once the fence value it was submitted with has completed.
+// A frame that references an older allocation again calls Retain(), which holds that space until the frame completes.
+class UploadRingAllocator
+{
+public:
+    static const uint32_t DEFAULT_ALIGNMENT = 256;
+
+    struct Allocation
+    {
+        Allocation()
+            : virtualOffset( 0 )
+            , size( 0 )
+            , pCPU( nullptr )
+            , gpuAddress( 0 )
+        {
+        }
+
+        bool IsValid() const { return pCPU != nullptr; }
+
+        uint64_t virtualOffset; // monotonically increasing, offset in the buffer is virtualOffset % capacity
+        uint32_t size;
+        void*    pCPU;
+        uint64_t gpuAddress;
+    };
+
+    struct Statistics
+    {
+        Statistics()
+            : frameBytes( 0 )
+            , lastFrameBytes( 0 )
+            , usedBytes( 0 )
+            , highWaterBytes( 0 )
+            , allocations( 0 )
+            , reuses( 0 )
+            , failures( 0 )
+        {
+        }
+
+        uint64_t frameBytes;     // bytes handed out since the last EndFrame()
+        uint64_t lastFrameBytes; // bytes handed out by the last completed frame
+        uint64_t usedBytes;      // bytes not yet reclaimed
+        uint64_t highWaterBytes;
+        uint32_t allocations;
+        uint32_t reuses;
+        uint32_t failures;
+    };
+
+public:
+    UploadRingAllocator( void* pCPUBase, uint64_t gpuBase, uint64_t capacity, uint32_t alignment = DEFAULT_ALIGNMENT );
+    ~UploadRingAllocator();
+
+public:
+    Allocation Allocate( uint32_t size );
+
+    // True while an older allocation is intact and recent enough to be referenced again this frame
+    bool CanReuse( const Allocation& allocation ) const;
+
+    // Keeps an older allocation alive until the current frame has completed on the GPU
+    void Retain( const Allocation& allocation );
+
+    void EndFrame( uint64_t fenceValue );
+    void Reclaim( uint64_t completedFenceValue );
+
+    uint64_t GetCapacity() const { return m_capacity; }
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+private:
+    struct Frame
+    {
+        uint64_t fenceValue;
+        uint64_t end;
+        uint64_t retainBegin;
+    };
+
+    unsigned char* m_pCPUBase;
+    uint64_t       m_gpuBase;
+    uint64_t       m_capacity;
+    uint32_t       m_alignment;
+
+    uint64_t m_head;
+    uint64_t m_tail;
+    uint64_t m_retainBegin;
+
+    std::deque<Frame> m_frames;
+
+    Statistics m_statistics;
+};
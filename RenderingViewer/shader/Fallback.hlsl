@@ -0,0 +1,41 @@
+#include "inputDef.hlsli"
+
+// Drawn in place of ForwardShading while its pipeline is created in the background: the same inputs and
+// root signature, lit by the main light alone, so its own pipeline is quick to create up front.
+
+//-------------------------------------------------------------------------------------------------
+//      Vertex shader entry point
+//-------------------------------------------------------------------------------------------------
+VSOutput VSMain( const VSInput input )
+{
+    VSOutput output = (VSOutput)0;
+
+    float4 localPos = float4(input.Position, 1.0f);
+
+    float4 worldPos = mul( World, localPos );
+    float4 viewPos = mul( View, worldPos );
+    float4 projPos = mul( Proj, viewPos );
+
+    output.Position = projPos;
+    output.WorldPos = worldPos;
+    output.Normal = mul( (float3x3)World, input.Normal );
+    output.TexCoord = input.TexCoord;
+    output.Color = input.Color;
+
+    return output;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      Pixel shader entry point
+//-------------------------------------------------------------------------------------------------
+PSOutput PSMain( const VSOutput input )
+{
+    PSOutput output = (PSOutput)0;
+
+    float3 l = -normalize( Direction );
+    float3 n = normalize( input.Normal );
+
+    output.Color = float4(Ka.rgb + Kd.rgb * max( dot( l, n ), 0.0 ), 1.0);
+
+    return output;
+}
@@ -43,6 +43,38 @@ float4 Phong( float4 pos, float3 normal )
     return float4(ambient + diffuse + specular, 1.0);
 }
 
+// Diffuse light of the point and spot lights binned into the pixel's cluster
+float3 ClusteredLighting( float3 worldPos, float3 normal, float2 pixel, float viewDepth )
+{
+    uint2 tile  = min( uint2( pixel * ClusterTileScale ), uint2( ClusterTilesX - 1, ClusterTilesY - 1 ) );
+    uint  slice = (uint)clamp( floor( log( max( viewDepth, 1e-4 ) ) * ClusterSliceScale + ClusterSliceBias ), 0.0, ClusterSlices - 1.0 );
+
+    uint2 range = ClusterRanges[(slice * ClusterTilesY + tile.y) * ClusterTilesX + tile.x];
+
+    float3 result = float3(0.0, 0.0, 0.0);
+    for (uint i = 0; i < range.y; ++i)
+    {
+        ClusterLight light = ClusterLights[ClusterIndices[range.x + i]];
+
+        float3 toLight       = light.PositionRange.xyz - worldPos;
+        float  lightDistance = length( toLight );
+        float3 l             = toLight / max( lightDistance, 1e-4 );
+
+        float attenuation = saturate( 1.0 - lightDistance / light.PositionRange.w );
+        attenuation *= attenuation;
+
+        if (light.DirectionCosOuter.w > -1.0)
+        {
+            float cosAngle = dot( -l, light.DirectionCosOuter.xyz );
+            attenuation *= saturate( (cosAngle - light.DirectionCosOuter.w) / max( light.ColorCosInner.w - light.DirectionCosOuter.w, 1e-4 ) );
+        }
+
+        result += Kd.rgb * light.ColorCosInner.rgb * max( dot( normal, l ), 0.0 ) * attenuation;
+    }
+
+    return result;
+}
+
 //-------------------------------------------------------------------------------------------------
 //      Pixel shader entry point
 //-------------------------------------------------------------------------------------------------
@@ -52,9 +84,12 @@ PSOutput PSMain( const VSOutput input )
 
     float4 color = Phong( input.Position, input.Normal );
 
-    float4 lightSpacePos = input.WorldPos;
-    lightSpacePos = mul( LightView, lightSpacePos );
-    lightSpacePos = mul( LightProj, lightSpacePos );
+    // The first cascade whose far split lies beyond the pixel
+    float viewDepth = mul( View, input.WorldPos ).z;
+    uint cascade = (viewDepth > CascadeSplits.x) + (viewDepth > CascadeSplits.y) + (viewDepth > CascadeSplits.z);
+    cascade = min( cascade, CascadeCount - 1 );
+
+    float4 lightSpacePos = mul( CascadeViewProj[cascade], input.WorldPos );
 
     lightSpacePos.xyz /= lightSpacePos.w;
 
@@ -62,11 +97,13 @@ PSOutput PSMain( const VSOutput input )
 
     float2 shadowTexCoord = 0.5f * (lightSpacePos.xy + 1.0f);
     shadowTexCoord.y = 1.0f - shadowTexCoord.y;
+    shadowTexCoord = shadowTexCoord * CascadeRects[cascade].xy + CascadeRects[cascade].zw;
 
     float4 shadowFactor = float4(1.0, 1.0, 1.0, 1.0);
     if (ShadowMap.Sample( ShadowSmp, shadowTexCoord ).x < depth )
         shadowFactor = float4(0.25, 0.25, 0.25, 1.0);
 
     output.Color = color * shadowFactor;
+    output.Color.rgb += ClusteredLighting( input.WorldPos.xyz, normalize( input.Normal ), input.Position.xy, viewDepth );
     return output;
 }
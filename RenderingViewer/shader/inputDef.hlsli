@@ -62,6 +62,12 @@ cbuffer LightDataBuffer : register(b1)
 
     float3 Direction : packoffset(c10);
     float3 Intensity : packoffset(c11);
+
+    // Cascaded shadow map: one tile of ShadowMap per cascade
+    float4x4 CascadeViewProj[4] : packoffset(c12);
+    float4   CascadeSplits      : packoffset(c28);  // far view depth of each cascade
+    float4   CascadeRects[4]    : packoffset(c29);  // atlas uv scale in xy, offset in zw
+    uint     CascadeCount       : packoffset(c33);
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -76,5 +82,34 @@ cbuffer Material : register(b2)
     float Shininess : packoffset(c2.w);
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ClusterBuffer constant buffer
+///////////////////////////////////////////////////////////////////////////////////////////////////
+cbuffer ClusterBuffer : register(b3)
+{
+    uint   ClusterTilesX     : packoffset(c0.x);
+    uint   ClusterTilesY     : packoffset(c0.y);
+    uint   ClusterSlices     : packoffset(c0.z);
+    uint   ClusterLightCount : packoffset(c0.w);
+
+    float  ClusterSliceScale : packoffset(c1.x);  // slice = log( viewDepth ) * scale + bias
+    float  ClusterSliceBias  : packoffset(c1.y);
+    float2 ClusterTileScale  : packoffset(c1.z);  // tiles per pixel
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ClusterLight structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct ClusterLight
+{
+    float4 PositionRange;
+    float4 ColorCosInner;
+    float4 DirectionCosOuter;   // cosOuter -1 for point lights
+};
+
+StructuredBuffer<ClusterLight> ClusterLights  : register(t1);
+StructuredBuffer<uint2>        ClusterRanges  : register(t2);  // offset, count per cluster
+StructuredBuffer<uint>         ClusterIndices : register(t3);
+
 Texture2D       ShadowMap : register(t0);
 SamplerState    ShadowSmp     : register(s0);
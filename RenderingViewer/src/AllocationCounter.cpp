@@ -0,0 +1,196 @@
+#include "AllocationCounter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef ALLOCATION_COUNTER_ENABLED
+
+namespace
+{
+    std::atomic<uint64_t> g_count( 0 );
+    std::atomic<uint64_t> g_bytes( 0 );
+    thread_local uint64_t g_threadCount = 0;
+
+    void Count( size_t size )
+    {
+        g_count.fetch_add( 1, std::memory_order_relaxed );
+        g_bytes.fetch_add( size, std::memory_order_relaxed );
+        g_threadCount++;
+    }
+
+    void* Allocate( size_t size )
+    {
+        Count( size );
+
+        // malloc( 0 ) may return null, new may not
+        if (size == 0)
+            size = 1;
+
+        for (;;)
+        {
+            void* p = std::malloc( size );
+            if (p != nullptr)
+                return p;
+
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr)
+                throw std::bad_alloc();
+
+            handler();
+        }
+    }
+
+#ifdef __cpp_aligned_new
+    void* AllocateAligned( size_t size, std::align_val_t alignment )
+    {
+        Count( size );
+
+        if (size == 0)
+            size = 1;
+
+        for (;;)
+        {
+#ifdef _WIN32
+            void* p = _aligned_malloc( size, static_cast<size_t>(alignment) );
+#else
+            void* p = nullptr;
+            if (posix_memalign( &p, std::max( sizeof( void* ), static_cast<size_t>(alignment) ), size ) != 0)
+                p = nullptr;
+#endif
+            if (p != nullptr)
+                return p;
+
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr)
+                throw std::bad_alloc();
+
+            handler();
+        }
+    }
+
+    void FreeAligned( void* p )
+    {
+#ifdef _WIN32
+        _aligned_free( p );
+#else
+        std::free( p );
+#endif
+    }
+#endif
+}
+
+void* operator new( size_t size ) { return Allocate( size ); }
+void* operator new[]( size_t size ) { return Allocate( size ); }
+
+void* operator new( size_t size, const std::nothrow_t& ) noexcept
+{
+    try
+    {
+        return Allocate( size );
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[]( size_t size, const std::nothrow_t& ) noexcept
+{
+    try
+    {
+        return Allocate( size );
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete( void* p ) noexcept { std::free( p ); }
+void operator delete[]( void* p ) noexcept { std::free( p ); }
+void operator delete( void* p, size_t ) noexcept { std::free( p ); }
+void operator delete[]( void* p, size_t ) noexcept { std::free( p ); }
+void operator delete( void* p, const std::nothrow_t& ) noexcept { std::free( p ); }
+void operator delete[]( void* p, const std::nothrow_t& ) noexcept { std::free( p ); }
+
+#ifdef __cpp_aligned_new
+void* operator new( size_t size, std::align_val_t alignment ) { return AllocateAligned( size, alignment ); }
+void* operator new[]( size_t size, std::align_val_t alignment ) { return AllocateAligned( size, alignment ); }
+
+void* operator new( size_t size, std::align_val_t alignment, const std::nothrow_t& ) noexcept
+{
+    try
+    {
+        return AllocateAligned( size, alignment );
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[]( size_t size, std::align_val_t alignment, const std::nothrow_t& ) noexcept
+{
+    try
+    {
+        return AllocateAligned( size, alignment );
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete( void* p, std::align_val_t ) noexcept { FreeAligned( p ); }
+void operator delete[]( void* p, std::align_val_t ) noexcept { FreeAligned( p ); }
+void operator delete( void* p, size_t, std::align_val_t ) noexcept { FreeAligned( p ); }
+void operator delete[]( void* p, size_t, std::align_val_t ) noexcept { FreeAligned( p ); }
+void operator delete( void* p, std::align_val_t, const std::nothrow_t& ) noexcept { FreeAligned( p ); }
+void operator delete[]( void* p, std::align_val_t, const std::nothrow_t& ) noexcept { FreeAligned( p ); }
+#endif
+
+bool AllocationCounter::IsEnabled()
+{
+    return true;
+}
+
+uint64_t AllocationCounter::GetCount()
+{
+    return g_count.load( std::memory_order_relaxed );
+}
+
+uint64_t AllocationCounter::GetBytes()
+{
+    return g_bytes.load( std::memory_order_relaxed );
+}
+
+uint64_t AllocationCounter::GetThreadCount()
+{
+    return g_threadCount;
+}
+
+#else
+
+bool AllocationCounter::IsEnabled()
+{
+    return false;
+}
+
+uint64_t AllocationCounter::GetCount()
+{
+    return 0;
+}
+
+uint64_t AllocationCounter::GetBytes()
+{
+    return 0;
+}
+
+uint64_t AllocationCounter::GetThreadCount()
+{
+    return 0;
+}
+
+#endif
@@ -1,8 +1,17 @@
 ﻿#include "App.h"
 
+static_assert( sizeof( Mat33f ) == sizeof( float ) * 9, "Mat33f is not 9 floats" );
+static_assert( sizeof( Vec3f ) == sizeof( float ) * 3, "Vec3f is not 3 floats" );
+
 App::App( HWND hWnd, HINSTANCE hInst )
     : m_isInit( false )
     , m_fenceValue( 1 )
+    , m_frameCount( 0 )
+    , m_cameraVersion( 0 )
+    , m_lightVersion( 0 )
+    , m_sceneVersion( 0 )
+    , m_bCompilingPipelines( false )
+    , m_fallbackFrames( 0 )
 {
     m_hWnd = hWnd;
     m_hInst = hInst;
@@ -24,16 +33,54 @@ bool App::Run()
         return false;
     }
 
-    OnFrameRender();
-
+    // The sampling thread reads the mouse even while dragging outside the window and wakes the loop
+    // on new input, so the camera takes everything sampled up to just before the frame is recorded
     ProcessInput();
 
+    TrackChanges();
+
+    if (m_scheduler.BeginIteration())
+        OnFrameRender();
+
     return true;
 }
 
+void App::TrackChanges()
+{
+    if (m_pCamera->GetVersion() != m_cameraVersion)
+    {
+        m_cameraVersion = m_pCamera->GetVersion();
+        m_scheduler.Invalidate( FrameScheduler::INVALIDATE_CAMERA );
+    }
+
+    if (m_pLight->GetVersion() != m_lightVersion)
+    {
+        m_lightVersion = m_pLight->GetVersion();
+        m_scheduler.Invalidate( FrameScheduler::INVALIDATE_LIGHT );
+    }
+
+    // Versions only grow, so the combination changes with any model edit, addition or removal
+    UINT64 sceneVersion = m_pScene->GetRootNode()->GetChildren().size();
+    for (auto& pNode : m_pScene->GetRootNode()->GetChildren())
+    {
+        if (pNode->IsNodeType( Node::NODE_TYPE_MODEL ) || pNode->IsNodeType( Node::NODE_TYPE_LIGHT_CLUSTER ))
+            sceneVersion = sceneVersion * 31 + pNode->GetVersion();
+    }
+
+    if (sceneVersion != m_sceneVersion)
+    {
+        m_sceneVersion = sceneVersion;
+        m_scheduler.Invalidate( FrameScheduler::INVALIDATE_SCENE );
+    }
+}
+
 
 bool App::Initialize()
 {
+    // Loading is recorded too; the trace keeps it, the frame summaries start with the first frame
+    Profiler::SetThreadName( "Main" );
+    Profiler::SetEnabled( true );
+
     if (!InitD3D12())
     {
         cerr << "Failed to initialize D3D12" << endl;
@@ -132,6 +179,36 @@ bool App::InitD3D12()
         }
     }
 
+    // Every resource below is accounted from here on, sized as the device places it
+    {
+        const UINT64 MiB = 1024 * 1024;
+
+        m_pMemoryBackend = unique_ptr<DeviceMemoryBackend>( new DeviceMemoryBackend( m_pDevice.Get(), m_pAdapter.Get() ) );
+
+        MemoryTracker& tracker = MemoryTracker::GetInstance();
+        tracker.SetBackend( m_pMemoryBackend.get() );
+        tracker.SetOwnerName( this, "App" );
+
+        tracker.SetBudget( MemoryTracker::CATEGORY_GEOMETRY, 256 * MiB );
+        tracker.SetBudget( MemoryTracker::CATEGORY_CONSTANTS, 16 * MiB );
+        tracker.SetBudget( MemoryTracker::CATEGORY_DESCRIPTORS, 8 * MiB );
+        tracker.SetBudget( MemoryTracker::CATEGORY_SHADOW, 128 * MiB );
+        tracker.SetBudget( MemoryTracker::CATEGORY_RENDER_TARGETS, 128 * MiB );
+
+        UINT64 deviceBudget = 0;
+        UINT64 deviceUsage  = 0;
+        if (m_pMemoryBackend->QueryDeviceMemory( deviceBudget, deviceUsage ))
+            tracker.SetTotalBudget( deviceBudget );
+
+        tracker.SetWarning( []( MemoryTracker::CATEGORY category, uint64_t bytes, uint64_t budget )
+        {
+            char buf[256];
+            sprintf_s( buf, 256, "MemoryTracker: %s uses %.1f MiB, over its %.1f MiB budget.",
+                       MemoryTracker::GetCategoryName( category ), bytes / (1024.0 * 1024.0), budget / (1024.0 * 1024.0) );
+            Log::Output( Log::LOG_LEVEL_ERROR, buf );
+        } );
+    }
+
     // create command queue
     {
         D3D12_COMMAND_QUEUE_DESC desc;
@@ -205,6 +282,9 @@ bool App::InitD3D12()
 
         m_pDescHeapForRT = make_shared<DescriptorHeap>();
         m_pDescHeapForRT->Create( m_pDevice.Get(), desc );
+
+        m_rtvHeapMemory = MemoryTracker::GetInstance().Track( MemoryTracker::CATEGORY_DESCRIPTORS,
+                                                              MemoryResourceDesc::DescriptorHeap( desc.NumDescriptors, m_pDevice->GetDescriptorHandleIncrementSize( desc.Type ) ), this );
     }
 
     // create render targets from back buffers
@@ -221,6 +301,9 @@ bool App::InitD3D12()
             }
 
             m_pRenderTargets[i]->CreateBufferView( m_pDevice.Get(), m_pDescHeapForRT, Buffer::BUFFER_VIEW_TYPE_RENDER_TARGET );
+
+            m_backBufferMemory[i] = MemoryTracker::GetInstance().Track( MemoryTracker::CATEGORY_RENDER_TARGETS,
+                                                                        MemoryResourceDesc::Texture2D( m_width, m_height, 4, MemoryResourceDesc::FLAG_RENDER_TARGET ), this );
         }
     }
 
@@ -279,21 +362,51 @@ bool App::InitApp()
 
 bool App::CreateRenderPass()
 {
+    // Root signatures, pipeline states and shaders are shared by every pass and context
+    m_pPipelineCache = make_shared<PipelineCache>();
+    m_pPipelineCache->PreloadShaders( { L"ForwardShading.hlsl", L"Shadow.hlsl", L"Fallback.hlsl" } );
+
+    // One shader-visible heap for every pass: persistent tables plus a transient slice per frame
+    const UINT PERSISTENT_DESCRIPTOR_COUNT = 65536;
+    const UINT TRANSIENT_DESCRIPTOR_COUNT  = 4096;
+    const UINT FRAME_COUNT                 = 2;
+    m_pDescHeap = make_shared<GlobalDescriptorHeap>( m_pDevice.Get(), PERSISTENT_DESCRIPTOR_COUNT, TRANSIENT_DESCRIPTOR_COUNT, FRAME_COUNT );
+
+    // Constants of every node are written into one mapped ring and bound as root CBVs
+    const UINT64 UPLOAD_RING_SIZE = 4 * 1024 * 1024;
+    m_pUploadRing = make_shared<UploadRing>( m_pDevice.Get(), UPLOAD_RING_SIZE );
+
+    // Vertex and index buffers of every model are placed in a few large heaps instead of a resource each
+    m_pGeometryHeap = make_shared<GeometryHeap>( m_pDevice.Get() );
+
+    // Each pass's command list is bracketed by timestamps, read back once its frame's fence has passed
+    m_pGpuTimestamps = make_shared<GpuTimestampHeap>( m_pDevice.Get(), m_pCommandQueue.Get(), GpuTimer::QUERY_COUNT );
+    m_pGpuTimer      = make_shared<GpuTimer>( *m_pGpuTimestamps );
+
+    // Draw lists and sort keys of the passes, rewound every frame
+    m_pFrameArena = make_shared<FrameArena>();
+
     m_pRenderPassClear = make_shared<RenderPassClear>( m_pDevice.Get() );
+    m_pRenderPassClear->SetGpuTimer( m_pGpuTimer, "GPU Clear" );
     m_pRenderPassClear->Construct( m_pDevice.Get() );
 
     m_pRenderPassForward = make_shared<RenderPassForward>( m_pDevice.Get() );
 
     m_pRenderPassForward->SetScene( m_pScene );
+    m_pRenderPassForward->SetPipelineCache( m_pPipelineCache );
+    m_pRenderPassForward->SetDescriptorHeap( m_pDescHeap );
+    m_pRenderPassForward->SetGpuTimer( m_pGpuTimer, "GPU Forward" );
+    m_pRenderPassForward->SetFrameArena( m_pFrameArena );
 
     m_pRenderPassForward->Construct( m_pDevice.Get() );
     m_pRenderPassForward->BindResource(m_pDevice.Get(), m_pShadowMap, Buffer::BUFFER_VIEW_TYPE_SHADER_RESOURCE);
 
-    m_pRenderPassClearShadow = make_shared<RenderPassClear>( m_pDevice.Get() );
-    m_pRenderPassClearShadow->Construct( m_pDevice.Get() );
-
     m_pRenderPassShadow = make_shared<RenderPassShadow>( m_pDevice.Get() );
     m_pRenderPassShadow->SetScene( m_pScene );
+    m_pRenderPassShadow->SetPipelineCache( m_pPipelineCache );
+    m_pRenderPassShadow->SetDescriptorHeap( m_pDescHeap );
+    m_pRenderPassShadow->SetGpuTimer( m_pGpuTimer, "GPU Shadow" );
+    m_pRenderPassShadow->SetFrameArena( m_pFrameArena );
 
     m_pRenderPassShadow->Construct( m_pDevice.Get() );
 
@@ -311,6 +424,9 @@ bool App::CreateDepthStencilBuffer()
 
         m_pDescHeapForDS = make_shared<DescriptorHeap>();
         m_pDescHeapForDS->Create( m_pDevice.Get(), desc );
+
+        m_dsvHeapMemory = MemoryTracker::GetInstance().Track( MemoryTracker::CATEGORY_DESCRIPTORS,
+                                                              MemoryResourceDesc::DescriptorHeap( desc.NumDescriptors, m_pDevice->GetDescriptorHandleIncrementSize( desc.Type ) ), this );
     }
 
     // create constant buffer
@@ -324,6 +440,9 @@ bool App::CreateDepthStencilBuffer()
 
         m_pDSBuffer->Create( m_pDevice.Get(), m_width, m_height, D3D12_RESOURCE_STATE_DEPTH_WRITE, &clearVal );
         m_pDSBuffer->CreateBufferView( m_pDevice.Get(), m_pDescHeapForDS, Buffer::BUFFER_VIEW_TYPE_DEPTH_STENCIL);
+
+        m_depthMemory = MemoryTracker::GetInstance().Track( MemoryTracker::CATEGORY_RENDER_TARGETS,
+                                                            MemoryResourceDesc::Texture2D( m_width, m_height, 4, MemoryResourceDesc::FLAG_DEPTH_STENCIL ), this );
     }
 
         // create constant buffer
@@ -333,12 +452,16 @@ bool App::CreateDepthStencilBuffer()
         clearVal.DepthStencil.Depth   = 1.0f;
         clearVal.DepthStencil.Stencil = 0;
 
-        m_shadowSize.x = 2048;
-        m_shadowSize.y = 2048;
+        // Atlas of 2048^2 tiles, one per cascade
+        m_shadowSize.x = 4096;
+        m_shadowSize.y = 4096;
 
         m_pShadowMap = make_shared<DepthStencilBuffer>();
         m_pShadowMap->Create( m_pDevice.Get(), m_shadowSize.x, m_shadowSize.y, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, &clearVal );
         m_pShadowMap->CreateBufferView( m_pDevice.Get(), m_pDescHeapForDS, Buffer::BUFFER_VIEW_TYPE_DEPTH_STENCIL );
+
+        m_shadowMapMemory = MemoryTracker::GetInstance().Track( MemoryTracker::CATEGORY_SHADOW,
+                                                                MemoryResourceDesc::Texture2D( m_shadowSize.x, m_shadowSize.y, 4, MemoryResourceDesc::FLAG_DEPTH_STENCIL ), this );
     }
 
     return true;
@@ -365,20 +488,61 @@ bool App::CreateScene()
     Mat44f poseMat = m_pCamera->GetViewMatrix().Inverse() * transMat.Inverse();
     m_pCamera->SetPoseMatrix( poseMat.GetScaleAndRoation() );
 
-    m_pCamera->UpdateGPUBuffer();
-
     m_pLight = make_shared<Light>( m_pDevice.Get() );
     m_pScene->GetRootNode()->AddChild( m_pLight );
 
     m_pBunny = make_shared<Model>( m_pDevice.Get() );
     m_pScene->GetRootNode()->AddChild( m_pBunny );
 
-    m_pBunny->BindAsset( m_pDevice.Get(), "resource/bunny.obj" );
-
     m_pFloor = make_shared<Model>( m_pDevice.Get() );
     m_pScene->GetRootNode()->AddChild( m_pFloor );
 
-    m_pFloor->BindAsset( m_pDevice.Get(), "resource/floor.obj" );
+    // The files are read and parsed as jobs while this thread helps; the geometry heap and the memory tracker
+    // are only touched here, binding the meshes once they are all loaded
+    shared_ptr<Model> pModels[] = { m_pBunny, m_pFloor };
+    const string      paths[]   = { "resource/bunny.obj", "resource/floor.obj" };
+    ObjMesh           meshes[_countof( paths )];
+    bool              bLoaded[_countof( paths )] = {};
+
+    auto loadMesh = [&]( uint32_t i ) { bLoaded[i] = meshes[i].Load( paths[i] ); };
+    JobSystem::GetInstance().ParallelFor( static_cast<uint32_t>(_countof( paths )), loadMesh, 1 );
+
+    for (size_t i = 0; i < _countof( paths ); ++i)
+    {
+        if (bLoaded[i])
+            pModels[i]->BindAsset( m_pGeometryHeap, paths[i], meshes[i] );
+        else
+            Log::Output( Log::LOG_LEVEL_ERROR, ("App::CreateScene() Failed to load " + paths[i] + ".").c_str() );
+    }
+
+    // A grid of colored point lights just above the floor and four spot lights aimed at the center
+    m_pLightClusters = make_shared<ClusteredLights>( m_pDevice.Get() );
+    m_pScene->GetRootNode()->AddChild( m_pLightClusters );
+
+    const ShadowFrustum::Bounds bounds = m_pScene->GetBounds();
+    const Vec3f lo( bounds.min[0], bounds.min[1], bounds.min[2] );
+    const Vec3f hi( bounds.max[0], bounds.max[1], bounds.max[2] );
+    const Vec3f center = (lo + hi) * 0.5f;
+    const Vec3f extent = hi - lo;
+
+    const Vec3f palette[] = { Vec3f( 1.0f, 0.3f, 0.2f ), Vec3f( 0.2f, 1.0f, 0.3f ), Vec3f( 0.2f, 0.4f, 1.0f ), Vec3f( 1.0f, 0.9f, 0.3f ) };
+    const int   GRID      = 8;
+    const float cellSize  = max( extent.x, extent.z ) / GRID;
+    for (int z = 0; z < GRID; ++z)
+    {
+        for (int x = 0; x < GRID; ++x)
+        {
+            Vec3f position( lo.x + (x + 0.5f) * extent.x / GRID, lo.y + 0.1f * extent.y, lo.z + (z + 0.5f) * extent.z / GRID );
+            m_pLightClusters->AddPointLight( position, 1.5f * cellSize, palette[(x + z) % _countof( palette )] * 0.5f );
+        }
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        Vec3f position( (i & 1) ? hi.x : lo.x, hi.y, (i & 2) ? hi.z : lo.z );
+        m_pLightClusters->AddSpotLight( position, center - position, 2.0f * (center - position).norm(),
+                                        static_cast<float>(DEG2RAD( 10 )), static_cast<float>(DEG2RAD( 20 )), Vec3f::ONE );
+    }
 
     return true;
 }
@@ -387,6 +551,10 @@ bool App::TermD3D12()
 {
     WaitDrawCommandDone();
 
+    // Pipelines still being created in the background use the device
+    if (m_pPipelineCache != nullptr)
+        m_pPipelineCache->Release();
+
     if (!CloseHandle( m_fenceEvent ))
     {
         cerr << "Failed to terminate app" << endl;
@@ -394,6 +562,20 @@ bool App::TermD3D12()
     }
     m_fenceEvent = nullptr;
 
+    // Resources of the passes and the scene are released with their owners, after the backend is gone
+    MemoryTracker& tracker = MemoryTracker::GetInstance();
+    m_rtvHeapMemory.Release();
+    m_dsvHeapMemory.Release();
+    m_depthMemory.Release();
+    m_shadowMapMemory.Release();
+    for (auto& memory : m_backBufferMemory)
+    {
+        memory.Release();
+    }
+    tracker.RemoveOwner( this );
+    tracker.SetBackend( nullptr );
+    m_pMemoryBackend.reset();
+
     m_pSwapChain.Reset();
     m_pFence.Reset();
     m_pCommandQueue.Reset();
@@ -409,14 +591,33 @@ bool App::TermApp()
 
 void App::Present( unsigned int syncInterval )
 {
-    m_pRenderPassClearShadow->Render( m_pCommandQueue.Get() );
-    m_pRenderPassShadow->Render( m_pCommandQueue.Get() );
+    PROFILE_SCOPE( "Present" );
+
+    // Each pass records into a single command list, so the whole frame goes out in one submission.
+    // The shadow list is left out when every cached tile was kept.
+    ID3D12CommandList* cmdList[3];
+    UINT               cmdListCount = 0;
+    if (m_pRenderPassShadow->IsRecorded())
+        cmdList[cmdListCount++] = m_pRenderPassShadow->GetCommandList()->GetCommandList();
+    cmdList[cmdListCount++] = m_pRenderPassClear->GetCommandList()->GetCommandList();
+    cmdList[cmdListCount++] = m_pRenderPassForward->GetCommandList()->GetCommandList();
 
-    m_pRenderPassClear->Render( m_pCommandQueue.Get() );
-    m_pRenderPassForward->Render( m_pCommandQueue.Get() );
+    m_pCommandQueue->ExecuteCommandLists( cmdListCount, cmdList );
+
+    // The pass timestamps are readable once the fence signaled below has passed
+    m_pGpuTimer->EndFrame( m_fenceValue );
 
     m_pSwapChain->Present( syncInterval, 0 );
 
+    // Ring space written this frame is free again once the fence signaled below has passed
+    m_pUploadRing->GetAllocator().EndFrame( m_fenceValue );
+
+    // So is geometry freed or moved away from during this frame
+    m_pGeometryHeap->GetAllocator().EndFrame( m_fenceValue );
+
+    // And the transient descriptors of this frame's slice
+    m_pDescHeap->EndFrame( m_fenceValue );
+
     WaitDrawCommandDone();
 
     m_swapChainCount = m_pSwapChain->GetCurrentBackBufferIndex();
@@ -424,18 +625,212 @@ void App::Present( unsigned int syncInterval )
 
 void App::OnFrameRender()
 {
-    ResetFrame();
+    const AllocationCounter::Scope allocations;
+
+    Profiler::BeginFrame();
+    {
+        PROFILE_SCOPE( "Frame" );
+
+        ResetFrame();
+
+        UpdateGPUBuffers();
+
+        RenderShadowPass();
+        RenderForwardPass();
+
+        Present( 1 );
+    }
+    Profiler::EndFrame();
+
+    AddFrameStatistics( allocations.GetCount() );
+
+    // Present returns once the GPU finished the frame
+    InputSampler& sampler = m_inputManager->GetSampler();
+    sampler.RecordPresent( m_inputManager->GetInputFrame(), sampler.Now() );
+
+    OutputStatistics();
+}
+
+void App::AddFrameStatistics( uint64_t allocations )
+{
+    FrameStatistics::Frame frame;
+    frame.cpuMilliseconds = Profiler::GetSummary().lastMilliseconds;
+
+    // Pass times are of the newest frame the GPU timer read, a frame or two behind this one
+    for (const GpuTimer::ZoneTime& zone : m_pGpuTimer->GetZoneTimes())
+    {
+        const uint32_t pass = m_frameStatistics.AddPass( zone.name );
+        if (pass != FrameStatistics::INVALID_PASS)
+            frame.passMilliseconds[pass] = zone.milliseconds;
+    }
+
+    const RenderPass::Statistics& shadowStats  = m_pRenderPassShadow->GetStatistics();
+    const RenderPass::Statistics& forwardStats = m_pRenderPassForward->GetStatistics();
+    frame.draws       = shadowStats.drawCount + forwardStats.drawCount;
+    frame.triangles   = shadowStats.triangleCount + forwardStats.triangleCount;
+    frame.uploadBytes = m_pUploadRing->GetAllocator().GetStatistics().lastFrameBytes;
+    frame.allocations = allocations;
+
+    m_frameStatistics.AddFrame( frame );
+
+    if (shadowStats.fallbackDraws + shadowStats.skippedDraws + forwardStats.fallbackDraws + forwardStats.skippedDraws > 0)
+        m_fallbackFrames++;
+}
+
+void App::OutputStatistics()
+{
+    const int REPORT_INTERVAL = 600;
 
-    UpdateGPUBuffers();
+    if ((m_frameCount++ % REPORT_INTERVAL) != 0)
+        return;
+
+    auto output = [&]( const char* name, const RenderPass::Statistics& stats )
+    {
+        cout << name
+             << ": draws " << stats.drawCount
+             << ", triangles " << stats.triangleCount
+             << ", command lists " << stats.commandLists
+             << ", state binds " << stats.requestedBinds << " -> " << stats.issuedBinds
+             << " (redundant " << stats.RedundantBinds() << ")"
+             << ", heap switches " << stats.heapSwitches
+             << ", state changes " << stats.unsortedStateChanges << " -> " << stats.stateChanges << " sorted"
+             << ", fallback draws " << stats.fallbackDraws << ", skipped draws " << stats.skippedDraws
+             << ", saturated keys " << stats.saturatedKeys << endl;
+    };
+
+    output( "Shadow pass", m_pRenderPassShadow->GetStatistics() );
+    output( "Forward pass", m_pRenderPassForward->GetStatistics() );
+
+    const FrameScheduler::Statistics& schedulerStats = m_scheduler.GetStatistics();
+    cout << "Frame scheduler"
+         << ": " << schedulerStats.frames << " frames / " << schedulerStats.iterations << " loop iterations"
+         << " (" << schedulerStats.RenderedRatio() * 100.0 << "%)"
+         << ", camera " << schedulerStats.reasonFrames[0] << ", light " << schedulerStats.reasonFrames[1]
+         << ", scene " << schedulerStats.reasonFrames[2] << ", window " << schedulerStats.reasonFrames[3]
+         << ", pending work " << schedulerStats.pendingFrames << endl;
+
+    const InputSampler::Statistics inputStats = m_inputManager->GetSampler().GetStatistics();
+    cout << "Input"
+         << ": " << inputStats.samples << " samples (failed " << inputStats.failedSamples << ")"
+         << ", " << inputStats.events << " events (coalesced " << inputStats.coalesced << ")"
+         << ", input to present " << inputStats.AverageLatency() * 1000.0 << " ms avg / " << inputStats.latencyMax * 1000.0 << " ms max"
+         << ", newest input " << inputStats.AverageLastLatency() * 1000.0 << " ms avg"
+         << " over " << inputStats.presents << " frames" << endl;
+
+    const Profiler::Summary& profile = Profiler::GetSummary();
+    cout << "CPU profile"
+         << ": frame " << profile.lastMilliseconds << " ms, " << profile.averageMilliseconds << " ms avg / " << profile.maxMilliseconds << " ms max"
+         << " over the last " << min<UINT64>( profile.frames, Profiler::SUMMARY_FRAMES ) << " frames"
+         << ", dropped events " << profile.droppedEvents << " (press P to write profile.json)" << endl;
+    for (const Profiler::ZoneStatistics& zone : profile.zones)
+    {
+        cout << "  " << string( zone.depth * 2, ' ' ) << zone.name
+             << ": " << zone.averageMilliseconds << " ms avg / " << zone.maxMilliseconds << " ms max"
+             << ", " << zone.calls << " calls last frame" << endl;
+    }
 
-    RenderShadowPass();
-    RenderForwardPass();
+    const GpuTimer::Statistics& gpuStats = m_pGpuTimer->GetStatistics();
+    cout << "GPU timing"
+         << ": frame " << gpuStats.lastMilliseconds << " ms"
+         << ", read " << gpuStats.readFrames << " / " << gpuStats.frames << " frames"
+         << ", latency " << gpuStats.lastLatency << " frames (max " << gpuStats.maxLatency << ")"
+         << ", skipped " << gpuStats.skippedFrames << ", dropped zones " << gpuStats.droppedZones
+         << ", failed reads " << gpuStats.failedReads << endl;
+
+    const FrameArena::Statistics& arenaStats = m_pFrameArena->GetStatistics();
+    cout << "Frame arena"
+         << ": " << arenaStats.frameBytes << " bytes last frame, peak " << arenaStats.peakBytes << " of " << arenaStats.capacity
+         << ", overflow " << arenaStats.overflowAllocations << " allocations / " << arenaStats.overflowBytes << " bytes"
+         << ", grown " << arenaStats.grows << " times" << endl;
+
+    const BufferSuballocator::Statistics geometryStats = m_pGeometryHeap->GetAllocator().GetStatistics();
+    cout << "Geometry heap"
+         << ": " << geometryStats.allocations << " buffers, " << geometryStats.requestedBytes << " bytes in " << geometryStats.usedBytes
+         << " of " << geometryStats.blockBytes << " (" << geometryStats.blocks << " blocks)"
+         << ", fragmentation " << geometryStats.GetFragmentation() * 100.0 << "%"
+         << ", moved " << geometryStats.moves << " buffers / " << geometryStats.movedBytes << " bytes"
+         << ", failures " << geometryStats.failures << endl;
+
+    // Frame time in 1 ms buckets up to two 60 Hz frames
+    m_frameStatistics.WriteReport( cout );
+    m_frameStatistics.WriteHistogram( cout, FrameStatistics::METRIC_CPU_TIME, 1.0, 34 );
+
+    MemoryTracker::GetInstance().WriteReport( cout );
+
+    const DescriptorAllocator::Statistics& descStats = m_pDescHeap->GetStatistics();
+    cout << "Descriptor heap"
+         << ": persistent " << descStats.persistentUsed << " (peak " << descStats.persistentPeak << ")"
+         << ", transient peak " << descStats.transientPeak
+         << ", failures " << descStats.failures << endl;
+
+    const PipelineCache::Statistics& cacheStats = m_pPipelineCache->GetStatistics();
+    cout << "Pipeline cache"
+         << ": root signature " << cacheStats.rootSignatureHits << " hits / " << cacheStats.rootSignatureMisses << " misses"
+         << ", pipeline state " << cacheStats.pipelineStateHits << " hits / " << cacheStats.pipelineStateMisses << " misses"
+         << ", " << cacheStats.collisions << " hash collisions"
+         << ", shader " << cacheStats.shaderHits << " hits / " << cacheStats.shaderLoads << " loads" << endl;
+
+    // Creation time is what the main thread would have stalled for had the passes created their pipelines themselves
+    const PipelineCompiler::Statistics& compilerStats = m_pPipelineCache->GetCompilerStatistics();
+    cout << "Pipeline compiler"
+         << ": " << compilerStats.published << " / " << compilerStats.requests << " created in the background"
+         << ", " << m_pPipelineCache->GetPendingCount() << " pending, " << compilerStats.failures << " failed"
+         << ", main thread stall removed " << compilerStats.compileMilliseconds << " ms (max " << compilerStats.maxCompileMilliseconds << " ms)"
+         << ", available after " << compilerStats.maxLatencyFrames << " frames at most"
+         << ", " << m_fallbackFrames << " frames with fallbacks" << endl;
+
+    const ShaderCache::Statistics& shaderStats = m_pPipelineCache->GetShaderCache()->GetStatistics();
+    cout << "Shader cache"
+         << ": " << shaderStats.hits << " hits / " << shaderStats.misses << " misses / " << shaderStats.failures << " failures"
+         << ", cold " << shaderStats.coldMilliseconds << " ms, warm " << shaderStats.warmMilliseconds << " ms" << endl;
+
+    // Density of each fitted box against a fixed box over the whole atlas, and the tile size that would match the fixed one
+    const RenderPassShadow::CacheStatistics& shadowCacheStats = m_pRenderPassShadow->GetCacheStatistics();
+    cout << "Shadow cache"
+         << ": " << shadowCacheStats.passes << " shadow passes / " << shadowCacheStats.frames << " frames"
+         << ", " << shadowCacheStats.cascadeRenders << " cascade renders" << endl;
+
+    const RenderPassShadow::CascadeStatistics& cascadeStats = m_pRenderPassShadow->GetCascadeStatistics();
+    const Light::ResLightData& lightData = m_pLight->GetBufferData();
+    const float fixedTexelsPerUnit = m_shadowSize.x / Light::DEFAULT_SHADOW_EXTENT;
+    cout << "Shadow cascades"
+         << ": " << cascadeStats.cascadeCount << " in a " << m_shadowSize.x << "^2 atlas"
+         << ", recorded in " << cascadeStats.recordMilliseconds << " ms" << endl;
+    for (int i = 0; i < cascadeStats.cascadeCount; ++i)
+    {
+        const ShadowFrustum::Result& frustum = m_pLight->GetShadowFrustum( i );
+        const float splits[] = { lightData.cascadeSplits.x, lightData.cascadeSplits.y, lightData.cascadeSplits.z, lightData.cascadeSplits.w };
+        cout << "  Cascade " << i
+             << ": far " << (i + 1 < cascadeStats.cascadeCount ? splits[i] : 0.0f)
+             << (cascadeStats.rendered[i] ? ", rendered" : ", cached")
+             << ", casters " << cascadeStats.casters[i] << " (culled " << cascadeStats.culled[i] << ")"
+             << ", extent " << frustum.extent << ", depth range " << frustum.depthRange
+             << ", " << frustum.texelsPerUnit << " texels/unit (fixed box " << fixedTexelsPerUnit << ")"
+             << ", fixed box density with " << ShadowFrustum::GetResolutionForDensity( frustum.extent, fixedTexelsPerUnit ) << "^2"
+             << (frustum.bFitted ? "" : ", camera sees no receivers") << endl;
+    }
 
-    Present( 1 );
+    const LightClusters::Statistics& clusterStats = m_pLightClusters->GetClusters().GetStatistics();
+    const LightClusters::Config&     clusterConfig = m_pLightClusters->GetClusters().GetConfig();
+    cout << "Light clusters"
+         << ": " << clusterConfig.tilesX << "x" << clusterConfig.tilesY << "x" << clusterConfig.slices << " grid"
+         << ", lights " << clusterStats.visibleLights << " visible / " << clusterStats.lights
+         << ", indices " << clusterStats.indices << ", max per cluster " << clusterStats.maxClusterLights
+         << ", built in " << clusterStats.milliseconds << " ms on " << clusterStats.threads << " threads"
+         << ", builds " << m_pLightClusters->GetBuildCount() << endl;
+
+    const UploadRingAllocator::Statistics& ringStats = m_pUploadRing->GetAllocator().GetStatistics();
+    cout << "Upload ring"
+         << ": " << ringStats.lastFrameBytes << " bytes/frame"
+         << ", in use " << ringStats.usedBytes << " (high water " << ringStats.highWaterBytes << ")"
+         << ", allocations " << ringStats.allocations << ", reuses " << ringStats.reuses
+         << ", failures " << ringStats.failures << endl;
 }
 
 void App::RenderShadowPass()
 {
+    PROFILE_SCOPE( "RenderShadowPass" );
+
     RenderContext::ConstructParams params;
 
     D3D12_VIEWPORT& vp = params.viewport;
@@ -451,12 +846,15 @@ void App::RenderShadowPass()
 
     params.bDSOnly = true;
 
-    m_pRenderPassClearShadow->Clear( params );
+    // The pass clears and re-renders only the cascades whose box or casters changed, and sorts each
+    // cascade's casters front-to-back from the near plane of its box
     m_pRenderPassShadow->Draw( params );
 }
 
 void App::RenderForwardPass()
 {
+    PROFILE_SCOPE( "RenderForwardPass" );
+
     RenderContext::ConstructParams params;
 
     params.viewport = m_viewport;
@@ -469,23 +867,69 @@ void App::RenderForwardPass()
     params.targetStateSrc = D3D12_RESOURCE_STATE_PRESENT;
     params.targetStateDst = D3D12_RESOURCE_STATE_RENDER_TARGET;
 
+    // Opaque geometry front-to-back from the camera, within the camera's far plane
+    m_pRenderPassForward->SetSortView( m_pCamera->GetPosition(), m_pCamera->GetLookDir(), 100.0f );
+
     m_pRenderPassClear->Clear( params );
     m_pRenderPassForward->Draw( params );
 }
 
 void App::UpdateGPUBuffers()
 {
-    if (m_bUpdateCB == false)
-        return;
+    PROFILE_SCOPE( "UpdateGPUBuffers" );
+
+    // The cascade boxes follow the camera, snapped to texels so they do not shimmer
+    m_pLight->FitShadowFrustum( m_pCamera.get(), m_pScene->GetBounds(), static_cast<UINT>(m_shadowSize.x) );
 
-    m_pCamera->UpdateGPUBuffer();
+    // Lights are rebinned only when the camera, the window or the lights changed
+    m_pLightClusters->Build( *m_pCamera, static_cast<UINT>(m_width), static_cast<UINT>(m_height) );
 
-    m_bUpdateCB = false;
+    // Nodes only rewrite constants that changed, clean ones keep their previous ring copy
+    for (auto& pNode : m_pScene->GetRootNode()->GetChildren())
+    {
+        pNode->UpdateGPUBuffer( m_pUploadRing->GetAllocator() );
+    }
 }
 
 void App::ResetFrame()
 {
-    m_pRenderPassClearShadow->Reset();
+    PROFILE_SCOPE( "ResetFrame" );
+
+    m_pUploadRing->GetAllocator().Reclaim( m_pFence->GetCompletedValue() );
+
+    // A little geometry is compacted every frame, before the passes make their views
+    const UINT64 GEOMETRY_DEFRAGMENT_BYTES = 256 * 1024;
+    BufferSuballocator& geometry = m_pGeometryHeap->GetAllocator();
+    geometry.Reclaim( m_pFence->GetCompletedValue() );
+    geometry.Defragment( GEOMETRY_DEFRAGMENT_BYTES );
+
+    // Pass times of finished frames go into this frame's profile
+    m_pGpuTimer->Update( m_pFence->GetCompletedValue() );
+
+    m_pDescHeap->Reclaim( m_pFence->GetCompletedValue() );
+
+    // Pipelines created in the background since the last frame replace the fallbacks for the whole of this one
+    if (m_pPipelineCache->Update() > 0)
+    {
+        m_pRenderPassForward->UpdatePipelineStates( m_pDevice.Get() );
+        m_pRenderPassShadow->UpdatePipelineStates( m_pDevice.Get() );
+    }
+
+    // Frames keep coming while pipelines are pending, so the last one shows up without further input
+    const bool bCompilingPipelines = m_pPipelineCache->GetPendingCount() > 0;
+    if (bCompilingPipelines != m_bCompilingPipelines)
+    {
+        if (bCompilingPipelines)
+            m_scheduler.BeginWork();
+        else
+            m_scheduler.EndWork();
+
+        m_bCompilingPipelines = bCompilingPipelines;
+    }
+
+    // The frame before last has finished on the GPU, so its draw lists are free again
+    m_pFrameArena->BeginFrame();
+
     m_pRenderPassShadow->Reset();
     m_pRenderPassClear->Reset();
     m_pRenderPassForward->Reset();
@@ -493,6 +937,8 @@ void App::ResetFrame()
 
 void App::WaitDrawCommandDone()
 {
+    PROFILE_SCOPE( "WaitDrawCommandDone" );
+
     const UINT64 nextFenceValue = m_fenceValue;
 
     // set target fence value 
@@ -510,110 +956,81 @@ void App::WaitDrawCommandDone()
 
 void App::ProcessInput()
 {
-    m_inputManager->ProcessKeyboard();
+    PROFILE_SCOPE( "ProcessInput" );
 
-    m_inputManager->ProcessMouse();
+    m_inputManager->ProcessKeyboard();
 
-    // Rotating
-    if (m_inputManager->IsPressed( InputManager::MOUSE_BUTTON_LEFT)   ||
-        m_inputManager->IsPressing( InputManager::MOUSE_BUTTON_LEFT ) )
+    if (m_inputManager->IsKeyPressed( DIK_P ))
     {
-        float dx = static_cast<float>(m_inputManager->GetMouseState().lX);
-        float dy = static_cast<float>(m_inputManager->GetMouseState().lY);
-
-        Vec3f d( dx, -dy, 0.0f );
-        if (d.norm() == 0.0f)
-            return;
-
-        // update camera position
-        m_pCamera->GetPoseMatrix().Inverse().Transform( d );
-
-        Vec3f lookAtDir = Vec3f::ZAXIS;
-        Mat33f rotMat = m_pCamera->GetPoseMatrix().Inverse();
-        rotMat.Transform( lookAtDir );
-        lookAtDir.normalized();
-
-        Vec3f rotAxis = Vec3f::cross( d, lookAtDir );
-        float rotSpeed = 1.0f / 50.0f;
-        float rot = rotAxis.norm() * rotSpeed;
-        rotAxis.normalized();
-
-        Quatf q( rot, rotAxis);
-        Vec3f newPosition = m_pCamera->GetPosition();
-        q.Rotate( newPosition );
+        if (Profiler::WriteChromeTrace( "profile.json" ))
+            cout << "Profile written to profile.json" << endl;
+        else
+            Log::Output( Log::LOG_LEVEL_ERROR, "App::ProcessInput() Failed to write profile.json." );
+    }
 
-        // update camera pose
-        Vec3f targetDir = m_pCamera->GetLookAt() - newPosition;
-        targetDir.normalized();
+    m_inputManager->ProcessMouse();
 
-        Vec3f cameraRotAxis = Vec3f::cross( lookAtDir, targetDir );
-        cameraRotAxis.normalized();
-        float theta = acos( Vec3f::dot( targetDir, lookAtDir ) );
-        
-        q = Quatf( theta, cameraRotAxis);
-        Mat33f newPose = m_pCamera->GetPoseMatrix() * q.GetRotationMatrix();
+    OrbitCamera::State camera;
+    memcpy( camera.pose, &m_pCamera->GetPoseMatrix(), sizeof( camera.pose ) );
+    memcpy( camera.position, &m_pCamera->GetPosition(), sizeof( camera.position ) );
+    memcpy( camera.lookAt, &m_pCamera->GetLookAt(), sizeof( camera.lookAt ) );
 
-        m_pCamera->SetPosition( newPosition );
-        m_pCamera->SetPoseMatrix( newPose );
+    const float dx = static_cast<float>(m_inputManager->GetMouseState().lX);
+    const float dy = static_cast<float>(m_inputManager->GetMouseState().lY);
+    const float dz = static_cast<float>(m_inputManager->GetMouseState().lZ);
 
-        Mat44f viewMatrix = Mat44f( newPose, newPosition );
-        m_pCamera->SetViewMatrix( viewMatrix.Inverse() );
+    bool bMoved = false;
 
-        m_bUpdateCB = true;
+    // Rotating
+    if (m_inputManager->IsPressed( InputManager::MOUSE_BUTTON_LEFT)   ||
+        m_inputManager->IsPressing( InputManager::MOUSE_BUTTON_LEFT ) )
+    {
+        bMoved |= OrbitCamera::Rotate( camera, dx, dy );
     }
 
     // Translating screen
     if (m_inputManager->IsPressed( InputManager::MOUSE_BUTTON_CENTER ) ||
         m_inputManager->IsPressing( InputManager::MOUSE_BUTTON_CENTER ))
     {
-        float dx = static_cast<float>(m_inputManager->GetMouseState().lX);
-        float dy = static_cast<float>(m_inputManager->GetMouseState().lY);
-
-        Vec3f d( -dx, dy, 0.0f );
-        if (d.norm() == 0.0f)
-            return;
-
-        // update camera positio
-        m_pCamera->GetPoseMatrix().Inverse().Transform( d );
-        float transSpeed = 1.0f / 100.0f;
-        d *= transSpeed;
-
-        Vec3f newPos = m_pCamera->GetPosition() + d;
-        Vec3f newLookAt = m_pCamera->GetLookAt() + d;
-
-        m_pCamera->SetPosition( newPos );
-        m_pCamera->SetLookAt( newLookAt );
-
-        Mat44f viewMatrix = Mat44f( m_pCamera->GetPoseMatrix(), newPos );
-        m_pCamera->SetViewMatrix( viewMatrix.Inverse() );
-
-        m_bUpdateCB = true;
+        bMoved |= OrbitCamera::Translate( camera, dx, dy );
     }
 
     // Zoom in/out
-    if (m_inputManager->GetMouseState().lZ != 0.0f)
+    bMoved |= OrbitCamera::Zoom( camera, dz );
+
+    if (bMoved)
+        UpdateViewMatrix( camera );
+}
+
+void App::UpdateViewMatrix( const OrbitCamera::State& camera )
+{
+    Mat44f viewMatrix;
+    if (!OrbitCamera::GetViewMatrix( camera, reinterpret_cast<float*>(&viewMatrix) ))
     {
-        float zoomSpeed = 1.0f / 100.0f;
-        float dz = m_inputManager->GetMouseState().lZ * zoomSpeed;
+        Log::Output( Log::LOG_LEVEL_ERROR, "App::UpdateViewMatrix() Camera pose is singular." );
+        return;
+    }
 
-        // update camera position
-        Vec3f dir = m_pCamera->GetLookDir();
-        Vec3f newPos = m_pCamera->GetPosition() + dz * dir;
+    const Mat33f& pose     = *reinterpret_cast<const Mat33f*>(camera.pose);
+    const Vec3f&  position = *reinterpret_cast<const Vec3f*>(camera.position);
 
-        Vec3f tmpDir = Vec3f::normalize( m_pCamera->GetLookAt() - newPos );
-        if (Vec3f::dot( dir, tmpDir ) < 0.0f)
-        {
-            newPos = m_pCamera->GetLookAt() - dir * 0.001f;
-        }
-        else
+#if defined(DEBUG) || defined(_DEBUG)
+    // Must agree with the general inverse of acLib
+    const Mat44f reference = Mat44f( pose, position ).Inverse();
+    const float* pResult    = reinterpret_cast<const float*>(&viewMatrix);
+    const float* pReference = reinterpret_cast<const float*>(&reference);
+    for (int i = 0; i < 16; ++i)
+    {
+        if (fabs( pResult[i] - pReference[i] ) > 1e-3f * (1.0f + fabs( pReference[i] )))
         {
-            newPos = m_pCamera->GetPosition() + dz * dir;
+            Log::Output( Log::LOG_LEVEL_ERROR, "App::UpdateViewMatrix() Affine inverse differs from Mat44f::Inverse()." );
+            break;
         }
-
-        m_pCamera->SetPosition( newPos );
-        Mat44f viewMatrix = Mat44f( m_pCamera->GetPoseMatrix(), newPos );
-        m_pCamera->SetViewMatrix( viewMatrix.Inverse() );
-
-        m_bUpdateCB = true;
     }
+#endif
+
+    m_pCamera->SetPosition( position );
+    m_pCamera->SetLookAt( *reinterpret_cast<const Vec3f*>(camera.lookAt) );
+    m_pCamera->SetPoseMatrix( pose );
+    m_pCamera->SetViewMatrix( viewMatrix );
 }
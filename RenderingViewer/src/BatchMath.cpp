@@ -0,0 +1,860 @@
+#include "BatchMath.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BATCH_MATH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled into every x86 build and only runs when the processor reports it
+#if BATCH_MATH_SSE2 && (defined(_MSC_VER) || defined(__GNUC__))
+#define BATCH_MATH_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BATCH_MATH_AVX2_TARGET
+#else
+#define BATCH_MATH_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+    typedef BatchMath::PATH PATH;
+
+    bool IsAVX2Supported()
+    {
+#if BATCH_MATH_AVX2 && defined(_MSC_VER)
+        int info[4];
+        __cpuid( info, 0 );
+        if (info[0] < 7)
+            return false;
+
+        // The OS has to save the YMM registers as well
+        __cpuid( info, 1 );
+        const bool bOSXSave = (info[2] & (1 << 27)) != 0;
+        const bool bAVX     = (info[2] & (1 << 28)) != 0;
+        if (!bOSXSave || !bAVX || (_xgetbv( 0 ) & 6) != 6)
+            return false;
+
+        __cpuidex( info, 7, 0 );
+        return (info[1] & (1 << 5)) != 0;
+#elif BATCH_MATH_AVX2
+        __builtin_cpu_init();
+        return __builtin_cpu_supports( "avx2" ) != 0;
+#else
+        return false;
+#endif
+    }
+
+    PATH Resolve( PATH path )
+    {
+        const PATH best = BatchMath::GetBestPath();
+        return path > best ? best : path;
+    }
+
+    //---------------------------------------------------------------------------------------------
+    // Scalar path. The SIMD paths below repeat these operations in the same order.
+    //---------------------------------------------------------------------------------------------
+
+    void MultiplyScalar( const float a[16], const float b[16], float out[16] )
+    {
+        float result[16];
+        for (int column = 0; column < 4; ++column)
+        {
+            for (int row = 0; row < 4; ++row)
+            {
+                float sum = a[row] * b[column * 4];
+                sum = sum + a[4 + row] * b[column * 4 + 1];
+                sum = sum + a[8 + row] * b[column * 4 + 2];
+                sum = sum + a[12 + row] * b[column * 4 + 3];
+                result[column * 4 + row] = sum;
+            }
+        }
+
+        memcpy( out, result, sizeof( result ) );
+    }
+
+    // Rows of the inverse 3x3 part are the cross products of the columns divided by the determinant
+    bool InvertAffineScalar( const float m[16], float out[16] )
+    {
+        const float* c0 = &m[0];
+        const float* c1 = &m[4];
+        const float* c2 = &m[8];
+        const float  t[3] = { m[12], m[13], m[14] };
+
+        float rows[3][3] = {
+            { c1[1] * c2[2] - c1[2] * c2[1], c1[2] * c2[0] - c1[0] * c2[2], c1[0] * c2[1] - c1[1] * c2[0] },
+            { c2[1] * c0[2] - c2[2] * c0[1], c2[2] * c0[0] - c2[0] * c0[2], c2[0] * c0[1] - c2[1] * c0[0] },
+            { c0[1] * c1[2] - c0[2] * c1[1], c0[2] * c1[0] - c0[0] * c1[2], c0[0] * c1[1] - c0[1] * c1[0] },
+        };
+
+        const float determinant = (c0[0] * rows[0][0] + c0[1] * rows[0][1]) + c0[2] * rows[0][2];
+        const float inverse     = 1.0f / determinant;
+
+        float result[16];
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                rows[i][j] = rows[i][j] * inverse;
+                result[j * 4 + i] = rows[i][j];
+            }
+            result[i * 4 + 3] = 0.0f;
+            result[12 + i]    = -((rows[i][0] * t[0] + rows[i][1] * t[1]) + rows[i][2] * t[2]);
+        }
+        result[15] = 1.0f;
+
+        memcpy( out, result, sizeof( result ) );
+
+        return determinant != 0.0f;
+    }
+
+    void TransformPointsScalar( const float m[16], const float* x, const float* y, const float* z, size_t begin, size_t end,
+                                float* outX, float* outY, float* outZ )
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const float px = x[i];
+            const float py = y[i];
+            const float pz = z[i];
+            outX[i] = ((m[0] * px + m[4] * py) + m[8] * pz) + m[12];
+            outY[i] = ((m[1] * px + m[5] * py) + m[9] * pz) + m[13];
+            outZ[i] = ((m[2] * px + m[6] * py) + m[10] * pz) + m[14];
+        }
+    }
+
+    // Each output axis takes the smaller and the larger product per input axis
+    void TransformBoxesScalar( const float m[16], const BatchMath::ConstBoxes& boxes, size_t begin, size_t end, const BatchMath::Boxes& out )
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            float lo[3];
+            float hi[3];
+            for (int row = 0; row < 3; ++row)
+            {
+                lo[row] = m[12 + row];
+                hi[row] = m[12 + row];
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    const float a = m[axis * 4 + row] * boxes.min[axis][i];
+                    const float b = m[axis * 4 + row] * boxes.max[axis][i];
+                    lo[row] = lo[row] + (a < b ? a : b);
+                    hi[row] = hi[row] + (a > b ? a : b);
+                }
+            }
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                out.min[axis][i] = lo[axis];
+                out.max[axis][i] = hi[axis];
+            }
+        }
+    }
+
+    size_t TestSpheresScalar( const float* planes, uint32_t planeCount, const float* x, const float* y, const float* z, const float* radius,
+                              size_t begin, size_t end, uint8_t* pVisible )
+    {
+        size_t visibleCount = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            bool bVisible = true;
+            for (uint32_t p = 0; p < planeCount; ++p)
+            {
+                const float* plane = &planes[p * 4];
+                const float distance = ((plane[0] * x[i] + plane[1] * y[i]) + plane[2] * z[i]) + plane[3];
+                bVisible = bVisible && distance >= -radius[i];
+            }
+
+            pVisible[i] = bVisible ? 1 : 0;
+            visibleCount += bVisible ? 1 : 0;
+        }
+
+        return visibleCount;
+    }
+
+    // The corner furthest along the plane normal decides
+    size_t TestBoxesScalar( const float* planes, uint32_t planeCount, const BatchMath::ConstBoxes& boxes, size_t begin, size_t end, uint8_t* pVisible )
+    {
+        size_t visibleCount = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            bool bVisible = true;
+            for (uint32_t p = 0; p < planeCount; ++p)
+            {
+                const float* plane = &planes[p * 4];
+                const float vx = plane[0] >= 0.0f ? boxes.max[0][i] : boxes.min[0][i];
+                const float vy = plane[1] >= 0.0f ? boxes.max[1][i] : boxes.min[1][i];
+                const float vz = plane[2] >= 0.0f ? boxes.max[2][i] : boxes.min[2][i];
+                bVisible = bVisible && ((plane[0] * vx + plane[1] * vy) + plane[2] * vz) + plane[3] >= 0.0f;
+            }
+
+            pVisible[i] = bVisible ? 1 : 0;
+            visibleCount += bVisible ? 1 : 0;
+        }
+
+        return visibleCount;
+    }
+
+#if BATCH_MATH_SSE2
+    //---------------------------------------------------------------------------------------------
+    // SSE2 path: one matrix or four points, boxes or spheres at a time
+    //---------------------------------------------------------------------------------------------
+
+    void MultiplySSE2( const float a[16], const float b[16], float out[16] )
+    {
+        const __m128 a0 = _mm_loadu_ps( &a[0] );
+        const __m128 a1 = _mm_loadu_ps( &a[4] );
+        const __m128 a2 = _mm_loadu_ps( &a[8] );
+        const __m128 a3 = _mm_loadu_ps( &a[12] );
+
+        __m128 columns[4];
+        for (int column = 0; column < 4; ++column)
+        {
+            __m128 sum = _mm_mul_ps( a0, _mm_set1_ps( b[column * 4] ) );
+            sum = _mm_add_ps( sum, _mm_mul_ps( a1, _mm_set1_ps( b[column * 4 + 1] ) ) );
+            sum = _mm_add_ps( sum, _mm_mul_ps( a2, _mm_set1_ps( b[column * 4 + 2] ) ) );
+            sum = _mm_add_ps( sum, _mm_mul_ps( a3, _mm_set1_ps( b[column * 4 + 3] ) ) );
+            columns[column] = sum;
+        }
+
+        for (int column = 0; column < 4; ++column)
+        {
+            _mm_storeu_ps( &out[column * 4], columns[column] );
+        }
+    }
+
+    // y z x and z x y lane orders for cross products
+    inline __m128 CrossSSE2( __m128 a, __m128 b )
+    {
+        const __m128 aYZX = _mm_shuffle_ps( a, a, _MM_SHUFFLE( 3, 0, 2, 1 ) );
+        const __m128 aZXY = _mm_shuffle_ps( a, a, _MM_SHUFFLE( 3, 1, 0, 2 ) );
+        const __m128 bYZX = _mm_shuffle_ps( b, b, _MM_SHUFFLE( 3, 0, 2, 1 ) );
+        const __m128 bZXY = _mm_shuffle_ps( b, b, _MM_SHUFFLE( 3, 1, 0, 2 ) );
+        return _mm_sub_ps( _mm_mul_ps( aYZX, bZXY ), _mm_mul_ps( aZXY, bYZX ) );
+    }
+
+    bool InvertAffineSSE2( const float m[16], float out[16] )
+    {
+        // w lanes of the columns are 0, so the cross products have 0 in w as well
+        const __m128 mask = _mm_castsi128_ps( _mm_set_epi32( 0, -1, -1, -1 ) );
+        const __m128 c0   = _mm_and_ps( _mm_loadu_ps( &m[0] ), mask );
+        const __m128 c1   = _mm_and_ps( _mm_loadu_ps( &m[4] ), mask );
+        const __m128 c2   = _mm_and_ps( _mm_loadu_ps( &m[8] ), mask );
+        const __m128 t    = _mm_loadu_ps( &m[12] );
+
+        __m128 r0 = CrossSSE2( c1, c2 );
+        __m128 r1 = CrossSSE2( c2, c0 );
+        __m128 r2 = CrossSSE2( c0, c1 );
+
+        const __m128 p = _mm_mul_ps( c0, r0 );
+        const __m128 determinant = _mm_add_ps( _mm_add_ps( _mm_shuffle_ps( p, p, _MM_SHUFFLE( 0, 0, 0, 0 ) ),
+                                                           _mm_shuffle_ps( p, p, _MM_SHUFFLE( 1, 1, 1, 1 ) ) ),
+                                               _mm_shuffle_ps( p, p, _MM_SHUFFLE( 2, 2, 2, 2 ) ) );
+        const __m128 inverse = _mm_div_ps( _mm_set1_ps( 1.0f ), determinant );
+
+        r0 = _mm_mul_ps( r0, inverse );
+        r1 = _mm_mul_ps( r1, inverse );
+        r2 = _mm_mul_ps( r2, inverse );
+
+        // Rows to columns
+        __m128 r3 = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+
+        __m128 translation = _mm_mul_ps( r0, _mm_shuffle_ps( t, t, _MM_SHUFFLE( 0, 0, 0, 0 ) ) );
+        translation = _mm_add_ps( translation, _mm_mul_ps( r1, _mm_shuffle_ps( t, t, _MM_SHUFFLE( 1, 1, 1, 1 ) ) ) );
+        translation = _mm_add_ps( translation, _mm_mul_ps( r2, _mm_shuffle_ps( t, t, _MM_SHUFFLE( 2, 2, 2, 2 ) ) ) );
+        translation = _mm_xor_ps( translation, _mm_set1_ps( -0.0f ) );
+
+        _mm_storeu_ps( &out[0], r0 );
+        _mm_storeu_ps( &out[4], r1 );
+        _mm_storeu_ps( &out[8], r2 );
+        _mm_storeu_ps( &out[12], translation );
+        out[15] = 1.0f;
+
+        return _mm_cvtss_f32( determinant ) != 0.0f;
+    }
+
+    size_t TransformPointsSSE2( const float m[16], const float* x, const float* y, const float* z, size_t count,
+                                float* outX, float* outY, float* outZ )
+    {
+        __m128 matrix[16];
+        for (int i = 0; i < 16; ++i)
+        {
+            matrix[i] = _mm_set1_ps( m[i] );
+        }
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 px = _mm_loadu_ps( &x[i] );
+            const __m128 py = _mm_loadu_ps( &y[i] );
+            const __m128 pz = _mm_loadu_ps( &z[i] );
+
+            __m128 result[3];
+            for (int row = 0; row < 3; ++row)
+            {
+                __m128 sum = _mm_add_ps( _mm_mul_ps( matrix[row], px ), _mm_mul_ps( matrix[4 + row], py ) );
+                sum = _mm_add_ps( sum, _mm_mul_ps( matrix[8 + row], pz ) );
+                result[row] = _mm_add_ps( sum, matrix[12 + row] );
+            }
+
+            _mm_storeu_ps( &outX[i], result[0] );
+            _mm_storeu_ps( &outY[i], result[1] );
+            _mm_storeu_ps( &outZ[i], result[2] );
+        }
+
+        return i;
+    }
+
+    size_t TransformBoxesSSE2( const float m[16], const BatchMath::ConstBoxes& boxes, size_t count, const BatchMath::Boxes& out )
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 lo[3];
+            __m128 hi[3];
+            for (int row = 0; row < 3; ++row)
+            {
+                lo[row] = _mm_set1_ps( m[12 + row] );
+                hi[row] = lo[row];
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    const __m128 element = _mm_set1_ps( m[axis * 4 + row] );
+                    const __m128 a = _mm_mul_ps( element, _mm_loadu_ps( &boxes.min[axis][i] ) );
+                    const __m128 b = _mm_mul_ps( element, _mm_loadu_ps( &boxes.max[axis][i] ) );
+                    lo[row] = _mm_add_ps( lo[row], _mm_min_ps( a, b ) );
+                    hi[row] = _mm_add_ps( hi[row], _mm_max_ps( a, b ) );
+                }
+            }
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                _mm_storeu_ps( &out.min[axis][i], lo[axis] );
+                _mm_storeu_ps( &out.max[axis][i], hi[axis] );
+            }
+        }
+
+        return i;
+    }
+
+    inline size_t StoreMaskSSE2( int mask, uint8_t* pVisible )
+    {
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            pVisible[lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+
+        return static_cast<size_t>(pVisible[0] + pVisible[1] + pVisible[2] + pVisible[3]);
+    }
+
+    size_t TestSpheresSSE2( const float* planes, uint32_t planeCount, const float* x, const float* y, const float* z, const float* radius,
+                            size_t count, uint8_t* pVisible, size_t& visibleCount )
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 px        = _mm_loadu_ps( &x[i] );
+            const __m128 py        = _mm_loadu_ps( &y[i] );
+            const __m128 pz        = _mm_loadu_ps( &z[i] );
+            const __m128 negRadius = _mm_xor_ps( _mm_loadu_ps( &radius[i] ), _mm_set1_ps( -0.0f ) );
+
+            __m128 visible = _mm_castsi128_ps( _mm_set1_epi32( -1 ) );
+            for (uint32_t p = 0; p < planeCount; ++p)
+            {
+                const float* plane = &planes[p * 4];
+                __m128 distance = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( plane[0] ), px ), _mm_mul_ps( _mm_set1_ps( plane[1] ), py ) );
+                distance = _mm_add_ps( distance, _mm_mul_ps( _mm_set1_ps( plane[2] ), pz ) );
+                distance = _mm_add_ps( distance, _mm_set1_ps( plane[3] ) );
+                visible  = _mm_and_ps( visible, _mm_cmpge_ps( distance, negRadius ) );
+            }
+
+            visibleCount += StoreMaskSSE2( _mm_movemask_ps( visible ), &pVisible[i] );
+        }
+
+        return i;
+    }
+
+    size_t TestBoxesSSE2( const float* planes, uint32_t planeCount, const BatchMath::ConstBoxes& boxes, size_t count, uint8_t* pVisible, size_t& visibleCount )
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 visible = _mm_castsi128_ps( _mm_set1_epi32( -1 ) );
+            for (uint32_t p = 0; p < planeCount; ++p)
+            {
+                const float* plane = &planes[p * 4];
+                const __m128 vx = _mm_loadu_ps( plane[0] >= 0.0f ? &boxes.max[0][i] : &boxes.min[0][i] );
+                const __m128 vy = _mm_loadu_ps( plane[1] >= 0.0f ? &boxes.max[1][i] : &boxes.min[1][i] );
+                const __m128 vz = _mm_loadu_ps( plane[2] >= 0.0f ? &boxes.max[2][i] : &boxes.min[2][i] );
+
+                __m128 distance = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( plane[0] ), vx ), _mm_mul_ps( _mm_set1_ps( plane[1] ), vy ) );
+                distance = _mm_add_ps( distance, _mm_mul_ps( _mm_set1_ps( plane[2] ), vz ) );
+                distance = _mm_add_ps( distance, _mm_set1_ps( plane[3] ) );
+                visible  = _mm_and_ps( visible, _mm_cmpge_ps( distance, _mm_setzero_ps() ) );
+            }
+
+            visibleCount += StoreMaskSSE2( _mm_movemask_ps( visible ), &pVisible[i] );
+        }
+
+        return i;
+    }
+#endif
+
+#if BATCH_MATH_AVX2
+    //---------------------------------------------------------------------------------------------
+    // AVX2 path: two matrices or eight points, boxes or spheres at a time
+    //---------------------------------------------------------------------------------------------
+
+    BATCH_MATH_AVX2_TARGET inline __m256 Load2( const float* pLow, const float* pHigh )
+    {
+        return _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( pLow ) ), _mm_loadu_ps( pHigh ), 1 );
+    }
+
+    BATCH_MATH_AVX2_TARGET inline void Store2( float* pLow, float* pHigh, __m256 value )
+    {
+        _mm_storeu_ps( pLow, _mm256_castps256_ps128( value ) );
+        _mm_storeu_ps( pHigh, _mm256_extractf128_ps( value, 1 ) );
+    }
+
+    // a * b for a pair of b matrices, two columns per register
+    BATCH_MATH_AVX2_TARGET void MultiplyAVX2( const float a[16], const float* b, float* out, size_t count )
+    {
+        __m256 columns[4];
+        for (int k = 0; k < 4; ++k)
+        {
+            columns[k] = _mm256_broadcast_ps( reinterpret_cast<const __m128*>(&a[k * 4]) );
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float* pB   = &b[i * 16];
+            float        result[16];
+            for (int column = 0; column < 4; column += 2)
+            {
+                const float* pLow  = &pB[column * 4];
+                const float* pHigh = &pB[(column + 1) * 4];
+
+                __m256 sum = _mm256_mul_ps( columns[0], _mm256_setr_ps( pLow[0], pLow[0], pLow[0], pLow[0], pHigh[0], pHigh[0], pHigh[0], pHigh[0] ) );
+                sum = _mm256_add_ps( sum, _mm256_mul_ps( columns[1], _mm256_setr_ps( pLow[1], pLow[1], pLow[1], pLow[1], pHigh[1], pHigh[1], pHigh[1], pHigh[1] ) ) );
+                sum = _mm256_add_ps( sum, _mm256_mul_ps( columns[2], _mm256_setr_ps( pLow[2], pLow[2], pLow[2], pLow[2], pHigh[2], pHigh[2], pHigh[2], pHigh[2] ) ) );
+                sum = _mm256_add_ps( sum, _mm256_mul_ps( columns[3], _mm256_setr_ps( pLow[3], pLow[3], pLow[3], pLow[3], pHigh[3], pHigh[3], pHigh[3], pHigh[3] ) ) );
+                _mm256_storeu_ps( &result[column * 4], sum );
+            }
+
+            memcpy( &out[i * 16], result, sizeof( result ) );
+        }
+
+        _mm256_zeroupper();
+    }
+
+    BATCH_MATH_AVX2_TARGET inline __m256 CrossAVX2( __m256 a, __m256 b )
+    {
+        const __m256 aYZX = _mm256_shuffle_ps( a, a, _MM_SHUFFLE( 3, 0, 2, 1 ) );
+        const __m256 aZXY = _mm256_shuffle_ps( a, a, _MM_SHUFFLE( 3, 1, 0, 2 ) );
+        const __m256 bYZX = _mm256_shuffle_ps( b, b, _MM_SHUFFLE( 3, 0, 2, 1 ) );
+        const __m256 bZXY = _mm256_shuffle_ps( b, b, _MM_SHUFFLE( 3, 1, 0, 2 ) );
+        return _mm256_sub_ps( _mm256_mul_ps( aYZX, bZXY ), _mm256_mul_ps( aZXY, bYZX ) );
+    }
+
+    // Same steps as InvertAffineSSE2 with one matrix in each 128-bit lane
+    BATCH_MATH_AVX2_TARGET size_t InvertAffineAVX2( const float* m, float* out, size_t count, size_t& singularCount )
+    {
+        const __m256 mask = _mm256_castsi256_ps( _mm256_setr_epi32( -1, -1, -1, 0, -1, -1, -1, 0 ) );
+
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            const float* pLow  = &m[i * 16];
+            const float* pHigh = &m[(i + 1) * 16];
+
+            const __m256 c0 = _mm256_and_ps( Load2( &pLow[0], &pHigh[0] ), mask );
+            const __m256 c1 = _mm256_and_ps( Load2( &pLow[4], &pHigh[4] ), mask );
+            const __m256 c2 = _mm256_and_ps( Load2( &pLow[8], &pHigh[8] ), mask );
+            const __m256 t  = Load2( &pLow[12], &pHigh[12] );
+
+            __m256 r0 = CrossAVX2( c1, c2 );
+            __m256 r1 = CrossAVX2( c2, c0 );
+            __m256 r2 = CrossAVX2( c0, c1 );
+
+            const __m256 p = _mm256_mul_ps( c0, r0 );
+            const __m256 determinant = _mm256_add_ps( _mm256_add_ps( _mm256_shuffle_ps( p, p, _MM_SHUFFLE( 0, 0, 0, 0 ) ),
+                                                                     _mm256_shuffle_ps( p, p, _MM_SHUFFLE( 1, 1, 1, 1 ) ) ),
+                                                      _mm256_shuffle_ps( p, p, _MM_SHUFFLE( 2, 2, 2, 2 ) ) );
+            const __m256 inverse = _mm256_div_ps( _mm256_set1_ps( 1.0f ), determinant );
+
+            r0 = _mm256_mul_ps( r0, inverse );
+            r1 = _mm256_mul_ps( r1, inverse );
+            r2 = _mm256_mul_ps( r2, inverse );
+
+            // Rows to columns within each lane, as _MM_TRANSPOSE4_PS does
+            const __m256 r3 = _mm256_setzero_ps();
+            const __m256 t0 = _mm256_unpacklo_ps( r0, r1 );
+            const __m256 t1 = _mm256_unpacklo_ps( r2, r3 );
+            const __m256 t2 = _mm256_unpackhi_ps( r0, r1 );
+            const __m256 t3 = _mm256_unpackhi_ps( r2, r3 );
+            const __m256 column0 = _mm256_shuffle_ps( t0, t1, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+            const __m256 column1 = _mm256_shuffle_ps( t0, t1, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+            const __m256 column2 = _mm256_shuffle_ps( t2, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+
+            __m256 translation = _mm256_mul_ps( column0, _mm256_shuffle_ps( t, t, _MM_SHUFFLE( 0, 0, 0, 0 ) ) );
+            translation = _mm256_add_ps( translation, _mm256_mul_ps( column1, _mm256_shuffle_ps( t, t, _MM_SHUFFLE( 1, 1, 1, 1 ) ) ) );
+            translation = _mm256_add_ps( translation, _mm256_mul_ps( column2, _mm256_shuffle_ps( t, t, _MM_SHUFFLE( 2, 2, 2, 2 ) ) ) );
+            translation = _mm256_xor_ps( translation, _mm256_set1_ps( -0.0f ) );
+
+            float* pOutLow  = &out[i * 16];
+            float* pOutHigh = &out[(i + 1) * 16];
+            Store2( &pOutLow[0], &pOutHigh[0], column0 );
+            Store2( &pOutLow[4], &pOutHigh[4], column1 );
+            Store2( &pOutLow[8], &pOutHigh[8], column2 );
+            Store2( &pOutLow[12], &pOutHigh[12], translation );
+            pOutLow[15]  = 1.0f;
+            pOutHigh[15] = 1.0f;
+
+            singularCount += _mm256_cvtss_f32( determinant ) == 0.0f ? 1 : 0;
+            singularCount += _mm_cvtss_f32( _mm256_extractf128_ps( determinant, 1 ) ) == 0.0f ? 1 : 0;
+        }
+
+        _mm256_zeroupper();
+
+        return i;
+    }
+
+    BATCH_MATH_AVX2_TARGET size_t TransformPointsAVX2( const float m[16], const float* x, const float* y, const float* z, size_t count,
+                                                       float* outX, float* outY, float* outZ )
+    {
+        __m256 matrix[16];
+        for (int i = 0; i < 16; ++i)
+        {
+            matrix[i] = _mm256_set1_ps( m[i] );
+        }
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256 px = _mm256_loadu_ps( &x[i] );
+            const __m256 py = _mm256_loadu_ps( &y[i] );
+            const __m256 pz = _mm256_loadu_ps( &z[i] );
+
+            __m256 result[3];
+            for (int row = 0; row < 3; ++row)
+            {
+                __m256 sum = _mm256_add_ps( _mm256_mul_ps( matrix[row], px ), _mm256_mul_ps( matrix[4 + row], py ) );
+                sum = _mm256_add_ps( sum, _mm256_mul_ps( matrix[8 + row], pz ) );
+                result[row] = _mm256_add_ps( sum, matrix[12 + row] );
+            }
+
+            _mm256_storeu_ps( &outX[i], result[0] );
+            _mm256_storeu_ps( &outY[i], result[1] );
+            _mm256_storeu_ps( &outZ[i], result[2] );
+        }
+
+        _mm256_zeroupper();
+
+        return i;
+    }
+
+    BATCH_MATH_AVX2_TARGET size_t TransformBoxesAVX2( const float m[16], const BatchMath::ConstBoxes& boxes, size_t count, const BatchMath::Boxes& out )
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 lo[3];
+            __m256 hi[3];
+            for (int row = 0; row < 3; ++row)
+            {
+                lo[row] = _mm256_set1_ps( m[12 + row] );
+                hi[row] = lo[row];
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    const __m256 element = _mm256_set1_ps( m[axis * 4 + row] );
+                    const __m256 a = _mm256_mul_ps( element, _mm256_loadu_ps( &boxes.min[axis][i] ) );
+                    const __m256 b = _mm256_mul_ps( element, _mm256_loadu_ps( &boxes.max[axis][i] ) );
+                    lo[row] = _mm256_add_ps( lo[row], _mm256_min_ps( a, b ) );
+                    hi[row] = _mm256_add_ps( hi[row], _mm256_max_ps( a, b ) );
+                }
+            }
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                _mm256_storeu_ps( &out.min[axis][i], lo[axis] );
+                _mm256_storeu_ps( &out.max[axis][i], hi[axis] );
+            }
+        }
+
+        _mm256_zeroupper();
+
+        return i;
+    }
+
+    BATCH_MATH_AVX2_TARGET inline size_t StoreMaskAVX2( __m256 visible, uint8_t* pVisible )
+    {
+        // Lane masks of -1 become bytes of 1
+        const __m256i bits  = _mm256_srli_epi32( _mm256_castps_si256( visible ), 31 );
+        const __m128i words = _mm_packs_epi32( _mm256_castsi256_si128( bits ), _mm256_extracti128_si256( bits, 1 ) );
+        const __m128i bytes = _mm_packus_epi16( words, words );
+        _mm_storel_epi64( reinterpret_cast<__m128i*>(pVisible), bytes );
+
+        return static_cast<size_t>(pVisible[0] + pVisible[1] + pVisible[2] + pVisible[3] + pVisible[4] + pVisible[5] + pVisible[6] + pVisible[7]);
+    }
+
+    BATCH_MATH_AVX2_TARGET size_t TestSpheresAVX2( const float* planes, uint32_t planeCount, const float* x, const float* y, const float* z, const float* radius,
+                                                   size_t count, uint8_t* pVisible, size_t& visibleCount )
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256 px        = _mm256_loadu_ps( &x[i] );
+            const __m256 py        = _mm256_loadu_ps( &y[i] );
+            const __m256 pz        = _mm256_loadu_ps( &z[i] );
+            const __m256 negRadius = _mm256_xor_ps( _mm256_loadu_ps( &radius[i] ), _mm256_set1_ps( -0.0f ) );
+
+            __m256 visible = _mm256_castsi256_ps( _mm256_set1_epi32( -1 ) );
+            for (uint32_t p = 0; p < planeCount; ++p)
+            {
+                const float* plane = &planes[p * 4];
+                __m256 distance = _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( plane[0] ), px ), _mm256_mul_ps( _mm256_set1_ps( plane[1] ), py ) );
+                distance = _mm256_add_ps( distance, _mm256_mul_ps( _mm256_set1_ps( plane[2] ), pz ) );
+                distance = _mm256_add_ps( distance, _mm256_set1_ps( plane[3] ) );
+                visible  = _mm256_and_ps( visible, _mm256_cmp_ps( distance, negRadius, _CMP_GE_OQ ) );
+            }
+
+            visibleCount += StoreMaskAVX2( visible, &pVisible[i] );
+        }
+
+        _mm256_zeroupper();
+
+        return i;
+    }
+
+    BATCH_MATH_AVX2_TARGET size_t TestBoxesAVX2( const float* planes, uint32_t planeCount, const BatchMath::ConstBoxes& boxes, size_t count,
+                                                 uint8_t* pVisible, size_t& visibleCount )
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 visible = _mm256_castsi256_ps( _mm256_set1_epi32( -1 ) );
+            for (uint32_t p = 0; p < planeCount; ++p)
+            {
+                const float* plane = &planes[p * 4];
+                const __m256 vx = _mm256_loadu_ps( plane[0] >= 0.0f ? &boxes.max[0][i] : &boxes.min[0][i] );
+                const __m256 vy = _mm256_loadu_ps( plane[1] >= 0.0f ? &boxes.max[1][i] : &boxes.min[1][i] );
+                const __m256 vz = _mm256_loadu_ps( plane[2] >= 0.0f ? &boxes.max[2][i] : &boxes.min[2][i] );
+
+                __m256 distance = _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( plane[0] ), vx ), _mm256_mul_ps( _mm256_set1_ps( plane[1] ), vy ) );
+                distance = _mm256_add_ps( distance, _mm256_mul_ps( _mm256_set1_ps( plane[2] ), vz ) );
+                distance = _mm256_add_ps( distance, _mm256_set1_ps( plane[3] ) );
+                visible  = _mm256_and_ps( visible, _mm256_cmp_ps( distance, _mm256_setzero_ps(), _CMP_GE_OQ ) );
+            }
+
+            visibleCount += StoreMaskAVX2( visible, &pVisible[i] );
+        }
+
+        _mm256_zeroupper();
+
+        return i;
+    }
+#endif
+}
+
+BatchMath::PATH BatchMath::GetBestPath()
+{
+    static const PATH best = []()
+    {
+        if (IsAVX2Supported())
+            return PATH_AVX2;
+#if BATCH_MATH_SSE2
+        return PATH_SSE2;
+#else
+        return PATH_SCALAR;
+#endif
+    }();
+
+    return best;
+}
+
+const char* BatchMath::GetPathName( PATH path )
+{
+    switch (Resolve( path ))
+    {
+    case PATH_AVX2: return "AVX2";
+    case PATH_SSE2: return "SSE2";
+    default:        return "scalar";
+    }
+}
+
+void BatchMath::Multiply( const float a[16], const float b[16], float out[16], PATH path )
+{
+    // One matrix does not fill the wider registers, AVX2 uses the SSE2 code
+#if BATCH_MATH_SSE2
+    if (Resolve( path ) != PATH_SCALAR)
+    {
+        MultiplySSE2( a, b, out );
+        return;
+    }
+#endif
+
+    MultiplyScalar( a, b, out );
+}
+
+void BatchMath::MultiplyArray( const float a[16], const float* b, float* out, size_t count, PATH path )
+{
+    path = Resolve( path );
+
+#if BATCH_MATH_AVX2
+    if (path == PATH_AVX2)
+    {
+        MultiplyAVX2( a, b, out, count );
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        Multiply( a, &b[i * 16], &out[i * 16], path );
+    }
+}
+
+bool BatchMath::InvertAffine( const float m[16], float out[16], PATH path )
+{
+#if BATCH_MATH_SSE2
+    if (Resolve( path ) != PATH_SCALAR)
+        return InvertAffineSSE2( m, out );
+#endif
+
+    return InvertAffineScalar( m, out );
+}
+
+size_t BatchMath::InvertAffineArray( const float* m, float* out, size_t count, PATH path )
+{
+    path = Resolve( path );
+
+    size_t singularCount = 0;
+    size_t i             = 0;
+
+#if BATCH_MATH_AVX2
+    if (path == PATH_AVX2)
+        i = InvertAffineAVX2( m, out, count, singularCount );
+#endif
+
+    for (; i < count; ++i)
+    {
+        singularCount += InvertAffine( &m[i * 16], &out[i * 16], path ) ? 0 : 1;
+    }
+
+    return singularCount;
+}
+
+void BatchMath::TransformPoints( const float m[16], const float* x, const float* y, const float* z, size_t count,
+                                 float* outX, float* outY, float* outZ, PATH path )
+{
+    path = Resolve( path );
+
+    size_t i = 0;
+
+#if BATCH_MATH_AVX2
+    if (path == PATH_AVX2)
+        i = TransformPointsAVX2( m, x, y, z, count, outX, outY, outZ );
+#endif
+#if BATCH_MATH_SSE2
+    if (path == PATH_SSE2)
+        i = TransformPointsSSE2( m, x, y, z, count, outX, outY, outZ );
+#endif
+
+    TransformPointsScalar( m, x, y, z, i, count, outX, outY, outZ );
+}
+
+void BatchMath::TransformBoxes( const float m[16], const ConstBoxes& boxes, size_t count, const Boxes& out, PATH path )
+{
+    path = Resolve( path );
+
+    size_t i = 0;
+
+#if BATCH_MATH_AVX2
+    if (path == PATH_AVX2)
+        i = TransformBoxesAVX2( m, boxes, count, out );
+#endif
+#if BATCH_MATH_SSE2
+    if (path == PATH_SSE2)
+        i = TransformBoxesSSE2( m, boxes, count, out );
+#endif
+
+    TransformBoxesScalar( m, boxes, i, count, out );
+}
+
+size_t BatchMath::TestSpheres( const float* planes, uint32_t planeCount, const float* x, const float* y, const float* z, const float* radius,
+                               size_t count, uint8_t* pVisible, PATH path )
+{
+    path = Resolve( path );
+
+    size_t visibleCount = 0;
+    size_t i            = 0;
+
+#if BATCH_MATH_AVX2
+    if (path == PATH_AVX2)
+        i = TestSpheresAVX2( planes, planeCount, x, y, z, radius, count, pVisible, visibleCount );
+#endif
+#if BATCH_MATH_SSE2
+    if (path == PATH_SSE2)
+        i = TestSpheresSSE2( planes, planeCount, x, y, z, radius, count, pVisible, visibleCount );
+#endif
+
+    return visibleCount + TestSpheresScalar( planes, planeCount, x, y, z, radius, i, count, pVisible );
+}
+
+size_t BatchMath::TestBoxes( const float* planes, uint32_t planeCount, const ConstBoxes& boxes, size_t count, uint8_t* pVisible, PATH path )
+{
+    path = Resolve( path );
+
+    size_t visibleCount = 0;
+    size_t i            = 0;
+
+#if BATCH_MATH_AVX2
+    if (path == PATH_AVX2)
+        i = TestBoxesAVX2( planes, planeCount, boxes, count, pVisible, visibleCount );
+#endif
+#if BATCH_MATH_SSE2
+    if (path == PATH_SSE2)
+        i = TestBoxesSSE2( planes, planeCount, boxes, count, pVisible, visibleCount );
+#endif
+
+    return visibleCount + TestBoxesScalar( planes, planeCount, boxes, i, count, pVisible );
+}
+
+void BatchMath::GetFrustumPlanes( const float viewProjection[16], float planes[24] )
+{
+    // Rows of the matrix; clip space has -w <= x, y <= w and 0 <= z <= w
+    float rows[4][4];
+    for (int row = 0; row < 4; ++row)
+    {
+        for (int column = 0; column < 4; ++column)
+        {
+            rows[row][column] = viewProjection[column * 4 + row];
+        }
+    }
+
+    for (int k = 0; k < 4; ++k)
+    {
+        planes[0 * 4 + k] = rows[3][k] + rows[0][k];
+        planes[1 * 4 + k] = rows[3][k] - rows[0][k];
+        planes[2 * 4 + k] = rows[3][k] + rows[1][k];
+        planes[3 * 4 + k] = rows[3][k] - rows[1][k];
+        planes[4 * 4 + k] = rows[2][k];
+        planes[5 * 4 + k] = rows[3][k] - rows[2][k];
+    }
+
+    for (int p = 0; p < 6; ++p)
+    {
+        float* plane = &planes[p * 4];
+        const float length = std::sqrt( plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2] );
+        if (length > 0.0f)
+        {
+            for (int k = 0; k < 4; ++k)
+            {
+                plane[k] /= length;
+            }
+        }
+    }
+}
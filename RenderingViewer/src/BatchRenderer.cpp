@@ -0,0 +1,484 @@
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    typedef chrono::steady_clock Clock;
+
+    double GetMilliseconds( Clock::time_point start )
+    {
+        return chrono::duration<double, milli>( Clock::now() - start ).count();
+    }
+
+    // Bounded FIFO between two pipeline stages. After Close(), Push() fails and Pop() fails once drained.
+    // The items are a ring allocated up front, so passing frames along never touches the heap.
+    template <typename T>
+    class StageQueue
+    {
+    public:
+        explicit StageQueue( size_t capacity )
+            : m_items( max<size_t>( capacity, 1 ) )
+            , m_first( 0 )
+            , m_count( 0 )
+            , m_bClosed( false )
+        {
+        }
+
+        bool Push( const T& value )
+        {
+            unique_lock<mutex> lock( m_mutex );
+            m_notFull.wait( lock, [&]() { return m_count < m_items.size() || m_bClosed; } );
+            if (m_bClosed)
+                return false;
+
+            m_items[(m_first + m_count) % m_items.size()] = value;
+            m_count++;
+            m_notEmpty.notify_one();
+            return true;
+        }
+
+        bool Pop( T& value )
+        {
+            unique_lock<mutex> lock( m_mutex );
+            m_notEmpty.wait( lock, [&]() { return m_count > 0 || m_bClosed; } );
+            if (m_count == 0)
+                return false;
+
+            value   = m_items[m_first];
+            m_first = (m_first + 1) % m_items.size();
+            m_count--;
+            m_notFull.notify_one();
+            return true;
+        }
+
+        void Close()
+        {
+            lock_guard<mutex> lock( m_mutex );
+            m_bClosed = true;
+            m_notFull.notify_all();
+            m_notEmpty.notify_all();
+        }
+
+    private:
+        mutex              m_mutex;
+        condition_variable m_notFull;
+        condition_variable m_notEmpty;
+        vector<T>          m_items;
+        size_t             m_first;
+        size_t             m_count;
+        bool               m_bClosed;
+    };
+
+    struct RenderedFrame
+    {
+        uint32_t index;
+        uint32_t target;
+    };
+
+    string CreateFramePath( const string& directory, uint32_t index )
+    {
+        ostringstream path;
+        if (!directory.empty())
+            path << directory << "/";
+        path << "frame_" << setw( 6 ) << setfill( '0' ) << index << ".ppm";
+        return path.str();
+    }
+}
+
+BatchRenderer::BatchRenderer()
+    : m_frameStatistics( STATISTICS_FRAMES )
+    , m_bRegressed( false )
+{
+}
+
+BatchRenderer::~BatchRenderer()
+{
+}
+
+bool BatchRenderer::ParseArguments( const vector<string>& args, Options& options )
+{
+    bool bBatch = false;
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+        const string& arg   = args[i];
+        const size_t  count = args.size() - i - 1;
+
+        if (arg == "--batch" && count >= 2)
+        {
+            options.cameraPath      = args[++i];
+            options.outputDirectory = args[++i];
+            bBatch = true;
+        }
+        else if (arg == "--size" && count >= 2)
+        {
+            options.width  = static_cast<UINT>(strtoul( args[++i].c_str(), nullptr, 10 ));
+            options.height = static_cast<UINT>(strtoul( args[++i].c_str(), nullptr, 10 ));
+        }
+        else if (arg == "--shadow-size" && count >= 1)
+            options.shadowMapSize = static_cast<UINT>(strtoul( args[++i].c_str(), nullptr, 10 ));
+        else if (arg == "--threads" && count >= 1)
+            options.threadCount = static_cast<uint32_t>(strtoul( args[++i].c_str(), nullptr, 10 ));
+        else if (arg == "--frames-in-flight" && count >= 1)
+            options.framesInFlight = static_cast<uint32_t>(strtoul( args[++i].c_str(), nullptr, 10 ));
+        else if (arg == "--model" && count >= 1)
+            options.modelPaths.push_back( args[++i] );
+        else if (arg == "--generate" && count >= 1)
+            options.generator.objectCount = static_cast<uint32_t>(strtoul( args[++i].c_str(), nullptr, 10 ));
+        else if (arg == "--seed" && count >= 1)
+            options.generator.seed = static_cast<uint32_t>(strtoul( args[++i].c_str(), nullptr, 10 ));
+        else if (arg == "--depth" && count >= 1)
+            options.generator.hierarchyDepth = static_cast<uint32_t>(strtoul( args[++i].c_str(), nullptr, 10 ));
+        else if (arg == "--instancing" && count >= 1)
+            options.generator.instanceRatio = strtof( args[++i].c_str(), nullptr );
+        else if (arg == "--segments" && count >= 2)
+        {
+            options.generator.minSegments = static_cast<uint32_t>(strtoul( args[++i].c_str(), nullptr, 10 ));
+            options.generator.maxSegments = static_cast<uint32_t>(strtoul( args[++i].c_str(), nullptr, 10 ));
+        }
+        else if (arg == "--distribution" && count >= 1)
+        {
+            const string name = args[++i];
+            for (int d = 0; d < SceneGenerator::DISTRIBUTION_NUM; ++d)
+            {
+                if (name == SceneGenerator::GetDistributionName( static_cast<SceneGenerator::DISTRIBUTION>(d) ))
+                    options.generator.distribution = static_cast<SceneGenerator::DISTRIBUTION>(d);
+            }
+        }
+        else if (arg == "--lights" && count >= 1)
+            options.generator.lightCount = static_cast<uint32_t>(strtoul( args[++i].c_str(), nullptr, 10 ));
+        else if (arg == "--scene" && count >= 1)
+            options.scenePath = args[++i];
+        else if (arg == "--baseline" && count >= 1)
+            options.baselinePath = args[++i];
+        else if (arg == "--write-baseline" && count >= 1)
+            options.writeBaselinePath = args[++i];
+        else if (arg == "--tolerance" && count >= 2)
+        {
+            options.tolerances.time.relative = strtod( args[++i].c_str(), nullptr );
+            options.tolerances.time.absolute = strtod( args[++i].c_str(), nullptr );
+        }
+        else if (arg == "--count-tolerance" && count >= 1)
+            options.tolerances.count.relative = strtod( args[++i].c_str(), nullptr );
+    }
+
+    return bBatch;
+}
+
+bool BatchRenderer::Run( const Options& options )
+{
+    m_statistics.Clear();
+    m_frameStatistics.Clear();
+    m_comparisons.clear();
+    m_bRegressed = false;
+
+    if (options.width == 0 || options.height == 0 || options.shadowMapSize == 0)
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "BatchRenderer::Run() Invalid target size." );
+        return false;
+    }
+
+    CameraPathReader reader;
+    if (!reader.Open( options.cameraPath ))
+    {
+        cerr << reader.GetError() << endl;
+        return false;
+    }
+
+    if (!options.outputDirectory.empty())
+        CreateDirectoryA( options.outputDirectory.c_str(), nullptr );
+
+    const Clock::time_point sceneStart = Clock::now();
+
+    if (!CreateScene( options ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "BatchRenderer::CreateScene() Failed." );
+        return false;
+    }
+
+    // The scene is static, so every view shares one shadow map
+    SoftwareRenderer renderer( options.threadCount );
+    if (!renderer.Prepare( m_pScene, options.shadowMapSize ))
+        return false;
+
+    m_statistics.sceneMilliseconds = GetMilliseconds( sceneStart );
+
+    const uint32_t framesInFlight = max( 1u, options.framesInFlight );
+
+    vector<SoftwareRasterizer::ColorTarget> targets( framesInFlight, SoftwareRasterizer::ColorTarget( options.width, options.height ) );
+
+    StageQueue<CameraPathReader::View> loadedViews( framesInFlight );
+    StageQueue<RenderedFrame>          renderedFrames( framesInFlight );
+    StageQueue<uint32_t>               freeTargets( framesInFlight );
+    for (uint32_t i = 0; i < framesInFlight; ++i)
+    {
+        freeTargets.Push( i );
+    }
+
+    // Each counter is written by its own stage only and read after the joins
+    double loadMilliseconds   = 0.0;
+    double encodeMilliseconds = 0.0;
+    bool   bEncodeFailed      = false;
+
+    const Clock::time_point start = Clock::now();
+
+    thread loader( [&]()
+    {
+        CameraPathReader::View view;
+        for (;;)
+        {
+            const Clock::time_point readStart = Clock::now();
+            const bool bRead = reader.Read( view );
+            loadMilliseconds += GetMilliseconds( readStart );
+
+            if (!bRead || !loadedViews.Push( view ))
+                break;
+        }
+
+        loadedViews.Close();
+    } );
+
+    thread encoder( [&]()
+    {
+        RenderedFrame frame;
+        while (renderedFrames.Pop( frame ))
+        {
+            const Clock::time_point encodeStart = Clock::now();
+            if (!SoftwareRasterizer::SaveColor( targets[frame.target], CreateFramePath( options.outputDirectory, frame.index ) ))
+                bEncodeFailed = true;
+            encodeMilliseconds += GetMilliseconds( encodeStart );
+
+            freeTargets.Push( frame.target );
+        }
+    } );
+
+    SoftwareRasterizer::TransformConstants transform = SoftwareRenderer::CreateTransform( Mat44f::IDENTITY, Mat44f::IDENTITY );
+
+    // The render stage's own work; stalls and encoding depend on the disk and are left out
+    const uint32_t setupPass  = m_frameStatistics.AddPass( "forward setup" );
+    const uint32_t rasterPass = m_frameStatistics.AddPass( "forward raster" );
+
+    bool bSucceeded = true;
+    for (;;)
+    {
+        const Clock::time_point stallStart = Clock::now();
+
+        CameraPathReader::View view;
+        uint32_t               target = 0;
+        if (!loadedViews.Pop( view ) || !freeTargets.Pop( target ))
+            break;
+
+        m_statistics.renderStallMilliseconds += GetMilliseconds( stallStart );
+
+        memcpy( transform.view, view.view, sizeof( transform.view ) );
+        memcpy( transform.projection, view.projection, sizeof( transform.projection ) );
+
+        // The loader and the encoder allocate for their files, so only this thread's allocations count
+        const AllocationCounter::Scope allocations;
+
+        const Clock::time_point renderStart = Clock::now();
+        if (!renderer.RenderView( transform, targets[target] ))
+        {
+            bSucceeded = false;
+            break;
+        }
+        const double renderMilliseconds = GetMilliseconds( renderStart );
+        m_statistics.renderMilliseconds += renderMilliseconds;
+
+        // The view's constants are all a GPU frame would upload; the scene was uploaded once
+        const SoftwareRasterizer::Statistics& forwardStats = renderer.GetForwardStatistics();
+        FrameStatistics::Frame frameStats;
+        frameStats.cpuMilliseconds              = renderMilliseconds;
+        frameStats.passMilliseconds[setupPass]  = forwardStats.setupMilliseconds;
+        frameStats.passMilliseconds[rasterPass] = forwardStats.rasterMilliseconds;
+        frameStats.draws                        = renderer.GetMeshCount();
+        frameStats.triangles                    = forwardStats.triangles;
+        frameStats.uploadBytes                  = sizeof( transform );
+        frameStats.allocations                  = allocations.GetThreadCount();
+        m_frameStatistics.AddFrame( frameStats );
+
+        RenderedFrame frame;
+        frame.index  = view.index;
+        frame.target = target;
+        renderedFrames.Push( frame );
+
+        m_statistics.frames++;
+    }
+
+    // Also releases the loader when rendering stopped early
+    loadedViews.Close();
+    renderedFrames.Close();
+
+    loader.join();
+    encoder.join();
+
+    m_statistics.wallMilliseconds   = GetMilliseconds( start );
+    m_statistics.loadMilliseconds   = loadMilliseconds;
+    m_statistics.encodeMilliseconds = encodeMilliseconds;
+
+    if (reader.HasError())
+    {
+        cerr << reader.GetError() << endl;
+        bSucceeded = false;
+    }
+
+    if (bEncodeFailed)
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "BatchRenderer::Run() Failed to write images." );
+        bSucceeded = false;
+    }
+
+    // A failed run is not the replay the baseline holds, so it is neither stored nor compared
+    if (bSucceeded)
+        bSucceeded = CompareBaseline( options );
+
+    return bSucceeded;
+}
+
+bool BatchRenderer::CompareBaseline( const Options& options )
+{
+    FrameBaseline current;
+    current.Capture( m_frameStatistics );
+
+    if (!options.writeBaselinePath.empty() && !current.Write( options.writeBaselinePath ))
+    {
+        cerr << current.GetError() << endl;
+        return false;
+    }
+
+    if (options.baselinePath.empty())
+        return true;
+
+    FrameBaseline baseline;
+    if (!baseline.Read( options.baselinePath ))
+    {
+        cerr << baseline.GetError() << endl;
+        return false;
+    }
+
+    // Percentiles over another number of frames come from another camera path
+    if (baseline.GetFrameCount() != current.GetFrameCount())
+    {
+        cerr << options.baselinePath << " holds " << baseline.GetFrameCount() << " frames, this replay " << current.GetFrameCount() << endl;
+        return false;
+    }
+
+    m_bRegressed = !baseline.Compare( current, options.tolerances, m_comparisons );
+    if (m_bRegressed)
+        Log::Output( Log::LOG_LEVEL_ERROR, "BatchRenderer::CompareBaseline() Frames regressed against the baseline." );
+
+    return !m_bRegressed;
+}
+
+void BatchRenderer::PrintStatistics() const
+{
+    const double frames = max( 1u, m_statistics.frames );
+
+    auto printStage = [&]( const char* name, double milliseconds )
+    {
+        cout << "  " << left << setw( 14 ) << name << right
+             << setw( 12 ) << fixed << setprecision( 2 ) << milliseconds << " ms"
+             << setw( 10 ) << milliseconds / frames << " ms/frame" << endl;
+    };
+
+    cout << "Batch: " << m_statistics.frames << " frames in " << fixed << setprecision( 2 ) << m_statistics.wallMilliseconds
+         << " ms, " << m_statistics.FramesPerSecond() << " fps (scene " << m_statistics.sceneMilliseconds << " ms)" << endl;
+    printStage( "load", m_statistics.loadMilliseconds );
+    printStage( "render", m_statistics.renderMilliseconds );
+    printStage( "encode", m_statistics.encodeMilliseconds );
+    printStage( "render stall", m_statistics.renderStallMilliseconds );
+
+    // Buckets sized so the slowest frames fall in the last few
+    const double p99 = m_frameStatistics.GetPercentiles( FrameStatistics::METRIC_CPU_TIME ).p99;
+    m_frameStatistics.WriteReport( cout );
+    m_frameStatistics.WriteHistogram( cout, FrameStatistics::METRIC_CPU_TIME, max( 0.1, ceil( p99 / 2.0 ) / 10.0 ), 25 );
+
+    if (!m_comparisons.empty())
+    {
+        cout << "Baseline: " << (m_bRegressed ? "REGRESSED" : "passed") << endl;
+        FrameBaseline::WriteComparisons( cout, m_comparisons );
+    }
+}
+
+bool BatchRenderer::CreateScene( const Options& options )
+{
+    // No device: nodes keep CPU data only
+    m_pScene = make_shared<Scene>( nullptr );
+
+    auto pLight = make_shared<Light>( nullptr );
+    m_pScene->GetRootNode()->AddChild( pLight );
+
+    const bool bGenerated = options.generator.objectCount > 0 || !options.scenePath.empty();
+    if (bGenerated && !CreateGeneratedScene( options ))
+        return false;
+
+    vector<string> modelPaths = options.modelPaths;
+    if (modelPaths.empty() && !bGenerated)
+    {
+        // App::CreateScene()
+        modelPaths.push_back( "resource/bunny.obj" );
+        modelPaths.push_back( "resource/floor.obj" );
+    }
+
+    // Models load as jobs, then join the scene in the order given
+    vector<shared_ptr<Model> > models( modelPaths.size() );
+    vector<uint8_t>            loaded( modelPaths.size(), 0 );
+    auto loadModel = [&]( uint32_t i )
+    {
+        models[i] = make_shared<Model>( nullptr );
+        loaded[i] = models[i]->BindAsset( nullptr, modelPaths[i] ) && !models[i]->GetIndices().empty();
+    };
+    JobSystem::GetInstance().ParallelFor( static_cast<uint32_t>(modelPaths.size()), loadModel, 1 );
+
+    for (size_t i = 0; i < models.size(); ++i)
+    {
+        if (!loaded[i])
+        {
+            cerr << "Failed to load " << modelPaths[i] << endl;
+            return false;
+        }
+
+        m_pScene->GetRootNode()->AddChild( models[i] );
+    }
+
+    // Views come from the camera path, so one shadow box covers the whole scene in a single cascade
+    pLight->SetCascadeCount( 1 );
+    pLight->FitShadowFrustum( nullptr, m_pScene->GetBounds(), options.shadowMapSize );
+
+    return true;
+}
+
+bool BatchRenderer::CreateGeneratedScene( const Options& options )
+{
+    GeneratedScene generated;
+    SceneGenerator generator;
+
+    if (options.generator.objectCount > 0)
+    {
+        if (!SceneGenerator::Generate( options.generator, generated ))
+        {
+            Log::Output( Log::LOG_LEVEL_ERROR, "BatchRenderer::CreateGeneratedScene() Invalid generator config." );
+            return false;
+        }
+
+        if (!options.scenePath.empty() && !generator.Write( generated, options.scenePath ))
+        {
+            cerr << generator.GetError() << endl;
+            return false;
+        }
+    }
+    else if (!generator.Read( options.scenePath, generated ))
+    {
+        cerr << generator.GetError() << endl;
+        return false;
+    }
+
+    cout << "Scene: " << generated.nodes.size() << " objects, " << generated.meshes.size() << " meshes, depth " << generated.GetDepth()
+         << ", " << generated.GetDrawnTriangleCount() << " triangles, " << generated.lights.Size() << " lights" << endl;
+
+    return m_pScene->AddGenerated( nullptr, nullptr, generated );
+}
@@ -0,0 +1,389 @@
+#include "BufferSuballocator.h"
+
+#include <algorithm>
+#include <cstring>
+
+MockBufferBlockBackend::MockBufferBlockBackend()
+    : m_liveBlocks( 0 )
+    , m_copiedBytes( 0 )
+{
+}
+
+bool MockBufferBlockBackend::CreateBlock( uint32_t block, uint64_t size )
+{
+    if (block >= m_blocks.size())
+        m_blocks.resize( block + 1 );
+
+    m_blocks[block].assign( static_cast<size_t>(size), 0 );
+    m_liveBlocks++;
+
+    return true;
+}
+
+void MockBufferBlockBackend::DestroyBlock( uint32_t block )
+{
+    std::vector<unsigned char>().swap( m_blocks[block] );
+    m_liveBlocks--;
+}
+
+void MockBufferBlockBackend::Copy( uint32_t srcBlock, uint64_t srcOffset, uint32_t dstBlock, uint64_t dstOffset, uint64_t size )
+{
+    memcpy( m_blocks[dstBlock].data() + dstOffset, m_blocks[srcBlock].data() + srcOffset, static_cast<size_t>(size) );
+    m_copiedBytes += size;
+}
+
+BufferSuballocator::BufferSuballocator( BufferBlockBackend& backend, uint64_t blockSize, uint64_t granularity )
+    : m_backend( backend )
+    , m_blockSize( blockSize )
+    , m_granularity( granularity )
+    , m_frameFreeBegin( 0 )
+    , m_requestedBytes( 0 )
+    , m_allocationCount( 0 )
+    , m_moves( 0 )
+    , m_movedBytes( 0 )
+    , m_blocksCreated( 0 )
+    , m_blocksDestroyed( 0 )
+    , m_failures( 0 )
+{
+}
+
+BufferSuballocator::~BufferSuballocator()
+{
+    for (uint32_t block = 0; block < m_blocks.size(); ++block)
+    {
+        if (m_blocks[block].pAllocator != nullptr)
+            m_backend.DestroyBlock( block );
+    }
+}
+
+BufferSuballocator::Handle BufferSuballocator::Allocate( uint64_t size, uint64_t alignment )
+{
+    if (size == 0)
+        return INVALID_HANDLE;
+
+    alignment = std::max( alignment, m_granularity );
+
+    uint32_t block = INVALID_HANDLE;
+    uint32_t node  = TlsfAllocator::INVALID_NODE;
+
+    // Earlier blocks first, which keeps later ones emptier for Defragment to clear
+    for (uint32_t i = 0; i < m_blocks.size() && node == TlsfAllocator::INVALID_NODE; ++i)
+    {
+        if (m_blocks[i].pAllocator == nullptr || m_blocks[i].bDedicated)
+            continue;
+
+        node  = m_blocks[i].pAllocator->Allocate( size, alignment );
+        block = i;
+    }
+
+    if (node == TlsfAllocator::INVALID_NODE)
+    {
+        const uint64_t required = ((size + m_granularity - 1) & ~(m_granularity - 1)) + alignment - m_granularity;
+        const bool     bDedicated = required > m_blockSize;
+
+        block = CreateBlock( bDedicated ? required : m_blockSize, bDedicated );
+        if (block != INVALID_HANDLE)
+            node = m_blocks[block].pAllocator->Allocate( size, alignment );
+
+        if (node == TlsfAllocator::INVALID_NODE)
+        {
+            m_failures++;
+            return INVALID_HANDLE;
+        }
+    }
+
+    Handle handle;
+    if (!m_unusedHandles.empty())
+    {
+        handle = m_unusedHandles.back();
+        m_unusedHandles.pop_back();
+    }
+    else
+    {
+        handle = static_cast<Handle>(m_entries.size());
+        m_entries.push_back( Entry() );
+    }
+
+    Entry& entry = m_entries[handle];
+    entry.block     = block;
+    entry.node      = node;
+    entry.size      = size;
+    entry.alignment = alignment;
+
+    m_requestedBytes += size;
+    m_allocationCount++;
+
+    return handle;
+}
+
+void BufferSuballocator::Free( Handle handle )
+{
+    if (handle >= m_entries.size() || m_entries[handle].block == INVALID_HANDLE)
+        return;
+
+    Entry& entry = m_entries[handle];
+    Retire( entry.block, entry.node );
+
+    m_requestedBytes -= entry.size;
+    m_allocationCount--;
+
+    entry.block = INVALID_HANDLE;
+    m_unusedHandles.push_back( handle );
+}
+
+BufferSuballocator::Location BufferSuballocator::GetLocation( Handle handle ) const
+{
+    Location location = { INVALID_HANDLE, 0, 0 };
+    if (handle >= m_entries.size() || m_entries[handle].block == INVALID_HANDLE)
+        return location;
+
+    const Entry& entry = m_entries[handle];
+    location.block  = entry.block;
+    location.offset = m_blocks[entry.block].pAllocator->GetOffset( entry.node );
+    location.size   = entry.size;
+
+    return location;
+}
+
+void BufferSuballocator::EndFrame( uint64_t fenceValue )
+{
+    for (size_t i = m_frameFreeBegin; i < m_pendingFrees.size(); ++i)
+    {
+        m_pendingFrees[i].fenceValue = fenceValue;
+    }
+    m_frameFreeBegin = m_pendingFrees.size();
+}
+
+void BufferSuballocator::Reclaim( uint64_t completedFenceValue )
+{
+    // Tagged frees are in fence order
+    size_t count = 0;
+    while (count < m_frameFreeBegin && m_pendingFrees[count].fenceValue <= completedFenceValue)
+    {
+        const PendingFree& pending = m_pendingFrees[count];
+        Block& block = m_blocks[pending.block];
+
+        block.pendingBytes -= block.pAllocator->GetSize( pending.node );
+        block.pAllocator->Free( pending.node );
+        count++;
+    }
+
+    if (count == 0)
+        return;
+
+    m_pendingFrees.erase( m_pendingFrees.begin(), m_pendingFrees.begin() + count );
+    m_frameFreeBegin -= count;
+
+    uint32_t ordinaryBlocks = 0;
+    for (const Block& block : m_blocks)
+    {
+        if (block.pAllocator != nullptr && !block.bDedicated)
+            ordinaryBlocks++;
+    }
+
+    for (uint32_t i = 0; i < m_blocks.size(); ++i)
+    {
+        Block& block = m_blocks[i];
+        if (block.pAllocator == nullptr || block.pAllocator->GetAllocationCount() > 0)
+            continue;
+
+        if (!block.bDedicated)
+        {
+            if (ordinaryBlocks == 1)
+                continue;
+            ordinaryBlocks--;
+        }
+
+        m_backend.DestroyBlock( i );
+        block.pAllocator.reset();
+        block.pendingBytes = 0;
+        m_blocksDestroyed++;
+    }
+}
+
+uint64_t BufferSuballocator::Defragment( uint64_t maxBytes )
+{
+    // Ordinary blocks, emptiest first
+    m_blockOrder.clear();
+    for (uint32_t i = 0; i < m_blocks.size(); ++i)
+    {
+        if (m_blocks[i].pAllocator != nullptr && !m_blocks[i].bDedicated)
+            m_blockOrder.push_back( i );
+    }
+
+    std::stable_sort( m_blockOrder.begin(), m_blockOrder.end(), [&]( uint32_t a, uint32_t b )
+    {
+        return m_blocks[a].pAllocator->GetUsedBytes() < m_blocks[b].pAllocator->GetUsedBytes();
+    } );
+
+    uint64_t moved = 0;
+    for (size_t source = 0; source < m_blockOrder.size() && moved < maxBytes; ++source)
+    {
+        const uint32_t block = m_blockOrder[source];
+        TlsfAllocator& allocator = *m_blocks[block].pAllocator;
+
+        // Buffers of the block, highest first, so holes fill from the bottom. Scans every handle, which
+        // is cheap next to copying.
+        m_candidates.clear();
+        for (Handle handle = 0; handle < m_entries.size(); ++handle)
+        {
+            if (m_entries[handle].block == block)
+                m_candidates.push_back( handle );
+        }
+
+        std::sort( m_candidates.begin(), m_candidates.end(), [&]( Handle a, Handle b )
+        {
+            return allocator.GetOffset( m_entries[a].node ) > allocator.GetOffset( m_entries[b].node );
+        } );
+
+        for (Handle handle : m_candidates)
+        {
+            if (moved >= maxBytes)
+                break;
+
+            const Entry& entry = m_entries[handle];
+
+            // Fuller blocks first
+            bool bMoved = false;
+            for (size_t target = m_blockOrder.size(); target-- > source + 1 && !bMoved;)
+            {
+                const uint32_t targetBlock = m_blockOrder[target];
+                const uint32_t node = m_blocks[targetBlock].pAllocator->Allocate( entry.size, entry.alignment );
+                if (node == TlsfAllocator::INVALID_NODE)
+                    continue;
+
+                moved += entry.size;
+                Move( handle, targetBlock, node );
+                bMoved = true;
+            }
+
+            if (bMoved)
+                continue;
+
+            // A lower hole of the same block; the range found is given back at once when it is not lower
+            const uint32_t node = allocator.Allocate( entry.size, entry.alignment );
+            if (node == TlsfAllocator::INVALID_NODE)
+                continue;
+
+            if (allocator.GetOffset( node ) < allocator.GetOffset( entry.node ))
+            {
+                moved += entry.size;
+                Move( handle, block, node );
+            }
+            else
+            {
+                allocator.Free( node );
+            }
+        }
+    }
+
+    return moved;
+}
+
+BufferSuballocator::Statistics BufferSuballocator::GetStatistics() const
+{
+    Statistics statistics;
+    for (const Block& block : m_blocks)
+    {
+        if (block.pAllocator == nullptr)
+            continue;
+
+        const TlsfAllocator& allocator = *block.pAllocator;
+        statistics.blocks++;
+        statistics.blockBytes      += allocator.GetCapacity();
+        statistics.usedBytes       += allocator.GetUsedBytes() - block.pendingBytes;
+        statistics.pendingBytes    += block.pendingBytes;
+        statistics.freeBytes       += allocator.GetCapacity() - allocator.GetUsedBytes();
+        statistics.largestFreeRange = std::max( statistics.largestFreeRange, allocator.GetLargestFreeRange() );
+    }
+
+    statistics.requestedBytes  = m_requestedBytes;
+    statistics.allocations     = m_allocationCount;
+    statistics.moves           = m_moves;
+    statistics.movedBytes      = m_movedBytes;
+    statistics.blocksCreated   = m_blocksCreated;
+    statistics.blocksDestroyed = m_blocksDestroyed;
+    statistics.failures        = m_failures;
+
+    return statistics;
+}
+
+bool BufferSuballocator::Validate() const
+{
+    uint32_t allocations = 0;
+    for (const Block& block : m_blocks)
+    {
+        if (block.pAllocator == nullptr)
+            continue;
+
+        if (!block.pAllocator->Validate())
+            return false;
+
+        allocations += block.pAllocator->GetAllocationCount();
+    }
+
+    for (const Entry& entry : m_entries)
+    {
+        if (entry.block == INVALID_HANDLE)
+            continue;
+
+        if (entry.block >= m_blocks.size() || m_blocks[entry.block].pAllocator == nullptr)
+            return false;
+
+        const TlsfAllocator& allocator = *m_blocks[entry.block].pAllocator;
+        if (allocator.GetSize( entry.node ) < entry.size || (allocator.GetOffset( entry.node ) & (entry.alignment - 1)) != 0)
+            return false;
+    }
+
+    // Pending ranges are still allocated in their blocks
+    return allocations == m_allocationCount + m_pendingFrees.size();
+}
+
+uint32_t BufferSuballocator::CreateBlock( uint64_t size, bool bDedicated )
+{
+    uint32_t block = 0;
+    while (block < m_blocks.size() && m_blocks[block].pAllocator != nullptr)
+    {
+        block++;
+    }
+
+    if (!m_backend.CreateBlock( block, size ))
+        return INVALID_HANDLE;
+
+    if (block == m_blocks.size())
+        m_blocks.push_back( Block() );
+
+    m_blocks[block].pAllocator.reset( new TlsfAllocator( size, m_granularity ) );
+    m_blocks[block].pendingBytes = 0;
+    m_blocks[block].bDedicated   = bDedicated;
+    m_blocksCreated++;
+
+    return block;
+}
+
+void BufferSuballocator::Retire( uint32_t block, uint32_t node )
+{
+    PendingFree pending;
+    pending.fenceValue = 0;
+    pending.block      = block;
+    pending.node       = node;
+    m_pendingFrees.push_back( pending );
+
+    m_blocks[block].pendingBytes += m_blocks[block].pAllocator->GetSize( node );
+}
+
+void BufferSuballocator::Move( Handle handle, uint32_t block, uint32_t node )
+{
+    Entry& entry = m_entries[handle];
+
+    m_backend.Copy( entry.block, m_blocks[entry.block].pAllocator->GetOffset( entry.node ),
+                    block, m_blocks[block].pAllocator->GetOffset( node ), entry.size );
+
+    Retire( entry.block, entry.node );
+
+    entry.block = block;
+    entry.node  = node;
+
+    m_moves++;
+    m_movedBytes += entry.size;
+}
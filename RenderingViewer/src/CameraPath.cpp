@@ -0,0 +1,93 @@
+#include "CameraPath.h"
+
+#include <cstdlib>
+#include <sstream>
+
+CameraPathReader::CameraPathReader()
+    : m_line( 0 )
+    , m_index( 0 )
+{
+}
+
+CameraPathReader::~CameraPathReader()
+{
+}
+
+bool CameraPathReader::Open( const std::string& path )
+{
+    m_path  = path;
+    m_error.clear();
+    m_line  = 0;
+    m_index = 0;
+
+    m_file.close();
+    m_file.clear();
+    m_file.open( path.c_str() );
+    if (!m_file)
+    {
+        m_error = "Failed to open " + path;
+        return false;
+    }
+
+    return true;
+}
+
+bool CameraPathReader::Read( View& view )
+{
+    if (!m_file.is_open() || HasError())
+        return false;
+
+    std::string line;
+    while (std::getline( m_file, line ))
+    {
+        m_line++;
+
+        const size_t first = line.find_first_not_of( " \t\r" );
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        float values[32];
+        int   count = 0;
+
+        const char* pCursor = line.c_str() + first;
+        while (*pCursor != '\0')
+        {
+            if (*pCursor == ' ' || *pCursor == '\t' || *pCursor == ',' || *pCursor == '\r')
+            {
+                pCursor++;
+                continue;
+            }
+
+            char* pEnd = nullptr;
+            const float value = std::strtof( pCursor, &pEnd );
+            if (pEnd == pCursor || count == 32)
+            {
+                count = -1;
+                break;
+            }
+
+            values[count++] = value;
+            pCursor = pEnd;
+        }
+
+        if (count != 32)
+        {
+            std::ostringstream message;
+            message << m_path << "(" << m_line << "): expected 32 numbers (view and projection matrices)";
+            m_error = message.str();
+            return false;
+        }
+
+        view.index = m_index++;
+        view.line  = m_line;
+        for (int i = 0; i < 16; ++i)
+        {
+            view.view[i]       = values[i];
+            view.projection[i] = values[16 + i];
+        }
+
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,109 @@
+ClusteredLights::ClusteredLights( ID3D12Device* pDevice, UINT threadCount )
+    : Node( pDevice )
+    , m_clusters( threadCount )
+    , m_buildCount( 0 )
+    , m_builtCameraVersion( 0 )
+    , m_builtVersion( 0 )
+    , m_builtWidth( 0 )
+    , m_builtHeight( 0 )
+    , m_bBuilt( false )
+{
+    m_nodeType = NODE_TYPE_LIGHT_CLUSTER;
+
+    memset( &m_clusterData, 0, sizeof( m_clusterData ) );
+}
+
+ClusteredLights::~ClusteredLights()
+{
+}
+
+UINT ClusteredLights::AddPointLight( const Vec3f& position, float range, const Vec3f& color )
+{
+    MarkChanged();
+
+    return m_lights.AddPointLight( &position.x, range, &color.x );
+}
+
+UINT ClusteredLights::AddSpotLight( const Vec3f& position, const Vec3f& direction, float range, float innerAngle, float outerAngle, const Vec3f& color )
+{
+    MarkChanged();
+
+    return m_lights.AddSpotLight( &position.x, &direction.x, range, innerAngle, outerAngle, &color.x );
+}
+
+void ClusteredLights::ClearLights()
+{
+    m_lights.Clear();
+
+    MarkChanged();
+}
+
+void ClusteredLights::Build( const Camera& camera, UINT width, UINT height )
+{
+    if (m_bBuilt && camera.GetVersion() == m_builtCameraVersion && GetVersion() == m_builtVersion &&
+        width == m_builtWidth && height == m_builtHeight)
+        return;
+
+    if (!m_bBuilt || GetVersion() != m_builtVersion)
+    {
+        m_gpuLights.resize( m_lights.Size() );
+        for (size_t i = 0; i < m_lights.Size(); ++i)
+        {
+            ResLight& light = m_gpuLights[i];
+            light.positionRange     = Vec4f( m_lights.positionX[i], m_lights.positionY[i], m_lights.positionZ[i], m_lights.range[i] );
+            light.colorCosInner     = Vec4f( m_lights.colorR[i], m_lights.colorG[i], m_lights.colorB[i], m_lights.spotCosInner[i] );
+            light.directionCosOuter = Vec4f( m_lights.directionX[i], m_lights.directionY[i], m_lights.directionZ[i], m_lights.spotCosOuter[i] );
+        }
+
+        m_shaderResources[SHADER_RESOURCE_LIGHTS].MarkDirty();
+    }
+
+    if (!m_clusters.Build( reinterpret_cast<const float*>(&camera.GetViewMatrix()), reinterpret_cast<const float*>(&camera.GetProjectionMatrix()), m_lights ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "ClusteredLights::Build() Projection has no depth range." );
+        return;
+    }
+
+    const LightClusters::Config& config = m_clusters.GetConfig();
+    m_clusterData.tilesX     = config.tilesX;
+    m_clusterData.tilesY     = config.tilesY;
+    m_clusterData.slices     = config.slices;
+    m_clusterData.lightCount = static_cast<UINT>(m_lights.Size());
+    m_clusterData.sliceScale = m_clusters.GetSliceScale();
+    m_clusterData.sliceBias  = m_clusters.GetSliceBias();
+    m_clusterData.tileScaleX = static_cast<float>(config.tilesX) / max( width, 1u );
+    m_clusterData.tileScaleY = static_cast<float>(config.tilesY) / max( height, 1u );
+
+    m_constants.MarkDirty();
+    m_shaderResources[SHADER_RESOURCE_RANGES].MarkDirty();
+    m_shaderResources[SHADER_RESOURCE_INDICES].MarkDirty();
+
+    m_builtCameraVersion = camera.GetVersion();
+    m_builtVersion       = GetVersion();
+    m_builtWidth         = width;
+    m_builtHeight        = height;
+    m_bBuilt             = true;
+    m_buildCount++;
+}
+
+void ClusteredLights::UpdateGPUBuffer( UploadRingAllocator& ring )
+{
+    m_constants.Update( ring, &m_clusterData, sizeof( m_clusterData ) );
+
+    // Root SRVs must point at memory even when there is nothing to read
+    static const UINT EMPTY[4] = { 0 };
+    auto update = [&]( SHADER_RESOURCE resource, const void* pData, size_t size )
+    {
+        if (size == 0)
+            m_shaderResources[resource].Update( ring, EMPTY, sizeof( EMPTY ) );
+        else
+            m_shaderResources[resource].Update( ring, pData, static_cast<uint32_t>(size) );
+    };
+
+    const vector<LightClusters::Range>& ranges  = m_clusters.GetRanges();
+    const vector<uint32_t>&             indices = m_clusters.GetIndices();
+
+    update( SHADER_RESOURCE_LIGHTS, m_gpuLights.data(), m_gpuLights.size() * sizeof( ResLight ) );
+    update( SHADER_RESOURCE_RANGES, ranges.data(), ranges.size() * sizeof( LightClusters::Range ) );
+    update( SHADER_RESOURCE_INDICES, indices.data(), indices.size() * sizeof( uint32_t ) );
+}
@@ -0,0 +1,131 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+
+DescriptorAllocator::DescriptorAllocator( uint32_t persistentCount, uint32_t transientCountPerFrame, uint32_t frameCount )
+    : m_persistentCount( persistentCount )
+    , m_transientCountPerFrame( transientCountPerFrame )
+    , m_frameCount( std::max( frameCount, 1u ) )
+    , m_frameIndex( 0 )
+    , m_transientOffset( 0 )
+    , m_sliceFenceValues( m_frameCount, 0 )
+    , m_completedFenceValue( 0 )
+    , m_bSliceBusy( false )
+{
+    if (m_persistentCount > 0)
+    {
+        Range range = { 0, m_persistentCount };
+        m_freeRanges.push_back( range );
+    }
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+}
+
+uint32_t DescriptorAllocator::AllocatePersistent( uint32_t count )
+{
+    if (count == 0)
+        return INVALID_INDEX;
+
+    for (size_t i = 0; i < m_freeRanges.size(); ++i)
+    {
+        Range& range = m_freeRanges[i];
+        if (range.count < count)
+            continue;
+
+        const uint32_t index = range.begin;
+
+        range.begin += count;
+        range.count -= count;
+        if (range.count == 0)
+            m_freeRanges.erase( m_freeRanges.begin() + i );
+
+        m_statistics.persistentUsed += count;
+        m_statistics.persistentPeak = std::max( m_statistics.persistentPeak, m_statistics.persistentUsed );
+
+        return index;
+    }
+
+    m_statistics.failures++;
+    return INVALID_INDEX;
+}
+
+void DescriptorAllocator::FreePersistent( uint32_t index, uint32_t count )
+{
+    if (index == INVALID_INDEX || count == 0 || index + count > m_persistentCount)
+        return;
+
+    auto it = std::lower_bound( m_freeRanges.begin(), m_freeRanges.end(), index,
+                                []( const Range& range, uint32_t value ) { return range.begin < value; } );
+
+    Range range = { index, count };
+    it = m_freeRanges.insert( it, range );
+
+    // Merge with the following range
+    auto next = it + 1;
+    if (next != m_freeRanges.end() && it->begin + it->count == next->begin)
+    {
+        it->count += next->count;
+        m_freeRanges.erase( next );
+    }
+
+    // Merge with the preceding range
+    if (it != m_freeRanges.begin())
+    {
+        auto prev = it - 1;
+        if (prev->begin + prev->count == it->begin)
+        {
+            prev->count += it->count;
+            m_freeRanges.erase( it );
+        }
+    }
+
+    m_statistics.persistentUsed -= std::min( m_statistics.persistentUsed, count );
+}
+
+uint32_t DescriptorAllocator::AllocateTransient( uint32_t count )
+{
+    // The GPU may still read the descriptors the slice held last time around
+    if (m_sliceFenceValues[m_frameIndex] > m_completedFenceValue)
+    {
+        if (!m_bSliceBusy)
+            m_statistics.busyFrames++;
+        m_bSliceBusy = true;
+
+        m_statistics.failures++;
+        return INVALID_INDEX;
+    }
+
+    if (count == 0 || m_transientOffset + count > m_transientCountPerFrame)
+    {
+        m_statistics.failures++;
+        return INVALID_INDEX;
+    }
+
+    const uint32_t index = m_persistentCount + m_frameIndex * m_transientCountPerFrame + m_transientOffset;
+    m_transientOffset += count;
+
+    m_statistics.transientUsed = m_transientOffset;
+    m_statistics.transientPeak = std::max( m_statistics.transientPeak, m_transientOffset );
+
+    return index;
+}
+
+void DescriptorAllocator::EndFrame( uint64_t fenceValue )
+{
+    // A slice nothing was allocated from is free again right away
+    if (m_transientOffset > 0)
+        m_sliceFenceValues[m_frameIndex] = std::max( m_sliceFenceValues[m_frameIndex], fenceValue );
+
+    m_frameIndex      = (m_frameIndex + 1) % m_frameCount;
+    m_transientOffset = 0;
+    m_bSliceBusy      = false;
+
+    m_statistics.transientUsed = 0;
+}
+
+void DescriptorAllocator::Reclaim( uint64_t completedFenceValue )
+{
+    m_completedFenceValue = std::max( m_completedFenceValue, completedFenceValue );
+}
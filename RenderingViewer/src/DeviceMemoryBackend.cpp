@@ -0,0 +1,64 @@
+DeviceMemoryBackend::DeviceMemoryBackend( ID3D12Device* pDevice, IDXGIAdapter* pAdapter )
+    : m_pDevice( pDevice )
+{
+    // Budgets need DXGI 1.4; without it only the sizes are known
+    if (pAdapter != nullptr)
+        pAdapter->QueryInterface( IID_PPV_ARGS( m_pAdapter.ReleaseAndGetAddressOf() ) );
+}
+
+DeviceMemoryBackend::~DeviceMemoryBackend()
+{
+}
+
+uint64_t DeviceMemoryBackend::GetAllocationSize( const MemoryResourceDesc& desc )
+{
+    if (desc.type == MemoryResourceDesc::TYPE_DESCRIPTOR_HEAP || m_pDevice == nullptr)
+        return desc.GetBytes();
+
+    D3D12_RESOURCE_DESC resourceDesc = {};
+    resourceDesc.DepthOrArraySize = 1;
+    resourceDesc.MipLevels        = 1;
+    resourceDesc.SampleDesc.Count = 1;
+
+    if (desc.type == MemoryResourceDesc::TYPE_BUFFER)
+    {
+        resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+        resourceDesc.Width     = desc.width;
+        resourceDesc.Height    = 1;
+        resourceDesc.Format    = DXGI_FORMAT_UNKNOWN;
+        resourceDesc.Layout    = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    }
+    else
+    {
+        // The viewer's textures are 32-bit depth or color
+        resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+        resourceDesc.Width     = desc.width;
+        resourceDesc.Height    = desc.height;
+        resourceDesc.Format    = (desc.flags & MemoryResourceDesc::FLAG_DEPTH_STENCIL) ? DXGI_FORMAT_D32_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM;
+        resourceDesc.Layout    = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+        if (desc.flags & MemoryResourceDesc::FLAG_DEPTH_STENCIL)
+            resourceDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+        if (desc.flags & MemoryResourceDesc::FLAG_RENDER_TARGET)
+            resourceDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+    }
+
+    const D3D12_RESOURCE_ALLOCATION_INFO info = m_pDevice->GetResourceAllocationInfo( 0, 1, &resourceDesc );
+    if (info.SizeInBytes == UINT64_MAX)
+        return desc.GetBytes();
+
+    return info.SizeInBytes;
+}
+
+bool DeviceMemoryBackend::QueryDeviceMemory( uint64_t& budget, uint64_t& usage )
+{
+    if (m_pAdapter == nullptr)
+        return false;
+
+    DXGI_QUERY_VIDEO_MEMORY_INFO info = {};
+    if (FAILED( m_pAdapter->QueryVideoMemoryInfo( 0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info ) ))
+        return false;
+
+    budget = info.Budget;
+    usage  = info.CurrentUsage;
+    return true;
+}
@@ -0,0 +1,93 @@
+#include "DrawBindings.h"
+
+DrawBindings::ForwardSources::ForwardSources()
+    : pCamera( nullptr )
+    , pLight( nullptr )
+    , pMaterial( nullptr )
+    , pLightClusters( nullptr )
+{
+}
+
+DrawBindings::DrawBindings()
+    : m_pRootSignature( nullptr )
+    , m_pPipelineState( nullptr )
+    , m_descriptorIndex( DescriptorAllocator::INVALID_INDEX )
+    , m_constantBufferCount( 0 )
+    , m_shaderResourceSourceCount( 0 )
+    , m_shaderResourceCount( 0 )
+{
+}
+
+bool DrawBindings::AddConstantBuffer( const Source* pSource )
+{
+    if (pSource == nullptr || m_constantBufferCount >= DrawRecorder::MAX_CONSTANT_BUFFERS)
+        return false;
+
+    m_pConstantSources[m_constantBufferCount++] = pSource;
+
+    return true;
+}
+
+bool DrawBindings::AddShaderResources( const Source* pSource )
+{
+    if (pSource == nullptr || m_shaderResourceCount + pSource->GetShaderResourceCount() > DrawRecorder::MAX_SHADER_RESOURCES)
+        return false;
+
+    m_pShaderResourceSources[m_shaderResourceSourceCount++] = pSource;
+    m_shaderResourceCount += pSource->GetShaderResourceCount();
+
+    return true;
+}
+
+bool DrawBindings::BindForward( const ForwardSources& sources )
+{
+    bool bBound = true;
+
+    // The material has constants only
+    const Source* pSources[] = { sources.pCamera, sources.pLight, sources.pMaterial, sources.pLightClusters };
+    for (const Source* pSource : pSources)
+    {
+        if (pSource == nullptr)
+            continue;
+
+        bBound &= AddConstantBuffer( pSource );
+
+        if (pSource != sources.pMaterial && pSource->GetShaderResourceCount() > 0)
+            bBound &= AddShaderResources( pSource );
+    }
+
+    return bBound;
+}
+
+void DrawBindings::CreatePacket( const void* pContext, const void* pModel, uint32_t indexCount, const float boundsMin[3], const float boundsMax[3],
+                                 DrawRecorder::Packet& packet ) const
+{
+    packet.pContext       = pContext;
+    packet.pRootSignature = m_pRootSignature;
+    packet.pPipelineState = m_pPipelineState;
+    packet.pModel         = pModel;
+
+    packet.constantBufferCount = m_constantBufferCount;
+    for (uint32_t i = 0; i < m_constantBufferCount; ++i)
+    {
+        packet.constantBuffers[i] = m_pConstantSources[i]->GetConstantBufferAddress();
+    }
+
+    packet.shaderResourceCount = 0;
+    for (uint32_t source = 0; source < m_shaderResourceSourceCount; ++source)
+    {
+        const Source* pSource = m_pShaderResourceSources[source];
+        for (uint32_t i = 0; i < pSource->GetShaderResourceCount(); ++i)
+        {
+            packet.shaderResources[packet.shaderResourceCount++] = pSource->GetShaderResourceAddress( i );
+        }
+    }
+
+    packet.descriptorIndex = m_descriptorIndex;
+    packet.indexCount      = indexCount;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        packet.center[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+    }
+}
@@ -0,0 +1,169 @@
+#include "DrawRecorder.h"
+
+DrawRecorder::DrawRecorder()
+    : m_sortPass( 0 )
+    , m_sortDepthRange( 0.0f )
+    , m_pPackets( nullptr )
+    , m_pItems( nullptr )
+    , m_count( 0 )
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        m_sortOrigin[i]    = 0.0f;
+        m_sortDirection[i] = 0.0f;
+    }
+}
+
+void DrawRecorder::SetSortView( const float origin[3], const float direction[3], float depthRange )
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        m_sortOrigin[i]    = origin[i];
+        m_sortDirection[i] = direction[i];
+    }
+    m_sortDepthRange = depthRange;
+}
+
+void DrawRecorder::ClearSortIds()
+{
+    m_pipelineIds.clear();
+    m_modelIds.clear();
+}
+
+void DrawRecorder::Sort( const Packet* pPackets, DrawSort::Item* pItems, uint32_t count, Statistics& statistics )
+{
+    m_pPackets = pPackets;
+    m_pItems   = pItems;
+    m_count    = pPackets != nullptr && pItems != nullptr ? count : 0;
+
+    for (uint32_t i = 0; i < m_count; ++i)
+    {
+        m_pItems[i].key   = CreateSortKey( m_pPackets[i], statistics );
+        m_pItems[i].index = i;
+    }
+
+    // Summed, so a pass sorting several batches reports all of them
+    statistics.unsortedStateChanges += DrawSort::CountStateChanges( m_pItems, m_count ).Total();
+
+    m_drawSort.Sort( m_pItems, m_count );
+
+    statistics.stateChanges += DrawSort::CountStateChanges( m_pItems, m_count ).Total();
+}
+
+uint64_t DrawRecorder::CreateSortKey( const Packet& packet, Statistics& statistics )
+{
+    float depth = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        depth += (packet.center[i] - m_sortOrigin[i]) * m_sortDirection[i];
+    }
+
+    // Each model owns its material constants and its geometry, so the model stands in for both
+    const uint32_t pipelineId = GetSortId( m_pipelineIds, packet.pPipelineState );
+    const uint32_t modelId    = GetSortId( m_modelIds, packet.pModel );
+
+    // The material field is the narrower of the two the model id goes into
+    if (!DrawKey::Fits( pipelineId, DrawKey::PIPELINE_BITS ) || !DrawKey::Fits( modelId, DrawKey::MATERIAL_BITS ))
+        statistics.saturatedKeys++;
+
+    return DrawKey::Pack( m_sortPass, pipelineId, modelId, modelId, DrawKey::QuantizeDepth( depth, m_sortDepthRange ) );
+}
+
+uint32_t DrawRecorder::GetSortId( std::unordered_map<const void*, uint32_t>& ids, const void* pObject )
+{
+    // Small ids in first-seen order keep the key fields compact
+    auto it = ids.find( pObject );
+    if (it != ids.end())
+        return it->second;
+
+    uint32_t id = static_cast<uint32_t>(ids.size());
+    ids.insert( std::make_pair( pObject, id ) );
+
+    return id;
+}
+
+void DrawRecorder::Record( CommandSink& sink, Statistics& statistics ) const
+{
+    const void* pCurRootSignature  = nullptr;
+    const void* pCurPipelineState  = nullptr;
+    uint32_t    curDescriptorIndex = DescriptorAllocator::INVALID_INDEX;
+    bool        bHeapBound         = false;
+
+    uint64_t curConstantBuffers[MAX_CONSTANT_BUFFERS] = {};
+    uint64_t curShaderResources[MAX_SHADER_RESOURCES] = {};
+
+    for (uint32_t draw = 0; draw < m_count; ++draw)
+    {
+        const Packet& packet = m_pPackets[m_pItems[draw].index];
+
+        // Root signature, descriptor heap, pipeline state and viewport were set for every draw before
+        statistics.requestedBinds += 4;
+
+        if (packet.pRootSignature != pCurRootSignature)
+        {
+            sink.SetRootSignature( packet );
+            pCurRootSignature = packet.pRootSignature;
+            statistics.issuedBinds++;
+
+            // Changing the root signature invalidates all root arguments
+            curDescriptorIndex = DescriptorAllocator::INVALID_INDEX;
+            for (auto& address : curConstantBuffers)
+            {
+                address = 0;
+            }
+            for (auto& address : curShaderResources)
+            {
+                address = 0;
+            }
+        }
+
+        for (uint32_t i = 0; i < packet.constantBufferCount; ++i)
+        {
+            if (packet.constantBuffers[i] == curConstantBuffers[i])
+                continue;
+
+            sink.SetConstantBuffer( i, packet.constantBuffers[i] );
+            curConstantBuffers[i] = packet.constantBuffers[i];
+            statistics.issuedBinds++;
+        }
+
+        for (uint32_t i = 0; i < packet.shaderResourceCount; ++i)
+        {
+            if (packet.shaderResources[i] == curShaderResources[i])
+                continue;
+
+            sink.SetShaderResource( packet.constantBufferCount + i, packet.shaderResources[i] );
+            curShaderResources[i] = packet.shaderResources[i];
+            statistics.issuedBinds++;
+        }
+
+        if (packet.descriptorIndex != curDescriptorIndex && packet.descriptorIndex != DescriptorAllocator::INVALID_INDEX)
+        {
+            // Every pass draws from the one shader-visible heap, so it is bound at most once per command list
+            if (!bHeapBound)
+            {
+                sink.SetDescriptorHeap();
+                bHeapBound = true;
+
+                statistics.issuedBinds++;
+                statistics.heapSwitches++;
+            }
+
+            sink.SetDescriptorTable( packet.constantBufferCount + packet.shaderResourceCount, packet.descriptorIndex );
+            curDescriptorIndex = packet.descriptorIndex;
+            statistics.issuedBinds++;
+        }
+
+        if (packet.pPipelineState != pCurPipelineState)
+        {
+            sink.SetPipelineState( packet );
+            pCurPipelineState = packet.pPipelineState;
+            statistics.issuedBinds++;
+        }
+
+        sink.Draw( packet );
+
+        statistics.drawCount++;
+        statistics.triangleCount += packet.indexCount / 3;
+    }
+}
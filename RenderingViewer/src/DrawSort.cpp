@@ -0,0 +1,173 @@
+#include "DrawSort.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+    const uint32_t PASS_COUNT = 64 / DrawSort::RADIX_BITS;
+}
+
+DrawSort::DrawSort( uint32_t threadCount )
+    : m_threadCount( threadCount )
+    , m_skippedPasses( 0 )
+{
+    if (m_threadCount == 0)
+        m_threadCount = std::max( 1u, std::thread::hardware_concurrency() );
+}
+
+DrawSort::~DrawSort()
+{
+}
+
+void DrawSort::Sort( std::vector<Item>& items )
+{
+    m_skippedPasses = 0;
+
+    const size_t count = items.size();
+    if (count < 2)
+        return;
+
+    m_scratch.resize( count );
+
+    if (SortRange( items.data(), m_scratch.data(), count, GetSortThreads( count ) ))
+        items.swap( m_scratch );
+}
+
+void DrawSort::Sort( Item* pItems, size_t count )
+{
+    m_skippedPasses = 0;
+
+    if (count < 2)
+        return;
+
+    m_scratch.resize( count );
+
+    if (SortRange( pItems, m_scratch.data(), count, GetSortThreads( count ) ))
+        std::copy( m_scratch.begin(), m_scratch.begin() + count, pItems );
+}
+
+uint32_t DrawSort::GetSortThreads( size_t count ) const
+{
+    if (count < PARALLEL_THRESHOLD)
+        return 1;
+
+    return static_cast<uint32_t>(std::min<size_t>( m_threadCount, count ));
+}
+
+bool DrawSort::SortRange( Item* pItems, Item* pScratch, size_t count, uint32_t threadCount )
+{
+    m_histograms.resize( static_cast<size_t>(threadCount) * RADIX_SIZE );
+
+    uint32_t skippedPasses = 0;
+    bool     bInScratch    = false;
+
+    Item*    pSrc  = pItems;
+    Item*    pDst  = pScratch;
+    uint32_t shift = 0;
+
+    // Each chunk counts its digits, then the offsets are summed here and each chunk scatters. Chunks are
+    // scattered in order, which keeps the sort stable.
+    auto countDigits = [&]( uint32_t chunk )
+    {
+        const size_t begin = count * chunk / threadCount;
+        const size_t end   = count * (chunk + 1) / threadCount;
+
+        size_t* pHistogram = &m_histograms[static_cast<size_t>(chunk) * RADIX_SIZE];
+        std::fill( pHistogram, pHistogram + RADIX_SIZE, 0 );
+        for (size_t i = begin; i < end; ++i)
+        {
+            pHistogram[(pSrc[i].key >> shift) & (RADIX_SIZE - 1)]++;
+        }
+    };
+
+    auto scatterDigits = [&]( uint32_t chunk )
+    {
+        const size_t begin = count * chunk / threadCount;
+        const size_t end   = count * (chunk + 1) / threadCount;
+
+        size_t* pOffsets = &m_histograms[static_cast<size_t>(chunk) * RADIX_SIZE];
+        for (size_t i = begin; i < end; ++i)
+        {
+            const uint32_t digit = static_cast<uint32_t>((pSrc[i].key >> shift) & (RADIX_SIZE - 1));
+            pDst[pOffsets[digit]++] = pSrc[i];
+        }
+    };
+
+    JobSystem& jobs = JobSystem::GetInstance();
+
+    for (uint32_t pass = 0; pass < PASS_COUNT; ++pass)
+    {
+        shift = pass * RADIX_BITS;
+
+        jobs.ParallelFor( threadCount, countDigits, 1 );
+
+        // Histograms become the chunks' first offsets for each digit
+        size_t total = 0;
+        bool   bSkip = false;
+        for (uint32_t digit = 0; digit < RADIX_SIZE && !bSkip; ++digit)
+        {
+            const size_t digitBegin = total;
+            for (uint32_t chunk = 0; chunk < threadCount; ++chunk)
+            {
+                size_t& value = m_histograms[static_cast<size_t>(chunk) * RADIX_SIZE + digit];
+                const size_t chunkCount = value;
+                value = total;
+                total += chunkCount;
+            }
+
+            bSkip = total - digitBegin == count;
+        }
+
+        if (bSkip)
+        {
+            skippedPasses++;
+            continue;
+        }
+
+        jobs.ParallelFor( threadCount, scatterDigits, 1 );
+
+        std::swap( pSrc, pDst );
+        bInScratch = !bInScratch;
+    }
+
+    m_skippedPasses = skippedPasses;
+
+    return bInScratch;
+}
+
+DrawSort::StateChanges DrawSort::CountStateChanges( const Item* pItems, size_t count )
+{
+    StateChanges changes;
+
+    // The first item binds everything
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint64_t key = pItems[i].key;
+        const bool     bFirst = i == 0;
+        const uint64_t prev = bFirst ? 0 : pItems[i - 1].key;
+
+        if (bFirst || DrawKey::GetPass( key ) != DrawKey::GetPass( prev ))
+            changes.pass++;
+        if (bFirst || DrawKey::GetPipeline( key ) != DrawKey::GetPipeline( prev ))
+            changes.pipeline++;
+        if (bFirst || DrawKey::GetMaterial( key ) != DrawKey::GetMaterial( prev ))
+            changes.material++;
+        if (bFirst || DrawKey::GetMesh( key ) != DrawKey::GetMesh( prev ))
+            changes.mesh++;
+    }
+
+    return changes;
+}
+
+bool DrawSort::IsSorted( const Item* pItems, size_t count )
+{
+    for (size_t i = 1; i < count; ++i)
+    {
+        if (pItems[i - 1].key > pItems[i].key)
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,111 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+
+FrameArena::FrameArena( size_t capacity )
+    : m_current( 0 )
+    , m_frameIndex( 0 )
+    , m_capacity( capacity )
+{
+    for (Buffer& buffer : m_buffers)
+    {
+        buffer.data.resize( m_capacity );
+    }
+
+    m_statistics.capacity = m_capacity;
+}
+
+FrameArena::~FrameArena()
+{
+    for (Buffer& buffer : m_buffers)
+    {
+        Rewind( buffer );
+    }
+}
+
+void FrameArena::BeginFrame()
+{
+    const size_t frameBytes = GetUsedBytes( m_buffers[m_current] );
+    m_statistics.frameBytes = frameBytes;
+    m_statistics.peakBytes  = std::max( m_statistics.peakBytes, frameBytes );
+
+    m_capacity = std::max( m_capacity, frameBytes );
+
+    m_current = 1 - m_current;
+    m_frameIndex++;
+
+    Buffer& buffer = m_buffers[m_current];
+    Rewind( buffer );
+
+    if (buffer.data.size() < m_capacity)
+    {
+        // Replaced, not resized: nothing in it has to survive
+        std::vector<unsigned char>( m_capacity ).swap( buffer.data );
+        m_statistics.grows++;
+    }
+
+    m_statistics.capacity = std::min( m_buffers[0].data.size(), m_buffers[1].data.size() );
+}
+
+void* FrameArena::Allocate( size_t size, size_t alignment )
+{
+    if (size == 0)
+        return nullptr;
+
+    Buffer& buffer = m_buffers[m_current];
+
+    const uintptr_t base     = reinterpret_cast<uintptr_t>(buffer.data.data());
+    const size_t    capacity = buffer.data.size();
+
+    size_t offset = buffer.offset.load( std::memory_order_relaxed );
+    for (;;)
+    {
+        const size_t padding = static_cast<size_t>(0 - (base + offset)) & (alignment - 1);
+        const size_t end     = offset + padding + size;
+        if (end > capacity || end < offset)
+            return AllocateOverflow( buffer, size, alignment );
+
+        if (buffer.offset.compare_exchange_weak( offset, end, std::memory_order_relaxed ))
+            return buffer.data.data() + offset + padding;
+    }
+}
+
+size_t FrameArena::GetFrameBytes() const
+{
+    return GetUsedBytes( m_buffers[m_current] );
+}
+
+size_t FrameArena::GetUsedBytes( const Buffer& buffer ) const
+{
+    return buffer.offset.load( std::memory_order_relaxed ) + buffer.overflowBytes;
+}
+
+void* FrameArena::AllocateOverflow( Buffer& buffer, size_t size, size_t alignment )
+{
+    // Worst-case padding, so the buffer grown to this frame's bytes fits the same requests
+    const size_t blockSize = size + alignment - 1;
+    unsigned char* pBlock = new unsigned char[blockSize];
+
+    std::lock_guard<std::mutex> lock( m_overflowMutex );
+
+    buffer.overflow.push_back( pBlock );
+    buffer.overflowBytes += blockSize;
+
+    m_statistics.overflowAllocations++;
+    m_statistics.overflowBytes += blockSize;
+
+    const uintptr_t address = reinterpret_cast<uintptr_t>(pBlock);
+    return pBlock + (static_cast<size_t>(0 - address) & (alignment - 1));
+}
+
+void FrameArena::Rewind( Buffer& buffer )
+{
+    for (unsigned char* pBlock : buffer.overflow)
+    {
+        delete[] pBlock;
+    }
+    buffer.overflow.clear();
+
+    buffer.overflowBytes = 0;
+    buffer.offset        = 0;
+}
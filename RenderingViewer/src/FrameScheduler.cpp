@@ -0,0 +1,79 @@
+#include "FrameScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+FrameScheduler::FrameScheduler( Clock clock )
+    : m_clock( clock )
+    , m_dirty( INVALIDATE_ALL )
+    , m_pendingWork( 0 )
+    , m_bPolling( false )
+    , m_bContinuous( false )
+    , m_pendingInterval( 1.0 / 60.0 )
+    , m_lastFrameTime( 0.0 )
+    , m_lastIterationTime( 0.0 )
+{
+    if (!m_clock)
+    {
+        m_clock = []()
+        {
+            return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+        };
+    }
+
+    m_lastFrameTime     = Now() - m_pendingInterval;
+    m_lastIterationTime = m_lastFrameTime;
+}
+
+FrameScheduler::~FrameScheduler()
+{
+}
+
+double FrameScheduler::Now() const
+{
+    return m_clock();
+}
+
+bool FrameScheduler::BeginIteration()
+{
+    const double now = Now();
+
+    m_statistics.iterations++;
+    m_lastIterationTime = now;
+
+    // Pending work advances at the pending interval, not at the rate the loop happens to wake
+    const bool bPendingDue = m_pendingWork > 0 && now - m_lastFrameTime >= m_pendingInterval;
+    if (m_dirty == 0 && !bPendingDue && !m_bContinuous)
+        return false;
+
+    if (m_dirty == 0)
+        m_statistics.pendingFrames++;
+
+    for (uint32_t i = 0; i < INVALIDATE_REASON_NUM; ++i)
+    {
+        if (m_dirty & (1u << i))
+            m_statistics.reasonFrames[i]++;
+    }
+
+    m_statistics.frames++;
+    m_dirty         = 0;
+    m_lastFrameTime = now;
+
+    return true;
+}
+
+uint32_t FrameScheduler::GetWaitMilliseconds() const
+{
+    if (m_dirty != 0 || m_bContinuous)
+        return 0;
+
+    if (m_pendingWork == 0 && !m_bPolling)
+        return WAIT_INFINITE;
+
+    const double now  = Now();
+    const double last = m_pendingWork > 0 ? m_lastFrameTime : m_lastIterationTime;
+    const double wait = std::max( 0.0, last + m_pendingInterval - now );
+
+    return static_cast<uint32_t>(std::ceil( wait * 1000.0 ));
+}
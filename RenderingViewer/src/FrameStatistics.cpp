@@ -0,0 +1,377 @@
+#include "FrameStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    const char* METRIC_NAMES[FrameStatistics::METRIC_PASS] =
+    {
+        "cpu",
+        "draws",
+        "triangles",
+        "upload bytes",
+        "allocations",
+    };
+
+    // Smallest value at or above the given share of the sorted samples
+    double GetRank( const std::vector<double>& sorted, double share )
+    {
+        const size_t rank = static_cast<size_t>(std::ceil( share * sorted.size() ));
+        return sorted[std::min( std::max<size_t>( rank, 1 ), sorted.size() ) - 1];
+    }
+
+    bool ParseDouble( const char*& pCursor, double& value )
+    {
+        char* pEnd = nullptr;
+        value = strtod( pCursor, &pEnd );
+        if (pEnd == pCursor)
+            return false;
+
+        pCursor = pEnd;
+        return true;
+    }
+}
+
+FrameStatistics::FrameStatistics( uint32_t windowFrames )
+    : m_windowFrames( std::max( 1u, windowFrames ) )
+    , m_samples( static_cast<size_t>(m_windowFrames) * METRIC_NUM, 0.0 )
+    , m_nextFrame( 0 )
+    , m_windowCount( 0 )
+    , m_frameCount( 0 )
+{
+}
+
+uint32_t FrameStatistics::AddPass( const char* name )
+{
+    for (uint32_t i = 0; i < m_passNames.size(); ++i)
+    {
+        if (m_passNames[i] == name)
+            return i;
+    }
+
+    if (m_passNames.size() >= MAX_PASSES)
+        return INVALID_PASS;
+
+    m_passNames.push_back( name );
+    return static_cast<uint32_t>(m_passNames.size() - 1);
+}
+
+void FrameStatistics::AddFrame( const Frame& frame )
+{
+    double* pSamples = &m_samples[static_cast<size_t>(m_nextFrame) * METRIC_NUM];
+    pSamples[METRIC_CPU_TIME]     = frame.cpuMilliseconds;
+    pSamples[METRIC_DRAWS]        = static_cast<double>(frame.draws);
+    pSamples[METRIC_TRIANGLES]    = static_cast<double>(frame.triangles);
+    pSamples[METRIC_UPLOAD_BYTES] = static_cast<double>(frame.uploadBytes);
+    pSamples[METRIC_ALLOCATIONS]  = static_cast<double>(frame.allocations);
+    for (uint32_t i = 0; i < MAX_PASSES; ++i)
+    {
+        pSamples[METRIC_PASS + i] = frame.passMilliseconds[i];
+    }
+
+    m_nextFrame   = (m_nextFrame + 1) % m_windowFrames;
+    m_windowCount = std::min( m_windowCount + 1, m_windowFrames );
+    m_frameCount++;
+}
+
+void FrameStatistics::Clear()
+{
+    m_nextFrame   = 0;
+    m_windowCount = 0;
+    m_frameCount  = 0;
+}
+
+std::string FrameStatistics::GetMetricName( uint32_t metric ) const
+{
+    if (metric < METRIC_PASS)
+        return METRIC_NAMES[metric];
+
+    return metric < GetMetricCount() ? m_passNames[metric - METRIC_PASS] : std::string();
+}
+
+FrameStatistics::Percentiles FrameStatistics::GetPercentiles( uint32_t metric ) const
+{
+    Percentiles percentiles;
+    if (m_windowCount == 0 || metric >= METRIC_NUM)
+        return percentiles;
+
+    // Order does not matter here, so the ring is read from its start
+    std::vector<double> sorted( m_windowCount );
+    double sum = 0.0;
+    for (uint32_t i = 0; i < m_windowCount; ++i)
+    {
+        sorted[i] = GetSample( metric, i );
+        sum += sorted[i];
+    }
+    std::sort( sorted.begin(), sorted.end() );
+
+    percentiles.p50  = GetRank( sorted, 0.50 );
+    percentiles.p95  = GetRank( sorted, 0.95 );
+    percentiles.p99  = GetRank( sorted, 0.99 );
+    percentiles.max  = sorted.back();
+    percentiles.mean = sum / m_windowCount;
+
+    return percentiles;
+}
+
+FrameStatistics::Histogram FrameStatistics::GetHistogram( uint32_t metric, double bucketWidth, uint32_t bucketCount ) const
+{
+    Histogram histogram;
+    histogram.bucketWidth = bucketWidth;
+    histogram.counts.assign( bucketCount, 0 );
+    if (bucketCount == 0 || bucketWidth <= 0.0 || metric >= METRIC_NUM)
+        return histogram;
+
+    for (uint32_t i = 0; i < m_windowCount; ++i)
+    {
+        const double bucket = std::floor( GetSample( metric, i ) / bucketWidth );
+        histogram.counts[bucket < 0.0 ? 0 : static_cast<uint32_t>(std::min<double>( bucket, bucketCount - 1 ))]++;
+    }
+
+    return histogram;
+}
+
+void FrameStatistics::WriteReport( std::ostream& stream ) const
+{
+    const std::ios::fmtflags flags     = stream.flags();
+    const std::streamsize    precision = stream.precision();
+
+    stream << "Frame statistics: " << m_windowCount << " frames of " << m_frameCount << std::endl;
+    for (uint32_t metric = 0; metric < GetMetricCount(); ++metric)
+    {
+        const Percentiles percentiles = GetPercentiles( metric );
+        const char*       unit        = IsTimeMetric( metric ) ? " ms" : "";
+
+        stream << std::fixed << std::setprecision( IsTimeMetric( metric ) ? 3 : 0 )
+               << "  " << std::left << std::setw( 16 ) << GetMetricName( metric ) << std::right
+               << " p50 " << percentiles.p50 << unit << ", p95 " << percentiles.p95 << unit << ", p99 " << percentiles.p99 << unit
+               << ", max " << percentiles.max << unit << std::endl;
+    }
+
+    stream.flags( flags );
+    stream.precision( precision );
+}
+
+void FrameStatistics::WriteHistogram( std::ostream& stream, uint32_t metric, double bucketWidth, uint32_t bucketCount ) const
+{
+    const uint32_t BAR_WIDTH = 40;
+
+    const Histogram histogram = GetHistogram( metric, bucketWidth, bucketCount );
+    if (histogram.counts.empty())
+        return;
+
+    const uint32_t fullest = *std::max_element( histogram.counts.begin(), histogram.counts.end() );
+
+    const std::ios::fmtflags flags     = stream.flags();
+    const std::streamsize    precision = stream.precision();
+    stream << std::fixed << std::setprecision( 1 );
+
+    stream << "  " << GetMetricName( metric ) << " histogram" << std::endl;
+    for (uint32_t i = 0; i < histogram.counts.size(); ++i)
+    {
+        if (histogram.counts[i] == 0)
+            continue;
+
+        std::ostringstream range;
+        range << std::fixed << std::setprecision( 1 ) << i * bucketWidth;
+        if (i + 1 < histogram.counts.size())
+            range << " - " << (i + 1) * bucketWidth;
+        else
+            range << " +";
+
+        stream << "    " << std::setw( 16 ) << range.str() << std::setw( 8 ) << histogram.counts[i] << " "
+               << std::string( (static_cast<uint64_t>(histogram.counts[i]) * BAR_WIDTH + fullest - 1) / fullest, '#' ) << std::endl;
+    }
+
+    stream.flags( flags );
+    stream.precision( precision );
+}
+
+FrameBaseline::FrameBaseline()
+    : m_frameCount( 0 )
+{
+}
+
+void FrameBaseline::Capture( const FrameStatistics& statistics )
+{
+    m_entries.clear();
+    m_frameCount = statistics.GetWindowCount();
+
+    for (uint32_t metric = 0; metric < statistics.GetMetricCount(); ++metric)
+    {
+        Entry entry;
+        entry.name        = statistics.GetMetricName( metric );
+        entry.bTime       = FrameStatistics::IsTimeMetric( metric );
+        entry.percentiles = statistics.GetPercentiles( metric );
+        m_entries.push_back( entry );
+    }
+}
+
+bool FrameBaseline::Write( const std::string& path )
+{
+    m_error.clear();
+
+    FILE* pFile = fopen( path.c_str(), "w" );
+    if (pFile == nullptr)
+    {
+        m_error = "Failed to open " + path;
+        return false;
+    }
+
+    // %.17g round-trips every double exactly
+    fprintf( pFile, "# Frame baseline: unit p50 p95 p99 max mean name\n" );
+    fprintf( pFile, "frames %llu\n", static_cast<unsigned long long>(m_frameCount) );
+    for (const Entry& entry : m_entries)
+    {
+        const FrameStatistics::Percentiles& p = entry.percentiles;
+        fprintf( pFile, "%s %.17g %.17g %.17g %.17g %.17g %s\n",
+                 entry.bTime ? "ms" : "count", p.p50, p.p95, p.p99, p.max, p.mean, entry.name.c_str() );
+    }
+
+    const bool bSucceeded = ferror( pFile ) == 0 && fclose( pFile ) == 0;
+    if (!bSucceeded)
+        m_error = "Failed to write " + path;
+
+    return bSucceeded;
+}
+
+bool FrameBaseline::Read( const std::string& path )
+{
+    m_error.clear();
+    m_entries.clear();
+    m_frameCount = 0;
+
+    std::ifstream file( path.c_str() );
+    if (!file)
+    {
+        m_error = "Failed to open " + path;
+        return false;
+    }
+
+    std::string line;
+    size_t      lineNumber = 0;
+    while (std::getline( file, line ))
+    {
+        lineNumber++;
+
+        const char* pCursor = line.c_str();
+        bool bParsed = true;
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        else if (line.compare( 0, 7, "frames " ) == 0)
+        {
+            m_frameCount = strtoull( pCursor + 7, nullptr, 10 );
+        }
+        else if (line.compare( 0, 3, "ms " ) == 0 || line.compare( 0, 6, "count " ) == 0)
+        {
+            Entry entry;
+            entry.bTime = line[0] == 'm';
+            pCursor += entry.bTime ? 3 : 6;
+
+            FrameStatistics::Percentiles& p = entry.percentiles;
+            bParsed = ParseDouble( pCursor, p.p50 ) && ParseDouble( pCursor, p.p95 ) && ParseDouble( pCursor, p.p99 ) &&
+                      ParseDouble( pCursor, p.max ) && ParseDouble( pCursor, p.mean ) && *pCursor == ' ' && pCursor[1] != '\0';
+            if (bParsed)
+            {
+                entry.name = pCursor + 1;
+                m_entries.push_back( entry );
+            }
+        }
+        else
+        {
+            bParsed = false;
+        }
+
+        if (!bParsed)
+        {
+            std::ostringstream message;
+            message << path << "(" << lineNumber << "): unexpected line";
+            m_error = message.str();
+            m_entries.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool FrameBaseline::Compare( const FrameBaseline& current, const Tolerances& tolerances, std::vector<Comparison>& comparisons ) const
+{
+    comparisons.clear();
+
+    bool bPassed = true;
+    for (const Entry& entry : m_entries)
+    {
+        Tolerance tolerance = entry.bTime ? tolerances.time : tolerances.count;
+        for (const auto& metric : tolerances.metrics)
+        {
+            if (metric.first == entry.name)
+                tolerance = metric.second;
+        }
+
+        const Entry* pCurrent = current.Find( entry.name );
+
+        const char*   names[]     = { "p50", "p95" };
+        const double  baselines[] = { entry.percentiles.p50, entry.percentiles.p95 };
+        const double  currents[]  = { pCurrent != nullptr ? pCurrent->percentiles.p50 : 0.0, pCurrent != nullptr ? pCurrent->percentiles.p95 : 0.0 };
+        for (int i = 0; i < 2; ++i)
+        {
+            Comparison comparison;
+            comparison.name       = entry.name;
+            comparison.percentile = names[i];
+            comparison.baseline   = baselines[i];
+            comparison.current    = currents[i];
+            comparison.limit      = baselines[i] * (1.0 + tolerance.relative) + tolerance.absolute;
+            comparison.bMissing   = pCurrent == nullptr;
+            comparison.bRegressed = comparison.bMissing || comparison.current > comparison.limit;
+            comparisons.push_back( comparison );
+
+            bPassed &= !comparison.bRegressed;
+        }
+    }
+
+    return bPassed;
+}
+
+void FrameBaseline::WriteComparisons( std::ostream& stream, const std::vector<Comparison>& comparisons )
+{
+    const std::ios::fmtflags flags     = stream.flags();
+    const std::streamsize    precision = stream.precision();
+    stream << std::fixed << std::setprecision( 3 );
+
+    for (const Comparison& comparison : comparisons)
+    {
+        stream << "  " << std::left << std::setw( 16 ) << comparison.name << " " << comparison.percentile << std::right;
+        if (comparison.bMissing)
+        {
+            stream << " MISSING from this run" << std::endl;
+            continue;
+        }
+
+        const double change = comparison.baseline != 0.0 ? (comparison.current / comparison.baseline - 1.0) * 100.0 : 0.0;
+        stream << std::setw( 16 ) << comparison.baseline << " -> " << std::setw( 16 ) << comparison.current
+               << " (" << std::showpos << std::setprecision( 1 ) << change << std::noshowpos << std::setprecision( 3 )
+               << "%, limit " << comparison.limit << ")" << (comparison.bRegressed ? " REGRESSED" : "") << std::endl;
+    }
+
+    stream.flags( flags );
+    stream.precision( precision );
+}
+
+const FrameBaseline::Entry* FrameBaseline::Find( const std::string& name ) const
+{
+    for (const Entry& entry : m_entries)
+    {
+        if (entry.name == name)
+            return &entry;
+    }
+    return nullptr;
+}
@@ -0,0 +1,136 @@
+GeometryHeap::GeometryHeap( ID3D12Device* pDevice, UINT64 blockSize )
+    : m_pDevice( pDevice )
+{
+    MemoryTracker::GetInstance().SetOwnerName( this, "Geometry heap" );
+
+    // Vertex and index views need no more than 4 byte alignment, the granularity only bounds the node count
+    m_pAllocator = unique_ptr<BufferSuballocator>( new BufferSuballocator( *this, blockSize, BufferSuballocator::DEFAULT_GRANULARITY ) );
+}
+
+GeometryHeap::~GeometryHeap()
+{
+    // Destroys the blocks through this backend, so it goes before them
+    m_pAllocator.reset();
+
+    MemoryTracker::GetInstance().RemoveOwner( this );
+}
+
+BufferSuballocator::Handle GeometryHeap::Upload( const void* pData, UINT64 size, UINT64 alignment )
+{
+    lock_guard<mutex> lock( m_mutex );
+
+    const BufferSuballocator::Handle handle = m_pAllocator->Allocate( size, alignment );
+    if (handle == BufferSuballocator::INVALID_HANDLE)
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "GeometryHeap::Upload() Out of memory." );
+        return handle;
+    }
+
+    const BufferSuballocator::Location location = m_pAllocator->GetLocation( handle );
+    memcpy( m_blocks[location.block].pCPU + location.offset, pData, static_cast<size_t>(size) );
+
+    return handle;
+}
+
+void GeometryHeap::Free( BufferSuballocator::Handle handle )
+{
+    lock_guard<mutex> lock( m_mutex );
+    m_pAllocator->Free( handle );
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS GeometryHeap::GetGPUAddress( BufferSuballocator::Handle handle ) const
+{
+    const BufferSuballocator::Location location = m_pAllocator->GetLocation( handle );
+    if (location.block == BufferSuballocator::INVALID_HANDLE)
+        return 0;
+
+    return m_blocks[location.block].gpuAddress + location.offset;
+}
+
+bool GeometryHeap::CreateBlock( uint32_t block, uint64_t size )
+{
+    if (block >= m_blocks.size())
+        m_blocks.resize( block + 1 );
+
+    Block& b = m_blocks[block];
+
+    D3D12_HEAP_DESC heapDesc = {};
+    heapDesc.SizeInBytes                     = size;
+    heapDesc.Properties.Type                 = D3D12_HEAP_TYPE_UPLOAD;
+    heapDesc.Properties.CPUPageProperty      = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+    heapDesc.Properties.CreationNodeMask     = 1;
+    heapDesc.Properties.VisibleNodeMask      = 1;
+    heapDesc.Alignment                       = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    heapDesc.Flags                           = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+
+    HRESULT hr = m_pDevice->CreateHeap( &heapDesc, IID_PPV_ARGS( b.pHeap.ReleaseAndGetAddressOf() ) );
+    if (FAILED( hr ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "GeometryHeap::CreateHeap() Failed." );
+        b.pHeap.Reset();
+        return false;
+    }
+
+    D3D12_RESOURCE_DESC desc = {};
+    desc.Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER;
+    desc.Width            = size;
+    desc.Height           = 1;
+    desc.DepthOrArraySize = 1;
+    desc.MipLevels        = 1;
+    desc.Format           = DXGI_FORMAT_UNKNOWN;
+    desc.SampleDesc.Count = 1;
+    desc.Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    desc.Flags            = D3D12_RESOURCE_FLAG_NONE;
+
+    hr = m_pDevice->CreatePlacedResource( b.pHeap.Get(),
+                                          0,
+                                          &desc,
+                                          D3D12_RESOURCE_STATE_GENERIC_READ,
+                                          nullptr,
+                                          IID_PPV_ARGS( b.pResource.ReleaseAndGetAddressOf() ) );
+    if (FAILED( hr ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "GeometryHeap::CreatePlacedResource() Failed." );
+        b.pHeap.Reset();
+        b.pResource.Reset();
+        return false;
+    }
+
+    void* pCPU = nullptr;
+    D3D12_RANGE readRange = { 0, 0 };
+    hr = b.pResource->Map( 0, &readRange, &pCPU );
+    if (FAILED( hr ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "GeometryHeap::Map() Failed." );
+        b.pHeap.Reset();
+        b.pResource.Reset();
+        return false;
+    }
+
+    b.pCPU       = static_cast<unsigned char*>(pCPU);
+    b.gpuAddress = b.pResource->GetGPUVirtualAddress();
+    b.memory     = MemoryTracker::GetInstance().Track( MemoryTracker::CATEGORY_GEOMETRY, MemoryResourceDesc::Buffer( size ), this );
+
+    return true;
+}
+
+void GeometryHeap::DestroyBlock( uint32_t block )
+{
+    Block& b = m_blocks[block];
+    if (b.pResource != nullptr)
+        b.pResource->Unmap( 0, nullptr );
+
+    b.pResource.Reset();
+    b.pHeap.Reset();
+    b.pCPU       = nullptr;
+    b.gpuAddress = 0;
+    b.memory.Release();
+}
+
+void GeometryHeap::Copy( uint32_t srcBlock, uint64_t srcOffset, uint32_t dstBlock, uint64_t dstOffset, uint64_t size )
+{
+    // Upload heaps cannot be copy destinations on the GPU. Reading them back on the CPU is uncached and slow,
+    // which the byte budget of Defragment keeps small.
+    memcpy( m_blocks[dstBlock].pCPU + dstOffset, m_blocks[srcBlock].pCPU + srcOffset, static_cast<size_t>(size) );
+}
@@ -0,0 +1,112 @@
+namespace
+{
+    const UINT STAGING_HEAP_SIZE = 256;
+}
+
+GlobalDescriptorHeap::GlobalDescriptorHeap( ID3D12Device* pDevice, UINT persistentCount, UINT transientCountPerFrame, UINT frameCount )
+    : m_descriptorSize( 0 )
+    , m_allocator( persistentCount, transientCountPerFrame, frameCount )
+    , m_stagingCount( STAGING_HEAP_SIZE )
+{
+    D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+    desc.NumDescriptors = m_allocator.GetCapacity();
+    desc.Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    desc.Type           = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+
+    HRESULT hr = pDevice->CreateDescriptorHeap( &desc, IID_PPV_ARGS( m_pHeap.ReleaseAndGetAddressOf() ) );
+    if (FAILED( hr ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "GlobalDescriptorHeap::CreateDescriptorHeap() Failed." );
+        return;
+    }
+
+    m_descriptorSize = pDevice->GetDescriptorHandleIncrementSize( D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV );
+
+    MemoryTracker& tracker = MemoryTracker::GetInstance();
+    tracker.SetOwnerName( this, "Global descriptor heap" );
+    m_heapMemory = tracker.Track( MemoryTracker::CATEGORY_DESCRIPTORS, MemoryResourceDesc::DescriptorHeap( desc.NumDescriptors, m_descriptorSize ), this );
+}
+
+GlobalDescriptorHeap::~GlobalDescriptorHeap()
+{
+    m_heapMemory.Release();
+    m_stagingMemory.clear();
+
+    MemoryTracker::GetInstance().RemoveOwner( this );
+}
+
+bool GlobalDescriptorHeap::CreateView( ID3D12Device* pDevice, shared_ptr<Buffer> pBuffer, Buffer::BUFFER_VIEW_TYPE type, UINT index )
+{
+    if (m_pHeap == nullptr || index >= m_allocator.GetCapacity())
+        return false;
+
+    D3D12_CPU_DESCRIPTOR_HANDLE srcHandle;
+    if (!GetStagingView( pDevice, pBuffer, type, srcHandle ))
+        return false;
+
+    pDevice->CopyDescriptorsSimple( 1, GetCPUHandle( index ), srcHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV );
+
+    return true;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE GlobalDescriptorHeap::GetCPUHandle( UINT index ) const
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE handle = m_pHeap->GetCPUDescriptorHandleForHeapStart();
+    handle.ptr += static_cast<SIZE_T>(index) * m_descriptorSize;
+
+    return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE GlobalDescriptorHeap::GetGPUHandle( UINT index ) const
+{
+    D3D12_GPU_DESCRIPTOR_HANDLE handle = m_pHeap->GetGPUDescriptorHandleForHeapStart();
+    handle.ptr += static_cast<UINT64>(index) * m_descriptorSize;
+
+    return handle;
+}
+
+bool GlobalDescriptorHeap::GetStagingView( ID3D12Device* pDevice, shared_ptr<Buffer> pBuffer, Buffer::BUFFER_VIEW_TYPE type, D3D12_CPU_DESCRIPTOR_HANDLE& handle )
+{
+    // The same camera or light view is copied into many tables, so keep one staging copy per buffer
+    auto key = make_pair( static_cast<const Buffer*>(pBuffer.get()), type );
+
+    auto it = m_stagingViews.find( key );
+    if (it != m_stagingViews.end() && !it->second.pBuffer.expired())
+    {
+        handle = it->second.handle;
+        return true;
+    }
+
+    // Staging descriptors are only a copy source, so a full heap is simply replaced
+    if (m_stagingCount >= STAGING_HEAP_SIZE)
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+        desc.NumDescriptors = STAGING_HEAP_SIZE;
+        desc.Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+        desc.Type           = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+
+        shared_ptr<DescriptorHeap> pStagingHeap = make_shared<DescriptorHeap>();
+        pStagingHeap->Create( pDevice, desc );
+
+        m_pStagingHeaps.push_back( pStagingHeap );
+        m_stagingMemory.push_back( MemoryTracker::GetInstance().Track( MemoryTracker::CATEGORY_DESCRIPTORS,
+                                                                        MemoryResourceDesc::DescriptorHeap( STAGING_HEAP_SIZE, m_descriptorSize ), this ) );
+
+        m_stagingCount = 0;
+        m_stagingViews.clear();
+    }
+
+    const shared_ptr<DescriptorHeap>& pStagingHeap = m_pStagingHeaps.back();
+
+    pBuffer->CreateBufferView( pDevice, pStagingHeap, type );
+    m_stagingCount++;
+
+    handle = pBuffer->GetHandleFromHeap( pStagingHeap );
+
+    StagingView view;
+    view.pBuffer = pBuffer;
+    view.handle  = handle;
+    m_stagingViews[key] = view;
+
+    return true;
+}
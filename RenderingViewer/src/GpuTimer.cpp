@@ -0,0 +1,240 @@
+#include "GpuTimer.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+MockGpuTimestampQueries::MockGpuTimestampQueries( uint32_t capacity, uint64_t frequency )
+    : m_queries( capacity )
+    , m_frequency( frequency )
+    , m_clock( 0 )
+    , m_completedFence( 0 )
+    , m_earlyReads( 0 )
+{
+    for (Query& query : m_queries)
+    {
+        query.written    = 0;
+        query.resolved   = 0;
+        query.fenceValue = UNSUBMITTED;
+        query.bResolved  = false;
+    }
+}
+
+void MockGpuTimestampQueries::Submit( uint64_t fenceValue )
+{
+    for (uint32_t index : m_unsubmitted)
+    {
+        m_queries[index].fenceValue = fenceValue;
+    }
+    m_unsubmitted.clear();
+}
+
+void MockGpuTimestampQueries::Complete( uint64_t fenceValue )
+{
+    m_completedFence = std::max( m_completedFence, fenceValue );
+}
+
+void MockGpuTimestampQueries::WriteTimestamp( void* pCommandList, uint32_t index )
+{
+    (void)pCommandList;
+
+    if (index < m_queries.size())
+        m_queries[index].written = m_clock;
+}
+
+void MockGpuTimestampQueries::Resolve( void* pCommandList, uint32_t first, uint32_t count )
+{
+    (void)pCommandList;
+
+    for (uint32_t i = first; i < first + count && i < m_queries.size(); ++i)
+    {
+        m_queries[i].resolved   = m_queries[i].written;
+        m_queries[i].fenceValue = UNSUBMITTED;
+        m_queries[i].bResolved  = true;
+        m_unsubmitted.push_back( i );
+    }
+}
+
+bool MockGpuTimestampQueries::Read( uint32_t first, uint32_t count, uint64_t* pTimestamps )
+{
+    if (first + count > m_queries.size())
+        return false;
+
+    for (uint32_t i = first; i < first + count; ++i)
+    {
+        const Query& query = m_queries[i];
+        if (!query.bResolved || query.fenceValue == UNSUBMITTED || query.fenceValue > m_completedFence)
+        {
+            m_earlyReads++;
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        pTimestamps[i] = m_queries[first + i].resolved;
+    }
+
+    return true;
+}
+
+GpuTimer::GpuTimer( GpuTimestampQueries& queries )
+    : m_queries( queries )
+    , m_bValid( queries.GetCapacity() >= QUERY_COUNT && queries.GetFrequency() != 0 )
+    , m_frameIndex( 0 )
+    , m_bStarted( false )
+    , m_bTimed( false )
+    , m_timestamps( 2 * MAX_ZONES )
+{
+    for (Frame& frame : m_frames)
+    {
+        frame.zones.reserve( MAX_ZONES );
+    }
+    m_zoneTimes.reserve( MAX_ZONES );
+}
+
+uint32_t GpuTimer::BeginZone( void* pCommandList, const char* name )
+{
+    const uint32_t slot  = static_cast<uint32_t>(m_frameIndex % MAX_FRAMES);
+    Frame&         frame = m_frames[slot];
+
+    // The range is taken by the first zone of a frame; Update may have freed it earlier in the frame
+    if (!m_bStarted)
+    {
+        m_bStarted = true;
+        m_bTimed   = m_bValid && !frame.bInFlight;
+        if (m_bTimed)
+            frame.zones.clear();
+    }
+
+    if (!m_bTimed)
+        return INVALID_ZONE;
+
+    if (frame.zones.size() >= MAX_ZONES)
+    {
+        m_statistics.droppedZones++;
+        return INVALID_ZONE;
+    }
+
+    const uint32_t zone = static_cast<uint32_t>(frame.zones.size());
+
+    Zone entry;
+    entry.name   = name;
+    entry.bEnded = false;
+    frame.zones.push_back( entry );
+
+    m_queries.WriteTimestamp( pCommandList, GetQuery( slot, zone ) );
+
+    return zone;
+}
+
+void GpuTimer::EndZone( void* pCommandList, uint32_t zone )
+{
+    const uint32_t slot  = static_cast<uint32_t>(m_frameIndex % MAX_FRAMES);
+    Frame&         frame = m_frames[slot];
+
+    if (!m_bTimed || zone >= frame.zones.size() || frame.zones[zone].bEnded)
+        return;
+
+    const uint32_t query = GetQuery( slot, zone );
+    m_queries.WriteTimestamp( pCommandList, query + 1 );
+    m_queries.Resolve( pCommandList, query, 2 );
+
+    frame.zones[zone].bEnded = true;
+}
+
+void GpuTimer::EndFrame( uint64_t fenceValue )
+{
+    if (m_bStarted && !m_bTimed && m_bValid)
+        m_statistics.skippedFrames++;
+
+    Frame& frame = m_frames[m_frameIndex % MAX_FRAMES];
+    if (m_bTimed && !frame.zones.empty())
+    {
+        frame.frameIndex = m_frameIndex;
+        frame.fenceValue = fenceValue;
+        frame.bInFlight  = true;
+    }
+
+    m_frameIndex++;
+    m_bStarted = false;
+    m_bTimed   = false;
+
+    m_statistics.frames++;
+}
+
+uint32_t GpuTimer::Update( uint64_t completedFenceValue )
+{
+    // Fence values grow with the frames, so frames are read oldest first until one is still running
+    uint32_t readCount = 0;
+    for (;;)
+    {
+        uint32_t oldest = MAX_FRAMES;
+        for (uint32_t slot = 0; slot < MAX_FRAMES; ++slot)
+        {
+            if (m_frames[slot].bInFlight && (oldest == MAX_FRAMES || m_frames[slot].frameIndex < m_frames[oldest].frameIndex))
+                oldest = slot;
+        }
+
+        if (oldest == MAX_FRAMES || m_frames[oldest].fenceValue > completedFenceValue)
+            break;
+
+        ReadFrame( m_frames[oldest], oldest );
+        readCount++;
+    }
+
+    // Only the newest frame goes to the summary, so frames read together do not add up
+    if (readCount > 0 && !m_zoneTimes.empty())
+    {
+        Profiler::AddZone( "GPU", 0, m_statistics.lastMilliseconds );
+        for (const ZoneTime& zoneTime : m_zoneTimes)
+        {
+            Profiler::AddZone( zoneTime.name, 1, zoneTime.milliseconds );
+        }
+    }
+
+    return readCount;
+}
+
+void GpuTimer::ReadFrame( Frame& frame, uint32_t slot )
+{
+    frame.bInFlight = false;
+
+    const uint32_t count = static_cast<uint32_t>(frame.zones.size());
+    if (!m_queries.Read( GetQuery( slot, 0 ), count * 2, m_timestamps.data() ))
+    {
+        m_statistics.failedReads++;
+        return;
+    }
+
+    const double tickMilliseconds = 1000.0 / m_queries.GetFrequency();
+
+    m_zoneTimes.clear();
+
+    uint64_t first = ~0ull;
+    uint64_t last  = 0;
+    for (uint32_t zone = 0; zone < count; ++zone)
+    {
+        if (!frame.zones[zone].bEnded)
+        {
+            m_statistics.droppedZones++;
+            continue;
+        }
+
+        const uint64_t begin = m_timestamps[zone * 2];
+        const uint64_t end   = std::max( begin, m_timestamps[zone * 2 + 1] );
+        first = std::min( first, begin );
+        last  = std::max( last, end );
+
+        ZoneTime zoneTime;
+        zoneTime.name         = frame.zones[zone].name;
+        zoneTime.milliseconds = (end - begin) * tickMilliseconds;
+        m_zoneTimes.push_back( zoneTime );
+    }
+
+    const uint32_t latency = static_cast<uint32_t>(m_frameIndex - frame.frameIndex);
+
+    m_statistics.readFrames++;
+    m_statistics.lastLatency      = latency;
+    m_statistics.maxLatency       = std::max( m_statistics.maxLatency, latency );
+    m_statistics.lastMilliseconds = m_zoneTimes.empty() ? 0.0 : (last - first) * tickMilliseconds;
+}
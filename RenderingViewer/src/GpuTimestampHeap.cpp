@@ -0,0 +1,105 @@
+GpuTimestampHeap::GpuTimestampHeap( ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue, UINT capacity )
+    : m_capacity( capacity )
+    , m_frequency( 0 )
+{
+    D3D12_QUERY_HEAP_DESC queryDesc = {};
+    queryDesc.Type     = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    queryDesc.Count    = capacity;
+    queryDesc.NodeMask = 0;
+
+    HRESULT hr = pDevice->CreateQueryHeap( &queryDesc, IID_PPV_ARGS( m_pQueryHeap.ReleaseAndGetAddressOf() ) );
+    if (FAILED( hr ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "GpuTimestampHeap::CreateQueryHeap() Failed." );
+        m_pQueryHeap.Reset();
+        return;
+    }
+
+    D3D12_HEAP_PROPERTIES heapProps = {};
+    heapProps.Type                 = D3D12_HEAP_TYPE_READBACK;
+    heapProps.CPUPageProperty      = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+    heapProps.CreationNodeMask     = 1;
+    heapProps.VisibleNodeMask      = 1;
+
+    D3D12_RESOURCE_DESC desc = {};
+    desc.Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER;
+    desc.Width            = sizeof( UINT64 ) * capacity;
+    desc.Height           = 1;
+    desc.DepthOrArraySize = 1;
+    desc.MipLevels        = 1;
+    desc.Format           = DXGI_FORMAT_UNKNOWN;
+    desc.SampleDesc.Count = 1;
+    desc.Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    desc.Flags            = D3D12_RESOURCE_FLAG_NONE;
+
+    hr = pDevice->CreateCommittedResource( &heapProps,
+                                           D3D12_HEAP_FLAG_NONE,
+                                           &desc,
+                                           D3D12_RESOURCE_STATE_COPY_DEST,
+                                           nullptr,
+                                           IID_PPV_ARGS( m_pReadback.ReleaseAndGetAddressOf() ) );
+    if (FAILED( hr ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "GpuTimestampHeap::CreateCommittedResource() Failed." );
+        m_pReadback.Reset();
+        return;
+    }
+
+    MemoryTracker& tracker = MemoryTracker::GetInstance();
+    tracker.SetOwnerName( this, "GPU timestamps" );
+    m_readbackMemory = tracker.Track( MemoryTracker::CATEGORY_OTHER, MemoryResourceDesc::Buffer( desc.Width ), this );
+
+    hr = pCommandQueue->GetTimestampFrequency( &m_frequency );
+    if (FAILED( hr ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "GpuTimestampHeap::GetTimestampFrequency() Failed." );
+        m_frequency = 0;
+    }
+}
+
+GpuTimestampHeap::~GpuTimestampHeap()
+{
+    m_readbackMemory.Release();
+    MemoryTracker::GetInstance().RemoveOwner( this );
+}
+
+void GpuTimestampHeap::WriteTimestamp( void* pCommandList, uint32_t index )
+{
+    if (!IsValid())
+        return;
+
+    static_cast<ID3D12GraphicsCommandList*>(pCommandList)->EndQuery( m_pQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, index );
+}
+
+void GpuTimestampHeap::Resolve( void* pCommandList, uint32_t first, uint32_t count )
+{
+    if (!IsValid())
+        return;
+
+    static_cast<ID3D12GraphicsCommandList*>(pCommandList)->ResolveQueryData( m_pQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, first, count,
+                                                                              m_pReadback.Get(), sizeof( UINT64 ) * first );
+}
+
+bool GpuTimestampHeap::Read( uint32_t first, uint32_t count, uint64_t* pTimestamps )
+{
+    if (!IsValid() || first + count > m_capacity)
+        return false;
+
+    // Only the resolved range is mapped, and nothing is written back
+    D3D12_RANGE readRange = { sizeof( UINT64 ) * first, sizeof( UINT64 ) * (first + count) };
+    void* pData = nullptr;
+    HRESULT hr = m_pReadback->Map( 0, &readRange, &pData );
+    if (FAILED( hr ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "GpuTimestampHeap::Map() Failed." );
+        return false;
+    }
+
+    memcpy( pTimestamps, static_cast<const UINT8*>(pData) + readRange.Begin, sizeof( UINT64 ) * count );
+
+    D3D12_RANGE writeRange = { 0, 0 };
+    m_pReadback->Unmap( 0, &writeRange );
+
+    return true;
+}
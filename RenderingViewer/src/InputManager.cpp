@@ -2,11 +2,22 @@
     : m_pDInput( nullptr )
     , m_pDIKeyboard( nullptr )
     , m_pDIMouse( nullptr )
+    , m_sampler( *this )
 {
+    ZeroMemory( m_prevKeyboardBuffer, sizeof( m_prevKeyboardBuffer ) );
+    ZeroMemory( m_keyboardBuffer, sizeof( m_keyboardBuffer ) );
+    ZeroMemory( &m_prevMouseState, sizeof( m_prevMouseState ) );
+    ZeroMemory( &m_mouseState, sizeof( m_mouseState ) );
+
     InitDirectInput( hInst );
 
     InitKeyboard( hWnd, hInst );
-    InitMouse( hWnd, hInst );
+    if (!InitMouse( hWnd, hInst ))
+        return;
+
+    // New input wakes the message loop, which may be sleeping until the next invalidation
+    m_sampler.SetNotify( [hWnd]() { PostMessage( hWnd, WM_NULL, 0, 0 ); } );
+    m_sampler.Start();
 }
 
 
@@ -17,6 +28,9 @@ InputManager::~InputManager()
 
 void InputManager::Release()
 {
+    // The sampling thread reads the mouse device
+    m_sampler.Stop();
+
     if (m_pDIKeyboard != nullptr)
     {
         m_pDIKeyboard->Release();
@@ -144,11 +158,14 @@ void InputManager::ProcessMouse()
 {
     memcpy( &m_prevMouseState, &m_mouseState, sizeof( DIMOUSESTATE ) );
 
-    HRESULT hr = m_pDIMouse->GetDeviceState( sizeof( DIMOUSESTATE ), &m_mouseState );
-    if FAILED( hr )
+    m_sampler.Consume( m_inputFrame );
+
+    m_mouseState.lX = m_inputFrame.dx;
+    m_mouseState.lY = m_inputFrame.dy;
+    m_mouseState.lZ = m_inputFrame.dz;
+    for (int i = 0; i < _countof( m_mouseState.rgbButtons ); ++i)
     {
-        hr = m_pDIMouse->Acquire();
-        return;
+        m_mouseState.rgbButtons[i] = (m_inputFrame.buttons & (1u << i)) ? 0x80 : 0;
     }
 
 #if 0
@@ -165,6 +182,29 @@ void InputManager::ProcessMouse()
 #endif
 }
 
+bool InputManager::Sample( InputState& state )
+{
+    DIMOUSESTATE mouseState;
+    HRESULT hr = m_pDIMouse->GetDeviceState( sizeof( DIMOUSESTATE ), &mouseState );
+    if FAILED( hr )
+    {
+        hr = m_pDIMouse->Acquire();
+        return false;
+    }
+
+    state.dx      = mouseState.lX;
+    state.dy      = mouseState.lY;
+    state.dz      = mouseState.lZ;
+    state.buttons = 0;
+    for (int i = 0; i < _countof( mouseState.rgbButtons ); ++i)
+    {
+        if (mouseState.rgbButtons[i] & 0x80)
+            state.buttons |= 1u << i;
+    }
+
+    return true;
+}
+
 bool InputManager::CheckMouseButton( MOUSE_BUTTON button, ACTION_STATE state ) const
 {
     bool bStatus = false;
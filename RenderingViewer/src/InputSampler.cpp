@@ -0,0 +1,238 @@
+#include "InputSampler.h"
+
+#include <algorithm>
+#include <chrono>
+
+SyntheticInputSource::SyntheticInputSource()
+    : m_totalSamples( 0 )
+    , m_step( 0 )
+    , m_sampleCount( 0 )
+    , m_totalX( 0 )
+    , m_totalY( 0 )
+{
+}
+
+void SyntheticInputSource::AddStep( const InputState& state, uint32_t samples )
+{
+    m_totalSamples += samples;
+
+    Step step;
+    step.state     = state;
+    step.endSample = m_totalSamples;
+    m_steps.push_back( step );
+}
+
+void SyntheticInputSource::AddDrag( uint32_t buttons, int32_t dx, int32_t dy, uint32_t samples )
+{
+    const InputState state = { dx, dy, 0, buttons };
+    AddStep( state, samples );
+}
+
+void SyntheticInputSource::AddIdle( uint32_t samples )
+{
+    const InputState state = { 0, 0, 0, 0 };
+    AddStep( state, samples );
+}
+
+bool SyntheticInputSource::Sample( InputState& state )
+{
+    const uint64_t sample = m_sampleCount.load();
+    while (m_step < m_steps.size() && sample >= m_steps[m_step].endSample)
+    {
+        m_step++;
+    }
+
+    // Past the script the device rests
+    if (m_step < m_steps.size())
+    {
+        state = m_steps[m_step].state;
+    }
+    else
+    {
+        const InputState idle = { 0, 0, 0, 0 };
+        state = idle;
+    }
+
+    m_totalX += state.dx;
+    m_totalY += state.dy;
+    m_sampleCount++;
+
+    return true;
+}
+
+InputSampler::InputSampler( InputSource& source, Clock clock )
+    : m_source( source )
+    , m_clock( clock )
+    , m_head( 0 )
+    , m_tail( 0 )
+    , m_bPending( false )
+    , m_sampledButtons( 0 )
+    , m_consumedButtons( 0 )
+    , m_bRunning( false )
+    , m_samples( 0 )
+    , m_failedSamples( 0 )
+    , m_events( 0 )
+    , m_coalesced( 0 )
+{
+    if (!m_clock)
+    {
+        m_clock = []()
+        {
+            return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+        };
+    }
+}
+
+InputSampler::~InputSampler()
+{
+    Stop();
+}
+
+void InputSampler::Start( double rate )
+{
+    if (IsRunning() || !(rate > 0.0))
+        return;
+
+    m_bRunning = true;
+    m_thread   = std::thread( [this, rate]() { Loop( rate ); } );
+}
+
+void InputSampler::Stop()
+{
+    if (!IsRunning())
+        return;
+
+    m_bRunning = false;
+    m_thread.join();
+}
+
+void InputSampler::Loop( double rate )
+{
+    const std::chrono::steady_clock::duration period =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( 1.0 / rate ) );
+
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    while (m_bRunning)
+    {
+        SampleOnce();
+
+        // Late wake-ups do not turn into a burst of samples
+        next += period;
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (next < now)
+            next = now;
+
+        std::this_thread::sleep_until( next );
+    }
+}
+
+void InputSampler::SampleOnce()
+{
+    InputState state;
+    const bool bRead = m_source.Sample( state );
+    const double time = Now();
+
+    m_samples++;
+    if (!bRead)
+    {
+        m_failedSamples++;
+        return;
+    }
+
+    if (state.dx != 0 || state.dy != 0 || state.dz != 0 || state.buttons != m_sampledButtons)
+    {
+        m_sampledButtons = state.buttons;
+        m_events++;
+
+        // A full ring folds new events into the one waiting for space; motion is kept, button
+        // changes in between are lost
+        if (m_bPending)
+        {
+            m_pending.state.dx      += state.dx;
+            m_pending.state.dy      += state.dy;
+            m_pending.state.dz      += state.dz;
+            m_pending.state.buttons  = state.buttons;
+            m_coalesced++;
+        }
+        else
+        {
+            m_pending.time  = time;
+            m_pending.state = state;
+            m_bPending      = true;
+        }
+    }
+
+    if (m_bPending && Push( m_pending ))
+        m_bPending = false;
+}
+
+bool InputSampler::Push( const Event& event )
+{
+    const uint32_t head = m_head.load( std::memory_order_relaxed );
+    const uint32_t tail = m_tail.load( std::memory_order_acquire );
+    if (head - tail >= RING_SIZE)
+        return false;
+
+    m_ring[head % RING_SIZE] = event;
+    m_head.store( head + 1, std::memory_order_release );
+
+    if (head == tail && m_notify)
+        m_notify();
+
+    return true;
+}
+
+void InputSampler::Consume( Frame& frame )
+{
+    frame.Clear();
+
+    uint32_t       tail = m_tail.load( std::memory_order_relaxed );
+    const uint32_t head = m_head.load( std::memory_order_acquire );
+
+    uint32_t buttons = m_consumedButtons;
+    for (; tail != head; ++tail)
+    {
+        const Event& event = m_ring[tail % RING_SIZE];
+
+        frame.dx       += event.state.dx;
+        frame.dy       += event.state.dy;
+        frame.dz       += event.state.dz;
+        frame.pressed  |= event.state.buttons & ~buttons;
+        frame.released |= ~event.state.buttons & buttons;
+        buttons         = event.state.buttons;
+
+        if (frame.eventCount == 0)
+            frame.firstTime = event.time;
+        frame.lastTime = event.time;
+        frame.eventCount++;
+    }
+
+    m_tail.store( tail, std::memory_order_release );
+
+    m_consumedButtons = buttons;
+    frame.buttons     = buttons;
+}
+
+void InputSampler::RecordPresent( const Frame& frame, double presentTime )
+{
+    if (!frame.HasInput())
+        return;
+
+    const double latency = presentTime - frame.firstTime;
+
+    m_presentStatistics.presents++;
+    m_presentStatistics.latencySum     += latency;
+    m_presentStatistics.latencyMax      = std::max( m_presentStatistics.latencyMax, latency );
+    m_presentStatistics.lastLatencySum += presentTime - frame.lastTime;
+}
+
+InputSampler::Statistics InputSampler::GetStatistics() const
+{
+    Statistics stats = m_presentStatistics;
+    stats.samples       = m_samples.load();
+    stats.failedSamples = m_failedSamples.load();
+    stats.events        = m_events.load();
+    stats.coalesced     = m_coalesced.load();
+
+    return stats;
+}
@@ -0,0 +1,395 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Set on the workers; every other thread uses slot 0
+    thread_local const JobSystem* t_pJobSystem = nullptr;
+    thread_local uint32_t         t_slot       = 0;
+
+    // Rounds of stealing that found nothing before a worker sleeps
+    const uint32_t SPIN_COUNT = 64;
+}
+
+JobSystem::Deque::Deque()
+    : m_top( 0 )
+    , m_bottom( 0 )
+{
+    for (auto& job : m_jobs)
+    {
+        job.store( nullptr, std::memory_order_relaxed );
+    }
+}
+
+bool JobSystem::Deque::Push( Job* pJob )
+{
+    const int64_t bottom = m_bottom.load( std::memory_order_relaxed );
+    const int64_t top    = m_top.load( std::memory_order_acquire );
+    if (bottom - top >= static_cast<int64_t>(JOB_CAPACITY))
+        return false;
+
+    m_jobs[bottom & (JOB_CAPACITY - 1)].store( pJob, std::memory_order_relaxed );
+
+    // Thieves that see the new bottom see the job
+    std::atomic_thread_fence( std::memory_order_release );
+    m_bottom.store( bottom + 1, std::memory_order_relaxed );
+
+    return true;
+}
+
+JobSystem::Job* JobSystem::Deque::Pop()
+{
+    const int64_t bottom = m_bottom.load( std::memory_order_relaxed ) - 1;
+    m_bottom.store( bottom, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    int64_t top = m_top.load( std::memory_order_relaxed );
+
+    if (top > bottom)
+    {
+        m_bottom.store( bottom + 1, std::memory_order_relaxed );
+        return nullptr;
+    }
+
+    Job* pJob = m_jobs[bottom & (JOB_CAPACITY - 1)].load( std::memory_order_relaxed );
+    if (top == bottom)
+    {
+        // The last job, which a thief may be taking too; whoever moves top has it
+        if (!m_top.compare_exchange_strong( top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed ))
+            pJob = nullptr;
+
+        m_bottom.store( bottom + 1, std::memory_order_relaxed );
+    }
+
+    return pJob;
+}
+
+JobSystem::Job* JobSystem::Deque::Steal()
+{
+    int64_t top = m_top.load( std::memory_order_acquire );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    const int64_t bottom = m_bottom.load( std::memory_order_acquire );
+
+    if (top >= bottom)
+        return nullptr;
+
+    Job* pJob = m_jobs[top & (JOB_CAPACITY - 1)].load( std::memory_order_relaxed );
+    if (!m_top.compare_exchange_strong( top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed ))
+        return nullptr;
+
+    return pJob;
+}
+
+JobSystem::JobSystem( uint32_t workerCount )
+    : m_workerCount( workerCount )
+    , m_queued( 0 )
+    , m_sleeping( 0 )
+    , m_sleeps( 0 )
+    , m_bStop( false )
+{
+    if (m_workerCount == DEFAULT_WORKERS)
+        m_workerCount = std::max( 1u, std::thread::hardware_concurrency() ) - 1;
+
+    m_slots.reserve( m_workerCount + 1 );
+    for (uint32_t i = 0; i <= m_workerCount; ++i)
+    {
+        m_slots.push_back( std::unique_ptr<Slot>( new Slot() ) );
+    }
+
+    m_threads.reserve( m_workerCount );
+    for (uint32_t i = 0; i < m_workerCount; ++i)
+    {
+        m_threads.push_back( std::thread( &JobSystem::Loop, this, i + 1 ) );
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_bStop = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+JobSystem& JobSystem::GetInstance()
+{
+    static JobSystem jobSystem;
+    return jobSystem;
+}
+
+void JobSystem::ParallelFor( uint32_t count, uint32_t grain, Function function, void* pContext )
+{
+    if (count == 0)
+        return;
+
+    if (grain == 0)
+        grain = std::max( 1u, count / (GetThreadCount() * 4) );
+
+    // Half a ring, so a nested ParallelFor still finds room
+    grain = std::max( grain, (count + JOB_CAPACITY / 2 - 1) / (JOB_CAPACITY / 2) );
+
+    if (m_workerCount == 0 || count <= grain)
+    {
+        function( pContext, 0, count );
+        return;
+    }
+
+    // The caller takes the first range and then helps with the rest
+    Counter counter;
+    for (uint32_t begin = grain; begin < count; begin += std::min( grain, count - begin ))
+    {
+        Submit( function, pContext, begin, begin + std::min( grain, count - begin ), &counter );
+    }
+
+    function( pContext, 0, grain );
+
+    Wait( counter );
+}
+
+void JobSystem::Submit( Function function, void* pContext, uint32_t begin, uint32_t end, Counter* pCounter, Counter* pDependency )
+{
+    const uint32_t slot = GetSlot();
+
+    Job* pJob = AllocateJob( slot );
+    pJob->function     = function;
+    pJob->pContext     = pContext;
+    pJob->begin        = begin;
+    pJob->end          = end;
+    pJob->pCounter     = pCounter;
+    pJob->pNextWaiting = nullptr;
+
+    if (pCounter != nullptr)
+        pCounter->m_value++;
+
+    if (pDependency != nullptr)
+    {
+        std::lock_guard<std::mutex> lock( pDependency->m_mutex );
+        if (pDependency->m_value > 0)
+        {
+            pJob->pNextWaiting      = pDependency->m_pWaiting;
+            pDependency->m_pWaiting = pJob;
+            return;
+        }
+    }
+
+    Push( slot, pJob );
+}
+
+void JobSystem::Wait( Counter& counter )
+{
+    const uint32_t slot = GetSlot();
+
+    while (counter.m_value > 0)
+    {
+        Job* pJob = Take( slot );
+        if (pJob != nullptr)
+            Execute( slot, pJob );
+        else
+            std::this_thread::yield();
+    }
+
+    // The Finish that reached zero may still hold the lock
+    std::lock_guard<std::mutex> lock( counter.m_mutex );
+}
+
+JobSystem::Statistics JobSystem::GetStatistics() const
+{
+    Statistics statistics;
+    for (const auto& pSlot : m_slots)
+    {
+        statistics.jobs       += pSlot->jobCount.load( std::memory_order_relaxed );
+        statistics.steals     += pSlot->stealCount.load( std::memory_order_relaxed );
+        statistics.inlineJobs += pSlot->inlineCount.load( std::memory_order_relaxed );
+    }
+    statistics.sleeps = m_sleeps.load( std::memory_order_relaxed );
+
+    return statistics;
+}
+
+uint32_t JobSystem::GetSlot() const
+{
+    return t_pJobSystem == this ? t_slot : 0;
+}
+
+JobSystem::Job* JobSystem::AllocateJob( uint32_t slot )
+{
+    Slot& s = *m_slots[slot];
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock( m_externalMutex, std::defer_lock );
+            if (slot == 0)
+                lock.lock();
+
+            Job& job = s.jobs[s.nextJob % JOB_CAPACITY];
+            if (!job.bBusy.load( std::memory_order_acquire ))
+            {
+                job.bBusy.store( true, std::memory_order_relaxed );
+                s.nextJob++;
+                return &job;
+            }
+        }
+
+        // The oldest job of the ring has not run yet; help until it has
+        Job* pJob = Take( slot );
+        if (pJob != nullptr)
+            Execute( slot, pJob );
+        else
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::Push( uint32_t slot, Job* pJob )
+{
+    bool bPushed;
+    if (slot == 0)
+    {
+        std::lock_guard<std::mutex> lock( m_externalMutex );
+        bPushed = m_slots[0]->deque.Push( pJob );
+    }
+    else
+    {
+        bPushed = m_slots[slot]->deque.Push( pJob );
+    }
+
+    if (!bPushed)
+    {
+        m_slots[slot]->inlineCount.fetch_add( 1, std::memory_order_relaxed );
+        Execute( slot, pJob );
+        return;
+    }
+
+    // A worker about to sleep either sees the job or is counted here; taking the lock orders the notify
+    // after its check
+    m_queued++;
+    if (m_sleeping > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+        }
+        m_wake.notify_one();
+    }
+}
+
+JobSystem::Job* JobSystem::Take( uint32_t slot )
+{
+    Job* pJob;
+    if (slot == 0)
+    {
+        std::lock_guard<std::mutex> lock( m_externalMutex );
+        pJob = m_slots[0]->deque.Pop();
+    }
+    else
+    {
+        pJob = m_slots[slot]->deque.Pop();
+    }
+
+    if (pJob == nullptr)
+    {
+        const uint32_t slotCount = static_cast<uint32_t>(m_slots.size());
+        for (uint32_t i = 1; i < slotCount && pJob == nullptr; ++i)
+        {
+            pJob = m_slots[(slot + i) % slotCount]->deque.Steal();
+        }
+
+        if (pJob != nullptr)
+            m_slots[slot]->stealCount.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    if (pJob != nullptr)
+        m_queued--;
+
+    return pJob;
+}
+
+void JobSystem::Execute( uint32_t slot, Job* pJob )
+{
+    const Function function = pJob->function;
+    void*          pContext = pJob->pContext;
+    const uint32_t begin    = pJob->begin;
+    const uint32_t end      = pJob->end;
+    Counter*       pCounter = pJob->pCounter;
+
+    // The ring may reuse the job from here on. Freed before it runs, as a job that submits a ring's worth of
+    // jobs from its own thread would otherwise wait on itself.
+    pJob->bBusy.store( false, std::memory_order_release );
+
+    function( pContext, begin, end );
+
+    m_slots[slot]->jobCount.fetch_add( 1, std::memory_order_relaxed );
+
+    if (pCounter != nullptr)
+        Finish( slot, *pCounter );
+}
+
+void JobSystem::Finish( uint32_t slot, Counter& counter )
+{
+    Job* pWaiting = nullptr;
+    {
+        std::lock_guard<std::mutex> lock( counter.m_mutex );
+        if (--counter.m_value == 0)
+        {
+            pWaiting           = counter.m_pWaiting;
+            counter.m_pWaiting = nullptr;
+        }
+    }
+
+    // The counter may be gone from here on
+    while (pWaiting != nullptr)
+    {
+        Job* pNext = pWaiting->pNextWaiting;
+        Push( slot, pWaiting );
+        pWaiting = pNext;
+    }
+}
+
+void JobSystem::Loop( uint32_t slot )
+{
+    t_pJobSystem = this;
+    t_slot       = slot;
+
+    // Takes the thread's profiler buffer now rather than in the first profiled job
+    Profiler::SetThreadName( "Worker" );
+
+    uint32_t idle = 0;
+    for (;;)
+    {
+        Job* pJob = Take( slot );
+        if (pJob != nullptr)
+        {
+            Execute( slot, pJob );
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < SPIN_COUNT)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        idle = 0;
+
+        std::unique_lock<std::mutex> lock( m_mutex );
+        if (m_bStop)
+            return;
+
+        m_sleeping++;
+        if (m_queued <= 0)
+        {
+            m_sleeps.fetch_add( 1, std::memory_order_relaxed );
+            m_wake.wait( lock, [&]() { return m_bStop || m_queued > 0; } );
+        }
+        m_sleeping--;
+
+        if (m_bStop)
+            return;
+    }
+}
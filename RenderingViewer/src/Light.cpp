@@ -1,5 +1,18 @@
+#include <cfloat>
+
+const float Light::DEFAULT_SHADOW_EXTENT = 1.86523065f * 5;
+
+// inputDef.hlsli reads the cascade data at these registers
+static_assert( offsetof( Light::ResLightData, cascadeViewProjection ) == 12 * 16, "CascadeViewProj must start at c12" );
+static_assert( offsetof( Light::ResLightData, cascadeSplits ) == 28 * 16, "CascadeSplits must start at c28" );
+static_assert( offsetof( Light::ResLightData, cascadeRects ) == 29 * 16, "CascadeRects must start at c29" );
+static_assert( offsetof( Light::ResLightData, cascadeCount ) == 33 * 16, "CascadeCount must start at c33" );
+static_assert( Light::ResLightData::CASCADE_NUM == ShadowFrustum::MAX_CASCADES, "Every cascade needs a tile of the atlas" );
+
 Light::Light( ID3D12Device* pDevice )
     : Node( pDevice )
+    , m_cascadeCount( ResLightData::CASCADE_NUM )
+    , m_cascadeSplitLambda( 0.5f )
 {
     m_nodeType = NODE_TYPE_LIGHT;
 
@@ -10,14 +23,22 @@ Light::~Light()
 {
 }
 
-bool Light::BindDescriptorHeap( ID3D12Device* pDevice, shared_ptr<DescriptorHeap> pDescHeap )
+void Light::UpdateGPUBuffer( UploadRingAllocator& ring )
 {
-    m_pLightCB->CreateBufferView( pDevice, pDescHeap, Buffer::BUFFER_VIEW_TYPE_CONSTANT );
+    m_constants.Update( ring, &m_lightBufferData, sizeof( m_lightBufferData ) );
 
-    return true;
+    for (UINT i = 0; i < m_lightBufferData.cascadeCount; ++i)
+    {
+        m_cascadeConstants[i].Update( ring, &m_cascadeBufferData[i], sizeof( m_cascadeBufferData[i] ) );
+    }
+}
+
+void Light::SetCascadeCount( UINT count )
+{
+    m_cascadeCount = min( max( count, 1u ), static_cast<UINT>(ResLightData::CASCADE_NUM) );
 }
 
-void Light::UpdateGPUBuffer()
+void Light::UpdateLightData()
 {
     // 萔obt@f[^̐ݒ.
     m_lightBufferData.size = sizeof( ResLightData );
@@ -33,22 +54,112 @@ void Light::UpdateGPUBuffer()
 
     Mat44f viewMatrix = Mat44f::CreateLookAt( position, dir, Vec3f::YAXIS );
 
-    float w = 1.86523065f * 5;
-    float h = 1.86523065f * 5;
+    float w = DEFAULT_SHADOW_EXTENT;
+    float h = DEFAULT_SHADOW_EXTENT;
 
     Mat44f projectionMatrix = Mat44f::CreateOrthoLH( -0.5f*w, 0.5f*w, -0.5f*h, 0.5f*h, 1.0f, 100.0f );
     m_lightBufferData.view[0] = viewMatrix;
     m_lightBufferData.projection[0] = projectionMatrix;
 
-    m_pLightCB->Map( &m_lightBufferData, sizeof( m_lightBufferData ) );
+    // A single cascade over the whole map until the first fit
+    memset( m_lightBufferData.cascadePadding, 0, sizeof( m_lightBufferData.cascadePadding ) );
+    memset( m_lightBufferData.cascadeViewProjection, 0, sizeof( m_lightBufferData.cascadeViewProjection ) );
+    memset( m_lightBufferData.cascadeRects, 0, sizeof( m_lightBufferData.cascadeRects ) );
+    ShadowFrustum::Multiply( reinterpret_cast<const float*>(&projectionMatrix), reinterpret_cast<const float*>(&viewMatrix),
+                             reinterpret_cast<float*>(&m_lightBufferData.cascadeViewProjection[0]) );
+    m_lightBufferData.cascadeSplits   = Vec4f( FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX );
+    m_lightBufferData.cascadeRects[0] = Vec4f( 1.0f, 1.0f, 0.0f, 0.0f );
+    m_lightBufferData.cascadeCount    = 1;
+
+    m_cascadeBufferData[0] = m_lightBufferData;
+
+    m_constants.MarkDirty();
+    m_cascadeConstants[0].MarkDirty();
+
+    // Light parameters changed; fitted shadow boxes follow the camera and do not count as a change
+    MarkChanged();
+}
+
+void Light::FitShadowFrustum( const Camera* pCamera, const ShadowFrustum::Bounds& bounds, UINT shadowMapSize )
+{
+    if (!bounds.IsValid())
+        return;
+
+    ShadowFrustum::Input input;
+    memcpy( input.direction, &m_lightBufferData.direction[0], sizeof( input.direction ) );
+    input.casters    = bounds;
+    input.receivers  = bounds;
+
+    float cameraView[16];
+    float cameraProjection[16];
+    if (pCamera != nullptr)
+    {
+        memcpy( cameraView, &pCamera->GetViewMatrix(), sizeof( cameraView ) );
+        memcpy( cameraProjection, &pCamera->GetProjectionMatrix(), sizeof( cameraProjection ) );
+        input.pCameraView       = cameraView;
+        input.pCameraProjection = cameraProjection;
+    }
+
+    // Steps relative to the scene, so the box size only changes after a noticeable camera move
+    const float diagonal = sqrtf( (bounds.max[0] - bounds.min[0]) * (bounds.max[0] - bounds.min[0])
+                                + (bounds.max[1] - bounds.min[1]) * (bounds.max[1] - bounds.min[1])
+                                + (bounds.max[2] - bounds.min[2]) * (bounds.max[2] - bounds.min[2]) );
+    input.sizeStep = diagonal / 32.0f;
+
+    ShadowFrustum::Result results[ResLightData::CASCADE_NUM];
+    float splits[ResLightData::CASCADE_NUM + 1];
+    const UINT cascadeCount = ShadowFrustum::FitCascades( input, m_cascadeCount, m_cascadeSplitLambda, shadowMapSize, results, splits );
+    if (cascadeCount == 0)
+        return;
+
+    ResLightData data = m_lightBufferData;
+
+    // view and projection keep the first cascade for passes that read a single map
+    memcpy( &data.view[0], results[0].view, sizeof( results[0].view ) );
+    memcpy( &data.projection[0], results[0].projection, sizeof( results[0].projection ) );
+
+    float cascadeSplits[ResLightData::CASCADE_NUM] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+    memset( data.cascadeViewProjection, 0, sizeof( data.cascadeViewProjection ) );
+    memset( data.cascadeRects, 0, sizeof( data.cascadeRects ) );
+    for (UINT i = 0; i < cascadeCount; ++i)
+    {
+        ShadowFrustum::Multiply( results[i].projection, results[i].view, reinterpret_cast<float*>(&data.cascadeViewProjection[i]) );
+
+        UINT x, y, size;
+        ShadowFrustum::GetCascadeTile( i, cascadeCount, shadowMapSize, x, y, size );
+
+        const float scale = static_cast<float>(size) / shadowMapSize;
+        data.cascadeRects[i] = Vec4f( scale, scale, static_cast<float>(x) / shadowMapSize, static_cast<float>(y) / shadowMapSize );
+
+        if (i + 1 < cascadeCount)
+            cascadeSplits[i] = splits[i + 1];
+    }
+    data.cascadeSplits = Vec4f( cascadeSplits[0], cascadeSplits[1], cascadeSplits[2], cascadeSplits[3] );
+    data.cascadeCount  = cascadeCount;
+
+    memcpy( m_shadowFrustum, results, sizeof( results ) );
+
+    // Snapped boxes repeat while the camera moves within a texel, and keep the uploaded constants
+    if (memcmp( &data, &m_lightBufferData, sizeof( data ) ) == 0)
+        return;
+
+    m_lightBufferData = data;
+    m_constants.MarkDirty();
+
+    for (UINT i = 0; i < cascadeCount; ++i)
+    {
+        m_cascadeBufferData[i] = data;
+        memcpy( &m_cascadeBufferData[i].view[0], results[i].view, sizeof( results[i].view ) );
+        memcpy( &m_cascadeBufferData[i].projection[0], results[i].projection, sizeof( results[i].projection ) );
+        m_cascadeConstants[i].MarkDirty();
+    }
 }
 
 bool Light::CreateCB( ID3D12Device* pDevice )
 {
-    m_pLightCB = make_shared<ConstantBuffer>();
-    m_pLightCB->Create( pDevice, sizeof( ResLightData ) );
+    AC_USE_VAR( pDevice );
 
-    UpdateGPUBuffer();
+    UpdateLightData();
 
     return true;
 }
\ No newline at end of file
@@ -0,0 +1,459 @@
+#include "LightClusters.h"
+#include "BatchMath.h"
+#include "Profiler.h"
+#include "ShadowFrustum.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+    // Below this much work per thread the grid is built on fewer threads
+    const size_t MIN_LIGHTS_PER_THREAD       = 1024;
+    const size_t MIN_LIGHT_SLICES_PER_THREAD = 16384;
+
+    const uint32_t MAX_GRID_SIZE = 255;
+
+    // Light centers moved to view space per batch
+    const size_t BOUNDS_BATCH_SIZE = 256;
+
+    // Plane through the eye where the projected coordinate of row equals value, normalized so
+    // dot( plane, v ) is the distance towards larger values
+    void GetTilePlane( const float projection[16], int row, float value, float plane[4] )
+    {
+        for (int column = 0; column < 4; ++column)
+        {
+            plane[column] = projection[column * 4 + row] - value * projection[column * 4 + 3];
+        }
+
+        const float length = std::sqrt( plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2] );
+        if (length > 0.0f)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                plane[i] /= length;
+            }
+        }
+    }
+
+    float Distance( const float plane[4], const float point[3] )
+    {
+        return plane[0] * point[0] + plane[1] * point[1] + plane[2] * point[2] + plane[3];
+    }
+}
+
+void LightList::Clear()
+{
+    for (std::vector<float>* pArray : { &positionX, &positionY, &positionZ, &range, &colorR, &colorG, &colorB,
+                                        &directionX, &directionY, &directionZ, &spotCosInner, &spotCosOuter })
+    {
+        pArray->clear();
+    }
+}
+
+void LightList::Reserve( size_t count )
+{
+    for (std::vector<float>* pArray : { &positionX, &positionY, &positionZ, &range, &colorR, &colorG, &colorB,
+                                        &directionX, &directionY, &directionZ, &spotCosInner, &spotCosOuter })
+    {
+        pArray->reserve( count );
+    }
+}
+
+uint32_t LightList::AddPointLight( const float position[3], float lightRange, const float color[3] )
+{
+    const float down[3] = { 0.0f, -1.0f, 0.0f };
+    return AddSpotLight( position, down, lightRange, 3.14159265f, 3.14159265f, color );
+}
+
+uint32_t LightList::AddSpotLight( const float position[3], const float direction[3], float lightRange, float innerAngle, float outerAngle, const float color[3] )
+{
+    float length = std::sqrt( direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2] );
+    if (!(length > 0.0f))
+        length = 1.0f;
+
+    positionX.push_back( position[0] );
+    positionY.push_back( position[1] );
+    positionZ.push_back( position[2] );
+    range.push_back( lightRange );
+
+    colorR.push_back( color[0] );
+    colorG.push_back( color[1] );
+    colorB.push_back( color[2] );
+
+    directionX.push_back( direction[0] / length );
+    directionY.push_back( direction[1] / length );
+    directionZ.push_back( direction[2] / length );
+
+    // A full sphere for point lights, and an inner cone no wider than the outer one
+    outerAngle = std::min( outerAngle, 3.14159265f );
+    innerAngle = std::min( innerAngle, outerAngle );
+    spotCosInner.push_back( outerAngle >= 3.14159265f ? -1.0f : std::cos( innerAngle ) );
+    spotCosOuter.push_back( outerAngle >= 3.14159265f ? -1.0f : std::cos( outerAngle ) );
+
+    return static_cast<uint32_t>(positionX.size() - 1);
+}
+
+void LightList::GetBoundingSphere( size_t index, float sphere[4] ) const
+{
+    const float position[3]  = { positionX[index], positionY[index], positionZ[index] };
+    const float direction[3] = { directionX[index], directionY[index], directionZ[index] };
+    const float lightRange   = range[index];
+    const float cosOuter     = spotCosOuter[index];
+
+    // Cones of 90 degrees or more are bounded by the whole sphere
+    float offset = 0.0f;
+    float radius = lightRange;
+    if (cosOuter > 0.0f)
+    {
+        // Wide cones: sphere around the cap; narrow cones: sphere through the apex and the rim
+        if (cosOuter < 0.70710678f)
+        {
+            offset = lightRange * cosOuter;
+            radius = lightRange * std::sqrt( 1.0f - cosOuter * cosOuter );
+        }
+        else
+        {
+            offset = lightRange / (2.0f * cosOuter);
+            radius = offset;
+        }
+    }
+
+    for (int k = 0; k < 3; ++k)
+    {
+        sphere[k] = position[k] + direction[k] * offset;
+    }
+    sphere[3] = radius;
+}
+
+LightClusters::LightClusters( uint32_t threadCount )
+    : m_threadCount( threadCount )
+    , m_nearZ( 0.0f )
+    , m_farZ( 0.0f )
+    , m_sliceScale( 0.0f )
+    , m_sliceBias( 0.0f )
+{
+    if (m_threadCount == 0)
+        m_threadCount = std::max( 1u, std::thread::hardware_concurrency() );
+}
+
+LightClusters::~LightClusters()
+{
+}
+
+uint32_t LightClusters::GetSlice( float viewDepth ) const
+{
+    if (!(viewDepth > m_nearZ))
+        return 0;
+
+    const float slice = std::floor( std::log( viewDepth ) * m_sliceScale + m_sliceBias );
+    if (slice <= 0.0f)
+        return 0;
+
+    return std::min( static_cast<uint32_t>(slice), m_config.slices - 1 );
+}
+
+template <typename Func>
+void LightClusters::ParallelFor( uint32_t workerCount, Func func )
+{
+    JobSystem::GetInstance().ParallelFor( workerCount, func, 1 );
+}
+
+bool LightClusters::Build( const float view[16], const float projection[16], const LightList& lights )
+{
+    PROFILE_SCOPE( "LightClusters::Build" );
+
+    const auto start = std::chrono::steady_clock::now();
+
+    m_statistics.Clear();
+
+    m_config.tilesX = std::min( std::max( m_config.tilesX, 1u ), MAX_GRID_SIZE );
+    m_config.tilesY = std::min( std::max( m_config.tilesY, 1u ), MAX_GRID_SIZE );
+    m_config.slices = std::min( std::max( m_config.slices, 1u ), MAX_GRID_SIZE );
+
+    // Depth range of the projection along the view axis
+    float inverse[16];
+    if (!ShadowFrustum::Invert( projection, inverse ))
+        return false;
+
+    auto unprojectDepth = [&]( float ndcZ )
+    {
+        const float ndc[4] = { 0.0f, 0.0f, ndcZ, 1.0f };
+        float position[4];
+        ShadowFrustum::Transform( inverse, ndc, position );
+        return position[2] / position[3];
+    };
+
+    m_nearZ = m_config.nearZ > 0.0f ? m_config.nearZ : unprojectDepth( 0.0f );
+    m_farZ  = m_config.farZ > 0.0f ? m_config.farZ : unprojectDepth( 1.0f );
+    if (!(m_nearZ > 0.0f) || !(m_farZ > m_nearZ))
+        return false;
+
+    const float logRatio = std::log( m_farZ / m_nearZ );
+    m_sliceScale = m_config.slices / logRatio;
+    m_sliceBias  = -(m_config.slices * std::log( m_nearZ )) / logRatio;
+
+    // Bounds per light
+    const size_t   lightCount   = lights.Size();
+    const uint32_t boundThreads = static_cast<uint32_t>(std::min<size_t>( m_threadCount, std::max<size_t>( 1, lightCount / MIN_LIGHTS_PER_THREAD ) ));
+
+    m_bounds.resize( lightCount );
+    ParallelFor( boundThreads, [&]( uint32_t thread )
+    {
+        ComputeBounds( view, projection, lights, lightCount * thread / boundThreads, lightCount * (thread + 1) / boundThreads );
+    } );
+
+    m_visible.clear();
+    for (size_t i = 0; i < lightCount; ++i)
+    {
+        if (m_bounds[i].z0 <= m_bounds[i].z1)
+            m_visible.push_back( static_cast<uint32_t>(i) );
+    }
+
+    // Slices are independent, each thread bins a contiguous run of them into its own list
+    const uint32_t slices     = m_config.slices;
+    const uint32_t binThreads = static_cast<uint32_t>(std::min<size_t>( std::min( m_threadCount, slices ),
+                                                                        std::max<size_t>( 1, m_visible.size() * slices / MIN_LIGHT_SLICES_PER_THREAD ) ));
+
+    m_ranges.resize( GetClusterCount() );
+    m_binScratch.resize( std::max<size_t>( m_binScratch.size(), binThreads ) );
+    ParallelFor( binThreads, [&]( uint32_t thread )
+    {
+        BinSlices( thread, slices * thread / binThreads, slices * (thread + 1) / binThreads );
+    } );
+
+    // Thread lists follow each other in slice order
+    uint32_t total = 0;
+    m_threadBase.resize( binThreads );
+    for (uint32_t thread = 0; thread < binThreads; ++thread)
+    {
+        m_threadBase[thread] = total;
+        total += static_cast<uint32_t>(m_binScratch[thread].indices.size());
+    }
+
+    m_indices.resize( total );
+
+    const uint32_t tileCount = m_config.tilesX * m_config.tilesY;
+    ParallelFor( binThreads, [&]( uint32_t thread )
+    {
+        const std::vector<uint32_t>& indices = m_binScratch[thread].indices;
+        std::copy( indices.begin(), indices.end(), m_indices.begin() + m_threadBase[thread] );
+
+        const uint32_t clusterBegin = slices * thread / binThreads * tileCount;
+        const uint32_t clusterEnd   = slices * (thread + 1) / binThreads * tileCount;
+        for (uint32_t cluster = clusterBegin; cluster < clusterEnd; ++cluster)
+        {
+            m_ranges[cluster].offset += m_threadBase[thread];
+        }
+    } );
+
+    m_statistics.lights        = static_cast<uint32_t>(lightCount);
+    m_statistics.visibleLights = static_cast<uint32_t>(m_visible.size());
+    m_statistics.indices       = total;
+    m_statistics.threads       = std::max( boundThreads, binThreads );
+    for (const Range& range : m_ranges)
+    {
+        m_statistics.maxClusterLights = std::max( m_statistics.maxClusterLights, range.count );
+    }
+    m_statistics.milliseconds = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+    return true;
+}
+
+void LightClusters::ComputeBounds( const float view[16], const float projection[16], const LightList& lights, size_t begin, size_t end )
+{
+    PROFILE_SCOPE( "LightClusters::ComputeBounds" );
+
+    const uint32_t tilesX = m_config.tilesX;
+    const uint32_t tilesY = m_config.tilesY;
+
+    // Tile edges: x from the left, y from the top of the screen
+    float planesX[(MAX_GRID_SIZE + 1) * 4];
+    float planesY[(MAX_GRID_SIZE + 1) * 4];
+    for (uint32_t i = 0; i <= tilesX; ++i)
+    {
+        GetTilePlane( projection, 0, -1.0f + 2.0f * i / tilesX, &planesX[i * 4] );
+    }
+    for (uint32_t i = 0; i <= tilesY; ++i)
+    {
+        GetTilePlane( projection, 1, 1.0f - 2.0f * i / tilesY, &planesY[i * 4] );
+    }
+
+    const Bounds OUTSIDE = { 1, 0, 1, 0, 1, 0 };
+
+    float centerX[BOUNDS_BATCH_SIZE];
+    float centerY[BOUNDS_BATCH_SIZE];
+    float centerZ[BOUNDS_BATCH_SIZE];
+    float radii[BOUNDS_BATCH_SIZE];
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        const size_t batchIndex = (i - begin) % BOUNDS_BATCH_SIZE;
+        if (batchIndex == 0)
+        {
+            const size_t batchCount = std::min( BOUNDS_BATCH_SIZE, end - i );
+            for (size_t j = 0; j < batchCount; ++j)
+            {
+                float sphere[4];
+                lights.GetBoundingSphere( i + j, sphere );
+                centerX[j] = sphere[0];
+                centerY[j] = sphere[1];
+                centerZ[j] = sphere[2];
+                radii[j]   = sphere[3];
+            }
+
+            BatchMath::TransformPoints( view, centerX, centerY, centerZ, batchCount, centerX, centerY, centerZ );
+        }
+
+        const float center[3] = { centerX[batchIndex], centerY[batchIndex], centerZ[batchIndex] };
+        const float radius    = radii[batchIndex];
+
+        Bounds& bounds = m_bounds[i];
+
+        const float zMin = std::max( center[2] - radius, m_nearZ );
+        const float zMax = std::min( center[2] + radius, m_farZ );
+        if (zMin > zMax)
+        {
+            bounds = OUTSIDE;
+            continue;
+        }
+
+        // A tile is missed when the sphere lies entirely beyond one of its two edges
+        float edges[MAX_GRID_SIZE + 1];
+        for (uint32_t x = 0; x <= tilesX; ++x)
+        {
+            edges[x] = Distance( &planesX[x * 4], center );
+        }
+
+        // Selects instead of branches, the outcome per tile is hard to predict
+        int x0 = static_cast<int>(tilesX);
+        int x1 = -1;
+        for (int x = static_cast<int>(tilesX) - 1; x >= 0; --x)
+        {
+            const bool bOverlap = edges[x] >= -radius && edges[x + 1] <= radius;
+            x0 = bOverlap ? x : x0;
+            x1 = bOverlap && x1 < 0 ? x : x1;
+        }
+
+        for (uint32_t y = 0; y <= tilesY; ++y)
+        {
+            edges[y] = Distance( &planesY[y * 4], center );
+        }
+
+        int y0 = static_cast<int>(tilesY);
+        int y1 = -1;
+        for (int y = static_cast<int>(tilesY) - 1; y >= 0; --y)
+        {
+            const bool bOverlap = edges[y] <= radius && edges[y + 1] >= -radius;
+            y0 = bOverlap ? y : y0;
+            y1 = bOverlap && y1 < 0 ? y : y1;
+        }
+
+        if (x1 < 0 || y1 < 0)
+        {
+            bounds = OUTSIDE;
+            continue;
+        }
+
+        bounds.x0 = static_cast<uint8_t>(x0);
+        bounds.x1 = static_cast<uint8_t>(x1);
+        bounds.y0 = static_cast<uint8_t>(y0);
+        bounds.y1 = static_cast<uint8_t>(y1);
+        bounds.z0 = static_cast<uint8_t>(GetSlice( zMin ));
+        bounds.z1 = static_cast<uint8_t>(GetSlice( zMax ));
+    }
+}
+
+void LightClusters::BinSlices( uint32_t thread, uint32_t sliceBegin, uint32_t sliceEnd )
+{
+    PROFILE_SCOPE( "LightClusters::BinSlices" );
+
+    const uint32_t tilesX     = m_config.tilesX;
+    const uint32_t tileCount  = m_config.tilesX * m_config.tilesY;
+    const uint32_t sliceCount = sliceEnd - sliceBegin;
+
+    BinScratch& scratch = m_binScratch[thread];
+
+    std::vector<uint32_t>& indices = scratch.indices;
+    indices.clear();
+
+    // Lights of each slice, so a slice only visits the lights that reach it
+    std::vector<uint32_t>& sliceOffsets = scratch.sliceOffsets;
+    sliceOffsets.assign( sliceCount + 1, 0 );
+    for (uint32_t light : m_visible)
+    {
+        const Bounds& bounds = m_bounds[light];
+        for (uint32_t slice = std::max<uint32_t>( bounds.z0, sliceBegin ); slice <= bounds.z1 && slice < sliceEnd; ++slice)
+        {
+            sliceOffsets[slice - sliceBegin + 1]++;
+        }
+    }
+
+    for (uint32_t i = 0; i < sliceCount; ++i)
+    {
+        sliceOffsets[i + 1] += sliceOffsets[i];
+    }
+
+    std::vector<uint32_t>& sliceLights = scratch.sliceLights;
+    std::vector<uint32_t>& sliceFill   = scratch.sliceFill;
+    sliceLights.resize( sliceOffsets[sliceCount] );
+    sliceFill.assign( sliceOffsets.begin(), sliceOffsets.end() - 1 );
+    for (uint32_t light : m_visible)
+    {
+        const Bounds& bounds = m_bounds[light];
+        for (uint32_t slice = std::max<uint32_t>( bounds.z0, sliceBegin ); slice <= bounds.z1 && slice < sliceEnd; ++slice)
+        {
+            sliceLights[sliceFill[slice - sliceBegin]++] = light;
+        }
+    }
+
+    std::vector<uint32_t>& counts = scratch.counts;
+    counts.resize( tileCount );
+
+    for (uint32_t slice = sliceBegin; slice < sliceEnd; ++slice)
+    {
+        Range* pRanges = &m_ranges[slice * tileCount];
+
+        const uint32_t* pLightsBegin = sliceLights.data() + sliceOffsets[slice - sliceBegin];
+        const uint32_t* pLightsEnd   = sliceLights.data() + sliceOffsets[slice - sliceBegin + 1];
+
+        // Count, then place: every cluster's lights end up contiguous and in light order
+        std::fill( counts.begin(), counts.end(), 0 );
+        for (const uint32_t* pLight = pLightsBegin; pLight != pLightsEnd; ++pLight)
+        {
+            const Bounds& bounds = m_bounds[*pLight];
+            for (uint32_t y = bounds.y0; y <= bounds.y1; ++y)
+            {
+                for (uint32_t x = bounds.x0; x <= bounds.x1; ++x)
+                {
+                    counts[y * tilesX + x]++;
+                }
+            }
+        }
+
+        uint32_t offset = static_cast<uint32_t>(indices.size());
+        for (uint32_t tile = 0; tile < tileCount; ++tile)
+        {
+            pRanges[tile].offset = offset;
+            pRanges[tile].count  = 0;
+            offset += counts[tile];
+        }
+
+        indices.resize( offset );
+        for (const uint32_t* pLight = pLightsBegin; pLight != pLightsEnd; ++pLight)
+        {
+            const Bounds& bounds = m_bounds[*pLight];
+            for (uint32_t y = bounds.y0; y <= bounds.y1; ++y)
+            {
+                for (uint32_t x = bounds.x0; x <= bounds.x1; ++x)
+                {
+                    Range& range = pRanges[y * tilesX + x];
+                    indices[range.offset + range.count++] = *pLight;
+                }
+            }
+        }
+    }
+}
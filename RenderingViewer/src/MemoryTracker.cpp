@@ -0,0 +1,393 @@
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    double ToMiB( uint64_t bytes )
+    {
+        return bytes / (1024.0 * 1024.0);
+    }
+}
+
+MemoryResourceDesc MemoryResourceDesc::Buffer( uint64_t bytes )
+{
+    MemoryResourceDesc desc;
+    desc.type        = TYPE_BUFFER;
+    desc.width       = bytes;
+    desc.height      = 1;
+    desc.elementSize = 1;
+    desc.flags       = 0;
+    return desc;
+}
+
+MemoryResourceDesc MemoryResourceDesc::Texture2D( uint32_t width, uint32_t height, uint32_t bytesPerTexel, uint32_t flags )
+{
+    MemoryResourceDesc desc;
+    desc.type        = TYPE_TEXTURE_2D;
+    desc.width       = width;
+    desc.height      = height;
+    desc.elementSize = bytesPerTexel;
+    desc.flags       = flags;
+    return desc;
+}
+
+MemoryResourceDesc MemoryResourceDesc::DescriptorHeap( uint32_t count, uint32_t descriptorSize )
+{
+    MemoryResourceDesc desc;
+    desc.type        = TYPE_DESCRIPTOR_HEAP;
+    desc.width       = count;
+    desc.height      = 1;
+    desc.elementSize = descriptorSize;
+    desc.flags       = 0;
+    return desc;
+}
+
+MockMemoryBackend::MockMemoryBackend()
+    : m_budget( 0 )
+    , m_usage( 0 )
+{
+}
+
+uint64_t MockMemoryBackend::GetAllocationSize( const MemoryResourceDesc& desc )
+{
+    const uint64_t bytes = desc.GetBytes();
+    if (desc.type == MemoryResourceDesc::TYPE_DESCRIPTOR_HEAP)
+        return bytes;
+
+    return std::max<uint64_t>( 1, (bytes + PAGE_SIZE - 1) / PAGE_SIZE ) * PAGE_SIZE;
+}
+
+bool MockMemoryBackend::QueryDeviceMemory( uint64_t& budget, uint64_t& usage )
+{
+    if (m_budget == 0)
+        return false;
+
+    budget = m_budget;
+    usage  = m_usage;
+    return true;
+}
+
+MemoryTracker::Handle::Handle()
+    : m_pTracker( nullptr )
+    , m_id( 0 )
+{
+}
+
+MemoryTracker::Handle::Handle( Handle&& other ) noexcept
+    : m_pTracker( other.m_pTracker )
+    , m_id( other.m_id )
+{
+    other.m_pTracker = nullptr;
+    other.m_id       = 0;
+}
+
+MemoryTracker::Handle& MemoryTracker::Handle::operator=( Handle&& other ) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+
+        m_pTracker       = other.m_pTracker;
+        m_id             = other.m_id;
+        other.m_pTracker = nullptr;
+        other.m_id       = 0;
+    }
+    return *this;
+}
+
+void MemoryTracker::Handle::Release()
+{
+    if (m_pTracker == nullptr)
+        return;
+
+    m_pTracker->Release( m_id );
+    m_pTracker = nullptr;
+    m_id       = 0;
+}
+
+MemoryTracker::MemoryTracker()
+    : m_pBackend( nullptr )
+    , m_totalBudget( 0 )
+    , m_nextId( 1 )
+{
+    std::fill( m_budgets, m_budgets + CATEGORY_NUM, 0 );
+}
+
+MemoryTracker& MemoryTracker::GetInstance()
+{
+    static MemoryTracker tracker;
+    return tracker;
+}
+
+const char* MemoryTracker::GetCategoryName( CATEGORY category )
+{
+    static const char* const names[] = { "geometry", "constants", "descriptors", "shadow", "render targets", "other" };
+    static_assert( sizeof( names ) / sizeof( names[0] ) == CATEGORY_NUM, "A category has no name" );
+
+    return category < CATEGORY_NUM ? names[category] : "total";
+}
+
+void MemoryTracker::SetBackend( MemoryBackend* pBackend )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_pBackend = pBackend;
+}
+
+void MemoryTracker::SetWarning( BudgetWarning warning )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_warning = warning;
+}
+
+void MemoryTracker::SetBudget( CATEGORY category, uint64_t bytes )
+{
+    if (category >= CATEGORY_NUM)
+        return;
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_budgets[category] = bytes;
+}
+
+void MemoryTracker::SetTotalBudget( uint64_t bytes )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_totalBudget = bytes;
+}
+
+void MemoryTracker::SetOwnerName( const void* owner, const std::string& name )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_owners[owner].name = name;
+}
+
+void MemoryTracker::RemoveOwner( const void* owner )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    if (owner == nullptr)
+        return;
+
+    // Allocations still alive stay in their category, just without an owner
+    for (auto& entry : m_allocations)
+    {
+        if (entry.second.owner == owner)
+        {
+            entry.second.owner = nullptr;
+            Add( m_owners[nullptr].usage, entry.second.bytes, entry.second.requestedBytes, 0 );
+        }
+    }
+    m_owners.erase( owner );
+}
+
+MemoryTracker::Handle MemoryTracker::Track( CATEGORY category, const MemoryResourceDesc& desc, const void* owner )
+{
+    Handle handle;
+    if (category >= CATEGORY_NUM)
+        return handle;
+
+    BudgetWarning warning;
+    bool     bCategoryOver  = false;
+    bool     bTotalOver     = false;
+    uint64_t categoryBytes  = 0;
+    uint64_t totalBytes     = 0;
+    uint64_t categoryBudget = 0;
+    uint64_t totalBudget    = 0;
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+
+        Allocation allocation;
+        allocation.category       = category;
+        allocation.owner          = owner;
+        allocation.requestedBytes = desc.GetBytes();
+        allocation.bytes          = m_pBackend != nullptr ? m_pBackend->GetAllocationSize( desc ) : allocation.requestedBytes;
+
+        const uint64_t id = m_nextId++;
+        m_allocations.insert( std::make_pair( id, allocation ) );
+
+        bCategoryOver  = Add( m_statistics.categories[category], allocation.bytes, allocation.requestedBytes, m_budgets[category] );
+        bTotalOver     = Add( m_statistics.total, allocation.bytes, allocation.requestedBytes, m_totalBudget );
+        categoryBytes  = m_statistics.categories[category].bytes;
+        totalBytes     = m_statistics.total.bytes;
+        categoryBudget = m_budgets[category];
+        totalBudget    = m_totalBudget;
+
+        Owner& entry = m_owners[owner];
+        Add( entry.usage, allocation.bytes, allocation.requestedBytes, 0 );
+
+        m_statistics.tracked++;
+        m_statistics.budgetWarnings += (bCategoryOver ? 1 : 0) + (bTotalOver ? 1 : 0);
+        warning = m_warning;
+
+        handle.m_pTracker = this;
+        handle.m_id       = id;
+    }
+
+    if (warning)
+    {
+        if (bCategoryOver)
+            warning( category, categoryBytes, categoryBudget );
+        if (bTotalOver)
+            warning( CATEGORY_NUM, totalBytes, totalBudget );
+    }
+
+    return handle;
+}
+
+void MemoryTracker::Release( uint64_t id )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    auto it = m_allocations.find( id );
+    if (it == m_allocations.end())
+        return;
+
+    const Allocation& allocation = it->second;
+    Remove( m_statistics.categories[allocation.category], allocation.bytes, allocation.requestedBytes );
+    Remove( m_statistics.total, allocation.bytes, allocation.requestedBytes );
+
+    auto owner = m_owners.find( allocation.owner );
+    if (owner != m_owners.end())
+        Remove( owner->second.usage, allocation.bytes, allocation.requestedBytes );
+
+    m_allocations.erase( it );
+    m_statistics.released++;
+}
+
+bool MemoryTracker::Add( Usage& usage, uint64_t bytes, uint64_t requestedBytes, uint64_t budget )
+{
+    const bool bWasOver = budget != 0 && usage.bytes > budget;
+
+    usage.bytes          += bytes;
+    usage.requestedBytes += requestedBytes;
+    usage.peakBytes       = std::max( usage.peakBytes, usage.bytes );
+    usage.allocations++;
+
+    return budget != 0 && !bWasOver && usage.bytes > budget;
+}
+
+void MemoryTracker::Remove( Usage& usage, uint64_t bytes, uint64_t requestedBytes )
+{
+    usage.bytes          -= bytes;
+    usage.requestedBytes -= requestedBytes;
+    usage.allocations--;
+}
+
+MemoryTracker::Statistics MemoryTracker::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_statistics;
+}
+
+MemoryTracker::Usage MemoryTracker::GetUsage( CATEGORY category ) const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return category < CATEGORY_NUM ? m_statistics.categories[category] : m_statistics.total;
+}
+
+MemoryTracker::Usage MemoryTracker::GetOwnerUsage( const void* owner ) const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    auto it = m_owners.find( owner );
+    return it != m_owners.end() ? it->second.usage : Usage();
+}
+
+std::vector<MemoryTracker::OwnerUsage> MemoryTracker::GetOwners() const
+{
+    std::vector<OwnerUsage> owners;
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+
+        owners.reserve( m_owners.size() );
+        for (const auto& entry : m_owners)
+        {
+            OwnerUsage owner;
+            owner.owner = entry.first;
+            owner.name  = entry.second.name;
+            owner.usage = entry.second.usage;
+            if (owner.name.empty() && entry.first == nullptr)
+            {
+                owner.name = "unowned";
+            }
+            else if (owner.name.empty())
+            {
+                std::ostringstream name;
+                name << entry.first;
+                owner.name = name.str();
+            }
+            owners.push_back( owner );
+        }
+    }
+
+    std::sort( owners.begin(), owners.end(), []( const OwnerUsage& a, const OwnerUsage& b )
+    {
+        return a.usage.bytes > b.usage.bytes;
+    } );
+
+    return owners;
+}
+
+void MemoryTracker::WriteReport( std::ostream& stream, size_t ownerCount ) const
+{
+    const Statistics stats = GetStatistics();
+
+    uint64_t deviceBudget = 0;
+    uint64_t deviceUsage  = 0;
+    bool     bDevice      = false;
+    uint64_t budgets[CATEGORY_NUM];
+    uint64_t totalBudget  = 0;
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        bDevice = m_pBackend != nullptr && m_pBackend->QueryDeviceMemory( deviceBudget, deviceUsage );
+        std::copy( m_budgets, m_budgets + CATEGORY_NUM, budgets );
+        totalBudget = m_totalBudget;
+    }
+
+    const std::ios::fmtflags flags = stream.flags();
+    const std::streamsize    precision = stream.precision();
+    stream << std::fixed << std::setprecision( 2 );
+
+    auto output = [&]( const char* name, const Usage& usage, uint64_t budget )
+    {
+        stream << name << ": " << ToMiB( usage.bytes ) << " MiB in " << usage.allocations << " allocations"
+               << " (data " << ToMiB( usage.requestedBytes ) << " MiB), peak " << ToMiB( usage.peakBytes ) << " MiB";
+        if (budget != 0)
+            stream << ", budget " << ToMiB( budget ) << " MiB" << (usage.bytes > budget ? " EXCEEDED" : "");
+        stream << std::endl;
+    };
+
+    output( "Memory", stats.total, totalBudget );
+    if (bDevice)
+        stream << "  device: " << ToMiB( deviceUsage ) << " MiB used of a " << ToMiB( deviceBudget ) << " MiB budget" << std::endl;
+
+    for (uint32_t i = 0; i < CATEGORY_NUM; ++i)
+    {
+        if (stats.categories[i].peakBytes == 0)
+            continue;
+
+        stream << "  ";
+        output( GetCategoryName( static_cast<CATEGORY>(i) ), stats.categories[i], budgets[i] );
+    }
+
+    const std::vector<OwnerUsage> owners = GetOwners();
+    for (size_t i = 0; i < owners.size() && i < ownerCount; ++i)
+    {
+        stream << "  owner " << owners[i].name << ": " << ToMiB( owners[i].usage.bytes ) << " MiB"
+               << ", peak " << ToMiB( owners[i].usage.peakBytes ) << " MiB" << std::endl;
+    }
+
+    stream.flags( flags );
+    stream.precision( precision );
+}
+
+void MemoryTracker::Reset()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    m_allocations.clear();
+    m_owners.clear();
+    m_statistics.Clear();
+}
@@ -1,5 +1,9 @@
-﻿Model::Model( ID3D12Device* pDevice )
+﻿static_assert( sizeof( Vertex ) == sizeof( ObjMesh::Vertex ), "Vertex layout differs from ObjMesh" );
+
+Model::Model( ID3D12Device* pDevice )
     : Node( pDevice )
+    , m_vertexAllocation( BufferSuballocator::INVALID_HANDLE )
+    , m_indexAllocation( BufferSuballocator::INVALID_HANDLE )
     , m_indexCount( 0 )
     , m_sourcePath("")
 {
@@ -13,119 +17,172 @@ Model::~Model()
 
 void Model::Release()
 {
+    if (m_pGeometryHeap != nullptr)
+    {
+        m_pGeometryHeap->Free( m_vertexAllocation );
+        m_pGeometryHeap->Free( m_indexAllocation );
+    }
+    m_vertexAllocation = BufferSuballocator::INVALID_HANDLE;
+    m_indexAllocation  = BufferSuballocator::INVALID_HANDLE;
+}
+
+bool Model::BindAsset( shared_ptr<GeometryHeap> pGeometryHeap, const string& sourcePath )
+{
+    ObjMesh mesh;
+    if (!mesh.Load( sourcePath ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, ("Model::BindAsset() Failed to load " + sourcePath + ".").c_str() );
+        return false;
+    }
+
+    BindAsset( pGeometryHeap, sourcePath, mesh );
+
+    return true;
 }
 
-bool Model::BindAsset( ID3D12Device* pDevice, const string& sourcePath )
+void Model::BindAsset( shared_ptr<GeometryHeap> pGeometryHeap, const string& sourcePath, const ObjMesh& mesh )
 {
-    acObjLoader loader;
-    acModelLoader::LoadOption option;
-    loader.SetLoadOption( option );
+    PROFILE_SCOPE( "Model::BindAsset" );
 
     m_sourcePath = sourcePath;
-    loader.Load( m_sourcePath );
 
-    CreateVertexBuffer( pDevice, loader );
+    // Buffers of an earlier asset are freed once the GPU is done with them
+    Release();
+    m_pGeometryHeap = pGeometryHeap;
+
+    CreateVertexBuffer( mesh );
     
-    CreateIndexBuffer( pDevice, loader );
+    CreateIndexBuffer( mesh );
 
-    CreateBoundingBox(loader);
+    CreateBoundingBox( mesh );
 
-    CreateMaterial( pDevice );
+    CreateMaterial();
 
-    return true;
+    // New geometry invalidates anything rendered from the old one
+    MarkChanged();
 }
 
-bool Model::BindDescriptorHeap( ID3D12Device* pDevice, shared_ptr<DescriptorHeap> pDescHeap )
+bool Model::BindMesh( shared_ptr<GeometryHeap> pGeometryHeap, const string& name, vector<Vertex> vertices, vector<unsigned short> indices )
 {
-    m_pMaterialCB->CreateBufferView( pDevice, pDescHeap, Buffer::BUFFER_VIEW_TYPE_CONSTANT);
+    PROFILE_SCOPE( "Model::BindMesh" );
+
+    m_sourcePath = name;
+
+    Release();
+    m_pGeometryHeap = pGeometryHeap;
+
+    m_vertices.swap( vertices );
+    m_indices.swap( indices );
+    m_indexCount = static_cast<int>(m_indices.size());
+
+    CreateVertexBuffer();
+
+    CreateIndexBuffer();
+
+    m_boundingBox = BoundingBox();
+    for (const Vertex& v : m_vertices)
+    {
+        m_boundingBox.hi.x = max( v.position.x, m_boundingBox.hi.x );
+        m_boundingBox.hi.y = max( v.position.y, m_boundingBox.hi.y );
+        m_boundingBox.hi.z = max( v.position.z, m_boundingBox.hi.z );
+
+        m_boundingBox.lo.x = min( v.position.x, m_boundingBox.lo.x );
+        m_boundingBox.lo.y = min( v.position.y, m_boundingBox.lo.y );
+        m_boundingBox.lo.z = min( v.position.z, m_boundingBox.lo.z );
+    }
+
+    CreateMaterial();
+
+    MarkChanged();
 
     return true;
 }
 
-void Model::CreateVertexBuffer( ID3D12Device* pDevice, const acObjLoader& loader )
+void Model::UpdateGPUBuffer( UploadRingAllocator& ring )
 {
-    vector<Vertex> vertices;
-    for (int i = 0; i < loader.GetVertexCount(); ++i)
-    {
-        Vertex v;
-        v.position = loader.GetVertex( i );
+    m_materialConstants.Update( ring, &m_materialData, sizeof( m_materialData ) );
+}
 
-        if (i < loader.GetNormalCount())
-            v.normal = loader.GetNormal( i );
+D3D12_VERTEX_BUFFER_VIEW Model::GetVertexBufferView() const
+{
+    D3D12_VERTEX_BUFFER_VIEW view = {};
+    if (m_pGeometryHeap == nullptr)
+        return view;
 
-        if (i < loader.GetTexCoordCount())
-            v.texCoord = loader.GetTexCoord( i );
+    view.BufferLocation = m_pGeometryHeap->GetGPUAddress( m_vertexAllocation );
+    view.SizeInBytes    = static_cast<UINT>(sizeof( Vertex ) * m_vertices.size());
+    view.StrideInBytes  = sizeof( Vertex );
 
-        // TODO: Vertex color
-        //if (i < loader.GetColor())
-        //    v.color = loader.GetColor( i );
+    return view;
+}
 
-        vertices.push_back( v );
-    }
+D3D12_INDEX_BUFFER_VIEW Model::GetIndexBufferView() const
+{
+    D3D12_INDEX_BUFFER_VIEW view = {};
+    if (m_pGeometryHeap == nullptr)
+        return view;
 
-    int vertexSize = static_cast<int>(sizeof( Vertex ) * vertices.size());
+    view.BufferLocation = m_pGeometryHeap->GetGPUAddress( m_indexAllocation );
+    view.SizeInBytes    = static_cast<UINT>(sizeof( unsigned short ) * m_indices.size());
+    view.Format         = DXGI_FORMAT_R16_UINT;
 
-    m_pVertexBuffer = make_shared<VertexBuffer>();
-    m_pVertexBuffer->SetDataStride( sizeof( Vertex ) );
-    m_pVertexBuffer->Create( pDevice, vertexSize );
-    m_pVertexBuffer->CreateBufferView( pDevice, nullptr, Buffer::BUFFER_VIEW_TYPE_VERTEX );
-    m_pVertexBuffer->Map( &vertices[0], vertexSize );
-    m_pVertexBuffer->Unmap();
+    return view;
 }
 
-void Model::CreateIndexBuffer( ID3D12Device* pDevice, const acObjLoader& loader )
+void Model::CreateVertexBuffer( const ObjMesh& mesh )
 {
-    m_indexCount = loader.GetIndexCount();
+    m_vertices.resize( mesh.GetVertexCount() );
+    if (!m_vertices.empty())
+        mesh.CreateVertices( reinterpret_cast<ObjMesh::Vertex*>(&m_vertices[0]) );
 
-    vector<unsigned short> indices;
-    for (int i = 0; i < loader.GetIndexCount(); ++i)
-    {
-        unsigned short index;
-        index = static_cast<unsigned short>(loader.GetIndex( i ));
+    CreateVertexBuffer();
+}
 
-        indices.push_back( index );
-    }
+void Model::CreateVertexBuffer()
+{
+    vector<Vertex>& vertices = m_vertices;
 
-    int indexSize = static_cast<int>(sizeof( unsigned short ) * indices.size());
+    // Headless: CPU copies only
+    if (m_pGeometryHeap == nullptr || vertices.empty())
+        return;
 
-    m_pIndexBuffer = make_shared<IndexBuffer>();
-    m_pIndexBuffer->SetDataFormat( DXGI_FORMAT_R16_UINT );
-    m_pIndexBuffer->Create( pDevice, indexSize );
-    m_pIndexBuffer->CreateBufferView( pDevice, nullptr, Buffer::BUFFER_VIEW_TYPE_INDEX );
-    m_pIndexBuffer->Map( &indices[0], indexSize );
-    m_pIndexBuffer->Unmap();
+    m_vertexAllocation = m_pGeometryHeap->Upload( &vertices[0], sizeof( Vertex ) * vertices.size() );
 }
 
-void Model::CreateBoundingBox( const acObjLoader& loader )
+void Model::CreateIndexBuffer( const ObjMesh& mesh )
 {
-    Vec3f& hi = m_boundingBox.hi;
-    Vec3f& lo = m_boundingBox.lo;
+    m_indexCount = static_cast<int>(mesh.GetIndexCount());
 
-    for (int i = 0; i < loader.GetVertexCount(); ++i)
-    {
-        const Vec3f& pos = loader.GetVertex( i );
+    m_indices.resize( mesh.GetIndexCount() );
+    if (!m_indices.empty())
+        mesh.CreateIndices( &m_indices[0] );
 
-        hi.x = max( pos.x, hi.x );
-        hi.y = max( pos.y, hi.y );
-        hi.z = max( pos.z, hi.z );
+    CreateIndexBuffer();
+}
 
-        lo.x = min( pos.x, hi.x );
-        lo.y = min( pos.y, hi.y );
-        lo.z = min( pos.z, hi.z );
-    }
+void Model::CreateIndexBuffer()
+{
+    vector<unsigned short>& indices = m_indices;
+
+    if (m_pGeometryHeap == nullptr || indices.empty())
+        return;
+
+    m_indexAllocation = m_pGeometryHeap->Upload( &indices[0], sizeof( unsigned short ) * indices.size() );
 }
 
-void Model::CreateMaterial( ID3D12Device* pDevice )
+void Model::CreateBoundingBox( const ObjMesh& mesh )
 {
-    m_pMaterialCB = make_shared<ConstantBuffer>();
-    m_pMaterialCB->Create( pDevice, sizeof(ResMaterialData) );
+    m_boundingBox = BoundingBox();
+    mesh.GetBounds( &m_boundingBox.lo.x, &m_boundingBox.hi.x );
+}
 
+void Model::CreateMaterial()
+{
     // 定数バッファデータの設定.
     m_materialData.size = sizeof( ResMaterialData );
     m_materialData.ka = Vec4f::ZERO;
     m_materialData.kd = Vec4f( 0.5f );
     m_materialData.ks = Vec4f( 1.0f, 1.0f, 1.0, 50.0f );
 
-    m_pMaterialCB->Map( &m_materialData, sizeof( m_materialData ) );
-
+    m_materialConstants.MarkDirty();
 }
@@ -1,4 +1,5 @@
 Node::Node( ID3D12Device* pDevice )
+    : m_version( 0 )
 {
     AC_USE_VAR( pDevice );
     m_nodeType = NODE_TYPE_NODE;
@@ -31,16 +32,9 @@ void Node::RemoveChild( int index )
     m_pChildren.erase( m_pChildren.begin() + index );
 }
 
-bool Node::BindDescriptorHeap( ID3D12Device* pDevice, shared_ptr<DescriptorHeap> pDescHeap )
-{
-    AC_USE_VAR( pDevice );
-    AC_USE_VAR( pDescHeap );
-
-    return true;
-}
-
-void Node::UpdateGPUBuffer()
+void Node::UpdateGPUBuffer( UploadRingAllocator& ring )
 {
+    AC_USE_VAR( ring );
 }
 
 bool Node::CreateCB()
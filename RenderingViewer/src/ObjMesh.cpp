@@ -0,0 +1,253 @@
+#include "ObjMesh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdlib>
+#include <fstream>
+
+namespace
+{
+    bool IsLineEnd( char c )
+    {
+        return c == '\n' || c == '\r' || c == '\0';
+    }
+
+    const char* SkipSpaces( const char* p )
+    {
+        while (*p == ' ' || *p == '\t')
+        {
+            ++p;
+        }
+        return p;
+    }
+
+    // strtof and strtol skip line breaks too, so a short line must not read into the next one
+    bool ReadFloat( const char*& p, float& value )
+    {
+        p = SkipSpaces( p );
+        if (IsLineEnd( *p ))
+            return false;
+
+        char* pNext = nullptr;
+        value = strtof( p, &pNext );
+        if (pNext == p)
+            return false;
+
+        p = pNext;
+        return true;
+    }
+
+    bool ReadIndex( const char*& p, long& value )
+    {
+        if (IsLineEnd( *p ) || *p == ' ' || *p == '\t')
+            return false;
+
+        char* pNext = nullptr;
+        value = strtol( p, &pNext, 10 );
+        if (pNext == p)
+            return false;
+
+        p = pNext;
+        return true;
+    }
+
+    // 1-based, or negative counting back from the last element read so far; count on failure
+    size_t ResolveIndex( long index, size_t count )
+    {
+        if (index > 0)
+            return static_cast<size_t>(index - 1);
+        if (index < 0 && static_cast<size_t>(-index) <= count)
+            return count - static_cast<size_t>(-index);
+        return count;
+    }
+}
+
+void ObjMesh::Clear()
+{
+    m_positions.clear();
+    m_normals.clear();
+    m_texCoords.clear();
+    m_indices.clear();
+
+    m_fileNormals.clear();
+    m_fileTexCoords.clear();
+}
+
+bool ObjMesh::Load( const std::string& path )
+{
+    Clear();
+
+    std::ifstream file( path.c_str(), std::ios::binary );
+    if (!file)
+        return false;
+
+    file.seekg( 0, std::ios::end );
+    const std::streamoff size = file.tellg();
+    file.seekg( 0, std::ios::beg );
+    if (size < 0)
+        return false;
+
+    std::string text( static_cast<size_t>(size), '\0' );
+    if (size > 0 && !file.read( &text[0], size ))
+        return false;
+
+    Parse( text );
+    return true;
+}
+
+void ObjMesh::Parse( const std::string& text )
+{
+    Clear();
+
+    // The string ends in a terminator, which stops every read of the last line
+    const char* p = text.c_str();
+    while (*p != '\0')
+    {
+        p = SkipSpaces( p );
+
+        if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+        {
+            const char* q = p + 2;
+            float position[3] = {};
+            for (float& value : position)
+            {
+                ReadFloat( q, value );
+            }
+            m_positions.insert( m_positions.end(), position, position + 3 );
+        }
+        else if (p[0] == 'v' && p[1] == 'n')
+        {
+            const char* q = p + 2;
+            float normal[3] = {};
+            for (float& value : normal)
+            {
+                ReadFloat( q, value );
+            }
+            m_fileNormals.insert( m_fileNormals.end(), normal, normal + 3 );
+        }
+        else if (p[0] == 'v' && p[1] == 't')
+        {
+            const char* q = p + 2;
+            float texCoord[2] = {};
+            for (float& value : texCoord)
+            {
+                ReadFloat( q, value );
+            }
+            m_fileTexCoords.insert( m_fileTexCoords.end(), texCoord, texCoord + 2 );
+        }
+        else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+        {
+            ParseFace( p + 2 );
+        }
+
+        while (*p != '\0' && *p != '\n')
+        {
+            ++p;
+        }
+        if (*p == '\n')
+            ++p;
+    }
+
+    // Positions no face used keep zero attributes
+    m_normals.resize( m_positions.size(), 0.0f );
+    m_texCoords.resize( GetVertexCount() * 2, 0.0f );
+
+    m_fileNormals.clear();
+    m_fileTexCoords.clear();
+}
+
+void ObjMesh::ParseFace( const char* p )
+{
+    const size_t vertexCount = GetVertexCount();
+    if (m_normals.size() < m_positions.size())
+    {
+        m_normals.resize( m_positions.size(), 0.0f );
+        m_texCoords.resize( vertexCount * 2, 0.0f );
+    }
+
+    // Corners are p, p/t, p//n or p/t/n
+    m_face.clear();
+    for (p = SkipSpaces( p ); !IsLineEnd( *p ); p = SkipSpaces( p ))
+    {
+        long position = 0, texCoord = 0, normal = 0;
+        const bool bPosition = ReadIndex( p, position );
+        if (*p == '/')
+        {
+            ++p;
+            if (*p != '/')
+                ReadIndex( p, texCoord );
+            if (*p == '/')
+            {
+                ++p;
+                ReadIndex( p, normal );
+            }
+        }
+
+        // Whatever is left of a corner that did not parse
+        while (!IsLineEnd( *p ) && *p != ' ' && *p != '\t')
+        {
+            ++p;
+        }
+
+        const size_t index = ResolveIndex( position, vertexCount );
+        if (!bPosition || index >= vertexCount)
+            continue;
+
+        const size_t n = ResolveIndex( normal, m_fileNormals.size() / 3 );
+        if (normal != 0 && n < m_fileNormals.size() / 3)
+            std::copy( &m_fileNormals[n * 3], &m_fileNormals[n * 3] + 3, &m_normals[index * 3] );
+
+        const size_t t = ResolveIndex( texCoord, m_fileTexCoords.size() / 2 );
+        if (texCoord != 0 && t < m_fileTexCoords.size() / 2)
+            std::copy( &m_fileTexCoords[t * 2], &m_fileTexCoords[t * 2] + 2, &m_texCoords[index * 2] );
+
+        m_face.push_back( static_cast<uint32_t>(index) );
+    }
+
+    for (size_t i = 2; i < m_face.size(); ++i)
+    {
+        m_indices.push_back( m_face[0] );
+        m_indices.push_back( m_face[i - 1] );
+        m_indices.push_back( m_face[i] );
+    }
+}
+
+void ObjMesh::CreateVertices( Vertex* pVertices ) const
+{
+    for (size_t i = 0; i < GetVertexCount(); ++i)
+    {
+        Vertex& v = pVertices[i];
+        std::copy( &m_positions[i * 3], &m_positions[i * 3] + 3, v.position );
+        std::copy( &m_normals[i * 3], &m_normals[i * 3] + 3, v.normal );
+        std::copy( &m_texCoords[i * 2], &m_texCoords[i * 2] + 2, v.texCoord );
+
+        // TODO: Vertex color
+        std::fill( v.color, v.color + 4, 0.0f );
+    }
+}
+
+void ObjMesh::CreateIndices( uint16_t* pIndices ) const
+{
+    for (size_t i = 0; i < m_indices.size(); ++i)
+    {
+        pIndices[i] = static_cast<uint16_t>(m_indices[i]);
+    }
+}
+
+void ObjMesh::GetBounds( float lo[3], float hi[3] ) const
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        lo[axis] = FLT_MAX;
+        hi[axis] = -FLT_MAX;
+    }
+
+    for (size_t i = 0; i < GetVertexCount(); ++i)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            hi[axis] = std::max( m_positions[i * 3 + axis], hi[axis] );
+            lo[axis] = std::min( m_positions[i * 3 + axis], lo[axis] );
+        }
+    }
+}
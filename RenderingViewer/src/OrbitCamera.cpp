@@ -0,0 +1,172 @@
+#include "OrbitCamera.h"
+#include "BatchMath.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const float ROTATE_SPEED    = 1.0f / 50.0f;
+    const float TRANSLATE_SPEED = 1.0f / 100.0f;
+    const float ZOOM_SPEED      = 1.0f / 100.0f;
+
+    // Closest the wheel brings the position to the target
+    const float MIN_DISTANCE = 0.001f;
+
+    float Dot( const float a[3], const float b[3] )
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    void Cross( const float a[3], const float b[3], float out[3] )
+    {
+        const float result[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+        std::copy( result, result + 3, out );
+    }
+
+    // Returns the length it had
+    float Normalize( float v[3] )
+    {
+        const float length = sqrtf( Dot( v, v ) );
+        if (length > 0.0f)
+        {
+            v[0] /= length;
+            v[1] /= length;
+            v[2] /= length;
+        }
+        return length;
+    }
+
+    // v times m, rows weighted by the components: a camera space direction to world space for the pose
+    void Transform( const float m[9], const float v[3], float out[3] )
+    {
+        const float result[3] = { m[0] * v[0] + m[3] * v[1] + m[6] * v[2],
+                                  m[1] * v[0] + m[4] * v[1] + m[7] * v[2],
+                                  m[2] * v[0] + m[5] * v[1] + m[8] * v[2] };
+        std::copy( result, result + 3, out );
+    }
+
+    // a times b
+    void Multiply( const float a[9], const float b[9], float out[9] )
+    {
+        float result[9];
+        for (int row = 0; row < 3; ++row)
+        {
+            Transform( b, &a[row * 3], &result[row * 3] );
+        }
+        std::copy( result, result + 9, out );
+    }
+
+    // Rotation by angle around a unit axis, as Quatf( angle, axis ).GetRotationMatrix()
+    void AxisAngle( const float axis[3], float angle, float out[9] )
+    {
+        const float c = cosf( angle );
+        const float s = sinf( angle );
+        const float t = 1.0f - c;
+        const float x = axis[0], y = axis[1], z = axis[2];
+        const float m[9] = { t * x * x + c,     t * x * y + s * z, t * x * z - s * y,
+                             t * x * y - s * z, t * y * y + c,     t * y * z + s * x,
+                             t * x * z + s * y, t * y * z - s * x, t * z * z + c };
+        std::copy( m, m + 9, out );
+    }
+}
+
+bool OrbitCamera::Rotate( State& state, float dx, float dy )
+{
+    float d[3] = { dx, -dy, 0.0f };
+    if (Dot( d, d ) == 0.0f)
+        return false;
+
+    Transform( state.pose, d, d );
+
+    const float zAxis[3] = { 0.0f, 0.0f, 1.0f };
+    float lookAtDir[3];
+    Transform( state.pose, zAxis, lookAtDir );
+    Normalize( lookAtDir );
+
+    // Orbit the position around the target
+    float rotAxis[3];
+    Cross( d, lookAtDir, rotAxis );
+    const float rot = Normalize( rotAxis ) * ROTATE_SPEED;
+
+    float rotation[9];
+    AxisAngle( rotAxis, rot, rotation );
+
+    float offset[3] = { state.position[0] - state.lookAt[0], state.position[1] - state.lookAt[1], state.position[2] - state.lookAt[2] };
+    Transform( rotation, offset, offset );
+    for (int i = 0; i < 3; ++i)
+    {
+        state.position[i] = state.lookAt[i] + offset[i];
+    }
+
+    // Turn the pose so it keeps looking at the target
+    float targetDir[3] = { -offset[0], -offset[1], -offset[2] };
+    Normalize( targetDir );
+
+    float cameraRotAxis[3];
+    Cross( lookAtDir, targetDir, cameraRotAxis );
+    if (Normalize( cameraRotAxis ) > 0.0f)
+    {
+        const float theta = acosf( std::max( -1.0f, std::min( 1.0f, Dot( targetDir, lookAtDir ) ) ) );
+        AxisAngle( cameraRotAxis, theta, rotation );
+        Multiply( state.pose, rotation, state.pose );
+    }
+
+    return true;
+}
+
+bool OrbitCamera::Translate( State& state, float dx, float dy )
+{
+    float d[3] = { -dx, dy, 0.0f };
+    if (Dot( d, d ) == 0.0f)
+        return false;
+
+    Transform( state.pose, d, d );
+    for (int i = 0; i < 3; ++i)
+    {
+        state.position[i] += d[i] * TRANSLATE_SPEED;
+        state.lookAt[i]   += d[i] * TRANSLATE_SPEED;
+    }
+
+    return true;
+}
+
+bool OrbitCamera::Zoom( State& state, float dz )
+{
+    if (dz == 0.0f)
+        return false;
+
+    float dir[3] = { state.lookAt[0] - state.position[0], state.lookAt[1] - state.position[1], state.lookAt[2] - state.position[2] };
+    Normalize( dir );
+
+    float position[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        position[i] = state.position[i] + dz * ZOOM_SPEED * dir[i];
+    }
+
+    // Stop just short of the target instead of passing it
+    float newDir[3] = { state.lookAt[0] - position[0], state.lookAt[1] - position[1], state.lookAt[2] - position[2] };
+    Normalize( newDir );
+    if (Dot( dir, newDir ) < 0.0f)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            position[i] = state.lookAt[i] - dir[i] * MIN_DISTANCE;
+        }
+    }
+
+    std::copy( position, position + 3, state.position );
+    return true;
+}
+
+bool OrbitCamera::GetViewMatrix( const State& state, float view[16] )
+{
+    // The pose is rigid, the affine inverse is enough
+    const float pose[16] = { state.pose[0],     state.pose[1],     state.pose[2],     0.0f,
+                             state.pose[3],     state.pose[4],     state.pose[5],     0.0f,
+                             state.pose[6],     state.pose[7],     state.pose[8],     0.0f,
+                             state.position[0], state.position[1], state.position[2], 1.0f };
+
+    return BatchMath::InvertAffine( pose, view );
+}
@@ -0,0 +1,365 @@
+namespace
+{
+    template<typename T>
+    void Append( const T& value, vector<UINT8>& key )
+    {
+        const UINT8* pBytes = reinterpret_cast<const UINT8*>(&value);
+        key.insert( key.end(), pBytes, pBytes + sizeof( T ) );
+    }
+
+    // Terminated, so neighboring names cannot run together
+    void AppendString( const char* pStr, vector<UINT8>& key )
+    {
+        if (pStr != nullptr)
+            key.insert( key.end(), pStr, pStr + strlen( pStr ) );
+        key.push_back( 0 );
+    }
+
+    const char* SHADER_CACHE_DIRECTORY = "shader_cache";
+
+    // PipelineState( element, shader, root signature ) gives every pipeline the same blend, depth and
+    // rasterizer state; a pipeline created with any other needs its own value in the key
+    const UINT FIXED_FUNCTION_DEFAULT = 0;
+}
+
+PipelineCache::PipelineCache()
+    : m_pShaderCache( make_shared<ShaderCache>( SHADER_CACHE_DIRECTORY, Shader::Compile ) )
+{
+}
+
+PipelineCache::~PipelineCache()
+{
+    Release();
+}
+
+void PipelineCache::Release()
+{
+    m_compiler.Clear();
+    m_compilingStates.clear();
+
+    m_pipelineStates.clear();
+    m_rootSignatureHashes.clear();
+    m_rootSignatures.clear();
+    m_shaders.clear();
+}
+
+shared_ptr<RootSignature> PipelineCache::GetRootSignature( ID3D12Device* pDevice, const D3D12_ROOT_SIGNATURE_DESC& desc )
+{
+    CreateRootSignatureKey( desc, m_key );
+    const UINT64 hash = HashKey( m_key );
+
+    auto it = m_rootSignatures.find( hash );
+    if (it != m_rootSignatures.end() && it->second.key == m_key)
+    {
+        m_statistics.rootSignatureHits++;
+        return it->second.pRootSignature;
+    }
+
+    m_statistics.rootSignatureMisses++;
+
+    shared_ptr<RootSignature> pRootSignature = make_shared<RootSignature>();
+    pRootSignature->Create( pDevice, desc );
+
+    // The entry of the other key stays; this one is not shared
+    if (it != m_rootSignatures.end())
+    {
+        m_statistics.collisions++;
+        Log::Output( Log::LOG_LEVEL_ERROR, "PipelineCache::GetRootSignature() Hash Collision." );
+        return pRootSignature;
+    }
+
+    RootSignatureEntry& entry = m_rootSignatures[hash];
+    entry.key            = m_key;
+    entry.pRootSignature = pRootSignature;
+    m_rootSignatureHashes[pRootSignature.get()] = hash;
+
+    return pRootSignature;
+}
+
+shared_ptr<PipelineState> PipelineCache::GetPipelineState( ID3D12Device* pDevice,
+                                                           const PipelineState::InputElement& element,
+                                                           const PipelineState::ShaderCode& shader,
+                                                           shared_ptr<RootSignature> pRootSignature )
+{
+    UINT64 hash = 0;
+    const bool bKeyed = CreateRequestKey( element, shader, pRootSignature, hash );
+
+    auto it = bKeyed ? m_pipelineStates.find( hash ) : m_pipelineStates.end();
+    if (it != m_pipelineStates.end() && it->second.key == m_key)
+    {
+        m_statistics.pipelineStateHits++;
+        return it->second.pPipelineState;
+    }
+
+    m_statistics.pipelineStateMisses++;
+
+    shared_ptr<PipelineState> pPipelineState = make_shared<PipelineState>( element, shader, pRootSignature );
+    pPipelineState->Create( pDevice );
+
+    if (!bKeyed)
+        return pPipelineState;
+
+    if (it != m_pipelineStates.end())
+    {
+        m_statistics.collisions++;
+        Log::Output( Log::LOG_LEVEL_ERROR, "PipelineCache::GetPipelineState() Hash Collision." );
+        return pPipelineState;
+    }
+
+    PipelineStateEntry& entry = m_pipelineStates[hash];
+    entry.key            = m_key;
+    entry.pPipelineState = pPipelineState;
+
+    return pPipelineState;
+}
+
+shared_ptr<PipelineState> PipelineCache::RequestPipelineState( ID3D12Device* pDevice,
+                                                               const PipelineState::InputElement& element,
+                                                               const PipelineState::ShaderCode& shader,
+                                                               shared_ptr<RootSignature> pRootSignature )
+{
+    UINT64 hash = 0;
+    if (!CreateRequestKey( element, shader, pRootSignature, hash ))
+        return nullptr;
+
+    auto it = m_pipelineStates.find( hash );
+    if (it != m_pipelineStates.end() && it->second.key == m_key)
+    {
+        m_statistics.pipelineStateHits++;
+        return it->second.pPipelineState;
+    }
+
+    // Another key under the hash, published or being created: made on the calling thread, where a published
+    // entry keeps the hash to itself
+    auto compiling = m_compilingStates.find( hash );
+    if (it != m_pipelineStates.end() || (compiling != m_compilingStates.end() && compiling->second.key != m_key))
+        return GetPipelineState( pDevice, element, shader, pRootSignature );
+
+    // Being created, or failed
+    if (m_compiler.GetState( hash ) != PipelineCompiler::STATE_UNKNOWN)
+        return nullptr;
+
+    m_statistics.pipelineStateMisses++;
+
+    // The device creates pipelines on any thread; the cache itself is only touched here and in Update
+    shared_ptr<PipelineState> pPipelineState = make_shared<PipelineState>( element, shader, pRootSignature );
+
+    PipelineStateEntry& entry = m_compilingStates[hash];
+    entry.key            = m_key;
+    entry.pPipelineState = pPipelineState;
+
+    // A failed pipeline is never published; its contexts keep drawing with the fallback
+    m_compiler.Request( hash, [pDevice, pPipelineState]()
+    {
+        return pPipelineState->Create( pDevice );
+    } );
+
+    return nullptr;
+}
+
+UINT PipelineCache::Update()
+{
+    m_publishedKeys.clear();
+    const UINT count = m_compiler.Update( &m_publishedKeys );
+
+    for (UINT64 key : m_publishedKeys)
+    {
+        auto it = m_compilingStates.find( key );
+        if (it == m_compilingStates.end())
+            continue;
+
+        // A pipeline of another key may have been cached under the hash meanwhile; it stays
+        if (m_compiler.GetState( key ) == PipelineCompiler::STATE_READY)
+            m_pipelineStates.insert( make_pair( key, it->second ) );
+        else
+            Log::Output( Log::LOG_LEVEL_ERROR, "PipelineCache::Update() Creating Pipeline State Failed." );
+
+        m_compilingStates.erase( it );
+    }
+
+    return count;
+}
+
+bool PipelineCache::GetShader( const wstring& file, PipelineState::ShaderCode& shader )
+{
+    auto it = m_shaders.find( file );
+    if (it != m_shaders.end())
+    {
+        m_statistics.shaderHits++;
+    }
+    else
+    {
+        if (!PreloadShaders( vector<wstring>( 1, file ) ))
+            return false;
+
+        it = m_shaders.find( file );
+    }
+
+    const ShaderEntry& entry = it->second;
+    // Blobs stay mapped for the lifetime of the cache
+    shader.vs = { reinterpret_cast<UINT8*>(const_cast<void*>(entry.pVSBlob->GetData())), entry.pVSBlob->GetSize() };
+    shader.ps = { reinterpret_cast<UINT8*>(const_cast<void*>(entry.pPSBlob->GetData())), entry.pPSBlob->GetSize() };
+
+    return true;
+}
+
+bool PipelineCache::PreloadShaders( const vector<wstring>& files )
+{
+    PROFILE_SCOPE( "PipelineCache::PreloadShaders" );
+
+    const unsigned int flags = Shader::GetCompileFlags();
+
+    bool bSucceeded = true;
+
+    vector<wstring>                     pending;
+    vector<ShaderCache::CompileRequest> requests;
+
+    for (const auto& file : files)
+    {
+        if (m_shaders.find( file ) != m_shaders.end())
+            continue;
+
+        wstring path;
+        if (!Shader::SearchFilePath( file, path ))
+        {
+            Log::Output( Log::LOG_LEVEL_ERROR, "File Not Found." );
+            bSucceeded = false;
+            continue;
+        }
+
+        char narrowPath[520] = { 0 };
+        WideCharToMultiByte( CP_ACP, 0, path.c_str(), -1, narrowPath, _countof( narrowPath ), nullptr, nullptr );
+
+        pending.push_back( file );
+        requests.push_back( ShaderCache::CompileRequest( narrowPath, "VSMain", "vs_5_0", flags ) );
+        requests.push_back( ShaderCache::CompileRequest( narrowPath, "PSMain", "ps_5_0", flags ) );
+    }
+
+    vector<shared_ptr<ShaderCache::Blob> > blobs;
+    m_pShaderCache->Fetch( requests, blobs );
+
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        ShaderEntry entry;
+        entry.pVSBlob = blobs[i * 2 + 0];
+        entry.pPSBlob = blobs[i * 2 + 1];
+
+        if (entry.pVSBlob == nullptr || entry.pPSBlob == nullptr)
+        {
+            bSucceeded = false;
+            continue;
+        }
+
+        m_statistics.shaderLoads++;
+        m_shaders[pending[i]] = entry;
+    }
+
+    return bSucceeded;
+}
+
+bool PipelineCache::GetRootSignatureHash( const shared_ptr<RootSignature>& pRootSignature, UINT64& hash ) const
+{
+    auto it = m_rootSignatureHashes.find( pRootSignature.get() );
+    if (it == m_rootSignatureHashes.end())
+        return false;
+
+    hash = it->second;
+    return true;
+}
+
+bool PipelineCache::CreateRequestKey( const PipelineState::InputElement& element,
+                                      const PipelineState::ShaderCode& shader,
+                                      const shared_ptr<RootSignature>& pRootSignature,
+                                      UINT64& hash )
+{
+    UINT64 rootSignatureHash = 0;
+    if (!GetRootSignatureHash( pRootSignature, rootSignatureHash ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "PipelineCache::CreateRequestKey() Root Signature Not Cached." );
+        return false;
+    }
+
+    CreatePipelineStateKey( element, shader, rootSignatureHash, m_key );
+    hash = HashKey( m_key );
+
+    return true;
+}
+
+void PipelineCache::CreateRootSignatureKey( const D3D12_ROOT_SIGNATURE_DESC& desc, vector<UINT8>& key )
+{
+    key.clear();
+    Append( desc.Flags, key );
+    Append( desc.NumParameters, key );
+
+    for (UINT i = 0; i < desc.NumParameters; ++i)
+    {
+        const D3D12_ROOT_PARAMETER& param = desc.pParameters[i];
+
+        Append( param.ParameterType, key );
+        Append( param.ShaderVisibility, key );
+
+        switch (param.ParameterType)
+        {
+        case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+            Append( param.DescriptorTable.NumDescriptorRanges, key );
+            for (UINT j = 0; j < param.DescriptorTable.NumDescriptorRanges; ++j)
+            {
+                Append( param.DescriptorTable.pDescriptorRanges[j], key );
+            }
+            break;
+
+        case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+            Append( param.Constants, key );
+            break;
+
+        default:
+            Append( param.Descriptor, key );
+            break;
+        }
+    }
+
+    Append( desc.NumStaticSamplers, key );
+    for (UINT i = 0; i < desc.NumStaticSamplers; ++i)
+    {
+        Append( desc.pStaticSamplers[i], key );
+    }
+}
+
+void PipelineCache::CreatePipelineStateKey( const PipelineState::InputElement& element,
+                                            const PipelineState::ShaderCode& shader,
+                                            UINT64 rootSignatureHash,
+                                            vector<UINT8>& key )
+{
+    key.clear();
+    Append( FIXED_FUNCTION_DEFAULT, key );
+    Append( rootSignatureHash, key );
+
+    // The bytecode by its sizes and hash rather than a copy of it
+    Append( shader.vs.BytecodeLength, key );
+    Append( shader.ps.BytecodeLength, key );
+    Append( HashShaderCode( shader ), key );
+
+    for (const auto& desc : element.elements)
+    {
+        AppendString( desc.SemanticName, key );
+        Append( desc.SemanticIndex, key );
+        Append( desc.Format, key );
+        Append( desc.InputSlot, key );
+        Append( desc.AlignedByteOffset, key );
+        Append( desc.InputSlotClass, key );
+        Append( desc.InstanceDataStepRate, key );
+    }
+}
+
+UINT64 PipelineCache::HashKey( const vector<UINT8>& key )
+{
+    return Hash::Fnv1a( key.data(), key.size() );
+}
+
+UINT64 PipelineCache::HashShaderCode( const PipelineState::ShaderCode& shader )
+{
+    UINT64 hash = Hash::Fnv1a( shader.vs.pShaderBytecode, shader.vs.BytecodeLength );
+    hash = Hash::Fnv1a( shader.ps.pShaderBytecode, shader.ps.BytecodeLength, hash );
+
+    return hash;
+}
@@ -0,0 +1,175 @@
+#include "PipelineCompiler.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    bool RunCompile( const PipelineCompiler::CompileFunc& compile, double& milliseconds )
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        const bool bSucceeded = compile();
+
+        milliseconds = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+        return bSucceeded;
+    }
+}
+
+PipelineCompiler::PipelineCompiler( uint32_t threadCount )
+    : m_pendingCount( 0 )
+    , m_frame( 0 )
+    , m_running( 0 )
+    , m_bStop( false )
+    , m_threadCount( threadCount )
+{
+}
+
+PipelineCompiler::~PipelineCompiler()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_bStop = true;
+        m_queue.clear();
+    }
+    m_wake.notify_all();
+
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+PipelineCompiler::STATE PipelineCompiler::Request( uint64_t key, const CompileFunc& compile )
+{
+    auto it = m_states.find( key );
+    if (it != m_states.end())
+        return it->second;
+
+    m_states[key] = STATE_COMPILING;
+    m_pendingCount++;
+    m_statistics.requests++;
+
+    std::unique_ptr<Compile> pCompile( new Compile() );
+    pCompile->key          = key;
+    pCompile->compile      = compile;
+    pCompile->frame        = m_frame;
+    pCompile->bSucceeded   = false;
+    pCompile->milliseconds = 0.0;
+
+    // Without threads the caller pays for the compile, and it is still published by the next Update
+    if (m_threadCount == 0)
+    {
+        pCompile->bSucceeded = RunCompile( pCompile->compile, pCompile->milliseconds );
+
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_finished.push_back( std::move( pCompile ) );
+        return STATE_COMPILING;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_queue.push_back( std::move( pCompile ) );
+    }
+    m_wake.notify_one();
+
+    if (m_threads.empty())
+    {
+        m_threads.reserve( m_threadCount );
+        for (uint32_t i = 0; i < m_threadCount; ++i)
+        {
+            m_threads.push_back( std::thread( &PipelineCompiler::Loop, this ) );
+        }
+    }
+
+    return STATE_COMPILING;
+}
+
+PipelineCompiler::STATE PipelineCompiler::GetState( uint64_t key ) const
+{
+    auto it = m_states.find( key );
+    return it != m_states.end() ? it->second : STATE_UNKNOWN;
+}
+
+uint32_t PipelineCompiler::Update( std::vector<uint64_t>* pKeys )
+{
+    m_frame++;
+
+    if (m_pendingCount == 0)
+        return 0;
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_publishing.swap( m_finished );
+    }
+
+    for (const auto& pCompile : m_publishing)
+    {
+        m_states[pCompile->key] = pCompile->bSucceeded ? STATE_READY : STATE_FAILED;
+        m_pendingCount--;
+
+        m_statistics.published++;
+        m_statistics.failures              += pCompile->bSucceeded ? 0 : 1;
+        m_statistics.compileMilliseconds   += pCompile->milliseconds;
+        m_statistics.maxCompileMilliseconds = std::max( m_statistics.maxCompileMilliseconds, pCompile->milliseconds );
+        m_statistics.maxLatencyFrames       = std::max( m_statistics.maxLatencyFrames, m_frame - pCompile->frame );
+
+        if (pKeys != nullptr)
+            pKeys->push_back( pCompile->key );
+    }
+
+    const uint32_t count = static_cast<uint32_t>(m_publishing.size());
+    m_publishing.clear();
+
+    return count;
+}
+
+void PipelineCompiler::Wait()
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_idle.wait( lock, [&]() { return m_queue.empty() && m_running == 0; } );
+}
+
+void PipelineCompiler::Clear()
+{
+    Wait();
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_finished.clear();
+    }
+
+    m_states.clear();
+    m_pendingCount = 0;
+}
+
+void PipelineCompiler::Loop()
+{
+    Profiler::SetThreadName( "Pipeline compiler" );
+
+    for (;;)
+    {
+        std::unique_ptr<Compile> pCompile;
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_wake.wait( lock, [&]() { return m_bStop || !m_queue.empty(); } );
+            if (m_bStop)
+                return;
+
+            pCompile = std::move( m_queue.front() );
+            m_queue.pop_front();
+            m_running++;
+        }
+
+        pCompile->bSucceeded = RunCompile( pCompile->compile, pCompile->milliseconds );
+
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_finished.push_back( std::move( pCompile ) );
+            m_running--;
+        }
+        m_idle.notify_all();
+    }
+}
@@ -0,0 +1,463 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#if (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))) || (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)))
+#define PROFILER_TSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+std::atomic<bool> Profiler::s_bEnabled( false );
+
+namespace
+{
+    int64_t ReadNanoseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+
+    // Zones are stamped with the time stamp counter where there is one, which is several times cheaper
+    // to read than the OS clock, and converted to time when they are read
+    inline int64_t ReadTicks()
+    {
+#if PROFILER_TSC
+        return static_cast<int64_t>(__rdtsc());
+#else
+        return ReadNanoseconds();
+#endif
+    }
+
+    struct Calibration
+    {
+        int64_t ticks;
+        int64_t nanoseconds;
+    };
+
+    const Calibration& GetOrigin()
+    {
+        static const Calibration origin = { ReadTicks(), ReadNanoseconds() };
+        return origin;
+    }
+
+    // Milliseconds per tick, measured against the OS clock since the profiler was first used
+    double GetTickMilliseconds()
+    {
+#if PROFILER_TSC
+        const Calibration& origin = GetOrigin();
+        const int64_t ticks       = ReadTicks() - origin.ticks;
+        const int64_t nanoseconds = ReadNanoseconds() - origin.nanoseconds;
+        if (ticks > 0 && nanoseconds > 0)
+            return static_cast<double>(nanoseconds) / ticks / 1000000.0;
+#endif
+        return 1.0 / 1000000.0;
+    }
+
+    struct Event
+    {
+        const char* name;
+        int64_t     begin;
+        int64_t     end;
+        uint32_t    depth;
+    };
+
+    // Written only by the thread that holds it; head is published with release so readers see whole events
+    struct ThreadBuffer
+    {
+        explicit ThreadBuffer( uint32_t threadId )
+            : id( threadId )
+            , events( Profiler::EVENTS_PER_THREAD )
+            , head( 0 )
+            , first( 0 )
+            , cursor( 0 )
+            , bInUse( true )
+        {
+            name = "Thread " + std::to_string( id );
+        }
+
+        uint32_t              id;
+        std::string           name;
+        std::vector<Event>    events;
+        std::atomic<uint64_t> head;
+
+        // Guarded by the registry mutex
+        uint64_t              first;    // oldest event kept after Reset
+        uint64_t              cursor;   // next event for the frame summary
+        bool                  bInUse;
+    };
+
+    struct Registry
+    {
+        std::mutex                                 mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    };
+
+    Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    // Hands the ring back when the thread exits, so short-lived workers reuse rings instead of adding one each
+    struct ThreadSlot
+    {
+        ThreadSlot()
+            : pBuffer( nullptr )
+            , depth( 0 )
+        {
+        }
+
+        ~ThreadSlot()
+        {
+            if (pBuffer == nullptr)
+                return;
+
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock( registry.mutex );
+            pBuffer->bInUse = false;
+        }
+
+        ThreadBuffer* pBuffer;
+        uint32_t      depth;
+    };
+
+    thread_local ThreadSlot t_slot;
+
+    ThreadBuffer* AcquireBuffer()
+    {
+        GetOrigin();
+
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock( registry.mutex );
+
+        for (auto& pBuffer : registry.buffers)
+        {
+            if (!pBuffer->bInUse)
+            {
+                pBuffer->bInUse = true;
+                return pBuffer.get();
+            }
+        }
+
+        registry.buffers.push_back( std::unique_ptr<ThreadBuffer>( new ThreadBuffer( static_cast<uint32_t>(registry.buffers.size()) ) ) );
+        return registry.buffers.back().get();
+    }
+
+    ThreadBuffer* GetThreadBuffer()
+    {
+        if (t_slot.pBuffer == nullptr)
+            t_slot.pBuffer = AcquireBuffer();
+
+        return t_slot.pBuffer;
+    }
+
+    struct ExternalZone
+    {
+        const char* name;
+        uint32_t    depth;
+        double      milliseconds;
+    };
+
+    // Main thread only
+    struct FrameState
+    {
+        FrameState()
+            : frameBegin( 0 )
+        {
+            std::fill( frameHistory, frameHistory + Profiler::SUMMARY_FRAMES, 0.0 );
+        }
+
+        int64_t                             frameBegin;
+        std::vector<ExternalZone>           externalZones;
+        double                              frameHistory[Profiler::SUMMARY_FRAMES];
+        std::vector<std::vector<double> >   zoneHistory;    // per zone of the summary
+        std::vector<double>                 zoneTotals;     // of the frame being folded, kept for their capacity
+        std::vector<uint32_t>               zoneCalls;
+        Profiler::Summary                   summary;
+    };
+
+    FrameState& GetFrameState()
+    {
+        static FrameState state;
+        return state;
+    }
+
+    // Names are compared by pointer first; the same literal may still live at several addresses
+    size_t FindZone( std::vector<Profiler::ZoneStatistics>& zones, const char* name )
+    {
+        for (size_t i = 0; i < zones.size(); ++i)
+        {
+            if (zones[i].name == name)
+                return i;
+        }
+        for (size_t i = 0; i < zones.size(); ++i)
+        {
+            if (strcmp( zones[i].name, name ) == 0)
+                return i;
+        }
+        return zones.size();
+    }
+
+    void WriteJsonString( std::ostream& stream, const char* text )
+    {
+        stream << '"';
+        for (const char* p = text; *p != '\0'; ++p)
+        {
+            if (*p == '"' || *p == '\\')
+                stream << '\\' << *p;
+            else if (static_cast<unsigned char>(*p) >= 0x20)
+                stream << *p;
+        }
+        stream << '"';
+    }
+}
+
+void Profiler::Scope::Begin( const char* name )
+{
+    GetThreadBuffer();
+    t_slot.depth++;
+
+    m_name  = name;
+    m_begin = ReadTicks();
+}
+
+void Profiler::Scope::End()
+{
+    const int64_t end = ReadTicks();
+
+    ThreadBuffer* pBuffer = t_slot.pBuffer;
+    t_slot.depth--;
+
+    const uint64_t head = pBuffer->head.load( std::memory_order_relaxed );
+    Event& event = pBuffer->events[head % EVENTS_PER_THREAD];
+    event.name  = m_name;
+    event.begin = m_begin;
+    event.end   = end;
+    event.depth = t_slot.depth;
+    pBuffer->head.store( head + 1, std::memory_order_release );
+}
+
+void Profiler::SetThreadName( const char* name )
+{
+    ThreadBuffer* pBuffer = GetThreadBuffer();
+
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock( registry.mutex );
+    pBuffer->name = name;
+}
+
+void Profiler::BeginFrame()
+{
+    GetOrigin();
+
+    GetFrameState().frameBegin = IsEnabled() ? ReadTicks() : 0;
+}
+
+void Profiler::EndFrame()
+{
+    FrameState& state = GetFrameState();
+    if (state.frameBegin == 0)
+    {
+        state.externalZones.clear();
+        return;
+    }
+
+    const int64_t frameEnd        = ReadTicks();
+    const double  tickMilliseconds = GetTickMilliseconds();
+
+    Summary& summary = state.summary;
+    const uint32_t slot = static_cast<uint32_t>(summary.frames % SUMMARY_FRAMES);
+
+    std::vector<double>&   totals = state.zoneTotals;
+    std::vector<uint32_t>& calls  = state.zoneCalls;
+    totals.assign( summary.zones.size(), 0.0 );
+    calls.assign( summary.zones.size(), 0 );
+
+    auto addZone = [&]( const char* name, uint32_t depth, double milliseconds )
+    {
+        const size_t zone = FindZone( summary.zones, name );
+        if (zone == summary.zones.size())
+        {
+            ZoneStatistics stats;
+            stats.name                = name;
+            stats.depth               = depth;
+            stats.calls               = 0;
+            stats.lastMilliseconds    = 0.0;
+            stats.averageMilliseconds = 0.0;
+            stats.maxMilliseconds     = 0.0;
+            summary.zones.push_back( stats );
+            state.zoneHistory.push_back( std::vector<double>( SUMMARY_FRAMES, 0.0 ) );
+            totals.push_back( 0.0 );
+            calls.push_back( 0 );
+        }
+
+        totals[zone] += milliseconds;
+        calls[zone]++;
+    };
+
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock( registry.mutex );
+
+        for (auto& pBuffer : registry.buffers)
+        {
+            const uint64_t head = pBuffer->head.load( std::memory_order_acquire );
+            if (head - pBuffer->cursor > EVENTS_PER_THREAD)
+            {
+                summary.droppedEvents += head - pBuffer->cursor - EVENTS_PER_THREAD;
+                pBuffer->cursor        = head - EVENTS_PER_THREAD;
+            }
+
+            for (; pBuffer->cursor < head; ++pBuffer->cursor)
+            {
+                const Event& event = pBuffer->events[pBuffer->cursor % EVENTS_PER_THREAD];
+
+                // Zones opened before the frame, e.g. while loading, are left to the trace
+                if (event.begin < state.frameBegin)
+                    continue;
+
+                addZone( event.name, event.depth, (event.end - event.begin) * tickMilliseconds );
+            }
+        }
+    }
+
+    for (const ExternalZone& zone : state.externalZones)
+    {
+        addZone( zone.name, zone.depth, zone.milliseconds );
+    }
+    state.externalZones.clear();
+
+    const uint32_t window = static_cast<uint32_t>(std::min<uint64_t>( summary.frames + 1, SUMMARY_FRAMES ));
+    auto fold = [&]( double* pHistory, double value, double& average, double& maximum )
+    {
+        pHistory[slot] = value;
+
+        double sum = 0.0;
+        maximum    = 0.0;
+        for (uint32_t i = 0; i < window; ++i)
+        {
+            sum     += pHistory[i];
+            maximum  = std::max( maximum, pHistory[i] );
+        }
+        average = sum / window;
+    };
+
+    summary.lastMilliseconds = (frameEnd - state.frameBegin) * tickMilliseconds;
+    fold( state.frameHistory, summary.lastMilliseconds, summary.averageMilliseconds, summary.maxMilliseconds );
+
+    for (size_t i = 0; i < summary.zones.size(); ++i)
+    {
+        ZoneStatistics& zone = summary.zones[i];
+        zone.calls            = calls[i];
+        zone.lastMilliseconds = totals[i];
+        fold( state.zoneHistory[i].data(), totals[i], zone.averageMilliseconds, zone.maxMilliseconds );
+    }
+
+    summary.frames++;
+    state.frameBegin = 0;
+}
+
+void Profiler::AddZone( const char* name, uint32_t depth, double milliseconds )
+{
+    if (!IsEnabled())
+        return;
+
+    ExternalZone zone;
+    zone.name         = name;
+    zone.depth        = depth;
+    zone.milliseconds = milliseconds;
+    GetFrameState().externalZones.push_back( zone );
+}
+
+const Profiler::Summary& Profiler::GetSummary()
+{
+    return GetFrameState().summary;
+}
+
+bool Profiler::WriteChromeTrace( const std::string& path )
+{
+    std::ofstream stream( path.c_str() );
+    if (!stream)
+        return false;
+
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock( registry.mutex );
+
+    // Times relative to the oldest kept event, in microseconds as the format expects
+    const double tickMicroseconds = GetTickMilliseconds() * 1000.0;
+
+    int64_t origin = INT64_MAX;
+    for (auto& pBuffer : registry.buffers)
+    {
+        const uint64_t head = pBuffer->head.load( std::memory_order_acquire );
+        const uint64_t tail = std::max( pBuffer->first, head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0 );
+        for (uint64_t i = tail; i < head; ++i)
+        {
+            origin = std::min( origin, pBuffer->events[i % EVENTS_PER_THREAD].begin );
+        }
+    }
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool bFirst = true;
+    auto separate = [&]()
+    {
+        stream << (bFirst ? "\n" : ",\n");
+        bFirst = false;
+    };
+
+    stream.setf( std::ios::fixed );
+    stream.precision( 3 );
+
+    for (auto& pBuffer : registry.buffers)
+    {
+        separate();
+        stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << pBuffer->id << ",\"args\":{\"name\":";
+        WriteJsonString( stream, pBuffer->name.c_str() );
+        stream << "}}";
+
+        const uint64_t head = pBuffer->head.load( std::memory_order_acquire );
+        const uint64_t tail = std::max( pBuffer->first, head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0 );
+        for (uint64_t i = tail; i < head; ++i)
+        {
+            const Event& event = pBuffer->events[i % EVENTS_PER_THREAD];
+
+            separate();
+            stream << "{\"name\":";
+            WriteJsonString( stream, event.name );
+            stream << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << pBuffer->id
+                   << ",\"ts\":" << (event.begin - origin) * tickMicroseconds
+                   << ",\"dur\":" << (event.end - event.begin) * tickMicroseconds << "}";
+        }
+    }
+
+    stream << "\n]}\n";
+
+    return static_cast<bool>(stream);
+}
+
+void Profiler::Reset()
+{
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock( registry.mutex );
+
+        for (auto& pBuffer : registry.buffers)
+        {
+            const uint64_t head = pBuffer->head.load( std::memory_order_acquire );
+            pBuffer->first  = head;
+            pBuffer->cursor = head;
+        }
+    }
+
+    FrameState& state = GetFrameState();
+    state = FrameState();
+}
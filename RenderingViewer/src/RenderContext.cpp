@@ -1,90 +1,121 @@
 ﻿RenderContext::RenderContext( ID3D12Device* pDevice )
-    : m_pCommandList( make_shared<CommandList>( pDevice, D3D12_COMMAND_LIST_TYPE_DIRECT ) )
+    : m_descriptorIndex( DescriptorAllocator::INVALID_INDEX )
+    , m_descriptorCount( 0 )
+    , m_boundDescriptorCount( 0 )
 {
+    AC_USE_VAR( pDevice );
 }
 
 RenderContext::~RenderContext()
 {
 }
 
-void RenderContext::Reset()
-{
-    m_pCommandList->Reset( m_pPipelineState );
-}
-
-bool RenderContext::Clear( const ConstructParams& params )
+bool RenderContext::Clear( shared_ptr<CommandList> pCommandList, const ConstructParams& params )
 {
     if (params.bDSOnly)
     {
-        m_pCommandList->Begin( params.depthStencil, params.targetStateSrc, params.targetStateDst );
-        {
-            auto hadleDS = params.hadleDS;
+        auto hadleDS = params.hadleDS;
 
-            m_pCommandList->SetTargets( nullptr, &hadleDS );
-
-            m_pCommandList->ClearTargets( nullptr, nullptr, &hadleDS, D3D12_CLEAR_FLAG_DEPTH, params.clearVal );
-        }
-        m_pCommandList->End();
+        pCommandList->ClearTargets( nullptr, nullptr, &hadleDS, D3D12_CLEAR_FLAG_DEPTH, params.clearVal );
     }
     else
     {
-        m_pCommandList->Begin( params.renderTarget, params.targetStateSrc, params.targetStateDst );
-        {
-            auto handleRTV = params.hadleRT;
-            auto handleDSV = params.hadleDS;
-
-            m_pCommandList->SetTargets( &handleRTV, &handleDSV );
+        auto handleRTV = params.hadleRT;
+        auto handleDSV = params.hadleDS;
 
-            float clearColor[] = { params.clearColor.x, params.clearColor.y, params.clearColor.z, 1.0f };
-            m_pCommandList->ClearTargets( &handleRTV, clearColor, &handleDSV, D3D12_CLEAR_FLAG_DEPTH, params.clearVal );
-        }
-        m_pCommandList->End();
+        float clearColor[] = { params.clearColor.x, params.clearColor.y, params.clearColor.z, 1.0f };
+        pCommandList->ClearTargets( &handleRTV, clearColor, &handleDSV, D3D12_CLEAR_FLAG_DEPTH, params.clearVal );
     }
 
     return true;
 }
 
-bool RenderContext::Draw( const ConstructParams& params )
+bool RenderContext::GetDrawPacket( DrawPacket& packet ) const
 {
-    if (m_pNode == nullptr)
+    if (m_pNode == nullptr || !m_pNode->IsNodeType( Node::NODE_TYPE_MODEL ))
         return false;
 
-    m_pCommandList->SetRootSignature( m_pRootSignature );
-    m_pCommandList->SetDescriptorHeaps( 1, m_pDescHeap );
-    m_pCommandList->SetPipelineState( m_pPipelineState );
+    const Model* pModel = static_cast<const Model*>(m_pNode.get());
 
-    m_pCommandList->SetViewport( params.viewport );
+    const Model::BoundingBox& boundingBox = pModel->GetBoundingBox();
+    m_bindings.CreatePacket( this, pModel, static_cast<UINT>(pModel->GetIndexCount()), &boundingBox.lo.x, &boundingBox.hi.x, packet );
 
-    shared_ptr<Model> pModel = static_pointer_cast<Model>(m_pNode);
+    return true;
+}
 
-    if (params.bDSOnly)
+void RenderContext::SetDescriptorTable( shared_ptr<GlobalDescriptorHeap> pDescHeap, UINT index, UINT count )
+{
+    m_pDescHeap            = pDescHeap;
+    m_descriptorIndex      = index;
+    m_descriptorCount      = count;
+    m_boundDescriptorCount = 0;
+
+    m_bindings.SetDescriptorIndex( index );
+}
+
+bool RenderContext::BindDescriptor( ID3D12Device* pDevice, shared_ptr<Buffer> pBuffer, Buffer::BUFFER_VIEW_TYPE type )
+{
+    if (m_pDescHeap == nullptr || m_descriptorIndex == DescriptorAllocator::INVALID_INDEX)
+        return false;
+
+    if (m_boundDescriptorCount >= m_descriptorCount)
     {
-        m_pCommandList->Begin( params.depthStencil, params.targetStateSrc, params.targetStateDst );
-        {
-            auto hadleDS = params.hadleDS;
+        Log::Output( Log::LOG_LEVEL_ERROR, "RenderContext::BindDescriptor() Descriptor table is full." );
+        return false;
+    }
 
-            m_pCommandList->SetTargets( nullptr, &hadleDS );
+    return m_pDescHeap->CreateView( pDevice, pBuffer, type, m_descriptorIndex + m_boundDescriptorCount++ );
+}
 
-            m_pCommandList->Draw( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, pModel->GetVertexBuffer(), pModel->GetIndexBuffer(), pModel->GetIndexCount() );
-        }
-        m_pCommandList->End();
+bool RenderContext::AddConstantBuffer( shared_ptr<Node> pNode )
+{
+    if (!m_bindings.AddConstantBuffer( pNode.get() ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "RenderContext::AddConstantBuffer() Too many constant buffers." );
+        return false;
     }
-    else
+
+    m_pBoundNodes.push_back( pNode );
+
+    return true;
+}
+
+bool RenderContext::AddShaderResources( shared_ptr<Node> pNode )
+{
+    if (!m_bindings.AddShaderResources( pNode.get() ))
     {
-        m_pCommandList->Begin( params.renderTarget, params.targetStateSrc, params.targetStateDst );
-        {
-            auto handleRTV = params.hadleRT;
-            auto handleDSV = params.hadleDS;
+        Log::Output( Log::LOG_LEVEL_ERROR, "RenderContext::AddShaderResources() Too many shader resources." );
+        return false;
+    }
+
+    m_pBoundNodes.push_back( pNode );
 
-            m_pCommandList->SetTargets( &handleRTV, &handleDSV );
+    return true;
+}
+
+bool RenderContext::BindForward( shared_ptr<Node> pCamera, shared_ptr<Node> pLight, shared_ptr<Node> pMaterial, shared_ptr<Node> pLightClusters )
+{
+    DrawBindings::ForwardSources sources;
+    sources.pCamera        = pCamera.get();
+    sources.pLight         = pLight.get();
+    sources.pMaterial      = pMaterial.get();
+    sources.pLightClusters = pLightClusters.get();
+
+    if (!m_bindings.BindForward( sources ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "RenderContext::BindForward() Too many root arguments." );
+        return false;
+    }
 
-            m_pCommandList->Draw( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, pModel->GetVertexBuffer(), pModel->GetIndexBuffer(), pModel->GetIndexCount() );
-        }
-        m_pCommandList->End();
+    for (const auto& pNode : { pCamera, pLight, pMaterial, pLightClusters })
+    {
+        if (pNode != nullptr)
+            m_pBoundNodes.push_back( pNode );
     }
 
     return true;
 }
+
 void RenderContext::SetNode( shared_ptr<Node> pNode )
 {
     m_pNode = pNode;
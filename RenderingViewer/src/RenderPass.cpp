@@ -1,10 +1,30 @@
-﻿RenderPass::RenderPass( ID3D12Device* pDevice )
+﻿namespace
 {
-    AC_USE_VAR( pDevice );
+    // Contexts per gather job; a scene of fewer is gathered on the calling thread
+    const uint32_t GATHER_GRAIN = 256;
+
+    enum GATHER_RESULT : uint8_t
+    {
+        GATHER_RESULT_NONE,         // not a model
+        GATHER_RESULT_PACKET,
+        GATHER_RESULT_FALLBACK,     // drawn with the fallback pipeline
+        GATHER_RESULT_SKIPPED,      // no pipeline at all
+    };
+}
+
+RenderPass::RenderPass( ID3D12Device* pDevice )
+    : m_pCommandList( make_shared<CommandList>( pDevice, D3D12_COMMAND_LIST_TYPE_DIRECT ) )
+    , m_pDrawPackets( nullptr )
+    , m_drawPacketCount( 0 )
+    , m_gpuTimerName( nullptr )
+    , m_gpuZone( GpuTimer::INVALID_ZONE )
+{
+    m_drawRecorder.SetSortPass( SORT_PASS_OPAQUE );
 }
 
 RenderPass::~RenderPass()
 {
+    ReleaseDescriptorTables();
 }
 
 void RenderPass::SetScene( shared_ptr<Scene> pScene )
@@ -14,43 +34,298 @@ void RenderPass::SetScene( shared_ptr<Scene> pScene )
 
 void RenderPass::BindResource( ID3D12Device* pDevice, shared_ptr<Buffer> pResource, Buffer::BUFFER_VIEW_TYPE type )
 {
-    for (auto pRenderContext : m_pRenderContexts)
+    // Contexts may share a table, in which case the view is only written once
+    vector<UINT> boundIndices;
+    for (const auto& pRenderContext : m_pRenderContexts)
     {
-        pResource->CreateBufferView( pDevice, pRenderContext->GetDescHeap(), type );
+        UINT index = pRenderContext->GetDescriptorIndex();
+        if (index != DescriptorAllocator::INVALID_INDEX && find( boundIndices.begin(), boundIndices.end(), index ) != boundIndices.end())
+            continue;
+
+        pRenderContext->BindDescriptor( pDevice, pResource, type );
+        boundIndices.push_back( index );
     }
 }
 
+void RenderPass::SetGpuTimer( shared_ptr<GpuTimer> pGpuTimer, const char* name )
+{
+    m_pGpuTimer    = pGpuTimer;
+    m_gpuTimerName = name;
+}
+
+void RenderPass::SetSortView( const Vec3f& origin, const Vec3f& direction, float depthRange )
+{
+    m_drawRecorder.SetSortView( &origin.x, &direction.x, depthRange );
+}
+
 void RenderPass::Construct( ID3D12Device* pDevice )
 {
     AC_USE_VAR( pDevice );
     m_pRenderContexts.clear();
+    m_pendingContexts.clear();
+    m_drawRecorder.ClearSortIds();
+
+    ReleaseDescriptorTables();
 }
 
-void RenderPass::Draw( const RenderContext::ConstructParams& params )
+UINT RenderPass::UpdatePipelineStates( ID3D12Device* pDevice )
 {
-    for (auto pRenderContext : m_pRenderContexts)
+    UINT count = 0;
+    for (size_t i = 0; i < m_pendingContexts.size();)
     {
-        pRenderContext->Draw( params );
+        auto& pending = m_pendingContexts[i];
+
+        shared_ptr<PipelineState> pPipelineState = CreatePipelineState( pDevice, pending.first->GetRootSignature(), pending.second );
+        if (pPipelineState == nullptr)
+        {
+            ++i;
+            continue;
+        }
+
+        pending.first->SetPipelineState( pPipelineState );
+        count++;
+
+        pending = m_pendingContexts.back();
+        m_pendingContexts.pop_back();
     }
+
+    return count;
 }
 
-void RenderPass::Render( ID3D12CommandQueue* pCommadnQueue )
+void RenderPass::AssignPipelineState( ID3D12Device* pDevice, shared_ptr<RenderContext> pContext, shared_ptr<Node> pNode )
 {
-    ID3D12CommandList* cmdList[1024];
+    shared_ptr<PipelineState> pPipelineState = CreatePipelineState( pDevice, pContext->GetRootSignature(), pNode );
+    if (pPipelineState == nullptr)
+    {
+        pPipelineState = m_pFallbackPipelineState;
+        m_pendingContexts.push_back( make_pair( pContext, pNode ) );
+    }
 
-    for (int i = 0; i < m_pRenderContexts.size(); ++i)
+    pContext->SetPipelineState( pPipelineState );
+}
+
+UINT RenderPass::AllocateDescriptorTable( UINT count )
+{
+    if (m_pDescHeap == nullptr)
+        return DescriptorAllocator::INVALID_INDEX;
+
+    UINT index = m_pDescHeap->AllocatePersistent( count );
+    if (index == DescriptorAllocator::INVALID_INDEX)
     {
-        const auto& pCommand = m_pRenderContexts[i]->GetCommandList();
-        cmdList[i] = pCommand->GetCommandList();
+        Log::Output( Log::LOG_LEVEL_ERROR, "RenderPass::AllocateDescriptorTable() Failed." );
+        return index;
     }
 
-    pCommadnQueue->ExecuteCommandLists( (UINT)m_pRenderContexts.size(), cmdList );
+    m_descriptorTables.push_back( make_pair( index, count ) );
+
+    return index;
 }
 
-void RenderPass::Reset()
+void RenderPass::ReleaseDescriptorTables()
 {
-    for (auto pRenderContext : m_pRenderContexts)
+    if (m_pDescHeap != nullptr)
     {
-        pRenderContext->Reset();
+        for (const auto& table : m_descriptorTables)
+        {
+            m_pDescHeap->FreePersistent( table.first, table.second );
+        }
     }
+
+    m_descriptorTables.clear();
+}
+
+void RenderPass::Draw( const RenderContext::ConstructParams& params )
+{
+    m_statistics.Clear();
+
+    GatherDrawPackets();
+
+    SortDrawPackets();
+
+    RecordDrawPackets( params );
+}
+
+template <typename T>
+T* RenderPass::AllocateFrameData( size_t count )
+{
+    if (count == 0)
+        return nullptr;
+
+    if (m_pFrameArena == nullptr)
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "RenderPass::AllocateFrameData() No frame arena." );
+        return nullptr;
+    }
+
+    return m_pFrameArena->Allocate<T>( count );
+}
+
+void RenderPass::GatherDrawPackets()
+{
+    PROFILE_SCOPE( "GatherDrawPackets" );
+
+    const uint32_t count = static_cast<uint32_t>(m_pRenderContexts.size());
+
+    m_drawPacketCount = 0;
+    m_pDrawPackets    = AllocateFrameData<RenderContext::DrawPacket>( count );
+    uint8_t* pResults = AllocateFrameData<uint8_t>( count );
+    if (m_pDrawPackets == nullptr || pResults == nullptr)
+        return;
+
+    // Contexts only read their nodes here, so each writes the packet at its own index
+    auto gather = [&]( uint32_t i )
+    {
+        const RenderContext& context = *m_pRenderContexts[i];
+
+        const shared_ptr<PipelineState>& pPipelineState = context.GetPipelineState();
+        if (pPipelineState == nullptr)
+            pResults[i] = GATHER_RESULT_SKIPPED;
+        else if (!context.GetDrawPacket( m_pDrawPackets[i] ))
+            pResults[i] = GATHER_RESULT_NONE;
+        else
+            pResults[i] = pPipelineState == m_pFallbackPipelineState ? GATHER_RESULT_FALLBACK : GATHER_RESULT_PACKET;
+    };
+    JobSystem::GetInstance().ParallelFor( count, gather, GATHER_GRAIN );
+
+    // Packed in context order, so the frame does not depend on which thread gathered what
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (pResults[i] == GATHER_RESULT_SKIPPED)
+        {
+            m_statistics.skippedDraws++;
+            continue;
+        }
+
+        if (pResults[i] == GATHER_RESULT_NONE)
+            continue;
+
+        if (pResults[i] == GATHER_RESULT_FALLBACK)
+            m_statistics.fallbackDraws++;
+
+        if (m_drawPacketCount != i)
+            m_pDrawPackets[m_drawPacketCount] = m_pDrawPackets[i];
+        m_drawPacketCount++;
+    }
+}
+
+void RenderPass::SortDrawPackets()
+{
+    PROFILE_SCOPE( "SortDrawPackets" );
+
+    DrawSort::Item* pItems = AllocateFrameData<DrawSort::Item>( m_drawPacketCount );
+    if (pItems == nullptr)
+        m_drawPacketCount = 0;
+
+    m_drawRecorder.Sort( m_pDrawPackets, pItems, m_drawPacketCount, m_statistics );
+}
+
+void RenderPass::RecordDrawPackets( const RenderContext::ConstructParams& params )
+{
+    BeginRecording( params );
+
+    RecordDrawItems();
+
+    EndRecording();
+}
+
+void RenderPass::BeginRecording( const RenderContext::ConstructParams& params )
+{
+    // Reset left the list open, so the zone starts ahead of the target transition
+    m_gpuZone = GpuTimer::INVALID_ZONE;
+    if (m_pGpuTimer != nullptr)
+        m_gpuZone = m_pGpuTimer->BeginZone( m_pCommandList->GetCommandList(), m_gpuTimerName );
+
+    if (params.bDSOnly)
+        m_pCommandList->Begin( params.depthStencil, params.targetStateSrc, params.targetStateDst );
+    else
+        m_pCommandList->Begin( params.renderTarget, params.targetStateSrc, params.targetStateDst );
+
+    auto handleRTV = params.hadleRT;
+    auto handleDSV = params.hadleDS;
+    m_pCommandList->SetTargets( params.bDSOnly ? nullptr : &handleRTV, &handleDSV );
+
+    m_pCommandList->SetViewport( params.viewport );
+    m_statistics.issuedBinds++;
+}
+
+void RenderPass::RecordDrawItems()
+{
+    PROFILE_SCOPE( "RecordDrawItems" );
+
+    m_pCommandList->GetCommandList()->IASetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+
+    CommandListSink sink( m_pCommandList.get(), m_pDescHeap.get() );
+    m_drawRecorder.Record( sink, m_statistics );
+}
+
+RenderPass::CommandListSink::CommandListSink( CommandList* pCommandList, GlobalDescriptorHeap* pDescHeap )
+    : m_pCommandList( pCommandList )
+    , m_pGraphicsList( pCommandList->GetCommandList() )
+    , m_pDescHeap( pDescHeap )
+{
+}
+
+void RenderPass::CommandListSink::SetRootSignature( const RenderContext::DrawPacket& packet )
+{
+    m_pCommandList->SetRootSignature( static_cast<const RenderContext*>(packet.pContext)->GetRootSignature() );
+}
+
+void RenderPass::CommandListSink::SetConstantBuffer( uint32_t parameter, uint64_t address )
+{
+    m_pGraphicsList->SetGraphicsRootConstantBufferView( parameter, address );
+}
+
+void RenderPass::CommandListSink::SetShaderResource( uint32_t parameter, uint64_t address )
+{
+    m_pGraphicsList->SetGraphicsRootShaderResourceView( parameter, address );
+}
+
+void RenderPass::CommandListSink::SetDescriptorHeap()
+{
+    ID3D12DescriptorHeap* pHeaps[] = { m_pDescHeap->GetHeap() };
+    m_pGraphicsList->SetDescriptorHeaps( _countof( pHeaps ), pHeaps );
+}
+
+void RenderPass::CommandListSink::SetDescriptorTable( uint32_t parameter, uint32_t descriptorIndex )
+{
+    m_pGraphicsList->SetGraphicsRootDescriptorTable( parameter, m_pDescHeap->GetGPUHandle( descriptorIndex ) );
+}
+
+void RenderPass::CommandListSink::SetPipelineState( const RenderContext::DrawPacket& packet )
+{
+    m_pCommandList->SetPipelineState( static_cast<const RenderContext*>(packet.pContext)->GetPipelineState() );
+}
+
+void RenderPass::CommandListSink::Draw( const RenderContext::DrawPacket& packet )
+{
+    const Model* pModel = static_cast<const Model*>(packet.pModel);
+    const D3D12_VERTEX_BUFFER_VIEW vertexView = pModel->GetVertexBufferView();
+    const D3D12_INDEX_BUFFER_VIEW  indexView  = pModel->GetIndexBufferView();
+
+    // Geometry lives in the blocks of the geometry heap, so the views are set here rather than by acLib
+    m_pGraphicsList->IASetVertexBuffers( 0, 1, &vertexView );
+    m_pGraphicsList->IASetIndexBuffer( &indexView );
+    m_pGraphicsList->DrawIndexedInstanced( packet.indexCount, 1, 0, 0, 0 );
+}
+
+void RenderPass::EndRecording()
+{
+    if (m_pGpuTimer != nullptr)
+        m_pGpuTimer->EndZone( m_pCommandList->GetCommandList(), m_gpuZone );
+
+    m_pCommandList->End();
+
+    m_statistics.commandLists = 1;
+}
+
+void RenderPass::Render( ID3D12CommandQueue* pCommadnQueue )
+{
+    ID3D12CommandList* cmdList[] = { m_pCommandList->GetCommandList() };
+
+    pCommadnQueue->ExecuteCommandLists( _countof( cmdList ), cmdList );
+}
+
+void RenderPass::Reset()
+{
+    m_pCommandList->Reset( nullptr );
 }
@@ -9,22 +9,25 @@ RenderPassClear::~RenderPassClear()
 
 void RenderPassClear::Construct( ID3D12Device* pDevice )
 {
+    RenderPass::Construct( pDevice );
+
     shared_ptr<RenderContext> pContext = make_shared<RenderContext>( pDevice );
     m_pRenderContexts.push_back( pContext );
 }
 
 void RenderPassClear::Clear( const RenderContext::ConstructParams& params )
 {
-    for (auto pRenderContext : m_pRenderContexts)
+    m_statistics.Clear();
+
+    // Recorded like the other passes, so the clear is timed the same way
+    BeginRecording( params );
+
+    for (const auto& pRenderContext : m_pRenderContexts)
     {
-        pRenderContext->Clear( params );
+        pRenderContext->Clear( m_pCommandList, params );
     }
-}
 
-shared_ptr<DescriptorHeap> RenderPassClear::CreateDescHeap( ID3D12Device* pDevice )
-{
-    AC_USE_VAR( pDevice );
-    return nullptr;
+    EndRecording();
 }
 
 shared_ptr<RootSignature> RenderPassClear::CreateRootSinature( ID3D12Device* pDevice )
@@ -18,17 +18,38 @@ void RenderPassForward::Construct( ID3D12Device * pDevice )
 {
     RenderPass::Construct( pDevice );
 
-    auto findNode = [&]( Node::NODE_TYPE type, shared_ptr<RenderContext>& pContext )
+    if (m_pPipelineCache == nullptr)
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "RenderPassForward::Construct() No pipeline cache." );
+        return;
+    }
+
+    // The root signature has one parameter of each, so the first node of the type is bound
+    auto findNode = [&]( Node::NODE_TYPE type )
     {
         for (auto& pNode : m_pScene->GetRootNode()->GetChildren())
         {
-            if (!pNode->IsNodeType( type ))
-                continue;
-
-            pNode->BindDescriptorHeap( pDevice, pContext->GetDescHeap() );
+            if (pNode->IsNodeType( type ))
+                return pNode;
         }
+        return shared_ptr<Node>();
     };
 
+    const shared_ptr<Node> pCamera        = findNode( Node::NODE_TYPE_CAMERA );
+    const shared_ptr<Node> pLight         = findNode( Node::NODE_TYPE_LIGHT );
+    const shared_ptr<Node> pLightClusters = findNode( Node::NODE_TYPE_LIGHT_CLUSTER );
+
+    // Constants are root CBVs, the table only holds the shadow map SRV and is shared by every draw
+    const UINT descriptorIndex = AllocateDescriptorTable( 1 );
+
+    // Created here rather than in the background, which its simple shader keeps short, so models are drawn
+    // from the first frame while their own pipelines are still being created
+    PipelineState::ShaderCode fallbackShader;
+    if (m_pPipelineCache->GetShader( L"Fallback.hlsl", fallbackShader ))
+        m_pFallbackPipelineState = m_pPipelineCache->GetPipelineState( pDevice, m_element, fallbackShader, CreateRootSinature( pDevice ) );
+    else
+        Log::Output( Log::LOG_LEVEL_ERROR, "Loading Fallback Shader Failed." );
+
     for (auto& pNode : m_pScene->GetRootNode()->GetChildren())
     {
         if (!pNode->IsNodeType( Node::NODE_TYPE_MODEL ))
@@ -36,18 +57,12 @@ void RenderPassForward::Construct( ID3D12Device * pDevice )
 
         shared_ptr<RenderContext> pContext = make_shared<RenderContext>( pDevice );
 
-        pContext->SetDescHeap( CreateDescHeap( pDevice ) );
+        pContext->SetDescriptorTable( m_pDescHeap, descriptorIndex, 1 );
         pContext->SetRootSinature( CreateRootSinature( pDevice ) );
-        pContext->SetPipelineState( CreatePipelineState( pDevice, pContext->GetRootSignature() ) );
-
-        // Camera
-        findNode( Node::NODE_TYPE_CAMERA, pContext );
+        AssignPipelineState( pDevice, pContext, pNode );
 
-        // Light
-        findNode( Node::NODE_TYPE_LIGHT, pContext );
-
-        // Material
-        pNode->BindDescriptorHeap( pDevice, pContext->GetDescHeap() );
+        // Camera, light, the model's material and the clustered point and spot lights
+        pContext->BindForward( pCamera, pLight, pNode, pLightClusters );
 
         pContext->SetNode( pNode );
 
@@ -55,41 +70,45 @@ void RenderPassForward::Construct( ID3D12Device * pDevice )
     }
 }
 
-shared_ptr<DescriptorHeap> RenderPassForward::CreateDescHeap( ID3D12Device* pDevice )
-{
-    D3D12_DESCRIPTOR_HEAP_DESC desc = {};
-    desc.NumDescriptors             = 4;
-    desc.Flags                      = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-    desc.Type                       = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-
-    shared_ptr<DescriptorHeap> pDescHeap = make_shared<DescriptorHeap>();
-    pDescHeap->Create( pDevice, desc );
-
-    return pDescHeap;
-}
-
 shared_ptr<RootSignature> RenderPassForward::CreateRootSinature( ID3D12Device* pDevice )
 {
     // ディスクリプタレンジの設定.
-    D3D12_DESCRIPTOR_RANGE ranges[2];
-    ranges[0].RangeType                         = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-    ranges[0].NumDescriptors                    = 3;
-    ranges[0].BaseShaderRegister                = 0;
-    ranges[0].RegisterSpace                     = 0;
+    D3D12_DESCRIPTOR_RANGE ranges[1];
+    ranges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    ranges[0].NumDescriptors = 1;
+    ranges[0].BaseShaderRegister = 0;
+    ranges[0].RegisterSpace = 0;
     ranges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
-    ranges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-    ranges[1].NumDescriptors = 1;
-    ranges[1].BaseShaderRegister = 0;
-    ranges[1].RegisterSpace = 0;
-    ranges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
     // ルートパラメータの設定.
-    D3D12_ROOT_PARAMETER params[1];
-    params[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-    params[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-    params[0].DescriptorTable.NumDescriptorRanges = _countof( ranges );
-    params[0].DescriptorTable.pDescriptorRanges = &ranges[0];
+    // b0: camera, b1: light, b2: material, b3: light clusters
+    // t1-t3: cluster lights, ranges and indices, t0: shadow map in the table
+    const UINT CBV_COUNT = 4;
+    const UINT SRV_COUNT = ClusteredLights::SHADER_RESOURCE_NUM;
+
+    D3D12_ROOT_PARAMETER params[CBV_COUNT + SRV_COUNT + 1];
+    for (UINT i = 0; i < CBV_COUNT; ++i)
+    {
+        params[i].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+        params[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+        params[i].Descriptor.ShaderRegister = i;
+        params[i].Descriptor.RegisterSpace = 0;
+    }
+
+    for (UINT i = 0; i < SRV_COUNT; ++i)
+    {
+        D3D12_ROOT_PARAMETER& param = params[CBV_COUNT + i];
+        param.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+        param.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+        param.Descriptor.ShaderRegister = 1 + i;
+        param.Descriptor.RegisterSpace = 0;
+    }
+
+    D3D12_ROOT_PARAMETER& table = params[CBV_COUNT + SRV_COUNT];
+    table.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    table.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    table.DescriptorTable.NumDescriptorRanges = _countof( ranges );
+    table.DescriptorTable.pDescriptorRanges = &ranges[0];
 
     // 静的サンプラーの設定.
     D3D12_STATIC_SAMPLER_DESC sampler = {};
@@ -118,31 +137,19 @@ shared_ptr<RootSignature> RenderPassForward::CreateRootSinature( ID3D12Device* p
         D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
         D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS;;
 
-    shared_ptr<RootSignature> pRootSignature = make_shared<RootSignature>();
-    pRootSignature->Create( pDevice, desc );
-
-    return pRootSignature;
+    return m_pPipelineCache->GetRootSignature( pDevice, desc );
 }
 
 shared_ptr<PipelineState> RenderPassForward::CreatePipelineState( ID3D12Device* pDevice, shared_ptr<RootSignature> pRootSignature, shared_ptr<Node> pNode )
 {
     // TODO: Shader determined by node's material
-    ComPtr<ID3DBlob> pVSBlob;
-    ComPtr<ID3DBlob> pPSBlob;
+    AC_USE_VAR( pNode );
 
     PipelineState::ShaderCode   shader;
-    if (!Shader::CompileShader( L"ForwardShading.hlsl", pVSBlob, pPSBlob ))
+    if (!m_pPipelineCache->GetShader( L"ForwardShading.hlsl", shader ))
     {
         Log::Output( Log::LOG_LEVEL_ERROR, "Loading Shader Failed." );
     }
-    else
-    {
-        shader.vs = { reinterpret_cast<UINT8*>(pVSBlob->GetBufferPointer()), pVSBlob->GetBufferSize() };
-        shader.ps = { reinterpret_cast<UINT8*>(pPSBlob->GetBufferPointer()), pPSBlob->GetBufferSize() };
-    }
-
-    shared_ptr<PipelineState> pPipelineState = make_shared<PipelineState>( m_element, shader, pRootSignature );
-    pPipelineState->Create( pDevice );
 
-    return pPipelineState;
+    return m_pPipelineCache->RequestPipelineState( pDevice, m_element, shader, pRootSignature );
 }
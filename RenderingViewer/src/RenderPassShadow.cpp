@@ -1,6 +1,11 @@
-﻿RenderPassShadow::RenderPassShadow( ID3D12Device* pDevice )
+﻿#include <chrono>
+
+RenderPassShadow::RenderPassShadow( ID3D12Device* pDevice )
     : RenderPass( pDevice )
+    , m_bRecorded( false )
 {
+    m_drawRecorder.SetSortPass( SORT_PASS_SHADOW );
+
     // 入力レイアウトの設定
     m_element.elements = {
         { "POSITION",  0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
@@ -18,6 +23,14 @@ void RenderPassShadow::Construct( ID3D12Device * pDevice )
 {
     RenderPass::Construct( pDevice );
 
+    Invalidate();
+
+    if (m_pPipelineCache == nullptr)
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "RenderPassShadow::Construct() No pipeline cache." );
+        return;
+    }
+
     auto findNode = [&]( Node::NODE_TYPE type, shared_ptr<RenderContext>& pContext )
     {
         for (auto& pNode : m_pScene->GetRootNode()->GetChildren())
@@ -25,7 +38,10 @@ void RenderPassShadow::Construct( ID3D12Device * pDevice )
             if (!pNode->IsNodeType( type ))
                 continue;
 
-            pNode->BindDescriptorHeap( pDevice, pContext->GetDescHeap() );
+            pContext->AddConstantBuffer( pNode );
+
+            if (type == Node::NODE_TYPE_LIGHT)
+                m_pLight = static_pointer_cast<Light>( pNode );
         }
     };
 
@@ -36,9 +52,9 @@ void RenderPassShadow::Construct( ID3D12Device * pDevice )
 
         shared_ptr<RenderContext> pContext = make_shared<RenderContext>( pDevice );
 
-        pContext->SetDescHeap( CreateDescHeap( pDevice ) );
         pContext->SetRootSinature( CreateRootSinature( pDevice ) );
-        pContext->SetPipelineState( CreatePipelineState( pDevice, pContext->GetRootSignature() ) );
+        // Casters are skipped until their pipeline exists; the tiles re-render once they appear
+        AssignPipelineState( pDevice, pContext, pNode );
 
         // Light
         findNode( Node::NODE_TYPE_LIGHT, pContext );
@@ -49,35 +65,164 @@ void RenderPassShadow::Construct( ID3D12Device * pDevice )
     }
 }
 
-shared_ptr<DescriptorHeap> RenderPassShadow::CreateDescHeap( ID3D12Device* pDevice )
+void RenderPassShadow::Invalidate()
 {
-    D3D12_DESCRIPTOR_HEAP_DESC desc = {};
-    desc.NumDescriptors = 1;
-    desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-    desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    for (auto& cache : m_cascadeCache)
+    {
+        cache.bValid = false;
+    }
+}
+
+void RenderPassShadow::Draw( const RenderContext::ConstructParams& params )
+{
+    const auto start = chrono::steady_clock::now();
+
+    m_statistics.Clear();
+    m_cascadeStatistics.Clear();
+    m_cacheStatistics.frames++;
+    m_bRecorded = false;
+
+    GatherDrawPackets();
+    const RenderContext::DrawPacket* pCasterPackets = m_pDrawPackets;
+    const UINT                       casterCount    = m_drawPacketCount;
+
+    const UINT cascadeCount  = m_pLight != nullptr ? m_pLight->GetBufferData().cascadeCount : 0;
+    const UINT shadowMapSize = static_cast<UINT>(params.viewport.Width);
 
-    shared_ptr<DescriptorHeap> pDescHeap = make_shared<DescriptorHeap>();
-    pDescHeap->Create( pDevice, desc );
+    // Draw lists of the cascades, in the frame arena like the casters
+    RenderContext::DrawPacket* pCascadePackets[Light::ResLightData::CASCADE_NUM] = {};
+    UINT                       cascadePacketCounts[Light::ResLightData::CASCADE_NUM] = {};
+
+    // A tile is kept while its box and the casters inside it, with their versions, stay the same
+    bool bDirty[Light::ResLightData::CASCADE_NUM] = {};
+    bool bAnyDirty = false;
+    for (UINT cascade = 0; cascade < cascadeCount; ++cascade)
+    {
+        const Light::ResLightData&   lightData = m_pLight->GetBufferData();
+        const ShadowFrustum::Result& frustum   = m_pLight->GetShadowFrustum( cascade );
+
+        // Casters outside the cascade's box leave no texel in its tile
+        RenderContext::DrawPacket* pPackets = AllocateFrameData<RenderContext::DrawPacket>( casterCount );
+        UINT                       count    = 0;
+        m_casters.clear();
+        for (UINT i = 0; i < casterCount && pPackets != nullptr; ++i)
+        {
+            const RenderContext::DrawPacket& packet = pCasterPackets[i];
+            const Node*               pNode = static_cast<const Model*>(packet.pModel);
+            const Model::BoundingBox& box   = static_cast<const Model*>(pNode)->GetBoundingBox();
+
+            ShadowFrustum::Bounds bounds;
+            bounds.Add( &box.lo.x );
+            bounds.Add( &box.hi.x );
+            if (!ShadowFrustum::Intersects( frustum, bounds ))
+            {
+                m_cascadeStatistics.culled[cascade]++;
+                continue;
+            }
+
+            // b1 holds the light constants with this cascade's view and projection
+            pPackets[count] = packet;
+            pPackets[count].constantBuffers[0] = m_pLight->GetCascadeConstantBufferAddress( cascade );
+            count++;
+
+            m_casters.push_back( make_pair( pNode, pNode->GetVersion() ) );
+        }
+
+        pCascadePackets[cascade]     = pPackets;
+        cascadePacketCounts[cascade] = count;
+
+        m_cascadeStatistics.casters[cascade] = static_cast<int>(count);
+
+        CascadeCache& cache = m_cascadeCache[cascade];
+        bDirty[cascade] = !cache.bValid
+                       || memcmp( &cache.viewProjection, &lightData.cascadeViewProjection[cascade], sizeof( cache.viewProjection ) ) != 0
+                       || memcmp( &cache.rect, &lightData.cascadeRects[cascade], sizeof( cache.rect ) ) != 0
+                       || cache.casters != m_casters;
+
+        if (bDirty[cascade])
+        {
+            cache.bValid         = true;
+            cache.viewProjection = lightData.cascadeViewProjection[cascade];
+            cache.rect           = lightData.cascadeRects[cascade];
+            cache.casters.swap( m_casters );
+
+            bAnyDirty = true;
+        }
+    }
 
-    return pDescHeap;
+    // Unused tiles were overwritten or belong to another layout once the count comes back
+    for (UINT cascade = cascadeCount; cascade < Light::ResLightData::CASCADE_NUM; ++cascade)
+    {
+        m_cascadeCache[cascade].bValid = false;
+    }
+
+    m_cascadeStatistics.cascadeCount = static_cast<int>(cascadeCount);
+
+    if (!bAnyDirty)
+    {
+        // Reset left the list open; it is closed empty and the map keeps last frame's depth
+        m_pCommandList->GetCommandList()->Close();
+
+        m_cascadeStatistics.recordMilliseconds = chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+        return;
+    }
+
+    BeginRecording( params );
+
+    ID3D12GraphicsCommandList* pGraphicsList = m_pCommandList->GetCommandList();
+
+    for (UINT cascade = 0; cascade < cascadeCount; ++cascade)
+    {
+        if (!bDirty[cascade])
+            continue;
+
+        const ShadowFrustum::Result& frustum = m_pLight->GetShadowFrustum( cascade );
+
+        UINT x, y, size;
+        ShadowFrustum::GetCascadeTile( cascade, cascadeCount, shadowMapSize, x, y, size );
+
+        // Only the re-rendered tile is cleared, the others keep their cached depth
+        const D3D12_RECT rect = { static_cast<LONG>(x), static_cast<LONG>(y), static_cast<LONG>(x + size), static_cast<LONG>(y + size) };
+        pGraphicsList->ClearDepthStencilView( params.hadleDS, D3D12_CLEAR_FLAG_DEPTH, params.clearVal, 0, 1, &rect );
+
+        m_pDrawPackets    = pCascadePackets[cascade];
+        m_drawPacketCount = cascadePacketCounts[cascade];
+
+        const Vec3f origin( frustum.origin[0], frustum.origin[1], frustum.origin[2] );
+        SetSortView( origin, m_pLight->GetBufferData().direction[0], frustum.depthRange );
+        SortDrawPackets();
+
+        D3D12_VIEWPORT viewport = params.viewport;
+        viewport.TopLeftX = static_cast<float>(x);
+        viewport.TopLeftY = static_cast<float>(y);
+        viewport.Width    = static_cast<float>(size);
+        viewport.Height   = static_cast<float>(size);
+        m_pCommandList->SetViewport( viewport );
+        m_statistics.issuedBinds++;
+
+        RecordDrawItems();
+
+        m_cascadeStatistics.rendered[cascade] = true;
+        m_cacheStatistics.cascadeRenders++;
+    }
+
+    EndRecording();
+
+    m_bRecorded = true;
+    m_cacheStatistics.passes++;
+
+    m_cascadeStatistics.recordMilliseconds = chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
 }
 
 shared_ptr<RootSignature> RenderPassShadow::CreateRootSinature( ID3D12Device* pDevice )
 {
-    // ディスクリプタレンジの設定.
-    D3D12_DESCRIPTOR_RANGE ranges[1];
-    ranges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-    ranges[0].NumDescriptors = 1;
-    ranges[0].BaseShaderRegister = 1;
-    ranges[0].RegisterSpace = 0;
-    ranges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
     // ルートパラメータの設定.
+    // b1: light
     D3D12_ROOT_PARAMETER params[1];
-    params[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    params[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
     params[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
-    params[0].DescriptorTable.NumDescriptorRanges = _countof( ranges );
-    params[0].DescriptorTable.pDescriptorRanges = &ranges[0];
+    params[0].Descriptor.ShaderRegister = 1;
+    params[0].Descriptor.RegisterSpace = 0;
 
     // ルートシグニチャの設定.
     D3D12_ROOT_SIGNATURE_DESC desc;
@@ -91,31 +236,19 @@ shared_ptr<RootSignature> RenderPassShadow::CreateRootSinature( ID3D12Device* pD
         D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
         D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS;
 
-    shared_ptr<RootSignature> pRootSignature = make_shared<RootSignature>();
-    pRootSignature->Create( pDevice, desc );
-
-    return pRootSignature;
+    return m_pPipelineCache->GetRootSignature( pDevice, desc );
 }
 
 shared_ptr<PipelineState> RenderPassShadow::CreatePipelineState( ID3D12Device* pDevice, shared_ptr<RootSignature> pRootSignature, shared_ptr<Node> pNode )
 {
     // TODO: Shader determined by node's material
-    ComPtr<ID3DBlob> pVSBlob;
-    ComPtr<ID3DBlob> pPSBlob;
+    AC_USE_VAR( pNode );
 
     PipelineState::ShaderCode   shader;
-    if (!Shader::CompileShader( L"Shadow.hlsl", pVSBlob, pPSBlob ))
+    if (!m_pPipelineCache->GetShader( L"Shadow.hlsl", shader ))
     {
         Log::Output( Log::LOG_LEVEL_ERROR, "Loading Shader Failed." );
     }
-    else
-    {
-        shader.vs = { reinterpret_cast<UINT8*>(pVSBlob->GetBufferPointer()), pVSBlob->GetBufferSize() };
-        shader.ps = { reinterpret_cast<UINT8*>(pPSBlob->GetBufferPointer()), pPSBlob->GetBufferSize() };
-    }
-
-    shared_ptr<PipelineState> pPipelineState = make_shared<PipelineState>( m_element, shader, pRootSignature );
-    pPipelineState->Create( pDevice );
 
-    return pPipelineState;
+    return m_pPipelineCache->RequestPipelineState( pDevice, m_element, shader, pRootSignature );
 }
@@ -12,6 +12,7 @@ HINSTANCE hInst;                                // 現在のインターフェ
 HWND g_hWnd;                                      // メインウィンドウのハンドル
 WCHAR szTitle[MAX_LOADSTRING];                  // タイトル バーのテキスト
 WCHAR szWindowClass[MAX_LOADSTRING];            // メイン ウィンドウ クラス名
+App* g_pApp = nullptr;                          // Invalidated by window events
 
 // このコード モジュールに含まれる関数の宣言を転送します:
 ATOM                MyRegisterClass(HINSTANCE hInstance);
@@ -27,6 +28,32 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
     UNREFERENCED_PARAMETER(hPrevInstance);
     UNREFERENCED_PARAMETER(lpCmdLine);
 
+    // Headless batch rendering: no window and no DirectInput
+    vector<string> args;
+    for (int i = 1; i < __argc; ++i)
+    {
+        char arg[MAX_PATH * 2];
+        WideCharToMultiByte( CP_ACP, 0, __wargv[i], -1, arg, sizeof( arg ), nullptr, nullptr );
+        args.push_back( arg );
+    }
+
+    BatchRenderer::Options batchOptions;
+    if (BatchRenderer::ParseArguments( args, batchOptions ))
+    {
+        if (AttachConsole( ATTACH_PARENT_PROCESS ) || AllocConsole())
+        {
+            FILE* fp = NULL;
+            freopen_s( &fp, "CONOUT$", "w", stdout );
+            freopen_s( &fp, "CONOUT$", "w", stderr );
+        }
+
+        BatchRenderer batchRenderer;
+        const bool bSucceeded = batchRenderer.Run( batchOptions );
+        batchRenderer.PrintStatistics();
+
+        return bSucceeded ? 0 : 1;
+    }
+
     // グローバル文字列を初期化しています。
     LoadStringW(hInstance, IDS_APP_TITLE, szTitle, MAX_LOADSTRING);
     LoadStringW(hInstance, IDC_RENDERINGVIEWER, szWindowClass, MAX_LOADSTRING);
@@ -41,24 +68,40 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
     }
 
     App app( g_hWnd, hInst );
+    g_pApp = &app;
 
     HACCEL hAccelTable = LoadAccelerators(hInstance, MAKEINTRESOURCE(IDC_RENDERINGVIEWER));
 
-    MSG msg;
+    MSG msg = {};
+    bool bQuit = false;
 
     // メイン メッセージ ループ:
-    while (GetMessage(&msg, nullptr, 0, 0))
+    // Sleeps until a message arrives or the app's scheduler wants the next iteration, so an unchanged view costs nothing
+    while (!bQuit)
     {
-        if (!TranslateAccelerator(msg.hwnd, hAccelTable, &msg))
+        MsgWaitForMultipleObjects( 0, nullptr, FALSE, app.GetWaitMilliseconds(), QS_ALLINPUT );
+
+        while (PeekMessage( &msg, nullptr, 0, 0, PM_REMOVE ))
         {
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
+            if (msg.message == WM_QUIT)
+            {
+                bQuit = true;
+                break;
+            }
+
+            if (!TranslateAccelerator(msg.hwnd, hAccelTable, &msg))
+            {
+                TranslateMessage(&msg);
+                DispatchMessage(&msg);
+            }
         }
 
-        if (!app.Run())
+        if (bQuit || !app.Run())
             break;
     }
 
+    g_pApp = nullptr;
+
 #ifdef _DEBUG
     ::FreeConsole();
 #endif
@@ -160,10 +203,20 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         break;
     case WM_PAINT:
         {
+            // Validates the region, otherwise WM_PAINT repeats forever
             PAINTSTRUCT ps;
+            BeginPaint(hWnd, &ps);
             EndPaint(hWnd, &ps);
+
+            if (g_pApp != nullptr)
+                g_pApp->Invalidate( FrameScheduler::INVALIDATE_WINDOW );
         }
         break;
+    case WM_SIZE:
+    case WM_ACTIVATE:
+        if (g_pApp != nullptr)
+            g_pApp->Invalidate( FrameScheduler::INVALIDATE_WINDOW );
+        return DefWindowProc(hWnd, message, wParam, lParam);
     case WM_DESTROY:
         PostQuitMessage(0);
         break;
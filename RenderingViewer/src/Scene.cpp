@@ -7,3 +7,97 @@ Scene::Scene( ID3D12Device *pDevice )
 Scene::~Scene()
 {
 }
+
+ShadowFrustum::Bounds Scene::GetBounds() const
+{
+    ShadowFrustum::Bounds bounds;
+    for (auto& pNode : m_pRootNode->GetChildren())
+    {
+        if (!pNode->IsNodeType( Node::NODE_TYPE_MODEL ))
+            continue;
+
+        const Model::BoundingBox& box = static_pointer_cast<Model>(pNode)->GetBoundingBox();
+        bounds.Add( &box.lo.x );
+        bounds.Add( &box.hi.x );
+    }
+
+    return bounds;
+}
+
+bool Scene::AddGenerated( ID3D12Device* pDevice, shared_ptr<GeometryHeap> pGeometryHeap, const GeneratedScene& scene )
+{
+    PROFILE_SCOPE( "Scene::AddGenerated" );
+
+    vector<uint32_t> meshNodes;
+    for (size_t i = 0; i < scene.nodes.size(); ++i)
+    {
+        if (scene.nodes[i].mesh != GeneratedScene::NO_MESH)
+            meshNodes.push_back( static_cast<uint32_t>(i) );
+    }
+
+    // Vertices are moved to world space in parallel, the models are then made in node order
+    vector<vector<Vertex> > worldVertices( meshNodes.size() );
+    auto transformVertices = [&]( uint32_t i )
+    {
+        const GeneratedScene::Node& node = scene.nodes[meshNodes[i]];
+        const GeneratedScene::Mesh& mesh = scene.meshes[node.mesh];
+        const float* m = node.world;
+
+        // Rotation and uniform scale only, so normals take the same matrix and are normalized again
+        vector<Vertex>& vertices = worldVertices[i];
+        vertices.resize( mesh.positions.size() / 3 );
+        for (size_t v = 0; v < vertices.size(); ++v)
+        {
+            const float* p = &mesh.positions[v * 3];
+            const float* n = &mesh.normals[v * 3];
+
+            vertices[v].position = Vec3f( m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12],
+                                          m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13],
+                                          m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14] );
+            vertices[v].normal   = Vec3f::normalize( Vec3f( m[0] * n[0] + m[4] * n[1] + m[8] * n[2],
+                                                            m[1] * n[0] + m[5] * n[1] + m[9] * n[2],
+                                                            m[2] * n[0] + m[6] * n[1] + m[10] * n[2] ) );
+        }
+    };
+    JobSystem::GetInstance().ParallelFor( static_cast<uint32_t>(meshNodes.size()), transformVertices );
+
+    for (size_t i = 0; i < meshNodes.size(); ++i)
+    {
+        const GeneratedScene::Mesh& mesh = scene.meshes[scene.nodes[meshNodes[i]].mesh];
+
+        char name[32];
+        sprintf_s( name, "generated/%u", meshNodes[i] );
+
+        auto pModel = make_shared<Model>( pDevice );
+        if (!pModel->BindMesh( pGeometryHeap, name, std::move( worldVertices[i] ), vector<unsigned short>( mesh.indices.begin(), mesh.indices.end() ) ))
+            return false;
+
+        m_pRootNode->AddChild( pModel );
+    }
+
+    if (scene.lights.Size() > 0)
+    {
+        const LightList& lights = scene.lights;
+
+        auto pLights = make_shared<ClusteredLights>( pDevice );
+        for (size_t i = 0; i < lights.Size(); ++i)
+        {
+            const Vec3f position( lights.positionX[i], lights.positionY[i], lights.positionZ[i] );
+            const Vec3f color( lights.colorR[i], lights.colorG[i], lights.colorB[i] );
+
+            if (lights.spotCosOuter[i] <= -1.0f)
+            {
+                pLights->AddPointLight( position, lights.range[i], color );
+            }
+            else
+            {
+                const Vec3f direction( lights.directionX[i], lights.directionY[i], lights.directionZ[i] );
+                pLights->AddSpotLight( position, direction, lights.range[i], acos( lights.spotCosInner[i] ), acos( lights.spotCosOuter[i] ), color );
+            }
+        }
+
+        m_pRootNode->AddChild( pLights );
+    }
+
+    return true;
+}
@@ -0,0 +1,736 @@
+#include "SceneGenerator.h"
+#include "BatchMath.h"
+#include "Hash.h"
+#include "JobSystem.h"
+#include "ObjMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    const float PI = 3.14159265f;
+
+    // mt19937 is specified to the bit; the conversions below are too, unlike the library's distributions
+    class Random
+    {
+    public:
+        explicit Random( uint32_t seed ) : m_engine( seed ) {}
+
+        // [0, 1)
+        float Unit() { return static_cast<float>(m_engine() >> 8) * (1.0f / 16777216.0f); }
+
+        float Range( float lo, float hi ) { return lo + (hi - lo) * Unit(); }
+
+        // [0, count)
+        uint32_t Index( uint32_t count ) { return static_cast<uint32_t>((static_cast<uint64_t>(m_engine()) * count) >> 32); }
+
+    private:
+        std::mt19937 m_engine;
+    };
+
+    // Translation, rotation around y, then uniform scale
+    void SetLocalMatrix( float x, float y, float z, float angle, float scale, float m[16] )
+    {
+        const float c = std::cos( angle );
+        const float s = std::sin( angle );
+
+        std::fill( m, m + 16, 0.0f );
+        m[0]  =  scale * c;
+        m[2]  = -scale * s;
+        m[5]  =  scale;
+        m[8]  =  scale * s;
+        m[10] =  scale * c;
+        m[12] =  x;
+        m[13] =  y;
+        m[14] =  z;
+        m[15] =  1.0f;
+    }
+
+    void UpdateBounds( GeneratedScene::Mesh& mesh )
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            mesh.boundsMin[axis] =  3.402823466e+38f;
+            mesh.boundsMax[axis] = -3.402823466e+38f;
+        }
+
+        for (size_t i = 0; i < mesh.positions.size(); i += 3)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                mesh.boundsMin[axis] = std::min( mesh.boundsMin[axis], mesh.positions[i + axis] );
+                mesh.boundsMax[axis] = std::max( mesh.boundsMax[axis], mesh.positions[i + axis] );
+            }
+        }
+    }
+
+    // Ground position of the index-th of count points, x and z in [-extent / 2, extent / 2]
+    void Place( SceneGenerator::DISTRIBUTION distribution, uint32_t index, uint32_t count, float extent,
+                const std::vector<float>& clusterCenters, Random& random, float& x, float& z )
+    {
+        const float half = 0.5f * extent;
+
+        switch (distribution)
+        {
+        case SceneGenerator::DISTRIBUTION_CLUSTERED:
+        {
+            // Sum of two uniforms: dense in the middle of a cluster, thinning out towards its edge
+            const uint32_t cluster = random.Index( static_cast<uint32_t>(clusterCenters.size() / 2) );
+            const float    radius  = extent / std::sqrt( static_cast<float>(clusterCenters.size() / 2) ) * 0.5f;
+            x = clusterCenters[cluster * 2]     + radius * (random.Unit() + random.Unit() - 1.0f);
+            z = clusterCenters[cluster * 2 + 1] + radius * (random.Unit() + random.Unit() - 1.0f);
+            break;
+        }
+        case SceneGenerator::DISTRIBUTION_GRID:
+        {
+            const uint32_t cells = static_cast<uint32_t>(std::ceil( std::sqrt( static_cast<double>(count) ) ));
+            const float    cell  = extent / cells;
+            x = -half + (index % cells + 0.5f) * cell;
+            z = -half + (index / cells + 0.5f) * cell;
+            break;
+        }
+        default:
+            x = random.Range( -half, half );
+            z = random.Range( -half, half );
+            break;
+        }
+
+        x = std::max( -half, std::min( half, x ) );
+        z = std::max( -half, std::min( half, z ) );
+    }
+
+    // Fewest children per node that fit count nodes into depth levels
+    uint32_t GetFanout( uint32_t count, uint32_t depth )
+    {
+        if (depth <= 1)
+            return count;
+
+        uint32_t fanout = std::max( 1u, static_cast<uint32_t>(std::pow( static_cast<double>(count), 1.0 / depth )) );
+        for (;;)
+        {
+            uint64_t capacity = 0;
+            uint64_t level    = 1;
+            for (uint32_t i = 0; i < depth && capacity < count; ++i)
+            {
+                level    *= fanout;
+                capacity += level;
+            }
+
+            if (capacity >= count)
+                return fanout;
+
+            fanout++;
+        }
+    }
+
+    // Paths in the manifest are relative to its directory
+    std::string GetDirectory( const std::string& path )
+    {
+        const size_t slash = path.find_last_of( "/\\" );
+        return slash == std::string::npos ? std::string() : path.substr( 0, slash + 1 );
+    }
+
+    std::string GetFileName( const std::string& path )
+    {
+        const size_t slash = path.find_last_of( "/\\" );
+        return slash == std::string::npos ? path : path.substr( slash + 1 );
+    }
+
+    // Reads count floats separated by spaces; false when the line runs out
+    bool ParseFloats( const char*& pCursor, float* pValues, int count )
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            char* pEnd = nullptr;
+            pValues[i] = std::strtof( pCursor, &pEnd );
+            if (pEnd == pCursor)
+                return false;
+            pCursor = pEnd;
+        }
+        return true;
+    }
+
+    bool ParseInteger( const char*& pCursor, long& value )
+    {
+        char* pEnd = nullptr;
+        value = std::strtol( pCursor, &pEnd, 10 );
+        if (pEnd == pCursor)
+            return false;
+        pCursor = pEnd;
+        return true;
+    }
+}
+
+void GeneratedScene::Clear()
+{
+    meshes.clear();
+    nodes.clear();
+    lights.Clear();
+}
+
+uint64_t GeneratedScene::GetVertexCount() const
+{
+    uint64_t count = 0;
+    for (const Mesh& mesh : meshes)
+    {
+        count += mesh.positions.size() / 3;
+    }
+    return count;
+}
+
+uint64_t GeneratedScene::GetTriangleCount() const
+{
+    uint64_t count = 0;
+    for (const Mesh& mesh : meshes)
+    {
+        count += mesh.indices.size() / 3;
+    }
+    return count;
+}
+
+uint64_t GeneratedScene::GetDrawnTriangleCount() const
+{
+    uint64_t count = 0;
+    for (const Node& node : nodes)
+    {
+        if (node.mesh != NO_MESH)
+            count += meshes[node.mesh].indices.size() / 3;
+    }
+    return count;
+}
+
+uint32_t GeneratedScene::GetDepth() const
+{
+    std::vector<uint32_t> levels( nodes.size() );
+
+    uint32_t depth = 0;
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        levels[i] = nodes[i].parent == NO_PARENT ? 1 : levels[nodes[i].parent] + 1;
+        depth = std::max( depth, levels[i] );
+    }
+    return depth;
+}
+
+void GeneratedScene::UpdateWorld()
+{
+    // Nodes ordered by level with a counting sort; the nodes of a level are updated in parallel once the
+    // level above is done
+    std::vector<uint32_t> levels( nodes.size() );
+    uint32_t depth = 0;
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        levels[i] = nodes[i].parent == NO_PARENT ? 0 : levels[nodes[i].parent] + 1;
+        depth = std::max( depth, levels[i] + 1 );
+    }
+
+    std::vector<uint32_t> starts( depth + 1, 0 );
+    for (uint32_t level : levels)
+    {
+        starts[level + 1]++;
+    }
+    for (uint32_t level = 0; level < depth; ++level)
+    {
+        starts[level + 1] += starts[level];
+    }
+
+    std::vector<uint32_t> order( nodes.size() );
+    std::vector<uint32_t> next( starts.begin(), starts.end() - 1 );
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        order[next[levels[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    // About a microsecond of multiplies per job
+    const uint32_t GRAIN = 64;
+
+    for (uint32_t level = 0; level < depth; ++level)
+    {
+        const uint32_t* pLevel = &order[starts[level]];
+        auto update = [&]( uint32_t i )
+        {
+            Node& node = nodes[pLevel[i]];
+            if (node.parent == NO_PARENT)
+                std::copy( node.local, node.local + 16, node.world );
+            else
+                BatchMath::Multiply( nodes[node.parent].world, node.local, node.world );
+        };
+        JobSystem::GetInstance().ParallelFor( starts[level + 1] - starts[level], update, GRAIN );
+    }
+}
+
+uint64_t GeneratedScene::GetHash() const
+{
+    uint64_t hash = Hash::FNV_OFFSET_BASIS;
+    for (const Mesh& mesh : meshes)
+    {
+        hash = Hash::Value( mesh.positions.size(), hash );
+        hash = Hash::Fnv1a( mesh.positions.data(), mesh.positions.size() * sizeof( float ), hash );
+        hash = Hash::Fnv1a( mesh.normals.data(), mesh.normals.size() * sizeof( float ), hash );
+        hash = Hash::Value( mesh.indices.size(), hash );
+        hash = Hash::Fnv1a( mesh.indices.data(), mesh.indices.size() * sizeof( uint16_t ), hash );
+    }
+
+    for (const Node& node : nodes)
+    {
+        hash = Hash::Value( node.parent, hash );
+        hash = Hash::Value( node.mesh, hash );
+        hash = Hash::Fnv1a( node.local, sizeof( node.local ), hash );
+    }
+
+    for (const std::vector<float>* pArray : { &lights.positionX, &lights.positionY, &lights.positionZ, &lights.range,
+                                              &lights.colorR, &lights.colorG, &lights.colorB,
+                                              &lights.directionX, &lights.directionY, &lights.directionZ,
+                                              &lights.spotCosInner, &lights.spotCosOuter })
+    {
+        hash = Hash::Value( pArray->size(), hash );
+        hash = Hash::Fnv1a( pArray->data(), pArray->size() * sizeof( float ), hash );
+    }
+
+    return hash;
+}
+
+const char* SceneGenerator::GetDistributionName( DISTRIBUTION distribution )
+{
+    switch (distribution)
+    {
+    case DISTRIBUTION_UNIFORM:   return "uniform";
+    case DISTRIBUTION_CLUSTERED: return "clustered";
+    case DISTRIBUTION_GRID:      return "grid";
+    default:                     return "unknown";
+    }
+}
+
+bool SceneGenerator::Generate( const Config& config, GeneratedScene& scene )
+{
+    scene.Clear();
+
+    if (config.objectCount == 0 || !(config.extent > 0.0f))
+        return false;
+
+    Random random( config.seed );
+
+    // Meshes first, so the object count does not shift them
+    const float    instanceRatio = std::max( 0.0f, std::min( 1.0f, config.instanceRatio ) );
+    const uint32_t meshCount     = std::max( 1u, config.objectCount - static_cast<uint32_t>(config.objectCount * static_cast<double>(instanceRatio)) );
+    const uint32_t minSegments   = std::max( 1u, std::min( config.minSegments, MAX_SEGMENTS ) );
+    const uint32_t maxSegments   = std::max( minSegments, std::min( config.maxSegments, MAX_SEGMENTS ) );
+
+    scene.meshes.resize( meshCount );
+    for (uint32_t i = 0; i < meshCount; ++i)
+    {
+        const uint32_t segments = minSegments + random.Index( maxSegments - minSegments + 1 );
+        if (i % 2 == 0)
+            CreateSphere( std::max( 3u, segments ), scene.meshes[i] );
+        else
+            CreateBox( segments, scene.meshes[i] );
+    }
+
+    // Roots fill the ground; each level below gathers its children closer around the parent
+    const uint32_t depth     = std::max( 1u, config.hierarchyDepth );
+    const uint32_t fanout    = GetFanout( config.objectCount, depth );
+    const uint32_t rootCount = std::min( config.objectCount, fanout );
+    const float    radius    = 0.35f * config.extent / std::sqrt( static_cast<float>(config.objectCount) );
+
+    std::vector<float> clusterCenters;
+    const uint32_t clusterCount = std::max( 1u, std::min( 64u, rootCount / 16 ) );
+    for (uint32_t i = 0; i < clusterCount; ++i)
+    {
+        clusterCenters.push_back( 0.8f * config.extent * (random.Unit() - 0.5f) );
+        clusterCenters.push_back( 0.8f * config.extent * (random.Unit() - 0.5f) );
+    }
+
+    std::vector<float> spreads( config.objectCount );
+
+    scene.nodes.resize( config.objectCount );
+    for (uint32_t i = 0; i < config.objectCount; ++i)
+    {
+        GeneratedScene::Node& node = scene.nodes[i];
+        node.mesh = i < meshCount ? i : random.Index( meshCount );
+
+        const float angle = random.Range( 0.0f, 2.0f * PI );
+        if (i < rootCount)
+        {
+            float x = 0.0f, z = 0.0f;
+            Place( config.distribution, i, rootCount, config.extent, clusterCenters, random, x, z );
+
+            const float scale = radius * random.Range( 0.75f, 1.25f );
+            node.parent = GeneratedScene::NO_PARENT;
+            SetLocalMatrix( x, scale, z, angle, scale, node.local );
+
+            spreads[i] = 0.5f * config.extent / std::sqrt( static_cast<float>(rootCount) ) / scale;
+        }
+        else
+        {
+            // Offsets are in the parent's units; children keep the parent's size
+            node.parent = (i - rootCount) / fanout;
+
+            const float spread   = spreads[node.parent];
+            const float distance = spread * std::sqrt( random.Unit() );
+            const float bearing  = random.Range( 0.0f, 2.0f * PI );
+            SetLocalMatrix( distance * std::cos( bearing ), 0.0f, distance * std::sin( bearing ), angle, 1.0f, node.local );
+
+            spreads[i] = spread / std::sqrt( static_cast<float>(fanout) );
+        }
+    }
+
+    scene.UpdateWorld();
+
+    // Lights over the same ground, a little above the objects
+    const float lightRange = 2.0f * config.extent / std::sqrt( static_cast<float>(std::max( 1u, config.lightCount )) );
+    scene.lights.Reserve( config.lightCount );
+    for (uint32_t i = 0; i < config.lightCount; ++i)
+    {
+        float x = 0.0f, z = 0.0f;
+        Place( config.distribution, i, config.lightCount, config.extent, clusterCenters, random, x, z );
+
+        const float position[3] = { x, radius * random.Range( 2.0f, 6.0f ), z };
+        const float color[3]    = { random.Range( 0.2f, 1.0f ), random.Range( 0.2f, 1.0f ), random.Range( 0.2f, 1.0f ) };
+        const float range       = lightRange * random.Range( 0.5f, 1.5f );
+
+        if (random.Unit() < config.spotLightRatio)
+        {
+            const float direction[3] = { random.Range( -0.5f, 0.5f ), -1.0f, random.Range( -0.5f, 0.5f ) };
+            const float innerAngle   = random.Range( 0.2f, 0.5f );
+            scene.lights.AddSpotLight( position, direction, range, innerAngle, innerAngle + 0.2f, color );
+        }
+        else
+        {
+            scene.lights.AddPointLight( position, range, color );
+        }
+    }
+
+    return true;
+}
+
+void SceneGenerator::CreateSphere( uint32_t segments, GeneratedScene::Mesh& mesh )
+{
+    mesh.positions.clear();
+    mesh.normals.clear();
+    mesh.indices.clear();
+
+    // Same layout and winding as the software rasterizer's test spheres: clockwise seen from outside
+    for (uint32_t i = 0; i <= segments; ++i)
+    {
+        for (uint32_t j = 0; j <= segments; ++j)
+        {
+            const float theta = PI * i / segments;
+            const float phi   = 2.0f * PI * j / segments;
+            const float n[3]  = { std::sin( theta ) * std::cos( phi ), std::cos( theta ), std::sin( theta ) * std::sin( phi ) };
+            mesh.positions.insert( mesh.positions.end(), n, n + 3 );
+            mesh.normals.insert( mesh.normals.end(), n, n + 3 );
+        }
+    }
+
+    for (uint32_t i = 0; i < segments; ++i)
+    {
+        for (uint32_t j = 0; j < segments; ++j)
+        {
+            const uint16_t a = static_cast<uint16_t>(i * (segments + 1) + j);
+            const uint16_t b = static_cast<uint16_t>(a + segments + 1);
+            const uint16_t triangles[6] = { a, static_cast<uint16_t>(a + 1), b, static_cast<uint16_t>(a + 1), static_cast<uint16_t>(b + 1), b };
+            mesh.indices.insert( mesh.indices.end(), triangles, triangles + 6 );
+        }
+    }
+
+    UpdateBounds( mesh );
+}
+
+void SceneGenerator::CreateBox( uint32_t segments, GeneratedScene::Mesh& mesh )
+{
+    mesh.positions.clear();
+    mesh.normals.clear();
+    mesh.indices.clear();
+
+    // Each side is a grid of segments x segments quads, spanned by two axes u and v with normal u x v, wound as the sphere
+    for (int side = 0; side < 6; ++side)
+    {
+        const int   axis = side / 2;
+        const float sign = side % 2 == 0 ? 1.0f : -1.0f;
+
+        float normal[3] = {}, u[3] = {}, v[3] = {};
+        normal[axis]         = sign;
+        u[(axis + 1) % 3]    = sign;
+        v[(axis + 2) % 3]    = 1.0f;
+
+        const uint16_t base = static_cast<uint16_t>(mesh.positions.size() / 3);
+        for (uint32_t i = 0; i <= segments; ++i)
+        {
+            for (uint32_t j = 0; j <= segments; ++j)
+            {
+                const float s = 2.0f * j / segments - 1.0f;
+                const float t = 2.0f * i / segments - 1.0f;
+                const float p[3] = { normal[0] + s * u[0] + t * v[0], normal[1] + s * u[1] + t * v[1], normal[2] + s * u[2] + t * v[2] };
+                mesh.positions.insert( mesh.positions.end(), p, p + 3 );
+                mesh.normals.insert( mesh.normals.end(), normal, normal + 3 );
+            }
+        }
+
+        for (uint32_t i = 0; i < segments; ++i)
+        {
+            for (uint32_t j = 0; j < segments; ++j)
+            {
+                const uint16_t a = static_cast<uint16_t>(base + i * (segments + 1) + j);
+                const uint16_t b = static_cast<uint16_t>(a + segments + 1);
+                const uint16_t triangles[6] = { a, static_cast<uint16_t>(a + 1), b, static_cast<uint16_t>(a + 1), static_cast<uint16_t>(b + 1), b };
+                mesh.indices.insert( mesh.indices.end(), triangles, triangles + 6 );
+            }
+        }
+    }
+
+    UpdateBounds( mesh );
+}
+
+std::string SceneGenerator::GetMeshPath( const std::string& manifestPath, size_t mesh )
+{
+    const size_t dot   = manifestPath.find_last_of( '.' );
+    const size_t slash = manifestPath.find_last_of( "/\\" );
+    const std::string stem = dot != std::string::npos && (slash == std::string::npos || dot > slash) ? manifestPath.substr( 0, dot ) : manifestPath;
+
+    std::ostringstream path;
+    path << stem << "_" << mesh << ".obj";
+    return path.str();
+}
+
+bool SceneGenerator::Write( const GeneratedScene& scene, const std::string& manifestPath )
+{
+    m_error.clear();
+
+    FILE* pFile = fopen( manifestPath.c_str(), "w" );
+    if (pFile == nullptr)
+    {
+        m_error = "Failed to open " + manifestPath;
+        return false;
+    }
+
+    // %.9g round-trips every float exactly
+    fprintf( pFile, "# Generated scene: meshes, nodes (parent, mesh, local matrix), lights\n" );
+    fprintf( pFile, "counts %zu %zu %zu\n", scene.meshes.size(), scene.nodes.size(), scene.lights.Size() );
+
+    bool bSucceeded = true;
+    for (size_t i = 0; i < scene.meshes.size() && bSucceeded; ++i)
+    {
+        const std::string meshPath = GetMeshPath( manifestPath, i );
+        fprintf( pFile, "m %s\n", GetFileName( meshPath ).c_str() );
+        bSucceeded = WriteMesh( scene.meshes[i], meshPath );
+    }
+
+    for (const GeneratedScene::Node& node : scene.nodes)
+    {
+        fprintf( pFile, "n %ld %ld",
+                 node.parent == GeneratedScene::NO_PARENT ? -1L : static_cast<long>(node.parent),
+                 node.mesh == GeneratedScene::NO_MESH ? -1L : static_cast<long>(node.mesh) );
+        for (float value : node.local)
+        {
+            fprintf( pFile, " %.9g", value );
+        }
+        fprintf( pFile, "\n" );
+    }
+
+    const LightList& lights = scene.lights;
+    for (size_t i = 0; i < lights.Size(); ++i)
+    {
+        fprintf( pFile, "l %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n",
+                 lights.positionX[i], lights.positionY[i], lights.positionZ[i], lights.range[i],
+                 lights.colorR[i], lights.colorG[i], lights.colorB[i],
+                 lights.directionX[i], lights.directionY[i], lights.directionZ[i], lights.spotCosInner[i], lights.spotCosOuter[i] );
+    }
+
+    bSucceeded &= ferror( pFile ) == 0;
+    bSucceeded &= fclose( pFile ) == 0;
+    if (!bSucceeded && m_error.empty())
+        m_error = "Failed to write " + manifestPath;
+
+    return bSucceeded;
+}
+
+bool SceneGenerator::WriteMesh( const GeneratedScene::Mesh& mesh, const std::string& path )
+{
+    FILE* pFile = fopen( path.c_str(), "w" );
+    if (pFile == nullptr)
+    {
+        m_error = "Failed to open " + path;
+        return false;
+    }
+
+    for (size_t i = 0; i < mesh.positions.size(); i += 3)
+    {
+        fprintf( pFile, "v %.9g %.9g %.9g\n", mesh.positions[i], mesh.positions[i + 1], mesh.positions[i + 2] );
+    }
+    for (size_t i = 0; i < mesh.normals.size(); i += 3)
+    {
+        fprintf( pFile, "vn %.9g %.9g %.9g\n", mesh.normals[i], mesh.normals[i + 1], mesh.normals[i + 2] );
+    }
+
+    // Normals are per position, so both share the index
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        const unsigned a = mesh.indices[i] + 1u, b = mesh.indices[i + 1] + 1u, c = mesh.indices[i + 2] + 1u;
+        fprintf( pFile, "f %u//%u %u//%u %u//%u\n", a, a, b, b, c, c );
+    }
+
+    const bool bSucceeded = ferror( pFile ) == 0 && fclose( pFile ) == 0;
+    if (!bSucceeded)
+        m_error = "Failed to write " + path;
+
+    return bSucceeded;
+}
+
+bool SceneGenerator::Read( const std::string& manifestPath, GeneratedScene& scene )
+{
+    m_error.clear();
+    scene.Clear();
+
+    std::ifstream file( manifestPath.c_str() );
+    if (!file)
+    {
+        m_error = "Failed to open " + manifestPath;
+        return false;
+    }
+
+    const std::string directory = GetDirectory( manifestPath );
+
+    // Meshes are read once the manifest is, in parallel
+    std::vector<std::string> meshPaths;
+
+    std::string line;
+    size_t      lineNumber = 0;
+    while (std::getline( file, line ))
+    {
+        lineNumber++;
+
+        const char* pCursor = line.c_str();
+        bool bParsed = true;
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        else if (line.compare( 0, 7, "counts " ) == 0)
+        {
+            pCursor += 7;
+            long counts[3] = {};
+            bParsed = ParseInteger( pCursor, counts[0] ) && ParseInteger( pCursor, counts[1] ) && ParseInteger( pCursor, counts[2] ) &&
+                      counts[0] >= 0 && counts[1] >= 0 && counts[2] >= 0;
+            if (bParsed)
+            {
+                scene.meshes.reserve( counts[0] );
+                scene.nodes.reserve( counts[1] );
+                scene.lights.Reserve( counts[2] );
+            }
+        }
+        else if (line.compare( 0, 2, "m " ) == 0)
+        {
+            scene.meshes.push_back( GeneratedScene::Mesh() );
+            meshPaths.push_back( directory + line.substr( 2 ) );
+        }
+        else if (line.compare( 0, 2, "n " ) == 0)
+        {
+            pCursor += 2;
+            long parent = 0, mesh = 0;
+            GeneratedScene::Node node;
+            bParsed = ParseInteger( pCursor, parent ) && ParseInteger( pCursor, mesh ) && ParseFloats( pCursor, node.local, 16 );
+
+            // Parents come first, and meshes before any node
+            bParsed = bParsed && parent < static_cast<long>(scene.nodes.size()) && mesh < static_cast<long>(scene.meshes.size());
+            if (bParsed)
+            {
+                node.parent = parent < 0 ? GeneratedScene::NO_PARENT : static_cast<uint32_t>(parent);
+                node.mesh   = mesh < 0 ? GeneratedScene::NO_MESH : static_cast<uint32_t>(mesh);
+                scene.nodes.push_back( node );
+            }
+        }
+        else if (line.compare( 0, 2, "l " ) == 0)
+        {
+            pCursor += 2;
+            float values[12];
+            bParsed = ParseFloats( pCursor, values, 12 );
+            if (bParsed)
+            {
+                // Straight into the arrays: AddSpotLight takes angles and would round the cosines
+                LightList& lights = scene.lights;
+                std::vector<float>* pArrays[12] = { &lights.positionX, &lights.positionY, &lights.positionZ, &lights.range,
+                                                    &lights.colorR, &lights.colorG, &lights.colorB,
+                                                    &lights.directionX, &lights.directionY, &lights.directionZ,
+                                                    &lights.spotCosInner, &lights.spotCosOuter };
+                for (int i = 0; i < 12; ++i)
+                {
+                    pArrays[i]->push_back( values[i] );
+                }
+            }
+        }
+        else
+        {
+            bParsed = false;
+        }
+
+        if (!bParsed)
+        {
+            std::ostringstream message;
+            message << manifestPath << "(" << lineNumber << "): unexpected line";
+            m_error = message.str();
+            scene.Clear();
+            return false;
+        }
+    }
+
+    std::vector<std::string> errors( meshPaths.size() );
+    auto readMesh = [&]( uint32_t i )
+    {
+        ReadMesh( meshPaths[i], scene.meshes[i], errors[i] );
+    };
+    JobSystem::GetInstance().ParallelFor( static_cast<uint32_t>(meshPaths.size()), readMesh, 1 );
+
+    // The first failure in manifest order, as when they were read one by one
+    for (const std::string& error : errors)
+    {
+        if (!error.empty())
+        {
+            m_error = error;
+            scene.Clear();
+            return false;
+        }
+    }
+
+    scene.UpdateWorld();
+
+    return true;
+}
+
+bool SceneGenerator::ReadMesh( const std::string& path, GeneratedScene::Mesh& mesh, std::string& error )
+{
+    // Through the loader Model binds meshes with; faces are written as p//n with p == n, so the normals it
+    // keeps per position are the ones written
+    ObjMesh obj;
+    if (!obj.Load( path ))
+    {
+        error = "Failed to open " + path;
+        return false;
+    }
+
+    if (obj.GetVertexCount() > 0x10000)
+    {
+        error = path + ": more positions than 16-bit indices reach";
+        return false;
+    }
+
+    if (obj.GetIndexCount() == 0)
+    {
+        error = path + ": no faces";
+        return false;
+    }
+
+    mesh.positions = obj.GetPositions();
+    mesh.normals   = obj.GetNormals();
+    mesh.indices.resize( obj.GetIndexCount() );
+    obj.CreateIndices( mesh.indices.data() );
+
+    UpdateBounds( mesh );
+
+    return true;
+}
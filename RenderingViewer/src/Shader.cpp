@@ -1,40 +1,42 @@
-﻿bool Shader::CompileShader( const std::wstring& file, ComPtr<ID3DBlob>& pVSBlob, ComPtr<ID3DBlob>& pPSBlob )
+﻿bool Shader::Compile( const ShaderCache::CompileRequest& request, vector<unsigned char>& bytecode )
 {
-    // 頂点シェーダのファイルパスを検索.
-    std::wstring path;
-    if (!SearchFilePath( file.c_str(), path ))
+    wchar_t path[520] = { 0 };
+    if (MultiByteToWideChar( CP_ACP, 0, request.path.c_str(), -1, path, _countof( path ) ) == 0)
     {
         Log::Output( Log::LOG_LEVEL_ERROR, "File Not Found." );
         return false;
     }
 
-#if defined(_DEBUG)
-    // Enable better shader debugging with the graphics debugging tools.
-    UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#else
-    UINT compileFlags = 0;
-#endif
-
     HRESULT hr = S_OK;
 
-    ComPtr<ID3DBlob> pBlob;
-    hr = D3DCompileFromFile( path.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "VSMain", "vs_5_0", compileFlags, 0, pVSBlob.ReleaseAndGetAddressOf(), pBlob.ReleaseAndGetAddressOf() );
+    ComPtr<ID3DBlob> pShaderBlob;
+    ComPtr<ID3DBlob> pErrorBlob;
+    hr = D3DCompileFromFile( path, nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, request.entryPoint.c_str(), request.profile.c_str(), request.flags, 0, pShaderBlob.ReleaseAndGetAddressOf(), pErrorBlob.ReleaseAndGetAddressOf() );
     if (FAILED( hr ))
     {
         Log::Output( Log::LOG_LEVEL_ERROR, "D3DCompileFromFile() Failed." );
-        return false;
-    }
+        if (pErrorBlob != nullptr)
+            Log::Output( Log::LOG_LEVEL_ERROR, reinterpret_cast<const char*>(pErrorBlob->GetBufferPointer()) );
 
-    hr = D3DCompileFromFile( path.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "PSMain", "ps_5_0", compileFlags, 0, pPSBlob.ReleaseAndGetAddressOf(), nullptr );
-    if (FAILED( hr ))
-    {
-        Log::Output( Log::LOG_LEVEL_ERROR, "D3DCompileFromFile Failed." );
         return false;
     }
 
+    const unsigned char* pData = reinterpret_cast<const unsigned char*>(pShaderBlob->GetBufferPointer());
+    bytecode.assign( pData, pData + pShaderBlob->GetBufferSize() );
+
     return true;
 }
 
+unsigned int Shader::GetCompileFlags()
+{
+#if defined(_DEBUG)
+    // Enable better shader debugging with the graphics debugging tools.
+    return D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+    return 0;
+#endif
+}
+
 bool Shader::SearchFilePath( const std::wstring& filePath, std::wstring& result )
 {
     if (filePath.length() == 0 || filePath == L" ")
@@ -0,0 +1,407 @@
+#include "ShaderCache.h"
+#include "Hash.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const uint32_t CACHE_FILE_MAGIC   = 0x43535652; // "RVSC"
+    const uint32_t CACHE_FILE_VERSION = 1;
+
+    struct CacheFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint64_t size;
+        uint64_t reserved;
+    };
+
+    bool ReadFile( const std::string& path, std::string& contents )
+    {
+        std::ifstream ifs( path.c_str(), std::ios::in | std::ios::binary );
+        if (!ifs)
+            return false;
+
+        contents.assign( std::istreambuf_iterator<char>( ifs ), std::istreambuf_iterator<char>() );
+        return true;
+    }
+
+    std::string GetDirectoryName( const std::string& path )
+    {
+        size_t pos = path.find_last_of( "/\\" );
+        return pos == std::string::npos ? std::string() : path.substr( 0, pos + 1 );
+    }
+
+    bool ParseInclude( const std::string& line, std::string& name )
+    {
+        size_t pos = line.find_first_not_of( " \t" );
+        if (pos == std::string::npos || line[pos] != '#')
+            return false;
+
+        pos = line.find_first_not_of( " \t", pos + 1 );
+        if (pos == std::string::npos || line.compare( pos, 7, "include" ) != 0)
+            return false;
+
+        size_t begin = line.find( '"', pos + 7 );
+        if (begin == std::string::npos)
+            return false;
+
+        size_t end = line.find( '"', begin + 1 );
+        if (end == std::string::npos)
+            return false;
+
+        name = line.substr( begin + 1, end - begin - 1 );
+        return true;
+    }
+
+    void CollectIncludes( const std::string& path, std::set<std::string>& visited, std::vector<std::string>& closure )
+    {
+        if (!visited.insert( path ).second)
+            return;
+
+        closure.push_back( path );
+
+        std::string source;
+        if (!ReadFile( path, source ))
+            return;
+
+        // Quoted includes are resolved relative to the including file like D3D_COMPILE_STANDARD_FILE_INCLUDE
+        const std::string directory = GetDirectoryName( path );
+
+        std::istringstream iss( source );
+        std::string line;
+        std::string name;
+        while (std::getline( iss, line ))
+        {
+            if (ParseInclude( line, name ))
+                CollectIncludes( directory + name, visited, closure );
+        }
+    }
+
+    bool MakeDirectory( const std::string& directory )
+    {
+#if defined(_WIN32)
+        return CreateDirectoryA( directory.c_str(), nullptr ) != 0 || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+        return mkdir( directory.c_str(), 0755 ) == 0 || errno == EEXIST;
+#endif
+    }
+
+    double ElapsedMilliseconds( const std::chrono::steady_clock::time_point& start )
+    {
+        return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+    }
+}
+
+ShaderCache::Blob::Blob()
+    : m_pData( nullptr )
+    , m_size( 0 )
+    , m_pMapped( nullptr )
+    , m_mappedSize( 0 )
+#if defined(_WIN32)
+    , m_hFile( INVALID_HANDLE_VALUE )
+    , m_hMapping( nullptr )
+#endif
+{
+}
+
+ShaderCache::Blob::~Blob()
+{
+    Unmap();
+}
+
+bool ShaderCache::Blob::Map( const std::string& path, uint64_t key )
+{
+    Unmap();
+
+#if defined(_WIN32)
+    m_hFile = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if (m_hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx( m_hFile, &fileSize ) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof( CacheFileHeader )))
+    {
+        Unmap();
+        return false;
+    }
+
+    m_hMapping = CreateFileMappingA( m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if (m_hMapping == nullptr)
+    {
+        Unmap();
+        return false;
+    }
+
+    m_pMapped    = MapViewOfFile( m_hMapping, FILE_MAP_READ, 0, 0, 0 );
+    m_mappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = open( path.c_str(), O_RDONLY );
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat( fd, &st ) != 0 || st.st_size < static_cast<off_t>(sizeof( CacheFileHeader )))
+    {
+        close( fd );
+        return false;
+    }
+
+    void* pMapped = mmap( nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+
+    m_pMapped    = pMapped != MAP_FAILED ? pMapped : nullptr;
+    m_mappedSize = static_cast<size_t>(st.st_size);
+#endif
+
+    if (m_pMapped == nullptr)
+    {
+        Unmap();
+        return false;
+    }
+
+    const CacheFileHeader* pHeader = static_cast<const CacheFileHeader*>(m_pMapped);
+    if (pHeader->magic != CACHE_FILE_MAGIC ||
+        pHeader->version != CACHE_FILE_VERSION ||
+        pHeader->key != key ||
+        pHeader->size != m_mappedSize - sizeof( CacheFileHeader ))
+    {
+        Unmap();
+        return false;
+    }
+
+    m_pData = static_cast<const unsigned char*>(m_pMapped) + sizeof( CacheFileHeader );
+    m_size  = static_cast<size_t>(pHeader->size);
+
+    return true;
+}
+
+void ShaderCache::Blob::Assign( std::vector<unsigned char>&& bytecode )
+{
+    Unmap();
+
+    m_bytecode = std::move( bytecode );
+    m_pData    = m_bytecode.empty() ? nullptr : &m_bytecode[0];
+    m_size     = m_bytecode.size();
+}
+
+void ShaderCache::Blob::Unmap()
+{
+#if defined(_WIN32)
+    if (m_pMapped != nullptr)
+        UnmapViewOfFile( m_pMapped );
+
+    if (m_hMapping != nullptr)
+        CloseHandle( m_hMapping );
+
+    if (m_hFile != INVALID_HANDLE_VALUE)
+        CloseHandle( m_hFile );
+
+    m_hMapping = nullptr;
+    m_hFile    = INVALID_HANDLE_VALUE;
+#else
+    if (m_pMapped != nullptr)
+        munmap( m_pMapped, m_mappedSize );
+#endif
+
+    m_pMapped    = nullptr;
+    m_mappedSize = 0;
+    m_pData      = nullptr;
+    m_size       = 0;
+}
+
+ShaderCache::ShaderCache( const std::string& directory, CompileFunc compiler, int workerCount )
+    : m_directory( directory )
+    , m_compiler( compiler )
+    , m_workerCount( workerCount )
+{
+    if (m_workerCount <= 0)
+        m_workerCount = static_cast<int>(JobSystem::GetInstance().GetThreadCount());
+
+    MakeDirectory( m_directory );
+}
+
+ShaderCache::~ShaderCache()
+{
+}
+
+bool ShaderCache::Fetch( const std::vector<CompileRequest>& requests, std::vector<std::shared_ptr<Blob> >& blobs )
+{
+    PROFILE_SCOPE( "ShaderCache::Fetch" );
+
+    const auto start = std::chrono::steady_clock::now();
+
+    blobs.assign( requests.size(), nullptr );
+
+    std::vector<uint64_t> keys( requests.size() );
+    std::vector<size_t>   misses;
+
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        keys[i] = ComputeKey( requests[i] );
+
+        std::shared_ptr<Blob> pBlob = std::make_shared<Blob>();
+        if (pBlob->Map( GetCachePath( keys[i] ), keys[i] ))
+        {
+            blobs[i] = pBlob;
+            m_statistics.hits++;
+        }
+        else
+        {
+            misses.push_back( i );
+            m_statistics.misses++;
+        }
+    }
+
+    if (misses.empty())
+    {
+        m_statistics.warmMilliseconds = ElapsedMilliseconds( start );
+        return true;
+    }
+
+    // Compile misses in jobs of the job system, each pulling from a shared index, as compiles differ in length
+    std::atomic<size_t> next( 0 );
+    auto worker = [&]( uint32_t )
+    {
+        for (size_t n = next++; n < misses.size(); n = next++)
+        {
+            const size_t i = misses[n];
+
+            PROFILE_SCOPE( "ShaderCache::Compile" );
+
+            std::vector<unsigned char> bytecode;
+            if (!m_compiler( requests[i], bytecode ))
+                continue;
+
+            Store( keys[i], bytecode );
+
+            std::shared_ptr<Blob> pBlob = std::make_shared<Blob>();
+            pBlob->Assign( std::move( bytecode ) );
+            blobs[i] = pBlob;
+        }
+    };
+
+    const int jobCount = std::min( m_workerCount, static_cast<int>(misses.size()) );
+    JobSystem::GetInstance().ParallelFor( static_cast<uint32_t>(jobCount), worker, 1 );
+
+    bool bSucceeded = true;
+    for (size_t i : misses)
+    {
+        if (blobs[i] == nullptr)
+        {
+            m_statistics.failures++;
+            bSucceeded = false;
+        }
+    }
+
+    m_statistics.coldMilliseconds = ElapsedMilliseconds( start );
+
+    return bSucceeded;
+}
+
+std::shared_ptr<ShaderCache::Blob> ShaderCache::Fetch( const CompileRequest& request )
+{
+    std::vector<std::shared_ptr<Blob> > blobs;
+    Fetch( std::vector<CompileRequest>( 1, request ), blobs );
+
+    return blobs[0];
+}
+
+uint64_t ShaderCache::ComputeKey( const CompileRequest& request )
+{
+    std::vector<std::string> closure;
+    ResolveIncludes( request.path, closure );
+
+    uint64_t key = Hash::FNV_OFFSET_BASIS;
+
+    std::string source;
+    for (const auto& path : closure)
+    {
+        // Missing files still contribute their name so the key changes once they appear
+        key = Hash::Fnv1a( path.c_str(), path.size(), key );
+
+        if (ReadFile( path, source ))
+            key = Hash::Fnv1a( source.data(), source.size(), key );
+    }
+
+    key = Hash::Fnv1a( request.entryPoint.c_str(), request.entryPoint.size() + 1, key );
+    key = Hash::Fnv1a( request.profile.c_str(), request.profile.size() + 1, key );
+    key = Hash::Value( request.flags, key );
+    key = Hash::Value( CACHE_FILE_VERSION, key );
+
+    return key;
+}
+
+void ShaderCache::ResolveIncludes( const std::string& path, std::vector<std::string>& closure )
+{
+    std::set<std::string> visited;
+
+    closure.clear();
+    CollectIncludes( path, visited, closure );
+}
+
+std::string ShaderCache::GetCachePath( uint64_t key ) const
+{
+    char name[32];
+    snprintf( name, sizeof( name ), "%016llx.cso", static_cast<unsigned long long>(key) );
+
+    return m_directory + "/" + name;
+}
+
+bool ShaderCache::Store( uint64_t key, const std::vector<unsigned char>& bytecode ) const
+{
+    const std::string path = GetCachePath( key );
+
+    // Write to a private temporary and rename so readers never map a partial file
+    std::ostringstream oss;
+    oss << path << "." << std::this_thread::get_id() << ".tmp";
+    const std::string tmpPath = oss.str();
+
+    FILE* fp = fopen( tmpPath.c_str(), "wb" );
+    if (fp == nullptr)
+        return false;
+
+    CacheFileHeader header = {};
+    header.magic   = CACHE_FILE_MAGIC;
+    header.version = CACHE_FILE_VERSION;
+    header.key     = key;
+    header.size    = bytecode.size();
+
+    bool bSucceeded = fwrite( &header, sizeof( header ), 1, fp ) == 1;
+    if (bSucceeded && !bytecode.empty())
+        bSucceeded = fwrite( &bytecode[0], bytecode.size(), 1, fp ) == 1;
+
+    bSucceeded = (fclose( fp ) == 0) && bSucceeded;
+
+    if (bSucceeded)
+    {
+        std::remove( path.c_str() );
+        bSucceeded = std::rename( tmpPath.c_str(), path.c_str() ) == 0;
+    }
+
+    if (!bSucceeded)
+        std::remove( tmpPath.c_str() );
+
+    return bSucceeded;
+}
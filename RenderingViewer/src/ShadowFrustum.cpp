@@ -0,0 +1,613 @@
+#include "ShadowFrustum.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    struct Point
+    {
+        float v[3];
+    };
+
+    // A quad clipped by the six faces of a box gains at most one vertex per face
+    const size_t MAX_POLYGON_POINTS = 4 + 6;
+
+    // Six clipped frustum faces and the eight box corners
+    const size_t MAX_POINTS = 6 * MAX_POLYGON_POINTS + 8;
+
+    // Points of a fit on the stack, so fitting every cascade of every frame stays off the heap
+    template <size_t N>
+    struct PointList
+    {
+        PointList() : count( 0 ) {}
+
+        void clear() { count = 0; }
+        bool empty() const { return count == 0; }
+        size_t size() const { return count; }
+
+        void push_back( const Point& point )
+        {
+            if (count < N)
+                points[count++] = point;
+        }
+
+        const Point& operator[]( size_t i ) const { return points[i]; }
+        const Point* begin() const { return points; }
+        const Point* end() const { return points + count; }
+
+        Point  points[N];
+        size_t count;
+    };
+
+    typedef PointList<MAX_POLYGON_POINTS> Polygon;
+
+    float Dot( const float a[3], const float b[3] )
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    void Cross( const float a[3], const float b[3], float out[3] )
+    {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    bool Normalize( float v[3] )
+    {
+        const float length = std::sqrt( Dot( v, v ) );
+        if (!(length > 0.0f))
+            return false;
+
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+        return true;
+    }
+
+    // Element (row, column) of the shader layout
+    float& At( float m[16], int row, int column )
+    {
+        return m[column * 4 + row];
+    }
+
+    void GetCorners( const ShadowFrustum::Bounds& bounds, Point corners[8] )
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            corners[i].v[0] = (i & 1) ? bounds.max[0] : bounds.min[0];
+            corners[i].v[1] = (i & 2) ? bounds.max[1] : bounds.min[1];
+            corners[i].v[2] = (i & 4) ? bounds.max[2] : bounds.min[2];
+        }
+    }
+
+    // Sutherland-Hodgman against the six faces of the box
+    void ClipToBounds( Polygon& polygon, const ShadowFrustum::Bounds& bounds )
+    {
+        Polygon clipped;
+        for (int plane = 0; plane < 6 && !polygon.empty(); ++plane)
+        {
+            const int  axis  = plane / 2;
+            const bool bMin  = (plane & 1) == 0;
+            auto distance = [&]( const Point& p ) { return bMin ? p.v[axis] - bounds.min[axis] : bounds.max[axis] - p.v[axis]; };
+
+            clipped.clear();
+            for (size_t i = 0; i < polygon.size(); ++i)
+            {
+                const Point& a  = polygon[i];
+                const Point& b  = polygon[(i + 1) % polygon.size()];
+                const float  da = distance( a );
+                const float  db = distance( b );
+
+                if (da >= 0.0f)
+                    clipped.push_back( a );
+
+                if ((da >= 0.0f) != (db >= 0.0f))
+                {
+                    const float t = da / (da - db);
+                    Point p;
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        p.v[k] = a.v[k] + (b.v[k] - a.v[k]) * t;
+                    }
+                    p.v[axis] = bMin ? bounds.min[axis] : bounds.max[axis];
+                    clipped.push_back( p );
+                }
+            }
+
+            std::swap( polygon, clipped );
+        }
+    }
+
+    float ViewDepth( const float view[16], const Point& point )
+    {
+        return view[2] * point.v[0] + view[6] * point.v[1] + view[10] * point.v[2] + view[14];
+    }
+
+    // World-space corners of the camera frustum, near face (0-3) then far face (4-7)
+    void GetFrustumCorners( const float inverse[16], Point corners[8] )
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            const float ndc[4] = { (i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : 0.0f, 1.0f };
+            float world[4];
+            ShadowFrustum::Transform( inverse, ndc, world );
+            for (int k = 0; k < 3; ++k)
+            {
+                corners[i].v[k] = world[k] / world[3];
+            }
+        }
+    }
+
+    // Moves the near and far faces to the given view depths along the frustum edges
+    void SliceFrustum( const float view[16], float splitNear, float splitFar, Point corners[8] )
+    {
+        Point sliced[8];
+        for (int i = 0; i < 4; ++i)
+        {
+            const Point& a  = corners[i];
+            const Point& b  = corners[i + 4];
+            const float  da = ViewDepth( view, a );
+            const float  db = ViewDepth( view, b );
+            const float  range = db - da;
+
+            const float tNear = range != 0.0f ? (splitNear - da) / range : 0.0f;
+            const float tFar  = range != 0.0f ? (splitFar - da) / range : 1.0f;
+            for (int k = 0; k < 3; ++k)
+            {
+                sliced[i].v[k]     = a.v[k] + (b.v[k] - a.v[k]) * tNear;
+                sliced[i + 4].v[k] = a.v[k] + (b.v[k] - a.v[k]) * tFar;
+            }
+        }
+
+        std::copy( sliced, sliced + 8, corners );
+    }
+
+    // Vertices of the intersection of the camera frustum with the bounds: frustum faces clipped
+    // to the box, plus box corners inside the frustum
+    void IntersectFrustum( const ShadowFrustum::Input& input, const float viewProjection[16], const float inverse[16], PointList<MAX_POINTS>& points )
+    {
+        const ShadowFrustum::Bounds& bounds = input.receivers;
+        const bool bSliced = input.splitFar > input.splitNear;
+
+        Point corners[8];
+        GetFrustumCorners( inverse, corners );
+        if (bSliced)
+            SliceFrustum( input.pCameraView, input.splitNear, input.splitFar, corners );
+
+        static const int FACES[6][4] =
+        {
+            { 0, 1, 3, 2 }, { 4, 5, 7, 6 }, // near, far
+            { 0, 2, 6, 4 }, { 1, 3, 7, 5 }, // left, right
+            { 0, 1, 5, 4 }, { 2, 3, 7, 6 }, // bottom, top
+        };
+
+        Polygon polygon;
+        for (int face = 0; face < 6; ++face)
+        {
+            polygon.clear();
+            for (int i = 0; i < 4; ++i)
+            {
+                polygon.push_back( corners[FACES[face][i]] );
+            }
+
+            ClipToBounds( polygon, bounds );
+            for (const Point& point : polygon)
+            {
+                points.push_back( point );
+            }
+        }
+
+        Point boxCorners[8];
+        GetCorners( bounds, boxCorners );
+        for (const Point& corner : boxCorners)
+        {
+            const float position[4] = { corner.v[0], corner.v[1], corner.v[2], 1.0f };
+            float clip[4];
+            ShadowFrustum::Transform( viewProjection, position, clip );
+
+            const float w = clip[3];
+            if (!(w > 0.0f && std::fabs( clip[0] ) <= w && std::fabs( clip[1] ) <= w && clip[2] >= 0.0f && clip[2] <= w))
+                continue;
+
+            const float depth = ViewDepth( input.pCameraView, corner );
+            if (bSliced && (depth < input.splitNear || depth > input.splitFar))
+                continue;
+
+            points.push_back( corner );
+        }
+    }
+}
+
+ShadowFrustum::Bounds::Bounds()
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        min[i] = FLT_MAX;
+        max[i] = -FLT_MAX;
+    }
+}
+
+void ShadowFrustum::Bounds::Add( const float point[3] )
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        min[i] = std::min( min[i], point[i] );
+        max[i] = std::max( max[i], point[i] );
+    }
+}
+
+void ShadowFrustum::Bounds::Add( const Bounds& bounds )
+{
+    if (!bounds.IsValid())
+        return;
+
+    Add( bounds.min );
+    Add( bounds.max );
+}
+
+ShadowFrustum::Input::Input()
+    : pCameraView( nullptr )
+    , pCameraProjection( nullptr )
+    , splitNear( 0.0f )
+    , splitFar( 0.0f )
+    , resolution( 2048 )
+    , sizeStep( 0.0f )
+    , bSnapToTexels( true )
+{
+    direction[0] = 0.0f;
+    direction[1] = -1.0f;
+    direction[2] = 0.0f;
+}
+
+ShadowFrustum::Result::Result()
+    : depthRange( 0.0f )
+    , extent( 0.0f )
+    , texelsPerUnit( 0.0f )
+    , bFitted( false )
+{
+    std::fill( view, view + 16, 0.0f );
+    std::fill( projection, projection + 16, 0.0f );
+    std::fill( origin, origin + 3, 0.0f );
+}
+
+bool ShadowFrustum::Fit( const Input& input, Result& result )
+{
+    if (!input.receivers.IsValid() || input.resolution < 4)
+        return false;
+
+    // Light view basis, the same construction as a left-handed look-at
+    float zAxis[3] = { input.direction[0], input.direction[1], input.direction[2] };
+    if (!Normalize( zAxis ))
+        return false;
+
+    float up[3] = { 0.0f, 1.0f, 0.0f };
+    if (std::fabs( zAxis[1] ) > 0.99f)
+    {
+        up[1] = 0.0f;
+        up[2] = 1.0f;
+    }
+
+    float xAxis[3];
+    float yAxis[3];
+    Cross( up, zAxis, xAxis );
+    Normalize( xAxis );
+    Cross( zAxis, xAxis, yAxis );
+
+    PointList<MAX_POINTS> points;
+    result.bFitted = false;
+
+    if (input.pCameraView != nullptr && input.pCameraProjection != nullptr)
+    {
+        float viewProjection[16];
+        float inverse[16];
+        Multiply( input.pCameraProjection, input.pCameraView, viewProjection );
+        if (Invert( viewProjection, inverse ))
+            IntersectFrustum( input, viewProjection, inverse, points );
+
+        result.bFitted = !points.empty();
+    }
+
+    if (points.empty())
+    {
+        Point corners[8];
+        GetCorners( input.receivers, corners );
+        for (const Point& corner : corners)
+        {
+            points.push_back( corner );
+        }
+    }
+
+    float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (const Point& point : points)
+    {
+        const float light[3] = { Dot( xAxis, point.v ), Dot( yAxis, point.v ), Dot( zAxis, point.v ) };
+        for (int k = 0; k < 3; ++k)
+        {
+            lo[k] = std::min( lo[k], light[k] );
+            hi[k] = std::max( hi[k], light[k] );
+        }
+    }
+
+    // Anything between the light and the receivers can cast into the map
+    if (input.casters.IsValid())
+    {
+        Point corners[8];
+        GetCorners( input.casters, corners );
+        for (const Point& corner : corners)
+        {
+            lo[2] = std::min( lo[2], Dot( zAxis, corner.v ) );
+        }
+    }
+
+    // Keeps depths off the clip planes
+    const float depthMargin = std::max( (hi[2] - lo[2]) * 0.01f, 1e-3f );
+    const float nearZ = lo[2] - depthMargin;
+    const float farZ  = hi[2] + depthMargin;
+
+    // Square box with room for the texel snap on both sides
+    const float resolution = static_cast<float>(input.resolution);
+    float extent = std::max( std::max( hi[0] - lo[0], hi[1] - lo[1] ), 1e-3f ) * resolution / (resolution - 2.0f);
+    if (input.sizeStep > 0.0f)
+        extent = std::ceil( extent / input.sizeStep ) * input.sizeStep;
+
+    const float texelSize = extent / resolution;
+
+    float left   = 0.5f * (lo[0] + hi[0] - extent);
+    float bottom = 0.5f * (lo[1] + hi[1] - extent);
+    if (input.bSnapToTexels)
+    {
+        left   = std::floor( lo[0] / texelSize ) * texelSize;
+        bottom = std::floor( lo[1] / texelSize ) * texelSize;
+    }
+
+    const float right = left + extent;
+    const float top   = bottom + extent;
+
+    std::fill( result.view, result.view + 16, 0.0f );
+    for (int column = 0; column < 3; ++column)
+    {
+        At( result.view, 0, column ) = xAxis[column];
+        At( result.view, 1, column ) = yAxis[column];
+        At( result.view, 2, column ) = zAxis[column];
+    }
+    At( result.view, 3, 3 ) = 1.0f;
+
+    std::fill( result.projection, result.projection + 16, 0.0f );
+    At( result.projection, 0, 0 ) = 2.0f / (right - left);
+    At( result.projection, 0, 3 ) = -(right + left) / (right - left);
+    At( result.projection, 1, 1 ) = 2.0f / (top - bottom);
+    At( result.projection, 1, 3 ) = -(top + bottom) / (top - bottom);
+    At( result.projection, 2, 2 ) = 1.0f / (farZ - nearZ);
+    At( result.projection, 2, 3 ) = -nearZ / (farZ - nearZ);
+    At( result.projection, 3, 3 ) = 1.0f;
+
+    const float centerX = 0.5f * (left + right);
+    const float centerY = 0.5f * (bottom + top);
+    for (int k = 0; k < 3; ++k)
+    {
+        result.origin[k] = xAxis[k] * centerX + yAxis[k] * centerY + zAxis[k] * nearZ;
+    }
+
+    result.depthRange    = farZ - nearZ;
+    result.extent        = extent;
+    result.texelsPerUnit = resolution / extent;
+
+    return true;
+}
+
+uint32_t ShadowFrustum::GetResolutionForDensity( float extent, float texelsPerUnit )
+{
+    const float resolution = std::ceil( extent * texelsPerUnit );
+    return resolution > 0.0f ? static_cast<uint32_t>(resolution) : 0;
+}
+
+bool ShadowFrustum::GetDepthRange( const float view[16], const float projection[16], const Bounds& bounds, float& nearZ, float& farZ )
+{
+    float viewProjection[16];
+    float inverse[16];
+    Multiply( projection, view, viewProjection );
+    if (!Invert( viewProjection, inverse ))
+        return false;
+
+    Point corners[8];
+    GetFrustumCorners( inverse, corners );
+
+    const float cameraNear = ViewDepth( view, corners[0] );
+    const float cameraFar  = ViewDepth( view, corners[4] );
+
+    if (!bounds.IsValid())
+    {
+        nearZ = cameraNear;
+        farZ  = cameraFar;
+        return true;
+    }
+
+    float boundsNear = FLT_MAX;
+    float boundsFar  = -FLT_MAX;
+
+    Point boxCorners[8];
+    GetCorners( bounds, boxCorners );
+    for (const Point& corner : boxCorners)
+    {
+        const float depth = ViewDepth( view, corner );
+        boundsNear = std::min( boundsNear, depth );
+        boundsFar  = std::max( boundsFar, depth );
+    }
+
+    nearZ = std::max( cameraNear, boundsNear );
+    farZ  = std::min( cameraFar, boundsFar );
+
+    return farZ > nearZ;
+}
+
+void ShadowFrustum::ComputeSplits( float nearZ, float farZ, uint32_t count, float lambda, float* pSplits )
+{
+    if (count == 0)
+        return;
+
+    // Logarithmic spacing needs a positive near depth
+    const float logNear = std::max( nearZ, 1e-3f );
+    const float ratio   = std::max( farZ, logNear ) / logNear;
+
+    pSplits[0] = nearZ;
+    for (uint32_t i = 1; i < count; ++i)
+    {
+        const float t = static_cast<float>(i) / static_cast<float>(count);
+        const float uniformSplit     = nearZ + (farZ - nearZ) * t;
+        const float logarithmicSplit = logNear * std::pow( ratio, t );
+
+        pSplits[i] = lambda * logarithmicSplit + (1.0f - lambda) * uniformSplit;
+    }
+    pSplits[count] = farZ;
+}
+
+void ShadowFrustum::GetCascadeTile( uint32_t cascade, uint32_t cascadeCount, uint32_t mapSize, uint32_t& x, uint32_t& y, uint32_t& size )
+{
+    // One cascade takes the whole map, more share it as quarters
+    const uint32_t columns = cascadeCount > 1 ? 2 : 1;
+
+    size = mapSize / columns;
+    x    = (cascade % columns) * size;
+    y    = (cascade / columns) * size;
+}
+
+uint32_t ShadowFrustum::FitCascades( const Input& input, uint32_t cascadeCount, float lambda, uint32_t mapSize, Result* pResults, float* pSplits )
+{
+    cascadeCount = std::max( cascadeCount, 1u );
+    if (cascadeCount > MAX_CASCADES)
+        cascadeCount = MAX_CASCADES;
+
+    // Splits cover only the depths the receivers occupy, so no cascade is spent on empty space
+    uint32_t count = 1;
+    if (cascadeCount > 1 && input.pCameraView != nullptr && input.pCameraProjection != nullptr &&
+        GetDepthRange( input.pCameraView, input.pCameraProjection, input.receivers, pSplits[0], pSplits[1] ))
+    {
+        count = cascadeCount;
+        ComputeSplits( pSplits[0], pSplits[1], count, lambda, pSplits );
+    }
+
+    Input cascade = input;
+    cascade.sizeStep  = input.sizeStep / count;
+    cascade.splitNear = 0.0f;
+    cascade.splitFar  = 0.0f;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t x, y;
+        GetCascadeTile( i, count, mapSize, x, y, cascade.resolution );
+
+        if (count > 1)
+        {
+            cascade.splitNear = pSplits[i];
+            cascade.splitFar  = pSplits[i + 1];
+        }
+
+        if (!Fit( cascade, pResults[i] ))
+            return 0;
+    }
+
+    return count;
+}
+
+bool ShadowFrustum::Intersects( const Result& result, const Bounds& bounds )
+{
+    if (!bounds.IsValid())
+        return false;
+
+    float viewProjection[16];
+    Multiply( result.projection, result.view, viewProjection );
+
+    // Separated when every corner lies beyond the same side of the box; nothing is closer than
+    // the near plane, which the fit already pulled back to the casters
+    bool bOutside[5] = { true, true, true, true, true };
+
+    Point corners[8];
+    GetCorners( bounds, corners );
+    for (const Point& corner : corners)
+    {
+        const float position[4] = { corner.v[0], corner.v[1], corner.v[2], 1.0f };
+        float clip[4];
+        Transform( viewProjection, position, clip );
+
+        bOutside[0] = bOutside[0] && clip[0] < -1.0f;
+        bOutside[1] = bOutside[1] && clip[0] > 1.0f;
+        bOutside[2] = bOutside[2] && clip[1] < -1.0f;
+        bOutside[3] = bOutside[3] && clip[1] > 1.0f;
+        bOutside[4] = bOutside[4] && clip[2] > 1.0f;
+    }
+
+    for (bool b : bOutside)
+    {
+        if (b)
+            return false;
+    }
+
+    return true;
+}
+
+void ShadowFrustum::Multiply( const float a[16], const float b[16], float out[16] )
+{
+    float result[16];
+    for (int row = 0; row < 4; ++row)
+    {
+        for (int column = 0; column < 4; ++column)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; ++k)
+            {
+                sum += a[k * 4 + row] * b[column * 4 + k];
+            }
+            result[column * 4 + row] = sum;
+        }
+    }
+
+    std::copy( result, result + 16, out );
+}
+
+bool ShadowFrustum::Invert( const float m[16], float out[16] )
+{
+    // Cofactor expansion, valid for either storage order
+    double inv[16];
+    inv[0]  =  m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    inv[4]  = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    inv[8]  =  m[4] * m[9]  * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    inv[12] = -m[4] * m[9]  * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    inv[1]  = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    inv[5]  =  m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    inv[9]  = -m[0] * m[9]  * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    inv[13] =  m[0] * m[9]  * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    inv[2]  =  m[1] * m[6]  * m[15] - m[1] * m[7]  * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7]  - m[13] * m[3] * m[6];
+    inv[6]  = -m[0] * m[6]  * m[15] + m[0] * m[7]  * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7]  + m[12] * m[3] * m[6];
+    inv[10] =  m[0] * m[5]  * m[15] - m[0] * m[7]  * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7]  - m[12] * m[3] * m[5];
+    inv[14] = -m[0] * m[5]  * m[14] + m[0] * m[6]  * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6]  + m[12] * m[2] * m[5];
+    inv[3]  = -m[1] * m[6]  * m[11] + m[1] * m[7]  * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9]  * m[2] * m[7]  + m[9]  * m[3] * m[6];
+    inv[7]  =  m[0] * m[6]  * m[11] - m[0] * m[7]  * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8]  * m[2] * m[7]  - m[8]  * m[3] * m[6];
+    inv[11] = -m[0] * m[5]  * m[11] + m[0] * m[7]  * m[9]  + m[4] * m[1] * m[11] - m[4] * m[3] * m[9]  - m[8]  * m[1] * m[7]  + m[8]  * m[3] * m[5];
+    inv[15] =  m[0] * m[5]  * m[10] - m[0] * m[6]  * m[9]  - m[4] * m[1] * m[10] + m[4] * m[2] * m[9]  + m[8]  * m[1] * m[6]  - m[8]  * m[2] * m[5];
+
+    const double determinant = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+    if (determinant == 0.0)
+        return false;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        out[i] = static_cast<float>(inv[i] / determinant);
+    }
+
+    return true;
+}
+
+void ShadowFrustum::Transform( const float m[16], const float v[4], float out[4] )
+{
+    float result[4];
+    for (int row = 0; row < 4; ++row)
+    {
+        result[row] = m[row] * v[0] + m[4 + row] * v[1] + m[8 + row] * v[2] + m[12 + row] * v[3];
+    }
+
+    std::copy( result, result + 4, out );
+}
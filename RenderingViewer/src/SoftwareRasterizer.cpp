@@ -0,0 +1,877 @@
+#include "SoftwareRasterizer.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWARE_RASTERIZER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const int32_t SUBPIXEL_BITS = 4;
+    const int32_t SUBPIXEL_SIZE = 1 << SUBPIXEL_BITS;
+    const int32_t SUBPIXEL_HALF = SUBPIXEL_SIZE / 2;
+
+    // Clip x and y at twice the viewport so snapped coordinates keep edge values within int32 per tile
+    const float GUARD_BAND = 2.0f;
+
+    // Edge values at a row start are clamped to this; a tile row never moves an edge by more than half of it
+    const int64_t EDGE_CLAMP = 1 << 30;
+
+    // Bias ForwardShading.hlsl subtracts before the shadow compare
+    const float SHADOW_BIAS = 0.00005f;
+
+    const uint32_t MAX_CLIP_VERTICES = 9;
+
+    // Triangles per setup thread below which more threads do not pay off
+    const uint64_t SETUP_BATCH = 1024;
+
+    double GetMilliseconds( std::chrono::steady_clock::time_point start )
+    {
+        return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+    }
+
+    float Dot3( const float* a, const float* b )
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    void Normalize3( float* v )
+    {
+        float length = std::sqrt( Dot3( v, v ) );
+        if (length > 0.0f)
+        {
+            v[0] /= length;
+            v[1] /= length;
+            v[2] /= length;
+        }
+    }
+
+    float Saturate( float v )
+    {
+        return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+    }
+
+    uint32_t PackColor( float r, float g, float b, float a )
+    {
+        uint32_t ir = static_cast<uint32_t>(Saturate( r ) * 255.0f + 0.5f);
+        uint32_t ig = static_cast<uint32_t>(Saturate( g ) * 255.0f + 0.5f);
+        uint32_t ib = static_cast<uint32_t>(Saturate( b ) * 255.0f + 0.5f);
+        uint32_t ia = static_cast<uint32_t>(Saturate( a ) * 255.0f + 0.5f);
+
+        return ir | (ig << 8) | (ib << 16) | (ia << 24);
+    }
+
+    // Signed distances to the clip planes, inside when >= 0: near (D3D z >= 0) and the guard band
+    float ClipDistance( const float* pVertex, uint32_t plane )
+    {
+        const float x = pVertex[0];
+        const float y = pVertex[1];
+        const float z = pVertex[2];
+        const float w = pVertex[3];
+
+        switch (plane)
+        {
+        case 0:  return z;
+        case 1:  return GUARD_BAND * w - x;
+        case 2:  return GUARD_BAND * w + x;
+        case 3:  return GUARD_BAND * w - y;
+        default: return GUARD_BAND * w + y;
+        }
+    }
+
+    const uint32_t CLIP_PLANE_COUNT = 5;
+
+    // Texture2D::Sample with MIN_MAG_MIP_LINEAR and WRAP on a single-mip depth texture
+    float SampleLinearWrap( const SoftwareRasterizer::DepthTarget& texture, float u, float v )
+    {
+        const int32_t width  = static_cast<int32_t>(texture.width);
+        const int32_t height = static_cast<int32_t>(texture.height);
+
+        const float x = u * width - 0.5f;
+        const float y = v * height - 0.5f;
+
+        const float fx = std::floor( x );
+        const float fy = std::floor( y );
+        const float tx = x - fx;
+        const float ty = y - fy;
+
+        auto wrap = []( int32_t i, int32_t size ) { i %= size; return i < 0 ? i + size : i; };
+
+        const int32_t x0 = wrap( static_cast<int32_t>(fx), width );
+        const int32_t y0 = wrap( static_cast<int32_t>(fy), height );
+        const int32_t x1 = wrap( x0 + 1, width );
+        const int32_t y1 = wrap( y0 + 1, height );
+
+        const float* pData = texture.data.data();
+        const float d00 = pData[y0 * width + x0];
+        const float d10 = pData[y0 * width + x1];
+        const float d01 = pData[y1 * width + x0];
+        const float d11 = pData[y1 * width + x1];
+
+        const float top    = d00 + (d10 - d00) * tx;
+        const float bottom = d01 + (d11 - d01) * tx;
+
+        return top + (bottom - top) * ty;
+    }
+}
+
+struct SoftwareRasterizer::Pass
+{
+    Pass()
+        : bForward( false )
+        , pTransform( nullptr )
+        , pLight( nullptr )
+        , pShadowMap( nullptr )
+        , pColor( nullptr )
+        , width( 0 )
+        , height( 0 )
+    {
+    }
+
+    bool bForward;
+
+    const TransformConstants* pTransform;
+    const LightConstants*     pLight;
+    const DepthTarget*        pShadowMap;
+    ColorTarget*              pColor;
+
+    uint32_t width;
+    uint32_t height;
+
+    // Normalized -Direction, shared by every pixel
+    float lightVector[3];
+};
+
+void SoftwareRasterizer::ColorTarget::Clear( float r, float g, float b )
+{
+    data.assign( data.size(), PackColor( r, g, b, 1.0f ) );
+}
+
+SoftwareRasterizer::SoftwareRasterizer( uint32_t threadCount )
+    : m_threadCount( threadCount )
+    , m_cullMode( CULL_MODE_BACK )
+    , m_tilesX( 0 )
+    , m_tilesY( 0 )
+    , m_setupThreads( 0 )
+{
+    if (m_threadCount == 0)
+        m_threadCount = std::max( 1u, std::thread::hardware_concurrency() );
+}
+
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+}
+
+bool SoftwareRasterizer::RenderShadow( const LightConstants& light, const std::vector<Mesh>& meshes, DepthTarget& shadowMap )
+{
+    Pass pass;
+    pass.pLight = &light;
+    pass.width  = shadowMap.width;
+    pass.height = shadowMap.height;
+
+    return Render( pass, meshes, shadowMap );
+}
+
+bool SoftwareRasterizer::RenderForward( const TransformConstants& transform, const LightConstants& light, const DepthTarget& shadowMap,
+                                        const std::vector<Mesh>& meshes, ColorTarget& color, DepthTarget& depth )
+{
+    if (color.width != depth.width || color.height != depth.height || shadowMap.width == 0 || shadowMap.height == 0)
+        return false;
+
+    Pass pass;
+    pass.bForward   = true;
+    pass.pTransform = &transform;
+    pass.pLight     = &light;
+    pass.pShadowMap = &shadowMap;
+    pass.pColor     = &color;
+    pass.width      = color.width;
+    pass.height     = color.height;
+
+    pass.lightVector[0] = -light.direction[0];
+    pass.lightVector[1] = -light.direction[1];
+    pass.lightVector[2] = -light.direction[2];
+    Normalize3( pass.lightVector );
+
+    return Render( pass, meshes, depth );
+}
+
+bool SoftwareRasterizer::Render( const Pass& pass, const std::vector<Mesh>& meshes, DepthTarget& depth )
+{
+    m_statistics.Clear();
+
+    if (pass.width == 0 || pass.height == 0 || pass.width > MAX_TARGET_SIZE || pass.height > MAX_TARGET_SIZE)
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    m_tilesX = (pass.width + TILE_SIZE - 1) / TILE_SIZE;
+    m_tilesY = (pass.height + TILE_SIZE - 1) / TILE_SIZE;
+    const uint32_t tileCount = m_tilesX * m_tilesY;
+
+    // Vertex shading, once per vertex
+    m_vertexOffsets.resize( meshes.size() + 1 );
+    m_vertexOffsets[0] = 0;
+
+    uint64_t triangleCount = 0;
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        m_vertexOffsets[i + 1] = m_vertexOffsets[i] + meshes[i].vertexCount;
+        triangleCount += meshes[i].indexCount / 3;
+    }
+
+    const uint64_t vertexCount = m_vertexOffsets.back();
+    m_clipVertices.resize( static_cast<size_t>(vertexCount) * CLIP_VERTEX_SIZE );
+
+    const uint32_t vertexThreads = static_cast<uint32_t>(std::max<uint64_t>( 1, std::min<uint64_t>( m_threadCount, vertexCount / SETUP_BATCH ) ));
+    ParallelFor( vertexThreads, [&]( uint32_t thread )
+    {
+        TransformVertices( pass, meshes, vertexCount * thread / vertexThreads, vertexCount * (thread + 1) / vertexThreads );
+    } );
+
+    // Clipping, culling and binning. Each thread owns a contiguous triangle range and its own bins.
+    const uint32_t setupThreads = static_cast<uint32_t>(std::max<uint64_t>( 1, std::min<uint64_t>( m_threadCount, triangleCount / SETUP_BATCH ) ));
+
+    m_triangles.resize( std::max<size_t>( m_triangles.size(), setupThreads ) );
+    m_bins.resize( std::max<size_t>( m_bins.size(), static_cast<size_t>(setupThreads) * tileCount ) );
+
+    ParallelFor( setupThreads, [&]( uint32_t thread )
+    {
+        m_triangles[thread].clear();
+        for (uint32_t tile = 0; tile < tileCount; ++tile)
+        {
+            m_bins[static_cast<size_t>(thread) * tileCount + tile].clear();
+        }
+
+        SetupTriangles( pass, meshes, thread, triangleCount * thread / setupThreads, triangleCount * (thread + 1) / setupThreads );
+    } );
+
+    m_statistics.triangles = triangleCount;
+    for (uint32_t thread = 0; thread < setupThreads; ++thread)
+    {
+        m_statistics.binnedTriangles += m_triangles[thread].size();
+    }
+
+    m_statistics.setupMilliseconds = GetMilliseconds( start );
+    start = std::chrono::steady_clock::now();
+
+    // Tiles are independent, threads pull them until none are left
+    m_tilePixels.assign( tileCount, 0 );
+    m_tileTriangles.assign( tileCount, 0 );
+
+    m_setupThreads = setupThreads;
+
+    std::atomic<uint32_t> nextTile( 0 );
+    ParallelFor( std::min( m_threadCount, tileCount ), [&]( uint32_t thread )
+    {
+        (void)thread;
+
+        for (uint32_t tile = nextTile++; tile < tileCount; tile = nextTile++)
+        {
+            RasterizeTile( pass, meshes, tile, depth );
+        }
+    } );
+
+    for (uint32_t tile = 0; tile < tileCount; ++tile)
+    {
+        m_statistics.pixels        += m_tilePixels[tile];
+        m_statistics.tileTriangles += m_tileTriangles[tile];
+    }
+
+    m_statistics.rasterMilliseconds = GetMilliseconds( start );
+
+    return true;
+}
+
+void SoftwareRasterizer::TransformVertices( const Pass& pass, const std::vector<Mesh>& meshes, uint64_t begin, uint64_t end )
+{
+    size_t meshIndex = std::upper_bound( m_vertexOffsets.begin(), m_vertexOffsets.end(), begin ) - m_vertexOffsets.begin() - 1;
+
+    for (uint64_t i = begin; i < end; ++i)
+    {
+        while (i >= m_vertexOffsets[meshIndex + 1])
+            meshIndex++;
+
+        const Vertex& vertex = meshes[meshIndex].pVertices[i - m_vertexOffsets[meshIndex]];
+        float* pOut = &m_clipVertices[static_cast<size_t>(i) * CLIP_VERTEX_SIZE];
+
+        const float localPos[4] = { vertex.position[0], vertex.position[1], vertex.position[2], 1.0f };
+
+        if (pass.bForward)
+        {
+            // VSMain of ForwardShading.hlsl
+            const TransformConstants& transform = *pass.pTransform;
+
+            float worldPos[4];
+            float viewPos[4];
+            Transform( transform.world, localPos, worldPos );
+            Transform( transform.view, worldPos, viewPos );
+            Transform( transform.projection, viewPos, pOut );
+
+            float* pVaryings = pOut + 4;
+            pVaryings[0] = worldPos[0];
+            pVaryings[1] = worldPos[1];
+            pVaryings[2] = worldPos[2];
+            pVaryings[3] = worldPos[3];
+
+            // mul( (float3x3)World, Normal )
+            const float* m = transform.world;
+            for (int r = 0; r < 3; ++r)
+            {
+                pVaryings[4 + r] = m[0 * 4 + r] * vertex.normal[0] + m[1 * 4 + r] * vertex.normal[1] + m[2 * 4 + r] * vertex.normal[2];
+            }
+        }
+        else
+        {
+            // VSMain of Shadow.hlsl
+            float viewPos[4];
+            Transform( pass.pLight->view, localPos, viewPos );
+            Transform( pass.pLight->projection, viewPos, pOut );
+        }
+    }
+}
+
+void SoftwareRasterizer::SetupTriangles( const Pass& pass, const std::vector<Mesh>& meshes, uint32_t thread, uint64_t begin, uint64_t end )
+{
+    // Find the mesh holding the first triangle of the range
+    uint32_t meshIndex     = 0;
+    uint64_t meshTriangles = 0;
+    while (meshIndex < meshes.size() && begin >= meshTriangles + meshes[meshIndex].indexCount / 3)
+    {
+        meshTriangles += meshes[meshIndex].indexCount / 3;
+        meshIndex++;
+    }
+
+    float clip[2][MAX_CLIP_VERTICES][CLIP_VERTEX_SIZE];
+
+    for (uint64_t triangle = begin; triangle < end; ++triangle)
+    {
+        while (triangle >= meshTriangles + meshes[meshIndex].indexCount / 3)
+        {
+            meshTriangles += meshes[meshIndex].indexCount / 3;
+            meshIndex++;
+        }
+
+        const Mesh&    mesh  = meshes[meshIndex];
+        const uint64_t first = (triangle - meshTriangles) * 3;
+
+        const float* pVertices[3];
+        bool bOutside = false;
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t index = mesh.pIndices[first + k];
+            if (index >= mesh.vertexCount)
+            {
+                bOutside = true;
+                break;
+            }
+
+            pVertices[k] = &m_clipVertices[static_cast<size_t>(m_vertexOffsets[meshIndex] + index) * CLIP_VERTEX_SIZE];
+        }
+
+        uint32_t clipMask = 0;
+        for (uint32_t plane = 0; plane < CLIP_PLANE_COUNT && !bOutside; ++plane)
+        {
+            uint32_t outsideCount = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                if (ClipDistance( pVertices[k], plane ) < 0.0f)
+                    outsideCount++;
+            }
+
+            if (outsideCount == 3)
+                bOutside = true;
+            else if (outsideCount > 0)
+                clipMask |= 1u << plane;
+        }
+
+        if (bOutside)
+            continue;
+
+        if (clipMask == 0)
+        {
+            EmitTriangle( pass, thread, meshIndex, pVertices );
+            continue;
+        }
+
+        // Sutherland-Hodgman against the planes the triangle crosses
+        uint32_t count = 3;
+        for (int k = 0; k < 3; ++k)
+        {
+            std::copy( pVertices[k], pVertices[k] + CLIP_VERTEX_SIZE, clip[0][k] );
+        }
+
+        uint32_t src = 0;
+        for (uint32_t plane = 0; plane < CLIP_PLANE_COUNT && count >= 3; ++plane)
+        {
+            if ((clipMask & (1u << plane)) == 0)
+                continue;
+
+            const uint32_t dst      = src ^ 1;
+            uint32_t       dstCount = 0;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const float* pA = clip[src][i];
+                const float* pB = clip[src][(i + 1) % count];
+                const float  da = ClipDistance( pA, plane );
+                const float  db = ClipDistance( pB, plane );
+
+                if (da >= 0.0f)
+                    std::copy( pA, pA + CLIP_VERTEX_SIZE, clip[dst][dstCount++] );
+
+                if ((da >= 0.0f) != (db >= 0.0f))
+                {
+                    const float t = da / (da - db);
+                    for (uint32_t j = 0; j < CLIP_VERTEX_SIZE; ++j)
+                    {
+                        clip[dst][dstCount][j] = pA[j] + (pB[j] - pA[j]) * t;
+                    }
+                    dstCount++;
+                }
+            }
+
+            count = dstCount;
+            src   = dst;
+        }
+
+        for (uint32_t i = 1; i + 1 < count; ++i)
+        {
+            const float* pFan[3] = { clip[src][0], clip[src][i], clip[src][i + 1] };
+            EmitTriangle( pass, thread, meshIndex, pFan );
+        }
+    }
+}
+
+void SoftwareRasterizer::EmitTriangle( const Pass& pass, uint32_t thread, uint32_t meshIndex, const float* pVertices[3] )
+{
+    int32_t x[3];
+    int32_t y[3];
+    float   z[3];
+    float   invW[3];
+
+    for (int k = 0; k < 3; ++k)
+    {
+        const float* pVertex = pVertices[k];
+
+        invW[k] = 1.0f / pVertex[3];
+
+        // Viewport transform, snapped to the subpixel grid
+        const float sx = (pVertex[0] * invW[k] + 1.0f) * 0.5f * pass.width;
+        const float sy = (1.0f - pVertex[1] * invW[k]) * 0.5f * pass.height;
+
+        x[k] = static_cast<int32_t>(std::floor( sx * SUBPIXEL_SIZE + 0.5f ));
+        y[k] = static_cast<int32_t>(std::floor( sy * SUBPIXEL_SIZE + 0.5f ));
+        z[k] = pVertex[2] * invW[k];
+    }
+
+    int64_t area = static_cast<int64_t>(x[1] - x[0]) * (y[2] - y[0]) - static_cast<int64_t>(y[1] - y[0]) * (x[2] - x[0]);
+    if (area == 0)
+        return;
+
+    // Clockwise on screen is front facing, as with the default D3D rasterizer state
+    int order[3] = { 0, 1, 2 };
+    if (area < 0)
+    {
+        if (m_cullMode == CULL_MODE_BACK)
+            return;
+
+        std::swap( order[1], order[2] );
+        area = -area;
+    }
+
+    Triangle triangle;
+
+    int32_t minX = std::min( std::min( x[0], x[1] ), x[2] );
+    int32_t minY = std::min( std::min( y[0], y[1] ), y[2] );
+    int32_t maxX = std::max( std::max( x[0], x[1] ), x[2] );
+    int32_t maxY = std::max( std::max( y[0], y[1] ), y[2] );
+
+    // Pixels whose centers fall inside the bounds
+    auto firstPixel = []( int32_t v ) { return (v - SUBPIXEL_HALF + SUBPIXEL_SIZE - 1) >> SUBPIXEL_BITS; };
+    auto lastPixel  = []( int32_t v ) { return (v - SUBPIXEL_HALF) >> SUBPIXEL_BITS; };
+
+    triangle.minX = std::max( firstPixel( minX ), 0 );
+    triangle.minY = std::max( firstPixel( minY ), 0 );
+    triangle.maxX = std::min( lastPixel( maxX ), static_cast<int32_t>(pass.width) - 1 );
+    triangle.maxY = std::min( lastPixel( maxY ), static_cast<int32_t>(pass.height) - 1 );
+
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return;
+
+    for (int k = 0; k < 3; ++k)
+    {
+        const int v0 = order[k];
+        const int va = order[(k + 1) % 3];
+        const int vb = order[(k + 2) % 3];
+
+        // Edge from va to vb, opposite v0
+        const int64_t a = static_cast<int64_t>(y[va]) - y[vb];
+        const int64_t b = static_cast<int64_t>(x[vb]) - x[va];
+        int64_t       c = -(a * x[va] + b * y[va]);
+
+        // Top-left fill rule
+        const bool bTopLeft = a > 0 || (a == 0 && b > 0);
+        if (!bTopLeft)
+            c -= 1;
+
+        triangle.a[k] = a;
+        triangle.b[k] = b;
+        triangle.c[k] = c;
+
+        triangle.z[k]    = z[v0];
+        triangle.invW[k] = invW[v0];
+
+        if (pass.bForward)
+            std::copy( pVertices[v0] + 4, pVertices[v0] + CLIP_VERTEX_SIZE, triangle.varyings[k] );
+    }
+
+    triangle.invArea   = 1.0f / static_cast<float>(area);
+    triangle.meshIndex = meshIndex;
+
+    std::vector<Triangle>& triangles = m_triangles[thread];
+    const uint32_t index = static_cast<uint32_t>(triangles.size());
+    triangles.push_back( triangle );
+
+    const uint32_t tileCount = m_tilesX * m_tilesY;
+    for (int32_t ty = triangle.minY / TILE_SIZE; ty <= triangle.maxY / static_cast<int32_t>(TILE_SIZE); ++ty)
+    {
+        for (int32_t tx = triangle.minX / TILE_SIZE; tx <= triangle.maxX / static_cast<int32_t>(TILE_SIZE); ++tx)
+        {
+            m_bins[static_cast<size_t>(thread) * tileCount + ty * m_tilesX + tx].push_back( index );
+        }
+    }
+}
+
+void SoftwareRasterizer::RasterizeTile( const Pass& pass, const std::vector<Mesh>& meshes, uint32_t tile, DepthTarget& depth )
+{
+    const uint32_t tileCount = m_tilesX * m_tilesY;
+
+    const int32_t tileX0 = static_cast<int32_t>((tile % m_tilesX) * TILE_SIZE);
+    const int32_t tileY0 = static_cast<int32_t>((tile / m_tilesX) * TILE_SIZE);
+    const int32_t tileX1 = std::min( tileX0 + static_cast<int32_t>(TILE_SIZE), static_cast<int32_t>(pass.width) ) - 1;
+    const int32_t tileY1 = std::min( tileY0 + static_cast<int32_t>(TILE_SIZE), static_cast<int32_t>(pass.height) ) - 1;
+
+    uint64_t pixels    = 0;
+    uint64_t triangles = 0;
+
+    float*    pDepth = depth.data.data();
+    uint32_t* pColor = pass.bForward ? pass.pColor->data.data() : nullptr;
+
+    // Setup threads binned contiguous triangle ranges, so walking them in thread order keeps submission order
+    for (uint32_t thread = 0; thread < m_setupThreads; ++thread)
+    {
+        const std::vector<Triangle>& threadTriangles = m_triangles[thread];
+
+        for (uint32_t index : m_bins[static_cast<size_t>(thread) * tileCount + tile])
+        {
+            const Triangle& triangle = threadTriangles[index];
+
+            const int32_t x0 = std::max( triangle.minX, tileX0 );
+            const int32_t y0 = std::max( triangle.minY, tileY0 );
+            const int32_t x1 = std::min( triangle.maxX, tileX1 );
+            const int32_t y1 = std::min( triangle.maxY, tileY1 );
+            if (x0 > x1 || y0 > y1)
+                continue;
+
+            triangles++;
+
+            // Edge values at the first pixel center of the first row, and their steps per pixel
+            int64_t rowEdge[3];
+            int32_t stepX[3];
+            int64_t stepY[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                rowEdge[k] = triangle.a[k] * (x0 * SUBPIXEL_SIZE + SUBPIXEL_HALF) + triangle.b[k] * (y0 * SUBPIXEL_SIZE + SUBPIXEL_HALF) + triangle.c[k];
+                stepX[k]   = static_cast<int32_t>(triangle.a[k] * SUBPIXEL_SIZE);
+                stepY[k]   = triangle.b[k] * SUBPIXEL_SIZE;
+            }
+
+#if SOFTWARE_RASTERIZER_SSE2
+            // E + stepX * lane for the four lanes of a quad
+            __m128i laneSteps[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                laneSteps[k] = _mm_set_epi32( stepX[k] * 3, stepX[k] * 2, stepX[k], 0 );
+            }
+#endif
+
+            const float z0  = triangle.z[0];
+            const float dz1 = (triangle.z[1] - z0) * triangle.invArea;
+            const float dz2 = (triangle.z[2] - z0) * triangle.invArea;
+
+            for (int32_t y = y0; y <= y1; ++y)
+            {
+                // Coverage runs on int32 values clamped far enough out that stepping along the row cannot flip their sign
+                int32_t edge[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    edge[k] = static_cast<int32_t>(std::max( -EDGE_CLAMP, std::min( EDGE_CLAMP, rowEdge[k] ) ));
+                }
+
+                const size_t rowOffset = static_cast<size_t>(y) * pass.width;
+
+                for (int32_t x = x0; x <= x1; x += 4)
+                {
+                    // Barycentrics in float from the exact edge values
+                    const int64_t dx = x - x0;
+                    const float   e1 = static_cast<float>(rowEdge[1] + stepX[1] * dx);
+                    const float   e2 = static_cast<float>(rowEdge[2] + stepX[2] * dx);
+                    const float   s1 = static_cast<float>(stepX[1]);
+                    const float   s2 = static_cast<float>(stepX[2]);
+
+                    float* pDepthRow = pDepth + rowOffset + x;
+                    const int32_t laneCount = std::min( 4, x1 - x + 1 );
+
+                    uint32_t mask = 0;
+                    float    laneZ[4];
+
+#if SOFTWARE_RASTERIZER_SSE2
+                    const __m128i laneIndex  = _mm_set_epi32( 3, 2, 1, 0 );
+                    const __m128  laneIndexF = _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f );
+
+                    // Inside when no edge value has its sign bit set
+                    const __m128i inside = _mm_or_si128( _mm_or_si128( _mm_add_epi32( _mm_set1_epi32( edge[0] ), laneSteps[0] ),
+                                                                       _mm_add_epi32( _mm_set1_epi32( edge[1] ), laneSteps[1] ) ),
+                                                         _mm_add_epi32( _mm_set1_epi32( edge[2] ), laneSteps[2] ) );
+                    const __m128i valid  = _mm_cmplt_epi32( laneIndex, _mm_set1_epi32( laneCount ) );
+                    const __m128i cover  = _mm_and_si128( _mm_cmpgt_epi32( inside, _mm_set1_epi32( -1 ) ), valid );
+
+                    const __m128 b1 = _mm_add_ps( _mm_set1_ps( e1 ), _mm_mul_ps( laneIndexF, _mm_set1_ps( s1 ) ) );
+                    const __m128 b2 = _mm_add_ps( _mm_set1_ps( e2 ), _mm_mul_ps( laneIndexF, _mm_set1_ps( s2 ) ) );
+                    const __m128 zv = _mm_add_ps( _mm_set1_ps( z0 ), _mm_add_ps( _mm_mul_ps( b1, _mm_set1_ps( dz1 ) ), _mm_mul_ps( b2, _mm_set1_ps( dz2 ) ) ) );
+
+                    float current[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+                    for (int32_t lane = 0; lane < laneCount; ++lane)
+                    {
+                        current[lane] = pDepthRow[lane];
+                    }
+
+                    // Depth test LESS plus depth clip to [0, 1]
+                    __m128 depthPass = _mm_and_ps( _mm_cmplt_ps( zv, _mm_loadu_ps( current ) ), _mm_cmpge_ps( zv, _mm_setzero_ps() ) );
+                    depthPass = _mm_and_ps( depthPass, _mm_cmple_ps( zv, _mm_set1_ps( 1.0f ) ) );
+                    depthPass = _mm_and_ps( depthPass, _mm_castsi128_ps( cover ) );
+
+                    mask = static_cast<uint32_t>(_mm_movemask_ps( depthPass ));
+                    _mm_storeu_ps( laneZ, zv );
+#else
+                    for (int32_t lane = 0; lane < laneCount; ++lane)
+                    {
+                        const int32_t e0 = edge[0] + stepX[0] * lane;
+                        const int32_t e1i = edge[1] + stepX[1] * lane;
+                        const int32_t e2i = edge[2] + stepX[2] * lane;
+                        if ((e0 | e1i | e2i) < 0)
+                            continue;
+
+                        const float zl = z0 + ((e1 + lane * s1) * dz1 + (e2 + lane * s2) * dz2);
+                        if (zl < pDepthRow[lane] && zl >= 0.0f && zl <= 1.0f)
+                        {
+                            mask |= 1u << lane;
+                            laneZ[lane] = zl;
+                        }
+                    }
+#endif
+
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        edge[k] += stepX[k] * 4;
+                    }
+
+                    if (mask == 0)
+                        continue;
+
+                    for (int32_t lane = 0; lane < laneCount; ++lane)
+                    {
+                        if ((mask & (1u << lane)) == 0)
+                            continue;
+
+                        pDepthRow[lane] = laneZ[lane];
+                        pixels++;
+
+                        if (!pass.bForward)
+                            continue;
+
+                        // Perspective-correct varyings
+                        const float w1 = (e1 + s1 * lane) * triangle.invArea;
+                        const float w2 = (e2 + s2 * lane) * triangle.invArea;
+                        const float w0 = 1.0f - w1 - w2;
+
+                        const float p0 = w0 * triangle.invW[0];
+                        const float p1 = w1 * triangle.invW[1];
+                        const float p2 = w2 * triangle.invW[2];
+                        const float invSum = 1.0f / (p0 + p1 + p2);
+
+                        float varyings[VARYING_COUNT];
+                        for (uint32_t i = 0; i < VARYING_COUNT; ++i)
+                        {
+                            varyings[i] = (triangle.varyings[0][i] * p0 + triangle.varyings[1][i] * p1 + triangle.varyings[2][i] * p2) * invSum;
+                        }
+
+                        const float* worldPos = varyings;
+                        const float* normal   = varyings + 4;
+
+                        // Phong() of ForwardShading.hlsl; the normal is used as interpolated
+                        const MaterialConstants& material = meshes[triangle.meshIndex].material;
+                        const float nDotL    = std::max( Dot3( pass.lightVector, normal ), 0.0f );
+                        const float specular = std::pow( nDotL, material.ks[3] );
+
+                        float color[3];
+                        for (int i = 0; i < 3; ++i)
+                        {
+                            color[i] = material.ka[i] + material.kd[i] * nDotL + material.ks[i] * specular;
+                        }
+
+                        // Shadow compare
+                        const LightConstants& light = *pass.pLight;
+                        float viewPos[4];
+                        float lightPos[4];
+                        Transform( light.view, worldPos, viewPos );
+                        Transform( light.projection, viewPos, lightPos );
+
+                        const float invLightW   = 1.0f / lightPos[3];
+                        const float lightDepth  = lightPos[2] * invLightW - SHADOW_BIAS;
+                        const float u           = 0.5f * (lightPos[0] * invLightW + 1.0f);
+                        const float v           = 1.0f - 0.5f * (lightPos[1] * invLightW + 1.0f);
+
+                        float shadowFactor = 1.0f;
+                        if (SampleLinearWrap( *pass.pShadowMap, u, v ) < lightDepth)
+                            shadowFactor = 0.25f;
+
+                        pColor[rowOffset + x + lane] = PackColor( color[0] * shadowFactor, color[1] * shadowFactor, color[2] * shadowFactor, 1.0f );
+                    }
+                }
+
+                for (int k = 0; k < 3; ++k)
+                {
+                    rowEdge[k] += stepY[k];
+                }
+            }
+        }
+    }
+
+    m_tilePixels[tile]    = pixels;
+    m_tileTriangles[tile] = triangles;
+}
+
+template <typename Func>
+void SoftwareRasterizer::ParallelFor( uint32_t workerCount, Func func )
+{
+    JobSystem::GetInstance().ParallelFor( workerCount, func, 1 );
+}
+
+void SoftwareRasterizer::Transform( const float m[16], const float v[4], float out[4] )
+{
+    // Constants are packed column_major, so element (row, column) lives at column * 4 + row
+    for (int r = 0; r < 4; ++r)
+    {
+        out[r] = m[0 * 4 + r] * v[0] + m[1 * 4 + r] * v[1] + m[2 * 4 + r] * v[2] + m[3 * 4 + r] * v[3];
+    }
+}
+
+void SoftwareRasterizer::CreateLookAtLH( const float eye[3], const float target[3], const float up[3], float out[16] )
+{
+    float zAxis[3] = { target[0] - eye[0], target[1] - eye[1], target[2] - eye[2] };
+    Normalize3( zAxis );
+
+    float xAxis[3] = { up[1] * zAxis[2] - up[2] * zAxis[1], up[2] * zAxis[0] - up[0] * zAxis[2], up[0] * zAxis[1] - up[1] * zAxis[0] };
+    Normalize3( xAxis );
+
+    const float yAxis[3] = { zAxis[1] * xAxis[2] - zAxis[2] * xAxis[1], zAxis[2] * xAxis[0] - zAxis[0] * xAxis[2], zAxis[0] * xAxis[1] - zAxis[1] * xAxis[0] };
+
+    const float* axes[3] = { xAxis, yAxis, zAxis };
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            out[c * 4 + r] = axes[r][c];
+        }
+        out[3 * 4 + r] = -Dot3( axes[r], eye );
+    }
+
+    out[0 * 4 + 3] = 0.0f;
+    out[1 * 4 + 3] = 0.0f;
+    out[2 * 4 + 3] = 0.0f;
+    out[3 * 4 + 3] = 1.0f;
+}
+
+void SoftwareRasterizer::CreatePerspectiveFovLH( float fovY, float aspect, float nearZ, float farZ, float out[16] )
+{
+    std::fill( out, out + 16, 0.0f );
+
+    const float yScale = 1.0f / std::tan( fovY * 0.5f );
+    const float xScale = yScale / aspect;
+
+    out[0 * 4 + 0] = xScale;
+    out[1 * 4 + 1] = yScale;
+    out[2 * 4 + 2] = farZ / (farZ - nearZ);
+    out[3 * 4 + 2] = -nearZ * farZ / (farZ - nearZ);
+    out[2 * 4 + 3] = 1.0f;
+}
+
+void SoftwareRasterizer::CreateOrthographicLH( float left, float right, float bottom, float top, float nearZ, float farZ, float out[16] )
+{
+    std::fill( out, out + 16, 0.0f );
+
+    out[0 * 4 + 0] = 2.0f / (right - left);
+    out[1 * 4 + 1] = 2.0f / (top - bottom);
+    out[2 * 4 + 2] = 1.0f / (farZ - nearZ);
+    out[3 * 4 + 0] = (left + right) / (left - right);
+    out[3 * 4 + 1] = (top + bottom) / (bottom - top);
+    out[3 * 4 + 2] = nearZ / (nearZ - farZ);
+    out[3 * 4 + 3] = 1.0f;
+}
+
+bool SoftwareRasterizer::SaveColor( const ColorTarget& target, const std::string& path )
+{
+    FILE* pFile = fopen( path.c_str(), "wb" );
+    if (pFile == nullptr)
+        return false;
+
+    fprintf( pFile, "P6\n%u %u\n255\n", target.width, target.height );
+
+    std::vector<unsigned char> row( static_cast<size_t>(target.width) * 3 );
+    bool bSucceeded = true;
+    for (uint32_t y = 0; y < target.height && bSucceeded; ++y)
+    {
+        for (uint32_t x = 0; x < target.width; ++x)
+        {
+            const uint32_t color = target.data[static_cast<size_t>(y) * target.width + x];
+            row[x * 3 + 0] = static_cast<unsigned char>(color & 0xff);
+            row[x * 3 + 1] = static_cast<unsigned char>((color >> 8) & 0xff);
+            row[x * 3 + 2] = static_cast<unsigned char>((color >> 16) & 0xff);
+        }
+
+        bSucceeded = fwrite( row.data(), 1, row.size(), pFile ) == row.size();
+    }
+
+    return fclose( pFile ) == 0 && bSucceeded;
+}
+
+bool SoftwareRasterizer::SaveDepth( const DepthTarget& target, const std::string& path )
+{
+    FILE* pFile = fopen( path.c_str(), "wb" );
+    if (pFile == nullptr)
+        return false;
+
+    fprintf( pFile, "P5\n%u %u\n255\n", target.width, target.height );
+
+    std::vector<unsigned char> row( target.width );
+    bool bSucceeded = true;
+    for (uint32_t y = 0; y < target.height && bSucceeded; ++y)
+    {
+        for (uint32_t x = 0; x < target.width; ++x)
+        {
+            row[x] = static_cast<unsigned char>(Saturate( target.data[static_cast<size_t>(y) * target.width + x] ) * 255.0f + 0.5f);
+        }
+
+        bSucceeded = fwrite( row.data(), 1, row.size(), pFile ) == row.size();
+    }
+
+    return fclose( pFile ) == 0 && bSucceeded;
+}
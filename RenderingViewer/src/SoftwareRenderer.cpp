@@ -0,0 +1,134 @@
+static_assert( sizeof( Vertex ) == sizeof( SoftwareRasterizer::Vertex ), "Vertex layout differs from the software rasterizer" );
+static_assert( sizeof( Mat44f ) == sizeof( float ) * 16, "Mat44f is not 16 floats" );
+static_assert( sizeof( Vec4f ) == sizeof( float ) * 4, "Vec4f is not 4 floats" );
+static_assert( sizeof( Vec3f ) == sizeof( float ) * 3, "Vec3f is not 3 floats" );
+
+SoftwareRenderer::SoftwareRenderer( uint32_t threadCount )
+    : m_rasterizer( threadCount )
+{
+}
+
+SoftwareRenderer::~SoftwareRenderer()
+{
+}
+
+bool SoftwareRenderer::Render( shared_ptr<Scene> pScene, UINT width, UINT height, UINT shadowMapSize )
+{
+    if (!Prepare( pScene, shadowMapSize ))
+        return false;
+
+    if (m_pCamera == nullptr)
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "SoftwareRenderer::Render() needs a camera." );
+        return false;
+    }
+
+    if (m_color.width != width || m_color.height != height)
+        m_color.Resize( width, height );
+
+    return RenderView( CreateTransform( m_pCamera->GetViewMatrix(), m_pCamera->GetProjectionMatrix() ), m_color );
+}
+
+bool SoftwareRenderer::Prepare( shared_ptr<Scene> pScene, UINT shadowMapSize )
+{
+    shared_ptr<Light> pLight;
+
+    m_pCamera = nullptr;
+    m_meshes.clear();
+    for (auto& pNode : pScene->GetRootNode()->GetChildren())
+    {
+        if (pNode->IsNodeType( Node::NODE_TYPE_CAMERA ) && m_pCamera == nullptr)
+            m_pCamera = static_pointer_cast<Camera>(pNode);
+        else if (pNode->IsNodeType( Node::NODE_TYPE_LIGHT ) && pLight == nullptr)
+            pLight = static_pointer_cast<Light>(pNode);
+        else if (pNode->IsNodeType( Node::NODE_TYPE_MODEL ))
+        {
+            auto pModel = static_pointer_cast<Model>(pNode);
+            if (pModel->GetIndices().empty())
+                continue;
+
+            SoftwareRasterizer::Mesh mesh;
+            mesh.pVertices   = reinterpret_cast<const SoftwareRasterizer::Vertex*>(pModel->GetVertices().data());
+            mesh.vertexCount = static_cast<uint32_t>(pModel->GetVertices().size());
+            mesh.pIndices    = pModel->GetIndices().data();
+            mesh.indexCount  = static_cast<uint32_t>(pModel->GetIndices().size());
+
+            const Model::ResMaterialData& material = pModel->GetMaterialData();
+            memcpy( mesh.material.ka, &material.ka, sizeof( mesh.material.ka ) );
+            memcpy( mesh.material.kd, &material.kd, sizeof( mesh.material.kd ) );
+            memcpy( mesh.material.ks, &material.ks, sizeof( mesh.material.ks ) );
+
+            m_meshes.push_back( mesh );
+        }
+    }
+
+    if (pLight == nullptr)
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "SoftwareRenderer::Prepare() needs a light." );
+        return false;
+    }
+
+    // The CPU path renders one map, which is only the whole shadow when the light has a single cascade
+    const Light::ResLightData& lightData = pLight->GetBufferData();
+    if (lightData.cascadeCount != 1)
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "SoftwareRenderer::Prepare() supports a single shadow cascade only." );
+        return false;
+    }
+
+    memcpy( m_light.position, &lightData.position[0], sizeof( m_light.position ) );
+    memcpy( m_light.color, &lightData.color[0], sizeof( m_light.color ) );
+    memcpy( m_light.view, &lightData.view[0], sizeof( m_light.view ) );
+    memcpy( m_light.projection, &lightData.projection[0], sizeof( m_light.projection ) );
+    memcpy( m_light.direction, &lightData.direction[0], sizeof( m_light.direction ) );
+    memcpy( m_light.intensity, &lightData.intensity[0], sizeof( m_light.intensity ) );
+
+    if (m_shadowMap.width != shadowMapSize || m_shadowMap.height != shadowMapSize)
+        m_shadowMap.Resize( shadowMapSize, shadowMapSize );
+    else
+        m_shadowMap.Clear( 1.0f );
+
+    if (!m_rasterizer.RenderShadow( m_light, m_meshes, m_shadowMap ))
+        return false;
+    m_shadowStatistics = m_rasterizer.GetStatistics();
+
+    return true;
+}
+
+bool SoftwareRenderer::RenderView( const SoftwareRasterizer::TransformConstants& transform, SoftwareRasterizer::ColorTarget& color )
+{
+    if (m_depth.width != color.width || m_depth.height != color.height)
+        m_depth.Resize( color.width, color.height );
+    else
+        m_depth.Clear( 1.0f );
+
+    // Default clear color of RenderContext::ConstructParams
+    color.Clear( 1.0f, 1.0f, 1.0f );
+
+    if (!m_rasterizer.RenderForward( transform, m_light, m_shadowMap, m_meshes, color, m_depth ))
+        return false;
+    m_forwardStatistics = m_rasterizer.GetStatistics();
+
+    return true;
+}
+
+bool SoftwareRenderer::Save( const string& basePath ) const
+{
+    bool bSucceeded = SoftwareRasterizer::SaveColor( m_color, basePath + ".ppm" );
+    bSucceeded &= SoftwareRasterizer::SaveDepth( m_shadowMap, basePath + "_shadow.pgm" );
+
+    return bSucceeded;
+}
+
+// Same values Camera::UpdateGPUBuffer() uploads
+SoftwareRasterizer::TransformConstants SoftwareRenderer::CreateTransform( const Mat44f& view, const Mat44f& projection )
+{
+    SoftwareRasterizer::TransformConstants transform;
+
+    const Mat44f world = Mat44f::IDENTITY;
+    memcpy( transform.world, &world, sizeof( transform.world ) );
+    memcpy( transform.view, &view, sizeof( transform.view ) );
+    memcpy( transform.projection, &projection, sizeof( transform.projection ) );
+
+    return transform;
+}
@@ -0,0 +1,362 @@
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+    uint32_t FindLowestBit( uint64_t value )
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64( &index, value );
+        return index;
+#else
+        return static_cast<uint32_t>(__builtin_ctzll( value ));
+#endif
+    }
+
+    uint32_t FindHighestBit( uint64_t value )
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64( &index, value );
+        return index;
+#else
+        return 63 - static_cast<uint32_t>(__builtin_clzll( value ));
+#endif
+    }
+}
+
+TlsfAllocator::TlsfAllocator( uint64_t capacity, uint64_t granularity )
+    : m_flBitmap( 0 )
+    , m_usedBytes( 0 )
+    , m_allocationCount( 0 )
+    , m_freeRangeCount( 0 )
+{
+    m_granularityShift = granularity > 1 ? FindHighestBit( granularity - 1 ) + 1 : 0;
+    m_granularity      = 1ull << m_granularityShift;
+    m_capacity         = capacity & ~(m_granularity - 1);
+
+    std::fill( m_slBitmaps, m_slBitmaps + FL_COUNT, 0u );
+    for (uint32_t fl = 0; fl < FL_COUNT; ++fl)
+    {
+        std::fill( m_freeHeads[fl], m_freeHeads[fl] + SL_COUNT, INVALID_NODE );
+    }
+
+    // One free range over the whole block
+    const uint32_t node = CreateNode();
+    m_nodes[node].offset = 0;
+    m_nodes[node].size   = m_capacity;
+    if (m_capacity > 0)
+        InsertFree( node );
+}
+
+TlsfAllocator::~TlsfAllocator()
+{
+}
+
+uint32_t TlsfAllocator::Allocate( uint64_t size, uint64_t alignment )
+{
+    if (size == 0 || size > m_capacity)
+        return INVALID_NODE;
+
+    alignment = std::max( alignment, m_granularity );
+
+    // Room for the worst padding, so any range of the class found fits once aligned
+    const uint64_t alignedSize = (size + m_granularity - 1) & ~(m_granularity - 1);
+    const uint64_t searchSize  = alignedSize + alignment - m_granularity;
+    if (searchSize > m_capacity)
+        return INVALID_NODE;
+
+    uint32_t node = FindFree( searchSize >> m_granularityShift );
+    if (node == INVALID_NODE)
+        return INVALID_NODE;
+
+    RemoveFree( node );
+
+    // Padding in front goes back as a range of its own; the used range before it keeps it from merging
+    const uint64_t offset  = m_nodes[node].offset;
+    const uint64_t padding = ((offset + alignment - 1) & ~(alignment - 1)) - offset;
+    if (padding > 0)
+    {
+        const uint32_t rest = Split( node, padding );
+        InsertFree( node );
+        node = rest;
+    }
+
+    if (m_nodes[node].size > alignedSize)
+    {
+        const uint32_t rest = Split( node, alignedSize );
+        InsertFree( rest );
+    }
+
+    m_nodes[node].bFree = false;
+    m_usedBytes += alignedSize;
+    m_allocationCount++;
+
+    return node;
+}
+
+void TlsfAllocator::Free( uint32_t node )
+{
+    if (node >= m_nodes.size() || m_nodes[node].bFree)
+        return;
+
+    m_usedBytes -= m_nodes[node].size;
+    m_allocationCount--;
+
+    const uint32_t prev = m_nodes[node].prevPhysical;
+    if (prev != INVALID_NODE && m_nodes[prev].bFree)
+    {
+        RemoveFree( prev );
+
+        m_nodes[prev].size += m_nodes[node].size;
+        m_nodes[prev].nextPhysical = m_nodes[node].nextPhysical;
+        if (m_nodes[node].nextPhysical != INVALID_NODE)
+            m_nodes[m_nodes[node].nextPhysical].prevPhysical = prev;
+
+        DestroyNode( node );
+        node = prev;
+    }
+
+    const uint32_t next = m_nodes[node].nextPhysical;
+    if (next != INVALID_NODE && m_nodes[next].bFree)
+    {
+        RemoveFree( next );
+
+        m_nodes[node].size += m_nodes[next].size;
+        m_nodes[node].nextPhysical = m_nodes[next].nextPhysical;
+        if (m_nodes[next].nextPhysical != INVALID_NODE)
+            m_nodes[m_nodes[next].nextPhysical].prevPhysical = node;
+
+        DestroyNode( next );
+    }
+
+    InsertFree( node );
+}
+
+uint64_t TlsfAllocator::GetLargestFreeRange() const
+{
+    if (m_flBitmap == 0)
+        return 0;
+
+    // Only the top class has to be searched, every range in it is larger than the rest
+    const uint32_t fl = FindHighestBit( m_flBitmap );
+    const uint32_t sl = FindHighestBit( m_slBitmaps[fl] );
+
+    uint64_t largest = 0;
+    for (uint32_t node = m_freeHeads[fl][sl]; node != INVALID_NODE; node = m_nodes[node].nextFree)
+    {
+        largest = std::max( largest, m_nodes[node].size );
+    }
+
+    return largest;
+}
+
+bool TlsfAllocator::Validate() const
+{
+    uint64_t offset    = 0;
+    uint64_t usedBytes = 0;
+    uint32_t used      = 0;
+    uint32_t free      = 0;
+    uint32_t prev      = INVALID_NODE;
+    for (uint32_t node = 0; node != INVALID_NODE; node = m_nodes[node].nextPhysical)
+    {
+        const Node& n = m_nodes[node];
+        if (n.offset != offset || n.prevPhysical != prev || (n.size == 0 && m_capacity > 0))
+            return false;
+
+        if ((n.offset | n.size) & (m_granularity - 1))
+            return false;
+
+        if (n.bFree)
+        {
+            if (prev != INVALID_NODE && m_nodes[prev].bFree)
+                return false;
+
+            uint32_t fl, sl;
+            GetClass( n.size >> m_granularityShift, fl, sl );
+
+            bool bListed = false;
+            for (uint32_t i = m_freeHeads[fl][sl]; i != INVALID_NODE && !bListed; i = m_nodes[i].nextFree)
+            {
+                bListed = i == node;
+            }
+            if (!bListed)
+                return false;
+
+            free++;
+        }
+        else
+        {
+            usedBytes += n.size;
+            used++;
+        }
+
+        offset += n.size;
+        prev = node;
+    }
+
+    if (offset != m_capacity || usedBytes != m_usedBytes || used != m_allocationCount || free != m_freeRangeCount)
+        return false;
+
+    uint32_t listed = 0;
+    for (uint32_t fl = 0; fl < FL_COUNT; ++fl)
+    {
+        if (((m_flBitmap >> fl) & 1) != (m_slBitmaps[fl] != 0 ? 1u : 0u))
+            return false;
+
+        for (uint32_t sl = 0; sl < SL_COUNT; ++sl)
+        {
+            if (((m_slBitmaps[fl] >> sl) & 1) != (m_freeHeads[fl][sl] != INVALID_NODE ? 1u : 0u))
+                return false;
+
+            for (uint32_t i = m_freeHeads[fl][sl]; i != INVALID_NODE; i = m_nodes[i].nextFree)
+            {
+                if (!m_nodes[i].bFree)
+                    return false;
+                listed++;
+            }
+        }
+    }
+
+    return listed == m_freeRangeCount;
+}
+
+void TlsfAllocator::GetClass( uint64_t granules, uint32_t& fl, uint32_t& sl )
+{
+    if (granules < SL_COUNT)
+    {
+        fl = 0;
+        sl = static_cast<uint32_t>(granules);
+        return;
+    }
+
+    const uint32_t msb = FindHighestBit( granules );
+    fl = msb - SL_BITS + 1;
+    sl = static_cast<uint32_t>(granules >> (msb - SL_BITS)) - SL_COUNT;
+}
+
+uint32_t TlsfAllocator::FindFree( uint64_t granules ) const
+{
+    // Rounded up to the next class boundary, so every range of the class found is large enough
+    if (granules >= SL_COUNT)
+        granules += (1ull << (FindHighestBit( granules ) - SL_BITS)) - 1;
+
+    uint32_t fl, sl;
+    GetClass( granules, fl, sl );
+
+    uint32_t slBitmap = m_slBitmaps[fl] & (~0u << sl);
+    if (slBitmap == 0)
+    {
+        const uint64_t flBitmap = fl + 1 < 64 ? m_flBitmap & (~0ull << (fl + 1)) : 0;
+        if (flBitmap == 0)
+            return INVALID_NODE;
+
+        fl       = FindLowestBit( flBitmap );
+        slBitmap = m_slBitmaps[fl];
+    }
+
+    return m_freeHeads[fl][FindLowestBit( slBitmap )];
+}
+
+void TlsfAllocator::InsertFree( uint32_t node )
+{
+    uint32_t fl, sl;
+    GetClass( m_nodes[node].size >> m_granularityShift, fl, sl );
+
+    const uint32_t head = m_freeHeads[fl][sl];
+    m_nodes[node].bFree    = true;
+    m_nodes[node].prevFree = INVALID_NODE;
+    m_nodes[node].nextFree = head;
+    if (head != INVALID_NODE)
+        m_nodes[head].prevFree = node;
+
+    m_freeHeads[fl][sl] = node;
+    m_slBitmaps[fl] |= 1u << sl;
+    m_flBitmap      |= 1ull << fl;
+
+    m_freeRangeCount++;
+}
+
+void TlsfAllocator::RemoveFree( uint32_t node )
+{
+    uint32_t fl, sl;
+    GetClass( m_nodes[node].size >> m_granularityShift, fl, sl );
+
+    const uint32_t prev = m_nodes[node].prevFree;
+    const uint32_t next = m_nodes[node].nextFree;
+    if (prev != INVALID_NODE)
+        m_nodes[prev].nextFree = next;
+    else
+        m_freeHeads[fl][sl] = next;
+
+    if (next != INVALID_NODE)
+        m_nodes[next].prevFree = prev;
+
+    if (m_freeHeads[fl][sl] == INVALID_NODE)
+    {
+        m_slBitmaps[fl] &= ~(1u << sl);
+        if (m_slBitmaps[fl] == 0)
+            m_flBitmap &= ~(1ull << fl);
+    }
+
+    m_nodes[node].bFree = false;
+    m_freeRangeCount--;
+}
+
+uint32_t TlsfAllocator::Split( uint32_t node, uint64_t size )
+{
+    // May grow m_nodes, so nothing is held by reference across it
+    const uint32_t rest = CreateNode();
+
+    Node& n = m_nodes[node];
+    Node& r = m_nodes[rest];
+    r.offset       = n.offset + size;
+    r.size         = n.size - size;
+    r.prevPhysical = node;
+    r.nextPhysical = n.nextPhysical;
+    if (n.nextPhysical != INVALID_NODE)
+        m_nodes[n.nextPhysical].prevPhysical = rest;
+
+    n.size         = size;
+    n.nextPhysical = rest;
+
+    return rest;
+}
+
+uint32_t TlsfAllocator::CreateNode()
+{
+    uint32_t node;
+    if (!m_unusedNodes.empty())
+    {
+        node = m_unusedNodes.back();
+        m_unusedNodes.pop_back();
+    }
+    else
+    {
+        node = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.push_back( Node() );
+    }
+
+    Node& n = m_nodes[node];
+    n.offset       = 0;
+    n.size         = 0;
+    n.prevPhysical = INVALID_NODE;
+    n.nextPhysical = INVALID_NODE;
+    n.prevFree     = INVALID_NODE;
+    n.nextFree     = INVALID_NODE;
+    n.bFree        = false;
+
+    return node;
+}
+
+void TlsfAllocator::DestroyNode( uint32_t node )
+{
+    m_nodes[node].bFree = false;
+    m_unusedNodes.push_back( node );
+}
@@ -0,0 +1,66 @@
+UploadRing::UploadRing( ID3D12Device* pDevice, UINT64 capacity )
+{
+    D3D12_HEAP_PROPERTIES heapProps = {};
+    heapProps.Type                 = D3D12_HEAP_TYPE_UPLOAD;
+    heapProps.CPUPageProperty      = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+    heapProps.CreationNodeMask     = 1;
+    heapProps.VisibleNodeMask      = 1;
+
+    D3D12_RESOURCE_DESC desc = {};
+    desc.Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER;
+    desc.Width            = capacity;
+    desc.Height           = 1;
+    desc.DepthOrArraySize = 1;
+    desc.MipLevels        = 1;
+    desc.Format           = DXGI_FORMAT_UNKNOWN;
+    desc.SampleDesc.Count = 1;
+    desc.Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    desc.Flags            = D3D12_RESOURCE_FLAG_NONE;
+
+    void*  pCPUBase = nullptr;
+    UINT64 gpuBase  = 0;
+
+    HRESULT hr = pDevice->CreateCommittedResource( &heapProps,
+                                                   D3D12_HEAP_FLAG_NONE,
+                                                   &desc,
+                                                   D3D12_RESOURCE_STATE_GENERIC_READ,
+                                                   nullptr,
+                                                   IID_PPV_ARGS( m_pResource.ReleaseAndGetAddressOf() ) );
+    if (FAILED( hr ))
+    {
+        Log::Output( Log::LOG_LEVEL_ERROR, "UploadRing::CreateCommittedResource() Failed." );
+        m_pResource.Reset();
+    }
+    else
+    {
+        // Upload heaps may stay mapped for the lifetime of the resource
+        D3D12_RANGE readRange = { 0, 0 };
+        hr = m_pResource->Map( 0, &readRange, &pCPUBase );
+        if (FAILED( hr ))
+        {
+            Log::Output( Log::LOG_LEVEL_ERROR, "UploadRing::Map() Failed." );
+            m_pResource.Reset();
+            pCPUBase = nullptr;
+        }
+        else
+        {
+            gpuBase = m_pResource->GetGPUVirtualAddress();
+
+            MemoryTracker& tracker = MemoryTracker::GetInstance();
+            tracker.SetOwnerName( this, "Upload ring" );
+            m_memory = tracker.Track( MemoryTracker::CATEGORY_CONSTANTS, MemoryResourceDesc::Buffer( capacity ), this );
+        }
+    }
+
+    m_pAllocator = unique_ptr<UploadRingAllocator>( new UploadRingAllocator( pCPUBase, gpuBase, capacity, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT ) );
+}
+
+UploadRing::~UploadRing()
+{
+    if (m_pResource != nullptr)
+        m_pResource->Unmap( 0, nullptr );
+
+    m_memory.Release();
+    MemoryTracker::GetInstance().RemoveOwner( this );
+}
@@ -0,0 +1,145 @@
+#include "UploadRingAllocator.h"
+#include "ConstantUpload.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const uint64_t NO_RETAIN = ~0ULL;
+}
+
+UploadRingAllocator::UploadRingAllocator( void* pCPUBase, uint64_t gpuBase, uint64_t capacity, uint32_t alignment )
+    : m_pCPUBase( static_cast<unsigned char*>(pCPUBase) )
+    , m_gpuBase( gpuBase )
+    , m_capacity( capacity )
+    , m_alignment( std::max( alignment, 1u ) )
+    , m_head( 0 )
+    , m_tail( 0 )
+    , m_retainBegin( NO_RETAIN )
+{
+}
+
+UploadRingAllocator::~UploadRingAllocator()
+{
+}
+
+UploadRingAllocator::Allocation UploadRingAllocator::Allocate( uint32_t size )
+{
+    Allocation allocation;
+
+    const uint64_t alignedSize = (static_cast<uint64_t>(size) + m_alignment - 1) / m_alignment * m_alignment;
+    if (m_pCPUBase == nullptr || alignedSize == 0 || alignedSize > m_capacity)
+    {
+        m_statistics.failures++;
+        return allocation;
+    }
+
+    // Allocations never straddle the end of the buffer
+    const uint64_t offset  = m_head % m_capacity;
+    const uint64_t padding = (offset + alignedSize > m_capacity) ? m_capacity - offset : 0;
+
+    if (m_head + padding + alignedSize - m_tail > m_capacity)
+    {
+        m_statistics.failures++;
+        return allocation;
+    }
+
+    m_head += padding;
+
+    allocation.virtualOffset = m_head;
+    allocation.size          = static_cast<uint32_t>(alignedSize);
+    allocation.pCPU          = m_pCPUBase + (m_head % m_capacity);
+    allocation.gpuAddress    = m_gpuBase + (m_head % m_capacity);
+
+    m_head += alignedSize;
+
+    m_statistics.allocations++;
+    m_statistics.frameBytes    += alignedSize;
+    m_statistics.usedBytes      = m_head - m_tail;
+    m_statistics.highWaterBytes = std::max( m_statistics.highWaterBytes, m_statistics.usedBytes );
+
+    return allocation;
+}
+
+bool UploadRingAllocator::CanReuse( const Allocation& allocation ) const
+{
+    if (!allocation.IsValid())
+        return false;
+
+    // Reclaimed space is only overwritten once the head wraps around to it. Restricting reuse to the
+    // newer half of the ring keeps the copy intact and bounds how much of the ring it can pin.
+    return allocation.virtualOffset + allocation.size <= m_head &&
+           m_head - allocation.virtualOffset <= m_capacity / 2;
+}
+
+void UploadRingAllocator::Retain( const Allocation& allocation )
+{
+    // Moving the tail back is safe because the head has not wrapped onto the allocation yet
+    m_tail        = std::min( m_tail, allocation.virtualOffset );
+    m_retainBegin = std::min( m_retainBegin, allocation.virtualOffset );
+
+    m_statistics.usedBytes = m_head - m_tail;
+    m_statistics.reuses++;
+}
+
+void UploadRingAllocator::EndFrame( uint64_t fenceValue )
+{
+    Frame frame;
+    frame.fenceValue  = fenceValue;
+    frame.end         = m_head;
+    frame.retainBegin = m_retainBegin;
+    m_frames.push_back( frame );
+
+    m_retainBegin = NO_RETAIN;
+
+    m_statistics.lastFrameBytes = m_statistics.frameBytes;
+    m_statistics.frameBytes     = 0;
+}
+
+void UploadRingAllocator::Reclaim( uint64_t completedFenceValue )
+{
+    uint64_t tail = m_tail;
+    while (!m_frames.empty() && m_frames.front().fenceValue <= completedFenceValue)
+    {
+        tail = m_frames.front().end;
+        m_frames.pop_front();
+    }
+
+    // Frames still in flight may reference allocations older than their own start
+    uint64_t retainBegin = m_retainBegin;
+    for (const auto& frame : m_frames)
+    {
+        retainBegin = std::min( retainBegin, frame.retainBegin );
+    }
+
+    m_tail = std::max( m_tail, std::min( tail, retainBegin ) );
+
+    m_statistics.usedBytes = m_head - m_tail;
+}
+
+bool ConstantUpload::Update( UploadRingAllocator& ring, const void* pData, uint32_t size )
+{
+    if (!m_bDirty && ring.CanReuse( m_allocation ))
+    {
+        ring.Retain( m_allocation );
+        return false;
+    }
+
+    UploadRingAllocator::Allocation allocation = ring.Allocate( size );
+    if (!allocation.IsValid())
+    {
+        // Keep the previous copy if there is one; the data is written again next frame
+        if (m_allocation.IsValid())
+            ring.Retain( m_allocation );
+
+        return false;
+    }
+
+    memcpy( allocation.pCPU, pData, size );
+
+    m_allocation = allocation;
+    m_bDirty     = false;
+
+    return true;
+}